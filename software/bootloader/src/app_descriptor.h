@@ -13,7 +13,9 @@
  */
 typedef struct {
     uint32_t magic_word;        /*!< Magic word APP_DESCRIPTOR_MAGIC_WORD */
-    uint32_t reserved1[3];      /*!< Reserved */
+    uint32_t protocol_version;  /*!< Host protocol version, or 0 if unversioned */
+    uint32_t settings_version;  /*!< Settings schema version, or 0 if unversioned */
+    uint32_t reserved1;         /*!< Reserved */
     char project_name[32];      /*!< Project name */
     char version[32];           /*!< Application version */
     char build_date[20];        /*!< Build timestamp */
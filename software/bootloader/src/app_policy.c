@@ -0,0 +1,34 @@
+#include "app_policy.h"
+
+#include <stddef.h>
+
+static const char SETTINGS_HEADER_MAGIC[] = "DENSITOMETER";
+
+uint32_t app_policy_stored_settings_version(const uint8_t *magic, const uint8_t *schema)
+{
+    /* An uninitialized settings header has no schema to protect */
+    for (size_t i = 0; i < sizeof(SETTINGS_HEADER_MAGIC); i++) {
+        if (magic[i] != (uint8_t)SETTINGS_HEADER_MAGIC[i]) {
+            return 0;
+        }
+    }
+
+    return ((uint32_t)schema[0] << 24) | ((uint32_t)schema[1] << 16)
+        | ((uint32_t)schema[2] << 8) | (uint32_t)schema[3];
+}
+
+uint32_t app_policy_app_settings_version(const app_descriptor_t *app_descriptor)
+{
+    if (app_descriptor->settings_version == 0) {
+        return APP_POLICY_SETTINGS_VERSION_LEGACY;
+    }
+    return app_descriptor->settings_version;
+}
+
+bool app_policy_settings_compatible(const app_descriptor_t *app_descriptor, uint32_t stored_settings_version)
+{
+    if (!app_descriptor) {
+        return false;
+    }
+    return app_policy_app_settings_version(app_descriptor) >= stored_settings_version;
+}
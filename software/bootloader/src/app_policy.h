@@ -0,0 +1,48 @@
+#ifndef APP_POLICY_H
+#define APP_POLICY_H
+
+/*
+ * Decision logic for whether the bootloader may start an application.
+ *
+ * These functions only depend on the C standard library, so that the
+ * checks can be built and exercised on a host machine separately from
+ * the hardware specific code in board.c.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_descriptor.h"
+
+/** Settings schema version assumed for applications from before schema versioning */
+#define APP_POLICY_SETTINGS_VERSION_LEGACY 1UL
+
+/**
+ * Read the settings schema version from the settings header in EEPROM.
+ *
+ * @param magic Magic string at the start of the settings header
+ * @param schema Big-endian schema version within the settings header
+ * @return Schema version, or 0 if the settings header is uninitialized
+ */
+uint32_t app_policy_stored_settings_version(const uint8_t *magic, const uint8_t *schema);
+
+/**
+ * Get the settings schema version an application was built for,
+ * treating unversioned applications as the legacy schema.
+ */
+uint32_t app_policy_app_settings_version(const app_descriptor_t *app_descriptor);
+
+/**
+ * Check whether an application can be started without misreading or
+ * clearing the settings stored in EEPROM.
+ *
+ * An application is refused if its settings schema is older than the
+ * stored one. Newer applications migrate the stored settings forward.
+ * The host protocol version has no bearing on this check.
+ *
+ * @param app_descriptor Descriptor of the application
+ * @param stored_settings_version Schema version of the settings in EEPROM, or 0 if none
+ * @return True if the application is compatible with the stored settings
+ */
+bool app_policy_settings_compatible(const app_descriptor_t *app_descriptor, uint32_t stored_settings_version);
+
+#endif /* APP_POLICY_H */
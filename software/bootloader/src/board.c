@@ -2,6 +2,7 @@
 #include "stm32l0xx_hal.h"
 #include "tusb.h"
 #include "app_descriptor.h"
+#include "app_policy.h"
 #ifdef HAL_SPI_MODULE_ENABLED
 #include "display.h"
 #endif
@@ -94,6 +95,19 @@ bool board_app_valid(void)
         BL_LOG_STR("App checksum is valid\r\n");
     }
 
+    /*
+     * Refuse to start an application that is older than the settings
+     * schema in EEPROM, since it would misread or clear the stored
+     * calibration.
+     */
+    const uint32_t stored_settings_version = app_policy_stored_settings_version(
+        (const uint8_t *)BOARD_SETTINGS_HEADER_MAGIC,
+        (const uint8_t *)BOARD_SETTINGS_HEADER_SCHEMA);
+    if (!app_policy_settings_compatible((const app_descriptor_t *)app_descriptor, stored_settings_version)) {
+        BL_LOG_STR("App settings schema is too old\r\n");
+        return false;
+    }
+
     return true;
 }
 
@@ -16,6 +16,12 @@
 /** Start address of the application descriptor structure in flash */
 #define BOARD_FLASH_APP_DESCRIPTOR 0x0802FF00UL
 
+/** Address of the settings header magic string in EEPROM */
+#define BOARD_SETTINGS_HEADER_MAGIC (DATA_EEPROM_BASE + 0x0000UL)
+
+/** Address of the settings schema version in EEPROM (big-endian) */
+#define BOARD_SETTINGS_HEADER_SCHEMA (DATA_EEPROM_BASE + 0x0014UL)
+
 #define BOARD_UF2_FAMILY_ID 0x202E3A91 /*!< ST STM32L0xx */
 #define USB_VID           0x16D0
 #define USB_PID           0x1198
@@ -0,0 +1,156 @@
+/*
+ * Host tests for the bootloader's application start policy, run against
+ * synthesized application images and settings headers
+ */
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "test.h"
+#include "board.h"
+#include "app_policy.h"
+
+/* Offsets within the settings header page, from settings.c in the firmware */
+#define HEADER_MAGIC  0U
+#define HEADER_SCHEMA 20U
+#define HEADER_SIZE   128U
+
+#define IMAGE_SIZE (BOARD_FLASH_APP_DESCRIPTOR - BOARD_FLASH_APP_START + sizeof(app_descriptor_t))
+
+static uint8_t *make_image(uint32_t protocol_version, uint32_t settings_version)
+{
+    uint8_t *image = calloc(1, IMAGE_SIZE);
+    app_descriptor_t desc = {
+        .magic_word = APP_DESCRIPTOR_MAGIC_WORD,
+        .protocol_version = protocol_version,
+        .settings_version = settings_version,
+        .project_name = "Printalyzer-Densitometer",
+        .version = "v0.7.0",
+        .build_date = "2022-11-05 14:32",
+        .build_describe = "v0.7.0-0-g0000000"
+    };
+    memcpy(image + (BOARD_FLASH_APP_DESCRIPTOR - BOARD_FLASH_APP_START), &desc, sizeof(desc));
+    return image;
+}
+
+static const app_descriptor_t *image_descriptor(const uint8_t *image)
+{
+    return (const app_descriptor_t *)(image + (BOARD_FLASH_APP_DESCRIPTOR - BOARD_FLASH_APP_START));
+}
+
+static void make_header(uint8_t *header, uint32_t schema)
+{
+    memset(header, 0xFF, HEADER_SIZE);
+    memcpy(header + HEADER_MAGIC, "DENSITOMETER\0", 13);
+    header[HEADER_SCHEMA + 0] = (schema >> 24) & 0xFF;
+    header[HEADER_SCHEMA + 1] = (schema >> 16) & 0xFF;
+    header[HEADER_SCHEMA + 2] = (schema >> 8) & 0xFF;
+    header[HEADER_SCHEMA + 3] = schema & 0xFF;
+}
+
+static uint32_t stored_version(const uint8_t *header)
+{
+    return app_policy_stored_settings_version(header + HEADER_MAGIC, header + HEADER_SCHEMA);
+}
+
+static bool image_compatible(uint32_t protocol_version, uint32_t settings_version, uint32_t stored)
+{
+    uint8_t *image = make_image(protocol_version, settings_version);
+    bool result = app_policy_settings_compatible(image_descriptor(image), stored);
+    free(image);
+    return result;
+}
+
+static void test_stored_settings_version(void)
+{
+    uint8_t header[HEADER_SIZE];
+
+    make_header(header, 7);
+    CHECK(stored_version(header) == 7);
+
+    /* Stored big-endian, as written by the firmware */
+    make_header(header, 0x01020304);
+    CHECK(stored_version(header) == 0x01020304);
+
+    /* Erased EEPROM */
+    memset(header, 0x00, sizeof(header));
+    CHECK(stored_version(header) == 0);
+    memset(header, 0xFF, sizeof(header));
+    CHECK(stored_version(header) == 0);
+
+    /* The magic string has to match in full, including its terminator */
+    make_header(header, 7);
+    header[11] = 'S';
+    CHECK(stored_version(header) == 0);
+    make_header(header, 7);
+    header[12] = 'X';
+    CHECK(stored_version(header) == 0);
+}
+
+static void test_app_settings_version(void)
+{
+    uint8_t *image = make_image(3, 7);
+    CHECK(app_policy_app_settings_version(image_descriptor(image)) == 7);
+    free(image);
+
+    /* Unversioned applications are treated as the legacy schema */
+    image = make_image(0, 0);
+    CHECK(app_policy_app_settings_version(image_descriptor(image)) == APP_POLICY_SETTINGS_VERSION_LEGACY);
+    free(image);
+}
+
+static void test_settings_compatible(void)
+{
+    /* Same or newer schema than the stored settings */
+    CHECK(image_compatible(3, 7, 7));
+    CHECK(image_compatible(3, 8, 7));
+
+    /* Older schema than the stored settings */
+    CHECK(!image_compatible(3, 6, 7));
+    CHECK(!image_compatible(3, 1, 2));
+
+    /* Nothing stored yet, so anything may start */
+    CHECK(image_compatible(0, 0, 0));
+    CHECK(image_compatible(3, 7, 0));
+
+    /* Unversioned applications can only start on legacy settings */
+    CHECK(image_compatible(0, 0, 1));
+    CHECK(!image_compatible(0, 0, 2));
+
+    CHECK(!app_policy_settings_compatible(NULL, 0));
+}
+
+static void test_protocol_version_ignored(void)
+{
+    /* The protocol version only matters to the host, not the bootloader */
+    CHECK(image_compatible(0, 7, 7));
+    CHECK(image_compatible(UINT32_MAX, 7, 7));
+    CHECK(!image_compatible(UINT32_MAX, 6, 7));
+}
+
+static void test_stored_header(void)
+{
+    /* From a settings header through to the decision, as in board_app_valid() */
+    uint8_t header[HEADER_SIZE];
+    uint8_t *image = make_image(3, 6);
+
+    make_header(header, 6);
+    CHECK(app_policy_settings_compatible(image_descriptor(image), stored_version(header)));
+
+    make_header(header, 7);
+    CHECK(!app_policy_settings_compatible(image_descriptor(image), stored_version(header)));
+
+    memset(header, 0xFF, sizeof(header));
+    CHECK(app_policy_settings_compatible(image_descriptor(image), stored_version(header)));
+
+    free(image);
+}
+
+int main(void)
+{
+    RUN_TEST(test_stored_settings_version);
+    RUN_TEST(test_app_settings_version);
+    RUN_TEST(test_settings_compatible);
+    RUN_TEST(test_protocol_version_ignored);
+    RUN_TEST(test_stored_header);
+    return TEST_RESULT();
+}
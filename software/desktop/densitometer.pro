@@ -2,7 +2,7 @@
 # Qt and Make options
 #-------------------------------------------------------------------------------
 
-QT += core gui serialport
+QT += core gui serialport network qml printsupport
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -54,48 +54,90 @@ linux:!android {
 #-------------------------------------------------------------------------------
 
 SOURCES += \
+    src/auditlog.cpp \
+    src/calprofilesdialog.cpp \
+    src/calreport.cpp \
+    src/cgats.cpp \
     src/connectdialog.cpp \
+    src/crashreport.cpp \
     src/denscalvalues.cpp \
     src/denscommand.cpp \
     src/densinterface.cpp \
+    src/denstransport.cpp \
+    src/firmwareimage.cpp \
     src/floatitemdelegate.cpp \
     src/gaincalibrationdialog.cpp \
     src/headlesstask.cpp \
+    src/hidtemplate.cpp \
+    src/hidtemplatedialog.cpp \
     src/logger.cpp \
     src/logwindow.cpp \
     src/main.cpp \
     src/mainwindow.cpp \
+    src/menusettingsdialog.cpp \
+    src/qcdialog.cpp \
+    src/qcevaluator.cpp \
+    src/readingtransform.cpp \
     src/remotecontroldialog.cpp \
+    src/rpcserver.cpp \
     src/settingsexporter.cpp \
     src/settingsimportdialog.cpp \
+    src/settingsschema.cpp \
     src/slopecalibrationdialog.cpp \
+    src/steptablet.cpp \
+    src/temperaturefit.cpp \
+    src/undocommands.cpp \
     src/util.cpp \
+    src/workspace.cpp \
     src/qsimplesignalaggregator.cpp
 
 HEADERS += \
+    src/auditlog.h \
+    src/calprofilesdialog.h \
+    src/calreport.h \
+    src/cgats.h \
     src/connectdialog.h \
+    src/crashreport.h \
     src/denscalvalues.h \
     src/denscommand.h \
     src/densinterface.h \
+    src/denstransport.h \
+    src/firmwareimage.h \
     src/floatitemdelegate.h \
     src/gaincalibrationdialog.h \
     src/headlesstask.h \
+    src/hidtemplate.h \
+    src/hidtemplatedialog.h \
     src/logger.h \
     src/logwindow.h \
     src/mainwindow.h \
+    src/menusettingsdialog.h \
+    src/qcdialog.h \
+    src/qcevaluator.h \
+    src/readingtransform.h \
     src/remotecontroldialog.h \
+    src/rpcserver.h \
     src/settingsexporter.h \
     src/settingsimportdialog.h \
+    src/settingsschema.h \
     src/slopecalibrationdialog.h \
+    src/steptablet.h \
+    src/temperaturefit.h \
+    src/undocommands.h \
     src/util.h \
+    src/workspace.h \
     src/qsignalaggregator.h \
     src/qsimplesignalaggregator.h
 
 FORMS += \
+    src/calprofilesdialog.ui \
     src/connectdialog.ui \
     src/gaincalibrationdialog.ui \
+    src/hidtemplatedialog.ui \
     src/logwindow.ui \
     src/mainwindow.ui \
+    src/menusettingsdialog.ui \
+    src/qcdialog.ui \
     src/remotecontroldialog.ui \
     src/settingsimportdialog.ui \
     src/slopecalibrationdialog.ui
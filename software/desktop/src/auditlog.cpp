@@ -0,0 +1,284 @@
+#include "auditlog.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QDebug>
+
+namespace
+{
+const QString GENESIS_HASH = QString(64, QLatin1Char('0'));
+}
+
+AuditLog::AuditLog(const QString &fileName)
+    : fileName_(fileName)
+    , lastSeq_(0)
+    , lastHash_(GENESIS_HASH)
+{
+    load();
+}
+
+QString AuditLog::defaultFileName()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation))
+            .filePath(QStringLiteral("audit.jsonl"));
+}
+
+QString AuditLog::fileName() const
+{
+    return fileName_;
+}
+
+void AuditLog::load()
+{
+    QFile file(fileName_);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return;
+    }
+
+    // Only the chain position and device states are needed here,
+    // since the chain itself is checked by verify()
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) { continue; }
+
+        const QJsonObject entry = QJsonDocument::fromJson(line).object();
+        if (entry.isEmpty()) { continue; }
+
+        lastSeq_ = entry.value("seq").toVariant().toLongLong();
+        lastHash_ = entry.value("hash").toString();
+
+        const QString uniqueId = entry.value("uid").toString();
+        const QString event = entry.value("event").toString();
+        if (event == QLatin1String("write")) {
+            pendingWrites_[uniqueId]++;
+        } else if (event == QLatin1String("cancel")) {
+            if (pendingWrites_.value(uniqueId) > 0) {
+                pendingWrites_[uniqueId]--;
+            }
+        } else if (event == QLatin1String("sync") || event == QLatin1String("untracked")) {
+            DeviceRecord record;
+            record.count = entry.value("count").toVariant().toUInt();
+            record.hash = entry.value("device_hash").toString();
+            devices_.insert(uniqueId, record);
+            pendingWrites_.remove(uniqueId);
+        }
+    }
+}
+
+bool AuditLog::recordWrite(const QString &uniqueId, const QString &field,
+                           const QString &oldValue, const QString &newValue)
+{
+    QJsonObject entry;
+    entry.insert("event", QStringLiteral("write"));
+    entry.insert("uid", uniqueId);
+    entry.insert("field", field);
+    entry.insert("old", oldValue);
+    entry.insert("new", newValue);
+
+    if (!append(entry)) { return false; }
+    pendingWrites_[uniqueId]++;
+    return true;
+}
+
+bool AuditLog::recordCancel(const QString &uniqueId, const QString &field)
+{
+    if (pendingWrites_.value(uniqueId) == 0) { return false; }
+
+    QJsonObject entry;
+    entry.insert("event", QStringLiteral("cancel"));
+    entry.insert("uid", uniqueId);
+    entry.insert("field", field);
+
+    if (!append(entry)) { return false; }
+    pendingWrites_[uniqueId]--;
+    return true;
+}
+
+AuditLog::DeviceState AuditLog::recordDeviceState(const QString &uniqueId, quint32 count, const QString &hash)
+{
+    DeviceState state;
+    QString event;
+
+    const bool known = devices_.contains(uniqueId);
+    const DeviceRecord record = devices_.value(uniqueId);
+    const quint32 pending = pendingWrites_.value(uniqueId);
+
+    if (!known) {
+        // First time this device has been seen, so just note its state
+        state = DeviceSynced;
+        event = QStringLiteral("sync");
+    } else if (pending > 0 && count == record.count + pending) {
+        // Accounted for by the changes logged since the last sync
+        state = DeviceSynced;
+        event = QStringLiteral("sync");
+    } else if (pending == 0 && record.count == count && record.hash == hash) {
+        return DeviceUnchanged;
+    } else {
+        state = DeviceUntracked;
+        event = QStringLiteral("untracked");
+    }
+
+    QJsonObject entry;
+    entry.insert("event", event);
+    entry.insert("uid", uniqueId);
+    entry.insert("count", static_cast<qint64>(count));
+    entry.insert("device_hash", hash);
+    if (state == DeviceUntracked) {
+        entry.insert("old", QString("%1,%2").arg(record.count).arg(record.hash));
+        entry.insert("new", QString("%1,%2").arg(count).arg(hash));
+        if (pending > 0) {
+            entry.insert("expected", static_cast<qint64>(record.count + pending));
+        }
+        if (count < record.count) {
+            entry.insert("note", QStringLiteral("change counter went backwards, settings may have been wiped"));
+        }
+    }
+
+    append(entry);
+
+    DeviceRecord updated;
+    updated.count = count;
+    updated.hash = hash;
+    devices_.insert(uniqueId, updated);
+    pendingWrites_.remove(uniqueId);
+
+    return state;
+}
+
+bool AuditLog::append(QJsonObject &entry)
+{
+    QFileInfo(fileName_).absoluteDir().mkpath(QStringLiteral("."));
+
+    QFile file(fileName_);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qWarning() << "Unable to open audit log:" << fileName_;
+        return false;
+    }
+
+    entry.insert("seq", lastSeq_ + 1);
+    entry.insert("time", QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs));
+    entry.insert("user", currentUser());
+    entry.insert("prev", lastHash_);
+    const QString hash = entryHash(entry);
+    entry.insert("hash", hash);
+
+    const QByteArray line = QJsonDocument(entry).toJson(QJsonDocument::Compact) + '\n';
+    if (file.write(line) != line.size()) {
+        qWarning() << "Unable to write audit log:" << fileName_;
+        return false;
+    }
+    file.close();
+
+    lastSeq_++;
+    lastHash_ = hash;
+
+    if (fileName_ == defaultFileName()) {
+        QSettings settings;
+        settings.setValue("audit/seq", lastSeq_);
+        settings.setValue("audit/hash", lastHash_);
+    }
+    return true;
+}
+
+QString AuditLog::entryHash(const QJsonObject &entry)
+{
+    // QJsonObject keeps its keys sorted, so the compact form is canonical
+    QJsonObject content = entry;
+    content.remove("hash");
+    const QByteArray data = QJsonDocument(content).toJson(QJsonDocument::Compact);
+    return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+}
+
+QString AuditLog::currentUser()
+{
+    QString user = QString::fromLocal8Bit(qgetenv("USER"));
+    if (user.isEmpty()) {
+        user = QString::fromLocal8Bit(qgetenv("USERNAME"));
+    }
+    return user;
+}
+
+bool AuditLog::verify(const QString &fileName, QStringList *issues)
+{
+    QStringList found;
+    bool intact = true;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (issues) {
+            issues->append(QString("Unable to open audit log: %1").arg(fileName));
+        }
+        return false;
+    }
+
+    qint64 expectedSeq = 1;
+    QString prevHash = GENESIS_HASH;
+    int lineNumber = 0;
+
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        lineNumber++;
+        if (line.isEmpty()) { continue; }
+
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+        if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+            found.append(QString("Line %1: not a valid entry").arg(lineNumber));
+            intact = false;
+            continue;
+        }
+
+        const QJsonObject entry = doc.object();
+        const qint64 seq = entry.value("seq").toVariant().toLongLong();
+        const QString hash = entry.value("hash").toString();
+
+        if (seq != expectedSeq) {
+            found.append(QString("Line %1: expected entry %2, found %3").arg(lineNumber).arg(expectedSeq).arg(seq));
+            intact = false;
+        }
+        if (entry.value("prev").toString() != prevHash) {
+            found.append(QString("Line %1: entry %2 does not link to the previous entry").arg(lineNumber).arg(seq));
+            intact = false;
+        }
+        if (entryHash(entry) != hash) {
+            found.append(QString("Line %1: entry %2 does not match its hash").arg(lineNumber).arg(seq));
+            intact = false;
+        }
+        if (entry.value("event").toString() == QLatin1String("untracked")) {
+            found.append(QString("Line %1: untracked change on device %2 (%3 -> %4)")
+                         .arg(lineNumber)
+                         .arg(entry.value("uid").toString(),
+                              entry.value("old").toString(),
+                              entry.value("new").toString()));
+        }
+
+        expectedSeq = seq + 1;
+        prevHash = hash;
+    }
+
+    // The latest entry of the default log is also kept in the settings,
+    // so entries removed from the end of the file can be detected
+    if (fileName == defaultFileName()) {
+        QSettings settings;
+        if (settings.contains("audit/seq")) {
+            const qint64 lastSeq = settings.value("audit/seq").toLongLong();
+            if (lastSeq != expectedSeq - 1 || settings.value("audit/hash").toString() != prevHash) {
+                found.append(QString("Log ends at entry %1, but entry %2 was the last one written")
+                             .arg(expectedSeq - 1).arg(lastSeq));
+                intact = false;
+            }
+        }
+    }
+
+    if (issues) {
+        issues->append(found);
+    }
+    return intact;
+}
@@ -0,0 +1,95 @@
+#ifndef AUDITLOG_H
+#define AUDITLOG_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+class QJsonObject;
+
+/**
+ * Tamper-evident log of changes made to device settings.
+ *
+ * The log is a JSON Lines file, with one entry per line. Each entry has
+ * a sequence number, the SHA-256 hash of the previous entry, and its own
+ * hash over its contents and that previous hash. Editing, removing or
+ * reordering entries therefore breaks the chain, which is detected by
+ * verify(). The hash and sequence number of the latest entry are also
+ * kept in the application settings, so that truncation of the default
+ * log can be detected as well.
+ *
+ * Entries have one of these events:
+ * - "write" for a settings change sent from this application
+ * - "cancel" for a change that was sent, but did not complete on the device
+ * - "sync" for the device's change counter and hash, read back after
+ *   logged changes were made
+ * - "untracked" when the device's change counter or hash do not account
+ *   for the logged changes, meaning the settings were changed on the
+ *   device itself or by another application
+ *
+ * The device counts each change to a user-visible setting once, so a
+ * device that only received the logged changes has advanced its counter
+ * by exactly the number of those changes.
+ */
+class AuditLog
+{
+public:
+    enum DeviceState {
+        DeviceUnchanged,
+        DeviceSynced,
+        DeviceUntracked
+    };
+
+    explicit AuditLog(const QString &fileName = defaultFileName());
+
+    static QString defaultFileName();
+    QString fileName() const;
+
+    /** Record a settings change that was sent to a device */
+    bool recordWrite(const QString &uniqueId, const QString &field,
+                     const QString &oldValue, const QString &newValue);
+
+    /**
+     * Record that a settings change sent to a device did not complete,
+     * such as a calibration run that failed before saving its results.
+     */
+    bool recordCancel(const QString &uniqueId, const QString &field);
+
+    /**
+     * Record the change counter and hash reported by a device.
+     *
+     * If the counter has advanced by exactly the number of changes logged
+     * since the device state was last recorded, the new state is accepted
+     * as the result of those changes. Otherwise any difference from the
+     * last recorded state is logged as an untracked change.
+     */
+    DeviceState recordDeviceState(const QString &uniqueId, quint32 count, const QString &hash);
+
+    /**
+     * Walk the hash chain of a log file, reporting sequence gaps, broken
+     * links, entries that do not match their hash, and untracked device
+     * changes.
+     *
+     * @return False if the chain is broken or the file could not be read
+     */
+    static bool verify(const QString &fileName, QStringList *issues);
+
+private:
+    void load();
+    bool append(QJsonObject &entry);
+    static QString entryHash(const QJsonObject &entry);
+    static QString currentUser();
+
+    struct DeviceRecord {
+        quint32 count = 0;
+        QString hash;
+    };
+
+    QString fileName_;
+    qint64 lastSeq_;
+    QString lastHash_;
+    QMap<QString, DeviceRecord> devices_;
+    QMap<QString, quint32> pendingWrites_;
+};
+
+#endif // AUDITLOG_H
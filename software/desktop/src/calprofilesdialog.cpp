@@ -0,0 +1,574 @@
+#include "calprofilesdialog.h"
+#include "ui_calprofilesdialog.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QInputDialog>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QRegularExpression>
+#include <QDebug>
+
+#include "settingsschema.h"
+
+namespace
+{
+static const int COL_SLOT = 0;
+static const int COL_ACTIVE = 1;
+static const int COL_NAME = 2;
+static const int PROFILE_NAME_LEN = 11;
+
+float parseFloat(const QJsonObject &obj, const QString &key)
+{
+    bool ok;
+    float value = obj[key].toString().toFloat(&ok);
+    return ok ? value : qSNaN();
+}
+
+QJsonObject targetToJson(const DensCalTarget &calTarget)
+{
+    QJsonObject jsonLo;
+    jsonLo["density"] = QString::number(calTarget.loDensity(), 'f', 2);
+    jsonLo["reading"] = QString::number(calTarget.loReading(), 'f', 6);
+
+    QJsonObject jsonHi;
+    jsonHi["density"] = QString::number(calTarget.hiDensity(), 'f', 2);
+    jsonHi["reading"] = QString::number(calTarget.hiReading(), 'f', 6);
+
+    QJsonObject jsonTarget;
+    jsonTarget["cal-lo"] = jsonLo;
+    jsonTarget["cal-hi"] = jsonHi;
+    return jsonTarget;
+}
+
+DensCalTarget targetFromJson(const QJsonObject &jsonTarget)
+{
+    const QJsonObject jsonLo = jsonTarget["cal-lo"].toObject();
+    const QJsonObject jsonHi = jsonTarget["cal-hi"].toObject();
+
+    DensCalTarget calTarget;
+    calTarget.setLoDensity(parseFloat(jsonLo, "density"));
+    calTarget.setLoReading(parseFloat(jsonLo, "reading"));
+    calTarget.setHiDensity(parseFloat(jsonHi, "density"));
+    calTarget.setHiReading(parseFloat(jsonHi, "reading"));
+    return calTarget;
+}
+
+bool isValidProfileName(const QString &name)
+{
+    static const QRegularExpression re("^[\\x20-\\x7E]+$");
+    return !name.isEmpty() && name.length() <= PROFILE_NAME_LEN
+            && re.match(name).hasMatch()
+            && !name.contains(QChar(',')) && !name.contains(QChar('"'));
+}
+}
+
+CalProfilesDialog::CalProfilesDialog(DensInterface *densInterface, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::CalProfilesDialog),
+    densInterface_(densInterface),
+    activeIndex_(-1),
+    busy_(false),
+    exportParts_(0),
+    importPendingSets_(0)
+{
+    ui->setupUi(this);
+
+    ui->profilesTableWidget->horizontalHeader()->setSectionResizeMode(COL_SLOT, QHeaderView::ResizeToContents);
+    ui->profilesTableWidget->horizontalHeader()->setSectionResizeMode(COL_ACTIVE, QHeaderView::ResizeToContents);
+
+    connect(densInterface_, &DensInterface::calProfileCountResponse, this, &CalProfilesDialog::onCalProfileCountResponse);
+    connect(densInterface_, &DensInterface::calProfileNameResponse, this, &CalProfilesDialog::onCalProfileNameResponse);
+    connect(densInterface_, &DensInterface::calProfileGainResponse, this, &CalProfilesDialog::onCalProfileGainResponse);
+    connect(densInterface_, &DensInterface::calProfileSlopeResponse, this, &CalProfilesDialog::onCalProfileSlopeResponse);
+    connect(densInterface_, &DensInterface::calProfileReflectionResponse, this, &CalProfilesDialog::onCalProfileReflectionResponse);
+    connect(densInterface_, &DensInterface::calProfileTransmissionResponse, this, &CalProfilesDialog::onCalProfileTransmissionResponse);
+    connect(densInterface_, &DensInterface::calProfileSelectComplete, this, &CalProfilesDialog::onCalProfileSelectComplete);
+    connect(densInterface_, &DensInterface::calProfileSetComplete, this, &CalProfilesDialog::onCalProfileSetComplete);
+    connect(densInterface_, &DensInterface::calProfileInvokeComplete, this, &CalProfilesDialog::onCalProfileInvokeComplete);
+
+    connect(ui->refreshPushButton, &QPushButton::clicked, this, &CalProfilesDialog::onRefreshClicked);
+    connect(ui->selectPushButton, &QPushButton::clicked, this, &CalProfilesDialog::onSelectClicked);
+    connect(ui->savePushButton, &QPushButton::clicked, this, &CalProfilesDialog::onSaveClicked);
+    connect(ui->renamePushButton, &QPushButton::clicked, this, &CalProfilesDialog::onRenameClicked);
+    connect(ui->copyPushButton, &QPushButton::clicked, this, &CalProfilesDialog::onCopyClicked);
+    connect(ui->clearPushButton, &QPushButton::clicked, this, &CalProfilesDialog::onClearClicked);
+    connect(ui->exportPushButton, &QPushButton::clicked, this, &CalProfilesDialog::onExportClicked);
+    connect(ui->importPushButton, &QPushButton::clicked, this, &CalProfilesDialog::onImportClicked);
+    connect(ui->profilesTableWidget, &QTableWidget::itemSelectionChanged, this, &CalProfilesDialog::onSelectionChanged);
+
+    onRefreshClicked();
+}
+
+CalProfilesDialog::~CalProfilesDialog()
+{
+    delete ui;
+}
+
+void CalProfilesDialog::onRefreshClicked()
+{
+    if (!densInterface_->connected()) { return; }
+
+    setBusy(true);
+    densInterface_->sendGetCalProfileCount();
+}
+
+void CalProfilesDialog::onSelectClicked()
+{
+    int index = selectedIndex();
+    if (index < 0 || !isSlotUsed(index)) { return; }
+
+    setBusy(true);
+    densInterface_->sendSetCalProfileActive(index);
+}
+
+void CalProfilesDialog::onSaveClicked()
+{
+    int index = selectedIndex();
+    if (index < 0) { return; }
+
+    if (isSlotUsed(index)) {
+        if (QMessageBox::question(this, tr("Save Current Calibration"),
+                                  tr("Replace the calibration in \"%1\" with the current calibration?").arg(slotLabel(index)))
+                != QMessageBox::Yes) {
+            return;
+        }
+    }
+
+    setBusy(true);
+    densInterface_->sendInvokeCalProfileSave(index);
+}
+
+void CalProfilesDialog::onRenameClicked()
+{
+    int index = selectedIndex();
+    if (index < 0 || !isSlotUsed(index)) { return; }
+
+    bool ok;
+    const QString name = QInputDialog::getText(this, tr("Rename Profile"),
+                                               tr("Profile name (up to %1 characters):").arg(PROFILE_NAME_LEN),
+                                               QLineEdit::Normal, slotLabel(index), &ok).trimmed();
+    if (!ok || name == slotLabel(index)) { return; }
+
+    if (!isValidProfileName(name)) {
+        QMessageBox::warning(this, tr("Rename Profile"),
+                             tr("Profile names must be 1-%1 plain characters, without commas or quotes.").arg(PROFILE_NAME_LEN));
+        return;
+    }
+
+    setBusy(true);
+    densInterface_->sendSetCalProfileName(index, name);
+}
+
+void CalProfilesDialog::onCopyClicked()
+{
+    int index = selectedIndex();
+    if (index < 0 || !isSlotUsed(index)) { return; }
+
+    QStringList items;
+    for (int i = 0; i < ui->profilesTableWidget->rowCount(); i++) {
+        const QString label = isSlotUsed(i) ? slotLabel(i) : tr("(empty)");
+        items.append(tr("%1: %2").arg(i + 1).arg(label));
+    }
+
+    bool ok;
+    const QString item = QInputDialog::getItem(this, tr("Copy Profile"),
+                                               tr("Copy \"%1\" to slot:").arg(slotLabel(index)),
+                                               items, 0, false, &ok);
+    int destIndex = items.indexOf(item);
+    if (!ok || destIndex < 0 || destIndex == index) { return; }
+
+    if (isSlotUsed(destIndex)) {
+        if (QMessageBox::question(this, tr("Copy Profile"),
+                                  tr("Replace \"%1\"?").arg(slotLabel(destIndex)))
+                != QMessageBox::Yes) {
+            return;
+        }
+    }
+
+    setBusy(true);
+    densInterface_->sendInvokeCalProfileCopy(index, destIndex);
+}
+
+void CalProfilesDialog::onClearClicked()
+{
+    int index = selectedIndex();
+    if (index < 0 || !isSlotUsed(index)) { return; }
+
+    if (QMessageBox::question(this, tr("Clear Profile"),
+                              tr("Clear \"%1\"?").arg(slotLabel(index)))
+            != QMessageBox::Yes) {
+        return;
+    }
+
+    setBusy(true);
+    densInterface_->sendInvokeCalProfileClear(index);
+}
+
+void CalProfilesDialog::onExportClicked()
+{
+    int index = selectedIndex();
+    if (index < 0 || !isSlotUsed(index)) { return; }
+
+    QFileDialog fileDialog(this, tr("Export Calibration Profile"), QString(), tr("Calibration Profile Files (*.pcp)"));
+    fileDialog.setDefaultSuffix(".pcp");
+    fileDialog.setAcceptMode(QFileDialog::AcceptSave);
+    if (!fileDialog.exec() || fileDialog.selectedFiles().isEmpty()) { return; }
+
+    exportFilename_ = fileDialog.selectedFiles().constFirst();
+    exportProfile_ = DensCalProfile();
+    exportProfile_.index = index;
+    exportProfile_.name = slotLabel(index);
+    exportParts_ = 0;
+
+    setBusy(true);
+    densInterface_->sendGetCalProfileValues(index);
+}
+
+void CalProfilesDialog::onImportClicked()
+{
+    int index = selectedIndex();
+    if (index < 0) { return; }
+
+    QFileDialog fileDialog(this, tr("Import Calibration Profile"), QString(),
+                           tr("Calibration Profile Files (*.pcp);;Settings Files (*.pds)"));
+    fileDialog.setAcceptMode(QFileDialog::AcceptOpen);
+    if (!fileDialog.exec() || fileDialog.selectedFiles().isEmpty()) { return; }
+    const QString filename = fileDialog.selectedFiles().constFirst();
+
+    DensCalProfile profile;
+    if (!loadProfileFile(filename, &profile)) {
+        QMessageBox::warning(this, tr("Import Calibration Profile"), tr("Unable to read calibration profile file"));
+        return;
+    }
+    if (!profile.gain.isValid() || !profile.slope.isValid()
+            || !profile.reflection.isValid() || !profile.transmission.isValid()) {
+        QMessageBox::warning(this, tr("Import Calibration Profile"), tr("Calibration profile file is incomplete"));
+        return;
+    }
+    if (!isValidProfileName(profile.name)) {
+        profile.name = QFileInfo(filename).completeBaseName().left(PROFILE_NAME_LEN);
+        if (!isValidProfileName(profile.name)) {
+            profile.name = tr("Imported");
+        }
+    }
+
+    if (isSlotUsed(index)) {
+        if (QMessageBox::question(this, tr("Import Calibration Profile"),
+                                  tr("Replace \"%1\" with \"%2\"?").arg(slotLabel(index), profile.name))
+                != QMessageBox::Yes) {
+            return;
+        }
+    }
+
+    // The slot is created from the current calibration first, since
+    // values can only be set in a slot that is in use, and then the
+    // name and values are replaced with those from the file.
+    profile.index = index;
+    importProfile_ = profile;
+    importPendingSets_ = 0;
+
+    setBusy(true);
+    densInterface_->sendInvokeCalProfileSave(index);
+}
+
+void CalProfilesDialog::onSelectionChanged()
+{
+    setBusy(busy_);
+}
+
+void CalProfilesDialog::onCalProfileCountResponse(int count, int active)
+{
+    if (count < 0) { return; }
+
+    activeIndex_ = active;
+
+    int selected = selectedIndex();
+    ui->profilesTableWidget->setRowCount(count);
+    for (int i = 0; i < count; i++) {
+        ui->profilesTableWidget->setItem(i, COL_SLOT, new QTableWidgetItem(QString::number(i + 1)));
+        ui->profilesTableWidget->setItem(i, COL_ACTIVE, new QTableWidgetItem(i == active ? QStringLiteral("*") : QString()));
+        ui->profilesTableWidget->setItem(i, COL_NAME, new QTableWidgetItem());
+        densInterface_->sendGetCalProfileName(i);
+    }
+    if (selected < 0 && count > 0) {
+        selected = (active >= 0) ? active : 0;
+    }
+    if (selected >= 0 && selected < count) {
+        ui->profilesTableWidget->selectRow(selected);
+    }
+
+    setBusy(false);
+}
+
+void CalProfilesDialog::onCalProfileNameResponse(int index, const QString &name)
+{
+    if (index < 0 || index >= ui->profilesTableWidget->rowCount()) { return; }
+
+    QTableWidgetItem *item = ui->profilesTableWidget->item(index, COL_NAME);
+    if (!item) { return; }
+
+    // Empty slots are shown in gray, and keep an empty name in the user data
+    item->setData(Qt::UserRole, name);
+    if (name.isEmpty()) {
+        item->setText(tr("(empty)"));
+        item->setForeground(palette().brush(QPalette::Disabled, QPalette::Text));
+    } else {
+        item->setText(name);
+        item->setForeground(palette().brush(QPalette::Active, QPalette::Text));
+    }
+
+    setBusy(busy_);
+}
+
+void CalProfilesDialog::onCalProfileGainResponse(int index, const DensCalGain &calGain)
+{
+    if (exportFilename_.isEmpty() || index != exportProfile_.index) { return; }
+    exportProfile_.gain = calGain;
+    exportPartReceived(ExportGain);
+}
+
+void CalProfilesDialog::onCalProfileSlopeResponse(int index, const DensCalSlope &calSlope)
+{
+    if (exportFilename_.isEmpty() || index != exportProfile_.index) { return; }
+    exportProfile_.slope = calSlope;
+    exportPartReceived(ExportSlope);
+}
+
+void CalProfilesDialog::onCalProfileReflectionResponse(int index, const DensCalTarget &calTarget)
+{
+    if (exportFilename_.isEmpty() || index != exportProfile_.index) { return; }
+    exportProfile_.reflection = calTarget;
+    exportPartReceived(ExportReflection);
+}
+
+void CalProfilesDialog::onCalProfileTransmissionResponse(int index, const DensCalTarget &calTarget)
+{
+    if (exportFilename_.isEmpty() || index != exportProfile_.index) { return; }
+    exportProfile_.transmission = calTarget;
+    exportPartReceived(ExportTransmission);
+}
+
+void CalProfilesDialog::onCalProfileSelectComplete(bool success)
+{
+    if (!busy_) { return; }
+
+    if (!success) {
+        QMessageBox::warning(this, tr("Error"), tr("The device could not select the profile"));
+    }
+    onRefreshClicked();
+}
+
+void CalProfilesDialog::onCalProfileSetComplete(bool success)
+{
+    if (!busy_) { return; }
+
+    if (importPendingSets_ > 0) {
+        importPendingSets_--;
+        if (!success) {
+            // Stop counting, so only one error is shown for the import
+            importPendingSets_ = 0;
+            QMessageBox::warning(this, tr("Error"), tr("The device did not accept the imported profile"));
+        }
+        if (importPendingSets_ > 0) { return; }
+    } else if (!success) {
+        QMessageBox::warning(this, tr("Error"), tr("The device did not accept the profile change"));
+    }
+    onRefreshClicked();
+}
+
+void CalProfilesDialog::onCalProfileInvokeComplete(bool success)
+{
+    if (!busy_) { return; }
+
+    if (importProfile_.index >= 0) {
+        DensCalProfile profile = importProfile_;
+        importProfile_ = DensCalProfile();
+        if (success) {
+            // One response for the name, and one for each group of values
+            importPendingSets_ = 5;
+            densInterface_->sendSetCalProfileName(profile.index, profile.name);
+            densInterface_->sendSetCalProfileValues(profile);
+            return;
+        }
+    }
+
+    if (!success) {
+        QMessageBox::warning(this, tr("Error"), tr("The device could not update the profile"));
+    }
+    onRefreshClicked();
+}
+
+int CalProfilesDialog::selectedIndex() const
+{
+    const QList<QTableWidgetItem *> items = ui->profilesTableWidget->selectedItems();
+    if (items.isEmpty()) {
+        return -1;
+    }
+    return items.constFirst()->row();
+}
+
+QString CalProfilesDialog::slotLabel(int index) const
+{
+    QTableWidgetItem *item = ui->profilesTableWidget->item(index, COL_NAME);
+    return item ? item->data(Qt::UserRole).toString() : QString();
+}
+
+bool CalProfilesDialog::isSlotUsed(int index) const
+{
+    return !slotLabel(index).isEmpty();
+}
+
+void CalProfilesDialog::setBusy(bool busy)
+{
+    busy_ = busy;
+
+    const int index = selectedIndex();
+    const bool hasSlot = !busy && index >= 0;
+    const bool used = hasSlot && isSlotUsed(index);
+
+    ui->refreshPushButton->setEnabled(!busy);
+    ui->selectPushButton->setEnabled(used && index != activeIndex_);
+    ui->savePushButton->setEnabled(hasSlot);
+    ui->renamePushButton->setEnabled(used);
+    ui->copyPushButton->setEnabled(used);
+    ui->clearPushButton->setEnabled(used);
+    ui->exportPushButton->setEnabled(used);
+    ui->importPushButton->setEnabled(hasSlot);
+}
+
+void CalProfilesDialog::exportPartReceived(int part)
+{
+    exportParts_ |= part;
+    if (exportParts_ != ExportAll) { return; }
+
+    if (!saveProfileFile(exportFilename_, exportProfile_)) {
+        QMessageBox::warning(this, tr("Export Calibration Profile"), tr("Unable to write calibration profile file"));
+    }
+    exportFilename_.clear();
+    exportParts_ = 0;
+    setBusy(false);
+}
+
+bool CalProfilesDialog::saveProfileFile(const QString &filename, const DensCalProfile &profile)
+{
+    // Uses the same calibration layout as the device settings export,
+    // so that either file can be imported as a profile
+    QJsonObject jsonHeader;
+    jsonHeader["version"] = QString::number(1);
+    jsonHeader["date"] = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm");
+
+    QJsonObject jsonProfile;
+    jsonProfile["name"] = profile.name;
+
+    QJsonObject jsonCalGain;
+    jsonCalGain["L0"] = QString::number(profile.gain.low0(), 'f', 6);
+    jsonCalGain["L1"] = QString::number(profile.gain.low1(), 'f', 6);
+    jsonCalGain["M0"] = QString::number(profile.gain.med0(), 'f', 6);
+    jsonCalGain["M1"] = QString::number(profile.gain.med1(), 'f', 6);
+    jsonCalGain["H0"] = QString::number(profile.gain.high0(), 'f', 6);
+    jsonCalGain["H1"] = QString::number(profile.gain.high1(), 'f', 6);
+    jsonCalGain["X0"] = QString::number(profile.gain.max0(), 'f', 6);
+    jsonCalGain["X1"] = QString::number(profile.gain.max1(), 'f', 6);
+
+    QJsonObject jsonCalSlope;
+    jsonCalSlope["B0"] = QString::number(profile.slope.b0(), 'f', 6);
+    jsonCalSlope["B1"] = QString::number(profile.slope.b1(), 'f', 6);
+    jsonCalSlope["B2"] = QString::number(profile.slope.b2(), 'f', 6);
+
+    QJsonObject jsonCalSensor;
+    jsonCalSensor["gain"] = jsonCalGain;
+    jsonCalSensor["slope"] = jsonCalSlope;
+
+    QJsonObject jsonCalTarget;
+    jsonCalTarget["reflection"] = targetToJson(profile.reflection);
+    jsonCalTarget["transmission"] = targetToJson(profile.transmission);
+
+    QJsonObject jsonCal;
+    jsonCal["sensor"] = jsonCalSensor;
+    jsonCal["target"] = jsonCalTarget;
+
+    QJsonObject jsonExport;
+    jsonExport["header"] = jsonHeader;
+    jsonExport["profile"] = jsonProfile;
+    jsonExport["calibration"] = jsonCal;
+
+    QFile exportFile(filename);
+    if (!exportFile.open(QIODevice::WriteOnly)) {
+        qWarning() << "Couldn't open profile export file.";
+        return false;
+    }
+
+    exportFile.write(QJsonDocument(jsonExport).toJson(QJsonDocument::Indented));
+    exportFile.close();
+    return true;
+}
+
+bool CalProfilesDialog::loadProfileFile(const QString &filename, DensCalProfile *profile)
+{
+    if (!profile) { return false; }
+
+    QFile importFile(filename);
+    if (!importFile.open(QIODevice::ReadOnly)) {
+        qWarning() << "Couldn't open profile import file.";
+        return false;
+    }
+
+    const QJsonDocument doc = QJsonDocument::fromJson(importFile.readAll());
+    importFile.close();
+    if (!doc.isObject()) { return false; }
+
+    // Device settings files are read through their own schema,
+    // since only profile files have a profile object
+    if (!doc.object().contains("profile")) {
+        QJsonObject root = doc.object();
+        const QList<SettingsSchema::Issue> issues = SettingsSchema::load(&root);
+        if (!issues.isEmpty()) {
+            qWarning() << "Invalid settings file:" << SettingsSchema::formatIssues(issues);
+            return false;
+        }
+        SettingsSchema::readCalGain(root, &profile->gain);
+        SettingsSchema::readCalSlope(root, &profile->slope);
+        SettingsSchema::readCalReflection(root, &profile->reflection);
+        SettingsSchema::readCalTransmission(root, &profile->transmission);
+        return true;
+    }
+
+    const QJsonObject root = doc.object();
+    const QJsonObject jsonHeader = root["header"].toObject();
+    if (jsonHeader.contains("version") && jsonHeader["version"].toString() != QLatin1String("1")) {
+        qWarning() << "Unexpected version:" << jsonHeader["version"].toString();
+        return false;
+    }
+
+    profile->name = root["profile"].toObject()["name"].toString();
+
+    const QJsonObject jsonCal = root["calibration"].toObject();
+    const QJsonObject jsonCalSensor = jsonCal["sensor"].toObject();
+    const QJsonObject jsonCalGain = jsonCalSensor["gain"].toObject();
+    const QJsonObject jsonCalSlope = jsonCalSensor["slope"].toObject();
+    const QJsonObject jsonCalTarget = jsonCal["target"].toObject();
+
+    profile->gain.setLow0(1.0F);
+    profile->gain.setLow1(1.0F);
+    profile->gain.setMed0(parseFloat(jsonCalGain, "M0"));
+    profile->gain.setMed1(parseFloat(jsonCalGain, "M1"));
+    profile->gain.setHigh0(parseFloat(jsonCalGain, "H0"));
+    profile->gain.setHigh1(parseFloat(jsonCalGain, "H1"));
+    profile->gain.setMax0(parseFloat(jsonCalGain, "X0"));
+    profile->gain.setMax1(parseFloat(jsonCalGain, "X1"));
+
+    profile->slope.setB0(parseFloat(jsonCalSlope, "B0"));
+    profile->slope.setB1(parseFloat(jsonCalSlope, "B1"));
+    profile->slope.setB2(parseFloat(jsonCalSlope, "B2"));
+
+    profile->reflection = targetFromJson(jsonCalTarget["reflection"].toObject());
+    profile->transmission = targetFromJson(jsonCalTarget["transmission"].toObject());
+
+    return true;
+}
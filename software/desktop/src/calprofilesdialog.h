@@ -0,0 +1,74 @@
+#ifndef CALPROFILESDIALOG_H
+#define CALPROFILESDIALOG_H
+
+#include <QDialog>
+#include "densinterface.h"
+
+namespace Ui {
+class CalProfilesDialog;
+}
+
+/**
+ * Manager for the calibration profiles stored on the device, which
+ * can select, rename, copy and clear profiles, and export and import
+ * them as files.
+ */
+class CalProfilesDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit CalProfilesDialog(DensInterface *densInterface, QWidget *parent = nullptr);
+    ~CalProfilesDialog();
+
+private slots:
+    void onRefreshClicked();
+    void onSelectClicked();
+    void onSaveClicked();
+    void onRenameClicked();
+    void onCopyClicked();
+    void onClearClicked();
+    void onExportClicked();
+    void onImportClicked();
+    void onSelectionChanged();
+
+    void onCalProfileCountResponse(int count, int active);
+    void onCalProfileNameResponse(int index, const QString &name);
+    void onCalProfileGainResponse(int index, const DensCalGain &calGain);
+    void onCalProfileSlopeResponse(int index, const DensCalSlope &calSlope);
+    void onCalProfileReflectionResponse(int index, const DensCalTarget &calTarget);
+    void onCalProfileTransmissionResponse(int index, const DensCalTarget &calTarget);
+    void onCalProfileSelectComplete(bool success);
+    void onCalProfileSetComplete(bool success);
+    void onCalProfileInvokeComplete(bool success);
+
+private:
+    enum ExportPart {
+        ExportGain = 0x01,
+        ExportSlope = 0x02,
+        ExportReflection = 0x04,
+        ExportTransmission = 0x08,
+        ExportAll = 0x0F
+    };
+
+    int selectedIndex() const;
+    QString slotLabel(int index) const;
+    bool isSlotUsed(int index) const;
+    void setBusy(bool busy);
+    void exportPartReceived(int part);
+
+    static bool saveProfileFile(const QString &filename, const DensCalProfile &profile);
+    static bool loadProfileFile(const QString &filename, DensCalProfile *profile);
+
+    Ui::CalProfilesDialog *ui;
+    DensInterface *densInterface_;
+    int activeIndex_;
+    bool busy_;
+    DensCalProfile exportProfile_;
+    QString exportFilename_;
+    int exportParts_;
+    DensCalProfile importProfile_;
+    int importPendingSets_;
+};
+
+#endif // CALPROFILESDIALOG_H
@@ -0,0 +1,414 @@
+#include "calreport.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QImage>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPageSize>
+#include <QPrinter>
+#include <QRegularExpression>
+#include <QTextDocument>
+#include <QTextStream>
+#include <QUrl>
+#include <QDebug>
+
+#include "densinterface.h"
+#include "settingsschema.h"
+#include "steptablet.h"
+
+namespace
+{
+static const float DEFAULT_TOLERANCE = 0.02F;
+static const char *DEFAULT_TEMPLATE = ":/report/calreport.html";
+static const char *DEFAULT_LOGO = ":/icons/appicon.png";
+static const char *LOGO_RESOURCE = "report-logo";
+
+QString formatValue(float value, int decimals)
+{
+    return qIsNaN(value) ? QStringLiteral("-") : QString::number(value, 'f', decimals);
+}
+
+QString tableRow(const QStringList &cells, bool header = false)
+{
+    const QString tag = header ? QStringLiteral("th") : QStringLiteral("td");
+    QString row = QStringLiteral("<tr>");
+    for (const QString &cell : cells) {
+        row += QStringLiteral("<%1>%2</%1>").arg(tag, cell.toHtmlEscaped());
+    }
+    row += QStringLiteral("</tr>");
+    return row;
+}
+
+QString table(const QStringList &rows)
+{
+    return QStringLiteral("<table class=\"values\" border=\"1\" cellspacing=\"0\" cellpadding=\"4\">")
+            + rows.join(QString()) + QStringLiteral("</table>");
+}
+}
+
+CalReport::CalReport()
+    : date_(QDateTime::currentDateTime())
+    , tolerance_(DEFAULT_TOLERANCE)
+{
+}
+
+CalReport CalReport::fromDevice(const DensInterface *densInterface)
+{
+    CalReport report;
+    if (!densInterface) { return report; }
+
+    report.deviceName_ = densInterface->projectName();
+    report.uniqueId_ = densInterface->uniqueId();
+    report.version_ = densInterface->version();
+    report.buildDescribe_ = densInterface->buildDescribe();
+    report.checksum_ = QString::number(densInterface->buildChecksum(), 16);
+    report.calGain_ = densInterface->calGain();
+    report.calSlope_ = densInterface->calSlope();
+    report.calReflection_ = densInterface->calReflection();
+    report.calTransmission_ = densInterface->calTransmission();
+    return report;
+}
+
+CalReport CalReport::fromSnapshot(const QString &fileName, QString *errorString)
+{
+    CalReport report;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) { *errorString = file.errorString(); }
+        return report;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!doc.isObject()) {
+        if (errorString) { *errorString = parseError.errorString(); }
+        return report;
+    }
+
+    QJsonObject root = doc.object();
+    const QList<SettingsSchema::Issue> issues = SettingsSchema::load(&root);
+    if (!issues.isEmpty()) {
+        if (errorString) { *errorString = SettingsSchema::formatIssues(issues); }
+        return report;
+    }
+
+    const QJsonObject jsonSystem = root["system"].toObject();
+    report.deviceName_ = jsonSystem["name"].toString();
+    report.uniqueId_ = jsonSystem["uid"].toString();
+    report.version_ = jsonSystem["version"].toString();
+    report.buildDescribe_ = jsonSystem["buildDescribe"].toString();
+    report.checksum_ = jsonSystem["checksum"].toString();
+
+    // Parts of the calibration left out of the file stay unset
+    SettingsSchema::readCalGain(root, &report.calGain_);
+    SettingsSchema::readCalSlope(root, &report.calSlope_);
+    SettingsSchema::readCalReflection(root, &report.calReflection_);
+    SettingsSchema::readCalTransmission(root, &report.calTransmission_);
+
+    if (!report.isValid() && errorString) {
+        *errorString = QStringLiteral("File does not contain a device ID");
+    }
+    return report;
+}
+
+bool CalReport::isValid() const { return !uniqueId_.isEmpty(); }
+QString CalReport::deviceName() const { return deviceName_; }
+QString CalReport::uniqueId() const { return uniqueId_; }
+QString CalReport::version() const { return version_; }
+
+QDateTime CalReport::date() const { return date_; }
+void CalReport::setDate(const QDateTime &date) { date_ = date; }
+
+QString CalReport::operatorName() const { return operatorName_; }
+void CalReport::setOperatorName(const QString &operatorName) { operatorName_ = operatorName; }
+
+QString CalReport::tabletName() const { return tabletName_; }
+void CalReport::setTabletName(const QString &tabletName) { tabletName_ = tabletName; }
+
+float CalReport::tolerance() const { return tolerance_; }
+void CalReport::setTolerance(float tolerance) { tolerance_ = tolerance; }
+
+QList<CalReportReading> CalReport::readings() const { return readings_; }
+void CalReport::setReadings(const QList<CalReportReading> &readings) { readings_ = readings; }
+
+bool CalReport::loadReadings(const QString &fileName, const StepTablet &tablet, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errorString) { *errorString = file.errorString(); }
+        return false;
+    }
+
+    const QList<float> densities = tablet.densities();
+    const QRegularExpression separator(QStringLiteral("[,;\\s]+"));
+    QList<CalReportReading> readings;
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) { continue; }
+
+        const QStringList fields = line.split(separator, Qt::SkipEmptyParts);
+        bool ok;
+        float first = fields.value(0).toFloat(&ok);
+        if (!ok) {
+            // Assume this is a header line
+            continue;
+        }
+
+        CalReportReading reading;
+        if (fields.size() > 1) {
+            reading.target = first;
+            reading.measured = fields.at(1).toFloat(&ok);
+            if (!ok) { continue; }
+        } else {
+            if (readings.size() >= densities.size()) {
+                if (errorString) {
+                    *errorString = densities.isEmpty()
+                            ? QStringLiteral("Readings without targets need a reference tablet")
+                            : QStringLiteral("More readings than tablet patches");
+                }
+                return false;
+            }
+            reading.target = densities.at(readings.size());
+            reading.measured = first;
+        }
+        readings.append(reading);
+    }
+
+    if (readings.isEmpty()) {
+        if (errorString) { *errorString = QStringLiteral("No readings"); }
+        return false;
+    }
+
+    readings_ = readings;
+    if (tabletName_.isEmpty() && tablet.isValid()) {
+        tabletName_ = tablet.displayName();
+    }
+    return true;
+}
+
+bool CalReport::applyOptions(const CalReportOptions &options, QString *errorString)
+{
+    if (!options.templateFile.isEmpty() && !setTemplateFile(options.templateFile, errorString)) {
+        return false;
+    }
+    if (!options.logoFile.isEmpty()) {
+        setLogoFile(options.logoFile);
+    }
+    if (!options.operatorName.isEmpty()) {
+        setOperatorName(options.operatorName);
+    }
+    if (!qIsNaN(options.tolerance) && options.tolerance > 0) {
+        setTolerance(options.tolerance);
+    }
+
+    StepTablet tablet;
+    if (!options.tabletSerial.isEmpty()) {
+        tablet = StepTabletLibrary::tablet(options.tabletSerial);
+        if (!tablet.isValid()) {
+            if (errorString) { *errorString = QStringLiteral("Unknown reference tablet: %1").arg(options.tabletSerial); }
+            return false;
+        }
+        setTabletName(tablet.displayName());
+    }
+
+    if (!options.readingsFile.isEmpty() && !loadReadings(options.readingsFile, tablet, errorString)) {
+        return false;
+    }
+    return true;
+}
+
+bool CalReport::passed() const
+{
+    for (const CalReportReading &reading : readings_) {
+        if (qIsNaN(reading.measured) || qAbs(reading.measured - reading.target) > tolerance_) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CalReport::setLogoFile(const QString &fileName)
+{
+    logoFile_ = fileName;
+}
+
+bool CalReport::setTemplateFile(const QString &fileName, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errorString) { *errorString = file.errorString(); }
+        return false;
+    }
+    template_ = QString::fromUtf8(file.readAll());
+    return true;
+}
+
+QString CalReport::toHtml() const
+{
+    // Embed the logo, so the HTML file does not depend on any other files
+    QByteArray logoData;
+    QBuffer buffer(&logoData);
+    buffer.open(QIODevice::WriteOnly);
+    logoImage().save(&buffer, "PNG");
+
+    return render(QStringLiteral("data:image/png;base64,") + QString::fromLatin1(logoData.toBase64()));
+}
+
+bool CalReport::write(const QString &fileName, QString *errorString) const
+{
+    if (fileName.endsWith(QLatin1String(".pdf"), Qt::CaseInsensitive)) {
+        return writePdf(fileName, errorString);
+    } else {
+        return writeHtml(fileName, errorString);
+    }
+}
+
+QString CalReport::outputFileName(const QString &pattern) const
+{
+    QString uid = uniqueId_;
+    uid.replace(QRegularExpression(QStringLiteral("[^A-Za-z0-9_-]")), QStringLiteral("_"));
+    QString fileName = pattern;
+    fileName.replace(QLatin1String("{uid}"), uid);
+    return fileName;
+}
+
+QString CalReport::render(const QString &logoSource) const
+{
+    QString html = template_;
+    if (html.isEmpty()) {
+        QFile file(DEFAULT_TEMPLATE);
+        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            html = QString::fromUtf8(file.readAll());
+        }
+    }
+
+    QString result;
+    if (readings_.isEmpty()) {
+        result = QStringLiteral("Not verified");
+    } else {
+        result = passed() ? QStringLiteral("Pass") : QStringLiteral("Fail");
+    }
+
+    const QList<QPair<QString, QString>> values = {
+        { QStringLiteral("DEVICE"), deviceName_.toHtmlEscaped() },
+        { QStringLiteral("UID"), uniqueId_.toHtmlEscaped() },
+        { QStringLiteral("VERSION"), version_.toHtmlEscaped() },
+        { QStringLiteral("BUILD"), buildDescribe_.toHtmlEscaped() },
+        { QStringLiteral("CHECKSUM"), checksum_.toHtmlEscaped() },
+        { QStringLiteral("DATE"), date_.toString("yyyy-MM-dd hh:mm").toHtmlEscaped() },
+        { QStringLiteral("OPERATOR"), operatorName_.toHtmlEscaped() },
+        { QStringLiteral("TABLET"), tabletName_.toHtmlEscaped() },
+        { QStringLiteral("TOLERANCE"), QString::number(tolerance_, 'f', 2) },
+        { QStringLiteral("RESULT"), result },
+        { QStringLiteral("LOGO"), logoSource.toHtmlEscaped() },
+        { QStringLiteral("GAIN_TABLE"), gainTable() },
+        { QStringLiteral("SLOPE_TABLE"), slopeTable() },
+        { QStringLiteral("REFLECTION_TABLE"), targetTable(calReflection_) },
+        { QStringLiteral("TRANSMISSION_TABLE"), targetTable(calTransmission_) },
+        { QStringLiteral("VERIFICATION_TABLE"), verificationTable() }
+    };
+    for (const QPair<QString, QString> &value : values) {
+        html.replace(QStringLiteral("{{%1}}").arg(value.first), value.second);
+    }
+    return html;
+}
+
+QString CalReport::gainTable() const
+{
+    QStringList rows;
+    rows.append(tableRow({ QStringLiteral("Gain"), QStringLiteral("Ch0"), QStringLiteral("Ch1") }, true));
+    rows.append(tableRow({ QStringLiteral("Low"), formatValue(calGain_.low0(), 6), formatValue(calGain_.low1(), 6) }));
+    rows.append(tableRow({ QStringLiteral("Medium"), formatValue(calGain_.med0(), 6), formatValue(calGain_.med1(), 6) }));
+    rows.append(tableRow({ QStringLiteral("High"), formatValue(calGain_.high0(), 6), formatValue(calGain_.high1(), 6) }));
+    rows.append(tableRow({ QStringLiteral("Maximum"), formatValue(calGain_.max0(), 6), formatValue(calGain_.max1(), 6) }));
+    return table(rows);
+}
+
+QString CalReport::slopeTable() const
+{
+    QStringList rows;
+    rows.append(tableRow({ QStringLiteral("B0"), QStringLiteral("B1"), QStringLiteral("B2") }, true));
+    rows.append(tableRow({ formatValue(calSlope_.b0(), 6), formatValue(calSlope_.b1(), 6), formatValue(calSlope_.b2(), 6) }));
+    return table(rows);
+}
+
+QString CalReport::targetTable(const DensCalTarget &calTarget) const
+{
+    QStringList rows;
+    rows.append(tableRow({ QString(), QStringLiteral("Density"), QStringLiteral("Reading") }, true));
+    rows.append(tableRow({ QStringLiteral("Low"), formatValue(calTarget.loDensity(), 2), formatValue(calTarget.loReading(), 6) }));
+    rows.append(tableRow({ QStringLiteral("High"), formatValue(calTarget.hiDensity(), 2), formatValue(calTarget.hiReading(), 6) }));
+    return table(rows);
+}
+
+QString CalReport::verificationTable() const
+{
+    if (readings_.isEmpty()) {
+        return QStringLiteral("<p>No verification readings.</p>");
+    }
+
+    QStringList rows;
+    rows.append(tableRow({ QStringLiteral("Patch"), QStringLiteral("Target"), QStringLiteral("Measured"),
+                           QStringLiteral("Deviation"), QStringLiteral("Result") }, true));
+    for (int i = 0; i < readings_.size(); i++) {
+        const CalReportReading &reading = readings_.at(i);
+        const float deviation = reading.measured - reading.target;
+        const bool ok = !qIsNaN(deviation) && qAbs(deviation) <= tolerance_;
+        rows.append(tableRow({ QString::number(i + 1),
+                               formatValue(reading.target, 2),
+                               formatValue(reading.measured, 2),
+                               qIsNaN(deviation) ? QStringLiteral("-") : QString("%1").arg(deviation, 0, 'f', 2),
+                               ok ? QStringLiteral("Pass") : QStringLiteral("Fail") }));
+    }
+    return table(rows);
+}
+
+QImage CalReport::logoImage() const
+{
+    QImage image;
+    if (logoFile_.isEmpty() || !image.load(logoFile_)) {
+        if (!logoFile_.isEmpty()) {
+            qWarning() << "Unable to load report logo:" << logoFile_;
+        }
+        image.load(DEFAULT_LOGO);
+    }
+    return image;
+}
+
+bool CalReport::writeHtml(const QString &fileName, QString *errorString) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (errorString) { *errorString = file.errorString(); }
+        return false;
+    }
+    file.write(toHtml().toUtf8());
+    file.close();
+    return true;
+}
+
+bool CalReport::writePdf(const QString &fileName, QString *errorString) const
+{
+    // QTextDocument does not support data URLs, so the logo is
+    // provided as a document resource instead
+    QTextDocument document;
+    document.addResource(QTextDocument::ImageResource, QUrl(LOGO_RESOURCE), logoImage());
+    document.setHtml(render(QLatin1String(LOGO_RESOURCE)));
+
+    QPrinter printer(QPrinter::HighResolution);
+    printer.setOutputFormat(QPrinter::PdfFormat);
+    printer.setOutputFileName(fileName);
+    printer.setPageSize(QPageSize(QPageSize::A4));
+    printer.setCreator(QStringLiteral("Printalyzer Densitometer Desktop"));
+    printer.setDocName(QStringLiteral("Calibration Certificate %1").arg(uniqueId_));
+    document.print(&printer);
+
+    if (printer.printerState() == QPrinter::Error) {
+        if (errorString) { *errorString = QStringLiteral("Unable to write PDF file"); }
+        return false;
+    }
+    return true;
+}
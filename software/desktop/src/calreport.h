@@ -0,0 +1,154 @@
+#ifndef CALREPORT_H
+#define CALREPORT_H
+
+#include <QDateTime>
+#include <QList>
+#include <QString>
+
+#include "denscalvalues.h"
+
+class QImage;
+class DensInterface;
+class StepTablet;
+
+/**
+ * Verification reading of a reference patch, taken after calibration.
+ */
+struct CalReportReading
+{
+    float target;
+    float measured;
+};
+
+/**
+ * Report settings that are given on the command line.
+ */
+struct CalReportOptions
+{
+    QString templateFile;
+    QString logoFile;
+    QString operatorName;
+    QString readingsFile;
+    QString tabletSerial;
+    float tolerance = qSNaN();
+};
+
+/**
+ * Calibration certificate for a single device, which is rendered from
+ * an HTML template into an HTML or PDF file.
+ *
+ * Templates are HTML files with {{NAME}} placeholders, which are replaced
+ * with HTML-escaped values. The supported placeholders are DEVICE, UID,
+ * VERSION, BUILD, CHECKSUM, DATE, OPERATOR, TABLET, TOLERANCE, RESULT and
+ * LOGO, along with GAIN_TABLE, SLOPE_TABLE, REFLECTION_TABLE,
+ * TRANSMISSION_TABLE and VERIFICATION_TABLE which expand to HTML tables.
+ * LOGO expands to an image source, for use in an img tag.
+ *
+ * PDF output does not need a display, so reports can be generated
+ * headlessly with the offscreen Qt platform.
+ */
+class CalReport
+{
+public:
+    CalReport();
+
+    /** Create a report from the values last read from a connected device */
+    static CalReport fromDevice(const DensInterface *densInterface);
+
+    /** Create a report from a saved device settings (.pds) file */
+    static CalReport fromSnapshot(const QString &fileName, QString *errorString = nullptr);
+
+    bool isValid() const;
+
+    QString deviceName() const;
+    QString uniqueId() const;
+    QString version() const;
+
+    QDateTime date() const;
+    void setDate(const QDateTime &date);
+
+    QString operatorName() const;
+    void setOperatorName(const QString &operatorName);
+
+    QString tabletName() const;
+    void setTabletName(const QString &tabletName);
+
+    /** Maximum deviation of a verification reading from its target */
+    float tolerance() const;
+    void setTolerance(float tolerance);
+
+    QList<CalReportReading> readings() const;
+    void setReadings(const QList<CalReportReading> &readings);
+
+    /**
+     * Load verification readings from a file.
+     *
+     * Each line either has a target density followed by the measured
+     * density, or just the measured density. In the latter case, the
+     * targets are taken from the tablet in patch order.
+     */
+    bool loadReadings(const QString &fileName, const StepTablet &tablet, QString *errorString = nullptr);
+
+    /**
+     * Apply the template, logo, operator, tolerance and verification
+     * readings from a set of options, looking up the reference tablet
+     * in the local library.
+     */
+    bool applyOptions(const CalReportOptions &options, QString *errorString = nullptr);
+
+    /** Whether every verification reading is within tolerance */
+    bool passed() const;
+
+    /** Set the logo image file, which defaults to the application icon */
+    void setLogoFile(const QString &fileName);
+
+    /**
+     * Set the template file, which defaults to the built-in template.
+     *
+     * @return False if the template could not be read
+     */
+    bool setTemplateFile(const QString &fileName, QString *errorString = nullptr);
+
+    QString toHtml() const;
+
+    /**
+     * Write the report, as PDF if the file name ends in .pdf and as
+     * HTML otherwise.
+     */
+    bool write(const QString &fileName, QString *errorString = nullptr) const;
+
+    /**
+     * Expand the {uid} placeholder in an output file name, so that
+     * reports for several devices can be written in one batch.
+     */
+    QString outputFileName(const QString &pattern) const;
+
+private:
+    QString render(const QString &logoSource) const;
+    QString gainTable() const;
+    QString slopeTable() const;
+    QString targetTable(const DensCalTarget &calTarget) const;
+    QString verificationTable() const;
+    QImage logoImage() const;
+    bool writeHtml(const QString &fileName, QString *errorString) const;
+    bool writePdf(const QString &fileName, QString *errorString) const;
+
+    QString deviceName_;
+    QString uniqueId_;
+    QString version_;
+    QString buildDescribe_;
+    QString checksum_;
+    DensCalGain calGain_;
+    DensCalSlope calSlope_;
+    DensCalTarget calReflection_;
+    DensCalTarget calTransmission_;
+    QDateTime date_;
+    QString operatorName_;
+    QString tabletName_;
+    float tolerance_;
+    QList<CalReportReading> readings_;
+    QString logoFile_;
+    QString template_;
+};
+
+#endif // CALREPORT_H
@@ -0,0 +1,443 @@
+#include "cgats.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+
+namespace
+{
+// Keywords and fields defined by the CGATS.17 standard, which do not
+// need to be declared with the KEYWORD keyword
+static const char *STANDARD_KEYWORDS[] = {
+    "ORIGINATOR", "DESCRIPTOR", "CREATED", "MANUFACTURER", "MANUFACTURE",
+    "PROD_DATE", "SERIAL", "MATERIAL", "INSTRUMENTATION", "MEASUREMENT_SOURCE",
+    "PRINT_CONDITIONS", "SAMPLE_BACKING", "CHISQ_DOF", "FILTER", "POLARIZATION",
+    "WEIGHTING_FUNCTION", "COMPUTATIONAL_PARAMETER", "TARGET_TYPE",
+    "SAMPLE_ID", "SAMPLE_NAME", "STRING", "D_RED", "D_GREEN", "D_BLUE", "D_VIS",
+    "D_MAJOR_FILTER"
+};
+
+static const char *STANDARD_FIELD_PREFIXES[] = {
+    "RGB_", "CMYK_", "XYZ_", "XYY_", "LAB_", "LCH_", "SPECTRAL_", "STDEV_", "MEAN_DE"
+};
+}
+
+CgatsTable::CgatsTable()
+{
+}
+
+CgatsTable::CgatsTable(const QString &identifier)
+    : identifier_(identifier)
+{
+}
+
+QString CgatsTable::identifier() const { return identifier_; }
+void CgatsTable::setIdentifier(const QString &identifier) { identifier_ = identifier; }
+
+QList<QPair<QString, QString>> CgatsTable::keywords() const { return keywords_; }
+
+QString CgatsTable::keyword(const QString &name) const
+{
+    for (const QPair<QString, QString> &keyword : keywords_) {
+        if (keyword.first.compare(name, Qt::CaseInsensitive) == 0) {
+            return keyword.second;
+        }
+    }
+    return QString();
+}
+
+bool CgatsTable::hasKeyword(const QString &name) const
+{
+    for (const QPair<QString, QString> &keyword : keywords_) {
+        if (keyword.first.compare(name, Qt::CaseInsensitive) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CgatsTable::setKeyword(const QString &name, const QString &value)
+{
+    for (QPair<QString, QString> &keyword : keywords_) {
+        if (keyword.first.compare(name, Qt::CaseInsensitive) == 0) {
+            keyword.second = value;
+            return;
+        }
+    }
+    keywords_.append(qMakePair(name, value));
+}
+
+QStringList CgatsTable::fields() const { return fields_; }
+void CgatsTable::setFields(const QStringList &fields) { fields_ = fields; }
+
+int CgatsTable::fieldIndex(const QString &name) const
+{
+    for (int i = 0; i < fields_.size(); i++) {
+        if (fields_.at(i).compare(name, Qt::CaseInsensitive) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int CgatsTable::densityField() const
+{
+    int densityField = -1;
+    for (int i = 0; i < fields_.size(); i++) {
+        const QString field = fields_.at(i).toUpper();
+        if (field == QLatin1String("D_VIS") || field == QLatin1String("DENSITY")) {
+            return i;
+        } else if (densityField < 0 && field.startsWith(QLatin1String("D_"))) {
+            densityField = i;
+        }
+    }
+    return densityField;
+}
+
+QList<QStringList> CgatsTable::rows() const { return rows_; }
+int CgatsTable::rowCount() const { return rows_.size(); }
+
+QString CgatsTable::value(int row, int field) const
+{
+    return rows_.value(row).value(field);
+}
+
+void CgatsTable::appendRow(const QStringList &values)
+{
+    rows_.append(values);
+}
+
+CgatsReader::CgatsReader(QIODevice *device)
+    : stream_(new QTextStream(device))
+    , lineNumber_(0)
+{
+}
+
+CgatsReader::~CgatsReader()
+{
+    delete stream_;
+}
+
+bool CgatsReader::readTable(CgatsTable *table)
+{
+    enum {
+        SectionHeader,
+        SectionFormat,
+        SectionData
+    } section = SectionHeader;
+
+    if (!table || hasError()) { return false; }
+    *table = CgatsTable();
+
+    bool haveIdentifier = false;
+    int numberOfFields = -1;
+    int numberOfSets = -1;
+    QStringList fields;
+    QStringList rowValues;
+    QStringList tokens;
+
+    while (nextLine(&tokens)) {
+        const QString first = tokens.first().toUpper();
+
+        if (!haveIdentifier) {
+            table->setIdentifier(tokens.join(QLatin1Char(' ')));
+            haveIdentifier = true;
+            continue;
+        }
+
+        if (section == SectionFormat) {
+            if (first == QLatin1String("END_DATA_FORMAT")) {
+                if (numberOfFields >= 0 && numberOfFields != fields.size()) {
+                    return setError(QStringLiteral("Data format has %1 fields, expected %2 on line %3")
+                                    .arg(fields.size()).arg(numberOfFields).arg(lineNumber_));
+                }
+                table->setFields(fields);
+                section = SectionHeader;
+            } else {
+                fields.append(tokens);
+            }
+        } else if (section == SectionData) {
+            if (first == QLatin1String("END_DATA")) {
+                if (!rowValues.isEmpty()) {
+                    return setError(QStringLiteral("Incomplete data row before line %1").arg(lineNumber_));
+                }
+                if (numberOfSets >= 0 && numberOfSets != table->rowCount()) {
+                    qWarning() << "Data set has" << table->rowCount() << "rows, expected" << numberOfSets;
+                }
+                return true;
+            }
+
+            // Rows may span multiple lines, so collect values until there is a full row
+            for (const QString &token : qAsConst(tokens)) {
+                rowValues.append(token);
+                if (rowValues.size() == fields.size()) {
+                    table->appendRow(rowValues);
+                    rowValues.clear();
+                }
+            }
+        } else if (first == QLatin1String("BEGIN_DATA_FORMAT")) {
+            fields.clear();
+            section = SectionFormat;
+        } else if (first == QLatin1String("BEGIN_DATA")) {
+            if (fields.isEmpty()) {
+                return setError(QStringLiteral("Data without a data format on line %1").arg(lineNumber_));
+            }
+            section = SectionData;
+        } else if (first == QLatin1String("END_DATA_FORMAT") || first == QLatin1String("END_DATA")) {
+            return setError(QStringLiteral("Unexpected %1 on line %2").arg(tokens.first()).arg(lineNumber_));
+        } else if (first == QLatin1String("KEYWORD")) {
+            // Declarations of non-standard keywords do not need to be kept
+            continue;
+        } else if (first == QLatin1String("NUMBER_OF_FIELDS")) {
+            numberOfFields = tokens.value(1).toInt();
+        } else if (first == QLatin1String("NUMBER_OF_SETS")) {
+            numberOfSets = tokens.value(1).toInt();
+        } else {
+            table->setKeyword(tokens.first(), tokens.mid(1).join(QLatin1Char(' ')));
+        }
+    }
+
+    if (hasError()) {
+        return false;
+    } else if (haveIdentifier) {
+        return setError(QStringLiteral("Data set \"%1\" ends without any data").arg(table->identifier()));
+    } else {
+        return false;
+    }
+}
+
+bool CgatsReader::atEnd() const
+{
+    return stream_->atEnd();
+}
+
+bool CgatsReader::hasError() const
+{
+    return !errorString_.isEmpty();
+}
+
+QString CgatsReader::errorString() const
+{
+    return errorString_;
+}
+
+bool CgatsReader::isCgatsLine(const QString &line)
+{
+    const QString trimmed = line.trimmed();
+    return trimmed.startsWith(QLatin1String("CGATS"), Qt::CaseInsensitive)
+            || trimmed.startsWith(QLatin1String("CTI"), Qt::CaseInsensitive)
+            || trimmed.startsWith(QLatin1String("IT8."), Qt::CaseInsensitive);
+}
+
+QList<CgatsTable> CgatsReader::readFile(const QString &fileName, QString *errorString)
+{
+    QList<CgatsTable> tables;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errorString) { *errorString = file.errorString(); }
+        return tables;
+    }
+
+    CgatsReader reader(&file);
+    CgatsTable table;
+    while (reader.readTable(&table)) {
+        tables.append(table);
+    }
+
+    if (reader.hasError()) {
+        if (errorString) { *errorString = reader.errorString(); }
+        tables.clear();
+    } else if (tables.isEmpty()) {
+        if (errorString) { *errorString = QStringLiteral("File does not contain any data sets"); }
+    }
+    return tables;
+}
+
+bool CgatsReader::nextLine(QStringList *tokens)
+{
+    while (!stream_->atEnd()) {
+        const QString line = stream_->readLine();
+        lineNumber_++;
+
+        bool ok;
+        *tokens = tokenize(line, &ok);
+        if (!ok) {
+            return setError(QStringLiteral("Unterminated quote on line %1").arg(lineNumber_));
+        }
+        if (!tokens->isEmpty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CgatsReader::setError(const QString &message)
+{
+    errorString_ = message;
+    return false;
+}
+
+QStringList CgatsReader::tokenize(const QString &line, bool *ok)
+{
+    QStringList tokens;
+    QString current;
+    bool inQuote = false;
+    bool haveToken = false;
+
+    for (int i = 0; i < line.size(); i++) {
+        const QChar ch = line.at(i);
+        if (inQuote) {
+            if (ch == QLatin1Char('"')) {
+                // A doubled quote is a literal quote within the value
+                if (i + 1 < line.size() && line.at(i + 1) == QLatin1Char('"')) {
+                    current.append(ch);
+                    i++;
+                } else {
+                    inQuote = false;
+                }
+            } else {
+                current.append(ch);
+            }
+        } else if (ch == QLatin1Char('"')) {
+            inQuote = true;
+            haveToken = true;
+        } else if (ch == QLatin1Char('#')) {
+            break;
+        } else if (ch.isSpace()) {
+            if (haveToken) {
+                tokens.append(current);
+                current.clear();
+                haveToken = false;
+            }
+        } else {
+            current.append(ch);
+            haveToken = true;
+        }
+    }
+
+    if (haveToken) {
+        tokens.append(current);
+    }
+    *ok = !inQuote;
+    return tokens;
+}
+
+CgatsWriter::CgatsWriter(QIODevice *device)
+    : stream_(new QTextStream(device))
+{
+}
+
+CgatsWriter::~CgatsWriter()
+{
+    stream_->flush();
+    delete stream_;
+}
+
+void CgatsWriter::writeTable(const CgatsTable &table)
+{
+    QTextStream &out = *stream_;
+    const QList<QPair<QString, QString>> keywords = table.keywords();
+    const QStringList fields = table.fields();
+
+    out << (table.identifier().isEmpty() ? QStringLiteral("CGATS.17") : table.identifier()) << "\n\n";
+
+    // Declare any keywords and fields that are not part of the standard
+    bool declared = false;
+    for (const QPair<QString, QString> &keyword : keywords) {
+        if (!isStandardKeyword(keyword.first)) {
+            out << "KEYWORD \"" << keyword.first << "\"\n";
+            declared = true;
+        }
+    }
+    for (const QString &field : fields) {
+        if (!isStandardKeyword(field)) {
+            out << "KEYWORD \"" << field << "\"\n";
+            declared = true;
+        }
+    }
+    if (declared) {
+        out << "\n";
+    }
+
+    for (const QPair<QString, QString> &keyword : keywords) {
+        out << keyword.first << " " << formatValue(keyword.second) << "\n";
+    }
+    if (!keywords.isEmpty()) {
+        out << "\n";
+    }
+
+    out << "NUMBER_OF_FIELDS " << fields.size() << "\n";
+    out << "BEGIN_DATA_FORMAT\n";
+    out << fields.join(QLatin1Char(' ')) << "\n";
+    out << "END_DATA_FORMAT\n\n";
+
+    const QList<QStringList> rows = table.rows();
+    out << "NUMBER_OF_SETS " << rows.size() << "\n";
+    out << "BEGIN_DATA\n";
+    for (const QStringList &row : rows) {
+        QStringList values;
+        for (int i = 0; i < fields.size(); i++) {
+            values.append(formatValue(row.value(i)));
+        }
+        out << values.join(QLatin1Char(' ')) << "\n";
+    }
+    out << "END_DATA\n";
+}
+
+bool CgatsWriter::writeFile(const QString &fileName, const QList<CgatsTable> &tables, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+        if (errorString) { *errorString = file.errorString(); }
+        return false;
+    }
+
+    {
+        CgatsWriter writer(&file);
+        for (int i = 0; i < tables.size(); i++) {
+            if (i > 0) {
+                *writer.stream_ << "\n";
+            }
+            writer.writeTable(tables.at(i));
+        }
+    }
+
+    if (file.error() != QFileDevice::NoError) {
+        if (errorString) { *errorString = file.errorString(); }
+        return false;
+    }
+    return true;
+}
+
+bool CgatsWriter::isStandardKeyword(const QString &name)
+{
+    const QString upperName = name.toUpper();
+    for (const char *keyword : STANDARD_KEYWORDS) {
+        if (upperName == QLatin1String(keyword)) {
+            return true;
+        }
+    }
+    for (const char *prefix : STANDARD_FIELD_PREFIXES) {
+        if (upperName.startsWith(QLatin1String(prefix))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString CgatsWriter::formatValue(const QString &value)
+{
+    // Numbers are written as-is, and everything else is quoted. The
+    // number parser allows surrounding whitespace that the reader would
+    // drop, so only values without any are left unquoted.
+    bool ok = false;
+    value.toDouble(&ok);
+    if (ok && value.trimmed() == value && !value.contains(QLatin1Char(' '))) {
+        return value;
+    }
+
+    QString result = value;
+    result.replace(QLatin1Char('"'), QLatin1String("\"\""));
+    return QLatin1Char('"') + result + QLatin1Char('"');
+}
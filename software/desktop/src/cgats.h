@@ -0,0 +1,119 @@
+#ifndef CGATS_H
+#define CGATS_H
+
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+
+class QIODevice;
+class QTextStream;
+
+/**
+ * Single data set from a CGATS-family file, such as a CGATS.17 or
+ * Argyll .ti3 file.
+ */
+class CgatsTable
+{
+public:
+    CgatsTable();
+    explicit CgatsTable(const QString &identifier);
+
+    /** File identifier on the first line of the data set, such as "CGATS.17" or "CTI3" */
+    QString identifier() const;
+    void setIdentifier(const QString &identifier);
+
+    /** Header keywords and their values, in file order */
+    QList<QPair<QString, QString>> keywords() const;
+    QString keyword(const QString &name) const;
+    bool hasKeyword(const QString &name) const;
+    void setKeyword(const QString &name, const QString &value);
+
+    QStringList fields() const;
+    void setFields(const QStringList &fields);
+    int fieldIndex(const QString &name) const;
+
+    /**
+     * Find the field most likely to hold visual density, preferring
+     * D_VIS or DENSITY over any other D_* field.
+     *
+     * @return Field index, or -1 if there is no density field
+     */
+    int densityField() const;
+
+    QList<QStringList> rows() const;
+    int rowCount() const;
+    QString value(int row, int field) const;
+    void appendRow(const QStringList &values);
+
+private:
+    QString identifier_;
+    QList<QPair<QString, QString>> keywords_;
+    QStringList fields_;
+    QList<QStringList> rows_;
+};
+
+/**
+ * Streaming reader for CGATS-family files, which returns one data set
+ * at a time without loading the whole file.
+ *
+ * Values may be quoted, with whitespace or '#' characters inside the
+ * quotes, and the values of a data row may span multiple lines.
+ * Comments start with '#' and run to the end of the line.
+ */
+class CgatsReader
+{
+public:
+    explicit CgatsReader(QIODevice *device);
+    ~CgatsReader();
+
+    /**
+     * Read the next data set from the file.
+     *
+     * @return True if a data set was read, false at the end of the file
+     *         or on error
+     */
+    bool readTable(CgatsTable *table);
+
+    bool atEnd() const;
+    bool hasError() const;
+    QString errorString() const;
+
+    /** Check whether a line looks like the start of a CGATS-family file */
+    static bool isCgatsLine(const QString &line);
+
+    /** Read all data sets from a file */
+    static QList<CgatsTable> readFile(const QString &fileName, QString *errorString = nullptr);
+
+private:
+    bool nextLine(QStringList *tokens);
+    bool setError(const QString &message);
+    static QStringList tokenize(const QString &line, bool *ok);
+
+    QTextStream *stream_;
+    int lineNumber_;
+    QString errorString_;
+};
+
+/**
+ * Writer for CGATS-family files.
+ */
+class CgatsWriter
+{
+public:
+    explicit CgatsWriter(QIODevice *device);
+    ~CgatsWriter();
+
+    void writeTable(const CgatsTable &table);
+
+    /** Write all data sets to a file */
+    static bool writeFile(const QString &fileName, const QList<CgatsTable> &tables, QString *errorString = nullptr);
+
+private:
+    static bool isStandardKeyword(const QString &name);
+    static QString formatValue(const QString &value);
+
+    QTextStream *stream_;
+};
+
+#endif // CGATS_H
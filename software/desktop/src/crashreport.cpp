@@ -0,0 +1,288 @@
+#include "crashreport.h"
+
+#include <QtEndian>
+#include <QFile>
+#include <QProcess>
+#include <QSettings>
+#include <QStringList>
+#include <QDebug>
+
+namespace
+{
+static const uint32_t RECORD_MAGIC = 0x48535243UL;
+static const uint16_t RECORD_VERSION = 1;
+static const int RECORD_SIZE = 372;
+
+static const int OFFSET_MAGIC = 0;
+static const int OFFSET_VERSION = 4;
+static const int OFFSET_SIZE = 6;
+static const int OFFSET_CHECKSUM = 8;
+static const int OFFSET_TYPE = 12;
+static const int OFFSET_UPTIME = 16;
+static const int OFFSET_APP_CRC32 = 20;
+static const int OFFSET_REGS = 24;
+static const int OFFSET_SP = 56;
+static const int OFFSET_ICSR = 60;
+static const int OFFSET_SHCSR = 64;
+static const int OFFSET_TASK_NAME = 68;
+static const int OFFSET_DETAIL = 84;
+static const int OFFSET_STACK = 116;
+static const int OFFSET_LOG_TAIL = 180;
+
+static const int TASK_NAME_LEN = 16;
+static const int DETAIL_LEN = 32;
+static const int STACK_WORDS = 16;
+static const int LOG_TAIL_LEN = 192;
+
+static const uint32_t APP_FLASH_START = 0x08008000UL;
+static const uint32_t APP_FLASH_END = 0x08030000UL;
+
+static const char *DEFAULT_ADDR2LINE = "arm-none-eabi-addr2line";
+
+uint32_t readU32(const QByteArray &data, int offset)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data.constData() + offset));
+}
+
+QString readString(const QByteArray &data, int offset, int len)
+{
+    QByteArray str = data.mid(offset, len);
+    int end = str.indexOf('\0');
+    if (end >= 0) {
+        str.truncate(end);
+    }
+    return QString::fromLatin1(str);
+}
+
+uint32_t crc32(const QByteArray &data)
+{
+    uint32_t crc = 0xFFFFFFFFUL;
+    for (const char ch : data) {
+        crc ^= static_cast<uint8_t>(ch);
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1UL)));
+        }
+    }
+    return ~crc;
+}
+
+QString hex32(uint32_t value)
+{
+    return QStringLiteral("0x%1").arg(value, 8, 16, QLatin1Char('0'));
+}
+}
+
+CrashReport::CrashReport()
+{
+}
+
+CrashReport CrashReport::fromRecord(const QByteArray &data)
+{
+    CrashReport report;
+
+    if (data.size() < RECORD_SIZE) {
+        qWarning() << "Crash record too short:" << data.size();
+        return report;
+    }
+
+    uint16_t version = qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(data.constData() + OFFSET_VERSION));
+    uint16_t size = qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(data.constData() + OFFSET_SIZE));
+
+    if (readU32(data, OFFSET_MAGIC) != RECORD_MAGIC
+            || version != RECORD_VERSION || size != RECORD_SIZE) {
+        qWarning() << "Unrecognized crash record:" << version << size;
+        return report;
+    }
+
+    if (readU32(data, OFFSET_CHECKSUM) != crc32(data.mid(OFFSET_TYPE, RECORD_SIZE - OFFSET_TYPE))) {
+        qWarning() << "Crash record checksum mismatch";
+        return report;
+    }
+
+    report.type_ = static_cast<CrashType>(readU32(data, OFFSET_TYPE));
+    report.uptime_ = readU32(data, OFFSET_UPTIME);
+
+    // Stored in the same byte order as the checksum reported by the device
+    report.appChecksum_ = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(data.constData() + OFFSET_APP_CRC32));
+
+    for (int i = 0; i < 8; i++) {
+        report.regs_[i] = readU32(data, OFFSET_REGS + (i * 4));
+    }
+    report.sp_ = readU32(data, OFFSET_SP);
+    report.icsr_ = readU32(data, OFFSET_ICSR);
+    report.shcsr_ = readU32(data, OFFSET_SHCSR);
+    report.taskName_ = readString(data, OFFSET_TASK_NAME, TASK_NAME_LEN);
+    report.detail_ = readString(data, OFFSET_DETAIL, DETAIL_LEN);
+    for (int i = 0; i < STACK_WORDS; i++) {
+        report.stack_.append(readU32(data, OFFSET_STACK + (i * 4)));
+    }
+    report.logTail_ = readString(data, OFFSET_LOG_TAIL, LOG_TAIL_LEN);
+    report.valid_ = true;
+
+    return report;
+}
+
+bool CrashReport::isValid() const { return valid_; }
+
+CrashReport::CrashType CrashReport::type() const { return type_; }
+
+QString CrashReport::typeName() const
+{
+    switch (type_) {
+    case CrashHardFault:
+        return QStringLiteral("Hard fault");
+    case CrashNmi:
+        return QStringLiteral("Non-maskable interrupt");
+    case CrashStackOverflow:
+        return QStringLiteral("Stack overflow");
+    case CrashMallocFailed:
+        return QStringLiteral("Memory allocation failed");
+    case CrashAssert:
+        return QStringLiteral("Assertion failed");
+    case CrashErrorHandler:
+        return QStringLiteral("Error handler");
+    case CrashWatchdog:
+        return QStringLiteral("Task watchdog");
+    default:
+        return QStringLiteral("Unknown (%1)").arg(static_cast<int>(type_));
+    }
+}
+
+uint32_t CrashReport::uptime() const { return uptime_; }
+uint32_t CrashReport::appChecksum() const { return appChecksum_; }
+uint32_t CrashReport::pc() const { return regs_[6]; }
+uint32_t CrashReport::lr() const { return regs_[5]; }
+uint32_t CrashReport::sp() const { return sp_; }
+QString CrashReport::taskName() const { return taskName_; }
+QString CrashReport::detail() const { return detail_; }
+QList<uint32_t> CrashReport::stack() const { return stack_; }
+QString CrashReport::logTail() const { return logTail_; }
+
+bool CrashReport::elfMatchesBuild(const QString &elfFile, const QString &buildDescribe)
+{
+    if (elfFile.isEmpty() || buildDescribe.isEmpty()) { return false; }
+
+    QFile file(elfFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Unable to open ELF file:" << elfFile;
+        return false;
+    }
+
+    // The app descriptor stores the build description as a null terminated string
+    QByteArray describe = buildDescribe.toLatin1();
+    describe.append('\0');
+
+    return file.readAll().contains(describe);
+}
+
+QString CrashReport::toText(const QString &buildDescribe, uint32_t buildChecksum, const QString &elfFile) const
+{
+    QStringList lines;
+
+    if (!valid_) {
+        return QStringLiteral("Invalid crash record\n");
+    }
+
+    lines.append(QStringLiteral("Crash type: %1").arg(typeName()));
+    if (!detail_.isEmpty()) {
+        lines.append(QStringLiteral("Detail: %1").arg(detail_));
+    }
+    lines.append(QStringLiteral("Uptime: %1 ms").arg(uptime_));
+    lines.append(QStringLiteral("Task: %1").arg(taskName_.isEmpty() ? QStringLiteral("<none>") : taskName_));
+
+    // Exception number of any interrupt that was active, from IPSR
+    uint32_t exception = regs_[7] & 0x3FUL;
+    if (exception != 0) {
+        lines.append(QStringLiteral("Active exception: %1").arg(exception));
+    }
+
+    lines.append(QString());
+    lines.append(QStringLiteral("Build describe: %1").arg(buildDescribe));
+    lines.append(QStringLiteral("Build checksum: %1").arg(buildChecksum, 8, 16, QLatin1Char('0')).toUpper());
+    lines.append(QStringLiteral("Crash checksum: %1").arg(appChecksum_, 8, 16, QLatin1Char('0')).toUpper());
+    if (buildChecksum != appChecksum_) {
+        lines.append(QStringLiteral("WARNING: The firmware has changed since the crash, symbols may be wrong"));
+    }
+
+    lines.append(QString());
+    static const char *REG_NAMES[] = { "R0", "R1", "R2", "R3", "R12", "LR", "PC", "xPSR" };
+    for (int i = 0; i < 8; i++) {
+        lines.append(QStringLiteral("%1 = %2").arg(QLatin1String(REG_NAMES[i]), 4).arg(hex32(regs_[i])));
+    }
+    lines.append(QStringLiteral("%1 = %2").arg(QLatin1String("SP"), 4).arg(hex32(sp_)));
+    lines.append(QStringLiteral("%1 = %2").arg(QLatin1String("ICSR"), 4).arg(hex32(icsr_)));
+    lines.append(QStringLiteral("%1 = %2").arg(QLatin1String("SHCSR"), 4).arg(hex32(shcsr_)));
+
+    // Collect every address that could be symbolized, starting with PC and LR
+    QList<uint32_t> addresses;
+    addresses.append(regs_[6]);
+    addresses.append(regs_[5]);
+    for (uint32_t word : stack_) {
+        if (isCodeAddress(word)) {
+            addresses.append(word);
+        }
+    }
+
+    QStringList symbols;
+    if (!elfFile.isEmpty()) {
+        symbols = symbolize(elfFile, addresses);
+    }
+
+    if (!symbols.isEmpty()) {
+        lines.append(QString());
+        lines.append(QStringLiteral("PC: %1").arg(symbols.value(0)));
+        lines.append(QStringLiteral("LR: %1").arg(symbols.value(1)));
+    }
+
+    lines.append(QString());
+    lines.append(QStringLiteral("Stack:"));
+    int symbolIndex = 2;
+    for (int i = 0; i < stack_.size(); i++) {
+        QString line = QStringLiteral("  [SP+%1] %2").arg(i * 4, 2, 10, QLatin1Char('0')).arg(hex32(stack_.at(i)));
+        if (isCodeAddress(stack_.at(i)) && symbolIndex < symbols.size()) {
+            line.append(QStringLiteral("  %1").arg(symbols.at(symbolIndex++)));
+        }
+        lines.append(line);
+    }
+
+    if (!logTail_.isEmpty()) {
+        lines.append(QString());
+        lines.append(QStringLiteral("Recent log output:"));
+        lines.append(logTail_.trimmed());
+    }
+
+    return lines.join(QLatin1Char('\n')) + QLatin1Char('\n');
+}
+
+bool CrashReport::isCodeAddress(uint32_t address)
+{
+    // Return addresses on the stack have the Thumb bit set
+    return (address & 1UL) && address >= APP_FLASH_START && address < APP_FLASH_END;
+}
+
+QStringList CrashReport::symbolize(const QString &elfFile, const QList<uint32_t> &addresses)
+{
+    QSettings settings;
+    const QString program = settings.value("crash_report/addr2line", DEFAULT_ADDR2LINE).toString();
+
+    QStringList args;
+    args << "-f" << "-p" << "-C" << "-e" << elfFile;
+    for (uint32_t address : addresses) {
+        args << hex32(address & ~1UL);
+    }
+
+    QProcess process;
+    process.start(program, args);
+    if (!process.waitForFinished(10000) || process.exitStatus() != QProcess::NormalExit
+            || process.exitCode() != 0) {
+        qWarning() << "Unable to run" << program << process.errorString();
+        return QStringList();
+    }
+
+    QStringList result = QString::fromLocal8Bit(process.readAllStandardOutput()).split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+    if (result.size() != addresses.size()) {
+        qWarning() << "Unexpected symbol count:" << result.size() << addresses.size();
+        return QStringList();
+    }
+    return result;
+}
@@ -0,0 +1,82 @@
+#ifndef CRASHREPORT_H
+#define CRASHREPORT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <stdint.h>
+
+/**
+ * Decoder for the crash record captured by the device firmware.
+ *
+ * The record is received as a raw copy of the firmware's crash_record_t
+ * structure, so the offsets used here must match that structure.
+ */
+class CrashReport
+{
+public:
+    enum CrashType {
+        CrashNone = 0,
+        CrashHardFault,
+        CrashNmi,
+        CrashStackOverflow,
+        CrashMallocFailed,
+        CrashAssert,
+        CrashErrorHandler,
+        CrashWatchdog
+    };
+
+    CrashReport();
+
+    static CrashReport fromRecord(const QByteArray &data);
+
+    bool isValid() const;
+
+    CrashType type() const;
+    QString typeName() const;
+    uint32_t uptime() const;
+    uint32_t appChecksum() const;
+    uint32_t pc() const;
+    uint32_t lr() const;
+    uint32_t sp() const;
+    QString taskName() const;
+    QString detail() const;
+    QList<uint32_t> stack() const;
+    QString logTail() const;
+
+    /**
+     * Check whether an ELF file matches the firmware build that is
+     * running on the device, based on the build description string
+     * embedded in its app descriptor.
+     */
+    static bool elfMatchesBuild(const QString &elfFile, const QString &buildDescribe);
+
+    /**
+     * Generate a readable report from the crash record.
+     *
+     * @param buildDescribe Build description of the firmware on the device
+     * @param buildChecksum Checksum of the firmware on the device
+     * @param elfFile ELF file to use for symbolizing addresses, may be empty
+     */
+    QString toText(const QString &buildDescribe, uint32_t buildChecksum,
+                   const QString &elfFile = QString()) const;
+
+private:
+    static bool isCodeAddress(uint32_t address);
+    static QStringList symbolize(const QString &elfFile, const QList<uint32_t> &addresses);
+
+    bool valid_ = false;
+    CrashType type_ = CrashNone;
+    uint32_t uptime_ = 0;
+    uint32_t appChecksum_ = 0;
+    uint32_t regs_[8] = {0};
+    uint32_t sp_ = 0;
+    uint32_t icsr_ = 0;
+    uint32_t shcsr_ = 0;
+    QString taskName_;
+    QString detail_;
+    QList<uint32_t> stack_;
+    QString logTail_;
+};
+
+#endif // CRASHREPORT_H
@@ -5,14 +5,48 @@
 #include "denscommand.h"
 #include "util.h"
 
+namespace
+{
+QString auditValue(std::initializer_list<float> values)
+{
+    // Values that were never read back from the device are left empty
+    QStringList elements;
+    for (float value : values) {
+        if (qIsNaN(value)) { return QString(); }
+        elements.append(QString::number(value, 'g', 7));
+    }
+    return elements.join(QLatin1Char(','));
+}
+
+QString auditValue(const DensCalGain &calGain)
+{
+    return auditValue({ calGain.med0(), calGain.med1(), calGain.high0(),
+                        calGain.high1(), calGain.max0(), calGain.max1() });
+}
+
+QString auditValue(const DensCalSlope &calSlope)
+{
+    return auditValue({ calSlope.b0(), calSlope.b1(), calSlope.b2() });
+}
+
+QString auditValue(const DensCalTarget &calTarget)
+{
+    return auditValue({ calTarget.loDensity(), calTarget.loReading(),
+                        calTarget.hiDensity(), calTarget.hiReading() });
+}
+}
+
 DensInterface::DensInterface(QObject *parent)
     : QObject(parent)
-    , serialPort_(nullptr)
+    , transport_(nullptr)
     , multilinePending_(false)
     , connecting_(false)
     , connected_(false)
     , deviceUnrecognized_(false)
     , remoteControlEnabled_(false)
+    , requestedFormat_(FormatBasic)
+    , protocolVersion_(0)
+    , settingsVersion_(0)
     , buildChecksum_(0)
     , freeRtosHeapSize_(0)
     , freeRtosHeapWatermark_(0)
@@ -20,10 +54,28 @@ DensInterface::DensInterface(QObject *parent)
 {
 }
 
-bool DensInterface::connectToDevice(QSerialPort *serialPort)
+QStringList DensInterface::readingQualityText(ReadingQuality quality)
 {
-    if (serialPort_) { return false; }
-    if (!serialPort || !serialPort->isOpen()) {
+    QStringList result;
+    if (quality.testFlag(QualityMotion)) {
+        result.append(tr("Target moved during the reading"));
+    }
+    if (quality.testFlag(QualitySaturated)) {
+        result.append(tr("Sensor saturated"));
+    }
+    if (quality.testFlag(QualityInvalidCycle)) {
+        result.append(tr("Sensor reading was not valid"));
+    }
+    if (quality.testFlag(QualityLidOpen)) {
+        result.append(tr("Lid opened during the reading"));
+    }
+    return result;
+}
+
+bool DensInterface::connectToDevice(DensTransport *transport)
+{
+    if (transport_) { return false; }
+    if (!transport || !transport->isOpen()) {
         return false;
     }
     if (connected_ || connecting_) {
@@ -35,23 +87,37 @@ bool DensInterface::connectToDevice(QSerialPort *serialPort)
     deviceUnrecognized_ = false;
     remoteControlEnabled_ = false;
 
+    // Forget calibration values read back from any previous device
+    calLight_ = DensCalLight();
+    calGain_ = DensCalGain();
+    calSlope_ = DensCalSlope();
+    calReflection_ = DensCalTarget();
+    calTransmission_ = DensCalTarget();
+    menuSettingValues_.clear();
+
     // Connect to signals for non-blocking command use
-    serialPort_ = serialPort;
-    connect(serialPort_, &QSerialPort::errorOccurred, this, &DensInterface::handleError);
-    connect(serialPort_, &QSerialPort::readyRead, this, &DensInterface::readData);
+    transport_ = transport;
+    connect(transport_, &DensTransport::errorOccurred, this, &DensInterface::handleError);
+    connect(transport_, &DensTransport::readyRead, this, &DensInterface::readData);
 
     // Send command to get system version, to verify connected device
     DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "V");
-    return sendCommand(command);
+    if (!sendCommand(command)) {
+        // Nothing was opened, so there is no connection to report as closed
+        connecting_ = false;
+        disconnectFromDevice();
+        return false;
+    }
+    return true;
 }
 
 void DensInterface::disconnectFromDevice()
 {
     bool notify = connected_ || connecting_;
-    if (serialPort_) {
-        disconnect(serialPort_, &QSerialPort::errorOccurred, this, &DensInterface::handleError);
-        disconnect(serialPort_, &QSerialPort::readyRead, this, &DensInterface::readData);
-        serialPort_ = nullptr;
+    if (transport_) {
+        disconnect(transport_, &DensTransport::errorOccurred, this, &DensInterface::handleError);
+        disconnect(transport_, &DensTransport::readyRead, this, &DensInterface::readData);
+        transport_ = nullptr;
     }
     multilineResponse_ = DensCommand();
     multilineBuffer_.clear();
@@ -64,52 +130,58 @@ void DensInterface::disconnectFromDevice()
     }
 }
 
-void DensInterface::sendGetSystemVersion()
+bool DensInterface::sendGetSystemVersion()
 {
     DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "V");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendGetSystemBuild()
+bool DensInterface::sendGetSystemBuild()
 {
     DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "B");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendGetSystemDeviceInfo()
+bool DensInterface::sendGetSystemDeviceInfo()
 {
     DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "DEV");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendGetSystemRtosInfo()
+bool DensInterface::sendGetSystemRtosInfo()
 {
     DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "RTOS");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendGetSystemUID()
+bool DensInterface::sendGetSystemUID()
 {
     DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "UID");
-    sendCommand(command);
+    return sendCommand(command);
+}
+
+bool DensInterface::sendGetSystemAudit()
+{
+    DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "AUDIT");
+    return sendCommand(command);
 }
 
-void DensInterface::sendGetSystemInternalSensors()
+bool DensInterface::sendGetSystemInternalSensors()
 {
     DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "ISEN");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendInvokeSystemRemoteControl(bool enabled)
+bool DensInterface::sendInvokeSystemRemoteControl(bool enabled)
 {
     QStringList args;
     args.append(enabled ? "1" : "0");
 
     DensCommand command(DensCommand::TypeInvoke, DensCommand::CategorySystem, "REMOTE", args);
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendSetSystemDisplayText(const QString &text)
+bool DensInterface::sendSetSystemDisplayText(const QString &text)
 {
     QString sendText = text;
     sendText.replace(QChar('\\'), QLatin1String("\\\\"));
@@ -119,26 +191,152 @@ void DensInterface::sendSetSystemDisplayText(const QString &text)
     args.append(sendText);
 
     DensCommand command(DensCommand::TypeSet, DensCommand::CategorySystem, "DISP", args);
-    sendCommand(command);
+    return sendCommand(command);
+}
+
+bool DensInterface::sendGetSystemLogLevels()
+{
+    DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "LOG");
+    return sendCommand(command);
 }
 
-void DensInterface::sendSetMeasurementFormat(DensInterface::DensityFormat format)
+bool DensInterface::sendSetSystemLogLevel(const QString &tag, QChar level)
+{
+    if (tag.isEmpty() || tag.contains(QChar(','))) {
+        qWarning() << "Invalid log tag:" << tag;
+        return false;
+    }
+
+    QStringList args;
+    args.append(tag);
+    args.append(QString(level));
+
+    DensCommand command(DensCommand::TypeSet, DensCommand::CategorySystem, "LOG", args);
+    return sendCommand(command);
+}
+
+bool DensInterface::sendSetSystemLogLevelSave()
+{
+    QStringList args;
+    args.append("SAVE");
+
+    DensCommand command(DensCommand::TypeSet, DensCommand::CategorySystem, "LOG", args);
+    return sendCommand(command);
+}
+
+bool DensInterface::sendSetSystemLogLevelReset()
+{
+    QStringList args;
+    args.append("RESET");
+
+    DensCommand command(DensCommand::TypeSet, DensCommand::CategorySystem, "LOG", args);
+    return sendCommand(command);
+}
+
+bool DensInterface::sendGetSystemHidTemplate()
+{
+    DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "HIDT");
+    return sendCommand(command);
+}
+
+bool DensInterface::sendSetSystemHidTemplate(const QString &text)
+{
+    if (text.isEmpty() || text.contains(QChar('\n')) || text.contains(QChar('\r'))) {
+        qWarning() << "Invalid HID template:" << text;
+        return false;
+    }
+
+    QStringList args;
+    args.append(text);
+
+    DensCommand command(DensCommand::TypeSet, DensCommand::CategorySystem, "HIDT", args);
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QStringLiteral("HIDT"), hidTemplate_, text);
+    return true;
+}
+
+bool DensInterface::sendGetSystemMenuSettingCount()
+{
+    DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "SETD");
+    return sendCommand(command);
+}
+
+bool DensInterface::sendGetSystemMenuSetting(int index)
+{
+    if (index < 0) { return false; }
+
+    QStringList args;
+    args.append(QString::number(index));
+
+    DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "SETD", args);
+    return sendCommand(command);
+}
+
+bool DensInterface::sendGetSystemMenuSettingChoices(int index)
+{
+    if (index < 0) { return false; }
+
+    QStringList args;
+    args.append(QString::number(index));
+
+    DensCommand command(DensCommand::TypeGet, DensCommand::CategorySystem, "SETC", args);
+    return sendCommand(command);
+}
+
+bool DensInterface::sendSetSystemMenuSetting(const QString &key, int value)
+{
+    if (key.isEmpty() || key.contains(QChar(','))) {
+        qWarning() << "Invalid menu setting key:" << key;
+        return false;
+    }
+
+    QStringList args;
+    args.append(key);
+    args.append(QString::number(value));
+
+    DensCommand command(DensCommand::TypeSet, DensCommand::CategorySystem, "SETV", args);
+    if (!sendCommand(command)) { return false; }
+
+    // The device does not write a setting that already has this value,
+    // and does not audit the display language
+    const bool changed = !menuSettingValues_.contains(key) || menuSettingValues_.value(key) != value;
+    if (changed && key != QLatin1String("LANGUAGE")) {
+        emit settingsWriteSent(QStringLiteral("SETV ") + key,
+                               menuSettingValues_.contains(key) ? QString::number(menuSettingValues_.value(key)) : QString(),
+                               QString::number(value));
+    }
+    menuSettingValues_.insert(key, value);
+    return true;
+}
+
+bool DensInterface::sendSetMeasurementFormat(DensInterface::DensityFormat format)
 {
     QStringList args;
     if (format == FormatBasic) {
         args.append("BASIC");
     } else if (format == FormatExtended) {
         args.append("EXT");
+    } else if (format == FormatExtendedUncertainty) {
+        args.append("EXT");
+        args.append("U");
+    } else if (format == FormatExtendedQuality) {
+        args.append("EXT");
+        args.append("U");
+        args.append("Q");
     } else {
         qWarning() << "Unsupported format:" << format;
-        return;
+        return false;
     }
 
     DensCommand command(DensCommand::TypeSet, DensCommand::CategoryMeasurement, "FORMAT", args);
-    sendCommand(command);
+    if (!sendCommand(command)) { return false; }
+
+    requestedFormat_ = format;
+    return true;
 }
 
-void DensInterface::sendSetAllowUncalibratedMeasurements(bool allow)
+bool DensInterface::sendSetAllowUncalibratedMeasurements(bool allow)
 {
     QStringList args;
     if (allow) {
@@ -148,16 +346,22 @@ void DensInterface::sendSetAllowUncalibratedMeasurements(bool allow)
     }
 
     DensCommand command(DensCommand::TypeSet, DensCommand::CategoryMeasurement, "UNCAL", args);
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendGetDiagDisplayScreenshot()
+bool DensInterface::sendGetDiagDisplayScreenshot()
 {
     DensCommand command(DensCommand::TypeGet, DensCommand::CategoryDiagnostics, "DISP");
-    sendCommand(command);
+    return sendCommand(command);
+}
+
+bool DensInterface::sendGetDiagCrashRecord()
+{
+    DensCommand command(DensCommand::TypeGet, DensCommand::CategoryDiagnostics, "CRASH");
+    return sendCommand(command);
 }
 
-void DensInterface::sendSetDiagLightRefl(int value)
+bool DensInterface::sendSetDiagLightRefl(int value)
 {
     if (value < 0) { value = 0; }
     else if (value > 128) { value = 128; }
@@ -166,10 +370,10 @@ void DensInterface::sendSetDiagLightRefl(int value)
     args.append(QString::number(value));
 
     DensCommand command(DensCommand::TypeSet, DensCommand::CategoryDiagnostics, "LR", args);
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendSetDiagLightTran(int value)
+bool DensInterface::sendSetDiagLightTran(int value)
 {
     if (value < 0) { value = 0; }
     else if (value > 128) { value = 128; }
@@ -178,24 +382,24 @@ void DensInterface::sendSetDiagLightTran(int value)
     args.append(QString::number(value));
 
     DensCommand command(DensCommand::TypeSet, DensCommand::CategoryDiagnostics, "LT", args);
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendInvokeDiagSensorStart()
+bool DensInterface::sendInvokeDiagSensorStart()
 {
     DensCommand command(DensCommand::TypeInvoke, DensCommand::CategoryDiagnostics, "S",
                         QStringList() << "START");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendInvokeDiagSensorStop()
+bool DensInterface::sendInvokeDiagSensorStop()
 {
     DensCommand command(DensCommand::TypeInvoke, DensCommand::CategoryDiagnostics, "S",
                         QStringList() << "STOP");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendSetDiagSensorConfig(int gain, int integration)
+bool DensInterface::sendSetDiagSensorConfig(int gain, int integration)
 {
     if (gain < 0) { gain = 0; }
     else if (gain > 3) { gain = 3; }
@@ -208,10 +412,10 @@ void DensInterface::sendSetDiagSensorConfig(int gain, int integration)
     args.append(QString::number(integration));
 
     DensCommand command(DensCommand::TypeSet, DensCommand::CategoryDiagnostics, "S", args);
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendInvokeDiagRead(DensInterface::SensorLight light, int gain, int integration)
+bool DensInterface::sendInvokeDiagRead(DensInterface::SensorLight light, int gain, int integration)
 {
     QStringList args;
     if (light == SensorLight::SensorLightReflection) {
@@ -225,52 +429,82 @@ void DensInterface::sendInvokeDiagRead(DensInterface::SensorLight light, int gai
     args.append(QString::number(integration));
 
     DensCommand command(DensCommand::TypeInvoke, DensCommand::CategoryDiagnostics, "READ", args);
-    sendCommand(command);
+    return sendCommand(command);
+}
+
+bool DensInterface::sendInvokeDiagSelfTest()
+{
+    DensCommand command(DensCommand::TypeInvoke, DensCommand::CategoryDiagnostics, "SELFTEST");
+    return sendCommand(command);
 }
 
-void DensInterface::sendSetDiagLoggingModeUsb()
+bool DensInterface::sendSetDiagLoggingModeUsb()
 {
     DensCommand command(DensCommand::TypeSet, DensCommand::CategoryDiagnostics,
                         "LOG", QStringList() << "U");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendSetDiagLoggingModeDebug()
+bool DensInterface::sendSetDiagLoggingModeDebug()
 {
     DensCommand command(DensCommand::TypeSet, DensCommand::CategoryDiagnostics,
                         "LOG", QStringList() << "D");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendInvokeCalGain()
+bool DensInterface::sendInvokeCalGain()
 {
     DensCommand command(DensCommand::TypeInvoke, DensCommand::CategoryCalibration, "GAIN");
-    sendCommand(command);
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QStringLiteral("GAIN"), auditValue(calGain_), QStringLiteral("MEASURE"));
+    return true;
 }
 
-void DensInterface::sendGetCalLight()
+bool DensInterface::sendInvokeCalGainResume()
+{
+    DensCommand command(DensCommand::TypeInvoke, DensCommand::CategoryCalibration, "GAIN",
+                        QStringList() << "RESUME");
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QStringLiteral("GAIN"), auditValue(calGain_), QStringLiteral("MEASURE RESUME"));
+    return true;
+}
+
+bool DensInterface::sendGetCalGainCheckpoint()
+{
+    DensCommand command(DensCommand::TypeGet, DensCommand::CategoryCalibration, "GAINCP");
+    return sendCommand(command);
+}
+
+bool DensInterface::sendGetCalLight()
 {
     DensCommand command(DensCommand::TypeGet, DensCommand::CategoryCalibration, "LIGHT");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendSetCalLight(const DensCalLight &calLight)
+bool DensInterface::sendSetCalLight(const DensCalLight &calLight)
 {
     QStringList args;
     args.append(QString::number(calLight.reflectionValue()));
     args.append(QString::number(calLight.transmissionValue()));
 
     DensCommand command(DensCommand::TypeSet, DensCommand::CategoryCalibration, "LIGHT", args);
-    sendCommand(command);
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QStringLiteral("LIGHT"),
+                           calLight_.isValid() ? QString("%1,%2").arg(calLight_.reflectionValue()).arg(calLight_.transmissionValue()) : QString(),
+                           args.join(QLatin1Char(',')));
+    return true;
 }
 
-void DensInterface::sendGetCalGain()
+bool DensInterface::sendGetCalGain()
 {
     DensCommand command(DensCommand::TypeGet, DensCommand::CategoryCalibration, "GAIN");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendSetCalGain(const DensCalGain &calGain)
+bool DensInterface::sendSetCalGain(const DensCalGain &calGain)
 {
     QStringList args;
     args.append(util::encode_f32(calGain.med0()));
@@ -281,16 +515,19 @@ void DensInterface::sendSetCalGain(const DensCalGain &calGain)
     args.append(util::encode_f32(calGain.max1()));
 
     DensCommand command(DensCommand::TypeSet, DensCommand::CategoryCalibration, "GAIN", args);
-    sendCommand(command);
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QStringLiteral("GAIN"), auditValue(calGain_), auditValue(calGain));
+    return true;
 }
 
-void DensInterface::sendGetCalSlope()
+bool DensInterface::sendGetCalSlope()
 {
     DensCommand command(DensCommand::TypeGet, DensCommand::CategoryCalibration, "SLOPE");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendSetCalSlope(const DensCalSlope &calSlope)
+bool DensInterface::sendSetCalSlope(const DensCalSlope &calSlope)
 {
     QStringList args;
     args.append(util::encode_f32(calSlope.b0()));
@@ -298,16 +535,19 @@ void DensInterface::sendSetCalSlope(const DensCalSlope &calSlope)
     args.append(util::encode_f32(calSlope.b2()));
 
     DensCommand command(DensCommand::TypeSet, DensCommand::CategoryCalibration, "SLOPE", args);
-    sendCommand(command);
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QStringLiteral("SLOPE"), auditValue(calSlope_), auditValue(calSlope));
+    return true;
 }
 
-void DensInterface::sendGetCalReflection()
+bool DensInterface::sendGetCalReflection()
 {
     DensCommand command(DensCommand::TypeGet, DensCommand::CategoryCalibration, "REFL");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendSetCalReflection(const DensCalTarget &calTarget)
+bool DensInterface::sendSetCalReflection(const DensCalTarget &calTarget)
 {
     QStringList args;
     args.append(util::encode_f32(calTarget.loDensity()));
@@ -316,16 +556,19 @@ void DensInterface::sendSetCalReflection(const DensCalTarget &calTarget)
     args.append(util::encode_f32(calTarget.hiReading()));
 
     DensCommand command(DensCommand::TypeSet, DensCommand::CategoryCalibration, "REFL", args);
-    sendCommand(command);
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QStringLiteral("REFL"), auditValue(calReflection_), auditValue(calTarget));
+    return true;
 }
 
-void DensInterface::sendGetCalTransmission()
+bool DensInterface::sendGetCalTransmission()
 {
     DensCommand command(DensCommand::TypeGet, DensCommand::CategoryCalibration, "TRAN");
-    sendCommand(command);
+    return sendCommand(command);
 }
 
-void DensInterface::sendSetCalTransmission(const DensCalTarget &calTarget)
+bool DensInterface::sendSetCalTransmission(const DensCalTarget &calTarget)
 {
     QStringList args;
     args.append(util::encode_f32(calTarget.loDensity()));
@@ -334,7 +577,173 @@ void DensInterface::sendSetCalTransmission(const DensCalTarget &calTarget)
     args.append(util::encode_f32(calTarget.hiReading()));
 
     DensCommand command(DensCommand::TypeSet, DensCommand::CategoryCalibration, "TRAN", args);
-    sendCommand(command);
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QStringLiteral("TRAN"), auditValue(calTransmission_), auditValue(calTarget));
+    return true;
+}
+
+bool DensInterface::sendGetCalProfileCount()
+{
+    DensCommand command(DensCommand::TypeGet, DensCommand::CategoryCalibration, "PROFC");
+    return sendCommand(command);
+}
+
+bool DensInterface::sendGetCalProfileName(int index)
+{
+    if (index < 0) { return false; }
+
+    QStringList args;
+    args.append(QString::number(index));
+
+    DensCommand command(DensCommand::TypeGet, DensCommand::CategoryCalibration, "PROF", args);
+    return sendCommand(command);
+}
+
+bool DensInterface::sendSetCalProfileActive(int index)
+{
+    if (index < 0) { return false; }
+
+    QStringList args;
+    args.append(QString::number(index));
+
+    DensCommand command(DensCommand::TypeSet, DensCommand::CategoryCalibration, "PROF", args);
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QStringLiteral("PROF"), QString(), QString::number(index));
+    return true;
+}
+
+bool DensInterface::sendSetCalProfileName(int index, const QString &name)
+{
+    if (index < 0 || name.isEmpty() || name.contains(QChar(',')) || name.contains(QChar('"'))) {
+        qWarning() << "Invalid calibration profile name:" << name;
+        return false;
+    }
+
+    QStringList args;
+    args.append(QString::number(index));
+    args.append(name);
+
+    DensCommand command(DensCommand::TypeSet, DensCommand::CategoryCalibration, "PROFN", args);
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QString("PROFN %1").arg(index), QString(), name);
+    return true;
+}
+
+bool DensInterface::sendInvokeCalProfileSave(int index)
+{
+    if (index < 0) { return false; }
+
+    QStringList args;
+    args.append("SAVE");
+    args.append(QString::number(index));
+
+    DensCommand command(DensCommand::TypeInvoke, DensCommand::CategoryCalibration, "PROF", args);
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QString("PROF %1").arg(index), QString(), QStringLiteral("SAVE"));
+    return true;
+}
+
+bool DensInterface::sendInvokeCalProfileCopy(int index, int destIndex)
+{
+    if (index < 0 || destIndex < 0) { return false; }
+
+    QStringList args;
+    args.append("COPY");
+    args.append(QString::number(index));
+    args.append(QString::number(destIndex));
+
+    DensCommand command(DensCommand::TypeInvoke, DensCommand::CategoryCalibration, "PROF", args);
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QString("PROF %1").arg(destIndex), QString(), QString("COPY %1").arg(index));
+    return true;
+}
+
+bool DensInterface::sendInvokeCalProfileClear(int index)
+{
+    if (index < 0) { return false; }
+
+    QStringList args;
+    args.append("CLEAR");
+    args.append(QString::number(index));
+
+    DensCommand command(DensCommand::TypeInvoke, DensCommand::CategoryCalibration, "PROF", args);
+    if (!sendCommand(command)) { return false; }
+
+    emit settingsWriteSent(QString("PROF %1").arg(index), QString(), QStringLiteral("CLEAR"));
+    return true;
+}
+
+bool DensInterface::sendGetCalProfileValues(int index)
+{
+    if (index < 0) { return false; }
+
+    QStringList args;
+    args.append(QString::number(index));
+
+    // Profile values are split across several commands, to keep within the
+    // device's command and response length limits. Nothing more is sent
+    // after a refusal, as the values are only useful as a complete set.
+    return sendCommand(DensCommand(DensCommand::TypeGet, DensCommand::CategoryCalibration, "PROFG", args))
+        && sendCommand(DensCommand(DensCommand::TypeGet, DensCommand::CategoryCalibration, "PROFS", args))
+        && sendCommand(DensCommand(DensCommand::TypeGet, DensCommand::CategoryCalibration, "PROFR", args))
+        && sendCommand(DensCommand(DensCommand::TypeGet, DensCommand::CategoryCalibration, "PROFT", args));
+}
+
+bool DensInterface::sendSetCalProfileValues(const DensCalProfile &profile)
+{
+    if (profile.index < 0) { return false; }
+
+    // Each part is only audited once it has actually been sent, and
+    // nothing more is sent after a refusal
+    QStringList gainArgs;
+    gainArgs.append(QString::number(profile.index));
+    gainArgs.append(util::encode_f32(profile.gain.med0()));
+    gainArgs.append(util::encode_f32(profile.gain.med1()));
+    gainArgs.append(util::encode_f32(profile.gain.high0()));
+    gainArgs.append(util::encode_f32(profile.gain.high1()));
+    gainArgs.append(util::encode_f32(profile.gain.max0()));
+    gainArgs.append(util::encode_f32(profile.gain.max1()));
+    if (!sendCommand(DensCommand(DensCommand::TypeSet, DensCommand::CategoryCalibration, "PROFG", gainArgs))) {
+        return false;
+    }
+    emit settingsWriteSent(QString("PROFG %1").arg(profile.index), QString(), auditValue(profile.gain));
+
+    QStringList slopeArgs;
+    slopeArgs.append(QString::number(profile.index));
+    slopeArgs.append(util::encode_f32(profile.slope.b0()));
+    slopeArgs.append(util::encode_f32(profile.slope.b1()));
+    slopeArgs.append(util::encode_f32(profile.slope.b2()));
+    if (!sendCommand(DensCommand(DensCommand::TypeSet, DensCommand::CategoryCalibration, "PROFS", slopeArgs))) {
+        return false;
+    }
+    emit settingsWriteSent(QString("PROFS %1").arg(profile.index), QString(), auditValue(profile.slope));
+
+    QStringList reflArgs;
+    reflArgs.append(QString::number(profile.index));
+    reflArgs.append(util::encode_f32(profile.reflection.loDensity()));
+    reflArgs.append(util::encode_f32(profile.reflection.loReading()));
+    reflArgs.append(util::encode_f32(profile.reflection.hiDensity()));
+    reflArgs.append(util::encode_f32(profile.reflection.hiReading()));
+    if (!sendCommand(DensCommand(DensCommand::TypeSet, DensCommand::CategoryCalibration, "PROFR", reflArgs))) {
+        return false;
+    }
+    emit settingsWriteSent(QString("PROFR %1").arg(profile.index), QString(), auditValue(profile.reflection));
+
+    QStringList tranArgs;
+    tranArgs.append(QString::number(profile.index));
+    tranArgs.append(util::encode_f32(profile.transmission.loReading()));
+    tranArgs.append(util::encode_f32(profile.transmission.hiDensity()));
+    tranArgs.append(util::encode_f32(profile.transmission.hiReading()));
+    if (!sendCommand(DensCommand(DensCommand::TypeSet, DensCommand::CategoryCalibration, "PROFT", tranArgs))) {
+        return false;
+    }
+    emit settingsWriteSent(QString("PROFT %1").arg(profile.index), QString(), auditValue(profile.transmission));
+    return true;
 }
 
 bool DensInterface::connected() const { return connected_; }
@@ -343,6 +752,8 @@ bool DensInterface::remoteControlEnabled() const { return remoteControlEnabled_;
 
 QString DensInterface::projectName() const { return projectName_; }
 QString DensInterface::version() const { return version_; }
+uint32_t DensInterface::protocolVersion() const { return protocolVersion_; }
+uint32_t DensInterface::settingsVersion() const { return settingsVersion_; }
 QDateTime DensInterface::buildDate() const { return buildDate_; }
 QString DensInterface::buildDescribe() const { return buildDescribe_; }
 uint32_t DensInterface::buildChecksum() const { return buildChecksum_; }
@@ -362,6 +773,9 @@ QString DensInterface::uniqueId() const { return uniqueId_; }
 QString DensInterface::mcuVdda() const { return mcuVdda_; }
 QString DensInterface::mcuTemp() const { return mcuTemp_; }
 
+QMap<QString, QChar> DensInterface::logLevels() const { return logLevels_; }
+QString DensInterface::hidTemplate() const { return hidTemplate_; }
+
 DensCalLight DensInterface::calLight() const { return calLight_; }
 DensCalGain DensInterface::calGain() const { return calGain_; }
 DensCalSlope DensInterface::calSlope() const { return calSlope_; }
@@ -371,8 +785,8 @@ DensCalTarget DensInterface::calTransmission() const { return calTransmission_;
 
 void DensInterface::readData()
 {
-    while (serialPort_->canReadLine()) {
-        const QByteArray line = serialPort_->readLine();
+    while (transport_ && transport_->canReadLine()) {
+        const QByteArray line = transport_->readLine();
         if (connecting_) {
             // In connecting mode we expect to only receive very specific
             // information from the device. Anything else will cause the
@@ -449,7 +863,25 @@ void DensInterface::readData()
             DensCommand response = DensCommand::parse(line);
 
             if (response.args().size() == 1 && response.args().at(0) == QLatin1String("NAK")) {
+                if (response.type() == DensCommand::TypeSet
+                        && response.category() == DensCommand::CategoryMeasurement
+                        && response.action() == QLatin1String("FORMAT")
+                        && (requestedFormat_ == FormatExtendedQuality
+                            || requestedFormat_ == FormatExtendedUncertainty)) {
+                    // Firmware from before the quality or uncertainty fields
+                    // were added does not know the format, so fall back one
+                    // step at a time to the plain extended format
+                    if (requestedFormat_ == FormatExtendedQuality) {
+                        qDebug() << "Quality format not supported, using uncertainty format";
+                        sendSetMeasurementFormat(FormatExtendedUncertainty);
+                    } else {
+                        qDebug() << "Uncertainty format not supported, using extended format";
+                        sendSetMeasurementFormat(FormatExtended);
+                    }
+                    continue;
+                }
                 qWarning() << "Invalid command:" << response.toString();
+                emit commandRejected(response.type(), response.category(), response.action(), true);
             } else if (response.args().size() == 1 && response.args().at(0) == QLatin1String("[[")) {
                 multilineResponse_ = response;
                 multilineBuffer_.clear();
@@ -467,9 +899,9 @@ void DensInterface::readData()
     }
 }
 
-void DensInterface::handleError(QSerialPort::SerialPortError error)
+void DensInterface::handleError(const QString &message)
 {
-    qDebug() << "Serial port error:" << error;
+    qDebug() << "Connection error:" << message;
     emit connectionError();
 }
 
@@ -489,6 +921,8 @@ void DensInterface::readDensityResponse(const DensCommand &response)
         float dZero = qSNaN();
         float rawValue = qSNaN();
         float corrValue = qSNaN();
+        float dUncertainty = qSNaN();
+        ReadingQuality quality;
 
         if (response.type() == DensCommand::TypeDensityReflection) {
             densityType = DensityReflection;
@@ -509,6 +943,18 @@ void DensInterface::readDensityResponse(const DensCommand &response)
             if (response.args().size() > 4) {
                 corrValue = util::decode_f32(response.args().at(4));
             }
+            if (response.args().size() > 5) {
+                dUncertainty = util::decode_f32(response.args().at(5));
+            }
+            if (response.args().size() > 6) {
+                bool ok;
+                const int flags = response.args().at(6).toInt(&ok, 16);
+                if (ok) {
+                    quality = ReadingQuality(flags);
+                } else {
+                    qWarning() << "Bad reading quality:" << response.args().at(6);
+                }
+            }
         } else {
             QString readingStr = response.args().at(0);
             readingStr.chop(1);
@@ -520,12 +966,16 @@ void DensInterface::readDensityResponse(const DensCommand &response)
             }
         }
 
-        emit densityReading(densityType, dValue, dZero, rawValue, corrValue);
+        emit densityReading(densityType, dValue, dZero, rawValue, corrValue, dUncertainty, quality);
     }
 }
 
 void DensInterface::readCommandResponse(const DensCommand &response)
 {
+    if (response.args().size() == 1 && response.args().at(0) == QLatin1String("ERR")) {
+        emit commandRejected(response.type(), response.category(), response.action(), false);
+    }
+
     switch (response.category()) {
     case DensCommand::CategorySystem:
         readSystemResponse(response);
@@ -555,6 +1005,8 @@ void DensInterface::readSystemResponse(const DensCommand &response)
             if (args.length() > 1) {
                 version_ = args.at(1);
             }
+            protocolVersion_ = (args.length() > 2) ? args.at(2).toUInt() : 0;
+            settingsVersion_ = (args.length() > 3) ? args.at(3).toUInt() : 0;
             if (!connecting_) {
                 emit systemVersionResponse();
             }
@@ -604,6 +1056,10 @@ void DensInterface::readSystemResponse(const DensCommand &response)
                 uniqueId_ = args.at(0);
             }
             emit systemUniqueId();
+        } else if (response.action() == QLatin1String("AUDIT")) {
+            if (args.length() > 1) {
+                emit systemAuditResponse(args.at(0).toUInt(), args.at(1).toUpper());
+            }
         } else if (response.action() == QLatin1String("ISEN")) {
             if (args.length() > 0) {
                 mcuVdda_ = args.at(0);
@@ -612,6 +1068,82 @@ void DensInterface::readSystemResponse(const DensCommand &response)
                 mcuTemp_ = args.at(1);
             }
             emit systemInternalSensors();
+        } else if (response.action() == QLatin1String("LOG")) {
+            logLevels_.clear();
+            if (args.length() > 0 && !args.at(0).isEmpty()) {
+                logLevels_.insert(QStringLiteral("*"), args.at(0).at(0));
+            }
+            for (int i = 1; i + 1 < args.length(); i += 2) {
+                if (!args.at(i + 1).isEmpty()) {
+                    logLevels_.insert(args.at(i), args.at(i + 1).at(0));
+                }
+            }
+            emit systemLogLevelsResponse();
+        } else if (response.action() == QLatin1String("HIDT")) {
+            if (args.length() > 1) {
+                // The template contained commas, so rejoin it and remove the quotes
+                QString text = args.join(QLatin1Char(','));
+                if (text.length() >= 2 && text.startsWith(QLatin1Char('"')) && text.endsWith(QLatin1Char('"'))) {
+                    text = text.mid(1, text.length() - 2);
+                }
+                hidTemplate_ = text;
+            } else {
+                hidTemplate_ = args.value(0);
+            }
+            emit systemHidTemplateResponse();
+        } else if (response.action() == QLatin1String("SETD")) {
+            if (args.length() == 1) {
+                emit systemMenuSettingCountResponse(args.at(0).toInt());
+            } else if (args.length() > 5) {
+                DensMenuSetting setting;
+                setting.index = args.at(0).toInt();
+                setting.key = args.at(1);
+                setting.isBool = (args.at(2) == QLatin1String("B"));
+                setting.isRange = (args.at(2) == QLatin1String("R"));
+                setting.group = args.at(3);
+                setting.name = args.at(4);
+                setting.value = args.at(5).toInt();
+                if (setting.isRange && args.length() > 9) {
+                    setting.minimum = args.at(6).toInt();
+                    setting.maximum = args.at(7).toInt();
+                    setting.step = qMax(1, args.at(8).toInt());
+                    setting.unit = args.at(9);
+                }
+                menuSettingValues_.insert(setting.key, setting.value);
+                emit systemMenuSettingResponse(setting);
+            }
+        } else if (response.action() == QLatin1String("SETC") && args.length() > 0) {
+            // Labels may contain commas, so rejoin any that were split apart
+            QStringList elements;
+            QString pending;
+            for (int i = 1; i < args.length(); i++) {
+                const QString &arg = args.at(i);
+                if (!pending.isEmpty()) {
+                    pending += QLatin1Char(',') + arg;
+                    if (arg.endsWith(QLatin1Char('"'))) {
+                        elements.append(pending.mid(1, pending.length() - 2));
+                        pending.clear();
+                    }
+                } else if (arg.startsWith(QLatin1Char('"'))) {
+                    pending = arg;
+                } else {
+                    elements.append(arg);
+                }
+            }
+
+            DensMenuSettingChoices choices;
+            for (int i = 0; i + 1 < elements.length(); i += 2) {
+                choices.append(qMakePair(elements.at(i).toInt(), elements.at(i + 1)));
+            }
+            emit systemMenuSettingChoicesResponse(args.at(0).toInt(), choices);
+        }
+    } else if (response.type() == DensCommand::TypeSet) {
+        if (response.action() == QLatin1String("LOG")) {
+            emit systemLogLevelSetComplete(isResponseSetOk(response, QLatin1String("LOG")));
+        } else if (response.action() == QLatin1String("HIDT")) {
+            emit systemHidTemplateSetComplete(isResponseSetOk(response, QLatin1String("HIDT")));
+        } else if (response.action() == QLatin1String("SETV")) {
+            emit systemMenuSettingSetComplete(isResponseSetOk(response, QLatin1String("SETV")));
         }
     } else if (response.type() == DensCommand::TypeInvoke) {
         const QStringList args = response.args();
@@ -639,7 +1171,9 @@ void DensInterface::readMeasurementResponse(const DensCommand &response)
 
 void DensInterface::readCalibrationResponse(const DensCommand &response)
 {
-    if (response.type() == DensCommand::TypeInvoke
+    if (response.action().startsWith(QLatin1String("PROF"))) {
+        readCalProfileResponse(response);
+    } else if (response.type() == DensCommand::TypeInvoke
             && response.action() == QLatin1String("GAIN")) {
         if (response.args().size() > 0 && response.args().at(0) == QLatin1String("OK")) {
             emit calGainCalFinished();
@@ -653,6 +1187,13 @@ void DensInterface::readCalibrationResponse(const DensCommand &response)
             if (!ok) { param = -1; }
             emit calGainCalStatus(status, param);
         }
+    } else if (response.type() == DensCommand::TypeGet
+               && response.action() == QLatin1String("GAINCP")
+               && response.args().length() >= 1) {
+        bool ok;
+        int stage = response.args().at(0).toInt(&ok);
+        if (!ok) { stage = 0; }
+        emit calGainCheckpointResponse(stage);
     } else if (response.type() == DensCommand::TypeGet
                && response.action() == QLatin1String("LIGHT")
                && response.args().length() == 2) {
@@ -707,6 +1248,74 @@ void DensInterface::readCalibrationResponse(const DensCommand &response)
     }
 }
 
+void DensInterface::readCalProfileResponse(const DensCommand &response)
+{
+    const QStringList args = response.args();
+    const bool isOk = args.length() == 1 && args.at(0) == QLatin1String("OK");
+
+    if (response.type() == DensCommand::TypeGet
+            && response.action() == QLatin1String("PROFC")
+            && args.length() == 2) {
+        bool ok;
+        int count = args.at(0).toInt(&ok);
+        if (!ok) { return; }
+        int active = args.at(1).isEmpty() ? -1 : args.at(1).toInt(&ok);
+        if (!ok) { active = -1; }
+        emit calProfileCountResponse(count, active);
+    } else if (response.type() == DensCommand::TypeGet
+               && response.action() == QLatin1String("PROF")
+               && args.length() == 2) {
+        bool ok;
+        int index = args.at(0).toInt(&ok);
+        if (!ok) { return; }
+        emit calProfileNameResponse(index, args.at(1));
+    } else if (response.type() == DensCommand::TypeSet && response.action() == QLatin1String("PROF")) {
+        emit calProfileSelectComplete(isOk);
+    } else if (response.type() == DensCommand::TypeInvoke && response.action() == QLatin1String("PROF")) {
+        emit calProfileInvokeComplete(isOk);
+    } else if (response.type() == DensCommand::TypeSet) {
+        emit calProfileSetComplete(isOk);
+    } else if (response.type() == DensCommand::TypeGet && args.length() > 1) {
+        bool ok;
+        int index = args.at(0).toInt(&ok);
+        if (!ok) { return; }
+
+        if (response.action() == QLatin1String("PROFG") && args.length() == 7) {
+            // Low gain is not calibrated, and is always reported as 1.0
+            DensCalGain calGain;
+            calGain.setLow0(1.0F);
+            calGain.setLow1(1.0F);
+            calGain.setMed0(util::decode_f32(args.at(1)));
+            calGain.setMed1(util::decode_f32(args.at(2)));
+            calGain.setHigh0(util::decode_f32(args.at(3)));
+            calGain.setHigh1(util::decode_f32(args.at(4)));
+            calGain.setMax0(util::decode_f32(args.at(5)));
+            calGain.setMax1(util::decode_f32(args.at(6)));
+            emit calProfileGainResponse(index, calGain);
+        } else if (response.action() == QLatin1String("PROFS") && args.length() == 4) {
+            DensCalSlope calSlope;
+            calSlope.setB0(util::decode_f32(args.at(1)));
+            calSlope.setB1(util::decode_f32(args.at(2)));
+            calSlope.setB2(util::decode_f32(args.at(3)));
+            emit calProfileSlopeResponse(index, calSlope);
+        } else if (response.action() == QLatin1String("PROFR") && args.length() == 5) {
+            DensCalTarget calTarget;
+            calTarget.setLoDensity(util::decode_f32(args.at(1)));
+            calTarget.setLoReading(util::decode_f32(args.at(2)));
+            calTarget.setHiDensity(util::decode_f32(args.at(3)));
+            calTarget.setHiReading(util::decode_f32(args.at(4)));
+            emit calProfileReflectionResponse(index, calTarget);
+        } else if (response.action() == QLatin1String("PROFT") && args.length() == 4) {
+            DensCalTarget calTarget;
+            calTarget.setLoDensity(0.0F);
+            calTarget.setLoReading(util::decode_f32(args.at(1)));
+            calTarget.setHiDensity(util::decode_f32(args.at(2)));
+            calTarget.setHiReading(util::decode_f32(args.at(3)));
+            emit calProfileTransmissionResponse(index, calTarget);
+        }
+    }
+}
+
 bool DensInterface::isResponseSetOk(const DensCommand &response, QLatin1String action)
 {
     if (response.type() == DensCommand::TypeSet
@@ -725,6 +1334,13 @@ void DensInterface::readDiagnosticsResponse(const DensCommand &response)
             && response.action() == QLatin1String("DISP")
             && !response.buffer().isEmpty()) {
         emit diagDisplayScreenshot(response.buffer());
+    } else if (response.type() == DensCommand::TypeGet
+               && response.action() == QLatin1String("CRASH")) {
+        if (!response.buffer().isEmpty()) {
+            emit diagCrashRecord(QByteArray::fromHex(response.buffer()));
+        } else {
+            emit diagCrashRecord(QByteArray());
+        }
     } else if (response.type() == DensCommand::TypeSet
                && response.action() == QLatin1String("LR")
                && response.args().size() == 1
@@ -757,6 +1373,33 @@ void DensInterface::readDiagnosticsResponse(const DensCommand &response)
         emit diagSensorInvokeReading(
                     response.args().at(0).toInt(),
                     response.args().at(1).toInt());
+    } else if (response.type() == DensCommand::TypeInvoke
+               && response.action() == QLatin1String("SELFTEST")) {
+        QList<DensSelfTestResult> results;
+        bool passed = false;
+        const QList<QByteArray> lines = response.buffer().split('\n');
+        for (const QByteArray &line : lines) {
+            const QList<QByteArray> fields = line.trimmed().split(',');
+            if (fields.size() != 3) { continue; }
+
+            if (fields.at(0) == "RESULT") {
+                passed = fields.at(1) == "PASS";
+                continue;
+            }
+
+            DensSelfTestResult result;
+            result.check = QString::fromLatin1(fields.at(0));
+            if (fields.at(1) == "PASS") {
+                result.status = DensSelfTestResult::StatusPass;
+            } else if (fields.at(1) == "FAIL") {
+                result.status = DensSelfTestResult::StatusFail;
+            } else {
+                result.status = DensSelfTestResult::StatusSkip;
+            }
+            result.value = fields.at(2).toInt();
+            results.append(result);
+        }
+        emit diagSelfTestResponse(results, passed && !results.isEmpty());
     } else if (response.type() == DensCommand::TypeGet
             && response.action() == QLatin1String("LOG")
             && response.args().size() == 1
@@ -769,11 +1412,25 @@ void DensInterface::readDiagnosticsResponse(const DensCommand &response)
 
 bool DensInterface::sendCommand(const DensCommand &command)
 {
-    if (!serialPort_ || !serialPort_->isOpen() || !command.isValid()) {
+    if (!command.isValid()) {
+        qWarning() << "Invalid command:" << command.toString();
         return false;
     }
 
-    QByteArray commandBytes = command.toString().toLatin1();
-    commandBytes.append("\r\n");
-    return serialPort_->write(commandBytes) != -1;
+    bool sent = false;
+    if (transport_ && transport_->isOpen()) {
+        QByteArray commandBytes = command.toString().toLatin1();
+        commandBytes.append("\r\n");
+        sent = transport_->write(commandBytes);
+        if (!sent) {
+            qWarning() << "Unable to send command:" << command.toString() << transport_->errorString();
+        }
+    } else {
+        qWarning() << "Unable to send command while disconnected:" << command.toString();
+    }
+
+    if (!sent) {
+        emit commandNotSent(command.type(), command.category(), command.action());
+    }
+    return sent;
 }
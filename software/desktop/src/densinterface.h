@@ -3,10 +3,62 @@
 
 #include <stdint.h>
 #include <QObject>
-#include <QSerialPort>
 #include <QDateTime>
+#include <QMap>
 #include "denscommand.h"
 #include "denscalvalues.h"
+#include "denstransport.h"
+
+/**
+ * Setting that can be changed from the device menu, as described
+ * by the device itself.
+ */
+struct DensMenuSetting
+{
+    int index = -1;
+    QString key;
+    bool isBool = false;
+    bool isRange = false;
+    QString group;
+    QString name;
+    int value = 0;
+    int minimum = 0;
+    int maximum = 0;
+    int step = 1;
+    QString unit;
+};
+
+/** Allowed values of a menu setting, as value and label pairs */
+typedef QList<QPair<int, QString>> DensMenuSettingChoices;
+
+/**
+ * Calibration profile stored in one of the device's profile slots.
+ */
+struct DensCalProfile
+{
+    int index = -1;
+    QString name;
+    DensCalGain gain;
+    DensCalSlope slope;
+    DensCalTarget reflection;
+    DensCalTarget transmission;
+};
+
+/**
+ * Result of one check from the device's built-in self-test.
+ */
+struct DensSelfTestResult
+{
+    enum Status {
+        StatusPass,
+        StatusFail,
+        StatusSkip
+    };
+
+    QString check;
+    Status status = StatusSkip;
+    int value = 0;
+};
 
 class DensInterface : public QObject
 {
@@ -21,10 +73,22 @@ public:
 
     enum DensityFormat {
         FormatBasic,
-        FormatExtended
+        FormatExtended,
+        FormatExtendedUncertainty,
+        FormatExtendedQuality
     };
     Q_ENUM(DensityFormat)
 
+    /** Checks a reading failed, as reported with the extended quality format */
+    enum ReadingQualityFlag {
+        QualityMotion = 0x01,
+        QualitySaturated = 0x02,
+        QualityInvalidCycle = 0x04,
+        QualityLidOpen = 0x08
+    };
+    Q_DECLARE_FLAGS(ReadingQuality, ReadingQualityFlag)
+    Q_FLAG(ReadingQuality)
+
     enum SensorLight {
         SensorLightOff,
         SensorLightReflection,
@@ -33,43 +97,76 @@ public:
     Q_ENUM(SensorLight)
 
     explicit DensInterface(QObject *parent = nullptr);
-    bool connectToDevice(QSerialPort *serialPort);
+
+    /** Describe each failed check of a reading, for display to the user */
+    static QStringList readingQualityText(ReadingQuality quality);
+
+    bool connectToDevice(DensTransport *transport);
     void disconnectFromDevice();
 
+    /*
+     * Each of these returns false if its command was not sent, either
+     * because the arguments were invalid or because commandNotSent()
+     * was emitted. Anything waiting on the response should stop there.
+     */
 public slots:
-    void sendGetSystemVersion();
-    void sendGetSystemBuild();
-    void sendGetSystemDeviceInfo();
-    void sendGetSystemRtosInfo();
-    void sendGetSystemUID();
-    void sendGetSystemInternalSensors();
-    void sendInvokeSystemRemoteControl(bool enabled);
-    void sendSetSystemDisplayText(const QString &text);
-
-    void sendSetMeasurementFormat(DensInterface::DensityFormat format);
-    void sendSetAllowUncalibratedMeasurements(bool allow);
-
-    void sendGetDiagDisplayScreenshot();
-    void sendSetDiagLightRefl(int value);
-    void sendSetDiagLightTran(int value);
-    void sendInvokeDiagSensorStart();
-    void sendInvokeDiagSensorStop();
-    void sendSetDiagSensorConfig(int gain, int integration);
-    void sendInvokeDiagRead(DensInterface::SensorLight light, int gain, int integration);
-    void sendSetDiagLoggingModeUsb();
-    void sendSetDiagLoggingModeDebug();
-
-    void sendInvokeCalGain();
-    void sendGetCalLight();
-    void sendSetCalLight(const DensCalLight &calLight);
-    void sendGetCalGain();
-    void sendSetCalGain(const DensCalGain &calGain);
-    void sendGetCalSlope();
-    void sendSetCalSlope(const DensCalSlope &calSlope);
-    void sendGetCalReflection();
-    void sendSetCalReflection(const DensCalTarget &calTarget);
-    void sendGetCalTransmission();
-    void sendSetCalTransmission(const DensCalTarget &calTarget);
+    bool sendGetSystemVersion();
+    bool sendGetSystemBuild();
+    bool sendGetSystemDeviceInfo();
+    bool sendGetSystemRtosInfo();
+    bool sendGetSystemUID();
+    bool sendGetSystemAudit();
+    bool sendGetSystemInternalSensors();
+    bool sendInvokeSystemRemoteControl(bool enabled);
+    bool sendSetSystemDisplayText(const QString &text);
+    bool sendGetSystemLogLevels();
+    bool sendSetSystemLogLevel(const QString &tag, QChar level);
+    bool sendSetSystemLogLevelSave();
+    bool sendSetSystemLogLevelReset();
+    bool sendGetSystemHidTemplate();
+    bool sendSetSystemHidTemplate(const QString &text);
+    bool sendGetSystemMenuSettingCount();
+    bool sendGetSystemMenuSetting(int index);
+    bool sendGetSystemMenuSettingChoices(int index);
+    bool sendSetSystemMenuSetting(const QString &key, int value);
+
+    bool sendSetMeasurementFormat(DensInterface::DensityFormat format);
+    bool sendSetAllowUncalibratedMeasurements(bool allow);
+
+    bool sendGetDiagDisplayScreenshot();
+    bool sendGetDiagCrashRecord();
+    bool sendSetDiagLightRefl(int value);
+    bool sendSetDiagLightTran(int value);
+    bool sendInvokeDiagSensorStart();
+    bool sendInvokeDiagSensorStop();
+    bool sendSetDiagSensorConfig(int gain, int integration);
+    bool sendInvokeDiagRead(DensInterface::SensorLight light, int gain, int integration);
+    bool sendInvokeDiagSelfTest();
+    bool sendSetDiagLoggingModeUsb();
+    bool sendSetDiagLoggingModeDebug();
+
+    bool sendInvokeCalGain();
+    bool sendInvokeCalGainResume();
+    bool sendGetCalGainCheckpoint();
+    bool sendGetCalLight();
+    bool sendSetCalLight(const DensCalLight &calLight);
+    bool sendGetCalGain();
+    bool sendSetCalGain(const DensCalGain &calGain);
+    bool sendGetCalSlope();
+    bool sendSetCalSlope(const DensCalSlope &calSlope);
+    bool sendGetCalReflection();
+    bool sendSetCalReflection(const DensCalTarget &calTarget);
+    bool sendGetCalTransmission();
+    bool sendSetCalTransmission(const DensCalTarget &calTarget);
+    bool sendGetCalProfileCount();
+    bool sendGetCalProfileName(int index);
+    bool sendSetCalProfileActive(int index);
+    bool sendSetCalProfileName(int index, const QString &name);
+    bool sendInvokeCalProfileSave(int index);
+    bool sendInvokeCalProfileCopy(int index, int destIndex);
+    bool sendInvokeCalProfileClear(int index);
+    bool sendGetCalProfileValues(int index);
+    bool sendSetCalProfileValues(const DensCalProfile &profile);
 
 public:
     bool connected() const;
@@ -78,6 +175,8 @@ public:
 
     QString projectName() const;
     QString version() const;
+    uint32_t protocolVersion() const;
+    uint32_t settingsVersion() const;
 
     QDateTime buildDate() const;
     QString buildDescribe() const;
@@ -98,6 +197,11 @@ public:
     QString mcuVdda() const;
     QString mcuTemp() const;
 
+    /** Log level filters by tag, with the global level under "*" */
+    QMap<QString, QChar> logLevels() const;
+
+    QString hidTemplate() const;
+
     DensCalLight calLight() const;
     DensCalGain calGain() const;
     DensCalSlope calSlope() const;
@@ -110,7 +214,24 @@ signals:
     void connectionClosed();
     void connectionError();
 
-    void densityReading(DensInterface::DensityType type, float dValue, float dZero, float rawValue, float corrValue);
+    /**
+     * Emitted when the device answers a command with ERR, because it
+     * failed, or with NAK, because it was not recognized or could not
+     * be processed in the current state.
+     */
+    void commandRejected(DensCommand::CommandType type, DensCommand::CommandCategory category,
+                         const QString &action, bool unrecognized);
+
+    /**
+     * Emitted when a command could not be sent at all, because there is
+     * no open connection or the transport refused it. No response will
+     * follow, and the send function that was called returns false.
+     */
+    void commandNotSent(DensCommand::CommandType type, DensCommand::CommandCategory category,
+                        const QString &action);
+
+    void densityReading(DensInterface::DensityType type, float dValue, float dZero, float rawValue, float corrValue,
+                        float dUncertainty, DensInterface::ReadingQuality quality);
     void measurementFormatChanged();
     void allowUncalibratedMeasurementsChanged();
 
@@ -119,16 +240,32 @@ signals:
     void systemDeviceResponse();
     void systemRtosResponse();
     void systemUniqueId();
+    void systemAuditResponse(quint32 count, const QString &hash);
     void systemInternalSensors();
     void systemRemoteControl(bool enabled);
+    void systemLogLevelsResponse();
+    void systemLogLevelSetComplete(bool success);
+    void systemHidTemplateResponse();
+    void systemHidTemplateSetComplete(bool success);
+    void systemMenuSettingCountResponse(int count);
+    void systemMenuSettingResponse(const DensMenuSetting &setting);
+    void systemMenuSettingChoicesResponse(int index, const DensMenuSettingChoices &choices);
+    void systemMenuSettingSetComplete(bool success);
 
     void diagDisplayScreenshot(const QByteArray &data);
+    void diagCrashRecord(const QByteArray &data);
     void diagLightReflChanged();
     void diagLightTranChanged();
     void diagSensorInvoked();
     void diagSensorChanged();
     void diagSensorGetReading(int ch0, int ch1);
     void diagSensorInvokeReading(int ch0, int ch1);
+
+    /**
+     * Emitted when the self-test completes, with the result of each check.
+     * If the device refused to run the self-test, the list is empty.
+     */
+    void diagSelfTestResponse(const QList<DensSelfTestResult> &results, bool passed);
     void diagLogLine(const QByteArray &data);
 
     void calLightResponse();
@@ -136,6 +273,7 @@ signals:
     void calGainCalStatus(int status, int param);
     void calGainCalFinished();
     void calGainCalError();
+    void calGainCheckpointResponse(int stage);
     void calGainResponse();
     void calGainSetComplete();
     void calSlopeResponse();
@@ -144,10 +282,27 @@ signals:
     void calReflectionSetComplete();
     void calTransmissionResponse();
     void calTransmissionSetComplete();
+    void calProfileCountResponse(int count, int active);
+    void calProfileNameResponse(int index, const QString &name);
+    void calProfileGainResponse(int index, const DensCalGain &calGain);
+    void calProfileSlopeResponse(int index, const DensCalSlope &calSlope);
+    void calProfileReflectionResponse(int index, const DensCalTarget &calTarget);
+    void calProfileTransmissionResponse(int index, const DensCalTarget &calTarget);
+    void calProfileSelectComplete(bool success);
+    void calProfileSetComplete(bool success);
+    void calProfileInvokeComplete(bool success);
+
+    /**
+     * Emitted whenever a command is sent that changes a value stored
+     * in the device's settings memory, so the change can be audited.
+     * The old value is the one last read back from the device, and is
+     * empty if it was never read.
+     */
+    void settingsWriteSent(const QString &field, const QString &oldValue, const QString &newValue);
 
 private slots:
     void readData();
-    void handleError(QSerialPort::SerialPortError error);
+    void handleError(const QString &message);
 
 private:
     static bool isLogLine(const QByteArray &line);
@@ -157,11 +312,12 @@ private:
     void readMeasurementResponse(const DensCommand &response);
     void readCalibrationResponse(const DensCommand &response);
     void readDiagnosticsResponse(const DensCommand &response);
+    void readCalProfileResponse(const DensCommand &response);
     static bool isResponseSetOk(const DensCommand &response, QLatin1String action);
 
     bool sendCommand(const DensCommand &command);
 
-    QSerialPort *serialPort_;
+    DensTransport *transport_;
     bool multilinePending_;
     DensCommand multilineResponse_;
     QByteArray multilineBuffer_;
@@ -169,9 +325,12 @@ private:
     bool connected_;
     bool deviceUnrecognized_;
     bool remoteControlEnabled_;
+    DensityFormat requestedFormat_;
 
     QString projectName_;
     QString version_;
+    uint32_t protocolVersion_;
+    uint32_t settingsVersion_;
     QDateTime buildDate_;
     QString buildDescribe_;
     uint32_t buildChecksum_;
@@ -186,11 +345,16 @@ private:
     QString uniqueId_;
     QString mcuVdda_;
     QString mcuTemp_;
+    QMap<QString, QChar> logLevels_;
+    QString hidTemplate_;
     DensCalLight calLight_;
     DensCalGain calGain_;
     DensCalSlope calSlope_;
     DensCalTarget calReflection_;
     DensCalTarget calTransmission_;
+    QMap<QString, int> menuSettingValues_;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(DensInterface::ReadingQuality)
+
 #endif // DENSINTERFACE_H
@@ -0,0 +1,379 @@
+#include "denstransport.h"
+
+#include <QSerialPort>
+#include <QTcpSocket>
+#include <QLocalSocket>
+#include <QDebug>
+
+namespace
+{
+static const int CONNECT_TIMEOUT_MS = 3000;
+}
+
+const qint64 DensTransport::DefaultWriteBufferLimit = 64 * 1024;
+
+DensTransport *DensTransport::fromUri(const QString &uri, QObject *parent, QString *errorString)
+{
+    const int schemeEnd = uri.indexOf(QLatin1Char(':'));
+    const QString scheme = uri.left(qMax(schemeEnd, 0)).toLower();
+    const QString path = uri.mid(schemeEnd + 1);
+
+    if (scheme == QLatin1String("tcp")) {
+        // Host names may be IPv6 addresses, so the port follows the last colon
+        const int portSep = path.lastIndexOf(QLatin1Char(':'));
+        QString hostName = path.left(qMax(portSep, 0));
+        if (hostName.startsWith(QLatin1Char('[')) && hostName.endsWith(QLatin1Char(']'))) {
+            hostName = hostName.mid(1, hostName.size() - 2);
+        }
+        bool ok = false;
+        const quint16 port = (portSep > 0) ? path.mid(portSep + 1).toUShort(&ok) : 0;
+        if (hostName.isEmpty() || !ok || port == 0) {
+            if (errorString) { *errorString = tr("Expected a TCP address like tcp:127.0.0.1:9000"); }
+            return nullptr;
+        }
+        return new DensTcpTransport(hostName, port, parent);
+    } else if (scheme == QLatin1String("local")) {
+        if (path.isEmpty()) {
+            if (errorString) { *errorString = tr("Expected a local socket name like local:densitometer"); }
+            return nullptr;
+        }
+        return new DensLocalTransport(path, parent);
+    } else if (scheme == QLatin1String("pipe")) {
+        if (errorString) { *errorString = tr("In-process pipes cannot be opened by URI"); }
+        return nullptr;
+    } else if (scheme == QLatin1String("serial")) {
+        if (path.isEmpty()) {
+            if (errorString) { *errorString = tr("Expected a serial port like serial:/dev/ttyACM0"); }
+            return nullptr;
+        }
+        return new DensSerialTransport(path, parent);
+    }
+
+    if (uri.isEmpty()) {
+        if (errorString) { *errorString = tr("No device address"); }
+        return nullptr;
+    }
+    return new DensSerialTransport(uri, parent);
+}
+
+DensTransport::DensTransport(QObject *parent)
+    : QObject(parent)
+    , writeBufferLimit_(DefaultWriteBufferLimit)
+{
+}
+
+bool DensTransport::write(const QByteArray &data)
+{
+    if (!isOpen()) {
+        setErrorString(tr("Transport is not open"));
+        return false;
+    }
+    if (bytesToWrite() + data.size() > writeBufferLimit_) {
+        setErrorString(tr("Write buffer is full"));
+        return false;
+    }
+    return writeData(data);
+}
+
+qint64 DensTransport::writeBufferLimit() const { return writeBufferLimit_; }
+void DensTransport::setWriteBufferLimit(qint64 limit) { writeBufferLimit_ = limit; }
+
+QString DensTransport::errorString() const { return errorString_; }
+void DensTransport::setErrorString(const QString &errorString) { errorString_ = errorString; }
+
+void DensTransport::setConnected(bool connected)
+{
+    connected_ = connected;
+}
+
+void DensTransport::fail(const QString &message)
+{
+    // Only the first report of a lost connection is passed on, since
+    // closing the underlying device can cause more of them
+    if (!connected_) { return; }
+    connected_ = false;
+
+    qDebug() << "Transport error:" << uri() << message;
+    setErrorString(message);
+    close();
+    emit errorOccurred(message);
+}
+
+DensIODeviceTransport::DensIODeviceTransport(QIODevice *device, QObject *parent)
+    : DensTransport(parent)
+    , device_(device)
+{
+    device_->setParent(this);
+    connect(device_, &QIODevice::readyRead, this, &DensTransport::readyRead);
+    connect(device_, &QIODevice::bytesWritten, this, &DensTransport::bytesWritten);
+}
+
+QIODevice *DensIODeviceTransport::device() const
+{
+    return device_;
+}
+
+bool DensIODeviceTransport::isOpen() const
+{
+    return device_->isOpen();
+}
+
+bool DensIODeviceTransport::canReadLine() const
+{
+    return device_->canReadLine();
+}
+
+QByteArray DensIODeviceTransport::readLine()
+{
+    return device_->readLine();
+}
+
+qint64 DensIODeviceTransport::bytesToWrite() const
+{
+    return device_->bytesToWrite();
+}
+
+bool DensIODeviceTransport::writeData(const QByteArray &data)
+{
+    if (device_->write(data) != data.size()) {
+        setErrorString(device_->errorString());
+        return false;
+    }
+    return true;
+}
+
+DensSerialTransport::DensSerialTransport(const QString &portName, QObject *parent)
+    : DensIODeviceTransport(new QSerialPort(portName), parent)
+{
+    serialPort_ = static_cast<QSerialPort *>(device());
+    connect(serialPort_, &QSerialPort::errorOccurred, this, [this](QSerialPort::SerialPortError error) {
+        if (error != QSerialPort::NoError) {
+            fail(serialPort_->errorString());
+        }
+    });
+}
+
+bool DensSerialTransport::open()
+{
+    if (serialPort_->isOpen()) { return true; }
+
+    serialPort_->setBaudRate(QSerialPort::Baud115200);
+    serialPort_->setDataBits(QSerialPort::Data8);
+    serialPort_->setParity(QSerialPort::NoParity);
+    serialPort_->setStopBits(QSerialPort::OneStop);
+    serialPort_->setFlowControl(QSerialPort::NoFlowControl);
+    if (!serialPort_->open(QIODevice::ReadWrite)) {
+        setErrorString(serialPort_->errorString());
+        return false;
+    }
+    serialPort_->setDataTerminalReady(true);
+    setConnected(true);
+    return true;
+}
+
+void DensSerialTransport::close()
+{
+    setConnected(false);
+    if (serialPort_->isOpen()) {
+        serialPort_->close();
+    }
+}
+
+QString DensSerialTransport::uri() const
+{
+    return QStringLiteral("serial:%1").arg(serialPort_->portName());
+}
+
+DensTcpTransport::DensTcpTransport(const QString &hostName, quint16 port, QObject *parent)
+    : DensIODeviceTransport(new QTcpSocket(), parent)
+    , hostName_(hostName)
+    , port_(port)
+{
+    socket_ = static_cast<QTcpSocket *>(device());
+    connect(socket_, &QAbstractSocket::errorOccurred, this, [this]() {
+        fail(socket_->errorString());
+    });
+    connect(socket_, &QAbstractSocket::disconnected, this, [this]() {
+        fail(tr("Connection closed by peer"));
+    });
+}
+
+bool DensTcpTransport::open()
+{
+    if (socket_->isOpen()) { return true; }
+
+    socket_->connectToHost(hostName_, port_);
+    if (!socket_->waitForConnected(CONNECT_TIMEOUT_MS)) {
+        setErrorString(socket_->errorString());
+        socket_->abort();
+        return false;
+    }
+
+    // Commands are short and each waits for its response,
+    // so they should not be held back to fill a segment
+    socket_->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    setConnected(true);
+    return true;
+}
+
+void DensTcpTransport::close()
+{
+    setConnected(false);
+    socket_->abort();
+}
+
+QString DensTcpTransport::uri() const
+{
+    if (hostName_.contains(QLatin1Char(':'))) {
+        return QStringLiteral("tcp:[%1]:%2").arg(hostName_).arg(port_);
+    }
+    return QStringLiteral("tcp:%1:%2").arg(hostName_).arg(port_);
+}
+
+DensLocalTransport::DensLocalTransport(const QString &serverName, QObject *parent)
+    : DensIODeviceTransport(new QLocalSocket(), parent)
+    , serverName_(serverName)
+{
+    socket_ = static_cast<QLocalSocket *>(device());
+    connect(socket_, &QLocalSocket::errorOccurred, this, [this]() {
+        fail(socket_->errorString());
+    });
+    connect(socket_, &QLocalSocket::disconnected, this, [this]() {
+        fail(tr("Connection closed by peer"));
+    });
+}
+
+bool DensLocalTransport::open()
+{
+    if (socket_->isOpen()) { return true; }
+
+    socket_->connectToServer(serverName_);
+    if (!socket_->waitForConnected(CONNECT_TIMEOUT_MS)) {
+        setErrorString(socket_->errorString());
+        socket_->abort();
+        return false;
+    }
+    setConnected(true);
+    return true;
+}
+
+void DensLocalTransport::close()
+{
+    setConnected(false);
+    socket_->abort();
+}
+
+QString DensLocalTransport::uri() const
+{
+    return QStringLiteral("local:%1").arg(serverName_);
+}
+
+QPair<DensPipeTransport *, DensPipeTransport *> DensPipeTransport::createPair(QObject *parent)
+{
+    DensPipeTransport *first = new DensPipeTransport(parent);
+    DensPipeTransport *second = new DensPipeTransport(parent);
+    first->peer_ = second;
+    second->peer_ = first;
+    return qMakePair(first, second);
+}
+
+DensPipeTransport::DensPipeTransport(QObject *parent)
+    : DensTransport(parent)
+{
+}
+
+bool DensPipeTransport::open()
+{
+    if (open_) { return true; }
+    if (!peer_) {
+        setErrorString(tr("Other end of the pipe no longer exists"));
+        return false;
+    }
+    open_ = true;
+    setConnected(true);
+    return true;
+}
+
+void DensPipeTransport::close()
+{
+    if (!open_) { return; }
+    setConnected(false);
+    open_ = false;
+
+    // Anything already written still reaches the other end, ahead of the close
+    QPointer<DensPipeTransport> peer = peer_;
+    if (peer && peer->open_) {
+        peer->readBuffer_.append(writeBuffer_);
+        QMetaObject::invokeMethod(peer.data(), [peer]() {
+            if (!peer) { return; }
+            if (!peer->readBuffer_.isEmpty()) {
+                emit peer->readyRead();
+            }
+            peer->fail(tr("Other end of the pipe was closed"));
+        }, Qt::QueuedConnection);
+    }
+    writeBuffer_.clear();
+    readBuffer_.clear();
+}
+
+bool DensPipeTransport::isOpen() const
+{
+    return open_;
+}
+
+QString DensPipeTransport::uri() const
+{
+    return QStringLiteral("pipe:");
+}
+
+bool DensPipeTransport::canReadLine() const
+{
+    return readBuffer_.contains('\n');
+}
+
+QByteArray DensPipeTransport::readLine()
+{
+    const int end = readBuffer_.indexOf('\n');
+    const QByteArray line = (end < 0) ? readBuffer_ : readBuffer_.left(end + 1);
+    readBuffer_.remove(0, line.size());
+
+    // Data only counts as written once it has been read, like a pipe
+    // with a bounded buffer, so a reader that stalls holds back the writer
+    if (peer_ && !line.isEmpty()) {
+        emit peer_->bytesWritten(line.size());
+    }
+    return line;
+}
+
+qint64 DensPipeTransport::bytesToWrite() const
+{
+    return writeBuffer_.size() + (peer_ ? peer_->readBuffer_.size() : 0);
+}
+
+bool DensPipeTransport::writeData(const QByteArray &data)
+{
+    writeBuffer_.append(data);
+    if (!deliverPending_) {
+        deliverPending_ = true;
+        QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+    }
+    return true;
+}
+
+void DensPipeTransport::deliver()
+{
+    deliverPending_ = false;
+    if (!open_ || writeBuffer_.isEmpty()) { return; }
+
+    // Like a serial line with nothing listening, data sent
+    // before the other end is open is lost
+    if (peer_ && peer_->open_) {
+        peer_->readBuffer_.append(writeBuffer_);
+        writeBuffer_.clear();
+        emit peer_->readyRead();
+    } else {
+        const qint64 size = writeBuffer_.size();
+        writeBuffer_.clear();
+        emit bytesWritten(size);
+    }
+}
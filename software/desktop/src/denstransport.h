@@ -0,0 +1,196 @@
+#ifndef DENSTRANSPORT_H
+#define DENSTRANSPORT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QPair>
+#include <QPointer>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+class QSerialPort;
+class QTcpSocket;
+class QLocalSocket;
+QT_END_NAMESPACE
+
+/**
+ * Byte stream that carries the device protocol.
+ *
+ * Every transport behaves the same way, regardless of what it is
+ * connected to:
+ * - open() is synchronous, and on failure leaves the reason in errorString()
+ * - close() is never reported through any signal
+ * - Losing the connection once it is open, whether through an I/O error
+ *   or the other end going away, emits errorOccurred() once and leaves
+ *   the transport closed
+ * - write() never blocks, and refuses data that would take the amount
+ *   waiting to be sent over writeBufferLimit(), so a stalled peer cannot
+ *   make the buffer grow without bound. That refusal is not an error,
+ *   and bytesWritten() is emitted as the buffer drains.
+ *
+ * Transports are created from a URI by fromUri(), such as
+ * "serial:/dev/ttyACM0", "tcp:127.0.0.1:9000" or "local:densitometer".
+ * Anything without one of those schemes is taken to be a serial port
+ * name, so plain names like "COM3" keep working.
+ */
+class DensTransport : public QObject
+{
+    Q_OBJECT
+public:
+    static const qint64 DefaultWriteBufferLimit;
+
+    static DensTransport *fromUri(const QString &uri, QObject *parent = nullptr, QString *errorString = nullptr);
+
+    virtual bool open() = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+
+    /** URI that describes this transport, in the form accepted by fromUri() */
+    virtual QString uri() const = 0;
+
+    virtual bool canReadLine() const = 0;
+    virtual QByteArray readLine() = 0;
+    virtual qint64 bytesToWrite() const = 0;
+
+    bool write(const QByteArray &data);
+
+    qint64 writeBufferLimit() const;
+    void setWriteBufferLimit(qint64 limit);
+
+    QString errorString() const;
+
+signals:
+    void readyRead();
+    void bytesWritten(qint64 bytes);
+    void errorOccurred(const QString &message);
+
+protected:
+    explicit DensTransport(QObject *parent = nullptr);
+
+    virtual bool writeData(const QByteArray &data) = 0;
+
+    void setErrorString(const QString &errorString);
+
+    /** Mark the connection as established, or as closed on purpose */
+    void setConnected(bool connected);
+
+    /** Report losing an open connection, closing the transport */
+    void fail(const QString &message);
+
+private:
+    qint64 writeBufferLimit_;
+    QString errorString_;
+    bool connected_ = false;
+};
+
+/**
+ * Transport over any Qt I/O device, which does all the work once the
+ * device has been opened by the subclass.
+ */
+class DensIODeviceTransport : public DensTransport
+{
+    Q_OBJECT
+public:
+    bool isOpen() const override;
+    bool canReadLine() const override;
+    QByteArray readLine() override;
+    qint64 bytesToWrite() const override;
+
+protected:
+    DensIODeviceTransport(QIODevice *device, QObject *parent);
+
+    QIODevice *device() const;
+
+    bool writeData(const QByteArray &data) override;
+
+private:
+    QIODevice *device_;
+};
+
+class DensSerialTransport : public DensIODeviceTransport
+{
+    Q_OBJECT
+public:
+    explicit DensSerialTransport(const QString &portName, QObject *parent = nullptr);
+
+    bool open() override;
+    void close() override;
+    QString uri() const override;
+
+private:
+    QSerialPort *serialPort_;
+};
+
+class DensTcpTransport : public DensIODeviceTransport
+{
+    Q_OBJECT
+public:
+    DensTcpTransport(const QString &hostName, quint16 port, QObject *parent = nullptr);
+
+    bool open() override;
+    void close() override;
+    QString uri() const override;
+
+private:
+    QTcpSocket *socket_;
+    QString hostName_;
+    quint16 port_;
+};
+
+class DensLocalTransport : public DensIODeviceTransport
+{
+    Q_OBJECT
+public:
+    explicit DensLocalTransport(const QString &serverName, QObject *parent = nullptr);
+
+    bool open() override;
+    void close() override;
+    QString uri() const override;
+
+private:
+    QLocalSocket *socket_;
+    QString serverName_;
+};
+
+/**
+ * In-process transport, where each end of a pair reads what the other
+ * end writes.
+ *
+ * Written data is delivered to the other end from the event loop rather
+ * than immediately, the same as with a real device. This is meant for
+ * simulators and for measuring protocol handling on its own, without
+ * any kernel or driver overhead.
+ */
+class DensPipeTransport : public DensTransport
+{
+    Q_OBJECT
+public:
+    static QPair<DensPipeTransport *, DensPipeTransport *> createPair(QObject *parent = nullptr);
+
+    bool open() override;
+    void close() override;
+    bool isOpen() const override;
+    QString uri() const override;
+
+    bool canReadLine() const override;
+    QByteArray readLine() override;
+    qint64 bytesToWrite() const override;
+
+protected:
+    bool writeData(const QByteArray &data) override;
+
+private slots:
+    void deliver();
+
+private:
+    explicit DensPipeTransport(QObject *parent);
+
+    QPointer<DensPipeTransport> peer_;
+    QByteArray readBuffer_;
+    QByteArray writeBuffer_;
+    bool open_ = false;
+    bool deliverPending_ = false;
+};
+
+#endif // DENSTRANSPORT_H
@@ -0,0 +1,410 @@
+#include "firmwareimage.h"
+
+#include <QtEndian>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QStringList>
+#include <QDebug>
+
+namespace
+{
+static const uint32_t APP_FLASH_START = 0x08008000UL;
+static const uint32_t APP_FLASH_SIZE = 0x00028000UL;
+static const uint32_t APP_DESCRIPTOR_ADDRESS = 0x0802FF00UL;
+static const uint32_t VECTOR_TABLE_SIZE = 0xC0UL;
+
+static const uint32_t APP_DESCRIPTOR_MAGIC_WORD = 0xABCD7654UL;
+static const int APP_DESCRIPTOR_SIZE = 256;
+static const int DESC_OFFSET_PROTOCOL_VERSION = 4;
+static const int DESC_OFFSET_SETTINGS_VERSION = 8;
+static const int DESC_OFFSET_PROJECT_NAME = 16;
+static const int DESC_OFFSET_VERSION = 48;
+static const int DESC_OFFSET_BUILD_DATE = 80;
+static const int DESC_OFFSET_BUILD_DESCRIBE = 100;
+static const int DESC_OFFSET_CRC32 = 252;
+
+static const uint32_t UF2_MAGIC_START0 = 0x0A324655UL;
+static const uint32_t UF2_MAGIC_START1 = 0x9E5D5157UL;
+static const uint32_t UF2_MAGIC_END = 0x0AB16F30UL;
+static const uint32_t UF2_FLAG_NOT_MAIN_FLASH = 0x00000001UL;
+static const int UF2_BLOCK_SIZE = 512;
+static const int UF2_DATA_OFFSET = 32;
+
+static const uint32_t ELF_PT_LOAD = 1;
+
+// Oldest settings schema a device can have, for firmware that predates versioning
+static const uint32_t SETTINGS_VERSION_LEGACY = 1;
+
+uint16_t readU16(const QByteArray &data, int offset)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(data.constData() + offset));
+}
+
+uint32_t readU32(const QByteArray &data, int offset)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data.constData() + offset));
+}
+
+QString readString(const QByteArray &data, int offset, int len)
+{
+    QByteArray str = data.mid(offset, len);
+    int end = str.indexOf('\0');
+    if (end >= 0) {
+        str.truncate(end);
+    }
+    return QString::fromLatin1(str);
+}
+
+QString hex32(uint32_t value)
+{
+    return QStringLiteral("%1").arg(value, 8, 16, QLatin1Char('0')).toUpper();
+}
+
+/**
+ * Flatten a set of address/data chunks into a contiguous image,
+ * filling any gaps with the erased flash value.
+ */
+bool flattenChunks(const QMap<uint32_t, QByteArray> &chunks, uint32_t *baseAddress, QByteArray *data, QString *errorString)
+{
+    if (chunks.isEmpty()) {
+        if (errorString) { *errorString = QStringLiteral("Image contains no loadable data"); }
+        return false;
+    }
+
+    uint32_t start = chunks.firstKey();
+    uint32_t end = start;
+    for (auto it = chunks.constBegin(); it != chunks.constEnd(); ++it) {
+        end = qMax(end, it.key() + static_cast<uint32_t>(it.value().size()));
+    }
+
+    if (end - start > APP_FLASH_SIZE * 2) {
+        if (errorString) { *errorString = QStringLiteral("Image address range is too large"); }
+        return false;
+    }
+
+    QByteArray result(static_cast<int>(end - start), static_cast<char>(0xFF));
+    for (auto it = chunks.constBegin(); it != chunks.constEnd(); ++it) {
+        result.replace(static_cast<int>(it.key() - start), it.value().size(), it.value());
+    }
+
+    *baseAddress = start;
+    *data = result;
+    return true;
+}
+}
+
+FirmwareImage::FirmwareImage()
+{
+}
+
+FirmwareImage FirmwareImage::load(const QString &fileName, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) { *errorString = file.errorString(); }
+        return FirmwareImage();
+    }
+
+    const QByteArray data = file.readAll();
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+
+    Format format;
+    if (data.startsWith("\x7F" "ELF")) {
+        format = FormatElf;
+    } else if (data.size() >= UF2_BLOCK_SIZE && readU32(data, 0) == UF2_MAGIC_START0) {
+        format = FormatUf2;
+    } else if (suffix == QLatin1String("bin")) {
+        format = FormatBinary;
+    } else {
+        if (errorString) { *errorString = QStringLiteral("Unrecognized image format"); }
+        return FirmwareImage();
+    }
+
+    return fromData(data, format, errorString);
+}
+
+FirmwareImage FirmwareImage::fromData(const QByteArray &data, Format format, QString *errorString)
+{
+    FirmwareImage image;
+    bool result;
+
+    switch (format) {
+    case FormatBinary:
+        // Raw binary images are always linked at the start of application flash
+        image.baseAddress_ = APP_FLASH_START;
+        image.data_ = data;
+        result = !data.isEmpty();
+        if (!result && errorString) { *errorString = QStringLiteral("Image is empty"); }
+        break;
+    case FormatElf:
+        result = parseElf(data, &image, errorString);
+        break;
+    case FormatUf2:
+        result = parseUf2(data, &image, errorString);
+        break;
+    default:
+        result = false;
+        break;
+    }
+
+    if (!result) {
+        return FirmwareImage();
+    }
+
+    image.format_ = format;
+    image.parseDescriptor();
+    return image;
+}
+
+bool FirmwareImage::parseElf(const QByteArray &data, FirmwareImage *image, QString *errorString)
+{
+    // Only 32-bit little-endian images are expected from the ARM toolchain
+    if (data.size() < 52 || data.at(4) != 1 || data.at(5) != 1) {
+        if (errorString) { *errorString = QStringLiteral("Unsupported ELF class or byte order"); }
+        return false;
+    }
+
+    const uint32_t phoff = readU32(data, 28);
+    const uint16_t phentsize = readU16(data, 42);
+    const uint16_t phnum = readU16(data, 44);
+
+    QMap<uint32_t, QByteArray> chunks;
+    for (uint16_t i = 0; i < phnum; i++) {
+        const qint64 ph = static_cast<qint64>(phoff) + (static_cast<qint64>(i) * phentsize);
+        if (ph + 32 > data.size()) {
+            if (errorString) { *errorString = QStringLiteral("Truncated ELF program header"); }
+            return false;
+        }
+
+        const uint32_t type = readU32(data, static_cast<int>(ph));
+        const uint32_t offset = readU32(data, static_cast<int>(ph + 4));
+        const uint32_t paddr = readU32(data, static_cast<int>(ph + 12));
+        const uint32_t filesz = readU32(data, static_cast<int>(ph + 16));
+
+        // Use the load address, so initialized data lands where it is stored in flash
+        if (type != ELF_PT_LOAD || filesz == 0) { continue; }
+        if (static_cast<qint64>(offset) + filesz > data.size()) {
+            if (errorString) { *errorString = QStringLiteral("Truncated ELF segment"); }
+            return false;
+        }
+        chunks.insert(paddr, data.mid(static_cast<int>(offset), static_cast<int>(filesz)));
+    }
+
+    return flattenChunks(chunks, &image->baseAddress_, &image->data_, errorString);
+}
+
+bool FirmwareImage::parseUf2(const QByteArray &data, FirmwareImage *image, QString *errorString)
+{
+    if (data.size() % UF2_BLOCK_SIZE != 0) {
+        if (errorString) { *errorString = QStringLiteral("UF2 file is not a whole number of blocks"); }
+        return false;
+    }
+
+    QMap<uint32_t, QByteArray> chunks;
+    for (int offset = 0; offset < data.size(); offset += UF2_BLOCK_SIZE) {
+        if (readU32(data, offset) != UF2_MAGIC_START0
+                || readU32(data, offset + 4) != UF2_MAGIC_START1
+                || readU32(data, offset + UF2_BLOCK_SIZE - 4) != UF2_MAGIC_END) {
+            if (errorString) { *errorString = QStringLiteral("Invalid UF2 block at offset %1").arg(offset); }
+            return false;
+        }
+
+        const uint32_t flags = readU32(data, offset + 8);
+        const uint32_t targetAddr = readU32(data, offset + 12);
+        const uint32_t payloadSize = readU32(data, offset + 16);
+
+        if (flags & UF2_FLAG_NOT_MAIN_FLASH) { continue; }
+        if (payloadSize > UF2_BLOCK_SIZE - UF2_DATA_OFFSET - 4) {
+            if (errorString) { *errorString = QStringLiteral("Invalid UF2 payload size at offset %1").arg(offset); }
+            return false;
+        }
+        chunks.insert(targetAddr, data.mid(offset + UF2_DATA_OFFSET, static_cast<int>(payloadSize)));
+    }
+
+    return flattenChunks(chunks, &image->baseAddress_, &image->data_, errorString);
+}
+
+void FirmwareImage::parseDescriptor()
+{
+    descriptorOffset_ = -1;
+
+    // Search backwards, since the descriptor is placed at the end of the image
+    for (int offset = (data_.size() - APP_DESCRIPTOR_SIZE) & ~3; offset >= 0; offset -= 4) {
+        if (readU32(data_, offset) == APP_DESCRIPTOR_MAGIC_WORD) {
+            descriptorOffset_ = offset;
+            break;
+        }
+    }
+    if (descriptorOffset_ < 0) {
+        return;
+    }
+
+    const QByteArray desc = data_.mid(descriptorOffset_, APP_DESCRIPTOR_SIZE);
+    protocolVersion_ = readU32(desc, DESC_OFFSET_PROTOCOL_VERSION);
+    settingsVersion_ = readU32(desc, DESC_OFFSET_SETTINGS_VERSION);
+    projectName_ = readString(desc, DESC_OFFSET_PROJECT_NAME, 32);
+    version_ = readString(desc, DESC_OFFSET_VERSION, 32);
+    buildDate_ = readString(desc, DESC_OFFSET_BUILD_DATE, 20);
+    buildDescribe_ = readString(desc, DESC_OFFSET_BUILD_DESCRIBE, 64);
+
+    // Both checksums are byte swapped to match how the device reports them
+    checksum_ = qbswap(readU32(desc, DESC_OFFSET_CRC32));
+    calculatedChecksum_ = qbswap(stmCrc32(0xFFFFFFFFUL, data_.left(descriptorOffset_ + DESC_OFFSET_CRC32)));
+}
+
+bool FirmwareImage::isValid() const { return format_ != FormatUnknown; }
+FirmwareImage::Format FirmwareImage::format() const { return format_; }
+uint32_t FirmwareImage::baseAddress() const { return baseAddress_; }
+QByteArray FirmwareImage::data() const { return data_; }
+bool FirmwareImage::hasDescriptor() const { return descriptorOffset_ >= 0; }
+
+uint32_t FirmwareImage::descriptorAddress() const
+{
+    return hasDescriptor() ? baseAddress_ + static_cast<uint32_t>(descriptorOffset_) : 0;
+}
+
+QString FirmwareImage::projectName() const { return projectName_; }
+QString FirmwareImage::version() const { return version_; }
+QString FirmwareImage::buildDate() const { return buildDate_; }
+QString FirmwareImage::buildDescribe() const { return buildDescribe_; }
+uint32_t FirmwareImage::protocolVersion() const { return protocolVersion_; }
+uint32_t FirmwareImage::settingsVersion() const { return settingsVersion_; }
+uint32_t FirmwareImage::checksum() const { return checksum_; }
+uint32_t FirmwareImage::calculatedChecksum() const { return calculatedChecksum_; }
+
+bool FirmwareImage::isChecksumValid() const
+{
+    return hasDescriptor() && checksum_ == calculatedChecksum_;
+}
+
+bool FirmwareImage::isCompatible(uint32_t deviceSettingsVersion, QString *reason) const
+{
+    if (!hasDescriptor()) {
+        if (reason) { *reason = QStringLiteral("Image has no app descriptor"); }
+        return false;
+    }
+    if (!isChecksumValid()) {
+        if (reason) { *reason = QStringLiteral("Image checksum is not valid"); }
+        return false;
+    }
+    if (baseAddress_ != APP_FLASH_START || descriptorAddress() != APP_DESCRIPTOR_ADDRESS) {
+        if (reason) { *reason = QStringLiteral("Image is not laid out for application flash"); }
+        return false;
+    }
+
+    // This mirrors the check performed by the bootloader
+    const uint32_t imageSettingsVersion = settingsVersion_ ? settingsVersion_ : SETTINGS_VERSION_LEGACY;
+    if (imageSettingsVersion < deviceSettingsVersion) {
+        if (reason) {
+            *reason = QStringLiteral("Image settings schema %1 is older than the device schema %2")
+                    .arg(imageSettingsVersion).arg(deviceSettingsVersion);
+        }
+        return false;
+    }
+
+    return true;
+}
+
+QString FirmwareImage::toText() const
+{
+    QStringList lines;
+
+    switch (format_) {
+    case FormatBinary:
+        lines.append(QStringLiteral("Format: Binary"));
+        break;
+    case FormatElf:
+        lines.append(QStringLiteral("Format: ELF"));
+        break;
+    case FormatUf2:
+        lines.append(QStringLiteral("Format: UF2"));
+        break;
+    default:
+        lines.append(QStringLiteral("Format: Unknown"));
+        return lines.join(QLatin1Char('\n'));
+    }
+
+    lines.append(QStringLiteral("Address range: %1-%2")
+                 .arg(hex32(baseAddress_), hex32(baseAddress_ + static_cast<uint32_t>(data_.size()) - 1)));
+
+    if (!hasDescriptor()) {
+        lines.append(QStringLiteral("App descriptor: Not found"));
+        return lines.join(QLatin1Char('\n'));
+    }
+
+    lines.append(QStringLiteral("App descriptor: %1").arg(hex32(descriptorAddress())));
+    lines.append(QStringLiteral("Project name: %1").arg(projectName_));
+    lines.append(QStringLiteral("Version: %1").arg(version_));
+    lines.append(QStringLiteral("Build date: %1").arg(buildDate_));
+    lines.append(QStringLiteral("Build describe: %1").arg(buildDescribe_));
+    lines.append(QStringLiteral("Protocol version: %1").arg(protocolVersion_ ? QString::number(protocolVersion_) : QStringLiteral("Unversioned")));
+    lines.append(QStringLiteral("Settings schema: %1").arg(settingsVersion_ ? QString::number(settingsVersion_) : QStringLiteral("Unversioned")));
+    lines.append(QStringLiteral("Checksum: %1 (%2)")
+                 .arg(hex32(checksum_),
+                      isChecksumValid() ? QStringLiteral("valid")
+                                        : QStringLiteral("invalid, expected %1").arg(hex32(calculatedChecksum_))));
+
+    return lines.join(QLatin1Char('\n'));
+}
+
+QList<FirmwareImage::DiffRegion> FirmwareImage::diff(const FirmwareImage &a, const FirmwareImage &b)
+{
+    QList<DiffRegion> regions;
+
+    const uint32_t start = qMin(a.baseAddress_, b.baseAddress_);
+    const uint32_t end = qMax(a.baseAddress_ + static_cast<uint32_t>(a.data_.size()),
+                              b.baseAddress_ + static_cast<uint32_t>(b.data_.size()));
+
+    // Split the address range into the regions that matter to the bootloader
+    QList<DiffRegion> layout;
+    const uint32_t descAddress = a.hasDescriptor() ? a.descriptorAddress() : APP_DESCRIPTOR_ADDRESS;
+    layout.append({ QStringLiteral("Vector table"), start, qMin(start + VECTOR_TABLE_SIZE, end), 0, 0 });
+    layout.append({ QStringLiteral("Program"), qMin(start + VECTOR_TABLE_SIZE, end), qMin(descAddress, end), 0, 0 });
+    layout.append({ QStringLiteral("App descriptor"), qMin(descAddress, end), qMin(descAddress + APP_DESCRIPTOR_SIZE, end), 0, 0 });
+    layout.append({ QStringLiteral("Trailing data"), qMin(descAddress + APP_DESCRIPTOR_SIZE, end), end, 0, 0 });
+
+    auto byteAt = [](const FirmwareImage &image, uint32_t address) -> int {
+        if (address < image.baseAddress_
+                || address >= image.baseAddress_ + static_cast<uint32_t>(image.data_.size())) {
+            return 0xFF;
+        }
+        return static_cast<uint8_t>(image.data_.at(static_cast<int>(address - image.baseAddress_)));
+    };
+
+    for (DiffRegion region : layout) {
+        if (region.start >= region.end) { continue; }
+        for (uint32_t address = region.start; address < region.end; address++) {
+            if (byteAt(a, address) != byteAt(b, address)) {
+                if (region.changedBytes == 0) {
+                    region.firstChange = address;
+                }
+                region.changedBytes++;
+            }
+        }
+        regions.append(region);
+    }
+
+    return regions;
+}
+
+uint32_t FirmwareImage::stmCrc32(uint32_t crc, const QByteArray &data)
+{
+    // Same algorithm as the STM32 hardware CRC unit and tools/checksum.pl,
+    // processing the data as little-endian 32-bit words
+    static const uint32_t crcTable[16] = {
+        0x00000000, 0x04C11DB7, 0x09823B6E, 0x0D4326D9,
+        0x130476DC, 0x17C56B6B, 0x1A864DB2, 0x1E475005,
+        0x2608EDB8, 0x22C9F00F, 0x2F8AD6D6, 0x2B4BCB61,
+        0x350C9B64, 0x31CD86D3, 0x3C8EA00A, 0x384FBDBD
+    };
+
+    for (int i = 0; i + 4 <= data.size(); i += 4) {
+        crc ^= readU32(data, i);
+        for (int j = 0; j < 8; j++) {
+            crc = (crc << 4) ^ crcTable[crc >> 28];
+        }
+    }
+
+    return crc;
+}
@@ -0,0 +1,100 @@
+#ifndef FIRMWAREIMAGE_H
+#define FIRMWAREIMAGE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <stdint.h>
+
+/**
+ * Offline reader for densitometer firmware images.
+ *
+ * Images can be loaded from raw binary, ELF, or UF2 files. The loaded
+ * image is flattened into a contiguous block of flash contents, from which
+ * the app descriptor can be located and its checksum verified using the
+ * same algorithm as the bootloader.
+ */
+class FirmwareImage
+{
+public:
+    enum Format {
+        FormatUnknown,
+        FormatBinary,
+        FormatElf,
+        FormatUf2
+    };
+
+    /**
+     * A named region of the image that differs between two images.
+     */
+    struct DiffRegion {
+        QString name;
+        uint32_t start;
+        uint32_t end;
+        uint32_t changedBytes;
+        uint32_t firstChange;
+    };
+
+    FirmwareImage();
+
+    static FirmwareImage load(const QString &fileName, QString *errorString = nullptr);
+    static FirmwareImage fromData(const QByteArray &data, Format format, QString *errorString = nullptr);
+
+    bool isValid() const;
+    Format format() const;
+    uint32_t baseAddress() const;
+    QByteArray data() const;
+
+    bool hasDescriptor() const;
+    uint32_t descriptorAddress() const;
+    QString projectName() const;
+    QString version() const;
+    QString buildDate() const;
+    QString buildDescribe() const;
+    uint32_t protocolVersion() const;
+    uint32_t settingsVersion() const;
+
+    /** Checksum stored in the descriptor, in the byte order reported by the device */
+    uint32_t checksum() const;
+
+    /** Checksum calculated across the image, in the byte order reported by the device */
+    uint32_t calculatedChecksum() const;
+
+    bool isChecksumValid() const;
+
+    /**
+     * Check whether this image can be safely used on a device whose
+     * settings EEPROM has the provided schema version.
+     *
+     * @param deviceSettingsVersion Schema version reported by the device
+     * @param reason Set to a description of the problem on failure
+     * @return True if the image is compatible
+     */
+    bool isCompatible(uint32_t deviceSettingsVersion, QString *reason = nullptr) const;
+
+    QString toText() const;
+
+    static QList<DiffRegion> diff(const FirmwareImage &a, const FirmwareImage &b);
+
+    static uint32_t stmCrc32(uint32_t crc, const QByteArray &data);
+
+private:
+    static bool parseElf(const QByteArray &data, FirmwareImage *image, QString *errorString);
+    static bool parseUf2(const QByteArray &data, FirmwareImage *image, QString *errorString);
+    void parseDescriptor();
+
+    Format format_ = FormatUnknown;
+    uint32_t baseAddress_ = 0;
+    QByteArray data_;
+    int descriptorOffset_ = -1;
+    QString projectName_;
+    QString version_;
+    QString buildDate_;
+    QString buildDescribe_;
+    uint32_t protocolVersion_ = 0;
+    uint32_t settingsVersion_ = 0;
+    uint32_t checksum_ = 0;
+    uint32_t calculatedChecksum_ = 0;
+};
+
+#endif // FIRMWAREIMAGE_H
@@ -4,6 +4,7 @@
 #include <QScrollBar>
 #include <QDialogButtonBox>
 #include <QPushButton>
+#include <QMessageBox>
 #include <QDebug>
 
 GainCalibrationDialog::GainCalibrationDialog(DensInterface *densInterface, QWidget *parent) :
@@ -24,6 +25,7 @@ GainCalibrationDialog::GainCalibrationDialog(DensInterface *densInterface, QWidg
     connect(densInterface_, &DensInterface::calGainCalStatus, this, &GainCalibrationDialog::onCalGainCalStatus);
     connect(densInterface_, &DensInterface::calGainCalFinished, this, &GainCalibrationDialog::onCalGainCalFinished);
     connect(densInterface_, &DensInterface::calGainCalError, this, &GainCalibrationDialog::onCalGainCalError);
+    connect(densInterface_, &DensInterface::calGainCheckpointResponse, this, &GainCalibrationDialog::onCalGainCheckpointResponse);
 
     connect(ui->buttonBox, &QDialogButtonBox::accepted, this, &GainCalibrationDialog::accept);
     connect(ui->buttonBox, &QDialogButtonBox::rejected, this, &GainCalibrationDialog::reject);
@@ -74,10 +76,29 @@ void GainCalibrationDialog::onSystemRemoteControl(bool enabled)
     if (enabled && !started_) {
         started_ = true;
         running_ = true;
-        densInterface_->sendInvokeCalGain();
+        densInterface_->sendGetCalGainCheckpoint();
     }
 }
 
+void GainCalibrationDialog::onCalGainCheckpointResponse(int stage)
+{
+    if (!running_ || lastStatus_ != -1) { return; }
+
+    if (stage > 0) {
+        QMessageBox messageBox(this);
+        messageBox.setWindowTitle(tr("Resume Calibration"));
+        messageBox.setText(tr("A previous gain calibration was interrupted. Resume it from the last completed step?"));
+        messageBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+        messageBox.setDefaultButton(QMessageBox::Yes);
+
+        if (messageBox.exec() == QMessageBox::Yes) {
+            densInterface_->sendInvokeCalGainResume();
+            return;
+        }
+    }
+    densInterface_->sendInvokeCalGain();
+}
+
 void GainCalibrationDialog::onCalGainCalStatus(int status, int param)
 {
     if (status == lastStatus_ && param == lastParam_) {
@@ -107,6 +128,9 @@ void GainCalibrationDialog::onCalGainCalStatus(int status, int param)
             addText(tr("Waiting between measurements..."));
         }
         break;
+    case 8:
+        addText(tr("Resuming from checkpoint... [%1]").arg(param));
+        break;
     }
 
     lastStatus_ = status;
@@ -30,6 +30,7 @@ private slots:
     void onCalGainCalStatus(int status, int param);
     void onCalGainCalFinished();
     void onCalGainCalError();
+    void onCalGainCheckpointResponse(int stage);
 
 private:
     QString gainParamText(int param);
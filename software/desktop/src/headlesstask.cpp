@@ -2,18 +2,21 @@
 
 #include <iostream>
 
-#include <QSerialPort>
 #include <QSerialPortInfo>
+#include <QFile>
+#include <QTextStream>
+#include <QDateTime>
 #include <QDebug>
 
 #include "qsimplesignalaggregator.h"
 #include "settingsexporter.h"
+#include "firmwareimage.h"
 
 HeadlessTask::HeadlessTask(QObject *parent)
     : QObject{parent}
-    , serialPort_(new QSerialPort(this))
     , densInterface_(new DensInterface(this))
 {
+    connect(densInterface_, &DensInterface::commandNotSent, this, &HeadlessTask::commandNotSent);
 }
 
 void HeadlessTask::setPort(const QString &portName)
@@ -27,6 +30,11 @@ void HeadlessTask::setCommand(HeadlessTask::Command command, const QString &comm
     commandArg_ = commandArg;
 }
 
+void HeadlessTask::setReportOptions(const CalReportOptions &options)
+{
+    reportOptions_ = options;
+}
+
 void HeadlessTask::run()
 {
     if (!connectToDevice()) {
@@ -41,6 +49,12 @@ void HeadlessTask::run()
         systemInfoStart();
     } else if (command_ == HeadlessTask::CommandExportSettings) {
         exportSettingStart();
+    } else if (command_ == HeadlessTask::CommandCheckImage) {
+        checkImageStart();
+    } else if (command_ == HeadlessTask::CommandReport) {
+        reportStart();
+    } else if (command_ == HeadlessTask::CommandSelfTest) {
+        selfTestStart();
     } else {
         emit finished();
     }
@@ -48,7 +62,8 @@ void HeadlessTask::run()
 
 bool HeadlessTask::connectToDevice()
 {
-    if (portName_.isEmpty()) {
+    QString uri = portName_;
+    if (uri.isEmpty()) {
         const auto infos = QSerialPortInfo::availablePorts();
         QSerialPortInfo selectedPort;
         for (const QSerialPortInfo &info : infos) {
@@ -63,37 +78,48 @@ bool HeadlessTask::connectToDevice()
 
         if (!selectedPort.isNull()) {
             qDebug() << "Detected device at:" << selectedPort.portName();
-            serialPort_->setPort(selectedPort);
+            uri = QStringLiteral("serial:%1").arg(selectedPort.portName());
         } else  {
             qWarning() << "No devices found";
+            return false;
         }
     } else {
         qDebug() << "Connecting to:" << portName_;
-        serialPort_->setPortName(portName_);
     }
 
-    serialPort_->setBaudRate(QSerialPort::Baud115200);
-    serialPort_->setDataBits(QSerialPort::Data8);
-    serialPort_->setParity(QSerialPort::NoParity);
-    serialPort_->setStopBits(QSerialPort::OneStop);
-    serialPort_->setFlowControl(QSerialPort::NoFlowControl);
+    QString errorString;
+    transport_ = DensTransport::fromUri(uri, this, &errorString);
+    if (!transport_) {
+        qWarning() << errorString;
+        return false;
+    }
 
-    if (serialPort_->open(QIODevice::ReadWrite)) {
-        serialPort_->setDataTerminalReady(true);
-        if (densInterface_->connectToDevice(serialPort_)) {
+    if (transport_->open()) {
+        if (densInterface_->connectToDevice(transport_)) {
             qDebug() << "Connected to device";
             return true;
         } else {
-            serialPort_->close();
+            transport_->close();
             qWarning() << "Unrecognized device";
             return false;
         }
     }
 
-    qDebug() << "Error opening device";
+    qDebug() << "Error opening device:" << transport_->errorString();
     return false;
 }
 
+void HeadlessTask::commandNotSent(DensCommand::CommandType type, DensCommand::CommandCategory category, const QString &action)
+{
+    Q_UNUSED(type)
+    Q_UNUSED(category)
+
+    // The task would otherwise wait forever on a response that is not coming
+    disconnect(densInterface_, &DensInterface::commandNotSent, this, &HeadlessTask::commandNotSent);
+    std::cout << "Unable to send " << action.toStdString() << " to the device" << std::endl;
+    emit finished();
+}
+
 void HeadlessTask::systemInfoStart()
 {
     QSimpleSignalAggregator *aggregator = new QSimpleSignalAggregator(this);
@@ -138,3 +164,154 @@ void HeadlessTask::exportSettingStart()
     });
     exporter->prepareExport();
 }
+
+void HeadlessTask::checkImageStart()
+{
+    QString errorString;
+    FirmwareImage image = FirmwareImage::load(commandArg_, &errorString);
+    if (!image.isValid()) {
+        std::cout << "Unable to load image: " << errorString.toStdString() << std::endl;
+        emit finished();
+        return;
+    }
+
+    // The settings schema was reported as part of the connection process
+    std::cout << "Device version: " << densInterface_->version().toStdString() << std::endl;
+    std::cout << "Device protocol version: " << densInterface_->protocolVersion() << std::endl;
+    std::cout << "Device settings schema: " << densInterface_->settingsVersion() << std::endl;
+    std::cout << "Image version: " << image.version().toStdString() << std::endl;
+
+    QString reason;
+    if (image.isCompatible(densInterface_->settingsVersion(), &reason)) {
+        std::cout << "Image is compatible with the device" << std::endl;
+    } else {
+        std::cout << "Image is NOT compatible with the device: " << reason.toStdString() << std::endl;
+    }
+
+    emit finished();
+}
+
+void HeadlessTask::reportStart()
+{
+    // The settings exporter collects everything the report needs
+    SettingsExporter *exporter = new SettingsExporter(densInterface_, this);
+    connect(exporter, &SettingsExporter::exportReady, this, [this, exporter]() {
+        exporter->deleteLater();
+
+        QString errorString;
+        CalReport report = CalReport::fromDevice(densInterface_);
+        if (!report.applyOptions(reportOptions_, &errorString)) {
+            std::cout << "Unable to prepare report: " << errorString.toStdString() << std::endl;
+        } else {
+            const QString fileName = report.outputFileName(commandArg_);
+            if (report.write(fileName, &errorString)) {
+                std::cout << "Wrote report for " << report.uniqueId().toStdString()
+                          << " to " << fileName.toStdString() << std::endl;
+            } else {
+                std::cout << fileName.toStdString() << ": " << errorString.toStdString() << std::endl;
+            }
+        }
+        emit finished();
+    });
+    connect(exporter, &SettingsExporter::exportFailed, this, [this, exporter]() {
+        std::cout << "Unable to read calibration from device" << std::endl;
+        exporter->deleteLater();
+        emit finished();
+    });
+    exporter->prepareExport();
+}
+
+void HeadlessTask::selfTestStart()
+{
+    // The self-test drives the sensor directly, which is only
+    // allowed while the device is under remote control
+    connect(densInterface_, &DensInterface::systemRemoteControl, this, &HeadlessTask::selfTestRemoteControl);
+    connect(densInterface_, &DensInterface::diagSelfTestResponse, this, &HeadlessTask::selfTestFinished);
+
+    densInterface_->sendGetSystemUID();
+    densInterface_->sendInvokeSystemRemoteControl(true);
+}
+
+void HeadlessTask::selfTestRemoteControl(bool enabled)
+{
+    if (enabled) {
+        std::cout << "Running self-test on " << densInterface_->uniqueId().toStdString() << std::endl;
+        densInterface_->sendInvokeDiagSelfTest();
+    } else {
+        std::cout << "Unable to enable remote control" << std::endl;
+        emit finished();
+    }
+}
+
+void HeadlessTask::selfTestFinished(const QList<DensSelfTestResult> &results, bool passed)
+{
+    disconnect(densInterface_, &DensInterface::systemRemoteControl, this, &HeadlessTask::selfTestRemoteControl);
+
+    if (results.isEmpty()) {
+        std::cout << "Device refused to run the self-test" << std::endl;
+    } else {
+        for (const DensSelfTestResult &result : results) {
+            const char *status;
+            if (result.status == DensSelfTestResult::StatusPass) {
+                status = "PASS";
+            } else if (result.status == DensSelfTestResult::StatusFail) {
+                status = "FAIL";
+            } else {
+                status = "SKIP";
+            }
+            std::cout << result.check.leftJustified(12).toStdString()
+                      << status << "  " << result.value << std::endl;
+        }
+        std::cout << "Self-test " << (passed ? "passed" : "FAILED") << std::endl;
+
+        if (!commandArg_.isEmpty()) {
+            QString errorString;
+            if (!appendSelfTestHistory(results, &errorString)) {
+                std::cout << commandArg_.toStdString() << ": " << errorString.toStdString() << std::endl;
+            }
+        }
+    }
+
+    // Wait for the device to leave remote control before exiting,
+    // so the command is not lost along with the connection
+    connect(densInterface_, &DensInterface::systemRemoteControl, this, &HeadlessTask::finished);
+    densInterface_->sendInvokeSystemRemoteControl(false);
+}
+
+bool HeadlessTask::appendSelfTestHistory(const QList<DensSelfTestResult> &results, QString *errorString)
+{
+    // Rows are only ever appended, so the history of every device
+    // in a fleet can be kept in the same file
+    QFile file(commandArg_);
+    const bool isNew = !file.exists() || file.size() == 0;
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        if (errorString) { *errorString = file.errorString(); }
+        return false;
+    }
+
+    QTextStream out(&file);
+    if (isNew) {
+        out << "date,uid,check,status,value\n";
+    }
+
+    const QString date = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    for (const DensSelfTestResult &result : results) {
+        QString status;
+        if (result.status == DensSelfTestResult::StatusPass) {
+            status = QStringLiteral("PASS");
+        } else if (result.status == DensSelfTestResult::StatusFail) {
+            status = QStringLiteral("FAIL");
+        } else {
+            status = QStringLiteral("SKIP");
+        }
+        out << date << ',' << densInterface_->uniqueId() << ','
+            << result.check << ',' << status << ',' << result.value << '\n';
+    }
+
+    out.flush();
+    if (out.status() != QTextStream::Ok) {
+        if (errorString) { *errorString = file.errorString(); }
+        return false;
+    }
+    return true;
+}
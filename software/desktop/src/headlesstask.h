@@ -4,10 +4,7 @@
 #include <QObject>
 
 #include "densinterface.h"
-
-QT_BEGIN_NAMESPACE
-class QSerialPort;
-QT_END_NAMESPACE
+#include "calreport.h"
 
 class HeadlessTask : public QObject
 {
@@ -16,6 +13,9 @@ public:
     enum Command {
         CommandSystemInfo,
         CommandExportSettings,
+        CommandCheckImage,
+        CommandReport,
+        CommandSelfTest,
         CommandUnknown = -1
     };
 
@@ -23,6 +23,7 @@ public:
 
     void setPort(const QString &portName);
     void setCommand(HeadlessTask::Command command, const QString &commandArg);
+    void setReportOptions(const CalReportOptions &options);
 
 public slots:
     void run();
@@ -31,17 +32,25 @@ signals:
     void finished();
 
 private slots:
+    void commandNotSent(DensCommand::CommandType type, DensCommand::CommandCategory category, const QString &action);
     void systemInfoFinished();
+    void selfTestRemoteControl(bool enabled);
+    void selfTestFinished(const QList<DensSelfTestResult> &results, bool passed);
 
 private:
     bool connectToDevice();
     void systemInfoStart();
     void exportSettingStart();
+    void checkImageStart();
+    void reportStart();
+    void selfTestStart();
+    bool appendSelfTestHistory(const QList<DensSelfTestResult> &results, QString *errorString);
 
     QString portName_;
     HeadlessTask::Command command_ = HeadlessTask::CommandUnknown;
     QString commandArg_;
-    QSerialPort *serialPort_ = nullptr;
+    CalReportOptions reportOptions_;
+    DensTransport *transport_ = nullptr;
     DensInterface *densInterface_ = nullptr;
 };
 
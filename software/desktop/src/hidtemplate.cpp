@@ -0,0 +1,208 @@
+#include "hidtemplate.h"
+
+#include <QRegularExpression>
+#include <cmath>
+
+namespace
+{
+static const int DEFAULT_DECIMALS = 2;
+static const int MAX_DECIMALS = 4;
+static const int MAX_WIDTH = 9;
+static const int MAX_OPS = 24;
+static const int MAX_OUTPUT = 63;
+}
+
+HidTemplate::HidTemplate()
+{
+}
+
+HidTemplate HidTemplate::compile(const QString &source, QString *errorString)
+{
+    HidTemplate result;
+    result.source_ = source;
+
+    if (source.isEmpty()) {
+        if (errorString) { *errorString = QStringLiteral("Template is empty"); }
+        return result;
+    }
+    if (source.length() > MAX_LENGTH) {
+        if (errorString) { *errorString = QStringLiteral("Template is longer than %1 characters").arg(MAX_LENGTH); }
+        return result;
+    }
+
+    QList<Op> ops;
+    int i = 0;
+    while (i < source.length()) {
+        const QChar ch = source.at(i);
+        const QChar next = (i + 1 < source.length()) ? source.at(i + 1) : QChar();
+        if ((ch == QLatin1Char('{') || ch == QLatin1Char('}')) && next == ch) {
+            ops.append(Op{OpLiteral, false, 0, QString(ch)});
+            i += 2;
+        } else if (ch == QLatin1Char('{')) {
+            int end = source.indexOf(QLatin1Char('}'), i + 1);
+            if (end < 0) {
+                if (errorString) { *errorString = QStringLiteral("Unmatched '{' at position %1").arg(i + 1); }
+                return result;
+            }
+            if (!compilePlaceholder(source.mid(i + 1, end - (i + 1)), &ops, errorString)) {
+                return result;
+            }
+            i = end + 1;
+        } else if (ch == QLatin1Char('}')) {
+            if (errorString) { *errorString = QStringLiteral("Unmatched '}' at position %1").arg(i + 1); }
+            return result;
+        } else if (ch.unicode() < 0x20 || ch.unicode() > 0x7E) {
+            if (errorString) { *errorString = QStringLiteral("Unsupported character at position %1").arg(i + 1); }
+            return result;
+        } else {
+            ops.append(Op{OpLiteral, false, 0, QString(ch)});
+            i++;
+        }
+    }
+
+    // Merge adjacent literals, as the device does, to count ops the same way
+    for (const Op &op : ops) {
+        if (op.type == OpLiteral && !result.ops_.isEmpty() && result.ops_.last().type == OpLiteral) {
+            result.ops_.last().text.append(op.text);
+        } else {
+            result.ops_.append(op);
+        }
+    }
+    if (result.ops_.size() > MAX_OPS) {
+        if (errorString) { *errorString = QStringLiteral("Template has too many placeholders"); }
+        result.ops_.clear();
+        return result;
+    }
+
+    result.valid_ = true;
+    return result;
+}
+
+bool HidTemplate::compilePlaceholder(const QString &str, QList<Op> *ops, QString *errorString)
+{
+    static const QRegularExpression re(QStringLiteral("^([A-Z]+)(\\+)?(?::([0-9]))?$"));
+    const QRegularExpressionMatch match = re.match(str);
+    if (!match.hasMatch()) {
+        if (errorString) { *errorString = QStringLiteral("Invalid placeholder: {%1}").arg(str); }
+        return false;
+    }
+
+    const QString name = match.captured(1);
+    const bool sign = !match.captured(2).isEmpty();
+    const bool hasModifier = !match.captured(3).isEmpty();
+    const int modifier = match.captured(3).toInt();
+
+    if (name == QLatin1String("TAB") || name == QLatin1String("ENTER") || name == QLatin1String("SPACE")
+            || name == QLatin1String("MODE") || name == QLatin1String("SEP")) {
+        if (sign || hasModifier) {
+            if (errorString) { *errorString = QStringLiteral("{%1} does not take modifiers").arg(name); }
+            return false;
+        }
+        if (name == QLatin1String("TAB")) {
+            ops->append(Op{OpLiteral, false, 0, QStringLiteral("\t")});
+        } else if (name == QLatin1String("ENTER")) {
+            ops->append(Op{OpLiteral, false, 0, QStringLiteral("\n")});
+        } else if (name == QLatin1String("SPACE")) {
+            ops->append(Op{OpLiteral, false, 0, QStringLiteral(" ")});
+        } else if (name == QLatin1String("MODE")) {
+            ops->append(Op{OpMode, false, 0, QString()});
+        } else {
+            ops->append(Op{OpSeparator, false, 0, QString()});
+        }
+        return true;
+    }
+
+    if (name == QLatin1String("N")) {
+        if (sign || modifier > MAX_WIDTH) {
+            if (errorString) { *errorString = QStringLiteral("Invalid modifier for {N}"); }
+            return false;
+        }
+        ops->append(Op{OpSequence, false, modifier, QString()});
+        return true;
+    }
+
+    OpType type;
+    if (name == QLatin1String("D")) {
+        type = OpDensity;
+    } else if (name == QLatin1String("ZERO")) {
+        type = OpZero;
+    } else if (name == QLatin1String("F")) {
+        type = OpFStop;
+    } else {
+        if (errorString) { *errorString = QStringLiteral("Unknown placeholder: {%1}").arg(name); }
+        return false;
+    }
+
+    if (hasModifier && modifier > MAX_DECIMALS) {
+        if (errorString) { *errorString = QStringLiteral("At most %1 decimal places are supported").arg(MAX_DECIMALS); }
+        return false;
+    }
+
+    ops->append(Op{type, sign, hasModifier ? modifier : DEFAULT_DECIMALS, QString()});
+    return true;
+}
+
+bool HidTemplate::isValid() const { return valid_; }
+QString HidTemplate::source() const { return source_; }
+
+QString HidTemplate::expand(QChar mode, float density, float zero, uint sequence, QChar decimalSeparator) const
+{
+    if (!std::isfinite(density)) { density = 0.0F; }
+    if (!std::isfinite(zero)) { zero = 0.0F; }
+    const float relative = density - zero;
+
+    QString result;
+    for (const Op &op : ops_) {
+        switch (op.type) {
+        case OpLiteral:
+            result.append(op.text);
+            break;
+        case OpMode:
+            result.append(mode);
+            break;
+        case OpDensity:
+            result.append(formatNumber(relative, op, decimalSeparator));
+            break;
+        case OpZero:
+            result.append(formatNumber(zero, op, decimalSeparator));
+            break;
+        case OpFStop:
+            result.append(formatNumber(relative * std::log2(10.0F), op, decimalSeparator));
+            break;
+        case OpSequence:
+            result.append(QStringLiteral("%1").arg(sequence, op.decimals, 10, QLatin1Char('0')));
+            break;
+        case OpSeparator:
+            result.append(decimalSeparator == QLatin1Char(',') ? QLatin1Char(';') : QLatin1Char(','));
+            break;
+        }
+    }
+    return result.left(MAX_OUTPUT);
+}
+
+QString HidTemplate::formatNumber(float value, const Op &op, QChar decimalSeparator)
+{
+    QString number = QString::number(std::fabs(value), 'f', op.decimals);
+
+    // Catch cases where a negative was rounded to zero
+    bool negative = value < 0.0F && number.contains(QRegularExpression(QStringLiteral("[1-9]")));
+
+    if (decimalSeparator != QLatin1Char('.')) {
+        number.replace(QLatin1Char('.'), decimalSeparator);
+    }
+
+    if (negative) {
+        number.prepend(QLatin1Char('-'));
+    } else if (op.sign) {
+        number.prepend(QLatin1Char('+'));
+    }
+    return number;
+}
+
+QString HidTemplate::displayText(const QString &output)
+{
+    QString text = output;
+    text.replace(QLatin1Char('\t'), QStringLiteral("<TAB>"));
+    text.replace(QLatin1Char('\n'), QStringLiteral("<ENTER>"));
+    return text;
+}
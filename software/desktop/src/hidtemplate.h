@@ -0,0 +1,67 @@
+#ifndef HIDTEMPLATE_H
+#define HIDTEMPLATE_H
+
+#include <QList>
+#include <QString>
+
+/**
+ * Desktop implementation of the template format used by the device
+ * for USB key output, so that templates can be checked and previewed
+ * before they are sent to the device.
+ *
+ * This must be kept consistent with the firmware's hid_template module.
+ */
+class HidTemplate
+{
+public:
+    /** Maximum template length accepted by the device */
+    static const int MAX_LENGTH = 55;
+
+    HidTemplate();
+
+    static HidTemplate compile(const QString &source, QString *errorString = nullptr);
+
+    bool isValid() const;
+    QString source() const;
+
+    /**
+     * Expand the template for a reading.
+     *
+     * @param mode Reading type, 'R' or 'T'
+     * @param density Density reading, without the zero applied
+     * @param zero Zero offset, NaN if not set
+     * @param sequence Sequence number of the reading
+     * @param decimalSeparator Decimal separator, '.' or ','
+     */
+    QString expand(QChar mode, float density, float zero, uint sequence, QChar decimalSeparator) const;
+
+    /** Replace non-printing keys in expanded output with readable names */
+    static QString displayText(const QString &output);
+
+private:
+    enum OpType {
+        OpLiteral,
+        OpMode,
+        OpDensity,
+        OpZero,
+        OpFStop,
+        OpSequence,
+        OpSeparator
+    };
+
+    struct Op {
+        OpType type;
+        bool sign;
+        int decimals;
+        QString text;
+    };
+
+    static bool compilePlaceholder(const QString &str, QList<Op> *ops, QString *errorString);
+    static QString formatNumber(float value, const Op &op, QChar decimalSeparator);
+
+    bool valid_ = false;
+    QString source_;
+    QList<Op> ops_;
+};
+
+#endif // HIDTEMPLATE_H
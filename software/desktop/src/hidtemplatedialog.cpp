@@ -0,0 +1,83 @@
+#include "hidtemplatedialog.h"
+#include "ui_hidtemplatedialog.h"
+
+#include <QMessageBox>
+#include <QPushButton>
+#include "hidtemplate.h"
+
+HidTemplateDialog::HidTemplateDialog(DensInterface *densInterface, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::HidTemplateDialog),
+    densInterface_(densInterface)
+{
+    ui->setupUi(this);
+    ui->templateLineEdit->setMaxLength(HidTemplate::MAX_LENGTH);
+
+    connect(densInterface_, &DensInterface::systemHidTemplateResponse, this, &HidTemplateDialog::onSystemHidTemplateResponse);
+    connect(densInterface_, &DensInterface::systemHidTemplateSetComplete, this, &HidTemplateDialog::onSystemHidTemplateSetComplete);
+
+    connect(ui->templateLineEdit, &QLineEdit::textChanged, this, &HidTemplateDialog::onTemplateTextChanged);
+    connect(ui->decimalCommaCheckBox, &QCheckBox::toggled, this, &HidTemplateDialog::onTemplateTextChanged);
+    connect(ui->getPushButton, &QPushButton::clicked, this, &HidTemplateDialog::onGetClicked);
+    connect(ui->setPushButton, &QPushButton::clicked, this, &HidTemplateDialog::onSetClicked);
+
+    onTemplateTextChanged();
+
+    if (densInterface_->connected()) {
+        densInterface_->sendGetSystemHidTemplate();
+    }
+}
+
+HidTemplateDialog::~HidTemplateDialog()
+{
+    delete ui;
+}
+
+void HidTemplateDialog::onTemplateTextChanged()
+{
+    QString errorString;
+    const HidTemplate hidTemplate = HidTemplate::compile(ui->templateLineEdit->text(), &errorString);
+
+    if (!hidTemplate.isValid()) {
+        ui->previewPlainTextEdit->setPlainText(errorString);
+        ui->setPushButton->setEnabled(false);
+        return;
+    }
+
+    // Preview a few representative readings
+    const QChar decimalSeparator = ui->decimalCommaCheckBox->isChecked() ? QLatin1Char(',') : QLatin1Char('.');
+    QStringList lines;
+    lines.append(HidTemplate::displayText(hidTemplate.expand(QLatin1Char('R'), 1.23F, qSNaN(), 1, decimalSeparator)));
+    lines.append(HidTemplate::displayText(hidTemplate.expand(QLatin1Char('R'), 0.08F, 0.15F, 2, decimalSeparator)));
+    lines.append(HidTemplate::displayText(hidTemplate.expand(QLatin1Char('T'), 2.46F, 0.21F, 3, decimalSeparator)));
+    ui->previewPlainTextEdit->setPlainText(lines.join(QLatin1Char('\n')));
+
+    ui->setPushButton->setEnabled(densInterface_->connected());
+}
+
+void HidTemplateDialog::onGetClicked()
+{
+    densInterface_->sendGetSystemHidTemplate();
+}
+
+void HidTemplateDialog::onSetClicked()
+{
+    const HidTemplate hidTemplate = HidTemplate::compile(ui->templateLineEdit->text());
+    if (!hidTemplate.isValid()) { return; }
+
+    densInterface_->sendSetSystemHidTemplate(hidTemplate.source());
+}
+
+void HidTemplateDialog::onSystemHidTemplateResponse()
+{
+    ui->templateLineEdit->setText(densInterface_->hidTemplate());
+}
+
+void HidTemplateDialog::onSystemHidTemplateSetComplete(bool success)
+{
+    if (success) {
+        densInterface_->sendGetSystemHidTemplate();
+    } else {
+        QMessageBox::warning(this, tr("Error"), tr("The device did not accept the template"));
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef HIDTEMPLATEDIALOG_H
+#define HIDTEMPLATEDIALOG_H
+
+#include <QDialog>
+#include "densinterface.h"
+
+namespace Ui {
+class HidTemplateDialog;
+}
+
+class HidTemplateDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit HidTemplateDialog(DensInterface *densInterface, QWidget *parent = nullptr);
+    ~HidTemplateDialog();
+
+private slots:
+    void onTemplateTextChanged();
+    void onGetClicked();
+    void onSetClicked();
+    void onSystemHidTemplateResponse();
+    void onSystemHidTemplateSetComplete(bool success);
+
+private:
+    Ui::HidTemplateDialog *ui;
+    DensInterface *densInterface_;
+};
+
+#endif // HIDTEMPLATEDIALOG_H
@@ -1,13 +1,17 @@
 #include "logwindow.h"
 #include "ui_logwindow.h"
 
+#include <QComboBox>
+#include <QLabel>
 #include <QDebug>
 
 #include "logger.h"
+#include "densinterface.h"
 
-LogWindow::LogWindow(QWidget *parent) :
+LogWindow::LogWindow(DensInterface *densInterface, QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::LogWindow),
+    densInterface_(densInterface),
     logger_(new Logger)
 {
     ui->setupUi(this);
@@ -16,8 +20,46 @@ LogWindow::LogWindow(QWidget *parent) :
 
     ui->actionFollow->setChecked(true);
 
+    // Runtime log level filter controls, which are applied on the device
+    tagComboBox_ = new QComboBox(this);
+    tagComboBox_->setEditable(true);
+    tagComboBox_->setMinimumContentsLength(16);
+    tagComboBox_->setToolTip(tr("Log tag, or \"*\" for all tags"));
+    tagComboBox_->addItem(QStringLiteral("*"));
+
+    levelComboBox_ = new QComboBox(this);
+    levelComboBox_->addItem(tr("Assert"), QChar('A'));
+    levelComboBox_->addItem(tr("Error"), QChar('E'));
+    levelComboBox_->addItem(tr("Warning"), QChar('W'));
+    levelComboBox_->addItem(tr("Info"), QChar('I'));
+    levelComboBox_->addItem(tr("Debug"), QChar('D'));
+    levelComboBox_->addItem(tr("Verbose"), QChar('V'));
+    levelComboBox_->setCurrentIndex(levelComboBox_->count() - 1);
+    levelComboBox_->setToolTip(tr("Maximum log level to output"));
+
+    levelsLabel_ = new QLabel(this);
+
+    ui->toolBar->addSeparator();
+    ui->toolBar->addWidget(tagComboBox_);
+    ui->toolBar->addWidget(levelComboBox_);
+    ui->toolBar->addAction(ui->actionSetLevel);
+    ui->toolBar->addAction(ui->actionSaveLevels);
+    ui->toolBar->addAction(ui->actionResetLevels);
+    ui->toolBar->addSeparator();
+    ui->toolBar->addWidget(levelsLabel_);
+
     connect(ui->actionFollow, &QAction::toggled, this, &LogWindow::onFollowToggled);
     connect(ui->actionClear, &QAction::triggered, this, &LogWindow::onClearTriggered);
+    connect(ui->actionSetLevel, &QAction::triggered, this, &LogWindow::onSetLevelTriggered);
+    connect(ui->actionSaveLevels, &QAction::triggered, this, &LogWindow::onSaveLevelsTriggered);
+    connect(ui->actionResetLevels, &QAction::triggered, this, &LogWindow::onResetLevelsTriggered);
+
+    connect(densInterface_, &DensInterface::connectionOpened, this, &LogWindow::onConnectionOpened);
+    connect(densInterface_, &DensInterface::connectionClosed, this, &LogWindow::onConnectionClosed);
+    connect(densInterface_, &DensInterface::systemLogLevelsResponse, this, &LogWindow::onSystemLogLevelsResponse);
+    connect(densInterface_, &DensInterface::systemLogLevelSetComplete, this, &LogWindow::onSystemLogLevelSetComplete);
+
+    refreshLevelControls();
 }
 
 LogWindow::~LogWindow()
@@ -29,6 +71,9 @@ void LogWindow::showEvent(QShowEvent *event)
 {
     Q_UNUSED(event);
     emit opened();
+    if (densInterface_->connected()) {
+        densInterface_->sendGetSystemLogLevels();
+    }
 }
 
 void LogWindow::closeEvent(QCloseEvent *event)
@@ -42,6 +87,12 @@ void LogWindow::appendLogLine(const QByteArray &line)
     logger_->putData(line);
 }
 
+void LogWindow::appendMessage(const QString &source, const QString &message)
+{
+    // Messages from the app itself are marked, to separate them from device logs
+    logger_->putData(QStringLiteral("[%1] %2\n").arg(source, message).toUtf8());
+}
+
 void LogWindow::onFollowToggled(bool checked)
 {
     logger_->setAutoScroll(checked);
@@ -51,3 +102,68 @@ void LogWindow::onClearTriggered()
 {
     logger_->clear();
 }
+
+void LogWindow::onConnectionOpened()
+{
+    refreshLevelControls();
+    if (isVisible()) {
+        densInterface_->sendGetSystemLogLevels();
+    }
+}
+
+void LogWindow::onConnectionClosed()
+{
+    levelsLabel_->clear();
+    refreshLevelControls();
+}
+
+void LogWindow::onSetLevelTriggered()
+{
+    const QString tag = tagComboBox_->currentText().trimmed();
+    if (tag.isEmpty()) { return; }
+
+    densInterface_->sendSetSystemLogLevel(tag, levelComboBox_->currentData().toChar());
+}
+
+void LogWindow::onSaveLevelsTriggered()
+{
+    densInterface_->sendSetSystemLogLevelSave();
+}
+
+void LogWindow::onResetLevelsTriggered()
+{
+    densInterface_->sendSetSystemLogLevelReset();
+}
+
+void LogWindow::onSystemLogLevelsResponse()
+{
+    const QMap<QString, QChar> levels = densInterface_->logLevels();
+    QStringList filters;
+
+    for (auto it = levels.constBegin(); it != levels.constEnd(); ++it) {
+        filters.append(QStringLiteral("%1=%2").arg(it.key(), QString(it.value())));
+        if (tagComboBox_->findText(it.key()) < 0) {
+            tagComboBox_->addItem(it.key());
+        }
+    }
+
+    levelsLabel_->setText(tr("Filters: %1").arg(filters.join(QLatin1Char(' '))));
+}
+
+void LogWindow::onSystemLogLevelSetComplete(bool success)
+{
+    if (!success) {
+        qWarning() << "Unable to set log level filter";
+    }
+    densInterface_->sendGetSystemLogLevels();
+}
+
+void LogWindow::refreshLevelControls()
+{
+    const bool connected = densInterface_->connected();
+    tagComboBox_->setEnabled(connected);
+    levelComboBox_->setEnabled(connected);
+    ui->actionSetLevel->setEnabled(connected);
+    ui->actionSaveLevels->setEnabled(connected);
+    ui->actionResetLevels->setEnabled(connected);
+}
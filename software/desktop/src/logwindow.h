@@ -7,17 +7,21 @@ namespace Ui {
 class LogWindow;
 }
 class Logger;
+class DensInterface;
+class QComboBox;
+class QLabel;
 
 class LogWindow : public QMainWindow
 {
     Q_OBJECT
 
 public:
-    explicit LogWindow(QWidget *parent = nullptr);
+    explicit LogWindow(DensInterface *densInterface, QWidget *parent = nullptr);
     ~LogWindow();
 
 public slots:
     void appendLogLine(const QByteArray &line);
+    void appendMessage(const QString &source, const QString &message);
 
 signals:
     void opened();
@@ -26,14 +30,27 @@ signals:
 private slots:
     void onFollowToggled(bool checked);
     void onClearTriggered();
+    void onConnectionOpened();
+    void onConnectionClosed();
+    void onSetLevelTriggered();
+    void onSaveLevelsTriggered();
+    void onResetLevelsTriggered();
+    void onSystemLogLevelsResponse();
+    void onSystemLogLevelSetComplete(bool success);
 
 protected:
     virtual void showEvent(QShowEvent *event);
     virtual void closeEvent(QCloseEvent *event);
 
 private:
+    void refreshLevelControls();
+
     Ui::LogWindow *ui;
-    Logger *logger_ = nullptr;;
+    DensInterface *densInterface_;
+    Logger *logger_ = nullptr;
+    QComboBox *tagComboBox_ = nullptr;
+    QComboBox *levelComboBox_ = nullptr;
+    QLabel *levelsLabel_ = nullptr;
 };
 
 #endif // LOGWINDOW_H
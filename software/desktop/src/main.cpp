@@ -4,8 +4,12 @@
 #include <QLocale>
 #include <QTranslator>
 #include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
 #include <QSerialPortInfo>
 #include <QTimer>
+#include <QEventLoop>
+#include <QRegularExpression>
 #include <QDebug>
 
 #ifdef Q_OS_MACX
@@ -14,12 +18,377 @@
 
 #include "mainwindow.h"
 #include "headlesstask.h"
+#include "rpcserver.h"
+#include "firmwareimage.h"
+#include "temperaturefit.h"
+#include "steptablet.h"
+#include "cgats.h"
+#include "slopecalibrationdialog.h"
+#include "readingtransform.h"
+#include "calreport.h"
+#include "auditlog.h"
+#include "util.h"
 
 namespace
 {
 HeadlessTask::Command headlessCommand = HeadlessTask::CommandUnknown;
 QString headlessArg;
+CalReportOptions reportOptions;
 QString connectPort;
+bool rpcMode = false;
+}
+
+bool loadImage(const QString &fileName, FirmwareImage *image)
+{
+    QString errorString;
+    *image = FirmwareImage::load(fileName, &errorString);
+    if (!image->isValid()) {
+        std::cout << fileName.toStdString() << ": " << errorString.toStdString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void inspectImages(const QString &fileName, const QString &diffFileName)
+{
+    FirmwareImage image;
+    if (!loadImage(fileName, &image)) { return; }
+    std::cout << "[" << fileName.toStdString() << "]" << std::endl;
+    std::cout << image.toText().toStdString() << std::endl;
+
+    if (diffFileName.isEmpty()) { return; }
+
+    FirmwareImage diffImage;
+    if (!loadImage(diffFileName, &diffImage)) { return; }
+    std::cout << std::endl << "[" << diffFileName.toStdString() << "]" << std::endl;
+    std::cout << diffImage.toText().toStdString() << std::endl;
+
+    std::cout << std::endl << "Differences:" << std::endl;
+    const QList<FirmwareImage::DiffRegion> regions = FirmwareImage::diff(image, diffImage);
+    for (const FirmwareImage::DiffRegion &region : regions) {
+        QString line = QString("%1-%2 %3: ")
+                .arg(region.start, 8, 16, QLatin1Char('0'))
+                .arg(region.end - 1, 8, 16, QLatin1Char('0'))
+                .arg(region.name, -14);
+        if (region.changedBytes > 0) {
+            line.append(QString("%1 bytes changed, first at %2")
+                        .arg(region.changedBytes)
+                        .arg(region.firstChange, 8, 16, QLatin1Char('0')));
+        } else {
+            line.append("identical");
+        }
+        std::cout << line.toStdString() << std::endl;
+    }
+}
+
+void fitTemperature(const QString &fileName)
+{
+    QString errorString;
+    TemperatureFit fit = TemperatureFit::fromFile(fileName, &errorString);
+    if (fit.sampleCount() > 0) {
+        std::cout << fit.toText().toStdString() << std::endl;
+    }
+    if (!fit.isValid()) {
+        std::cout << fileName.toStdString() << ": " << errorString.toStdString() << std::endl;
+    }
+}
+
+void importTablet(const QString &fileName, const QString &serial)
+{
+    QString errorString;
+    StepTablet tablet = StepTablet::fromFile(fileName, &errorString);
+    if (!tablet.isValid()) {
+        std::cout << fileName.toStdString() << ": " << errorString.toStdString() << std::endl;
+        return;
+    }
+    if (!serial.isEmpty()) {
+        tablet.setSerial(serial);
+    }
+    StepTabletLibrary::addTablet(tablet);
+    std::cout << "Imported " << tablet.displayName().toStdString() << std::endl;
+}
+
+void inspectCgats(const QString &fileName, const QString &referenceFileName, const QString &outputFileName)
+{
+    QString errorString;
+    const QList<CgatsTable> tables = CgatsReader::readFile(fileName, &errorString);
+    if (tables.isEmpty()) {
+        std::cout << fileName.toStdString() << ": " << errorString.toStdString() << std::endl;
+        return;
+    }
+
+    for (const CgatsTable &table : tables) {
+        std::cout << "[" << table.identifier().toStdString() << "]" << std::endl;
+        const QList<QPair<QString, QString>> keywords = table.keywords();
+        for (const QPair<QString, QString> &keyword : keywords) {
+            std::cout << keyword.first.toStdString() << ": " << keyword.second.toStdString() << std::endl;
+        }
+        std::cout << "Fields: " << table.fields().join(", ").toStdString() << std::endl;
+        std::cout << "Rows: " << table.rowCount() << std::endl << std::endl;
+    }
+
+    if (!outputFileName.isEmpty()) {
+        if (CgatsWriter::writeFile(outputFileName, tables, &errorString)) {
+            std::cout << "Wrote " << tables.size() << " data sets to " << outputFileName.toStdString() << std::endl;
+        } else {
+            std::cout << outputFileName.toStdString() << ": " << errorString.toStdString() << std::endl;
+        }
+    }
+
+    if (referenceFileName.isEmpty()) { return; }
+
+    const QList<CgatsTable> referenceTables = CgatsReader::readFile(referenceFileName, &errorString);
+    if (referenceTables.isEmpty()) {
+        std::cout << referenceFileName.toStdString() << ": " << errorString.toStdString() << std::endl;
+        return;
+    }
+
+    const CgatsTable &table = tables.first();
+    const CgatsTable &reference = referenceTables.first();
+    const int field = table.densityField();
+    const int referenceField = reference.densityField();
+    if (field < 0 || referenceField < 0) {
+        std::cout << "No density values to compare" << std::endl;
+        return;
+    }
+
+    std::cout << "Differences:" << std::endl;
+    const int count = qMin(table.rowCount(), reference.rowCount());
+    for (int i = 0; i < count; i++) {
+        const float value = table.value(i, field).toFloat();
+        const float referenceValue = reference.value(i, referenceField).toFloat();
+        std::cout << QString("%1: %2 %3 %4")
+                     .arg(i + 1, 3)
+                     .arg(value, 5, 'f', 2)
+                     .arg(referenceValue, 5, 'f', 2)
+                     .arg(value - referenceValue, 6, 'f', 2)
+                     .toStdString() << std::endl;
+    }
+    if (table.rowCount() != reference.rowCount()) {
+        std::cout << "Row counts differ: " << table.rowCount() << " vs " << reference.rowCount() << std::endl;
+    }
+}
+
+void listTablets()
+{
+    const QList<StepTablet> tablets = StepTabletLibrary::tablets();
+    for (const StepTablet &tablet : tablets) {
+        std::cout << tablet.displayName().toStdString() << std::endl;
+    }
+    if (tablets.isEmpty()) {
+        std::cout << "No reference tablets." << std::endl;
+    }
+}
+
+void slopeCalibration(const QString &fileName, const QString &serial)
+{
+    const StepTablet tablet = StepTabletLibrary::tablet(serial);
+    if (!tablet.isValid()) {
+        std::cout << "Unknown reference tablet: " << serial.toStdString() << std::endl;
+        return;
+    }
+
+    // The first reading is the zero reading, followed by the patch readings
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        std::cout << fileName.toStdString() << ": " << file.errorString().toStdString() << std::endl;
+        return;
+    }
+    QList<float> readings;
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) { continue; }
+        bool ok = false;
+        float reading = line.section(QLatin1Char(','), -1).trimmed().toFloat(&ok);
+        if (ok) {
+            readings.append(reading);
+        }
+    }
+    if (readings.isEmpty()) {
+        std::cout << fileName.toStdString() << ": No readings" << std::endl;
+        return;
+    }
+
+    const float zeroReading = readings.takeFirst();
+    const StepTabletAlignment alignment = tablet.align(readings);
+    if (!alignment.valid) {
+        std::cout << "Alignment failed: " << alignment.message.toStdString() << std::endl;
+        return;
+    }
+
+    std::cout << "Tablet: " << tablet.displayName().toStdString() << std::endl;
+    std::cout << "Readings: " << readings.size()
+              << (alignment.reversed ? " (reversed)" : "") << std::endl;
+    for (int patch : alignment.skipped) {
+        std::cout << "Skipped patch: " << (patch + 1) << std::endl;
+    }
+    std::cout << "Correlation: " << alignment.correlation << std::endl;
+    std::cout << "Max residual: " << alignment.maxResidual << std::endl;
+
+    const QList<float> tabletDensities = tablet.densities();
+    QList<float> densities;
+    QList<float> patchReadings;
+    densities.append(0.0F);
+    patchReadings.append(zeroReading);
+    for (int i = 0; i < tabletDensities.size(); i++) {
+        densities.append(tabletDensities.at(i));
+        const int readingIndex = alignment.patches.indexOf(i);
+        patchReadings.append(readingIndex >= 0 ? readings.at(readingIndex) : qQNaN());
+    }
+
+    auto beta = SlopeCalibrationDialog::calculateSlope(densities, patchReadings);
+    if (qIsNaN(std::get<0>(beta))) {
+        std::cout << "Not enough readings to calculate slope calibration" << std::endl;
+        return;
+    }
+    std::cout << "B0: " << std::get<0>(beta) << std::endl;
+    std::cout << "B1: " << std::get<1>(beta) << std::endl;
+    std::cout << "B2: " << std::get<2>(beta) << std::endl;
+    std::cout << "Device command: SC SLOPE,"
+              << util::encode_f32(std::get<0>(beta)).toStdString() << ","
+              << util::encode_f32(std::get<1>(beta)).toStdString() << ","
+              << util::encode_f32(std::get<2>(beta)).toStdString() << std::endl;
+}
+
+void replayReadings(const QString &fileName, const QStringList &scripts)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        std::cout << fileName.toStdString() << ": " << file.errorString().toStdString() << std::endl;
+        return;
+    }
+
+    // Each line is a recorded reading, as mode,density[,zero[,raw,corrected,uncertainty]]
+    QList<TransformReading> readings;
+    const QRegularExpression separator(QStringLiteral("[,;\\s]+"));
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) { continue; }
+
+        const QStringList fields = line.split(separator, Qt::SkipEmptyParts);
+        TransformReading reading;
+        if (fields.value(0) == QLatin1String("R")) {
+            reading.type = DensInterface::DensityReflection;
+        } else if (fields.value(0) == QLatin1String("T")) {
+            reading.type = DensInterface::DensityTransmission;
+        }
+
+        bool ok;
+        reading.dValue = fields.value(1).toFloat(&ok);
+        if (!ok) {
+            // Assume this is a header line
+            continue;
+        }
+        if (fields.size() > 2) { reading.dZero = fields.at(2).toFloat(&ok); if (!ok) { reading.dZero = qSNaN(); } }
+        if (fields.size() > 3) { reading.rawValue = fields.at(3).toFloat(); }
+        if (fields.size() > 4) { reading.corrValue = fields.at(4).toFloat(); }
+        if (fields.size() > 5) { reading.dUncertainty = fields.at(5).toFloat(); }
+        readings.append(reading);
+    }
+    if (readings.isEmpty()) {
+        std::cout << fileName.toStdString() << ": No readings" << std::endl;
+        return;
+    }
+
+    ReadingTransform transform;
+    QEventLoop loop;
+    QStringList columns;
+    QList<QMap<QString, QString>> results;
+    quint64 lastSequence = 0;
+
+    QObject::connect(&transform, &ReadingTransform::scriptError, [](const QString &message) {
+        std::cout << "Script error: " << message.toStdString() << std::endl;
+    });
+    QObject::connect(&transform, &ReadingTransform::readingTransformed,
+                     [&](const TransformReading &reading, const QStringList &readingColumns, const QStringList &values) {
+        QMap<QString, QString> result;
+        for (int i = 0; i < readingColumns.size() && i < values.size(); i++) {
+            if (!columns.contains(readingColumns.at(i))) {
+                columns.append(readingColumns.at(i));
+            }
+            result.insert(readingColumns.at(i), values.at(i));
+        }
+        results.append(result);
+        if (reading.sequence == lastSequence) {
+            loop.quit();
+        }
+    });
+
+    transform.setScripts(scripts);
+    for (const TransformReading &reading : qAsConst(readings)) {
+        lastSequence = transform.processReading(reading.type, reading.dValue, reading.dZero,
+                                                reading.rawValue, reading.corrValue, reading.dUncertainty);
+    }
+    loop.exec();
+
+    std::cout << QStringList({ QStringLiteral("mode"), QStringLiteral("density"), QStringLiteral("zero") }).join(',').toStdString();
+    for (const QString &column : qAsConst(columns)) {
+        std::cout << "," << column.toStdString();
+    }
+    std::cout << std::endl;
+
+    for (int i = 0; i < readings.size() && i < results.size(); i++) {
+        const TransformReading &reading = readings.at(i);
+        QStringList fields;
+        if (reading.type == DensInterface::DensityReflection) {
+            fields.append(QStringLiteral("R"));
+        } else if (reading.type == DensInterface::DensityTransmission) {
+            fields.append(QStringLiteral("T"));
+        } else {
+            fields.append(QString());
+        }
+        fields.append(QString::number(reading.dValue, 'f', 2));
+        fields.append(qIsNaN(reading.dZero) ? QString() : QString::number(reading.dZero, 'f', 2));
+        for (const QString &column : qAsConst(columns)) {
+            fields.append(results.at(i).value(column));
+        }
+        std::cout << fields.join(',').toStdString() << std::endl;
+    }
+}
+
+void generateReports(const QString &outputPattern, const QStringList &snapshots, const CalReportOptions &options)
+{
+    if (snapshots.size() > 1 && !outputPattern.contains(QLatin1String("{uid}"))) {
+        std::cout << "Report file name must contain {uid} when generating more than one report" << std::endl;
+        return;
+    }
+
+    for (const QString &snapshot : snapshots) {
+        QString errorString;
+        CalReport report = CalReport::fromSnapshot(snapshot, &errorString);
+        if (!report.isValid()) {
+            std::cout << snapshot.toStdString() << ": " << errorString.toStdString() << std::endl;
+            continue;
+        }
+        if (!report.applyOptions(options, &errorString)) {
+            std::cout << "Unable to prepare report: " << errorString.toStdString() << std::endl;
+            return;
+        }
+
+        const QString fileName = report.outputFileName(outputPattern);
+        if (report.write(fileName, &errorString)) {
+            std::cout << "Wrote report for " << report.uniqueId().toStdString()
+                      << " to " << fileName.toStdString() << std::endl;
+        } else {
+            std::cout << fileName.toStdString() << ": " << errorString.toStdString() << std::endl;
+        }
+    }
+}
+
+void verifyAuditLog(const QString &fileName)
+{
+    QStringList issues;
+    const bool intact = AuditLog::verify(fileName, &issues);
+    for (const QString &issue : qAsConst(issues)) {
+        std::cout << issue.toStdString() << std::endl;
+    }
+    if (intact) {
+        std::cout << "Audit log chain is intact: " << fileName.toStdString() << std::endl;
+    } else {
+        std::cout << "Audit log chain is broken: " << fileName.toStdString() << std::endl;
+    }
 }
 
 bool handleCommandLine(const QCoreApplication &app)
@@ -35,7 +404,7 @@ bool handleCommandLine(const QCoreApplication &app)
     parser.addOption(listOption);
 
     QCommandLineOption portOption(QStringList() << "p" << "port",
-                                  QCoreApplication::translate("main", "Connect to device at the selected port."),
+                                  QCoreApplication::translate("main", "Connect to device at the selected port, or at a URI such as tcp:127.0.0.1:9000 or local:name."),
                                   QCoreApplication::translate("main", "port"));
     parser.addOption(portOption);
 
@@ -48,9 +417,156 @@ bool handleCommandLine(const QCoreApplication &app)
                                     QCoreApplication::translate("main", "file"));
     parser.addOption(exportOption);
 
+    QCommandLineOption inspectOption(QStringList() << "inspect",
+                                     QCoreApplication::translate("main", "Inspect a firmware image file (bin, elf, or uf2)."),
+                                     QCoreApplication::translate("main", "file"));
+    parser.addOption(inspectOption);
+
+    QCommandLineOption diffOption(QStringList() << "diff",
+                                  QCoreApplication::translate("main", "Compare the inspected firmware image against another image file."),
+                                  QCoreApplication::translate("main", "file"));
+    parser.addOption(diffOption);
+
+    QCommandLineOption checkImageOption(QStringList() << "check-image",
+                                        QCoreApplication::translate("main", "Check whether a firmware image is compatible with the device."),
+                                        QCoreApplication::translate("main", "file"));
+    parser.addOption(checkImageOption);
+
+    QCommandLineOption fitTempOption(QStringList() << "fit-temp",
+                                     QCoreApplication::translate("main", "Fit temperature compensation coefficients to a logged temperature sweep (CSV of temperature,reading)."),
+                                     QCoreApplication::translate("main", "file"));
+    parser.addOption(fitTempOption);
+
+    QCommandLineOption tabletOption(QStringList() << "tablet",
+                                    QCoreApplication::translate("main", "Serial number of the reference tablet to use."),
+                                    QCoreApplication::translate("main", "serial"));
+    parser.addOption(tabletOption);
+
+    QCommandLineOption importTabletOption(QStringList() << "import-tablet",
+                                          QCoreApplication::translate("main", "Import reference tablet data (CSV or CGATS) into the local library."),
+                                          QCoreApplication::translate("main", "file"));
+    parser.addOption(importTabletOption);
+
+    QCommandLineOption listTabletsOption(QStringList() << "list-tablets",
+                                         QCoreApplication::translate("main", "List reference tablets in the local library."));
+    parser.addOption(listTabletsOption);
+
+    QCommandLineOption slopeCalOption(QStringList() << "slope-cal",
+                                      QCoreApplication::translate("main", "Calculate slope calibration from a file of readings of the selected tablet."),
+                                      QCoreApplication::translate("main", "file"));
+    parser.addOption(slopeCalOption);
+
+    QCommandLineOption transformOption(QStringList() << "transform",
+                                       QCoreApplication::translate("main", "Reading transform script to run on replayed readings (may be repeated)."),
+                                       QCoreApplication::translate("main", "script"));
+    parser.addOption(transformOption);
+
+    QCommandLineOption replayOption(QStringList() << "replay",
+                                    QCoreApplication::translate("main", "Replay a file of recorded readings (CSV of mode,density,zero,...) through the transform scripts."),
+                                    QCoreApplication::translate("main", "file"));
+    parser.addOption(replayOption);
+
+    QCommandLineOption cgatsOption(QStringList() << "cgats",
+                                   QCoreApplication::translate("main", "Inspect a CGATS or Argyll .ti3 measurement file."),
+                                   QCoreApplication::translate("main", "file"));
+    parser.addOption(cgatsOption);
+
+    QCommandLineOption referenceOption(QStringList() << "reference",
+                                       QCoreApplication::translate("main", "Compare the inspected CGATS file against a reference file."),
+                                       QCoreApplication::translate("main", "file"));
+    parser.addOption(referenceOption);
+
+    QCommandLineOption cgatsOutOption(QStringList() << "cgats-out",
+                                      QCoreApplication::translate("main", "Write the data sets read from the inspected CGATS file to a new file."),
+                                      QCoreApplication::translate("main", "file"));
+    parser.addOption(cgatsOutOption);
+
+    QCommandLineOption reportOption(QStringList() << "report",
+                                    QCoreApplication::translate("main", "Generate a calibration certificate (PDF or HTML, by file extension). "
+                                                                        "Use {uid} in the file name for batches of devices. "
+                                                                        "Set QT_QPA_PLATFORM=offscreen to run without a display."),
+                                    QCoreApplication::translate("main", "file"));
+    parser.addOption(reportOption);
+
+    QCommandLineOption snapshotOption(QStringList() << "snapshot",
+                                      QCoreApplication::translate("main", "Generate the report from an exported settings file instead of a connected device (may be repeated)."),
+                                      QCoreApplication::translate("main", "file"));
+    parser.addOption(snapshotOption);
+
+    QCommandLineOption reportTemplateOption(QStringList() << "report-template",
+                                            QCoreApplication::translate("main", "HTML template for the calibration certificate."),
+                                            QCoreApplication::translate("main", "file"));
+    parser.addOption(reportTemplateOption);
+
+    QCommandLineOption reportLogoOption(QStringList() << "report-logo",
+                                        QCoreApplication::translate("main", "Logo image for the calibration certificate."),
+                                        QCoreApplication::translate("main", "file"));
+    parser.addOption(reportLogoOption);
+
+    QCommandLineOption operatorOption(QStringList() << "operator",
+                                      QCoreApplication::translate("main", "Name of the operator shown on the calibration certificate."),
+                                      QCoreApplication::translate("main", "name"));
+    parser.addOption(operatorOption);
+
+    QCommandLineOption verifyOption(QStringList() << "verify",
+                                    QCoreApplication::translate("main", "Verification readings for the calibration certificate (CSV of target,reading, or readings of the selected tablet)."),
+                                    QCoreApplication::translate("main", "file"));
+    parser.addOption(verifyOption);
+
+    QCommandLineOption toleranceOption(QStringList() << "tolerance",
+                                       QCoreApplication::translate("main", "Maximum deviation of a verification reading from its target."),
+                                       QCoreApplication::translate("main", "density"));
+    parser.addOption(toleranceOption);
+
+    QCommandLineOption verifyAuditOption(QStringList() << "verify-audit",
+                                         QCoreApplication::translate("main", "Verify the hash chain of the settings audit log, and report any gaps, tampering or untracked device changes."));
+    parser.addOption(verifyAuditOption);
+
+    QCommandLineOption auditLogOption(QStringList() << "audit-log",
+                                      QCoreApplication::translate("main", "Audit log file to verify, instead of the default one."),
+                                      QCoreApplication::translate("main", "file"));
+    parser.addOption(auditLogOption);
+
+    QCommandLineOption selfTestOption(QStringList() << "self-test",
+                                      QCoreApplication::translate("main", "Run the device built-in self-test."));
+    parser.addOption(selfTestOption);
+
+    QCommandLineOption selfTestLogOption(QStringList() << "self-test-log",
+                                         QCoreApplication::translate("main", "Append the self-test results to a CSV file, for tracking devices over time."),
+                                         QCoreApplication::translate("main", "file"));
+    parser.addOption(selfTestLogOption);
+
+    QCommandLineOption rpcOption(QStringList() << "rpc",
+                                 QCoreApplication::translate("main", "Run a JSON-RPC 2.0 server on stdin and stdout, with one message per line. "
+                                                                     "The port option sets the device used when connect is called without one."));
+    parser.addOption(rpcOption);
+
     // Parse the command line
     parser.process(app);
 
+    if (parser.isSet(reportOption)) {
+        reportOptions.templateFile = parser.value(reportTemplateOption);
+        reportOptions.logoFile = parser.value(reportLogoOption);
+        reportOptions.operatorName = parser.value(operatorOption);
+        reportOptions.readingsFile = parser.value(verifyOption);
+        reportOptions.tabletSerial = parser.value(tabletOption);
+        if (parser.isSet(toleranceOption)) {
+            bool ok;
+            reportOptions.tolerance = parser.value(toleranceOption).toFloat(&ok);
+            if (!ok) { reportOptions.tolerance = qSNaN(); }
+        }
+    }
+
+    if (parser.isSet(reportOption) && parser.isSet(snapshotOption)) {
+        generateReports(parser.value(reportOption), parser.values(snapshotOption), reportOptions);
+        return true;
+    }
+
+    if (parser.isSet(verifyAuditOption)) {
+        verifyAuditLog(parser.isSet(auditLogOption) ? parser.value(auditLogOption) : AuditLog::defaultFileName());
+        return true;
+    }
+
     if (parser.isSet(listOption)) {
         bool hasDevices = false;
         const auto infos = QSerialPortInfo::availablePorts();
@@ -73,7 +589,50 @@ bool handleCommandLine(const QCoreApplication &app)
         return true;
     }
 
+    if (parser.isSet(inspectOption)) {
+        inspectImages(parser.value(inspectOption), parser.value(diffOption));
+        return true;
+    }
+
+    if (parser.isSet(cgatsOption)) {
+        inspectCgats(parser.value(cgatsOption), parser.value(referenceOption), parser.value(cgatsOutOption));
+        return true;
+    }
+
+    if (parser.isSet(importTabletOption)) {
+        importTablet(parser.value(importTabletOption), parser.value(tabletOption));
+        return true;
+    }
+
+    if (parser.isSet(listTabletsOption)) {
+        listTablets();
+        return true;
+    }
+
+    if (parser.isSet(slopeCalOption)) {
+        slopeCalibration(parser.value(slopeCalOption), parser.value(tabletOption));
+        return true;
+    }
+
+    if (parser.isSet(replayOption)) {
+        replayReadings(parser.value(replayOption), parser.values(transformOption));
+        return true;
+    }
+
+    if (parser.isSet(fitTempOption)) {
+        fitTemperature(parser.value(fitTempOption));
+        return true;
+    }
+
     QString portValue = parser.value(portOption);
+
+    // Nothing but protocol messages can be written to stdout in this mode
+    if (parser.isSet(rpcOption)) {
+        rpcMode = true;
+        connectPort = portValue;
+        return false;
+    }
+
     if (!portValue.isEmpty()) {
         std::cout << "Connecting to " << portValue.toStdString() << std::endl;
         connectPort = portValue;
@@ -88,6 +647,21 @@ bool handleCommandLine(const QCoreApplication &app)
         headlessArg = parser.value(exportOption);
     }
 
+    if (parser.isSet(checkImageOption) && headlessCommand == HeadlessTask::CommandUnknown) {
+        headlessCommand = HeadlessTask::CommandCheckImage;
+        headlessArg = parser.value(checkImageOption);
+    }
+
+    if (parser.isSet(reportOption) && headlessCommand == HeadlessTask::CommandUnknown) {
+        headlessCommand = HeadlessTask::CommandReport;
+        headlessArg = parser.value(reportOption);
+    }
+
+    if (parser.isSet(selfTestOption) && headlessCommand == HeadlessTask::CommandUnknown) {
+        headlessCommand = HeadlessTask::CommandSelfTest;
+        headlessArg = parser.value(selfTestLogOption);
+    }
+
     return false;
 }
 
@@ -121,10 +695,17 @@ int main(int argc, char *argv[])
         return 0;
     }
 
-    if (headlessCommand != HeadlessTask::CommandUnknown) {
+    if (rpcMode) {
+        RpcServer *server = new RpcServer(&a);
+        server->setPort(connectPort);
+        QTimer::singleShot(0, server, &RpcServer::run);
+        QObject::connect(server, &RpcServer::finished, &a, &QCoreApplication::quit);
+        return a.exec();
+    } else if (headlessCommand != HeadlessTask::CommandUnknown) {
         HeadlessTask *task = new HeadlessTask(&a);
         task->setPort(connectPort);
         task->setCommand(headlessCommand, headlessArg);
+        task->setReportOptions(reportOptions);
         QTimer::singleShot(0, task, &HeadlessTask::run);
         QObject::connect(task, &HeadlessTask::finished, &a, &QCoreApplication::quit);
         return a.exec();
@@ -4,10 +4,19 @@
 #include <QtCore/QDebug>
 #include <QtCore/QThread>
 #include <QtCore/QMimeData>
+#include <QtCore/QSettings>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QDateTime>
+#include <QtCore/QTimer>
 #include <QtWidgets/QLabel>
 #include <QtWidgets/QMessageBox>
 #include <QtWidgets/QFileDialog>
+#include <QtWidgets/QInputDialog>
 #include <QtWidgets/QMessageBox>
+#include <QtWidgets/QUndoGroup>
+#include <QtWidgets/QUndoStack>
+#include <QtGui/QCloseEvent>
 #include <QtGui/QImage>
 #include <QtGui/QValidator>
 #include <QtGui/QStandardItemModel>
@@ -18,24 +27,47 @@
 #include "remotecontroldialog.h"
 #include "gaincalibrationdialog.h"
 #include "slopecalibrationdialog.h"
+#include "hidtemplatedialog.h"
+#include "menusettingsdialog.h"
+#include "calprofilesdialog.h"
+#include "calreport.h"
 #include "logwindow.h"
 #include "settingsexporter.h"
 #include "settingsimportdialog.h"
 #include "floatitemdelegate.h"
+#include "crashreport.h"
+#include "cgats.h"
+#include "auditlog.h"
+#include "workspace.h"
+#include "qcdialog.h"
 #include "util.h"
 
 namespace
 {
 static const int MEAS_TABLE_ROWS = 10;
+static const float DEFAULT_UNCERTAINTY_THRESHOLD = 0.02F;
+static const int MEAS_TABLE_FIXED_COLUMNS = 4;
+static const int MEAS_RAW_ROLE = Qt::UserRole + 1;
+static const int MEAS_CORRECTED_ROLE = Qt::UserRole + 2;
+static const int MEAS_TIME_ROLE = Qt::UserRole + 3;
+static const int WORKSPACE_AUTOSAVE_INTERVAL = 30000;
 }
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , statusLabel_(new QLabel)
-    , serialPort_(new QSerialPort(this))
+    , sessionLabel_(new QLabel)
     , densInterface_(new DensInterface(this))
-    , logWindow_(new LogWindow(this))
+    , logWindow_(new LogWindow(densInterface_, this))
+    , undoGroup_(new QUndoGroup(this))
+    , measUndoStack_(new QUndoStack(undoGroup_))
+    , calUndoStack_(new QUndoStack(undoGroup_))
+    , readingTransform_(new ReadingTransform(this))
+    , auditLog_(new AuditLog())
+    , auditSyncTimer_(new QTimer(this))
+    , workspace_(new Workspace())
+    , autosaveTimer_(new QTimer(this))
 {
     // Setup initial state of menu items
     ui->setupUi(this);
@@ -46,11 +78,17 @@ MainWindow::MainWindow(QWidget *parent)
 
     ui->actionImportSettings->setEnabled(false);
     ui->actionExportSettings->setEnabled(false);
+    ui->actionHidTemplate->setEnabled(false);
+    ui->actionMenuSettings->setEnabled(false);
+    ui->actionCalProfiles->setEnabled(false);
+    ui->actionCalReport->setEnabled(false);
 
     ui->refreshSensorsPushButton->setEnabled(false);
     ui->screenshotButton->setEnabled(false);
+    ui->crashReportPushButton->setEnabled(false);
 
     ui->statusBar->addWidget(statusLabel_);
+    ui->statusBar->addPermanentWidget(sessionLabel_);
 
     ui->zeroIndicatorLabel->setPixmap(QPixmap());
 
@@ -64,6 +102,15 @@ MainWindow::MainWindow(QWidget *parent)
     ui->actionDelete->setShortcut(QKeySequence::Delete);
     ui->actionExit->setShortcut(QKeySequence::Quit);
 
+    // Setup undo and redo, with a separate history for each tab
+    QAction *undoAction = undoGroup_->createUndoAction(this, tr("&Undo"));
+    undoAction->setShortcut(QKeySequence::Undo);
+    QAction *redoAction = undoGroup_->createRedoAction(this, tr("&Redo"));
+    redoAction->setShortcut(QKeySequence::Redo);
+    ui->menuEdit->insertAction(ui->actionCut, undoAction);
+    ui->menuEdit->insertAction(ui->actionCut, redoAction);
+    ui->menuEdit->insertSeparator(ui->actionCut);
+
     // Calibration (measurement light) field validation
     ui->reflLightLineEdit->setValidator(util::createIntValidator(1, 128, this));
     ui->tranLightLineEdit->setValidator(util::createIntValidator(1, 128, this));
@@ -112,8 +159,16 @@ MainWindow::MainWindow(QWidget *parent)
 
     // Top-level UI signals
     connect(ui->menuEdit, &QMenu::aboutToShow, this, &MainWindow::onMenuEditAboutToShow);
+    connect(ui->menuSession, &QMenu::aboutToShow, this, &MainWindow::onMenuSessionAboutToShow);
+    connect(ui->tabWidget, &QTabWidget::currentChanged, this, &MainWindow::onTabChanged);
     connect(ui->actionConnect, &QAction::triggered, this, &MainWindow::openConnection);
     connect(ui->actionDisconnect, &QAction::triggered, this, &MainWindow::closeConnection);
+    connect(ui->actionNewWorkspace, &QAction::triggered, this, &MainWindow::onNewWorkspace);
+    connect(ui->actionOpenWorkspace, &QAction::triggered, this, &MainWindow::onOpenWorkspace);
+    connect(ui->actionSaveWorkspace, &QAction::triggered, this, &MainWindow::onSaveWorkspace);
+    connect(ui->actionSaveWorkspaceAs, &QAction::triggered, this, &MainWindow::onSaveWorkspaceAs);
+    connect(ui->actionExportMeasurements, &QAction::triggered, this, &MainWindow::onExportMeasurements);
+    connect(ui->actionImportReference, &QAction::triggered, this, &MainWindow::onImportReference);
     connect(ui->actionExit, &QAction::triggered, this, &MainWindow::close);
     //connect(ui->actionConfigure, &QAction::triggered, settings_, &SettingsDialog::show);
     connect(ui->actionCut, &QAction::triggered, this, &MainWindow::onActionCut);
@@ -122,9 +177,22 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->actionDelete, &QAction::triggered, this, &MainWindow::onActionDelete);
     connect(ui->actionImportSettings, &QAction::triggered, this, &MainWindow::onImportSettings);
     connect(ui->actionExportSettings, &QAction::triggered, this, &MainWindow::onExportSettings);
+    connect(ui->actionHidTemplate, &QAction::triggered, this, &MainWindow::onHidTemplate);
+    connect(ui->actionMenuSettings, &QAction::triggered, this, &MainWindow::onMenuSettings);
+    connect(ui->actionCalProfiles, &QAction::triggered, this, &MainWindow::onCalProfiles);
+    connect(ui->actionCalReport, &QAction::triggered, this, &MainWindow::onCalReport);
+    connect(ui->actionReadingScripts, &QAction::triggered, this, &MainWindow::onReadingScripts);
+    connect(ui->actionClearReadingScripts, &QAction::triggered, this, &MainWindow::onClearReadingScripts);
+    connect(ui->actionQcMode, &QAction::triggered, this, &MainWindow::onQcMode);
     connect(ui->actionLogger, &QAction::triggered, this, &MainWindow::onLogger);
     connect(ui->actionAbout, &QAction::triggered, this, &MainWindow::about);
 
+    // Session menu signals
+    connect(ui->actionNewSession, &QAction::triggered, this, &MainWindow::onNewSession);
+    connect(ui->actionRenameSession, &QAction::triggered, this, &MainWindow::onRenameSession);
+    connect(ui->actionSessionNotes, &QAction::triggered, this, &MainWindow::onSessionNotes);
+    connect(ui->actionDeleteSession, &QAction::triggered, this, &MainWindow::onDeleteSession);
+
     // Log window UI signals
     connect(logWindow_, &LogWindow::opened, this, &MainWindow::onLoggerOpened);
     connect(logWindow_, &LogWindow::closed, this, &MainWindow::onLoggerClosed);
@@ -137,6 +205,7 @@ MainWindow::MainWindow(QWidget *parent)
     // Diagnostics UI signals
     connect(ui->refreshSensorsPushButton, &QPushButton::clicked, densInterface_, &DensInterface::sendGetSystemInternalSensors);
     connect(ui->screenshotButton, &QPushButton::clicked, densInterface_, &DensInterface::sendGetDiagDisplayScreenshot);
+    connect(ui->crashReportPushButton, &QPushButton::clicked, densInterface_, &DensInterface::sendGetDiagCrashRecord);
     connect(ui->remotePushButton, &QPushButton::clicked, this, &MainWindow::onRemoteControl);
 
     // Calibration UI signals
@@ -158,13 +227,17 @@ MainWindow::MainWindow(QWidget *parent)
     connect(densInterface_, &DensInterface::connectionOpened, this, &MainWindow::onConnectionOpened);
     connect(densInterface_, &DensInterface::connectionClosed, this, &MainWindow::onConnectionClosed);
     connect(densInterface_, &DensInterface::connectionError, this, &MainWindow::onConnectionError);
+    connect(densInterface_, &DensInterface::commandNotSent, this, &MainWindow::onCommandNotSent);
     connect(densInterface_, &DensInterface::densityReading, this, &MainWindow::onDensityReading);
+    connect(readingTransform_, &ReadingTransform::readingTransformed, this, &MainWindow::onReadingTransformed);
+    connect(readingTransform_, &ReadingTransform::scriptError, this, &MainWindow::onReadingScriptError);
     connect(densInterface_, &DensInterface::systemVersionResponse, this, &MainWindow::onSystemVersionResponse);
     connect(densInterface_, &DensInterface::systemBuildResponse, this, &MainWindow::onSystemBuildResponse);
     connect(densInterface_, &DensInterface::systemDeviceResponse, this, &MainWindow::onSystemDeviceResponse);
     connect(densInterface_, &DensInterface::systemUniqueId, this, &MainWindow::onSystemUniqueId);
     connect(densInterface_, &DensInterface::systemInternalSensors, this, &MainWindow::onSystemInternalSensors);
     connect(densInterface_, &DensInterface::diagDisplayScreenshot, this, &MainWindow::onDiagDisplayScreenshot);
+    connect(densInterface_, &DensInterface::diagCrashRecord, this, &MainWindow::onDiagCrashRecord);
     connect(densInterface_, &DensInterface::diagLogLine, logWindow_, &LogWindow::appendLogLine);
     connect(densInterface_, &DensInterface::calLightResponse, this, &MainWindow::onCalLightResponse);
     connect(densInterface_, &DensInterface::calGainResponse, this, &MainWindow::onCalGainResponse);
@@ -179,15 +252,30 @@ MainWindow::MainWindow(QWidget *parent)
     connect(densInterface_, &DensInterface::calReflectionSetComplete, densInterface_, &DensInterface::sendGetCalReflection);
     connect(densInterface_, &DensInterface::calTransmissionSetComplete, densInterface_, &DensInterface::sendGetCalTransmission);
 
+    // Audit trail of settings changes, with a single device state query
+    // after each batch of changes so they are synced together
+    auditSyncTimer_->setSingleShot(true);
+    auditSyncTimer_->setInterval(0);
+    connect(auditSyncTimer_, &QTimer::timeout, densInterface_, &DensInterface::sendGetSystemAudit);
+    connect(densInterface_, &DensInterface::settingsWriteSent, this, &MainWindow::onSettingsWriteSent);
+    connect(densInterface_, &DensInterface::systemAuditResponse, this, &MainWindow::onSystemAuditResponse);
+    connect(densInterface_, &DensInterface::calGainCalFinished, auditSyncTimer_, QOverload<>::of(&QTimer::start));
+    connect(densInterface_, &DensInterface::calGainCalError, this, [this]() {
+        // A failed run does not save its results, so there is no change to account for
+        auditLog_->recordCancel(densInterface_->uniqueId(), QStringLiteral("GAIN"));
+        auditSyncTimer_->start();
+    });
+
     // Setup the measurement model
     measModel_ = new QStandardItemModel(MEAS_TABLE_ROWS, 2, this);
-    measModel_->setHorizontalHeaderLabels(QStringList() << tr("Mode") << tr("Measurement") << tr("Offset"));
+    measModel_->setHorizontalHeaderLabels(QStringList() << tr("Mode") << tr("Measurement") << tr("Offset") << QString::fromUtf8("\u00B1"));
     ui->measTableView->setModel(measModel_);
     ui->measTableView->setItemDelegateForColumn(1, new FloatItemDelegate(0.0, 5.0, 2));
     ui->measTableView->setItemDelegateForColumn(2, new FloatItemDelegate(0.0, 5.0, 2));
     ui->measTableView->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
     ui->measTableView->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
     ui->measTableView->horizontalHeader()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
+    ui->measTableView->horizontalHeader()->setSectionResizeMode(3, QHeaderView::ResizeToContents);
 
     // Set the initial state of table items
     for (int row = 0; row < measModel_->rowCount(); row++) {
@@ -202,12 +290,46 @@ MainWindow::MainWindow(QWidget *parent)
         item->setSelectable(false);
         item->setEditable(false);
         measModel_->setItem(row, 2, item);
+
+        // Non-editable uncertainty item
+        item = new QStandardItem();
+        item->setSelectable(false);
+        item->setEditable(false);
+        measModel_->setItem(row, 3, item);
+    }
+
+    // Readings with an uncertainty above this threshold are flagged in the
+    // measurement table. As with other app settings that are mostly useful
+    // for device characterization, no UI is currently provided to change it.
+    QSettings settings;
+    bool ok;
+    uncertaintyThreshold_ = settings.value("measurement/uncertainty_threshold", DEFAULT_UNCERTAINTY_THRESHOLD).toFloat(&ok);
+    if (!ok || uncertaintyThreshold_ <= 0.0F) {
+        uncertaintyThreshold_ = DEFAULT_UNCERTAINTY_THRESHOLD;
     }
 
     QModelIndex index = measModel_->index(0, 1);
     ui->measTableView->setCurrentIndex(index);
     ui->measTableView->selectionModel()->clearSelection();
 
+    // Load any reading transform scripts, which add computed columns to the table
+    readingTransform_->loadSavedScripts();
+    ui->actionClearReadingScripts->setEnabled(readingTransform_->isActive());
+
+    // Track edits made directly in the table, so they can be undone
+    measTableState_ = measTableCapture();
+    connect(measModel_, &QStandardItemModel::itemChanged, this, &MainWindow::onMeasItemChanged);
+
+    // Changes to the measurement table are autosaved to the recovery file
+    // shortly after they are made, and any workspace left over from a
+    // previous run is offered for recovery once the window is shown
+    autosaveTimer_->setSingleShot(true);
+    autosaveTimer_->setInterval(WORKSPACE_AUTOSAVE_INTERVAL);
+    connect(autosaveTimer_, &QTimer::timeout, this, &MainWindow::onWorkspaceAutosave);
+    workspaceUpdateStatus();
+    QTimer::singleShot(0, this, &MainWindow::onWorkspaceRecover);
+    onTabChanged(ui->tabWidget->currentIndex());
+
     ui->autoAddPushButton->setChecked(true);
     ui->addReadingPushButton->setEnabled(false);
 
@@ -223,6 +345,8 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    delete workspace_;
+    delete auditLog_;
     delete ui;
 }
 
@@ -233,6 +357,15 @@ void MainWindow::connectToPort(const QString &portName)
     }
 }
 
+void MainWindow::closeEvent(QCloseEvent *event)
+{
+    if (workspaceMaybeSave()) {
+        event->accept();
+    } else {
+        event->ignore();
+    }
+}
+
 void MainWindow::openConnection()
 {
     qDebug() << "Open connection";
@@ -256,35 +389,45 @@ void MainWindow::onOpenConnectionDialogFinished(int result)
 void MainWindow::openConnectionToPort(const QString &portName)
 {
     qDebug() << "Connecting to:" << portName;
-    serialPort_->setPortName(portName);
-    serialPort_->setBaudRate(QSerialPort::Baud115200);
-    serialPort_->setDataBits(QSerialPort::Data8);
-    serialPort_->setParity(QSerialPort::NoParity);
-    serialPort_->setStopBits(QSerialPort::OneStop);
-    serialPort_->setFlowControl(QSerialPort::NoFlowControl);
-    if (serialPort_->open(QIODevice::ReadWrite)) {
-        serialPort_->setDataTerminalReady(true);
-        if (densInterface_->connectToDevice(serialPort_)) {
+    if (transport_) { return; }
+
+    QString errorString;
+    transport_ = DensTransport::fromUri(portName, this, &errorString);
+    if (!transport_) {
+        statusLabel_->setText(tr("Open error"));
+        QMessageBox::critical(this, tr("Error"), errorString);
+        return;
+    }
+
+    if (transport_->open()) {
+        if (densInterface_->connectToDevice(transport_)) {
             ui->actionConnect->setEnabled(false);
             ui->actionDisconnect->setEnabled(true);
             statusLabel_->setText(tr("Connected to %1").arg(portName));
+            return;
         } else {
-            serialPort_->close();
             statusLabel_->setText(tr("Unrecognized device"));
             QMessageBox::critical(this, tr("Error"), tr("Unrecognized device"));
         }
     } else {
         statusLabel_->setText(tr("Open error"));
-        QMessageBox::critical(this, tr("Error"), serialPort_->errorString());
+        QMessageBox::critical(this, tr("Error"), transport_->errorString());
     }
+
+    transport_->close();
+    transport_->deleteLater();
+    transport_ = nullptr;
 }
 
 void MainWindow::closeConnection()
 {
     qDebug() << "Close connection";
     densInterface_->disconnectFromDevice();
-    if (serialPort_->isOpen()) {
-        serialPort_->close();
+    if (transport_) {
+        // This may be called from one of the transport's own signals
+        transport_->close();
+        transport_->deleteLater();
+        transport_ = nullptr;
     }
     refreshButtonState();
     ui->actionConnect->setEnabled(true);
@@ -300,8 +443,14 @@ void MainWindow::onImportSettings()
         QString filename = fileDialog.selectedFiles().constFirst();
         if (!filename.isEmpty()) {
             SettingsImportDialog importDialog;
-            if (!importDialog.loadFile(filename)) {
-                QMessageBox::warning(this, tr("Error"), tr("Unable to read settings file"));
+            QString errorString;
+            if (!importDialog.loadFile(filename, &errorString)) {
+                QMessageBox messageBox(this);
+                messageBox.setIcon(QMessageBox::Warning);
+                messageBox.setWindowTitle(tr("Error"));
+                messageBox.setText(tr("Unable to read settings file"));
+                messageBox.setDetailedText(errorString);
+                messageBox.exec();
                 return;
             }
             if (importDialog.exec() == QDialog::Accepted) {
@@ -324,12 +473,19 @@ void MainWindow::onExportSettings()
 {
     SettingsExporter *exporter = new SettingsExporter(densInterface_, this);
     connect(exporter, &SettingsExporter::exportReady, this, [this, exporter]() {
-        QFileDialog fileDialog(this, tr("Save Device Settings"), QString(), tr("Settings File (*.pds)"));
+        // Exact values round-trip to the device without any loss,
+        // while decimal values are easier to read and edit by hand
+        const QString exactFilter = tr("Settings File (*.pds)");
+        const QString decimalFilter = tr("Settings File, decimal values (*.pds)");
+        QFileDialog fileDialog(this, tr("Save Device Settings"), QString(),
+                               exactFilter + QLatin1String(";;") + decimalFilter);
         fileDialog.setDefaultSuffix(".pds");
         fileDialog.setAcceptMode(QFileDialog::AcceptSave);
         if (fileDialog.exec() && !fileDialog.selectedFiles().isEmpty()) {
             QString filename = fileDialog.selectedFiles().constFirst();
             if (!filename.isEmpty()) {
+                exporter->setFloatEncoding(fileDialog.selectedNameFilter() == decimalFilter
+                                           ? SettingsSchema::FloatDecimal : SettingsSchema::FloatExact);
                 exporter->saveExport(filename);
             }
         }
@@ -341,6 +497,499 @@ void MainWindow::onExportSettings()
     exporter->prepareExport();
 }
 
+void MainWindow::onNewWorkspace()
+{
+    if (!workspaceMaybeSave()) { return; }
+
+    autosaveTimer_->stop();
+    workspace_->clear();
+    workspaceShowSession(workspace_->currentSession());
+}
+
+void MainWindow::onOpenWorkspace()
+{
+    if (!workspaceMaybeSave()) { return; }
+
+    QFileDialog fileDialog(this, tr("Open Workspace"), QString(),
+                           tr("Workspace Files (*.pdw);;All Files (*)"));
+    fileDialog.setAcceptMode(QFileDialog::AcceptOpen);
+    if (!fileDialog.exec() || fileDialog.selectedFiles().isEmpty()) { return; }
+    const QString filename = fileDialog.selectedFiles().constFirst();
+    if (filename.isEmpty()) { return; }
+
+    // Only the session index is read here, with each session's
+    // readings loaded when it is first shown
+    QString errorString;
+    if (!workspace_->load(filename, &errorString)) {
+        QMessageBox::warning(this, tr("Error"), tr("Unable to open workspace: %1").arg(errorString));
+        return;
+    }
+    autosaveTimer_->stop();
+    workspaceShowSession(workspace_->currentSession());
+}
+
+bool MainWindow::onSaveWorkspace()
+{
+    if (workspace_->fileName().isEmpty()) {
+        return onSaveWorkspaceAs();
+    }
+
+    QString errorString;
+    if (!workspace_->save(workspace_->fileName(), &errorString)) {
+        QMessageBox::warning(this, tr("Error"), tr("Unable to save workspace: %1").arg(errorString));
+        return false;
+    }
+    autosaveTimer_->stop();
+    workspaceUpdateStatus();
+    return true;
+}
+
+bool MainWindow::onSaveWorkspaceAs()
+{
+    QFileDialog fileDialog(this, tr("Save Workspace"), workspace_->fileName(),
+                           tr("Workspace Files (*.pdw)"));
+    fileDialog.setDefaultSuffix(".pdw");
+    fileDialog.setAcceptMode(QFileDialog::AcceptSave);
+    if (!fileDialog.exec() || fileDialog.selectedFiles().isEmpty()) { return false; }
+    const QString filename = fileDialog.selectedFiles().constFirst();
+    if (filename.isEmpty()) { return false; }
+
+    QString errorString;
+    if (!workspace_->save(filename, &errorString)) {
+        QMessageBox::warning(this, tr("Error"), tr("Unable to save workspace: %1").arg(errorString));
+        return false;
+    }
+    autosaveTimer_->stop();
+    workspaceUpdateStatus();
+    return true;
+}
+
+void MainWindow::onNewSession()
+{
+    bool ok;
+    const QString name = QInputDialog::getText(this, tr("New Session"), tr("Session name:"),
+                                               QLineEdit::Normal,
+                                               tr("Session %1").arg(workspace_->sessionCount() + 1), &ok).trimmed();
+    if (!ok || name.isEmpty()) { return; }
+
+    // The current session already holds the table contents,
+    // since they are stored with every change
+    const int index = workspace_->addSession(name);
+    workspaceShowSession(index);
+    autosaveTimer_->start();
+}
+
+void MainWindow::onRenameSession()
+{
+    const int index = workspace_->currentSession();
+    bool ok;
+    const QString name = QInputDialog::getText(this, tr("Rename Session"), tr("Session name:"),
+                                               QLineEdit::Normal,
+                                               workspace_->sessionName(index), &ok).trimmed();
+    if (!ok || name.isEmpty()) { return; }
+
+    workspace_->renameSession(index, name);
+    workspaceUpdateStatus();
+    autosaveTimer_->start();
+}
+
+void MainWindow::onSessionNotes()
+{
+    QSharedPointer<WorkspaceSession> session = workspace_->session(workspace_->currentSession());
+    if (!session) { return; }
+
+    bool ok;
+    const QString notes = QInputDialog::getMultiLineText(this, tr("Session Notes"),
+                                                         tr("Notes for %1:").arg(session->name),
+                                                         session->notes, &ok);
+    if (!ok || notes == session->notes) { return; }
+
+    session->notes = notes;
+    workspace_->setModified();
+    autosaveTimer_->start();
+}
+
+void MainWindow::onDeleteSession()
+{
+    const int index = workspace_->currentSession();
+    const int readingCount = workspace_->sessionReadingCount(index);
+    if (readingCount > 0) {
+        const QMessageBox::StandardButton result =
+                QMessageBox::question(this, tr("Delete Session"),
+                                      tr("Delete \"%1\" and its %n reading(s)?", nullptr, readingCount)
+                                      .arg(workspace_->sessionName(index)));
+        if (result != QMessageBox::Yes) { return; }
+    }
+
+    workspace_->removeSession(index);
+    workspaceShowSession(workspace_->currentSession());
+    autosaveTimer_->start();
+}
+
+void MainWindow::onMenuSessionAboutToShow()
+{
+    // Replace the list of sessions that follows the fixed menu items
+    const QList<QAction *> actions = ui->menuSession->actions();
+    const int fixedCount = actions.indexOf(ui->actionDeleteSession) + 2;
+    for (int i = fixedCount; i < actions.size(); i++) {
+        ui->menuSession->removeAction(actions.at(i));
+        actions.at(i)->deleteLater();
+    }
+
+    for (int i = 0; i < workspace_->sessionCount(); i++) {
+        QAction *action = ui->menuSession->addAction(
+                    tr("%1 (%n reading(s))", nullptr, workspace_->sessionReadingCount(i))
+                    .arg(workspace_->sessionName(i)));
+        action->setCheckable(true);
+        action->setChecked(i == workspace_->currentSession());
+        connect(action, &QAction::triggered, this, [this, i]() {
+            if (i != workspace_->currentSession()) {
+                workspaceShowSession(i);
+            } else {
+                workspaceUpdateStatus();
+            }
+        });
+    }
+}
+
+void MainWindow::onWorkspaceAutosave()
+{
+    if (!workspace_->isModified()) { return; }
+
+    QString errorString;
+    if (!workspace_->autosave(&errorString)) {
+        ui->statusBar->showMessage(tr("Unable to autosave workspace: %1").arg(errorString), 5000);
+    }
+}
+
+void MainWindow::onWorkspaceRecover()
+{
+    if (!QFile::exists(Workspace::recoveryFileName())) { return; }
+
+    const QMessageBox::StandardButton result =
+            QMessageBox::question(this, tr("Recover Workspace"),
+                                  tr("Measurements from a previous session were not saved. "
+                                     "Do you want to recover them?"));
+    if (result != QMessageBox::Yes) {
+        Workspace::discardRecovery();
+        return;
+    }
+
+    QString errorString;
+    if (!workspace_->recover(&errorString)) {
+        QMessageBox::warning(this, tr("Error"), tr("Unable to recover workspace: %1").arg(errorString));
+        return;
+    }
+    workspaceShowSession(workspace_->currentSession());
+}
+
+bool MainWindow::workspaceMaybeSave()
+{
+    if (!workspace_->isModified()) { return true; }
+
+    const QMessageBox::StandardButton result =
+            QMessageBox::question(this, tr("Save Workspace"),
+                                  tr("The workspace has unsaved changes. Do you want to save them?"),
+                                  QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel,
+                                  QMessageBox::Save);
+    if (result == QMessageBox::Save) {
+        return onSaveWorkspace();
+    } else if (result == QMessageBox::Discard) {
+        autosaveTimer_->stop();
+        Workspace::discardRecovery();
+        return true;
+    }
+    return false;
+}
+
+void MainWindow::workspaceShowSession(int index)
+{
+    QString errorString;
+    QSharedPointer<WorkspaceSession> session = workspace_->session(index, &errorString);
+    if (!session) {
+        QMessageBox::warning(this, tr("Error"), tr("Unable to open session: %1").arg(errorString));
+        workspaceUpdateStatus();
+        return;
+    }
+    workspace_->setCurrentSession(index);
+    measTableAddColumns(session->columns);
+
+    // Pad the stored readings out to a full table, with the
+    // current row following the last reading
+    MeasTableState state;
+    state.rows = session->rows;
+    int used = state.rows.size();
+    while (used > 0 && state.rows.at(used - 1).type.isEmpty() && state.rows.at(used - 1).value.isEmpty()) {
+        used--;
+    }
+    while (state.rows.size() < qMax(MEAS_TABLE_ROWS, used + 1)) {
+        state.rows.append(MeasTableRow());
+    }
+    state.currentRow = used;
+
+    // Undo history only applies to the session it was recorded in
+    measTableRestore(state);
+    measUndoStack_->clear();
+    workspaceUpdateStatus();
+}
+
+void MainWindow::workspaceStoreSession(const MeasTableState &state)
+{
+    QSharedPointer<WorkspaceSession> session = workspace_->session(workspace_->currentSession());
+    if (!session) { return; }
+
+    session->rows = state.rows;
+    session->columns = computedColumns_;
+    workspace_->setModified();
+    if (!autosaveTimer_->isActive()) {
+        autosaveTimer_->start();
+    }
+}
+
+void MainWindow::workspaceNoteDevice()
+{
+    if (!densInterface_->connected()) { return; }
+
+    QSharedPointer<WorkspaceSession> session = workspace_->session(workspace_->currentSession());
+    if (!session) { return; }
+
+    session->deviceName = densInterface_->projectName();
+    session->deviceVersion = densInterface_->version();
+    session->uniqueId = densInterface_->uniqueId();
+    session->calibration = Workspace::calibrationToJson(densInterface_->calGain(), densInterface_->calSlope(),
+                                                        densInterface_->calReflection(), densInterface_->calTransmission());
+}
+
+void MainWindow::workspaceUpdateStatus()
+{
+    const QString workspaceName = workspace_->fileName().isEmpty()
+            ? tr("Untitled")
+            : QFileInfo(workspace_->fileName()).completeBaseName();
+    sessionLabel_->setText(tr("%1: %2").arg(workspaceName, workspace_->sessionName(workspace_->currentSession())));
+}
+
+void MainWindow::onExportMeasurements()
+{
+    const MeasTableState state = measTableCapture();
+    QVector<MeasTableRow> rows;
+    for (const MeasTableRow &rowData : state.rows) {
+        if (!rowData.value.isEmpty()) {
+            rows.append(rowData);
+        }
+    }
+    if (rows.isEmpty()) {
+        QMessageBox::information(this, tr("Export Measurements"), tr("There are no measurements to export."));
+        return;
+    }
+
+    QFileDialog fileDialog(this, tr("Export Measurements"), QString(),
+                           tr("CGATS Files (*.txt *.cgats);;Argyll Files (*.ti3)"));
+    fileDialog.setDefaultSuffix(".txt");
+    fileDialog.setAcceptMode(QFileDialog::AcceptSave);
+    if (!fileDialog.exec() || fileDialog.selectedFiles().isEmpty()) { return; }
+    const QString filename = fileDialog.selectedFiles().constFirst();
+    if (filename.isEmpty()) { return; }
+
+    // Optional fields are only included if every row has a value for them
+    bool hasOffset = false;
+    bool hasUncertainty = true;
+    bool hasRaw = true;
+    for (const MeasTableRow &rowData : qAsConst(rows)) {
+        if (!rowData.offset.isEmpty()) { hasOffset = true; }
+        if (rowData.uncertainty.isEmpty()) { hasUncertainty = false; }
+        if (rowData.raw.isEmpty() || rowData.corrected.isEmpty()) { hasRaw = false; }
+    }
+
+    const bool argyll = QFileInfo(filename).suffix().compare(QLatin1String("ti3"), Qt::CaseInsensitive) == 0;
+    CgatsTable table(argyll ? QStringLiteral("CTI3") : QStringLiteral("CGATS.17"));
+    table.setKeyword("ORIGINATOR", QString("%1 %2").arg(QApplication::applicationName(), QApplication::applicationVersion()));
+    table.setKeyword("DESCRIPTOR", "Density measurements");
+    table.setKeyword("CREATED", QDateTime::currentDateTime().toString(Qt::ISODate));
+    if (densInterface_->connected()) {
+        table.setKeyword("INSTRUMENTATION", densInterface_->projectName());
+        table.setKeyword("SERIAL", densInterface_->uniqueId());
+        table.setKeyword("DEVICE_VERSION", densInterface_->version());
+
+        const DensCalTarget calReflection = densInterface_->calReflection();
+        if (calReflection.isValidReflection()) {
+            table.setKeyword("CAL_REFL_LO_DENSITY", QString::number(calReflection.loDensity(), 'f', 2));
+            table.setKeyword("CAL_REFL_LO_READING", QString::number(calReflection.loReading(), 'f', 6));
+            table.setKeyword("CAL_REFL_HI_DENSITY", QString::number(calReflection.hiDensity(), 'f', 2));
+            table.setKeyword("CAL_REFL_HI_READING", QString::number(calReflection.hiReading(), 'f', 6));
+        }
+        const DensCalTarget calTransmission = densInterface_->calTransmission();
+        if (calTransmission.isValidTransmission()) {
+            table.setKeyword("CAL_TRAN_LO_DENSITY", QString::number(calTransmission.loDensity(), 'f', 2));
+            table.setKeyword("CAL_TRAN_LO_READING", QString::number(calTransmission.loReading(), 'f', 6));
+            table.setKeyword("CAL_TRAN_HI_DENSITY", QString::number(calTransmission.hiDensity(), 'f', 2));
+            table.setKeyword("CAL_TRAN_HI_READING", QString::number(calTransmission.hiReading(), 'f', 6));
+        }
+    }
+
+    QStringList fields;
+    fields << "SAMPLE_ID" << "MEAS_MODE" << "D_VIS";
+    if (hasOffset) { fields << "D_ZERO"; }
+    if (hasUncertainty) { fields << "D_UNCERTAINTY"; }
+    if (hasRaw) { fields << "RAW_READING" << "CORR_READING"; }
+    table.setFields(fields);
+
+    for (int i = 0; i < rows.size(); i++) {
+        const MeasTableRow &rowData = rows.at(i);
+        QStringList values;
+        values << QString::number(i + 1) << rowData.type << rowData.value;
+        if (hasOffset) { values << rowData.offset; }
+        if (hasUncertainty) { values << QString(rowData.uncertainty).remove(QChar(0x00B1)); }
+        if (hasRaw) { values << rowData.raw << rowData.corrected; }
+        table.appendRow(values);
+    }
+
+    QString errorString;
+    if (!CgatsWriter::writeFile(filename, QList<CgatsTable>() << table, &errorString)) {
+        QMessageBox::warning(this, tr("Error"), tr("Unable to write measurements file: %1").arg(errorString));
+    }
+}
+
+void MainWindow::onImportReference()
+{
+    QFileDialog fileDialog(this, tr("Import Reference Values"), QString(),
+                           tr("CGATS Files (*.txt *.cgats *.ti3);;All Files (*)"));
+    fileDialog.setAcceptMode(QFileDialog::AcceptOpen);
+    if (!fileDialog.exec() || fileDialog.selectedFiles().isEmpty()) { return; }
+    const QString filename = fileDialog.selectedFiles().constFirst();
+    if (filename.isEmpty()) { return; }
+
+    QString errorString;
+    const QList<CgatsTable> tables = CgatsReader::readFile(filename, &errorString);
+    if (tables.isEmpty()) {
+        QMessageBox::warning(this, tr("Error"), tr("Unable to read reference file: %1").arg(errorString));
+        return;
+    }
+
+    // Use the first data set that has density values
+    int tableIndex = -1;
+    for (int i = 0; i < tables.size(); i++) {
+        if (tables.at(i).densityField() >= 0) {
+            tableIndex = i;
+            break;
+        }
+    }
+    if (tableIndex < 0) {
+        QMessageBox::warning(this, tr("Error"), tr("Reference file does not contain any density values"));
+        return;
+    }
+    const CgatsTable &table = tables.at(tableIndex);
+    const int field = table.densityField();
+
+    const QString referenceColumn = tr("Reference");
+    const QString differenceColumn = tr("Difference");
+    measTableAddColumns(QStringList() << referenceColumn << differenceColumn);
+
+    // Reference values are matched to table rows in patch order
+    MeasTableState state = measTableCapture();
+    while (state.rows.size() < table.rowCount()) {
+        state.rows.append(MeasTableRow());
+    }
+    for (int row = 0; row < state.rows.size(); row++) {
+        MeasTableRow &rowData = state.rows[row];
+        rowData.computed.remove(referenceColumn);
+        rowData.computed.remove(differenceColumn);
+        if (row >= table.rowCount()) { continue; }
+
+        bool ok;
+        const float reference = table.value(row, field).toFloat(&ok);
+        if (!ok) { continue; }
+        rowData.computed.insert(referenceColumn, QString("%1").arg(reference, 4, 'f', 2));
+
+        const float value = rowData.value.toFloat(&ok);
+        if (ok) {
+            rowData.computed.insert(differenceColumn, QString("%1").arg(value - reference, 4, 'f', 2));
+        }
+    }
+
+    measTableEditing_ = true;
+    if (measModel_->rowCount() < state.rows.size()) {
+        measModel_->insertRows(measModel_->rowCount(), state.rows.size() - measModel_->rowCount());
+    }
+    measTableEditing_ = false;
+    for (int row = 0; row < state.rows.size(); row++) {
+        measTableSetRow(row, state.rows.at(row));
+    }
+
+    measTableRecord(tr("Import Reference Values"));
+}
+
+void MainWindow::onHidTemplate()
+{
+    HidTemplateDialog *dialog = new HidTemplateDialog(densInterface_, this);
+    connect(dialog, &QDialog::finished, dialog, &QObject::deleteLater);
+    dialog->show();
+}
+
+void MainWindow::onMenuSettings()
+{
+    MenuSettingsDialog *dialog = new MenuSettingsDialog(densInterface_, this);
+    connect(dialog, &QDialog::finished, dialog, &QObject::deleteLater);
+    dialog->show();
+}
+
+void MainWindow::onCalProfiles()
+{
+    CalProfilesDialog *dialog = new CalProfilesDialog(densInterface_, this);
+    connect(dialog, &QDialog::finished, dialog, &QObject::deleteLater);
+    dialog->show();
+}
+
+void MainWindow::onCalReport()
+{
+    SettingsExporter *exporter = new SettingsExporter(densInterface_, this);
+    connect(exporter, &SettingsExporter::exportReady, this, [this, exporter]() {
+        exporter->deleteLater();
+
+        CalReport report = CalReport::fromDevice(densInterface_);
+
+        // Verification readings come from measurements with imported reference values
+        const QString referenceColumn = tr("Reference");
+        const MeasTableState state = measTableCapture();
+        QList<CalReportReading> readings;
+        for (const MeasTableRow &rowData : state.rows) {
+            bool targetOk;
+            bool measuredOk;
+            CalReportReading reading;
+            reading.target = rowData.computed.value(referenceColumn).toFloat(&targetOk);
+            reading.measured = rowData.value.toFloat(&measuredOk);
+            if (targetOk && measuredOk) {
+                readings.append(reading);
+            }
+        }
+        report.setReadings(readings);
+
+        QSettings settings;
+        bool ok;
+        const QString operatorName = QInputDialog::getText(this, tr("Calibration Certificate"), tr("Operator:"),
+                                                           QLineEdit::Normal,
+                                                           settings.value("report/operator").toString(), &ok);
+        if (!ok) { return; }
+        settings.setValue("report/operator", operatorName);
+        report.setOperatorName(operatorName);
+
+        QFileDialog fileDialog(this, tr("Save Calibration Certificate"), QString(),
+                               tr("PDF Files (*.pdf);;HTML Files (*.html)"));
+        fileDialog.setDefaultSuffix(".pdf");
+        fileDialog.setAcceptMode(QFileDialog::AcceptSave);
+        if (!fileDialog.exec() || fileDialog.selectedFiles().isEmpty()) { return; }
+        const QString filename = fileDialog.selectedFiles().constFirst();
+
+        QString errorString;
+        if (!report.write(filename, &errorString)) {
+            QMessageBox::warning(this, tr("Error"), tr("Unable to save calibration certificate: %1").arg(errorString));
+        }
+    });
+    connect(exporter, &SettingsExporter::exportFailed, this, [exporter]() {
+        exporter->deleteLater();
+    });
+    exporter->prepareExport();
+}
+
 void MainWindow::onLogger(bool checked)
 {
     if (checked) {
@@ -384,8 +1033,13 @@ void MainWindow::refreshButtonState()
     if (connected) {
         ui->actionImportSettings->setEnabled(true);
         ui->actionExportSettings->setEnabled(true);
+        ui->actionHidTemplate->setEnabled(true);
+        ui->actionMenuSettings->setEnabled(true);
+        ui->actionCalProfiles->setEnabled(true);
+        ui->actionCalReport->setEnabled(true);
         ui->refreshSensorsPushButton->setEnabled(true);
         ui->screenshotButton->setEnabled(true);
+        ui->crashReportPushButton->setEnabled(true);
         ui->remotePushButton->setEnabled(true);
         ui->calGetAllPushButton->setEnabled(true);
         ui->lightGetPushButton->setEnabled(true);
@@ -419,8 +1073,13 @@ void MainWindow::refreshButtonState()
     } else {
         ui->actionImportSettings->setEnabled(false);
         ui->actionExportSettings->setEnabled(false);
+        ui->actionHidTemplate->setEnabled(false);
+        ui->actionMenuSettings->setEnabled(false);
+        ui->actionCalProfiles->setEnabled(false);
+        ui->actionCalReport->setEnabled(false);
         ui->refreshSensorsPushButton->setEnabled(false);
         ui->screenshotButton->setEnabled(false);
+        ui->crashReportPushButton->setEnabled(false);
         ui->remotePushButton->setEnabled(false);
         ui->calGetAllPushButton->setEnabled(false);
         ui->lightGetPushButton->setEnabled(false);
@@ -524,6 +1183,18 @@ void MainWindow::onMenuEditAboutToShow()
     ui->actionDelete->setEnabled(hasDelete);
 }
 
+void MainWindow::onTabChanged(int index)
+{
+    QWidget *widget = ui->tabWidget->widget(index);
+    if (widget == ui->tabMeasurement) {
+        undoGroup_->setActiveStack(measUndoStack_);
+    } else if (widget == ui->tabCalibration) {
+        undoGroup_->setActiveStack(calUndoStack_);
+    } else {
+        undoGroup_->setActiveStack(nullptr);
+    }
+}
+
 void MainWindow::onConnectionOpened()
 {
     qDebug() << "Connection opened";
@@ -555,12 +1226,22 @@ void MainWindow::onConnectionOpened()
     ui->tranHiDensityLineEdit->clear();
     ui->tranHiReadingLineEdit->clear();
 
-    densInterface_->sendSetMeasurementFormat(DensInterface::FormatExtended);
+    // Calibration history is only meaningful for the connected device
+    calUndoStack_->clear();
+
+    densInterface_->sendSetMeasurementFormat(DensInterface::FormatExtendedQuality);
     densInterface_->sendSetAllowUncalibratedMeasurements(true);
     densInterface_->sendGetSystemBuild();
     densInterface_->sendGetSystemDeviceInfo();
     densInterface_->sendGetSystemUID();
+    densInterface_->sendGetSystemAudit();
     densInterface_->sendGetSystemInternalSensors();
+
+    // Calibration values are recorded with each measurement session
+    densInterface_->sendGetCalGain();
+    densInterface_->sendGetCalSlope();
+    densInterface_->sendGetCalReflection();
+    densInterface_->sendGetCalTransmission();
     refreshButtonState();
 
     if (logWindow_->isVisible()) {
@@ -571,6 +1252,7 @@ void MainWindow::onConnectionOpened()
 void MainWindow::onConnectionClosed()
 {
     qDebug() << "Connection closed";
+    calUndoStack_->clear();
     refreshButtonState();
     ui->actionConnect->setEnabled(true);
     ui->actionDisconnect->setEnabled(false);
@@ -592,11 +1274,19 @@ void MainWindow::onConnectionError()
     closeConnection();
 }
 
-void MainWindow::onDensityReading(DensInterface::DensityType type, float dValue, float dZero, float rawValue, float corrValue)
+void MainWindow::onCommandNotSent(DensCommand::CommandType type, DensCommand::CommandCategory category, const QString &action)
 {
-    Q_UNUSED(rawValue)
-    Q_UNUSED(corrValue)
+    Q_UNUSED(type)
+    Q_UNUSED(category)
+
+    // Anything waiting on the response is left as it was, so the
+    // refusal is the only indication that nothing is coming
+    ui->statusBar->showMessage(tr("Unable to send %1 to the device").arg(action), 5000);
+}
 
+void MainWindow::onDensityReading(DensInterface::DensityType type, float dValue, float dZero, float rawValue, float corrValue,
+                                  float dUncertainty, DensInterface::ReadingQuality quality)
+{
     // Update main tab contents
     if (type == DensInterface::DensityReflection) {
         ui->readingTypeLogoLabel->setPixmap(QPixmap(QString::fromUtf8(":/images/reflection-icon.png")));
@@ -629,17 +1319,47 @@ void MainWindow::onDensityReading(DensInterface::DensityType type, float dValue,
         displayValue = 0.0F;
     }
     ui->readingValueLineEdit->setText(QString("%1D").arg(displayValue, 4, 'f', 2));
+    QStringList readingNotes;
+    if (!qIsNaN(dUncertainty)) {
+        readingNotes.append(QString::fromUtf8("\u00B1%1D").arg(dUncertainty, 4, 'f', 3));
+    }
+
+    // The device retries a reading before sending it with any checks failed
+    const QStringList qualityText = DensInterface::readingQualityText(quality);
+    if (!qualityText.isEmpty()) {
+        readingNotes.append(qualityText);
+        ui->readingValueLineEdit->setStyleSheet("QLineEdit { background-color: lightgoldenrodyellow; }");
+        ui->statusBar->showMessage(tr("Reading may be unreliable: %1").arg(qualityText.join(QLatin1String(", "))), 10000);
+    } else {
+        ui->readingValueLineEdit->setStyleSheet(styleSheet());
+    }
+    ui->readingValueLineEdit->setToolTip(readingNotes.join(QLatin1Char('\n')));
 
     // Save values so they can be referenced later
     lastReadingType_ = type;
     lastReadingDensity_ = displayValue;
     lastReadingOffset_ = dZero;
+    lastReadingUncertainty_ = dUncertainty;
+    lastReadingRaw_ = rawValue;
+    lastReadingCorrected_ = corrValue;
+    lastReadingComputed_.clear();
+    pendingAutoAdd_ = false;
     ui->addReadingPushButton->setEnabled(true);
 
+    // Pass the reading through any transform scripts
+    if (readingTransform_->isActive()) {
+        lastReadingSequence_ = readingTransform_->processReading(type, dValue, dZero, rawValue, corrValue, dUncertainty);
+    }
+
     // Update the measurement tab table view, if the tab is focused
     if (ui->tabWidget->currentWidget() == ui->tabMeasurement) {
         if (ui->autoAddPushButton->isChecked()) {
-            onAddReadingClicked();
+            if (readingTransform_->isActive()) {
+                // Wait for the computed columns before adding the reading
+                pendingAutoAdd_ = true;
+            } else {
+                onAddReadingClicked();
+            }
         }
     }
 
@@ -735,28 +1455,99 @@ void MainWindow::onActionDelete()
                 && focusWidget == ui->measTableView
                 && !ui->measTableView->selectionModel()->selectedRows(1).isEmpty()) {
             measTableDelete();
+            measTableRecord(tr("Delete Readings"));
         }
     }
 }
 
-void MainWindow::measTableAddReading(DensInterface::DensityType type, float density, float offset)
+void MainWindow::onReadingTransformed(const TransformReading &reading, const QStringList &columns, const QStringList &values)
 {
+    // Ignore results for readings that have since been replaced
+    if (reading.sequence != lastReadingSequence_) { return; }
 
-    QString numStr = QString("%1").arg(density, 4, 'f', 2);
-    QString typeStr;
-    QIcon typeIcon;
-    QString offsetStr;
+    lastReadingComputed_.clear();
+    for (int i = 0; i < columns.size() && i < values.size(); i++) {
+        lastReadingComputed_.insert(columns.at(i), values.at(i));
+    }
+    measTableAddColumns(columns);
+
+    if (pendingAutoAdd_) {
+        pendingAutoAdd_ = false;
+        onAddReadingClicked();
+    }
+}
+
+void MainWindow::onReadingScriptError(const QString &message)
+{
+    qWarning() << "Reading script error:" << message;
+    logWindow_->appendMessage(tr("script"), message);
+    ui->statusBar->showMessage(tr("Reading script error, see log window"), 5000);
+}
+
+void MainWindow::onReadingScripts()
+{
+    const QStringList fileNames = QFileDialog::getOpenFileNames(this, tr("Load Reading Scripts"),
+                                                                QString(), tr("Scripts (*.js)"));
+    if (fileNames.isEmpty()) { return; }
+
+    readingTransform_->setScripts(fileNames);
+    readingTransform_->saveScripts();
+    ui->actionClearReadingScripts->setEnabled(true);
+}
+
+void MainWindow::onClearReadingScripts()
+{
+    readingTransform_->setScripts(QStringList());
+    readingTransform_->saveScripts();
+    ui->actionClearReadingScripts->setEnabled(false);
+}
+
+void MainWindow::onQcMode()
+{
+    if (!qcDialog_) {
+        qcDialog_ = new QcDialog(this);
+    }
+    qcDialog_->show();
+    qcDialog_->raise();
+    qcDialog_->activateWindow();
+}
+
+void MainWindow::measTableAddReading(DensInterface::DensityType type, float density, float offset, float uncertainty,
+                                     float rawValue, float corrValue,
+                                     const QMap<QString, QString> &computed)
+{
+    MeasTableRow rowData = MeasTableRow();
+    rowData.value = QString("%1").arg(density, 4, 'f', 2);
+    rowData.computed = computed;
 
     if (type == DensInterface::DensityReflection) {
-        typeIcon = QIcon(QString::fromUtf8(":/images/reflection-icon.png"));
-        typeStr = QLatin1String("R");
+        rowData.type = QLatin1String("R");
     } else if (type == DensInterface::DensityTransmission) {
-        typeIcon = QIcon(QString::fromUtf8(":/images/transmission-icon.png"));
-        typeStr = QLatin1String("T");
+        rowData.type = QLatin1String("T");
     }
 
     if (!qIsNaN(offset)) {
-        offsetStr = QString("%1").arg(offset, 4, 'f', 2);
+        rowData.offset = QString("%1").arg(offset, 4, 'f', 2);
+    }
+
+    if (!qIsNaN(rawValue)) {
+        rowData.raw = QString::number(rawValue, 'f');
+    }
+    if (!qIsNaN(corrValue)) {
+        rowData.corrected = QString::number(corrValue, 'f');
+    }
+
+    if (type != DensInterface::DensityUnknown) {
+        rowData.time = QDateTime::currentDateTime();
+        workspaceNoteDevice();
+    }
+
+    if (!qIsNaN(uncertainty)) {
+        rowData.uncertainty = QString::fromUtf8("\u00B1%1").arg(uncertainty, 4, 'f', 3);
+        rowData.flagged = uncertainty > uncertaintyThreshold_;
+        if (rowData.flagged) {
+            rowData.flaggedToolTip = tr("Reading uncertainty is above %1").arg(uncertaintyThreshold_, 4, 'f', 3);
+        }
     }
 
     int row = -1;
@@ -770,24 +1561,14 @@ void MainWindow::measTableAddReading(DensInterface::DensityType type, float dens
     ui->measTableView->selectionModel()->clearSelection();
 
     if (row >= 0) {
-        QStandardItem *typeItem = new QStandardItem(typeIcon, typeStr);
-        typeItem->setSelectable(false);
-        typeItem->setEditable(false);
-        measModel_->setItem(row, 0, typeItem);
-
-        QStandardItem *measItem = new QStandardItem(numStr);
-        measModel_->setItem(row, 1, measItem);
-
-        QStandardItem *offsetItem = new QStandardItem(offsetStr);
-        offsetItem->setSelectable(false);
-        offsetItem->setEditable(false);
-        measModel_->setItem(row, 2, offsetItem);
+        measTableSetRow(row, rowData);
 
         if (row < measModel_->rowCount() - 1) {
             QModelIndex index = measModel_->index(row + 1, 1);
             ui->measTableView->setCurrentIndex(index);
         } else {
             measModel_->insertRow(row + 1);
+            measTableSetRow(row + 1, MeasTableRow());
             QModelIndex index = measModel_->index(row + 1, 1);
             ui->measTableView->setCurrentIndex(index);
         }
@@ -795,10 +1576,173 @@ void MainWindow::measTableAddReading(DensInterface::DensityType type, float dens
     }
 }
 
+void MainWindow::measTableSetRow(int row, const MeasTableRow &rowData)
+{
+    measTableEditing_ = true;
+
+    QIcon typeIcon;
+    if (rowData.type == QLatin1String("R")) {
+        typeIcon = QIcon(QString::fromUtf8(":/images/reflection-icon.png"));
+    } else if (rowData.type == QLatin1String("T")) {
+        typeIcon = QIcon(QString::fromUtf8(":/images/transmission-icon.png"));
+    }
+
+    QStandardItem *typeItem = new QStandardItem(typeIcon, rowData.type);
+    typeItem->setSelectable(false);
+    typeItem->setEditable(false);
+    measModel_->setItem(row, 0, typeItem);
+
+    QStandardItem *measItem = new QStandardItem(rowData.value);
+    measItem->setData(rowData.raw, MEAS_RAW_ROLE);
+    measItem->setData(rowData.corrected, MEAS_CORRECTED_ROLE);
+    measItem->setData(rowData.time, MEAS_TIME_ROLE);
+    if (rowData.flagged) {
+        measItem->setForeground(QBrush(Qt::red));
+        measItem->setToolTip(rowData.flaggedToolTip);
+    }
+    measModel_->setItem(row, 1, measItem);
+
+    QStandardItem *offsetItem = new QStandardItem(rowData.offset);
+    offsetItem->setSelectable(false);
+    offsetItem->setEditable(false);
+    measModel_->setItem(row, 2, offsetItem);
+
+    QStandardItem *uncertaintyItem = new QStandardItem(rowData.uncertainty);
+    uncertaintyItem->setSelectable(false);
+    uncertaintyItem->setEditable(false);
+    if (rowData.flagged) {
+        uncertaintyItem->setForeground(QBrush(Qt::red));
+    }
+    measModel_->setItem(row, 3, uncertaintyItem);
+
+    const QString qcColumn = tr("QC");
+    for (int i = 0; i < computedColumns_.size(); i++) {
+        QStandardItem *computedItem = new QStandardItem(rowData.computed.value(computedColumns_.at(i)));
+        computedItem->setSelectable(false);
+        computedItem->setEditable(false);
+        if (computedColumns_.at(i) == qcColumn) {
+            const QColor statusColor = QcDialog::statusColor(computedItem->text());
+            if (statusColor.isValid()) {
+                computedItem->setForeground(QBrush(statusColor));
+            }
+        }
+        measModel_->setItem(row, MEAS_TABLE_FIXED_COLUMNS + i, computedItem);
+    }
+
+    measTableEditing_ = false;
+}
+
+void MainWindow::measTableAddColumns(const QStringList &columns)
+{
+    for (const QString &column : columns) {
+        if (computedColumns_.contains(column)) { continue; }
+
+        const int col = MEAS_TABLE_FIXED_COLUMNS + computedColumns_.size();
+        computedColumns_.append(column);
+
+        measTableEditing_ = true;
+        measModel_->setColumnCount(col + 1);
+        measModel_->setHorizontalHeaderItem(col, new QStandardItem(column));
+        for (int row = 0; row < measModel_->rowCount(); row++) {
+            QStandardItem *item = new QStandardItem();
+            item->setSelectable(false);
+            item->setEditable(false);
+            measModel_->setItem(row, col, item);
+        }
+        measTableEditing_ = false;
+
+        ui->measTableView->horizontalHeader()->setSectionResizeMode(col, QHeaderView::ResizeToContents);
+    }
+}
+
+MeasTableState MainWindow::measTableCapture() const
+{
+    MeasTableState state;
+    state.currentRow = ui->measTableView->currentIndex().row();
+
+    for (int row = 0; row < measModel_->rowCount(); row++) {
+        MeasTableRow rowData = MeasTableRow();
+        const QStandardItem *item = measModel_->item(row, 0);
+        if (item) { rowData.type = item->text(); }
+
+        item = measModel_->item(row, 1);
+        if (item) {
+            rowData.value = item->text();
+            rowData.raw = item->data(MEAS_RAW_ROLE).toString();
+            rowData.corrected = item->data(MEAS_CORRECTED_ROLE).toString();
+            rowData.time = item->data(MEAS_TIME_ROLE).toDateTime();
+            rowData.flaggedToolTip = item->toolTip();
+            rowData.flagged = !rowData.flaggedToolTip.isEmpty();
+        }
+
+        item = measModel_->item(row, 2);
+        if (item) { rowData.offset = item->text(); }
+
+        item = measModel_->item(row, 3);
+        if (item) { rowData.uncertainty = item->text(); }
+
+        for (int i = 0; i < computedColumns_.size(); i++) {
+            item = measModel_->item(row, MEAS_TABLE_FIXED_COLUMNS + i);
+            if (item && !item->text().isEmpty()) {
+                rowData.computed.insert(computedColumns_.at(i), item->text());
+            }
+        }
+
+        state.rows.append(rowData);
+    }
+
+    return state;
+}
+
+void MainWindow::measTableRestore(const MeasTableState &state)
+{
+    if (measModel_->rowCount() > state.rows.size()) {
+        measModel_->removeRows(state.rows.size(), measModel_->rowCount() - state.rows.size());
+    } else if (measModel_->rowCount() < state.rows.size()) {
+        measModel_->insertRows(measModel_->rowCount(), state.rows.size() - measModel_->rowCount());
+    }
+
+    for (int row = 0; row < state.rows.size(); row++) {
+        measTableSetRow(row, state.rows.at(row));
+    }
+
+    if (state.currentRow >= 0) {
+        ui->measTableView->setCurrentIndex(measModel_->index(state.currentRow, 1));
+    }
+    ui->measTableView->selectionModel()->clearSelection();
+    ui->measTableView->scrollTo(ui->measTableView->currentIndex());
+
+    measTableState_ = state;
+}
+
+void MainWindow::measTableRecord(const QString &text, const QString &mergeKey)
+{
+    const MeasTableState state = measTableCapture();
+    if (state == measTableState_) { return; }
+
+    measUndoStack_->push(new MeasTableCommand(text, measTableState_, state,
+                                              [this](const MeasTableState &restoreState) {
+        measTableRestore(restoreState);
+        workspaceStoreSession(restoreState);
+    }, mergeKey));
+    measTableState_ = state;
+    workspaceStoreSession(state);
+}
+
+void MainWindow::onMeasItemChanged(QStandardItem *item)
+{
+    if (measTableEditing_) { return; }
+
+    // Edits made directly in the table view, with repeated edits
+    // of the same cell undone in one step
+    measTableRecord(tr("Edit Reading"), QString("edit %1,%2").arg(item->row()).arg(item->column()));
+}
+
 void MainWindow::measTableCut()
 {
     measTableCopy();
     measTableDelete();
+    measTableRecord(tr("Cut Readings"));
 }
 
 void MainWindow::measTableCopy()
@@ -878,8 +1822,9 @@ void MainWindow::measTablePaste()
 
     // Add the pasted readings
     for (float num : numList) {
-        measTableAddReading(DensInterface::DensityUnknown, num, qSNaN());
+        measTableAddReading(DensInterface::DensityUnknown, num, qSNaN(), qSNaN());
     }
+    measTableRecord(tr("Paste Readings"));
 }
 
 void MainWindow::measTableDelete()
@@ -887,17 +1832,7 @@ void MainWindow::measTableDelete()
     QModelIndexList selected = ui->measTableView->selectionModel()->selectedRows(1);
 
     for (const QModelIndex &index : qAsConst(selected)) {
-        QStandardItem *item = measModel_->item(index.row(), 0);
-        if (item) {
-            item->setText(QString());
-            item->setIcon(QIcon());
-        }
-
-        item = measModel_->item(index.row(), 1);
-        if (item) { item->setText(QString()); }
-
-        item = measModel_->item(index.row(), 2);
-        if (item) { item->setText(QString()); }
+        measTableSetRow(index.row(), MeasTableRow());
     }
 }
 
@@ -908,7 +1843,22 @@ void MainWindow::onAddReadingClicked()
         return;
     }
 
-    measTableAddReading(lastReadingType_, lastReadingDensity_, lastReadingOffset_);
+    // Readings are evaluated once, as they are added to the table
+    QMap<QString, QString> computed = lastReadingComputed_;
+    if (qcDialog_ && qcDialog_->isActive()) {
+        const QcResult result = qcDialog_->evaluate(lastReadingType_, lastReadingDensity_);
+        if (result.patch >= 0) {
+            const QString patchColumn = tr("Patch");
+            const QString qcColumn = tr("QC");
+            measTableAddColumns(QStringList() << patchColumn << qcColumn);
+            computed.insert(patchColumn, qcDialog_->patchName(result.patch));
+            computed.insert(qcColumn, QcEvaluator::statusText(result.status));
+        }
+    }
+
+    measTableAddReading(lastReadingType_, lastReadingDensity_, lastReadingOffset_, lastReadingUncertainty_,
+                        lastReadingRaw_, lastReadingCorrected_, computed);
+    measTableRecord(tr("Add Reading"));
 }
 
 void MainWindow::onCopyTableClicked()
@@ -930,23 +1880,15 @@ void MainWindow::onClearTableClicked()
     }
 
     for (int row = 0; row < measModel_->rowCount(); row++) {
-        QStandardItem *item = measModel_->item(row, 0);
-        if (item) {
-            item->setText(QString());
-            item->setIcon(QIcon());
-        }
-
-        item = measModel_->item(row, 1);
-        if (item) { item->setText(QString()); }
-
-        item = measModel_->item(row, 2);
-        if (item) { item->setText(QString()); }
+        measTableSetRow(row, MeasTableRow());
     }
 
     QModelIndex index = measModel_->index(0, 1);
     ui->measTableView->setCurrentIndex(index);
     ui->measTableView->selectionModel()->clearSelection();
     ui->measTableView->scrollToTop();
+
+    measTableRecord(tr("Clear Table"));
 }
 
 void MainWindow::onCalGetAllValues()
@@ -971,7 +1913,9 @@ void MainWindow::onCalLightSetClicked()
 
     if (!calLight.isValid()) { return; }
 
-    densInterface_->sendSetCalLight(calLight);
+    calUndoStack_->push(new CalSetCommand<DensCalLight>(
+                            tr("Set Measurement Light"), densInterface_, &DensInterface::sendSetCalLight,
+                            densInterface_->calLight(), calLight));
 }
 
 void MainWindow::onCalGainCalClicked()
@@ -1026,7 +1970,9 @@ void MainWindow::onCalGainSetClicked()
     calSlope.setMax1(ui->max1LineEdit->text().toFloat(&ok));
     if (!ok) { return; }
 
-    densInterface_->sendSetCalGain(calSlope);
+    calUndoStack_->push(new CalSetCommand<DensCalGain>(
+                            tr("Set Sensor Gain"), densInterface_, &DensInterface::sendSetCalGain,
+                            densInterface_->calGain(), calSlope));
 }
 
 void MainWindow::onCalSlopeSetClicked()
@@ -1043,7 +1989,9 @@ void MainWindow::onCalSlopeSetClicked()
     calSlope.setB2(ui->b2LineEdit->text().toFloat(&ok));
     if (!ok) { return; }
 
-    densInterface_->sendSetCalSlope(calSlope);
+    calUndoStack_->push(new CalSetCommand<DensCalSlope>(
+                            tr("Set Slope Calibration"), densInterface_, &DensInterface::sendSetCalSlope,
+                            densInterface_->calSlope(), calSlope));
 }
 
 void MainWindow::onCalReflectionSetClicked()
@@ -1063,7 +2011,9 @@ void MainWindow::onCalReflectionSetClicked()
     calTarget.setHiReading(ui->reflHiReadingLineEdit->text().toFloat(&ok));
     if (!ok) { return; }
 
-    densInterface_->sendSetCalReflection(calTarget);
+    calUndoStack_->push(new CalSetCommand<DensCalTarget>(
+                            tr("Set Reflection Calibration"), densInterface_, &DensInterface::sendSetCalReflection,
+                            densInterface_->calReflection(), calTarget));
 }
 
 void MainWindow::onCalTransmissionSetClicked()
@@ -1082,7 +2032,9 @@ void MainWindow::onCalTransmissionSetClicked()
     calTarget.setHiReading(ui->tranHiReadingLineEdit->text().toFloat(&ok));
     if (!ok) { return; }
 
-    densInterface_->sendSetCalTransmission(calTarget);
+    calUndoStack_->push(new CalSetCommand<DensCalTarget>(
+                            tr("Set Transmission Calibration"), densInterface_, &DensInterface::sendSetCalTransmission,
+                            densInterface_->calTransmission(), calTarget));
 }
 
 void MainWindow::onCalLightTextChanged()
@@ -1243,6 +2195,27 @@ void MainWindow::onSystemInternalSensors()
     ui->mcuTempLabel->setText(tr("Temperature: %1").arg(densInterface_->mcuTemp()));
 }
 
+void MainWindow::onSystemAuditResponse(quint32 count, const QString &hash)
+{
+    const QString uniqueId = densInterface_->uniqueId();
+    if (uniqueId.isEmpty()) { return; }
+
+    if (auditLog_->recordDeviceState(uniqueId, count, hash) == AuditLog::DeviceUntracked) {
+        qWarning() << "Device settings were changed outside the audit log:" << uniqueId;
+        ui->statusBar->showMessage(tr("Device settings were changed outside of this application"), 10000);
+    }
+}
+
+void MainWindow::onSettingsWriteSent(const QString &field, const QString &oldValue, const QString &newValue)
+{
+    auditLog_->recordWrite(densInterface_->uniqueId(), field, oldValue, newValue);
+
+    // Gain measurement writes its results when it finishes
+    if (!newValue.startsWith(QLatin1String("MEASURE"))) {
+        auditSyncTimer_->start();
+    }
+}
+
 void MainWindow::onDiagDisplayScreenshot(const QByteArray &data)
 {
     qDebug() << "Got screenshot:" << data.size();
@@ -1264,6 +2237,56 @@ void MainWindow::onDiagDisplayScreenshot(const QByteArray &data)
     }
 }
 
+void MainWindow::onDiagCrashRecord(const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        QMessageBox::information(this, tr("Crash Report"), tr("The device does not have a crash record."));
+        return;
+    }
+
+    CrashReport report = CrashReport::fromRecord(data);
+    if (!report.isValid()) {
+        QMessageBox::warning(this, tr("Crash Report"), tr("The crash record from the device could not be decoded."));
+        return;
+    }
+
+    // Symbolizing addresses is optional, so the user may cancel this
+    QString elfFile = QFileDialog::getOpenFileName(this, tr("Select Firmware ELF File"),
+                                                   QString(),
+                                                   tr("ELF files (*.elf)"));
+    if (!elfFile.isEmpty() && !CrashReport::elfMatchesBuild(elfFile, densInterface_->buildDescribe())) {
+        QMessageBox::warning(this, tr("Crash Report"),
+                             tr("The selected ELF file does not match the firmware build on the device, "
+                                "so addresses will not be symbolized."));
+        elfFile.clear();
+    }
+
+    const QString text = report.toText(densInterface_->buildDescribe(), densInterface_->buildChecksum(), elfFile);
+
+    QMessageBox messageBox(this);
+    messageBox.setIcon(QMessageBox::Warning);
+    messageBox.setWindowTitle(tr("Crash Report"));
+    messageBox.setText(tr("%1 in task \"%2\"").arg(report.typeName(), report.taskName()));
+    messageBox.setDetailedText(text);
+    messageBox.setStandardButtons(QMessageBox::Save | QMessageBox::Close);
+    messageBox.setDefaultButton(QMessageBox::Save);
+
+    if (messageBox.exec() == QMessageBox::Save) {
+        QString fileName = QFileDialog::getSaveFileName(this, tr("Save Crash Report"),
+                                                        "crash-report.txt",
+                                                        tr("Text files (*.txt)"));
+        if (!fileName.isEmpty()) {
+            QFile file(fileName);
+            if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                file.write(text.toUtf8());
+                qDebug() << "Saved crash report to:" << fileName;
+            } else {
+                qDebug() << "Error saving crash report to:" << fileName;
+            }
+        }
+    }
+}
+
 void MainWindow::onCalLightResponse()
 {
     const DensCalLight calLight = densInterface_->calLight();
@@ -4,20 +4,28 @@
 #include <QMainWindow>
 #include <QAbstractItemModel>
 #include "densinterface.h"
+#include "undocommands.h"
+#include "readingtransform.h"
 
 QT_BEGIN_NAMESPACE
 
 class QLabel;
-class QSerialPort;
 class QLineEdit;
 class QSpinBox;
+class QStandardItem;
 class QStandardItemModel;
+class QUndoGroup;
+class QUndoStack;
 
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
 class LogWindow;
 class RemoteControlDialog;
+class QcDialog;
+class AuditLog;
+class Workspace;
+class QTimer;
 
 class MainWindow : public QMainWindow
 {
@@ -29,24 +37,52 @@ public:
 
     void connectToPort(const QString &portName);
 
+protected:
+    void closeEvent(QCloseEvent *event) override;
+
 private slots:
     void openConnection();
     void onOpenConnectionDialogFinished(int result);
     void closeConnection();
     void onImportSettings();
     void onExportSettings();
+    void onNewWorkspace();
+    void onOpenWorkspace();
+    bool onSaveWorkspace();
+    bool onSaveWorkspaceAs();
+    void onNewSession();
+    void onRenameSession();
+    void onSessionNotes();
+    void onDeleteSession();
+    void onMenuSessionAboutToShow();
+    void onWorkspaceAutosave();
+    void onWorkspaceRecover();
+    void onExportMeasurements();
+    void onImportReference();
+    void onHidTemplate();
+    void onMenuSettings();
+    void onCalProfiles();
+    void onCalReport();
+    void onReadingScripts();
+    void onClearReadingScripts();
+    void onQcMode();
     void onLogger(bool checked);
     void onLoggerOpened();
     void onLoggerClosed();
     void about();
 
     void onMenuEditAboutToShow();
+    void onTabChanged(int index);
 
     void onConnectionOpened();
     void onConnectionClosed();
     void onConnectionError();
+    void onCommandNotSent(DensCommand::CommandType type, DensCommand::CommandCategory category, const QString &action);
 
-    void onDensityReading(DensInterface::DensityType type, float dValue, float dZero, float rawValue, float corrValue);
+    void onDensityReading(DensInterface::DensityType type, float dValue, float dZero, float rawValue, float corrValue,
+                          float dUncertainty, DensInterface::ReadingQuality quality);
+    void onReadingTransformed(const TransformReading &reading, const QStringList &columns, const QStringList &values);
+    void onReadingScriptError(const QString &message);
 
     void onActionCut();
     void onActionCopy();
@@ -56,6 +92,7 @@ private slots:
     void onAddReadingClicked();
     void onCopyTableClicked();
     void onClearTableClicked();
+    void onMeasItemChanged(QStandardItem *item);
 
     void onCalGetAllValues();
     void onCalLightSetClicked();
@@ -76,8 +113,11 @@ private slots:
     void onSystemDeviceResponse();
     void onSystemUniqueId();
     void onSystemInternalSensors();
+    void onSystemAuditResponse(quint32 count, const QString &hash);
+    void onSettingsWriteSent(const QString &field, const QString &oldValue, const QString &newValue);
 
     void onDiagDisplayScreenshot(const QByteArray &data);
+    void onDiagCrashRecord(const QByteArray &data);
 
     void onCalLightResponse();
     void onCalGainResponse();
@@ -96,23 +136,55 @@ private:
     void refreshButtonState();
     void updateLineEditDirtyState(QLineEdit *lineEdit, int value);
     void updateLineEditDirtyState(QLineEdit *lineEdit, float value, int prec);
-    void measTableAddReading(DensInterface::DensityType type, float density, float offset);
+    void measTableAddReading(DensInterface::DensityType type, float density, float offset, float uncertainty,
+                             float rawValue = qSNaN(), float corrValue = qSNaN(),
+                             const QMap<QString, QString> &computed = QMap<QString, QString>());
+    void measTableAddColumns(const QStringList &columns);
     void measTableCut();
     void measTableCopy();
     void measTableCopyList(const QModelIndexList &indexList, bool includeEmpty);
     void measTablePaste();
     void measTableDelete();
+    void measTableSetRow(int row, const MeasTableRow &rowData);
+    MeasTableState measTableCapture() const;
+    void measTableRestore(const MeasTableState &state);
+    void measTableRecord(const QString &text, const QString &mergeKey = QString());
+    bool workspaceMaybeSave();
+    void workspaceShowSession(int index);
+    void workspaceStoreSession(const MeasTableState &state);
+    void workspaceNoteDevice();
+    void workspaceUpdateStatus();
 
     Ui::MainWindow *ui = nullptr;
     QLabel *statusLabel_ = nullptr;
-    QSerialPort *serialPort_ = nullptr;
+    QLabel *sessionLabel_ = nullptr;
+    DensTransport *transport_ = nullptr;
     DensInterface *densInterface_ = nullptr;
     LogWindow *logWindow_ = nullptr;
     QStandardItemModel *measModel_ = nullptr;
+    QUndoGroup *undoGroup_ = nullptr;
+    QUndoStack *measUndoStack_ = nullptr;
+    QUndoStack *calUndoStack_ = nullptr;
+    MeasTableState measTableState_;
+    bool measTableEditing_ = false;
     RemoteControlDialog *remoteDialog_ = nullptr;
+    QcDialog *qcDialog_ = nullptr;
+    ReadingTransform *readingTransform_ = nullptr;
+    AuditLog *auditLog_ = nullptr;
+    QTimer *auditSyncTimer_ = nullptr;
+    Workspace *workspace_ = nullptr;
+    QTimer *autosaveTimer_ = nullptr;
+    QStringList computedColumns_;
     DensInterface::DensityType lastReadingType_ = DensInterface::DensityUnknown;
     float lastReadingDensity_ = qSNaN();
     float lastReadingOffset_ = qSNaN();
+    float lastReadingUncertainty_ = qSNaN();
+    float lastReadingRaw_ = qSNaN();
+    float lastReadingCorrected_ = qSNaN();
+    QMap<QString, QString> lastReadingComputed_;
+    quint64 lastReadingSequence_ = 0;
+    bool pendingAutoAdd_ = false;
+    float uncertaintyThreshold_ = 0.0F;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,215 @@
+#include "menusettingsdialog.h"
+#include "ui_menusettingsdialog.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QFormLayout>
+#include <QGroupBox>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSignalBlocker>
+#include <QSpinBox>
+
+MenuSettingsDialog::MenuSettingsDialog(DensInterface *densInterface, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::MenuSettingsDialog),
+    densInterface_(densInterface),
+    settingCount_(0),
+    loading_(false),
+    pendingIndex_(-1)
+{
+    ui->setupUi(this);
+
+    connect(densInterface_, &DensInterface::systemMenuSettingCountResponse, this, &MenuSettingsDialog::onSystemMenuSettingCountResponse);
+    connect(densInterface_, &DensInterface::systemMenuSettingResponse, this, &MenuSettingsDialog::onSystemMenuSettingResponse);
+    connect(densInterface_, &DensInterface::systemMenuSettingChoicesResponse, this, &MenuSettingsDialog::onSystemMenuSettingChoicesResponse);
+    connect(densInterface_, &DensInterface::systemMenuSettingSetComplete, this, &MenuSettingsDialog::onSystemMenuSettingSetComplete);
+
+    connect(ui->refreshPushButton, &QPushButton::clicked, this, &MenuSettingsDialog::onRefreshClicked);
+
+    onRefreshClicked();
+}
+
+MenuSettingsDialog::~MenuSettingsDialog()
+{
+    delete ui;
+}
+
+void MenuSettingsDialog::onRefreshClicked()
+{
+    if (!densInterface_->connected()) { return; }
+
+    clearForm();
+    loading_ = true;
+    ui->refreshPushButton->setEnabled(false);
+    if (!densInterface_->sendGetSystemMenuSettingCount()) {
+        stopLoading();
+    }
+}
+
+void MenuSettingsDialog::onSystemMenuSettingCountResponse(int count)
+{
+    if (!loading_) { return; }
+
+    settingCount_ = count;
+    if (settingCount_ <= 0 || !densInterface_->sendGetSystemMenuSetting(0)) {
+        stopLoading();
+    }
+}
+
+void MenuSettingsDialog::onSystemMenuSettingResponse(const DensMenuSetting &setting)
+{
+    if (setting.index < 0) { return; }
+
+    settings_.insert(setting.index, setting);
+
+    if (loading_) {
+        // Descriptors are requested one at a time, followed by their choices
+        if (!densInterface_->sendGetSystemMenuSettingChoices(setting.index)) {
+            stopLoading();
+        }
+    } else {
+        updateSettingWidget(setting);
+    }
+}
+
+void MenuSettingsDialog::onSystemMenuSettingChoicesResponse(int index, const DensMenuSettingChoices &choices)
+{
+    if (!loading_ || !settings_.contains(index)) { return; }
+
+    addSettingWidget(settings_.value(index), choices);
+
+    if (index + 1 >= settingCount_ || !densInterface_->sendGetSystemMenuSetting(index + 1)) {
+        stopLoading();
+    }
+}
+
+void MenuSettingsDialog::onSystemMenuSettingSetComplete(bool success)
+{
+    if (pendingIndex_ < 0) { return; }
+
+    if (!success) {
+        QMessageBox::warning(this, tr("Error"), tr("The device did not accept the setting"));
+    }
+
+    // Read back the setting, so the form shows the value that was actually saved
+    const int index = pendingIndex_;
+    pendingIndex_ = -1;
+    if (!densInterface_->sendGetSystemMenuSetting(index)) {
+        updateSettingWidget(settings_.value(index));
+    }
+}
+
+void MenuSettingsDialog::stopLoading()
+{
+    loading_ = false;
+    ui->refreshPushButton->setEnabled(true);
+}
+
+
+void MenuSettingsDialog::clearForm()
+{
+    qDeleteAll(settingWidgets_);
+    settingWidgets_.clear();
+
+    for (QFormLayout *layout : qAsConst(groupLayouts_)) {
+        delete layout->parentWidget();
+    }
+    groupLayouts_.clear();
+
+    settings_.clear();
+    settingCount_ = 0;
+    pendingIndex_ = -1;
+}
+
+void MenuSettingsDialog::addSettingWidget(const DensMenuSetting &setting, const DensMenuSettingChoices &choices)
+{
+    QFormLayout *layout = groupLayouts_.value(setting.group);
+    if (!layout) {
+        QGroupBox *groupBox = new QGroupBox(setting.group, ui->scrollAreaWidgetContents);
+        layout = new QFormLayout(groupBox);
+        ui->settingsLayout->insertWidget(ui->settingsLayout->count() - 1, groupBox);
+        groupLayouts_.insert(setting.group, layout);
+    }
+
+    QWidget *widget;
+    if (setting.isBool) {
+        QCheckBox *checkBox = new QCheckBox(layout->parentWidget());
+        connect(checkBox, &QCheckBox::toggled, this, [this, setting](bool checked) {
+            setSettingValue(setting.index, checked ? 1 : 0);
+        });
+        widget = checkBox;
+    } else if (setting.isRange) {
+        QSpinBox *spinBox = new QSpinBox(layout->parentWidget());
+        spinBox->setRange(setting.minimum, setting.maximum);
+        spinBox->setSingleStep(setting.step);
+        spinBox->setSuffix(setting.unit);
+        spinBox->setKeyboardTracking(false);
+        for (const QPair<int, QString> &choice : choices) {
+            // Only the minimum can be shown as text by a spin box
+            if (choice.first == setting.minimum) {
+                spinBox->setSpecialValueText(choice.second);
+            }
+        }
+        connect(spinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, [this, setting](int value) {
+            // Typed values are rounded to the nearest step the device accepts
+            int steps = qRound(static_cast<double>(value - setting.minimum) / setting.step);
+            setSettingValue(setting.index, qMin(setting.minimum + (steps * setting.step), setting.maximum));
+        });
+        widget = spinBox;
+    } else {
+        QComboBox *comboBox = new QComboBox(layout->parentWidget());
+        for (const QPair<int, QString> &choice : choices) {
+            comboBox->addItem(choice.second, choice.first);
+        }
+        connect(comboBox, QOverload<int>::of(&QComboBox::activated), this, [this, setting, comboBox](int index) {
+            setSettingValue(setting.index, comboBox->itemData(index).toInt());
+        });
+        widget = comboBox;
+    }
+
+    layout->addRow(setting.name, widget);
+    settingWidgets_.insert(setting.index, widget);
+    updateSettingWidget(setting);
+}
+
+void MenuSettingsDialog::updateSettingWidget(const DensMenuSetting &setting)
+{
+    QWidget *widget = settingWidgets_.value(setting.index);
+    if (!widget) { return; }
+
+    const QSignalBlocker blocker(widget);
+    if (QCheckBox *checkBox = qobject_cast<QCheckBox *>(widget)) {
+        checkBox->setChecked(setting.value != 0);
+    } else if (QSpinBox *spinBox = qobject_cast<QSpinBox *>(widget)) {
+        spinBox->setValue(setting.value);
+    } else if (QComboBox *comboBox = qobject_cast<QComboBox *>(widget)) {
+        int index = comboBox->findData(setting.value);
+        if (index < 0) {
+            // The saved value is not one of the listed choices
+            comboBox->addItem(QString::number(setting.value), setting.value);
+            index = comboBox->count() - 1;
+        }
+        comboBox->setCurrentIndex(index);
+    }
+    widget->setEnabled(true);
+}
+
+void MenuSettingsDialog::setSettingValue(int index, int value)
+{
+    if (!settings_.contains(index) || pendingIndex_ >= 0) { return; }
+
+    QWidget *widget = settingWidgets_.value(index);
+    if (widget) {
+        widget->setEnabled(false);
+    }
+
+    pendingIndex_ = index;
+    if (!densInterface_->sendSetSystemMenuSetting(settings_.value(index).key, value)) {
+        // Nothing will be read back, so the widget still shows the value
+        // that was not sent
+        pendingIndex_ = -1;
+        updateSettingWidget(settings_.value(index));
+        QMessageBox::warning(this, tr("Error"), tr("Unable to send the setting to the device"));
+    }
+}
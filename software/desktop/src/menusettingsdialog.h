@@ -0,0 +1,51 @@
+#ifndef MENUSETTINGSDIALOG_H
+#define MENUSETTINGSDIALOG_H
+
+#include <QDialog>
+#include <QMap>
+#include "densinterface.h"
+
+namespace Ui {
+class MenuSettingsDialog;
+}
+
+class QFormLayout;
+
+/**
+ * Editor for the settings that can be changed from the device menu,
+ * with a form that is generated from the setting descriptors
+ * reported by the device.
+ */
+class MenuSettingsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit MenuSettingsDialog(DensInterface *densInterface, QWidget *parent = nullptr);
+    ~MenuSettingsDialog();
+
+private slots:
+    void onRefreshClicked();
+    void onSystemMenuSettingCountResponse(int count);
+    void onSystemMenuSettingResponse(const DensMenuSetting &setting);
+    void onSystemMenuSettingChoicesResponse(int index, const DensMenuSettingChoices &choices);
+    void onSystemMenuSettingSetComplete(bool success);
+
+private:
+    void stopLoading();
+    void clearForm();
+    void addSettingWidget(const DensMenuSetting &setting, const DensMenuSettingChoices &choices);
+    void updateSettingWidget(const DensMenuSetting &setting);
+    void setSettingValue(int index, int value);
+
+    Ui::MenuSettingsDialog *ui;
+    DensInterface *densInterface_;
+    int settingCount_;
+    bool loading_;
+    int pendingIndex_;
+    QMap<int, DensMenuSetting> settings_;
+    QMap<int, QWidget *> settingWidgets_;
+    QMap<QString, QFormLayout *> groupLayouts_;
+};
+
+#endif // MENUSETTINGSDIALOG_H
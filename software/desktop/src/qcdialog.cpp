@@ -0,0 +1,270 @@
+#include "qcdialog.h"
+#include "ui_qcdialog.h"
+
+#include <QApplication>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QDebug>
+
+#include "cgats.h"
+
+namespace
+{
+static const int COL_PATCH = 0;
+static const int COL_MODE = 1;
+static const int COL_TARGET = 2;
+static const int COL_TOLERANCE = 3;
+static const int COL_COUNT = 4;
+static const int COL_MEAN = 5;
+static const int COL_STDDEV = 6;
+static const int COL_CPK = 7;
+static const int COL_TREND = 8;
+static const int COL_PASS = 9;
+static const int COL_WARN = 10;
+static const int COL_FAIL = 11;
+static const int COL_LAST = 12;
+static const int COL_MAX = 13;
+
+QString formatValue(float value, int prec)
+{
+    return qIsNaN(value) ? QString() : QString::number(value, 'f', prec);
+}
+
+QTableWidgetItem *tableItem(const QString &text)
+{
+    QTableWidgetItem *item = new QTableWidgetItem(text);
+    item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+    return item;
+}
+}
+
+QcDialog::QcDialog(QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::QcDialog),
+    updatingSelection_(false)
+{
+    ui->setupUi(this);
+
+    ui->patchesTableWidget->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui->patchesTableWidget->horizontalHeader()->setSectionResizeMode(COL_PATCH, QHeaderView::Stretch);
+
+    connect(ui->loadSpecPushButton, &QPushButton::clicked, this, &QcDialog::onLoadSpecClicked);
+    connect(ui->matchingComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &QcDialog::onMatchingChanged);
+    connect(ui->patchesTableWidget, &QTableWidget::itemSelectionChanged, this, &QcDialog::onPatchSelectionChanged);
+    connect(ui->resetPushButton, &QPushButton::clicked, this, &QcDialog::onResetClicked);
+    connect(ui->reportPushButton, &QPushButton::clicked, this, &QcDialog::onReportClicked);
+
+    ui->resetPushButton->setEnabled(false);
+    ui->reportPushButton->setEnabled(false);
+}
+
+QcDialog::~QcDialog()
+{
+    delete ui;
+}
+
+bool QcDialog::isActive() const
+{
+    return isVisible() && ui->enabledCheckBox->isChecked() && evaluator_.hasSpec();
+}
+
+QcResult QcDialog::evaluate(DensInterface::DensityType type, float density)
+{
+    QString mode;
+    if (type == DensInterface::DensityReflection) {
+        mode = QLatin1String("R");
+    } else if (type == DensInterface::DensityTransmission) {
+        mode = QLatin1String("T");
+    }
+
+    // Only the row of the evaluated patch needs to be refreshed,
+    // since the statistics of every other patch are unchanged
+    const QcResult result = evaluator_.evaluate(mode, density);
+    if (result.patch >= 0) {
+        lastResults_[result.patch] = result;
+        updatePatchRow(result.patch);
+        updateCurrentPatch();
+        ui->reportPushButton->setEnabled(true);
+    }
+    return result;
+}
+
+QString QcDialog::patchName(int index) const
+{
+    return evaluator_.patches().value(index).name;
+}
+
+QColor QcDialog::statusColor(const QString &statusText)
+{
+    if (statusText == QcEvaluator::statusText(QcResult::Pass)) {
+        return QColor(Qt::darkGreen);
+    } else if (statusText == QcEvaluator::statusText(QcResult::Warn)) {
+        return QColor(0xE0, 0x80, 0x00);
+    } else if (statusText.startsWith(QcEvaluator::statusText(QcResult::Fail))) {
+        return QColor(Qt::red);
+    } else {
+        return QColor();
+    }
+}
+
+void QcDialog::onLoadSpecClicked()
+{
+    QFileDialog fileDialog(this, tr("Load QC Spec"), QString(),
+                           tr("CGATS Files (*.txt *.cgats *.ti3);;All Files (*)"));
+    fileDialog.setAcceptMode(QFileDialog::AcceptOpen);
+    if (!fileDialog.exec() || fileDialog.selectedFiles().isEmpty()) { return; }
+    const QString filename = fileDialog.selectedFiles().constFirst();
+    if (filename.isEmpty()) { return; }
+
+    QString errorString;
+    const QList<QcPatch> patches = QcEvaluator::loadSpec(filename, &errorString);
+    if (patches.isEmpty()) {
+        QMessageBox::warning(this, tr("Error"), tr("Unable to load QC spec: %1").arg(errorString));
+        return;
+    }
+
+    evaluator_.setSpec(patches);
+    specFileName_ = filename;
+    ui->specLabel->setText(tr("%1 (%n patch(es))", nullptr, patches.size()).arg(QFileInfo(filename).fileName()));
+    populatePatches();
+}
+
+void QcDialog::onMatchingChanged(int index)
+{
+    evaluator_.setMatching(index == 1 ? QcEvaluator::MatchSelected : QcEvaluator::MatchSequence);
+}
+
+void QcDialog::onPatchSelectionChanged()
+{
+    if (updatingSelection_) { return; }
+
+    // Selecting a patch sets the patch for the next reading,
+    // which also restarts a sequence from that point
+    const QList<QTableWidgetItem *> selected = ui->patchesTableWidget->selectedItems();
+    if (!selected.isEmpty()) {
+        evaluator_.setCurrentPatch(selected.first()->row());
+    }
+}
+
+void QcDialog::onResetClicked()
+{
+    if (!evaluator_.records().isEmpty()) {
+        const QMessageBox::StandardButton result =
+                QMessageBox::question(this, tr("New Batch"),
+                                      tr("Clear the statistics of the current batch?"));
+        if (result != QMessageBox::Yes) { return; }
+    }
+
+    evaluator_.reset();
+    populatePatches();
+}
+
+void QcDialog::onReportClicked()
+{
+    QFileDialog fileDialog(this, tr("Save QC Report"), QString(),
+                           tr("CGATS Files (*.txt *.cgats)"));
+    fileDialog.setDefaultSuffix(".txt");
+    fileDialog.setAcceptMode(QFileDialog::AcceptSave);
+    if (!fileDialog.exec() || fileDialog.selectedFiles().isEmpty()) { return; }
+    const QString filename = fileDialog.selectedFiles().constFirst();
+    if (filename.isEmpty()) { return; }
+
+    const QString originator = QString("%1 %2").arg(QApplication::applicationName(), QApplication::applicationVersion());
+    CgatsTable summary = evaluator_.summaryTable();
+    summary.setKeyword("ORIGINATOR", originator);
+    summary.setKeyword("QC_SPEC", QFileInfo(specFileName_).fileName());
+    CgatsTable readings = evaluator_.readingsTable();
+    readings.setKeyword("ORIGINATOR", originator);
+
+    QString errorString;
+    if (!CgatsWriter::writeFile(filename, QList<CgatsTable>() << summary << readings, &errorString)) {
+        QMessageBox::warning(this, tr("Error"), tr("Unable to write QC report: %1").arg(errorString));
+    }
+}
+
+void QcDialog::populatePatches()
+{
+    const QList<QcPatch> patches = evaluator_.patches();
+    lastResults_ = QVector<QcResult>(patches.size());
+
+    updatingSelection_ = true;
+    ui->patchesTableWidget->clearContents();
+    ui->patchesTableWidget->setRowCount(patches.size());
+    for (int i = 0; i < patches.size(); i++) {
+        const QcPatch &patch = patches.at(i);
+
+        QString tolerance;
+        if (qFuzzyCompare(patch.tolMinus, patch.tolPlus)) {
+            tolerance = QString::fromUtf8("±%1").arg(patch.tolPlus, 4, 'f', 2);
+        } else {
+            tolerance = QString("-%1/+%2").arg(patch.tolMinus, 4, 'f', 2).arg(patch.tolPlus, 4, 'f', 2);
+        }
+
+        ui->patchesTableWidget->setItem(i, COL_PATCH, tableItem(patch.name));
+        ui->patchesTableWidget->setItem(i, COL_MODE, tableItem(patch.mode));
+        ui->patchesTableWidget->setItem(i, COL_TARGET, tableItem(formatValue(patch.target, 2)));
+        ui->patchesTableWidget->setItem(i, COL_TOLERANCE, tableItem(tolerance));
+        for (int col = COL_COUNT; col < COL_MAX; col++) {
+            ui->patchesTableWidget->setItem(i, col, tableItem(QString()));
+        }
+        updatePatchRow(i);
+    }
+    updatingSelection_ = false;
+
+    ui->resetPushButton->setEnabled(!patches.isEmpty());
+    ui->reportPushButton->setEnabled(false);
+    updateCurrentPatch();
+}
+
+void QcDialog::updatePatchRow(int index)
+{
+    const QcPatch patch = evaluator_.patches().value(index);
+    const QcPatchStats &stats = evaluator_.stats(index);
+    QTableWidget *table = ui->patchesTableWidget;
+
+    table->item(index, COL_COUNT)->setText(QString::number(stats.count()));
+    table->item(index, COL_MEAN)->setText(formatValue(stats.mean(), 3));
+    table->item(index, COL_STDDEV)->setText(formatValue(stats.stddev(), 4));
+    table->item(index, COL_CPK)->setText(formatValue(stats.cpk(patch.lowerLimit(), patch.upperLimit()), 2));
+    table->item(index, COL_TREND)->setText(formatValue(stats.trend(), 4));
+    table->item(index, COL_PASS)->setText(QString::number(evaluator_.statusCount(index, QcResult::Pass)));
+    table->item(index, COL_WARN)->setText(QString::number(evaluator_.statusCount(index, QcResult::Warn)));
+    table->item(index, COL_FAIL)->setText(QString::number(evaluator_.statusCount(index, QcResult::Fail)));
+
+    QTableWidgetItem *lastItem = table->item(index, COL_LAST);
+    const QcResult &last = lastResults_.at(index);
+    if (last.patch < 0) {
+        lastItem->setText(QString());
+        lastItem->setToolTip(QString());
+    } else {
+        const QString statusText = QcEvaluator::statusText(last.status);
+        lastItem->setText(QString("%1 (%2)").arg(statusText).arg(last.deviation, 0, 'f', 2));
+        lastItem->setForeground(statusColor(statusText));
+        lastItem->setToolTip(last.modeMismatch ? tr("Reading was taken in the wrong measurement mode") : QString());
+    }
+}
+
+void QcDialog::updateCurrentPatch()
+{
+    const int current = evaluator_.currentPatch();
+    QTableWidget *table = ui->patchesTableWidget;
+
+    // The next patch to be measured is shown in bold
+    for (int row = 0; row < table->rowCount(); row++) {
+        QTableWidgetItem *item = table->item(row, COL_PATCH);
+        QFont font = item->font();
+        if (font.bold() != (row == current)) {
+            font.setBold(row == current);
+            item->setFont(font);
+        }
+    }
+
+    if (current < table->rowCount()) {
+        updatingSelection_ = true;
+        table->selectRow(current);
+        table->scrollToItem(table->item(current, COL_PATCH));
+        updatingSelection_ = false;
+    }
+}
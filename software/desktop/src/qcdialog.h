@@ -0,0 +1,56 @@
+#ifndef QCDIALOG_H
+#define QCDIALOG_H
+
+#include <QDialog>
+#include <QColor>
+#include "densinterface.h"
+#include "qcevaluator.h"
+
+namespace Ui {
+class QcDialog;
+}
+
+/**
+ * Tolerance based QC mode, which evaluates readings against a loaded
+ * target spec as they are added to the measurement table, and shows
+ * running statistics for each patch of the spec.
+ */
+class QcDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit QcDialog(QWidget *parent = nullptr);
+    ~QcDialog();
+
+    /** Whether readings should currently be evaluated */
+    bool isActive() const;
+
+    /** Evaluate a reading, and update the statistics of its patch */
+    QcResult evaluate(DensInterface::DensityType type, float density);
+
+    QString patchName(int index) const;
+
+    /** Colour for a status in the text form used in the measurement table */
+    static QColor statusColor(const QString &statusText);
+
+private slots:
+    void onLoadSpecClicked();
+    void onMatchingChanged(int index);
+    void onPatchSelectionChanged();
+    void onResetClicked();
+    void onReportClicked();
+
+private:
+    void populatePatches();
+    void updatePatchRow(int index);
+    void updateCurrentPatch();
+
+    Ui::QcDialog *ui;
+    QcEvaluator evaluator_;
+    QString specFileName_;
+    QVector<QcResult> lastResults_;
+    bool updatingSelection_;
+};
+
+#endif // QCDIALOG_H
@@ -0,0 +1,389 @@
+#include "qcevaluator.h"
+
+#include <QtMath>
+#include <limits>
+
+#include "cgats.h"
+
+namespace
+{
+int findField(const CgatsTable &table, const QStringList &names)
+{
+    for (const QString &name : names) {
+        const int index = table.fieldIndex(name);
+        if (index >= 0) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+float parseValue(const CgatsTable &table, int row, int field, float defaultValue)
+{
+    if (field < 0) { return defaultValue; }
+    bool ok;
+    const float value = table.value(row, field).toFloat(&ok);
+    return ok ? value : defaultValue;
+}
+
+float parseKeyword(const CgatsTable &table, const QString &name)
+{
+    bool ok;
+    const float value = table.keyword(name).toFloat(&ok);
+    return ok ? value : qSNaN();
+}
+
+QString formatDensity(float value)
+{
+    return qIsNaN(value) ? QString() : QString::number(value, 'f', 2);
+}
+
+QString formatStat(float value, int prec)
+{
+    return qIsNaN(value) ? QString() : QString::number(value, 'f', prec);
+}
+}
+
+QcPatchStats::QcPatchStats()
+    : count_(0)
+    , mean_(0)
+    , m2_(0)
+    , min_(std::numeric_limits<double>::max())
+    , max_(std::numeric_limits<double>::lowest())
+    , sumX_(0)
+    , sumXX_(0)
+    , sumXY_(0)
+    , sumY_(0)
+{
+}
+
+void QcPatchStats::add(float density)
+{
+    const double x = count_;
+    const double y = density;
+
+    // Welford's method for the mean and variance
+    count_++;
+    const double delta = y - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (y - mean_);
+
+    min_ = qMin(min_, y);
+    max_ = qMax(max_, y);
+
+    // Sums for the least-squares trend over reading number
+    sumX_ += x;
+    sumXX_ += x * x;
+    sumXY_ += x * y;
+    sumY_ += y;
+}
+
+int QcPatchStats::count() const
+{
+    return count_;
+}
+
+float QcPatchStats::mean() const
+{
+    return count_ > 0 ? static_cast<float>(mean_) : qSNaN();
+}
+
+float QcPatchStats::stddev() const
+{
+    return count_ > 1 ? static_cast<float>(qSqrt(m2_ / (count_ - 1))) : qSNaN();
+}
+
+float QcPatchStats::min() const
+{
+    return count_ > 0 ? static_cast<float>(min_) : qSNaN();
+}
+
+float QcPatchStats::max() const
+{
+    return count_ > 0 ? static_cast<float>(max_) : qSNaN();
+}
+
+float QcPatchStats::cpk(float lowerLimit, float upperLimit) const
+{
+    const float sigma = stddev();
+    if (qIsNaN(sigma) || sigma <= 0.0F) { return qSNaN(); }
+
+    const double upper = (upperLimit - mean_) / (3.0 * sigma);
+    const double lower = (mean_ - lowerLimit) / (3.0 * sigma);
+    return static_cast<float>(qMin(upper, lower));
+}
+
+float QcPatchStats::trend() const
+{
+    if (count_ < 2) { return qSNaN(); }
+
+    const double denominator = count_ * sumXX_ - sumX_ * sumX_;
+    if (denominator == 0.0) { return qSNaN(); }
+    return static_cast<float>((count_ * sumXY_ - sumX_ * sumY_) / denominator);
+}
+
+QcEvaluator::QcEvaluator()
+    : matching_(MatchSequence)
+    , currentPatch_(0)
+{
+}
+
+QList<QcPatch> QcEvaluator::loadSpec(const QString &fileName, QString *errorString)
+{
+    const QList<CgatsTable> tables = CgatsReader::readFile(fileName, errorString);
+    for (const CgatsTable &table : tables) {
+        if (table.fieldIndex("D_TARGET") >= 0 || table.densityField() >= 0) {
+            return specFromTable(table, errorString);
+        }
+    }
+    if (!tables.isEmpty() && errorString) {
+        *errorString = QStringLiteral("File does not contain any target densities");
+    }
+    return QList<QcPatch>();
+}
+
+QList<QcPatch> QcEvaluator::specFromTable(const CgatsTable &table, QString *errorString)
+{
+    int targetField = table.fieldIndex("D_TARGET");
+    if (targetField < 0) {
+        targetField = table.densityField();
+    }
+    if (targetField < 0) {
+        if (errorString) {
+            *errorString = QStringLiteral("File does not contain any target densities");
+        }
+        return QList<QcPatch>();
+    }
+
+    const int nameField = findField(table, QStringList() << "SAMPLE_NAME" << "SAMPLE_ID");
+    const int modeField = table.fieldIndex("MEAS_MODE");
+    const int tolField = table.fieldIndex("D_TOL");
+    const int tolMinusField = table.fieldIndex("D_TOL_MINUS");
+    const int tolPlusField = table.fieldIndex("D_TOL_PLUS");
+    const int warnField = table.fieldIndex("D_WARN");
+    const int warnMinusField = table.fieldIndex("D_WARN_MINUS");
+    const int warnPlusField = table.fieldIndex("D_WARN_PLUS");
+
+    // Keywords give limits for any patch without its own
+    const float defaultTol = parseKeyword(table, "D_TOL");
+    const float defaultWarn = parseKeyword(table, "D_WARN");
+
+    QList<QcPatch> patches;
+    for (int row = 0; row < table.rowCount(); row++) {
+        QcPatch patch;
+        patch.target = parseValue(table, row, targetField, qSNaN());
+        if (qIsNaN(patch.target)) { continue; }
+
+        patch.name = nameField >= 0 ? table.value(row, nameField) : QString::number(row + 1);
+        const QString mode = modeField >= 0 ? table.value(row, modeField).trimmed().toUpper() : QString();
+        if (mode == QLatin1String("R") || mode == QLatin1String("T")) {
+            patch.mode = mode;
+        }
+
+        const float tol = parseValue(table, row, tolField, defaultTol);
+        patch.tolMinus = qAbs(parseValue(table, row, tolMinusField, tol));
+        patch.tolPlus = qAbs(parseValue(table, row, tolPlusField, tol));
+        if (qIsNaN(patch.tolMinus) || qIsNaN(patch.tolPlus)) {
+            if (errorString) {
+                *errorString = QStringLiteral("Patch %1 has no tolerance").arg(patch.name);
+            }
+            return QList<QcPatch>();
+        }
+
+        const float warn = parseValue(table, row, warnField, defaultWarn);
+        patch.warnMinus = qAbs(parseValue(table, row, warnMinusField, warn));
+        patch.warnPlus = qAbs(parseValue(table, row, warnPlusField, warn));
+        if (qIsNaN(patch.warnMinus) || patch.warnMinus > patch.tolMinus) {
+            patch.warnMinus = patch.tolMinus;
+        }
+        if (qIsNaN(patch.warnPlus) || patch.warnPlus > patch.tolPlus) {
+            patch.warnPlus = patch.tolPlus;
+        }
+
+        patches.append(patch);
+    }
+
+    if (patches.isEmpty() && errorString) {
+        *errorString = QStringLiteral("File does not contain any patches");
+    }
+    return patches;
+}
+
+QcResult::Status QcEvaluator::classify(const QcPatch &patch, float density)
+{
+    const float deviation = density - patch.target;
+    if (qIsNaN(deviation) || deviation < -patch.tolMinus || deviation > patch.tolPlus) {
+        return QcResult::Fail;
+    } else if (deviation < -patch.warnMinus || deviation > patch.warnPlus) {
+        return QcResult::Warn;
+    } else {
+        return QcResult::Pass;
+    }
+}
+
+QString QcEvaluator::statusText(QcResult::Status status)
+{
+    switch (status) {
+    case QcResult::Pass:
+        return QStringLiteral("PASS");
+    case QcResult::Warn:
+        return QStringLiteral("WARN");
+    case QcResult::Fail:
+    default:
+        return QStringLiteral("FAIL");
+    }
+}
+
+void QcEvaluator::setSpec(const QList<QcPatch> &patches)
+{
+    patches_ = patches;
+    reset();
+}
+
+QList<QcPatch> QcEvaluator::patches() const
+{
+    return patches_;
+}
+
+bool QcEvaluator::hasSpec() const
+{
+    return !patches_.isEmpty();
+}
+
+QcEvaluator::Matching QcEvaluator::matching() const
+{
+    return matching_;
+}
+
+void QcEvaluator::setMatching(Matching matching)
+{
+    matching_ = matching;
+}
+
+int QcEvaluator::currentPatch() const
+{
+    return currentPatch_;
+}
+
+void QcEvaluator::setCurrentPatch(int index)
+{
+    if (index < 0 || index >= patches_.size()) { return; }
+    currentPatch_ = index;
+}
+
+QcResult QcEvaluator::evaluate(const QString &mode, float density)
+{
+    QcResult result;
+    if (patches_.isEmpty()) { return result; }
+
+    const QcPatch &patch = patches_.at(currentPatch_);
+    result.patch = currentPatch_;
+    result.deviation = density - patch.target;
+
+    if (!patch.mode.isEmpty() && patch.mode != mode) {
+        result.status = QcResult::Fail;
+        result.modeMismatch = true;
+    } else {
+        result.status = classify(patch, density);
+        stats_[currentPatch_].add(density);
+    }
+    statusCounts_[currentPatch_][result.status]++;
+
+    QcRecord record;
+    record.time = QDateTime::currentDateTime();
+    record.mode = mode;
+    record.density = density;
+    record.result = result;
+    records_.append(record);
+
+    if (matching_ == MatchSequence && !result.modeMismatch) {
+        currentPatch_ = (currentPatch_ + 1) % patches_.size();
+    }
+
+    return result;
+}
+
+const QcPatchStats &QcEvaluator::stats(int index) const
+{
+    static const QcPatchStats emptyStats;
+    if (index < 0 || index >= stats_.size()) { return emptyStats; }
+    return stats_.at(index);
+}
+
+int QcEvaluator::statusCount(int index, QcResult::Status status) const
+{
+    if (index < 0 || index >= statusCounts_.size()) { return 0; }
+    return statusCounts_.at(index).at(status);
+}
+
+QList<QcRecord> QcEvaluator::records() const
+{
+    return records_;
+}
+
+void QcEvaluator::reset()
+{
+    stats_ = QVector<QcPatchStats>(patches_.size());
+    statusCounts_ = QVector<QVector<int>>(patches_.size(), QVector<int>(QcResult::Fail + 1, 0));
+    records_.clear();
+    currentPatch_ = 0;
+}
+
+CgatsTable QcEvaluator::summaryTable() const
+{
+    CgatsTable table(QStringLiteral("CGATS.17"));
+    table.setKeyword("DESCRIPTOR", "QC batch summary");
+    table.setKeyword("CREATED", QDateTime::currentDateTime().toString(Qt::ISODate));
+    table.setFields(QStringList() << "SAMPLE_ID" << "SAMPLE_NAME" << "MEAS_MODE"
+                    << "D_TARGET" << "D_TOL_MINUS" << "D_TOL_PLUS"
+                    << "COUNT" << "D_MEAN" << "D_STDEV" << "D_MIN" << "D_MAX" << "CPK" << "TREND"
+                    << "PASS" << "WARN" << "FAIL");
+
+    for (int i = 0; i < patches_.size(); i++) {
+        const QcPatch &patch = patches_.at(i);
+        const QcPatchStats &patchStats = stats_.at(i);
+        table.appendRow(QStringList()
+                        << QString::number(i + 1)
+                        << patch.name
+                        << patch.mode
+                        << formatDensity(patch.target)
+                        << formatDensity(patch.tolMinus)
+                        << formatDensity(patch.tolPlus)
+                        << QString::number(patchStats.count())
+                        << formatStat(patchStats.mean(), 3)
+                        << formatStat(patchStats.stddev(), 4)
+                        << formatDensity(patchStats.min())
+                        << formatDensity(patchStats.max())
+                        << formatStat(patchStats.cpk(patch.lowerLimit(), patch.upperLimit()), 2)
+                        << formatStat(patchStats.trend(), 4)
+                        << QString::number(statusCount(i, QcResult::Pass))
+                        << QString::number(statusCount(i, QcResult::Warn))
+                        << QString::number(statusCount(i, QcResult::Fail)));
+    }
+    return table;
+}
+
+CgatsTable QcEvaluator::readingsTable() const
+{
+    CgatsTable table(QStringLiteral("CGATS.17"));
+    table.setKeyword("DESCRIPTOR", "QC batch readings");
+    table.setFields(QStringList() << "READING_ID" << "TIME" << "SAMPLE_NAME" << "MEAS_MODE"
+                    << "D_VIS" << "D_DEVIATION" << "QC_STATUS");
+
+    for (int i = 0; i < records_.size(); i++) {
+        const QcRecord &record = records_.at(i);
+        QString status = statusText(record.result.status);
+        if (record.result.modeMismatch) {
+            status.append(QStringLiteral("_MODE"));
+        }
+        table.appendRow(QStringList()
+                        << QString::number(i + 1)
+                        << record.time.toString(Qt::ISODate)
+                        << patches_.value(record.result.patch).name
+                        << record.mode
+                        << formatDensity(record.density)
+                        << formatDensity(record.result.deviation)
+                        << status);
+    }
+    return table;
+}
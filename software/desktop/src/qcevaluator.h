@@ -0,0 +1,181 @@
+#ifndef QCEVALUATOR_H
+#define QCEVALUATOR_H
+
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <QtNumeric>
+
+class CgatsTable;
+
+/**
+ * Target specification for a single QC patch.
+ *
+ * Readings within the warning limits pass, readings outside of the
+ * tolerance limits fail, and anything in between is a warning. If no
+ * warning limits are given, they are the same as the tolerance limits.
+ */
+struct QcPatch
+{
+    QString name;
+    QString mode;      // "R", "T", or empty for either measurement mode
+    float target = qSNaN();
+    float tolMinus = qSNaN();
+    float tolPlus = qSNaN();
+    float warnMinus = qSNaN();
+    float warnPlus = qSNaN();
+
+    float lowerLimit() const { return target - tolMinus; }
+    float upperLimit() const { return target + tolPlus; }
+};
+
+/**
+ * Running statistics for the readings of a single patch.
+ *
+ * Each reading is folded into the statistics as it arrives, so the cost
+ * of adding a reading does not grow with the number of readings.
+ */
+class QcPatchStats
+{
+public:
+    QcPatchStats();
+
+    void add(float density);
+
+    int count() const;
+    float mean() const;
+    float stddev() const;
+    float min() const;
+    float max() const;
+
+    /** Process capability index for the given limits, or NaN with fewer than two readings */
+    float cpk(float lowerLimit, float upperLimit) const;
+
+    /** Least-squares slope of density over reading number, or NaN with fewer than two readings */
+    float trend() const;
+
+private:
+    int count_;
+    double mean_;
+    double m2_;
+    double min_;
+    double max_;
+    double sumX_;
+    double sumXX_;
+    double sumXY_;
+    double sumY_;
+};
+
+/**
+ * Evaluation of a single reading against the QC specification.
+ */
+struct QcResult
+{
+    enum Status {
+        Pass,
+        Warn,
+        Fail
+    };
+
+    int patch = -1;
+    Status status = Fail;
+    float deviation = qSNaN();
+    bool modeMismatch = false;
+};
+
+/**
+ * Reading that was evaluated as part of the current QC batch.
+ */
+struct QcRecord
+{
+    QDateTime time;
+    QString mode;
+    float density;
+    QcResult result;
+};
+
+/**
+ * Tolerance based QC evaluation of density readings.
+ *
+ * Readings are matched either to patches in the order of the
+ * specification, or to a patch that has been selected, and each reading
+ * is evaluated once as it arrives. This class has no dependencies on the
+ * GUI, so it can be driven from anywhere readings are available.
+ */
+class QcEvaluator
+{
+public:
+    enum Matching {
+        MatchSequence,
+        MatchSelected
+    };
+
+    QcEvaluator();
+
+    /**
+     * Load a QC specification from the first data set of a CGATS file
+     * that has target densities.
+     *
+     * Each row is a patch, with its target in D_TARGET (or the usual
+     * density field), tolerances in D_TOL or D_TOL_MINUS and D_TOL_PLUS,
+     * and optional warning limits in D_WARN or D_WARN_MINUS and
+     * D_WARN_PLUS. Patches are named by SAMPLE_NAME or SAMPLE_ID, and
+     * MEAS_MODE can restrict a patch to R or T readings. D_TOL and D_WARN
+     * keywords set the limits for patches that do not have their own.
+     */
+    static QList<QcPatch> loadSpec(const QString &fileName, QString *errorString = nullptr);
+    static QList<QcPatch> specFromTable(const CgatsTable &table, QString *errorString = nullptr);
+
+    /** Classify a density reading against a patch's limits */
+    static QcResult::Status classify(const QcPatch &patch, float density);
+    static QString statusText(QcResult::Status status);
+
+    /** Replace the specification, which also starts a new batch */
+    void setSpec(const QList<QcPatch> &patches);
+    QList<QcPatch> patches() const;
+    bool hasSpec() const;
+
+    Matching matching() const;
+    void setMatching(Matching matching);
+
+    /** Patch that the next reading will be matched to */
+    int currentPatch() const;
+    void setCurrentPatch(int index);
+
+    /**
+     * Evaluate a reading against the current patch, and add it to the
+     * batch.
+     *
+     * Readings taken in the wrong mode for the patch fail, and are not
+     * included in the patch statistics. When matching in sequence, the
+     * current patch then advances to the next one, unless the mode was
+     * wrong so the patch needs to be measured again.
+     *
+     * @param mode Measurement mode of the reading, "R" or "T"
+     */
+    QcResult evaluate(const QString &mode, float density);
+
+    const QcPatchStats &stats(int index) const;
+    int statusCount(int index, QcResult::Status status) const;
+    QList<QcRecord> records() const;
+
+    /** Clear the statistics and readings of the batch */
+    void reset();
+
+    /** Per-patch summary of the batch, for a QC report */
+    CgatsTable summaryTable() const;
+
+    /** All readings of the batch, for a QC report */
+    CgatsTable readingsTable() const;
+
+private:
+    QList<QcPatch> patches_;
+    QVector<QcPatchStats> stats_;
+    QVector<QVector<int>> statusCounts_;
+    QList<QcRecord> records_;
+    Matching matching_;
+    int currentPatch_;
+};
+
+#endif // QCEVALUATOR_H
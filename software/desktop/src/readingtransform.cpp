@@ -0,0 +1,282 @@
+#include "readingtransform.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QJSEngine>
+#include <QJSValueIterator>
+#include <QMutexLocker>
+#include <QSettings>
+#include <QTextStream>
+#include <QThread>
+#include <QDebug>
+
+namespace
+{
+static const int DEFAULT_TIME_BUDGET = 50;
+}
+
+ReadingTransformWorker::ReadingTransformWorker(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ReadingTransformWorker::~ReadingTransformWorker()
+{
+}
+
+void ReadingTransformWorker::interrupt(quint64 sequence)
+{
+    QMutexLocker locker(&interruptMutex_);
+    if (engine_ && currentSequence_ == sequence) {
+        interrupted_ = true;
+        engine_->setInterrupted(true);
+    }
+}
+
+void ReadingTransformWorker::loadScripts(const QStringList &fileNames)
+{
+    {
+        // The engine is created here, so that it belongs to the worker thread
+        QMutexLocker locker(&interruptMutex_);
+        if (!engine_) {
+            engine_ = new QJSEngine(this);
+        }
+    }
+
+    scripts_.clear();
+    for (const QString &fileName : fileNames) {
+        const QString name = QFileInfo(fileName).fileName();
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            emit scriptError(QStringLiteral("%1: %2").arg(name, file.errorString()));
+            continue;
+        }
+        const QString source = QTextStream(&file).readAll();
+
+        // Evaluate each script in its own function scope, so that scripts
+        // cannot interfere with each other, and keep the opening of the
+        // scope on the first line so that reported line numbers match.
+        const QString program = QStringLiteral("(function() {") + source
+                + QStringLiteral("\n;return typeof transform === 'function' ? transform : undefined;\n})()");
+
+        QJSValue function = engine_->evaluate(program, fileName, 1);
+        if (function.isError()) {
+            emit scriptError(QStringLiteral("%1:%2: %3").arg(name,
+                                                             function.property(QStringLiteral("lineNumber")).toString(),
+                                                             function.toString()));
+            continue;
+        }
+        if (!function.isCallable()) {
+            emit scriptError(QStringLiteral("%1: Script does not define a transform(reading) function").arg(name));
+            continue;
+        }
+
+        scripts_.append(Script{name, function, false});
+    }
+}
+
+void ReadingTransformWorker::processReading(const TransformReading &reading)
+{
+    QStringList columns;
+    QStringList values;
+
+    if (!engine_ || scripts_.isEmpty()) {
+        emit readingTransformed(reading, columns, values);
+        return;
+    }
+
+    {
+        QMutexLocker locker(&interruptMutex_);
+        currentSequence_ = reading.sequence;
+        interrupted_ = false;
+    }
+    emit transformStarted(reading.sequence);
+
+    for (Script &script : scripts_) {
+        const QJSValue result = script.function.call(QJSValueList() << createReadingObject(reading));
+
+        bool interrupted;
+        {
+            QMutexLocker locker(&interruptMutex_);
+            interrupted = interrupted_;
+            if (interrupted) {
+                interrupted_ = false;
+                engine_->setInterrupted(false);
+            }
+        }
+
+        if (interrupted || result.isError()) {
+            // Only report the first of a run of errors from the same script,
+            // to avoid flooding the log with one error per reading
+            if (!script.failing) {
+                if (interrupted) {
+                    emit scriptError(QStringLiteral("%1: Script exceeded its time budget").arg(script.name));
+                } else {
+                    emit scriptError(QStringLiteral("%1:%2: %3").arg(script.name,
+                                                                     result.property(QStringLiteral("lineNumber")).toString(),
+                                                                     result.toString()));
+                }
+                script.failing = true;
+            }
+            continue;
+        }
+        script.failing = false;
+
+        if (!result.isObject()) { continue; }
+
+        QJSValueIterator it(result);
+        while (it.hasNext()) {
+            it.next();
+            int index = columns.indexOf(it.name());
+            if (index < 0) {
+                columns.append(it.name());
+                values.append(valueToString(it.value()));
+            } else {
+                values[index] = valueToString(it.value());
+            }
+        }
+    }
+
+    {
+        QMutexLocker locker(&interruptMutex_);
+        currentSequence_ = 0;
+    }
+
+    emit readingTransformed(reading, columns, values);
+}
+
+QJSValue ReadingTransformWorker::createReadingObject(const TransformReading &reading)
+{
+    QJSValue obj = engine_->newObject();
+
+    QString mode;
+    if (reading.type == DensInterface::DensityReflection) {
+        mode = QStringLiteral("R");
+    } else if (reading.type == DensInterface::DensityTransmission) {
+        mode = QStringLiteral("T");
+    }
+
+    float density = reading.dValue;
+    if (!qIsNaN(reading.dZero)) {
+        density -= reading.dZero;
+    }
+
+    obj.setProperty(QStringLiteral("mode"), mode);
+    obj.setProperty(QStringLiteral("density"), density);
+    obj.setProperty(QStringLiteral("value"), reading.dValue);
+    obj.setProperty(QStringLiteral("zero"), qIsNaN(reading.dZero) ? QJSValue(QJSValue::NullValue) : QJSValue(reading.dZero));
+    obj.setProperty(QStringLiteral("raw"), reading.rawValue);
+    obj.setProperty(QStringLiteral("corrected"), reading.corrValue);
+    obj.setProperty(QStringLiteral("uncertainty"), reading.dUncertainty);
+    obj.setProperty(QStringLiteral("sequence"), static_cast<double>(reading.sequence));
+    return obj;
+}
+
+QString ReadingTransformWorker::valueToString(const QJSValue &value)
+{
+    if (value.isNull() || value.isUndefined()) {
+        return QString();
+    } else if (value.isNumber()) {
+        // Division by zero, or arithmetic on a missing property, has no value
+        const double number = value.toNumber();
+        return qIsFinite(number) ? QString::number(number, 'g', 4) : QString();
+    } else {
+        return value.toString();
+    }
+}
+
+ReadingTransform::ReadingTransform(QObject *parent)
+    : QObject(parent)
+    , thread_(new QThread(this))
+    , worker_(new ReadingTransformWorker)
+    , timeBudget_(DEFAULT_TIME_BUDGET)
+{
+    qRegisterMetaType<TransformReading>();
+
+    worker_->moveToThread(thread_);
+    connect(thread_, &QThread::finished, worker_, &QObject::deleteLater);
+    connect(worker_, &ReadingTransformWorker::transformStarted, this, &ReadingTransform::onTransformStarted);
+    connect(worker_, &ReadingTransformWorker::readingTransformed, this, &ReadingTransform::onReadingTransformed);
+    connect(worker_, &ReadingTransformWorker::scriptError, this, &ReadingTransform::scriptError);
+
+    watchdog_.setSingleShot(true);
+    connect(&watchdog_, &QTimer::timeout, this, &ReadingTransform::onWatchdogTimeout);
+
+    thread_->setObjectName(QStringLiteral("ReadingTransform"));
+    thread_->start();
+}
+
+ReadingTransform::~ReadingTransform()
+{
+    if (watchdog_.isActive()) {
+        worker_->interrupt(watchdogSequence_);
+    }
+    thread_->quit();
+    thread_->wait();
+}
+
+void ReadingTransform::loadSavedScripts()
+{
+    QSettings settings;
+    bool ok;
+    int timeBudget = settings.value("reading_transform/time_budget", DEFAULT_TIME_BUDGET).toInt(&ok);
+    if (ok && timeBudget > 0) {
+        timeBudget_ = timeBudget;
+    }
+
+    scripts_ = settings.value("reading_transform/scripts").toStringList();
+    QMetaObject::invokeMethod(worker_, "loadScripts", Qt::QueuedConnection, Q_ARG(QStringList, scripts_));
+}
+
+void ReadingTransform::saveScripts()
+{
+    QSettings settings;
+    settings.setValue("reading_transform/scripts", scripts_);
+}
+
+void ReadingTransform::setScripts(const QStringList &fileNames)
+{
+    scripts_ = fileNames;
+    QMetaObject::invokeMethod(worker_, "loadScripts", Qt::QueuedConnection, Q_ARG(QStringList, scripts_));
+}
+
+QStringList ReadingTransform::scripts() const { return scripts_; }
+bool ReadingTransform::isActive() const { return !scripts_.isEmpty(); }
+int ReadingTransform::timeBudget() const { return timeBudget_; }
+void ReadingTransform::setTimeBudget(int msec) { timeBudget_ = msec; }
+
+quint64 ReadingTransform::processReading(DensInterface::DensityType type, float dValue, float dZero,
+                                         float rawValue, float corrValue, float dUncertainty)
+{
+    TransformReading reading;
+    reading.type = type;
+    reading.dValue = dValue;
+    reading.dZero = dZero;
+    reading.rawValue = rawValue;
+    reading.corrValue = corrValue;
+    reading.dUncertainty = dUncertainty;
+    reading.sequence = ++sequence_;
+
+    QMetaObject::invokeMethod(worker_, "processReading", Qt::QueuedConnection, Q_ARG(TransformReading, reading));
+    return reading.sequence;
+}
+
+void ReadingTransform::onTransformStarted(quint64 sequence)
+{
+    watchdogSequence_ = sequence;
+    watchdog_.start(timeBudget_);
+}
+
+void ReadingTransform::onReadingTransformed(const TransformReading &reading, const QStringList &columns, const QStringList &values)
+{
+    if (reading.sequence == watchdogSequence_) {
+        watchdog_.stop();
+    }
+    emit readingTransformed(reading, columns, values);
+}
+
+void ReadingTransform::onWatchdogTimeout()
+{
+    qWarning() << "Interrupting transform scripts for reading" << watchdogSequence_;
+    worker_->interrupt(watchdogSequence_);
+}
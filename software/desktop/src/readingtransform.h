@@ -0,0 +1,135 @@
+#ifndef READINGTRANSFORM_H
+#define READINGTRANSFORM_H
+
+#include <QObject>
+#include <QJSValue>
+#include <QMutex>
+#include <QStringList>
+#include <QTimer>
+#include "densinterface.h"
+
+class QJSEngine;
+class QThread;
+
+/**
+ * Density reading passed through the transform scripts.
+ */
+struct TransformReading
+{
+    DensInterface::DensityType type = DensInterface::DensityUnknown;
+    float dValue = qSNaN();
+    float dZero = qSNaN();
+    float rawValue = qSNaN();
+    float corrValue = qSNaN();
+    float dUncertainty = qSNaN();
+    quint64 sequence = 0;
+};
+Q_DECLARE_METATYPE(TransformReading)
+
+/**
+ * Runs the transform scripts, and lives on the transform worker thread.
+ */
+class ReadingTransformWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ReadingTransformWorker(QObject *parent = nullptr);
+    ~ReadingTransformWorker();
+
+    /**
+     * Interrupt the script run for the reading, if it is still running.
+     *
+     * This may be called from any thread.
+     */
+    void interrupt(quint64 sequence);
+
+public slots:
+    void loadScripts(const QStringList &fileNames);
+    void processReading(const TransformReading &reading);
+
+signals:
+    void transformStarted(quint64 sequence);
+    void readingTransformed(const TransformReading &reading, const QStringList &columns, const QStringList &values);
+    void scriptError(const QString &message);
+
+private:
+    struct Script {
+        QString name;
+        QJSValue function;
+        bool failing;
+    };
+
+    QJSValue createReadingObject(const TransformReading &reading);
+    static QString valueToString(const QJSValue &value);
+
+    QJSEngine *engine_ = nullptr;
+    QList<Script> scripts_;
+    QMutex interruptMutex_;
+    quint64 currentSequence_ = 0;
+    bool interrupted_ = false;
+};
+
+/**
+ * Hook stage that passes density readings through user scripts,
+ * which can add computed columns to the reading.
+ *
+ * Each script is a JavaScript file that defines a transform(reading)
+ * function. The reading object has the mode ("R" or "T"), density
+ * (relative to any zero), value, zero, raw, corrected, uncertainty and
+ * sequence properties. The function returns an object whose properties
+ * become the computed columns, in the order they are defined. Values
+ * that are null, undefined or not a finite number are left empty.
+ *
+ * Scripts are compiled once when they are loaded, and run on a worker
+ * thread. A script that runs longer than the time budget is interrupted,
+ * and script errors are reported without affecting other scripts.
+ */
+class ReadingTransform : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ReadingTransform(QObject *parent = nullptr);
+    ~ReadingTransform();
+
+    /** Load the scripts saved in the app settings */
+    void loadSavedScripts();
+
+    /** Save the current scripts in the app settings */
+    void saveScripts();
+
+    /** Replace the current scripts, compiling them on the worker thread */
+    void setScripts(const QStringList &fileNames);
+    QStringList scripts() const;
+    bool isActive() const;
+
+    int timeBudget() const;
+    void setTimeBudget(int msec);
+
+    /**
+     * Queue a reading to be passed through the scripts.
+     *
+     * @return Sequence number of the queued reading
+     */
+    quint64 processReading(DensInterface::DensityType type, float dValue, float dZero,
+                           float rawValue, float corrValue, float dUncertainty);
+
+signals:
+    void readingTransformed(const TransformReading &reading, const QStringList &columns, const QStringList &values);
+    void scriptError(const QString &message);
+
+private slots:
+    void onTransformStarted(quint64 sequence);
+    void onReadingTransformed(const TransformReading &reading, const QStringList &columns, const QStringList &values);
+    void onWatchdogTimeout();
+
+private:
+    QThread *thread_;
+    ReadingTransformWorker *worker_;
+    QTimer watchdog_;
+    QStringList scripts_;
+    int timeBudget_;
+    quint64 sequence_ = 0;
+    quint64 watchdogSequence_ = 0;
+};
+
+#endif // READINGTRANSFORM_H
@@ -0,0 +1,825 @@
+#include "rpcserver.h"
+
+#include <iostream>
+#include <string>
+
+#include <QSerialPortInfo>
+#include <QThread>
+#include <QTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QDateTime>
+#include <QStringList>
+#include <QDebug>
+
+#include "settingsexporter.h"
+#include "crashreport.h"
+
+const int RpcServer::DefaultTimeout = 5000;
+const int RpcServer::SelfTestTimeout = 30000;
+const int RpcServer::LateResponseTimeout = 30000;
+
+RpcServer::RpcServer(QObject *parent)
+    : QObject{parent}
+    , densInterface_(new DensInterface(this))
+    , timeoutTimer_(new QTimer(this))
+{
+    connect(densInterface_, &DensInterface::connectionOpened, this, &RpcServer::onConnectionOpened);
+    connect(densInterface_, &DensInterface::connectionClosed, this, &RpcServer::onConnectionClosed);
+    connect(densInterface_, &DensInterface::connectionError, this, &RpcServer::onConnectionError);
+    connect(densInterface_, &DensInterface::densityReading, this, &RpcServer::onDensityReading);
+    connect(densInterface_, &DensInterface::commandRejected, this, &RpcServer::onCommandRejected);
+    connect(densInterface_, &DensInterface::commandNotSent, this, &RpcServer::onCommandNotSent);
+
+    // Each kind of device response completes the oldest request waiting on it
+    connect(densInterface_, &DensInterface::systemBuildResponse, this, [this]() {
+        respond(ResponseSystemBuild, QJsonValue());
+    });
+    connect(densInterface_, &DensInterface::systemDeviceResponse, this, [this]() {
+        respond(ResponseSystemDevice, QJsonValue());
+    });
+    connect(densInterface_, &DensInterface::systemUniqueId, this, [this]() {
+        respond(ResponseSystemUid, QJsonValue());
+    });
+    connect(densInterface_, &DensInterface::systemInternalSensors, this, [this]() {
+        respond(ResponseSystemSensors, QJsonValue());
+    });
+    connect(densInterface_, &DensInterface::systemRemoteControl, this, [this](bool enabled) {
+        respond(ResponseRemoteControl, enabled);
+    });
+    connect(densInterface_, &DensInterface::diagSelfTestResponse, this,
+            [this](const QList<DensSelfTestResult> &results, bool passed) {
+        if (results.isEmpty()) {
+            respond(ResponseSelfTest, QJsonValue());
+            return;
+        }
+
+        QJsonArray checks;
+        for (const DensSelfTestResult &result : results) {
+            QJsonObject check;
+            check["check"] = result.check;
+            if (result.status == DensSelfTestResult::StatusPass) {
+                check["status"] = QStringLiteral("pass");
+            } else if (result.status == DensSelfTestResult::StatusFail) {
+                check["status"] = QStringLiteral("fail");
+            } else {
+                check["status"] = QStringLiteral("skip");
+            }
+            check["value"] = result.value;
+            checks.append(check);
+        }
+
+        QJsonObject jsonResult;
+        jsonResult["passed"] = passed;
+        jsonResult["checks"] = checks;
+        respond(ResponseSelfTest, jsonResult);
+    });
+    connect(densInterface_, &DensInterface::diagCrashRecord, this, [this](const QByteArray &data) {
+        QJsonObject jsonResult;
+        const CrashReport report = CrashReport::fromRecord(data);
+        jsonResult["present"] = report.isValid();
+        if (report.isValid()) {
+            jsonResult["type"] = report.typeName();
+            jsonResult["task"] = report.taskName();
+            jsonResult["detail"] = report.detail();
+            jsonResult["uptime"] = static_cast<qint64>(report.uptime());
+            jsonResult["report"] = report.toText(densInterface_->buildDescribe(), densInterface_->buildChecksum());
+            jsonResult["data"] = QString::fromLatin1(data.toHex());
+        }
+        respond(ResponseCrashRecord, jsonResult);
+    });
+    connect(densInterface_, &DensInterface::calGainResponse, this, [this]() {
+        respond(ResponseCalGain, QJsonValue());
+    });
+    connect(densInterface_, &DensInterface::calSlopeResponse, this, [this]() {
+        respond(ResponseCalSlope, QJsonValue());
+    });
+    connect(densInterface_, &DensInterface::calReflectionResponse, this, [this]() {
+        respond(ResponseCalReflection, QJsonValue());
+    });
+    connect(densInterface_, &DensInterface::calTransmissionResponse, this, [this]() {
+        respond(ResponseCalTransmission, QJsonValue());
+    });
+    connect(densInterface_, &DensInterface::calGainSetComplete, this, [this]() {
+        respond(ResponseCalGainSet, QJsonValue());
+    });
+    connect(densInterface_, &DensInterface::calSlopeSetComplete, this, [this]() {
+        respond(ResponseCalSlopeSet, QJsonValue());
+    });
+    connect(densInterface_, &DensInterface::calReflectionSetComplete, this, [this]() {
+        respond(ResponseCalReflectionSet, QJsonValue());
+    });
+    connect(densInterface_, &DensInterface::calTransmissionSetComplete, this, [this]() {
+        respond(ResponseCalTransmissionSet, QJsonValue());
+    });
+
+    timeoutTimer_->setInterval(250);
+    connect(timeoutTimer_, &QTimer::timeout, this, &RpcServer::onCheckTimeouts);
+}
+
+RpcServer::~RpcServer()
+{
+    // The reader only stops once stdin is closed, so it cannot be
+    // interrupted if the server goes away before then
+    if (readerThread_ && readerThread_->isRunning()) {
+        readerThread_->terminate();
+        readerThread_->wait();
+    }
+}
+
+void RpcServer::setPort(const QString &portName)
+{
+    portName_ = portName;
+}
+
+void RpcServer::run()
+{
+    // Reading stdin blocks, and there is no portable way to be notified
+    // of input on it, so it is read on its own thread and each line is
+    // handed back to this one
+    readerThread_ = QThread::create([this]() {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            const QByteArray data = QByteArray::fromStdString(line);
+            QMetaObject::invokeMethod(this, [this, data]() { processLine(data); }, Qt::QueuedConnection);
+        }
+        QMetaObject::invokeMethod(this, [this]() {
+            inputClosed_ = true;
+            finishIfIdle();
+        }, Qt::QueuedConnection);
+    });
+    readerThread_->setParent(this);
+    readerThread_->start();
+
+    timeoutTimer_->start();
+    qDebug() << "RPC server ready";
+}
+
+void RpcServer::processLine(const QByteArray &line)
+{
+    if (line.trimmed().isEmpty()) { return; }
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        sendError(QJsonValue(), ErrorParse, parseError.errorString());
+        return;
+    }
+
+    // Responses to a batch would have to wait on every request in it,
+    // which defeats the point of handling requests concurrently
+    if (!doc.isObject()) {
+        sendError(QJsonValue(), ErrorInvalidRequest, QStringLiteral("Batch requests are not supported"));
+        return;
+    }
+
+    const QJsonObject request = doc.object();
+    const QJsonValue id = request.value(QLatin1String("id"));
+    const QJsonValue method = request.value(QLatin1String("method"));
+    const QJsonValue params = request.value(QLatin1String("params"));
+
+    const bool validId = id.isUndefined() || id.isNull() || id.isString() || id.isDouble();
+    if (!validId || request.value(QLatin1String("jsonrpc")) != QLatin1String("2.0") || !method.isString()) {
+        sendError((validId && !id.isUndefined()) ? id : QJsonValue(), ErrorInvalidRequest, QStringLiteral("Invalid request"));
+        return;
+    }
+    if (!(params.isUndefined() || params.isObject())) {
+        sendError(id, ErrorInvalidParams, QStringLiteral("Parameters must be named"));
+        return;
+    }
+    if (!id.isUndefined() && isPending(id)) {
+        sendError(id, ErrorInvalidRequest, QStringLiteral("Request id is already in use"));
+        return;
+    }
+
+    processRequest(method.toString(), id, params.toObject());
+}
+
+void RpcServer::processRequest(const QString &method, const QJsonValue &id, const QJsonObject &params)
+{
+    if (method == QLatin1String("connect")) {
+        connectStart(id, params);
+        return;
+    } else if (method == QLatin1String("disconnect")) {
+        disconnectStart(id);
+        return;
+    }
+
+    static const QStringList deviceMethods {
+        QStringLiteral("device.info"),
+        QStringLiteral("measurement.subscribe"),
+        QStringLiteral("measurement.unsubscribe"),
+        QStringLiteral("calibration.get"),
+        QStringLiteral("calibration.set"),
+        QStringLiteral("settings.export"),
+        QStringLiteral("settings.import"),
+        QStringLiteral("diagnostics.selfTest"),
+        QStringLiteral("diagnostics.crashRecord")
+    };
+    if (!deviceMethods.contains(method)) {
+        sendError(id, ErrorMethodNotFound, QStringLiteral("Method not found: %1").arg(method));
+        return;
+    }
+    if (!densInterface_->connected()) {
+        sendError(id, ErrorNotConnected, QStringLiteral("Not connected"));
+        return;
+    }
+
+    if (method == QLatin1String("device.info")) {
+        deviceInfoStart(id);
+    } else if (method == QLatin1String("measurement.subscribe")) {
+        subscribed_ = true;
+        sendResult(id, true);
+    } else if (method == QLatin1String("measurement.unsubscribe")) {
+        subscribed_ = false;
+        sendResult(id, true);
+    } else if (method == QLatin1String("calibration.get")) {
+        calibrationGetStart(id, params);
+    } else if (method == QLatin1String("calibration.set")) {
+        calibrationSetStart(id, params);
+    } else if (method == QLatin1String("settings.export")) {
+        settingsExportStart(id, params);
+    } else if (method == QLatin1String("settings.import")) {
+        settingsImportStart(id, params);
+    } else if (method == QLatin1String("diagnostics.selfTest")) {
+        selfTestStart(id);
+    } else if (method == QLatin1String("diagnostics.crashRecord")) {
+        crashRecordStart(id);
+    }
+}
+
+void RpcServer::connectStart(const QJsonValue &id, const QJsonObject &params)
+{
+    if (transport_) {
+        sendError(id, ErrorInvalidRequest, QStringLiteral("Already connected"));
+        return;
+    }
+
+    QString uri = params.value(QLatin1String("port")).toString(portName_);
+    if (uri.isEmpty()) {
+        const auto infos = QSerialPortInfo::availablePorts();
+        for (const QSerialPortInfo &info : infos) {
+            // Filter the list to only contain devices that match the VID/PID
+            // actually assigned to the Printalyzer Densitometer
+            if (info.vendorIdentifier() == 0x16D0 && info.productIdentifier() == 0x10EB) {
+                uri = QStringLiteral("serial:%1").arg(info.portName());
+                break;
+            }
+        }
+        if (uri.isEmpty()) {
+            sendError(id, ErrorNotConnected, QStringLiteral("No devices found"));
+            return;
+        }
+    }
+    qDebug() << "Connecting to:" << uri;
+
+    QString errorString;
+    transport_ = DensTransport::fromUri(uri, this, &errorString);
+    if (!transport_) {
+        sendError(id, ErrorInvalidParams, errorString);
+        return;
+    }
+
+    if (!transport_->open()) {
+        sendError(id, ErrorNotConnected, transport_->errorString());
+        closeConnection();
+        return;
+    }
+
+    // The connection is only open once the device has answered
+    // with its version, which completes the request
+    expect(ResponseConnect, id);
+    if (!densInterface_->connectToDevice(transport_)) {
+        failAll(ErrorNotConnected, QStringLiteral("Unable to connect"));
+        closeConnection();
+    }
+}
+
+void RpcServer::disconnectStart(const QJsonValue &id)
+{
+    closeConnection();
+    sendResult(id, true);
+}
+
+void RpcServer::deviceInfoStart(const QJsonValue &id)
+{
+    expectStep(ResponseSystemBuild, id);
+    expectStep(ResponseSystemDevice, id);
+    expectStep(ResponseSystemUid, id);
+    expect(ResponseSystemSensors, id, [this, id](const QJsonValue &) {
+        QJsonObject jsonResult;
+        jsonResult["name"] = densInterface_->projectName();
+        jsonResult["version"] = densInterface_->version();
+        jsonResult["protocolVersion"] = static_cast<qint64>(densInterface_->protocolVersion());
+        jsonResult["settingsVersion"] = static_cast<qint64>(densInterface_->settingsVersion());
+        jsonResult["buildDate"] = densInterface_->buildDate().toString("yyyy-MM-dd hh:mm");
+        jsonResult["buildDescribe"] = densInterface_->buildDescribe();
+        jsonResult["checksum"] = QString::number(densInterface_->buildChecksum(), 16);
+        jsonResult["uid"] = densInterface_->uniqueId();
+        jsonResult["vdda"] = densInterface_->mcuVdda();
+        jsonResult["temperature"] = densInterface_->mcuTemp();
+        sendResult(id, jsonResult);
+    });
+
+    densInterface_->sendGetSystemBuild();
+    densInterface_->sendGetSystemDeviceInfo();
+    densInterface_->sendGetSystemUID();
+    densInterface_->sendGetSystemInternalSensors();
+}
+
+void RpcServer::calibrationGetStart(const QJsonValue &id, const QJsonObject &params)
+{
+    SettingsSchema::FloatEncoding encoding;
+    if (!readFloatEncoding(params, SettingsSchema::FloatDecimal, &encoding)) {
+        sendError(id, ErrorInvalidParams, QStringLiteral("Unknown float encoding"));
+        return;
+    }
+
+    // Responses arrive in order, so the last one means all the values are current
+    expectStep(ResponseCalGain, id);
+    expectStep(ResponseCalSlope, id);
+    expectStep(ResponseCalReflection, id);
+    expect(ResponseCalTransmission, id, [this, id, encoding](const QJsonValue &) {
+        sendResult(id, SettingsSchema::calibrationToJson(
+                       densInterface_->calGain(), densInterface_->calSlope(),
+                       densInterface_->calReflection(), densInterface_->calTransmission(),
+                       encoding));
+    });
+
+    densInterface_->sendGetCalGain();
+    densInterface_->sendGetCalSlope();
+    densInterface_->sendGetCalReflection();
+    densInterface_->sendGetCalTransmission();
+}
+
+void RpcServer::calibrationSetStart(const QJsonValue &id, const QJsonObject &params)
+{
+    SettingsSchema::FloatEncoding encoding;
+    if (!readFloatEncoding(params, SettingsSchema::FloatDecimal, &encoding)) {
+        sendError(id, ErrorInvalidParams, QStringLiteral("Unknown float encoding"));
+        return;
+    }
+    if (!params.value(QLatin1String("calibration")).isObject()) {
+        sendError(id, ErrorInvalidParams, QStringLiteral("Missing calibration"));
+        return;
+    }
+
+    // Wrap the values up as a settings file, so they get the same checks
+    QJsonObject root;
+    root["header"] = SettingsSchema::header(encoding);
+    root["calibration"] = params.value(QLatin1String("calibration"));
+    writeCalibration(id, root);
+}
+
+void RpcServer::settingsExportStart(const QJsonValue &id, const QJsonObject &params)
+{
+    SettingsSchema::FloatEncoding encoding;
+    if (!readFloatEncoding(params, SettingsSchema::FloatExact, &encoding)) {
+        sendError(id, ErrorInvalidParams, QStringLiteral("Unknown float encoding"));
+        return;
+    }
+
+    SettingsExporter *exporter = new SettingsExporter(densInterface_, this);
+    exporter->setFloatEncoding(encoding);
+    connect(exporter, &SettingsExporter::exportReady, this, [this, id, exporter]() {
+        sendResult(id, exporter->exportObject());
+        exporter->deleteLater();
+        exportsPending_--;
+        finishIfIdle();
+    });
+    connect(exporter, &SettingsExporter::exportFailed, this, [this, id, exporter]() {
+        sendError(id, ErrorTimeout, QStringLiteral("Unable to read settings from device"));
+        exporter->deleteLater();
+        exportsPending_--;
+        finishIfIdle();
+    });
+    exportsPending_++;
+    exporter->prepareExport();
+}
+
+void RpcServer::settingsImportStart(const QJsonValue &id, const QJsonObject &params)
+{
+    if (!params.value(QLatin1String("settings")).isObject()) {
+        sendError(id, ErrorInvalidParams, QStringLiteral("Missing settings"));
+        return;
+    }
+    writeCalibration(id, params.value(QLatin1String("settings")).toObject());
+}
+
+void RpcServer::writeCalibration(const QJsonValue &id, QJsonObject root)
+{
+    const QList<SettingsSchema::Issue> issues = SettingsSchema::load(&root);
+    if (!issues.isEmpty()) {
+        sendError(id, ErrorInvalidParams, SettingsSchema::formatIssues(issues));
+        return;
+    }
+
+    DensCalGain calGain;
+    DensCalSlope calSlope;
+    DensCalTarget calReflection;
+    DensCalTarget calTransmission;
+    const bool hasGain = SettingsSchema::readCalGain(root, &calGain);
+    const bool hasSlope = SettingsSchema::readCalSlope(root, &calSlope);
+    const bool hasReflection = SettingsSchema::readCalReflection(root, &calReflection);
+    const bool hasTransmission = SettingsSchema::readCalTransmission(root, &calTransmission);
+
+    QList<Response> responses;
+    if (hasGain) { responses.append(ResponseCalGainSet); }
+    if (hasSlope) { responses.append(ResponseCalSlopeSet); }
+    if (hasReflection) { responses.append(ResponseCalReflectionSet); }
+    if (hasTransmission) { responses.append(ResponseCalTransmissionSet); }
+    if (responses.isEmpty()) {
+        sendError(id, ErrorInvalidParams, QStringLiteral("No calibration values to set"));
+        return;
+    }
+
+    // A rejected value is answered with ERR, which fails the request
+    for (int i = 0; i < responses.size() - 1; i++) {
+        expectStep(responses.at(i), id);
+    }
+    expect(responses.last(), id, [this, id](const QJsonValue &) {
+        sendResult(id, true);
+    });
+
+    if (hasGain) { densInterface_->sendSetCalGain(calGain); }
+    if (hasSlope) { densInterface_->sendSetCalSlope(calSlope); }
+    if (hasReflection) { densInterface_->sendSetCalReflection(calReflection); }
+    if (hasTransmission) { densInterface_->sendSetCalTransmission(calTransmission); }
+}
+
+void RpcServer::selfTestStart(const QJsonValue &id)
+{
+    // The self-test drives the sensor directly, which is only
+    // allowed while the device is under remote control
+    expect(ResponseRemoteControl, id, [this, id](const QJsonValue &enabled) {
+        if (!enabled.toBool()) {
+            sendError(id, ErrorDevice, QStringLiteral("Unable to enable remote control"));
+            return;
+        }
+
+        expect(ResponseSelfTest, id, [this, id](const QJsonValue &result) {
+            expect(ResponseRemoteControl);
+            densInterface_->sendInvokeSystemRemoteControl(false);
+
+            if (result.isObject()) {
+                sendResult(id, result);
+            } else {
+                sendError(id, ErrorDevice, QStringLiteral("Device refused to run the self-test"));
+            }
+        }, SelfTestTimeout);
+        densInterface_->sendInvokeDiagSelfTest();
+    });
+    densInterface_->sendInvokeSystemRemoteControl(true);
+}
+
+void RpcServer::crashRecordStart(const QJsonValue &id)
+{
+    expect(ResponseCrashRecord, id);
+    densInterface_->sendGetDiagCrashRecord();
+}
+
+void RpcServer::onConnectionOpened()
+{
+    qDebug() << "Connected to device";
+    densInterface_->sendSetMeasurementFormat(DensInterface::FormatExtendedQuality);
+    densInterface_->sendSetAllowUncalibratedMeasurements(true);
+
+    QJsonObject jsonResult;
+    jsonResult["name"] = densInterface_->projectName();
+    jsonResult["version"] = densInterface_->version();
+    jsonResult["port"] = transport_ ? transport_->uri() : QString();
+    respond(ResponseConnect, jsonResult);
+}
+
+void RpcServer::onConnectionClosed()
+{
+    const bool unrecognized = densInterface_->deviceUnrecognized();
+    failAll(ErrorNotConnected, unrecognized ? QStringLiteral("Unrecognized device") : QStringLiteral("Connection closed"));
+    closeConnection();
+    finishIfIdle();
+}
+
+void RpcServer::onConnectionError()
+{
+    // This may be called from one of the transport's own signals
+    const bool wasConnected = densInterface_->connected();
+    closeConnection();
+    if (wasConnected) {
+        sendNotification(QStringLiteral("device.disconnected"), QJsonObject());
+    }
+}
+
+void RpcServer::onDensityReading(DensInterface::DensityType type, float dValue, float dZero, float rawValue, float corrValue,
+                                 float dUncertainty, DensInterface::ReadingQuality quality)
+{
+    if (!subscribed_) { return; }
+
+    QJsonObject params;
+    if (type == DensInterface::DensityReflection) {
+        params["type"] = QStringLiteral("reflection");
+    } else if (type == DensInterface::DensityTransmission) {
+        params["type"] = QStringLiteral("transmission");
+    } else {
+        params["type"] = QStringLiteral("unknown");
+    }
+    params["density"] = jsonNumber(dValue);
+    params["zero"] = jsonNumber(dZero);
+    params["raw"] = jsonNumber(rawValue);
+    params["corrected"] = jsonNumber(corrValue);
+    params["uncertainty"] = jsonNumber(dUncertainty);
+    params["quality"] = static_cast<int>(quality);
+    params["time"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs);
+    sendNotification(QStringLiteral("measurement.reading"), params);
+}
+
+void RpcServer::onCheckTimeouts()
+{
+    QList<QJsonValue> expired;
+    for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+        QList<Pending> &queue = it.value();
+        for (auto entry = queue.begin(); entry != queue.end();) {
+            if (!entry->deadline.hasExpired()) {
+                ++entry;
+            } else if (entry->discarded) {
+                // The device is assumed to have dropped the command
+                entry = queue.erase(entry);
+            } else {
+                // Kept in place, so its late response is not
+                // given to the next request waiting on it
+                if (!expired.contains(entry->id)) {
+                    expired.append(entry->id);
+                }
+                if (entry->id.isUndefined()) {
+                    entry->discarded = true;
+                    entry->deadline = QDeadlineTimer(LateResponseTimeout);
+                }
+                ++entry;
+            }
+        }
+    }
+
+    for (const QJsonValue &id : qAsConst(expired)) {
+        failRequest(id, ErrorTimeout, QStringLiteral("Device did not respond"));
+    }
+    finishIfIdle();
+}
+
+void RpcServer::onCommandRejected(DensCommand::CommandType type, DensCommand::CommandCategory category,
+                                  const QString &action, bool unrecognized)
+{
+    Response response;
+    if (!responseForCommand(type, category, action, &response)) { return; }
+
+    // The rejection takes the place of the response, so it
+    // belongs to the oldest request waiting on one
+    QList<Pending> &queue = pending_[response];
+    if (queue.isEmpty()) { return; }
+
+    const Pending pending = queue.takeFirst();
+    if (!pending.discarded) {
+        const QString message = unrecognized
+                ? QStringLiteral("Device could not process %1 (NAK)")
+                : QStringLiteral("Device rejected %1 (ERR)");
+        failRequest(pending.id, ErrorDevice, message.arg(action));
+    }
+    finishIfIdle();
+}
+
+void RpcServer::onCommandNotSent(DensCommand::CommandType type, DensCommand::CommandCategory category,
+                                 const QString &action)
+{
+    Response response;
+    if (!responseForCommand(type, category, action, &response)) { return; }
+
+    // Requests are registered before their commands are sent, so the one
+    // that was not sent is the newest request waiting on this response
+    QList<Pending> &queue = pending_[response];
+    if (queue.isEmpty()) { return; }
+
+    const Pending pending = queue.takeLast();
+    if (!pending.discarded) {
+        failRequest(pending.id, ErrorDevice, QStringLiteral("Unable to send %1 to the device").arg(action));
+    }
+    finishIfIdle();
+}
+
+void RpcServer::expect(Response response, const QJsonValue &id, const Handler &handler, int timeout)
+{
+    Pending pending;
+    pending.id = id;
+    pending.handler = handler;
+    pending.deadline = QDeadlineTimer(timeout);
+    pending_[response].append(pending);
+}
+
+void RpcServer::expectStep(Response response, const QJsonValue &id)
+{
+    Pending pending;
+    pending.id = id;
+    pending.deadline = QDeadlineTimer(DefaultTimeout);
+    pending.step = true;
+    pending_[response].append(pending);
+}
+
+void RpcServer::respond(Response response, const QJsonValue &result)
+{
+    QList<Pending> &queue = pending_[response];
+    if (queue.isEmpty()) { return; }
+
+    const Pending pending = queue.takeFirst();
+    if (pending.discarded) {
+        qDebug() << "Discarding late device response";
+    } else if (pending.step) {
+        // Later responses complete the request
+    } else if (pending.handler) {
+        pending.handler(result);
+    } else {
+        sendResult(pending.id, result);
+    }
+    finishIfIdle();
+}
+
+bool RpcServer::isPending(const QJsonValue &id) const
+{
+    for (const QList<Pending> &queue : qAsConst(pending_)) {
+        for (const Pending &entry : queue) {
+            if (!entry.discarded && entry.id == id) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void RpcServer::failRequest(const QJsonValue &id, int code, const QString &message)
+{
+    // Without an id, entries cannot be told apart from those of other
+    // requests, and there is nobody to send the error to anyway
+    if (id.isUndefined()) { return; }
+
+    // Every other response the request is waiting on still has to be
+    // consumed when it arrives, but must not complete the request
+    bool failed = false;
+    for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+        for (Pending &entry : it.value()) {
+            if (!entry.discarded && entry.id == id) {
+                entry.discarded = true;
+                entry.deadline = QDeadlineTimer(LateResponseTimeout);
+                failed = true;
+            }
+        }
+    }
+
+    if (failed) {
+        sendError(id, code, message);
+    }
+}
+
+void RpcServer::failAll(int code, const QString &message)
+{
+    // Cleared first, so a late device response cannot complete these again
+    const QMap<Response, QList<Pending>> pending = pending_;
+    pending_.clear();
+
+    for (const QList<Pending> &queue : pending) {
+        for (const Pending &entry : queue) {
+            sendError(entry.id, code, message);
+        }
+    }
+}
+
+void RpcServer::closeConnection()
+{
+    if (!transport_) { return; }
+
+    DensTransport *transport = transport_;
+    transport_ = nullptr;
+    subscribed_ = false;
+
+    densInterface_->disconnectFromDevice();
+    transport->close();
+    transport->deleteLater();
+
+    failAll(ErrorNotConnected, QStringLiteral("Connection closed"));
+}
+
+void RpcServer::finishIfIdle()
+{
+    // Input can be piped in all at once, so closing stdin only
+    // ends the session once everything sent has been answered
+    if (!inputClosed_ || exportsPending_ > 0) { return; }
+    for (const QList<Pending> &queue : qAsConst(pending_)) {
+        for (const Pending &entry : queue) {
+            if (!entry.discarded) { return; }
+        }
+    }
+
+    // Cleared first, since closing the connection comes back through here
+    inputClosed_ = false;
+    closeConnection();
+    emit finished();
+}
+
+void RpcServer::sendResult(const QJsonValue &id, const QJsonValue &result)
+{
+    // Notifications from the client are never answered
+    if (id.isUndefined()) { return; }
+
+    QJsonObject message;
+    message["id"] = id;
+    message["result"] = result;
+    writeMessage(message);
+}
+
+void RpcServer::sendError(const QJsonValue &id, int code, const QString &message)
+{
+    if (id.isUndefined()) { return; }
+
+    QJsonObject error;
+    error["code"] = code;
+    error["message"] = message;
+
+    QJsonObject jsonMessage;
+    jsonMessage["id"] = id;
+    jsonMessage["error"] = error;
+    writeMessage(jsonMessage);
+}
+
+void RpcServer::sendNotification(const QString &method, const QJsonObject &params)
+{
+    QJsonObject message;
+    message["method"] = method;
+    if (!params.isEmpty()) {
+        message["params"] = params;
+    }
+    writeMessage(message);
+}
+
+void RpcServer::writeMessage(QJsonObject message)
+{
+    message["jsonrpc"] = QStringLiteral("2.0");
+    std::cout << QJsonDocument(message).toJson(QJsonDocument::Compact).toStdString() << std::endl;
+}
+
+bool RpcServer::responseForCommand(DensCommand::CommandType type, DensCommand::CommandCategory category,
+                                   const QString &action, Response *response)
+{
+    static const struct {
+        DensCommand::CommandType type;
+        DensCommand::CommandCategory category;
+        const char *action;
+        Response response;
+    } commands[] = {
+        { DensCommand::TypeGet, DensCommand::CategorySystem, "B", ResponseSystemBuild },
+        { DensCommand::TypeGet, DensCommand::CategorySystem, "DEV", ResponseSystemDevice },
+        { DensCommand::TypeGet, DensCommand::CategorySystem, "UID", ResponseSystemUid },
+        { DensCommand::TypeGet, DensCommand::CategorySystem, "ISEN", ResponseSystemSensors },
+        { DensCommand::TypeInvoke, DensCommand::CategorySystem, "REMOTE", ResponseRemoteControl },
+        { DensCommand::TypeInvoke, DensCommand::CategoryDiagnostics, "SELFTEST", ResponseSelfTest },
+        { DensCommand::TypeGet, DensCommand::CategoryDiagnostics, "CRASH", ResponseCrashRecord },
+        { DensCommand::TypeGet, DensCommand::CategoryCalibration, "GAIN", ResponseCalGain },
+        { DensCommand::TypeGet, DensCommand::CategoryCalibration, "SLOPE", ResponseCalSlope },
+        { DensCommand::TypeGet, DensCommand::CategoryCalibration, "REFL", ResponseCalReflection },
+        { DensCommand::TypeGet, DensCommand::CategoryCalibration, "TRAN", ResponseCalTransmission },
+        { DensCommand::TypeSet, DensCommand::CategoryCalibration, "GAIN", ResponseCalGainSet },
+        { DensCommand::TypeSet, DensCommand::CategoryCalibration, "SLOPE", ResponseCalSlopeSet },
+        { DensCommand::TypeSet, DensCommand::CategoryCalibration, "REFL", ResponseCalReflectionSet },
+        { DensCommand::TypeSet, DensCommand::CategoryCalibration, "TRAN", ResponseCalTransmissionSet }
+    };
+
+    for (const auto &command : commands) {
+        if (command.type == type && command.category == category
+                && action == QLatin1String(command.action)) {
+            *response = command.response;
+            return true;
+        }
+    }
+    return false;
+}
+
+QJsonValue RpcServer::jsonNumber(float value)
+{
+    // JSON has no way to represent these, and the device uses NaN
+    // for values that are not part of the measurement format
+    if (qIsNaN(value) || qIsInf(value)) {
+        return QJsonValue();
+    }
+    return static_cast<double>(value);
+}
+
+bool RpcServer::readFloatEncoding(const QJsonObject &params, SettingsSchema::FloatEncoding defaultEncoding,
+                                  SettingsSchema::FloatEncoding *encoding)
+{
+    const QJsonValue value = params.value(QLatin1String("floats"));
+    if (value.isUndefined()) {
+        *encoding = defaultEncoding;
+    } else if (value == QLatin1String("decimal")) {
+        *encoding = SettingsSchema::FloatDecimal;
+    } else if (value == QLatin1String("exact")) {
+        *encoding = SettingsSchema::FloatExact;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,182 @@
+#ifndef RPCSERVER_H
+#define RPCSERVER_H
+
+#include <functional>
+#include <QObject>
+#include <QDeadlineTimer>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
+#include <QMap>
+
+#include "densinterface.h"
+#include "settingsschema.h"
+
+class QThread;
+class QTimer;
+
+/**
+ * Headless JSON-RPC 2.0 server, speaking newline-delimited messages
+ * on stdin and stdout, so other tools can drive the device without
+ * implementing its serial protocol.
+ *
+ * Requests are handled as they arrive, without waiting for earlier
+ * ones to finish, so their responses may be sent in a different order.
+ * The device answers commands in the order they were sent, so each
+ * kind of device response is matched to the oldest request still
+ * waiting on it. A request that times out keeps its place until its
+ * late response arrives, which is then discarded, so it cannot be
+ * given to the next request. A command the device rejects with ERR
+ * or NAK fails its request with an error.
+ *
+ * Request ids have to be unique among the requests still waiting
+ * on the device.
+ *
+ * Methods:
+ * - connect {port} - Connect to the device, with the port in the form
+ *   accepted by DensTransport::fromUri(), or the first attached device
+ * - disconnect
+ * - device.info
+ * - measurement.subscribe, measurement.unsubscribe - Control the
+ *   measurement.reading notifications sent for each reading
+ * - calibration.get {floats}, calibration.set {calibration, floats} -
+ *   Calibration values, in the form used by the settings file
+ * - settings.export {floats}, settings.import {settings} - Complete
+ *   settings files, as written and read by the desktop application
+ * - diagnostics.selfTest, diagnostics.crashRecord
+ *
+ * Losing the connection is reported with a device.disconnected
+ * notification. Everything that is not a JSON-RPC message goes to
+ * the debug log on stderr.
+ */
+class RpcServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit RpcServer(QObject *parent = nullptr);
+    ~RpcServer();
+
+    /** Port to connect to when a connect request does not name one */
+    void setPort(const QString &portName);
+
+public slots:
+    void run();
+
+signals:
+    /** Emitted once stdin is closed, and every request has been answered */
+    void finished();
+
+private slots:
+    void onConnectionOpened();
+    void onConnectionClosed();
+    void onConnectionError();
+    void onDensityReading(DensInterface::DensityType type, float dValue, float dZero, float rawValue, float corrValue,
+                          float dUncertainty, DensInterface::ReadingQuality quality);
+    void onCheckTimeouts();
+    void onCommandRejected(DensCommand::CommandType type, DensCommand::CommandCategory category,
+                           const QString &action, bool unrecognized);
+    void onCommandNotSent(DensCommand::CommandType type, DensCommand::CommandCategory category,
+                          const QString &action);
+
+private:
+    enum ErrorCode {
+        ErrorParse = -32700,
+        ErrorInvalidRequest = -32600,
+        ErrorMethodNotFound = -32601,
+        ErrorInvalidParams = -32602,
+        ErrorNotConnected = -32000,
+        ErrorTimeout = -32001,
+        ErrorDevice = -32002
+    };
+
+    /** Kinds of device response that requests can wait on */
+    enum Response {
+        ResponseConnect,
+        ResponseSystemBuild,
+        ResponseSystemDevice,
+        ResponseSystemUid,
+        ResponseSystemSensors,
+        ResponseRemoteControl,
+        ResponseSelfTest,
+        ResponseCrashRecord,
+        ResponseCalGain,
+        ResponseCalSlope,
+        ResponseCalReflection,
+        ResponseCalTransmission,
+        ResponseCalGainSet,
+        ResponseCalSlopeSet,
+        ResponseCalReflectionSet,
+        ResponseCalTransmissionSet
+    };
+
+    typedef std::function<void(const QJsonValue &result)> Handler;
+
+    /**
+     * Request waiting on a device response.
+     *
+     * Without a handler, the response is sent as the result of the
+     * request. A step is one of several device responses waited on by
+     * a single request, and is just consumed. A discarded entry belongs
+     * to a request that has already failed, and only remains to consume
+     * the device response if it still arrives.
+     */
+    struct Pending
+    {
+        QJsonValue id;
+        Handler handler;
+        QDeadlineTimer deadline;
+        bool step = false;
+        bool discarded = false;
+    };
+
+    static const int DefaultTimeout;
+    static const int SelfTestTimeout;
+    static const int LateResponseTimeout;
+
+    void processLine(const QByteArray &line);
+    void processRequest(const QString &method, const QJsonValue &id, const QJsonObject &params);
+
+    void connectStart(const QJsonValue &id, const QJsonObject &params);
+    void disconnectStart(const QJsonValue &id);
+    void deviceInfoStart(const QJsonValue &id);
+    void calibrationGetStart(const QJsonValue &id, const QJsonObject &params);
+    void calibrationSetStart(const QJsonValue &id, const QJsonObject &params);
+    void settingsExportStart(const QJsonValue &id, const QJsonObject &params);
+    void settingsImportStart(const QJsonValue &id, const QJsonObject &params);
+    void selfTestStart(const QJsonValue &id);
+    void crashRecordStart(const QJsonValue &id);
+    void writeCalibration(const QJsonValue &id, QJsonObject root);
+
+    void expect(Response response, const QJsonValue &id = QJsonValue::Undefined,
+                const Handler &handler = nullptr, int timeout = DefaultTimeout);
+    void expectStep(Response response, const QJsonValue &id);
+    void respond(Response response, const QJsonValue &result);
+    bool isPending(const QJsonValue &id) const;
+    void failRequest(const QJsonValue &id, int code, const QString &message);
+    void failAll(int code, const QString &message);
+    void closeConnection();
+    void finishIfIdle();
+
+    void sendResult(const QJsonValue &id, const QJsonValue &result);
+    void sendError(const QJsonValue &id, int code, const QString &message);
+    void sendNotification(const QString &method, const QJsonObject &params);
+    void writeMessage(QJsonObject message);
+
+    static bool responseForCommand(DensCommand::CommandType type, DensCommand::CommandCategory category,
+                                   const QString &action, Response *response);
+    static QJsonValue jsonNumber(float value);
+    static bool readFloatEncoding(const QJsonObject &params, SettingsSchema::FloatEncoding defaultEncoding,
+                                  SettingsSchema::FloatEncoding *encoding);
+
+    QString portName_;
+    DensTransport *transport_ = nullptr;
+    DensInterface *densInterface_ = nullptr;
+    QThread *readerThread_ = nullptr;
+    QTimer *timeoutTimer_ = nullptr;
+    QMap<Response, QList<Pending>> pending_;
+    int exportsPending_ = 0;
+    bool subscribed_ = false;
+    bool inputClosed_ = false;
+};
+
+#endif // RPCSERVER_H
@@ -25,6 +25,11 @@ SettingsExporter::SettingsExporter(DensInterface *densInterface, QObject *parent
     connect(densInterface_, &DensInterface::calTransmissionResponse, this, &SettingsExporter::onCalTransmissionResponse);
 }
 
+void SettingsExporter::setFloatEncoding(SettingsSchema::FloatEncoding encoding)
+{
+    floatEncoding_ = encoding;
+}
+
 void SettingsExporter::prepareExport()
 {
     qDebug() << "Getting all settings for export";
@@ -44,10 +49,21 @@ bool SettingsExporter::saveExport(const QString &filename)
     if (prepareFailed_ || !hasAllData_ || filename.isEmpty()) { return false; }
     qDebug() << "Saving data to file:" << filename;
 
-    // File header information
-    QJsonObject jsonHeader;
-    jsonHeader["version"] = QString::number(1);
-    jsonHeader["date"] = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm");
+    QFile exportFile(filename);
+
+    if (!exportFile.open(QIODevice::WriteOnly)) {
+        qWarning() << "Couldn't open export file.";
+        return false;
+    }
+
+    exportFile.write(QJsonDocument(exportObject()).toJson(QJsonDocument::Indented));
+    exportFile.close();
+    return true;
+}
+
+QJsonObject SettingsExporter::exportObject() const
+{
+    if (prepareFailed_ || !hasAllData_) { return QJsonObject(); }
 
     // General system properties, for reference
     QJsonObject jsonSystem;
@@ -58,81 +74,16 @@ bool SettingsExporter::saveExport(const QString &filename)
     jsonSystem["checksum"] = QString::number(densInterface_->buildChecksum(), 16);
     jsonSystem["uid"] = densInterface_->uniqueId();
 
-    // Sensor calibration
-    QJsonObject jsonCalGain;
-    const DensCalGain calGain = densInterface_->calGain();
-    jsonCalGain["L0"] = QString::number(calGain.low0(), 'f', 6);
-    jsonCalGain["L1"] = QString::number(calGain.low1(), 'f', 6);
-    jsonCalGain["M0"] = QString::number(calGain.med0(), 'f', 6);
-    jsonCalGain["M1"] = QString::number(calGain.med1(), 'f', 6);
-    jsonCalGain["H0"] = QString::number(calGain.high0(), 'f', 6);
-    jsonCalGain["H1"] = QString::number(calGain.high1(), 'f', 6);
-    jsonCalGain["X0"] = QString::number(calGain.max0(), 'f', 6);
-    jsonCalGain["X1"] = QString::number(calGain.max1(), 'f', 6);
-
-    QJsonObject jsonCalSlope;
-    const DensCalSlope calSlope = densInterface_->calSlope();
-    jsonCalSlope["B0"] = QString::number(calSlope.b0(), 'f', 6);
-    jsonCalSlope["B1"] = QString::number(calSlope.b1(), 'f', 6);
-    jsonCalSlope["B2"] = QString::number(calSlope.b2(), 'f', 6);
-
-    QJsonObject jsonCalSensor;
-    jsonCalSensor["gain"] = jsonCalGain;
-    jsonCalSensor["slope"] = jsonCalSlope;
-
-    // Target calibration
-    const DensCalTarget calReflection = densInterface_->calReflection();
-    const DensCalTarget calTransmission = densInterface_->calTransmission();
-
-    QJsonObject jsonCalReflLo;
-    jsonCalReflLo["density"] = QString::number(calReflection.loDensity(), 'f', 2);
-    jsonCalReflLo["reading"] = QString::number(calReflection.loReading(), 'f', 6);
-
-    QJsonObject jsonCalReflHi;
-    jsonCalReflHi["density"] = QString::number(calReflection.hiDensity(), 'f', 2);
-    jsonCalReflHi["reading"] = QString::number(calReflection.hiReading(), 'f', 6);
-
-    QJsonObject jsonCalRefl;
-    jsonCalRefl["cal-lo"] = jsonCalReflLo;
-    jsonCalRefl["cal-hi"] = jsonCalReflHi;
-
-    QJsonObject jsonCalTranLo;
-    jsonCalTranLo["density"] = QString::number(calTransmission.loDensity(), 'f', 2);
-    jsonCalTranLo["reading"] = QString::number(calTransmission.loReading(), 'f', 6);
-
-    QJsonObject jsonCalTranHi;
-    jsonCalTranHi["density"] = QString::number(calTransmission.hiDensity(), 'f', 2);
-    jsonCalTranHi["reading"] = QString::number(calTransmission.hiReading(), 'f', 6);
-
-    QJsonObject jsonCalTran;
-    jsonCalTran["cal-lo"] = jsonCalTranLo;
-    jsonCalTran["cal-hi"] = jsonCalTranHi;
-
-    QJsonObject jsonCalTarget;
-    jsonCalTarget["reflection"] = jsonCalRefl;
-    jsonCalTarget["transmission"] = jsonCalTran;
-
-    // Combining calibration objects
-    QJsonObject jsonCal;
-    jsonCal["sensor"] = jsonCalSensor;
-    jsonCal["target"] = jsonCalTarget;
-
     // Top level JSON object
     QJsonObject jsonExport;
-    jsonExport["header"] = jsonHeader;
+    jsonExport["header"] = SettingsSchema::header(floatEncoding_);
     jsonExport["system"] = jsonSystem;
-    jsonExport["calibration"] = jsonCal;
-
-    QFile exportFile(filename);
-
-    if (!exportFile.open(QIODevice::WriteOnly)) {
-        qWarning() << "Couldn't open export file.";
-        return false;
-    }
+    jsonExport["calibration"] = SettingsSchema::calibrationToJson(
+                densInterface_->calGain(), densInterface_->calSlope(),
+                densInterface_->calReflection(), densInterface_->calTransmission(),
+                floatEncoding_);
 
-    exportFile.write(QJsonDocument(jsonExport).toJson(QJsonDocument::Indented));
-    exportFile.close();
-    return true;
+    return jsonExport;
 }
 
 void SettingsExporter::onPrepareTimeout()
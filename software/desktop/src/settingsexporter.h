@@ -4,6 +4,7 @@
 #include <QObject>
 
 #include "densinterface.h"
+#include "settingsschema.h"
 
 class QTimer;
 
@@ -13,9 +14,14 @@ class SettingsExporter : public QObject
 public:
     explicit SettingsExporter(DensInterface *densInterface, QObject *parent = nullptr);
 
+    void setFloatEncoding(SettingsSchema::FloatEncoding encoding);
+
     void prepareExport();
     bool saveExport(const QString &filename);
 
+    /** Contents of the export file, or an empty object if the export is not ready */
+    QJsonObject exportObject() const;
+
 signals:
     void exportReady();
     void exportFailed();
@@ -35,6 +41,7 @@ private:
     void checkResponses();
 
     DensInterface *densInterface_;
+    SettingsSchema::FloatEncoding floatEncoding_ = SettingsSchema::FloatExact;
     QTimer *timer_ = nullptr;
     bool hasSystemVersion_ = false;
     bool hasSystemBuild_ = false;
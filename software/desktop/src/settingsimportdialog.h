@@ -19,18 +19,16 @@ public:
     explicit SettingsImportDialog(QWidget *parent = nullptr);
     ~SettingsImportDialog();
 
-    bool loadFile(const QString &filename);
+    bool loadFile(const QString &filename, QString *errorString = nullptr);
     void sendSelectedSettings(DensInterface *densInterface);
 
 private slots:
     void onCheckBoxChanged();
 
 private:
-    bool parseHeader(const QJsonObject &root);
-    void parseCalSensor(const QJsonObject &jsonCalSensor);
-    void parseCalTarget(const QJsonObject &jsonCalTarget);
-    int parseInt(const QJsonValue &value);
-    float parseFloat(const QJsonValue &value);
+    void parseHeader(const QJsonObject &root);
+    void parseCalSensor(const QJsonObject &root);
+    void parseCalTarget(const QJsonObject &root);
 
     Ui::SettingsImportDialog *ui;
 
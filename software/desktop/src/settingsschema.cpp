@@ -0,0 +1,616 @@
+#include "settingsschema.h"
+
+#include <QDateTime>
+#include <QJsonValue>
+#include <QRegularExpression>
+#include <QStringList>
+#include <cfloat>
+#include <cmath>
+
+#include "util.h"
+
+const int SettingsSchema::CurrentVersion = 2;
+
+namespace
+{
+typedef SettingsSchema::Issue Issue;
+typedef SettingsSchema::FloatEncoding FloatEncoding;
+
+static const QStringList GAIN_KEYS = { "L0", "L1", "M0", "M1", "H0", "H1", "X0", "X1" };
+static const QStringList SLOPE_KEYS = { "B0", "B1", "B2" };
+static const QStringList TARGET_KEYS = { "cal-lo", "cal-hi" };
+static const QStringList TARGET_POINT_KEYS = { "density", "reading" };
+
+// Highest gain multiplier accepted for the sensor, which leaves some headroom
+static const float GAIN_MAX = 10000.0F;
+
+// Density limits of the device, for each measurement mode
+static const float REFLECTION_MAX_D = 2.50F;
+static const float TRANSMISSION_MAX_D = 5.00F;
+
+QString joinPath(const QString &parent, const QString &key)
+{
+    return parent.isEmpty() ? key : parent + QLatin1Char('.') + key;
+}
+
+void addIssue(QList<Issue> *issues, const QString &path, const QString &message)
+{
+    if (issues) {
+        Issue issue;
+        issue.path = path;
+        issue.message = message;
+        issues->append(issue);
+    }
+}
+
+FloatEncoding fileEncoding(const QJsonObject &root)
+{
+    const QString floats = root["header"].toObject()["floats"].toString();
+    return (floats == QLatin1String("exact")) ? SettingsSchema::FloatExact : SettingsSchema::FloatDecimal;
+}
+
+QJsonValue encodeFloat(float value, FloatEncoding encoding)
+{
+    if (encoding == SettingsSchema::FloatExact) {
+        return util::encode_f32(value);
+    } else {
+        return static_cast<double>(value);
+    }
+}
+
+/**
+ * Decode a calibration value.
+ *
+ * @return Empty string on success, or the reason the value cannot be used
+ */
+QString decodeFloat(const QJsonValue &value, FloatEncoding encoding, float *result)
+{
+    static const QRegularExpression hexPattern(QStringLiteral("^[0-9A-Fa-f]{8}$"));
+
+    float decoded;
+    if (encoding == SettingsSchema::FloatExact) {
+        if (!value.isString() || !hexPattern.match(value.toString()).hasMatch()) {
+            return QStringLiteral("expected an exact value, as 8 hex digits");
+        }
+        decoded = util::decode_f32(value.toString());
+    } else {
+        if (!value.isDouble()) {
+            return QStringLiteral("expected a number");
+        }
+        const double number = value.toDouble();
+        if (std::fabs(number) > FLT_MAX) {
+            return QStringLiteral("value is out of range");
+        }
+        decoded = static_cast<float>(number);
+    }
+
+    if (!std::isfinite(decoded)) {
+        return QStringLiteral("value is not a finite number");
+    }
+
+    if (result) { *result = decoded; }
+    return QString();
+}
+
+float readFloat(const QJsonObject &parent, const QString &key, FloatEncoding encoding)
+{
+    float value;
+    return decodeFloat(parent.value(key), encoding, &value).isEmpty() ? value : qSNaN();
+}
+
+bool checkFloat(const QJsonObject &parent, const QString &parentPath, const QString &key,
+                FloatEncoding encoding, float *result, QList<Issue> *issues)
+{
+    const QString path = joinPath(parentPath, key);
+    if (!parent.contains(key)) {
+        addIssue(issues, path, QStringLiteral("missing value"));
+        return false;
+    }
+
+    const QString error = decodeFloat(parent.value(key), encoding, result);
+    if (!error.isEmpty()) {
+        addIssue(issues, path, error);
+        return false;
+    }
+    return true;
+}
+
+void checkKeys(const QJsonObject &obj, const QString &path, const QStringList &allowed, QList<Issue> *issues)
+{
+    const QStringList keys = obj.keys();
+    for (const QString &key : keys) {
+        if (!allowed.contains(key)) {
+            addIssue(issues, joinPath(path, key), QStringLiteral("unexpected key"));
+        }
+    }
+}
+
+/**
+ * Get an optional child object, reporting it if it is not an object.
+ *
+ * @return True if the child is present and is an object
+ */
+bool checkObject(const QJsonObject &parent, const QString &parentPath, const QString &key,
+                 QJsonObject *result, QList<Issue> *issues)
+{
+    if (!parent.contains(key)) { return false; }
+
+    if (!parent.value(key).isObject()) {
+        addIssue(issues, joinPath(parentPath, key), QStringLiteral("expected an object"));
+        return false;
+    }
+
+    *result = parent.value(key).toObject();
+    return true;
+}
+
+DensCalGain gainFromJson(const QJsonObject &jsonGain, FloatEncoding encoding)
+{
+    DensCalGain calGain;
+    calGain.setLow0(readFloat(jsonGain, "L0", encoding));
+    calGain.setLow1(readFloat(jsonGain, "L1", encoding));
+    calGain.setMed0(readFloat(jsonGain, "M0", encoding));
+    calGain.setMed1(readFloat(jsonGain, "M1", encoding));
+    calGain.setHigh0(readFloat(jsonGain, "H0", encoding));
+    calGain.setHigh1(readFloat(jsonGain, "H1", encoding));
+    calGain.setMax0(readFloat(jsonGain, "X0", encoding));
+    calGain.setMax1(readFloat(jsonGain, "X1", encoding));
+    return calGain;
+}
+
+DensCalSlope slopeFromJson(const QJsonObject &jsonSlope, FloatEncoding encoding)
+{
+    DensCalSlope calSlope;
+    calSlope.setB0(readFloat(jsonSlope, "B0", encoding));
+    calSlope.setB1(readFloat(jsonSlope, "B1", encoding));
+    calSlope.setB2(readFloat(jsonSlope, "B2", encoding));
+    return calSlope;
+}
+
+DensCalTarget targetFromJson(const QJsonObject &jsonTarget, FloatEncoding encoding)
+{
+    const QJsonObject jsonLo = jsonTarget["cal-lo"].toObject();
+    const QJsonObject jsonHi = jsonTarget["cal-hi"].toObject();
+
+    DensCalTarget calTarget;
+    calTarget.setLoDensity(readFloat(jsonLo, "density", encoding));
+    calTarget.setLoReading(readFloat(jsonLo, "reading", encoding));
+    calTarget.setHiDensity(readFloat(jsonHi, "density", encoding));
+    calTarget.setHiReading(readFloat(jsonHi, "reading", encoding));
+    return calTarget;
+}
+
+QJsonObject targetToJson(const DensCalTarget &calTarget, FloatEncoding encoding)
+{
+    QJsonObject jsonLo;
+    jsonLo["density"] = encodeFloat(calTarget.loDensity(), encoding);
+    jsonLo["reading"] = encodeFloat(calTarget.loReading(), encoding);
+
+    QJsonObject jsonHi;
+    jsonHi["density"] = encodeFloat(calTarget.hiDensity(), encoding);
+    jsonHi["reading"] = encodeFloat(calTarget.hiReading(), encoding);
+
+    QJsonObject jsonTarget;
+    jsonTarget["cal-lo"] = jsonLo;
+    jsonTarget["cal-hi"] = jsonHi;
+    return jsonTarget;
+}
+
+void validateGain(const QJsonObject &jsonGain, const QString &path, FloatEncoding encoding, QList<Issue> *issues)
+{
+    checkKeys(jsonGain, path, GAIN_KEYS, issues);
+
+    bool complete = true;
+    for (int i = 0; i < GAIN_KEYS.size(); i++) {
+        const QString &key = GAIN_KEYS.at(i);
+        float value;
+        if (!checkFloat(jsonGain, path, key, encoding, &value, issues)) {
+            complete = false;
+            continue;
+        }
+
+        // The low gain is the reference for all the others
+        if (key.startsWith(QLatin1Char('L'))) {
+            if (qAbs(1.0F - value) > 0.001F) {
+                addIssue(issues, joinPath(path, key), QStringLiteral("low gain must be 1.0"));
+                complete = false;
+            }
+        } else if (value <= 1.0F || value > GAIN_MAX) {
+            addIssue(issues, joinPath(path, key),
+                     QStringLiteral("gain must be above 1.0 and at most %1").arg(GAIN_MAX, 0, 'f', 1));
+            complete = false;
+        }
+    }
+
+    if (complete && !gainFromJson(jsonGain, encoding).isValid()) {
+        addIssue(issues, path, QStringLiteral("gains must increase from low to maximum"));
+    }
+}
+
+void validateSlope(const QJsonObject &jsonSlope, const QString &path, FloatEncoding encoding, QList<Issue> *issues)
+{
+    checkKeys(jsonSlope, path, SLOPE_KEYS, issues);
+
+    for (const QString &key : SLOPE_KEYS) {
+        checkFloat(jsonSlope, path, key, encoding, nullptr, issues);
+    }
+}
+
+void validateTarget(const QJsonObject &jsonTarget, const QString &path, FloatEncoding encoding,
+                    bool reflection, QList<Issue> *issues)
+{
+    const float maxDensity = reflection ? REFLECTION_MAX_D : TRANSMISSION_MAX_D;
+
+    checkKeys(jsonTarget, path, TARGET_KEYS, issues);
+
+    bool complete = true;
+    for (const QString &key : TARGET_KEYS) {
+        const QString pointPath = joinPath(path, key);
+        QJsonObject jsonPoint;
+        if (!checkObject(jsonTarget, path, key, &jsonPoint, issues)) {
+            if (!jsonTarget.contains(key)) {
+                addIssue(issues, pointPath, QStringLiteral("missing object"));
+            }
+            complete = false;
+            continue;
+        }
+        checkKeys(jsonPoint, pointPath, TARGET_POINT_KEYS, issues);
+
+        float density;
+        if (checkFloat(jsonPoint, pointPath, "density", encoding, &density, issues)) {
+            if (density < 0.0F || density > maxDensity) {
+                addIssue(issues, joinPath(pointPath, "density"),
+                         QStringLiteral("density must be between 0.00 and %1").arg(maxDensity, 0, 'f', 2));
+                complete = false;
+            }
+        } else {
+            complete = false;
+        }
+
+        float reading;
+        if (checkFloat(jsonPoint, pointPath, "reading", encoding, &reading, issues)) {
+            if (reading <= 0.0F) {
+                addIssue(issues, joinPath(pointPath, "reading"), QStringLiteral("reading must be above zero"));
+                complete = false;
+            }
+        } else {
+            complete = false;
+        }
+    }
+
+    if (!complete) { return; }
+
+    const DensCalTarget calTarget = targetFromJson(jsonTarget, encoding);
+    if (reflection && !calTarget.isValidReflection()) {
+        addIssue(issues, path, QStringLiteral("CAL-LO density must be above zero, and CAL-HI must have "
+                                              "a higher density and a lower reading than CAL-LO"));
+    } else if (!reflection && !calTarget.isValidTransmission()) {
+        addIssue(issues, path, QStringLiteral("CAL-LO density must be zero, and CAL-HI must have "
+                                              "a higher density and a lower reading than CAL-LO"));
+    }
+}
+
+/**
+ * Convert the decimal strings of one part of a version 1 calibration
+ * into numbers.
+ *
+ * @return False if the part was never set on the device, which version 1
+ *         wrote as "nan" values and later versions leave out instead
+ */
+bool convertVersion1Values(QJsonObject *obj)
+{
+    for (auto it = obj->begin(); it != obj->end(); ++it) {
+        if (it.value().isObject()) {
+            QJsonObject child = it.value().toObject();
+            if (!convertVersion1Values(&child)) { return false; }
+            it.value() = QJsonValue(child);
+        } else if (it.value().isString()) {
+            bool ok;
+            const float value = it.value().toString().toFloat(&ok);
+            if (ok && qIsNaN(value)) { return false; }
+
+            // Anything unreadable is left for validation to report
+            if (ok) { it.value() = QJsonValue(static_cast<double>(value)); }
+        }
+    }
+    return true;
+}
+
+void migrateVersion1Section(QJsonObject *parent, const QString &key)
+{
+    if (!parent->value(key).isObject()) { return; }
+
+    QJsonObject section = parent->value(key).toObject();
+    if (convertVersion1Values(&section)) {
+        parent->insert(key, section);
+    } else {
+        parent->remove(key);
+    }
+}
+
+/*
+ * Version 1 had a string version number, and wrote every calibration
+ * value as a decimal string rounded to a fixed number of places.
+ */
+void migrateVersion1(QJsonObject *root)
+{
+    QJsonObject jsonHeader = root->value("header").toObject();
+    jsonHeader["version"] = 2;
+    jsonHeader["floats"] = QStringLiteral("decimal");
+    root->insert("header", jsonHeader);
+
+    if (!root->value("calibration").isObject()) { return; }
+    QJsonObject jsonCal = root->value("calibration").toObject();
+
+    if (jsonCal["sensor"].isObject()) {
+        QJsonObject jsonCalSensor = jsonCal["sensor"].toObject();
+        migrateVersion1Section(&jsonCalSensor, "gain");
+        migrateVersion1Section(&jsonCalSensor, "slope");
+        jsonCal["sensor"] = jsonCalSensor;
+    }
+    if (jsonCal["target"].isObject()) {
+        QJsonObject jsonCalTarget = jsonCal["target"].toObject();
+        migrateVersion1Section(&jsonCalTarget, "reflection");
+        migrateVersion1Section(&jsonCalTarget, "transmission");
+        jsonCal["target"] = jsonCalTarget;
+    }
+
+    root->insert("calibration", jsonCal);
+}
+
+typedef void (*MigrationFunc)(QJsonObject *root);
+
+struct Migration
+{
+    int fromVersion;
+    MigrationFunc func;
+};
+
+// Each migration upgrades a file by exactly one version
+static const Migration MIGRATIONS[] = {
+    { 1, migrateVersion1 }
+};
+
+/**
+ * Get the version of a settings file, where files without one are
+ * assumed to be version 1.
+ */
+bool readVersion(const QJsonObject &root, int *version, QList<Issue> *issues)
+{
+    const QJsonValue value = root["header"].toObject()["version"];
+    bool ok = true;
+    if (value.isUndefined()) {
+        *version = 1;
+    } else if (value.isString()) {
+        *version = value.toString().toInt(&ok);
+    } else if (value.isDouble() && value.toDouble() == static_cast<double>(value.toInt())) {
+        *version = value.toInt();
+    } else {
+        ok = false;
+    }
+
+    if (!ok) {
+        addIssue(issues, QStringLiteral("header.version"), QStringLiteral("expected a version number"));
+    }
+    return ok;
+}
+}
+
+QJsonObject SettingsSchema::header(FloatEncoding encoding)
+{
+    QJsonObject jsonHeader;
+    jsonHeader["version"] = CurrentVersion;
+    jsonHeader["date"] = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm");
+    jsonHeader["floats"] = (encoding == FloatExact) ? QStringLiteral("exact") : QStringLiteral("decimal");
+    return jsonHeader;
+}
+
+QJsonObject SettingsSchema::calibrationToJson(const DensCalGain &calGain, const DensCalSlope &calSlope,
+                                              const DensCalTarget &calReflection, const DensCalTarget &calTransmission,
+                                              FloatEncoding encoding)
+{
+    // Calibration that is not set on the device is left out
+    QJsonObject jsonCalSensor;
+    if (calGain.isValid()) {
+        QJsonObject jsonCalGain;
+        jsonCalGain["L0"] = encodeFloat(calGain.low0(), encoding);
+        jsonCalGain["L1"] = encodeFloat(calGain.low1(), encoding);
+        jsonCalGain["M0"] = encodeFloat(calGain.med0(), encoding);
+        jsonCalGain["M1"] = encodeFloat(calGain.med1(), encoding);
+        jsonCalGain["H0"] = encodeFloat(calGain.high0(), encoding);
+        jsonCalGain["H1"] = encodeFloat(calGain.high1(), encoding);
+        jsonCalGain["X0"] = encodeFloat(calGain.max0(), encoding);
+        jsonCalGain["X1"] = encodeFloat(calGain.max1(), encoding);
+        jsonCalSensor["gain"] = jsonCalGain;
+    }
+    if (calSlope.isValid()) {
+        QJsonObject jsonCalSlope;
+        jsonCalSlope["B0"] = encodeFloat(calSlope.b0(), encoding);
+        jsonCalSlope["B1"] = encodeFloat(calSlope.b1(), encoding);
+        jsonCalSlope["B2"] = encodeFloat(calSlope.b2(), encoding);
+        jsonCalSensor["slope"] = jsonCalSlope;
+    }
+
+    QJsonObject jsonCalTarget;
+    if (calReflection.isValidReflection()) {
+        jsonCalTarget["reflection"] = targetToJson(calReflection, encoding);
+    }
+    if (calTransmission.isValidTransmission()) {
+        jsonCalTarget["transmission"] = targetToJson(calTransmission, encoding);
+    }
+
+    QJsonObject jsonCal;
+    jsonCal["sensor"] = jsonCalSensor;
+    jsonCal["target"] = jsonCalTarget;
+    return jsonCal;
+}
+
+QList<SettingsSchema::Issue> SettingsSchema::load(QJsonObject *root)
+{
+    QList<Issue> issues;
+    if (!migrate(root, &issues)) {
+        return issues;
+    }
+    return validate(*root);
+}
+
+bool SettingsSchema::migrate(QJsonObject *root, QList<Issue> *issues)
+{
+    int version;
+    if (!readVersion(*root, &version, issues)) {
+        return false;
+    }
+
+    if (version > CurrentVersion) {
+        addIssue(issues, QStringLiteral("header.version"),
+                 QStringLiteral("version %1 is newer than this application supports").arg(version));
+        return false;
+    }
+
+    while (version < CurrentVersion) {
+        MigrationFunc func = nullptr;
+        for (const Migration &migration : MIGRATIONS) {
+            if (migration.fromVersion == version) {
+                func = migration.func;
+                break;
+            }
+        }
+        if (!func) {
+            addIssue(issues, QStringLiteral("header.version"),
+                     QStringLiteral("unable to upgrade from version %1").arg(version));
+            return false;
+        }
+
+        func(root);
+        version++;
+    }
+    return true;
+}
+
+QList<SettingsSchema::Issue> SettingsSchema::validate(const QJsonObject &root)
+{
+    QList<Issue> issues;
+
+    checkKeys(root, QString(), { "header", "system", "calibration" }, &issues);
+
+    QJsonObject jsonHeader;
+    if (!root.contains("header")) {
+        addIssue(&issues, QStringLiteral("header"), QStringLiteral("missing object"));
+    } else if (checkObject(root, QString(), "header", &jsonHeader, &issues)) {
+        checkKeys(jsonHeader, "header", { "version", "date", "floats" }, &issues);
+
+        const QJsonValue version = jsonHeader["version"];
+        if (!version.isDouble() || version.toDouble() != static_cast<double>(CurrentVersion)) {
+            addIssue(&issues, QStringLiteral("header.version"),
+                     QStringLiteral("expected version %1").arg(CurrentVersion));
+        }
+        if (jsonHeader.contains("date") && !jsonHeader["date"].isString()) {
+            addIssue(&issues, QStringLiteral("header.date"), QStringLiteral("expected a string"));
+        }
+        const QString floats = jsonHeader["floats"].toString();
+        if (floats != QLatin1String("decimal") && floats != QLatin1String("exact")) {
+            addIssue(&issues, QStringLiteral("header.floats"), QStringLiteral("expected \"decimal\" or \"exact\""));
+        }
+    }
+
+    // System properties are only kept for reference, so any are allowed
+    QJsonObject jsonSystem;
+    if (checkObject(root, QString(), "system", &jsonSystem, &issues)) {
+        for (auto it = jsonSystem.constBegin(); it != jsonSystem.constEnd(); ++it) {
+            if (!it.value().isString()) {
+                addIssue(&issues, joinPath("system", it.key()), QStringLiteral("expected a string"));
+            }
+        }
+    }
+
+    const FloatEncoding encoding = fileEncoding(root);
+    QJsonObject jsonCal;
+    if (!root.contains("calibration")) {
+        addIssue(&issues, QStringLiteral("calibration"), QStringLiteral("missing object"));
+    } else if (checkObject(root, QString(), "calibration", &jsonCal, &issues)) {
+        checkKeys(jsonCal, "calibration", { "sensor", "target" }, &issues);
+
+        QJsonObject jsonCalSensor;
+        if (checkObject(jsonCal, "calibration", "sensor", &jsonCalSensor, &issues)) {
+            checkKeys(jsonCalSensor, "calibration.sensor", { "gain", "slope" }, &issues);
+
+            QJsonObject jsonCalGain;
+            if (checkObject(jsonCalSensor, "calibration.sensor", "gain", &jsonCalGain, &issues)) {
+                validateGain(jsonCalGain, "calibration.sensor.gain", encoding, &issues);
+            }
+            QJsonObject jsonCalSlope;
+            if (checkObject(jsonCalSensor, "calibration.sensor", "slope", &jsonCalSlope, &issues)) {
+                validateSlope(jsonCalSlope, "calibration.sensor.slope", encoding, &issues);
+            }
+        }
+
+        QJsonObject jsonCalTarget;
+        if (checkObject(jsonCal, "calibration", "target", &jsonCalTarget, &issues)) {
+            checkKeys(jsonCalTarget, "calibration.target", { "reflection", "transmission" }, &issues);
+
+            QJsonObject jsonCalRefl;
+            if (checkObject(jsonCalTarget, "calibration.target", "reflection", &jsonCalRefl, &issues)) {
+                validateTarget(jsonCalRefl, "calibration.target.reflection", encoding, true, &issues);
+            }
+            QJsonObject jsonCalTran;
+            if (checkObject(jsonCalTarget, "calibration.target", "transmission", &jsonCalTran, &issues)) {
+                validateTarget(jsonCalTran, "calibration.target.transmission", encoding, false, &issues);
+            }
+        }
+    }
+
+    return issues;
+}
+
+QString SettingsSchema::formatIssues(const QList<Issue> &issues)
+{
+    QStringList lines;
+    for (const Issue &issue : issues) {
+        lines.append(QStringLiteral("%1: %2").arg(issue.path, issue.message));
+    }
+    return lines.join(QLatin1Char('\n'));
+}
+
+bool SettingsSchema::readCalGain(const QJsonObject &root, DensCalGain *calGain)
+{
+    const QJsonObject jsonCalSensor = root["calibration"].toObject()["sensor"].toObject();
+    if (!jsonCalSensor["gain"].isObject()) { return false; }
+
+    if (calGain) {
+        *calGain = gainFromJson(jsonCalSensor["gain"].toObject(), fileEncoding(root));
+    }
+    return true;
+}
+
+bool SettingsSchema::readCalSlope(const QJsonObject &root, DensCalSlope *calSlope)
+{
+    const QJsonObject jsonCalSensor = root["calibration"].toObject()["sensor"].toObject();
+    if (!jsonCalSensor["slope"].isObject()) { return false; }
+
+    if (calSlope) {
+        *calSlope = slopeFromJson(jsonCalSensor["slope"].toObject(), fileEncoding(root));
+    }
+    return true;
+}
+
+bool SettingsSchema::readCalReflection(const QJsonObject &root, DensCalTarget *calTarget)
+{
+    const QJsonObject jsonCalTarget = root["calibration"].toObject()["target"].toObject();
+    if (!jsonCalTarget["reflection"].isObject()) { return false; }
+
+    if (calTarget) {
+        *calTarget = targetFromJson(jsonCalTarget["reflection"].toObject(), fileEncoding(root));
+    }
+    return true;
+}
+
+bool SettingsSchema::readCalTransmission(const QJsonObject &root, DensCalTarget *calTarget)
+{
+    const QJsonObject jsonCalTarget = root["calibration"].toObject()["target"].toObject();
+    if (!jsonCalTarget["transmission"].isObject()) { return false; }
+
+    if (calTarget) {
+        *calTarget = targetFromJson(jsonCalTarget["transmission"].toObject(), fileEncoding(root));
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef SETTINGSSCHEMA_H
+#define SETTINGSSCHEMA_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+#include "denscalvalues.h"
+
+/**
+ * Schema of the device settings files written by SettingsExporter.
+ *
+ * Each file has an integer format version in its header. Files written
+ * by older versions of the application are upgraded to the current
+ * version by a chain of migrations, one version at a time, and are then
+ * checked against the schema before any of their values are used.
+ */
+class SettingsSchema
+{
+public:
+    /** Format version written to new files */
+    static const int CurrentVersion;
+
+    enum FloatEncoding {
+        FloatDecimal, /*!< JSON numbers, which are easier to read */
+        FloatExact    /*!< Hex encoded IEEE-754 bits, in the same form as the device protocol */
+    };
+
+    /** Problem found in a settings file */
+    struct Issue
+    {
+        QString path;    /*!< Path of the value, such as "calibration.sensor.gain.M0" */
+        QString message;
+    };
+
+    static QJsonObject header(FloatEncoding encoding);
+    static QJsonObject calibrationToJson(const DensCalGain &calGain, const DensCalSlope &calSlope,
+                                         const DensCalTarget &calReflection, const DensCalTarget &calTransmission,
+                                         FloatEncoding encoding);
+
+    /**
+     * Upgrade the contents of a settings file to the current version,
+     * then validate them.
+     *
+     * @return Every problem found, which is empty if the file can be used
+     */
+    static QList<Issue> load(QJsonObject *root);
+
+    /**
+     * Upgrade the contents of a settings file to the current version.
+     *
+     * @return False if there is no way to upgrade from the file's version
+     */
+    static bool migrate(QJsonObject *root, QList<Issue> *issues);
+
+    /**
+     * Check the contents of a settings file at the current version,
+     * reporting every problem rather than stopping at the first.
+     */
+    static QList<Issue> validate(const QJsonObject &root);
+
+    static QString formatIssues(const QList<Issue> &issues);
+
+    /*
+     * Read values from validated file contents, returning false
+     * if the file does not include that part of the calibration.
+     */
+    static bool readCalGain(const QJsonObject &root, DensCalGain *calGain);
+    static bool readCalSlope(const QJsonObject &root, DensCalSlope *calSlope);
+    static bool readCalReflection(const QJsonObject &root, DensCalTarget *calTarget);
+    static bool readCalTransmission(const QJsonObject &root, DensCalTarget *calTarget);
+
+private:
+    SettingsSchema() = delete;
+};
+
+#endif // SETTINGSSCHEMA_H
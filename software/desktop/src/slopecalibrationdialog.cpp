@@ -2,6 +2,9 @@
 #include "ui_slopecalibrationdialog.h"
 
 #include <QClipboard>
+#include <QFileDialog>
+#include <QInputDialog>
+#include <QMessageBox>
 #include <QMimeData>
 #include <QStyledItemDelegate>
 #include <QThread>
@@ -9,6 +12,7 @@
 #include <QDebug>
 #include <cmath>
 #include "floatitemdelegate.h"
+#include "steptablet.h"
 #include "util.h"
 
 //TODO Find a way to store the raw floats, rather than being limited by string formatting
@@ -38,6 +42,8 @@ SlopeCalibrationDialog::SlopeCalibrationDialog(DensInterface *densInterface, QWi
 
     connect(ui->calculatePushButton, &QPushButton::clicked, this, &SlopeCalibrationDialog::onCalculateResults);
     connect(ui->clearPushButton, &QPushButton::clicked, this, &SlopeCalibrationDialog::onClearReadings);
+    connect(ui->alignPushButton, &QPushButton::clicked, this, &SlopeCalibrationDialog::onAlignReadings);
+    connect(ui->importTabletPushButton, &QPushButton::clicked, this, &SlopeCalibrationDialog::onImportTablet);
 
     model_ = new QStandardItemModel(22, 2, this);
     model_->setHorizontalHeaderLabels(QStringList() << tr("Density") << tr("Raw Reading"));
@@ -60,9 +66,8 @@ SlopeCalibrationDialog::SlopeCalibrationDialog(DensInterface *densInterface, QWi
     ui->buttonBox->button(QDialogButtonBox::Ok)->setEnabled(false);
 
     // Preload calibrated numbers for the step wedge, with basic validation,
-    // if they have been stored in app settings. As this is primarily intended
-    // to help with device manufacturing use cases, no UI is currently provided
-    // for populating this data.
+    // if they have been stored in app settings. This is used when no
+    // tablet has been selected from the reference library.
     QSettings settings;
     QVariantList scaleList = settings.value("slope_calibration/scale").toList();
     if (!scaleList.isEmpty()) {
@@ -76,6 +81,10 @@ SlopeCalibrationDialog::SlopeCalibrationDialog(DensInterface *densInterface, QWi
             }
         }
     }
+
+    reloadTablets(settings.value("slope_calibration/tablet").toString());
+    connect(ui->tabletComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &SlopeCalibrationDialog::onTabletChanged);
 }
 
 SlopeCalibrationDialog::~SlopeCalibrationDialog()
@@ -265,18 +274,41 @@ void SlopeCalibrationDialog::onActionDelete()
 void SlopeCalibrationDialog::onCalculateResults()
 {
     qDebug() << "Calculate Results";
-    QList<float> xList;
-    QList<float> yList;
-    float base_measurement = qSNaN();
+    QList<float> densities;
+    QList<float> readings;
 
     for (int row = 0; row < model_->rowCount(); row++) {
         float density = itemValueAsFloat(row, 0);
-        float measurement = itemValueAsFloat(row, 1);
-        if (qIsNaN(density) || qIsNaN(measurement)) {
+        if (qIsNaN(density)) {
             break;
         }
+        densities.append(density);
+        readings.append(itemValueAsFloat(row, 1));
+    }
+
+    auto beta = calculateSlope(densities, readings);
+    if (qIsNaN(std::get<0>(beta))) {
+        return;
+    }
+
+    ui->b0LineEdit->setText(QString::number(std::get<0>(beta), 'f'));
+    ui->b1LineEdit->setText(QString::number(std::get<1>(beta), 'f'));
+    ui->b2LineEdit->setText(QString::number(std::get<2>(beta), 'f'));
+    calValues_ = beta;
+    ui->buttonBox->button(QDialogButtonBox::Ok)->setEnabled(true);
+}
+
+std::tuple<float, float, float> SlopeCalibrationDialog::calculateSlope(const QList<float> &densities, const QList<float> &readings)
+{
+    QList<float> xList;
+    QList<float> yList;
+    float base_measurement = qSNaN();
+
+    for (int row = 0; row < densities.size() && row < readings.size(); row++) {
+        float density = densities.at(row);
+        float measurement = readings.at(row);
         if (row == 0) {
-            if (density < 0.0F || density > 0.001F) {
+            if (qIsNaN(measurement) || density < 0.0F || density > 0.001F) {
                 qDebug() << "First row density must be zero:" << density;
                 break;
             }
@@ -285,6 +317,10 @@ void SlopeCalibrationDialog::onCalculateResults()
             yList.append(x);
             base_measurement = measurement;
         } else {
+            // Patches without a reading were skipped during capture
+            if (qIsNaN(density) || qIsNaN(measurement)) {
+                continue;
+            }
             float x = std::log10(measurement);
             float y = std::log10(base_measurement / std::pow(10.0F, density));
             xList.append(x);
@@ -294,119 +330,144 @@ void SlopeCalibrationDialog::onCalculateResults()
     qDebug() << "Have" << xList.size() << "rows of data";
     if (xList.size() < 5) {
         qDebug() << "Not enough rows of data";
-        return;
+        return {qSNaN(), qSNaN(), qSNaN()};
     }
 
-    auto beta = polyfit(xList, yList);
-    ui->b0LineEdit->setText(QString::number(std::get<0>(beta), 'f'));
-    ui->b1LineEdit->setText(QString::number(std::get<1>(beta), 'f'));
-    ui->b2LineEdit->setText(QString::number(std::get<2>(beta), 'f'));
-    calValues_ = beta;
-    ui->buttonBox->button(QDialogButtonBox::Ok)->setEnabled(true);
+    return util::polyfit(xList, yList);
 }
 
-std::tuple<float, float, float> SlopeCalibrationDialog::polyfit(const QList<float> &xList, const QList<float> &yList)
+void SlopeCalibrationDialog::onClearReadings()
 {
-    // Polynomial Fitting, based on this implementation:
-    // https://www.bragitoff.com/2018/06/polynomial-fitting-c-program/
-
-    if (xList.isEmpty() || xList.size() != yList.size()) {
-        return {qSNaN(), qSNaN(), qSNaN()};
+    for (int i = 0; i < model_->rowCount(); i++) {
+        model_->setItem(i, 1, nullptr);
     }
+    QModelIndex index = model_->index(0, 0);
+    ui->tableView->setCurrentIndex(index);
+    ui->tableView->selectionModel()->clearSelection();
+    ui->tableView->setColumnWidth(0, 80);
+    ui->tableView->setColumnWidth(1, 150);
+    ui->tableView->scrollToTop();
+}
 
-    // Number of data points
-    const int N = xList.size();
-
-    // Degree of polynomial
-    const int n = 2;
+void SlopeCalibrationDialog::onTabletChanged(int index)
+{
+    const QString serial = ui->tabletComboBox->itemData(index).toString();
+    QSettings settings;
+    settings.setValue("slope_calibration/tablet", serial);
+    ui->alignmentLabel->clear();
 
-    // An array of size 2*n+1 for storing N, Sig xi, Sig xi^2, ....
-    // which are the independent components of the normal matrix
-    double X[2*n+1];
-    for (int i=0; i <= 2 * n; i++) {
-        X[i] = 0;
-        for (int j=0; j < N; j++) {
-            X[i] = X[i] + std::pow((double)xList[j], i);
-        }
+    if (serial.isEmpty()) {
+        return;
     }
 
-    // The normal augmented matrix
-    //double B[n+1][n+2];
-    double **B = util::make2DArray(n+1, n+2);
-    // rhs
-    double Y[n+1];
-    for (int i = 0; i <= n; i++) {
-        Y[i] = 0;
-        for (int j=0; j < N; j++) {
-            Y[i] = Y[i] + std::pow((double)xList[j], i) * (double)yList[j];
-        }
-    }
-    for (int i = 0; i <= n; i++) {
-        for (int j = 0; j <= n; j++) {
-            B[i][j] = X[i + j];
-        }
+    const StepTablet tablet = StepTabletLibrary::tablet(serial);
+    const QList<float> densities = tablet.densities();
+
+    // The first row is always the zero density reading, without the tablet
+    model_->setRowCount(densities.size() + 1);
+    model_->setItem(0, 0, new QStandardItem(QString::number(0.0F, 'f', 2)));
+    for (int i = 0; i < densities.size(); i++) {
+        model_->setItem(i + 1, 0, new QStandardItem(QString::number(densities.at(i), 'f', 2)));
     }
-    for (int i = 0; i <= n; i++) {
-        B[i][n + 1] = Y[i];
+
+    QStringList verticalLabels;
+    for (int i = 0; i < model_->rowCount(); i++) {
+        verticalLabels.append(QString::number(i));
     }
+    model_->setVerticalHeaderLabels(verticalLabels);
+}
 
-    double A[n+1];
-    gaussEliminationLS(n+1, n+2, B, A);
+void SlopeCalibrationDialog::onImportTablet()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Import Reference Tablet"), QString(),
+                                                          tr("Reference Data (*.csv *.txt *.cgats *.cxf *.it8);;All Files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
 
-    for(int i = 0; i <= n; i++) {
-        qDebug().nospace() << "B[" << i << "] = " << A[i];
+    QString errorString;
+    StepTablet tablet = StepTablet::fromFile(fileName, &errorString);
+    if (!tablet.isValid()) {
+        QMessageBox::warning(this, tr("Import Failed"), tr("Unable to import reference data: %1").arg(errorString));
+        return;
     }
 
-    util::free2DArray(B, n+1);
+    bool ok = false;
+    const QString serial = QInputDialog::getText(this, tr("Import Reference Tablet"),
+                                                 tr("Tablet serial number:"), QLineEdit::Normal,
+                                                 tablet.serial(), &ok).trimmed();
+    if (!ok || serial.isEmpty()) {
+        return;
+    }
+    tablet.setSerial(serial);
 
-    return {(float)A[0], (float)A[1], (float)A[2]};
+    StepTabletLibrary::addTablet(tablet);
+    reloadTablets(serial);
 }
 
-void SlopeCalibrationDialog::gaussEliminationLS(int m, int n, double **a /*[m][n]*/, double *x /*[n-1]*/)
+void SlopeCalibrationDialog::onAlignReadings()
 {
-    for (int i = 0; i < m-1; i++) {
-        // Partial Pivoting
-        for (int k = i+1; k < m; k++) {
-            // If diagonal element(absolute vallue) is smaller than any of the terms below it
-            if (std::abs(a[i][i]) < std::abs(a[k][i])) {
-                // Swap the rows
-                for (int j=0; j < n; j++) {
-                    double temp;
-                    temp = a[i][j];
-                    a[i][j] = a[k][j];
-                    a[k][j] = temp;
-                }
-            }
-        }
-        // Begin Gauss Elimination
-        for (int k = i + 1; k < m; k++) {
-            double term = a[k][i] / a[i][i];
-            for (int j = 0; j < n; j++) {
-                a[k][j] = a[k][j] - term * a[i][j];
-            }
+    const StepTablet tablet = StepTabletLibrary::tablet(ui->tabletComboBox->currentData().toString());
+    if (!tablet.isValid()) {
+        ui->alignmentLabel->setText(tr("Select a reference tablet to align readings"));
+        return;
+    }
+
+    // Collect the captured patch readings, in the order they appear
+    QList<float> readings;
+    for (int row = 1; row < model_->rowCount(); row++) {
+        float reading = itemValueAsFloat(row, 1);
+        if (!qIsNaN(reading)) {
+            readings.append(reading);
         }
     }
-    // Begin Back-substitution
-    for (int i = m-1; i >= 0; i--) {
-        x[i] = a[i][n-1];
-        for (int j = i+1; j < n-1; j++) {
-            x[i] = x[i] - a[i][j] * x[j];
+
+    const StepTabletAlignment alignment = tablet.align(readings);
+    if (!alignment.valid) {
+        ui->alignmentLabel->setText(alignment.message);
+        return;
+    }
+
+    for (int row = 1; row < model_->rowCount(); row++) {
+        model_->setItem(row, 1, nullptr);
+    }
+    for (int i = 0; i < readings.size(); i++) {
+        QString numStr = QString::number(readings.at(i), 'f', 6);
+        model_->setItem(alignment.patches.at(i) + 1, 1, new QStandardItem(numStr));
+    }
+
+    QStringList notes;
+    notes.append(tr("Aligned %1 readings").arg(readings.size()));
+    if (alignment.reversed) {
+        notes.append(tr("captured in reverse"));
+    }
+    if (!alignment.skipped.isEmpty()) {
+        QStringList skippedRows;
+        for (int patch : alignment.skipped) {
+            skippedRows.append(QString::number(patch + 1));
         }
-        x[i] = x[i] / a[i][i];
+        notes.append(tr("skipped rows %1").arg(skippedRows.join(QLatin1String(", "))));
     }
+    ui->alignmentLabel->setText(notes.join(QLatin1String(", ")));
 }
 
-void SlopeCalibrationDialog::onClearReadings()
+void SlopeCalibrationDialog::reloadTablets(const QString &selectedSerial)
 {
-    for (int i = 0; i < model_->rowCount(); i++) {
-        model_->setItem(i, 1, nullptr);
+    QSignalBlocker blocker(ui->tabletComboBox);
+    ui->tabletComboBox->clear();
+    ui->tabletComboBox->addItem(tr("Manual entry"), QString());
+
+    const QList<StepTablet> tablets = StepTabletLibrary::tablets();
+    for (const StepTablet &tablet : tablets) {
+        ui->tabletComboBox->addItem(tablet.displayName(), tablet.serial());
+    }
+
+    int index = ui->tabletComboBox->findData(selectedSerial);
+    if (index > 0) {
+        ui->tabletComboBox->setCurrentIndex(index);
+        blocker.unblock();
+        onTabletChanged(index);
     }
-    QModelIndex index = model_->index(0, 0);
-    ui->tableView->setCurrentIndex(index);
-    ui->tableView->selectionModel()->clearSelection();
-    ui->tableView->setColumnWidth(0, 80);
-    ui->tableView->setColumnWidth(1, 150);
-    ui->tableView->scrollToTop();
 }
 
 QPair<int, int> SlopeCalibrationDialog::upperLeftActiveIndex() const
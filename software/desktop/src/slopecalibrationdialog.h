@@ -22,6 +22,16 @@ public:
 
     std::tuple<float, float, float> calValues() const;
 
+    /**
+     * Calculate slope calibration values from a series of readings.
+     *
+     * The first entry must be a zero density reading, taken without a
+     * tablet in place. Entries with a NaN reading are skipped.
+     *
+     * @return Calibration values, or NaN if there are not enough readings
+     */
+    static std::tuple<float, float, float> calculateSlope(const QList<float> &densities, const QList<float> &readings);
+
 private slots:
     void onDensityReading(DensInterface::DensityType type, float dValue, float dZero, float rawValue, float corrValue);
     void onActionCut();
@@ -30,10 +40,12 @@ private slots:
     void onActionDelete();
     void onCalculateResults();
     void onClearReadings();
+    void onTabletChanged(int index);
+    void onImportTablet();
+    void onAlignReadings();
 
 private:
-    std::tuple<float, float, float> polyfit(const QList<float> &xList, const QList<float> &yList);
-    void gaussEliminationLS(int m, int n, double **a /*[m][n]*/, double *x /*[n-1]*/);
+    void reloadTablets(const QString &selectedSerial);
     QPair<int, int> upperLeftActiveIndex() const;
     float itemValueAsFloat(int row, int col) const;
 
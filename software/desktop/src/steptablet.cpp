@@ -0,0 +1,413 @@
+#include "steptablet.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSettings>
+#include <QStringList>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "cgats.h"
+
+namespace
+{
+// Cost added for each patch skipped between consecutive readings, so that
+// contiguous alignments are preferred when the fit is otherwise equivalent
+static const double SKIP_PENALTY = 0.0001;
+
+// Change in log reading, against the direction of the tablet, that is
+// considered to be a real ordering problem rather than noise
+static const float MONOTONIC_TOLERANCE = 0.02F;
+
+// Minimum correlation between reading and density for a usable alignment
+static const float MIN_CORRELATION = 0.99F;
+
+// Largest distance of a reading from the line fitted through the aligned
+// patches, as a fraction of the average density step of the tablet. This
+// catches readings matched against the wrong tablet, which may still
+// correlate well when the tablets have similar density ranges.
+static const float MAX_RESIDUAL_STEPS = 0.35F;
+
+static const int MIN_READINGS = 3;
+
+float correlation(const QList<float> &xList, const QList<float> &yList)
+{
+    const int n = xList.size();
+    double xMean = 0;
+    double yMean = 0;
+    for (int i = 0; i < n; i++) {
+        xMean += xList.at(i);
+        yMean += yList.at(i);
+    }
+    xMean /= n;
+    yMean /= n;
+
+    double sxy = 0;
+    double sxx = 0;
+    double syy = 0;
+    for (int i = 0; i < n; i++) {
+        const double dx = xList.at(i) - xMean;
+        const double dy = yList.at(i) - yMean;
+        sxy += dx * dy;
+        sxx += dx * dx;
+        syy += dy * dy;
+    }
+    if (sxx <= 0 || syy <= 0) {
+        return 0;
+    }
+    return sxy / std::sqrt(sxx * syy);
+}
+
+float maxResidual(const QList<float> &yList, const QList<float> &dList)
+{
+    // Fit y = a * d + b, then measure each reading in units of density
+    const int n = yList.size();
+    double dMean = 0;
+    double yMean = 0;
+    for (int i = 0; i < n; i++) {
+        dMean += dList.at(i);
+        yMean += yList.at(i);
+    }
+    dMean /= n;
+    yMean /= n;
+
+    double sdy = 0;
+    double sdd = 0;
+    for (int i = 0; i < n; i++) {
+        sdy += (dList.at(i) - dMean) * (yList.at(i) - yMean);
+        sdd += (dList.at(i) - dMean) * (dList.at(i) - dMean);
+    }
+    if (sdd <= 0 || sdy <= 0) {
+        return INFINITY;
+    }
+    const double a = sdy / sdd;
+    const double b = yMean - (a * dMean);
+
+    double result = 0;
+    for (int i = 0; i < n; i++) {
+        result = std::max(result, std::fabs(((yList.at(i) - b) / a) - dList.at(i)));
+    }
+    return result;
+}
+}
+
+StepTablet::StepTablet()
+{
+}
+
+StepTablet::StepTablet(const QString &serial, const QString &name, const QList<float> &densities)
+    : serial_(serial), name_(name), densities_(densities)
+{
+}
+
+StepTablet StepTablet::fromFile(const QString &fileName, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errorString) { *errorString = file.errorString(); }
+        return StepTablet();
+    }
+
+    QStringList lines;
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        lines.append(stream.readLine().trimmed());
+    }
+
+    StepTablet tablet;
+    if (!lines.isEmpty() && CgatsReader::isCgatsLine(lines.first())) {
+        file.close();
+        tablet = fromCgats(fileName, errorString);
+    } else {
+        tablet = fromCsv(fileName, lines, errorString);
+    }
+
+    if (tablet.densities_.size() < MIN_READINGS) {
+        if (errorString && errorString->isEmpty()) {
+            *errorString = QStringLiteral("File does not contain enough patches");
+        }
+        return StepTablet();
+    }
+    return tablet;
+}
+
+StepTablet StepTablet::fromCgats(const QString &fileName, QString *errorString)
+{
+    const QList<CgatsTable> tables = CgatsReader::readFile(fileName, errorString);
+    if (tables.isEmpty()) { return StepTablet(); }
+
+    const CgatsTable &table = tables.first();
+    const int densityField = table.densityField();
+    if (densityField < 0) {
+        if (errorString) { *errorString = QStringLiteral("No density field in data format"); }
+        return StepTablet();
+    }
+
+    StepTablet tablet;
+    for (int i = 0; i < table.rowCount(); i++) {
+        bool ok = false;
+        float density = table.value(i, densityField).toFloat(&ok);
+        if (!ok) {
+            if (errorString) { *errorString = QStringLiteral("Invalid density value in row %1").arg(i + 1); }
+            return StepTablet();
+        }
+        tablet.densities_.append(density);
+    }
+
+    if (table.hasKeyword(QStringLiteral("SERIAL"))) {
+        tablet.serial_ = table.keyword(QStringLiteral("SERIAL"));
+    } else {
+        tablet.serial_ = table.keyword(QStringLiteral("SERIAL_NUMBER"));
+    }
+    tablet.name_ = table.keyword(QStringLiteral("DESCRIPTOR"));
+    if (tablet.name_.isEmpty()) {
+        tablet.name_ = table.keyword(QStringLiteral("TARGET_TYPE"));
+    }
+
+    if (tablet.serial_.isEmpty()) {
+        tablet.serial_ = QFileInfo(fileName).completeBaseName();
+    }
+    return tablet;
+}
+
+StepTablet StepTablet::fromCsv(const QString &fileName, const QStringList &lines, QString *errorString)
+{
+    const QRegularExpression separator(QStringLiteral("[,;\\t]"));
+    StepTablet tablet;
+
+    for (const QString &line : lines) {
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) { continue; }
+
+        // Use the last column, so both "density" and "patch,density" lines work
+        const QStringList values = line.split(separator);
+        bool ok = false;
+        float density = values.last().trimmed().toFloat(&ok);
+        if (!ok) {
+            if (tablet.densities_.isEmpty()) {
+                // Assume this is a header line
+                continue;
+            }
+            if (errorString) { *errorString = QStringLiteral("Invalid data line: %1").arg(line); }
+            return StepTablet();
+        }
+        tablet.densities_.append(density);
+    }
+
+    tablet.serial_ = QFileInfo(fileName).completeBaseName();
+    return tablet;
+}
+
+bool StepTablet::isValid() const { return !serial_.isEmpty() && densities_.size() >= MIN_READINGS; }
+QString StepTablet::serial() const { return serial_; }
+void StepTablet::setSerial(const QString &serial) { serial_ = serial; }
+QString StepTablet::name() const { return name_; }
+void StepTablet::setName(const QString &name) { name_ = name; }
+QList<float> StepTablet::densities() const { return densities_; }
+
+QString StepTablet::displayName() const
+{
+    if (name_.isEmpty()) {
+        return QStringLiteral("#%1 (%2 patches)").arg(serial_).arg(densities_.size());
+    } else {
+        return QStringLiteral("#%1 - %2 (%3 patches)").arg(serial_, name_).arg(densities_.size());
+    }
+}
+
+StepTabletAlignment StepTablet::align(const QList<float> &readings) const
+{
+    StepTabletAlignment result{};
+    const int k = readings.size();
+    const int n = densities_.size();
+
+    if (k < MIN_READINGS) {
+        result.message = QStringLiteral("At least %1 readings are required").arg(MIN_READINGS);
+        return result;
+    }
+    if (k > n) {
+        result.message = QStringLiteral("More readings (%1) than tablet patches (%2)").arg(k).arg(n);
+        return result;
+    }
+
+    // Work in units of log reading, which increase along with density
+    QList<float> yList;
+    for (float reading : readings) {
+        if (!std::isfinite(reading) || reading <= 0) {
+            result.message = QStringLiteral("Invalid reading: %1").arg(reading);
+            return result;
+        }
+        yList.append(-std::log10(reading));
+    }
+
+    // Readings taken from the dense end of the tablet will be decreasing
+    int increasing = 0;
+    int decreasing = 0;
+    for (int i = 1; i < k; i++) {
+        if (yList.at(i) > yList.at(i - 1)) {
+            increasing++;
+        } else if (yList.at(i) < yList.at(i - 1)) {
+            decreasing++;
+        }
+    }
+    result.reversed = decreasing > increasing;
+    if (result.reversed) {
+        std::reverse(yList.begin(), yList.end());
+    }
+
+    for (int i = 1; i < k; i++) {
+        if (yList.at(i) < yList.at(i - 1) - MONOTONIC_TOLERANCE) {
+            result.monotonicErrors++;
+        }
+    }
+
+    // Find the increasing assignment of readings to patches that best
+    // matches the step-to-step changes in density. Comparing steps,
+    // rather than absolute values, makes this insensitive to the unknown
+    // reading offset and tolerant of the slope error being calibrated.
+    std::vector<std::vector<double>> cost(k, std::vector<double>(n, INFINITY));
+    std::vector<std::vector<int>> prev(k, std::vector<int>(n, -1));
+    for (int j = 0; j < n; j++) {
+        cost[0][j] = j * SKIP_PENALTY;
+    }
+    for (int i = 1; i < k; i++) {
+        const double dy = yList.at(i) - yList.at(i - 1);
+        for (int j = i; j < n; j++) {
+            for (int jp = i - 1; jp < j; jp++) {
+                if (std::isinf(cost[i - 1][jp])) { continue; }
+                const double dd = densities_.at(j) - densities_.at(jp);
+                const double c = cost[i - 1][jp] + ((dy - dd) * (dy - dd)) + ((j - jp - 1) * SKIP_PENALTY);
+                if (c < cost[i][j]) {
+                    cost[i][j] = c;
+                    prev[i][j] = jp;
+                }
+            }
+        }
+    }
+
+    int last = k - 1;
+    for (int j = k - 1; j < n; j++) {
+        if (cost[k - 1][j] < cost[k - 1][last]) {
+            last = j;
+        }
+    }
+
+    QList<int> patches;
+    for (int i = k - 1, j = last; i >= 0; j = prev[i][j], i--) {
+        patches.prepend(j);
+    }
+
+    QList<float> dList;
+    for (int patch : qAsConst(patches)) {
+        dList.append(densities_.at(patch));
+    }
+    result.correlation = correlation(yList, dList);
+    result.maxResidual = maxResidual(yList, dList);
+    const float residualLimit = MAX_RESIDUAL_STEPS * std::fabs(densities_.last() - densities_.first()) / (n - 1);
+
+    // Report patches in the order the readings were captured
+    if (result.reversed) {
+        std::reverse(patches.begin(), patches.end());
+    }
+    result.patches = patches;
+    for (int j = 0; j < n; j++) {
+        if (!patches.contains(j)) {
+            result.skipped.append(j);
+        }
+    }
+
+    if (result.monotonicErrors > 0) {
+        result.message = QStringLiteral("Readings are out of order in %1 place(s)").arg(result.monotonicErrors);
+    } else if (result.correlation < MIN_CORRELATION) {
+        result.message = QStringLiteral("Readings do not match the tablet (correlation %1)").arg(result.correlation, 0, 'f', 4);
+    } else if (!(result.maxResidual < residualLimit)) {
+        result.message = QStringLiteral("Readings do not match the tablet (off by up to %1)").arg(result.maxResidual, 0, 'f', 2);
+    } else {
+        result.valid = true;
+    }
+    return result;
+}
+
+QList<StepTablet> StepTabletLibrary::tablets()
+{
+    QList<StepTablet> result;
+    QSettings settings;
+    const int size = settings.beginReadArray("step_tablets");
+    for (int i = 0; i < size; i++) {
+        settings.setArrayIndex(i);
+        QList<float> densities;
+        const QVariantList densityList = settings.value("densities").toList();
+        for (const QVariant &entry : densityList) {
+            densities.append(entry.toFloat());
+        }
+        StepTablet tablet(settings.value("serial").toString(), settings.value("name").toString(), densities);
+        if (tablet.isValid()) {
+            result.append(tablet);
+        }
+    }
+    settings.endArray();
+    return result;
+}
+
+StepTablet StepTabletLibrary::tablet(const QString &serial)
+{
+    const QList<StepTablet> tabletList = tablets();
+    for (const StepTablet &tablet : tabletList) {
+        if (tablet.serial() == serial) {
+            return tablet;
+        }
+    }
+    return StepTablet();
+}
+
+bool StepTabletLibrary::addTablet(const StepTablet &tablet)
+{
+    if (!tablet.isValid()) { return false; }
+
+    // Replace any existing tablet with the same serial number
+    QList<StepTablet> tabletList = tablets();
+    bool replaced = false;
+    for (int i = 0; i < tabletList.size(); i++) {
+        if (tabletList.at(i).serial() == tablet.serial()) {
+            tabletList[i] = tablet;
+            replaced = true;
+            break;
+        }
+    }
+    if (!replaced) {
+        tabletList.append(tablet);
+    }
+    saveTablets(tabletList);
+    return true;
+}
+
+void StepTabletLibrary::removeTablet(const QString &serial)
+{
+    QList<StepTablet> tabletList = tablets();
+    for (int i = tabletList.size() - 1; i >= 0; i--) {
+        if (tabletList.at(i).serial() == serial) {
+            tabletList.removeAt(i);
+        }
+    }
+    saveTablets(tabletList);
+}
+
+void StepTabletLibrary::saveTablets(const QList<StepTablet> &tablets)
+{
+    QSettings settings;
+    settings.remove("step_tablets");
+    settings.beginWriteArray("step_tablets", tablets.size());
+    for (int i = 0; i < tablets.size(); i++) {
+        settings.setArrayIndex(i);
+        QVariantList densityList;
+        const QList<float> densities = tablets.at(i).densities();
+        for (float density : densities) {
+            densityList.append(density);
+        }
+        settings.setValue("serial", tablets.at(i).serial());
+        settings.setValue("name", tablets.at(i).name());
+        settings.setValue("densities", densityList);
+    }
+    settings.endArray();
+}
@@ -0,0 +1,87 @@
+#ifndef STEPTABLET_H
+#define STEPTABLET_H
+
+#include <QList>
+#include <QString>
+
+/**
+ * Result of aligning a sequence of captured readings to the patches
+ * of a step tablet.
+ */
+struct StepTabletAlignment {
+    bool valid;
+    bool reversed;
+    QList<int> patches;     // Patch index for each reading, in capture order
+    QList<int> skipped;     // Patches with no matching reading
+    int monotonicErrors;    // Readings that go against the direction of the tablet
+    float correlation;      // Correlation between reading and patch density
+    float maxResidual;      // Largest density error of a reading from the fitted line
+    QString message;
+};
+
+/**
+ * Reference data for a specific, serial-numbered step tablet.
+ */
+class StepTablet
+{
+public:
+    StepTablet();
+    StepTablet(const QString &serial, const QString &name, const QList<float> &densities);
+
+    /**
+     * Import reference data from a vendor data file.
+     *
+     * CGATS files are detected by their contents, and use the first
+     * density field in the data format along with the serial number
+     * from the file header. All other files are treated as CSV, with
+     * either one density per line or a patch number followed by
+     * a density. If no serial number is found, the base name of
+     * the file is used instead.
+     */
+    static StepTablet fromFile(const QString &fileName, QString *errorString = nullptr);
+
+    bool isValid() const;
+    QString serial() const;
+    void setSerial(const QString &serial);
+    QString name() const;
+    void setName(const QString &name);
+    QList<float> densities() const;
+
+    /** Name for presenting the tablet in a list */
+    QString displayName() const;
+
+    /**
+     * Align captured readings to the patches of this tablet.
+     *
+     * The readings are slope uncorrected values, in the order in which
+     * they were captured. They may have been captured in either direction
+     * across the tablet, and may skip patches, but must not otherwise be
+     * out of order.
+     */
+    StepTabletAlignment align(const QList<float> &readings) const;
+
+private:
+    static StepTablet fromCgats(const QString &fileName, QString *errorString);
+    static StepTablet fromCsv(const QString &fileName, const QStringList &lines, QString *errorString);
+
+    QString serial_;
+    QString name_;
+    QList<float> densities_;
+};
+
+/**
+ * Locally stored collection of step tablet reference data.
+ */
+class StepTabletLibrary
+{
+public:
+    static QList<StepTablet> tablets();
+    static StepTablet tablet(const QString &serial);
+    static bool addTablet(const StepTablet &tablet);
+    static void removeTablet(const QString &serial);
+
+private:
+    static void saveTablets(const QList<StepTablet> &tablets);
+};
+
+#endif // STEPTABLET_H
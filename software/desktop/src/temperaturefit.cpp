@@ -0,0 +1,149 @@
+#include "temperaturefit.h"
+
+#include <QFile>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QTextStream>
+#include <cmath>
+#include "util.h"
+
+namespace
+{
+static const float REFERENCE_TEMP = 25.0F;
+static const int MIN_SAMPLES = 5;
+static const float MIN_TEMP_SPAN = 5.0F;
+
+// Limits enforced by the firmware when the coefficients are saved
+static const float MAX_COEF_A = 0.1F;
+static const float MAX_COEF_B = 0.01F;
+}
+
+TemperatureFit::TemperatureFit()
+{
+}
+
+TemperatureFit TemperatureFit::fromFile(const QString &fileName, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errorString) { *errorString = file.errorString(); }
+        return TemperatureFit();
+    }
+
+    QList<float> temperatures;
+    QList<float> readings;
+    const QRegularExpression separator(QStringLiteral("[,;\\s]+"));
+    QTextStream stream(&file);
+    int lineNumber = 0;
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine().trimmed();
+        lineNumber++;
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) { continue; }
+
+        const QStringList fields = line.split(separator, Qt::SkipEmptyParts);
+        bool tempOk = false;
+        bool readingOk = false;
+        float temperature = fields.value(0).toFloat(&tempOk);
+        float reading = fields.value(1).toFloat(&readingOk);
+        if (!tempOk || !readingOk) {
+            if (temperatures.isEmpty()) {
+                // Assume this is a header line
+                continue;
+            }
+            if (errorString) { *errorString = QStringLiteral("Invalid data on line %1").arg(lineNumber); }
+            return TemperatureFit();
+        }
+        temperatures.append(temperature);
+        readings.append(reading);
+    }
+
+    return fromSamples(temperatures, readings, errorString);
+}
+
+TemperatureFit TemperatureFit::fromSamples(const QList<float> &temperatures, const QList<float> &readings,
+                                           QString *errorString)
+{
+    TemperatureFit fit;
+
+    if (temperatures.size() != readings.size() || temperatures.size() < MIN_SAMPLES) {
+        if (errorString) { *errorString = QStringLiteral("At least %1 samples are required").arg(MIN_SAMPLES); }
+        return fit;
+    }
+
+    QList<float> xList;
+    float minTemp = temperatures.first();
+    float maxTemp = temperatures.first();
+    for (int i = 0; i < temperatures.size(); i++) {
+        if (!std::isfinite(temperatures.at(i)) || !std::isfinite(readings.at(i)) || readings.at(i) <= 0) {
+            if (errorString) { *errorString = QStringLiteral("Invalid sample: %1").arg(i + 1); }
+            return fit;
+        }
+        minTemp = qMin(minTemp, temperatures.at(i));
+        maxTemp = qMax(maxTemp, temperatures.at(i));
+        xList.append(temperatures.at(i) - REFERENCE_TEMP);
+    }
+
+    if (maxTemp - minTemp < MIN_TEMP_SPAN) {
+        if (errorString) { *errorString = QStringLiteral("Temperature sweep must span at least %1C").arg(MIN_TEMP_SPAN); }
+        return fit;
+    }
+
+    // Fit the readings directly, then normalize to the reading at the reference temperature
+    auto beta = util::polyfit(xList, readings);
+    float c0 = std::get<0>(beta);
+    if (!std::isfinite(c0) || c0 <= 0) {
+        if (errorString) { *errorString = QStringLiteral("Unable to fit the sweep data"); }
+        return fit;
+    }
+
+    fit.coefA_ = std::get<1>(beta) / c0;
+    fit.coefB_ = std::get<2>(beta) / c0;
+    fit.reading25_ = c0;
+    fit.sampleCount_ = temperatures.size();
+    fit.minTemperature_ = minTemp;
+    fit.maxTemperature_ = maxTemp;
+
+    double sumSquares = 0;
+    for (int i = 0; i < xList.size(); i++) {
+        const double x = xList.at(i);
+        const double modeled = c0 * (1.0 + (fit.coefA_ * x) + (fit.coefB_ * x * x));
+        const double residual = (readings.at(i) - modeled) / modeled;
+        sumSquares += residual * residual;
+    }
+    fit.rmsError_ = std::sqrt(sumSquares / xList.size());
+
+    if (!std::isfinite(fit.coefA_) || !std::isfinite(fit.coefB_)
+            || std::fabs(fit.coefA_) > MAX_COEF_A || std::fabs(fit.coefB_) > MAX_COEF_B) {
+        if (errorString) { *errorString = QStringLiteral("Coefficients out of range: %1, %2").arg(fit.coefA_).arg(fit.coefB_); }
+        return fit;
+    }
+
+    fit.valid_ = true;
+    return fit;
+}
+
+bool TemperatureFit::isValid() const { return valid_; }
+int TemperatureFit::sampleCount() const { return sampleCount_; }
+float TemperatureFit::minTemperature() const { return minTemperature_; }
+float TemperatureFit::maxTemperature() const { return maxTemperature_; }
+float TemperatureFit::reading25() const { return reading25_; }
+float TemperatureFit::coefA() const { return coefA_; }
+float TemperatureFit::coefB() const { return coefB_; }
+float TemperatureFit::rmsError() const { return rmsError_; }
+
+QString TemperatureFit::toText() const
+{
+    QStringList lines;
+    lines.append(QStringLiteral("Samples: %1").arg(sampleCount_));
+    lines.append(QStringLiteral("Temperature range: %1C - %2C")
+                 .arg(minTemperature_, 0, 'f', 1).arg(maxTemperature_, 0, 'f', 1));
+    lines.append(QStringLiteral("Reading at %1C: %2").arg(REFERENCE_TEMP, 0, 'f', 0).arg(reading25_, 0, 'f'));
+    lines.append(QStringLiteral("A: %1").arg(coefA_, 0, 'e', 6));
+    lines.append(QStringLiteral("B: %1").arg(coefB_, 0, 'e', 6));
+    lines.append(QStringLiteral("RMS error: %1%").arg(rmsError_ * 100.0F, 0, 'f', 3));
+    if (valid_) {
+        lines.append(QStringLiteral("Device command: SC TEMP,%1,%2")
+                     .arg(util::encode_f32(coefA_), util::encode_f32(coefB_)));
+    }
+    return lines.join(QLatin1Char('\n'));
+}
@@ -0,0 +1,61 @@
+#ifndef TEMPERATUREFIT_H
+#define TEMPERATUREFIT_H
+
+#include <QList>
+#include <QString>
+
+/**
+ * Derives the temperature compensation coefficients used by the device
+ * from a logged temperature sweep.
+ *
+ * The sweep is a series of readings of the same target, taken as the
+ * device warms up or cools down, each paired with the die temperature
+ * at the time of the reading. The sensor response is modeled as
+ * R(T) = R25 * (1 + A*(T-25) + B*(T-25)^2), matching the firmware.
+ */
+class TemperatureFit
+{
+public:
+    TemperatureFit();
+
+    /**
+     * Load a sweep from a CSV file.
+     *
+     * Each line contains a temperature in degrees Celsius followed by a
+     * slope corrected reading, separated by a comma or whitespace.
+     * Blank lines, lines starting with '#', and a leading header line
+     * are ignored.
+     */
+    static TemperatureFit fromFile(const QString &fileName, QString *errorString = nullptr);
+
+    static TemperatureFit fromSamples(const QList<float> &temperatures, const QList<float> &readings,
+                                      QString *errorString = nullptr);
+
+    bool isValid() const;
+    int sampleCount() const;
+    float minTemperature() const;
+    float maxTemperature() const;
+
+    /** Modeled reading at the 25C reference temperature */
+    float reading25() const;
+
+    float coefA() const;
+    float coefB() const;
+
+    /** RMS of the relative residuals of the fit */
+    float rmsError() const;
+
+    QString toText() const;
+
+private:
+    bool valid_ = false;
+    int sampleCount_ = 0;
+    float minTemperature_ = 0;
+    float maxTemperature_ = 0;
+    float reading25_ = 0;
+    float coefA_ = 0;
+    float coefB_ = 0;
+    float rmsError_ = 0;
+};
+
+#endif // TEMPERATUREFIT_H
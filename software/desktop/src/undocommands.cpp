@@ -0,0 +1,67 @@
+#include "undocommands.h"
+
+bool MeasTableRow::operator==(const MeasTableRow &other) const
+{
+    return type == other.type
+            && value == other.value
+            && offset == other.offset
+            && uncertainty == other.uncertainty
+            && raw == other.raw
+            && corrected == other.corrected
+            && flagged == other.flagged
+            && flaggedToolTip == other.flaggedToolTip
+            && computed == other.computed
+            && time == other.time;
+}
+
+bool MeasTableState::operator==(const MeasTableState &other) const
+{
+    return rows == other.rows && currentRow == other.currentRow;
+}
+
+MeasTableCommand::MeasTableCommand(const QString &text,
+                                   const MeasTableState &before, const MeasTableState &after,
+                                   const RestoreFunction &restore,
+                                   const QString &mergeKey,
+                                   QUndoCommand *parent)
+    : QUndoCommand(text, parent)
+    , before_(before)
+    , after_(after)
+    , restore_(restore)
+    , mergeKey_(mergeKey)
+    , applied_(true)
+{
+}
+
+void MeasTableCommand::undo()
+{
+    restore_(before_);
+    applied_ = false;
+}
+
+void MeasTableCommand::redo()
+{
+    // Skip the redo that happens when the command is first pushed,
+    // since the change has already been made to the table
+    if (applied_) { return; }
+
+    restore_(after_);
+    applied_ = true;
+}
+
+int MeasTableCommand::id() const
+{
+    return mergeKey_.isEmpty() ? -1 : 1;
+}
+
+bool MeasTableCommand::mergeWith(const QUndoCommand *other)
+{
+    const MeasTableCommand *command = static_cast<const MeasTableCommand *>(other);
+    if (command->mergeKey_ != mergeKey_) { return false; }
+
+    after_ = command->after_;
+
+    // Edits that put the cell back the way it was leave nothing to undo
+    setObsolete(after_ == before_);
+    return true;
+}
@@ -0,0 +1,135 @@
+#ifndef UNDOCOMMANDS_H
+#define UNDOCOMMANDS_H
+
+#include <functional>
+#include <QUndoCommand>
+#include <QDateTime>
+#include <QMap>
+#include <QString>
+#include <QVector>
+#include "densinterface.h"
+
+/**
+ * Contents of a single row in the measurement table.
+ */
+struct MeasTableRow
+{
+    QString type;
+    QString value;
+    QString offset;
+    QString uncertainty;
+    QString raw;       // Raw sensor reading, not shown in the table
+    QString corrected; // Corrected sensor reading, not shown in the table
+    bool flagged;
+    QString flaggedToolTip;
+    QMap<QString, QString> computed; // Values of computed columns, by column name
+    QDateTime time;    // When the reading was taken, not shown in the table
+
+    bool operator==(const MeasTableRow &other) const;
+    bool operator!=(const MeasTableRow &other) const { return !(*this == other); }
+};
+
+/**
+ * Snapshot of the full contents of the measurement table.
+ */
+struct MeasTableState
+{
+    QVector<MeasTableRow> rows;
+    int currentRow;
+
+    bool operator==(const MeasTableState &other) const;
+    bool operator!=(const MeasTableState &other) const { return !(*this == other); }
+};
+
+/**
+ * Undoable change to the contents of the measurement table.
+ *
+ * The change is expected to have already been made to the table by the
+ * time this command is pushed onto the undo stack, so the first call to
+ * redo() does nothing. The restore function is responsible for replacing
+ * the table contents with a provided snapshot.
+ *
+ * Commands with the same non-empty merge key, such as successive edits
+ * of the same cell, are merged into a single undo step when pushed one
+ * after the other.
+ */
+class MeasTableCommand : public QUndoCommand
+{
+public:
+    typedef std::function<void(const MeasTableState &)> RestoreFunction;
+
+    MeasTableCommand(const QString &text,
+                     const MeasTableState &before, const MeasTableState &after,
+                     const RestoreFunction &restore,
+                     const QString &mergeKey = QString(),
+                     QUndoCommand *parent = nullptr);
+
+    void undo() override;
+    void redo() override;
+    int id() const override;
+    bool mergeWith(const QUndoCommand *other) override;
+
+    MeasTableState before() const { return before_; }
+    MeasTableState after() const { return after_; }
+
+private:
+    MeasTableState before_;
+    MeasTableState after_;
+    RestoreFunction restore_;
+    QString mergeKey_;
+    bool applied_;
+};
+
+/**
+ * Undoable write of a calibration value to the device.
+ *
+ * The previous value is the one most recently read back from the device,
+ * so undoing the command writes that value back to the device. The UI is
+ * then refreshed through the normal read-back that follows a write.
+ */
+template <typename T>
+class CalSetCommand : public QUndoCommand
+{
+public:
+    typedef bool (DensInterface::*SetFunction)(const T &);
+
+    CalSetCommand(const QString &text, DensInterface *densInterface, SetFunction setFunction,
+                  const T &previousValue, const T &value,
+                  QUndoCommand *parent = nullptr)
+        : QUndoCommand(text, parent)
+        , densInterface_(densInterface)
+        , setFunction_(setFunction)
+        , previousValue_(previousValue)
+        , value_(value)
+    {
+    }
+
+    void undo() override
+    {
+        // Nothing can be restored if the value was never read back
+        if (!previousValue_.isValid()) {
+            setObsolete(true);
+            return;
+        }
+        send(previousValue_);
+    }
+    void redo() override { send(value_); }
+
+    T previousValue() const { return previousValue_; }
+    T value() const { return value_; }
+
+private:
+    void send(const T &value)
+    {
+        if (!densInterface_->connected() || !(densInterface_->*setFunction_)(value)) {
+            setObsolete(true);
+        }
+    }
+
+    DensInterface *densInterface_;
+    SetFunction setFunction_;
+    T previousValue_;
+    T value_;
+};
+
+#endif // UNDOCOMMANDS_H
@@ -1,8 +1,10 @@
 #include "util.h"
 
 #include <QIntValidator>
+#include <QDebug>
 #include <QDoubleValidator>
 #include <string.h>
+#include <cmath>
 
 namespace util
 {
@@ -78,6 +80,97 @@ void free2DArray(double **array, const size_t rows)
     delete[] array;
 }
 
+static void gaussEliminationLS(int m, int n, double **a /*[m][n]*/, double *x /*[n-1]*/)
+{
+    for (int i = 0; i < m-1; i++) {
+        // Partial Pivoting
+        for (int k = i+1; k < m; k++) {
+            // If diagonal element(absolute vallue) is smaller than any of the terms below it
+            if (std::abs(a[i][i]) < std::abs(a[k][i])) {
+                // Swap the rows
+                for (int j=0; j < n; j++) {
+                    double temp;
+                    temp = a[i][j];
+                    a[i][j] = a[k][j];
+                    a[k][j] = temp;
+                }
+            }
+        }
+        // Begin Gauss Elimination
+        for (int k = i + 1; k < m; k++) {
+            double term = a[k][i] / a[i][i];
+            for (int j = 0; j < n; j++) {
+                a[k][j] = a[k][j] - term * a[i][j];
+            }
+        }
+    }
+    // Begin Back-substitution
+    for (int i = m-1; i >= 0; i--) {
+        x[i] = a[i][n-1];
+        for (int j = i+1; j < n-1; j++) {
+            x[i] = x[i] - a[i][j] * x[j];
+        }
+        x[i] = x[i] / a[i][i];
+    }
+}
+
+std::tuple<float, float, float> polyfit(const QList<float> &xList, const QList<float> &yList)
+{
+    // Polynomial Fitting, based on this implementation:
+    // https://www.bragitoff.com/2018/06/polynomial-fitting-c-program/
+
+    if (xList.isEmpty() || xList.size() != yList.size()) {
+        return {qSNaN(), qSNaN(), qSNaN()};
+    }
+
+    // Number of data points
+    const int N = xList.size();
+
+    // Degree of polynomial
+    const int n = 2;
+
+    // An array of size 2*n+1 for storing N, Sig xi, Sig xi^2, ....
+    // which are the independent components of the normal matrix
+    double X[2*n+1];
+    for (int i=0; i <= 2 * n; i++) {
+        X[i] = 0;
+        for (int j=0; j < N; j++) {
+            X[i] = X[i] + std::pow((double)xList[j], i);
+        }
+    }
+
+    // The normal augmented matrix
+    //double B[n+1][n+2];
+    double **B = util::make2DArray(n+1, n+2);
+    // rhs
+    double Y[n+1];
+    for (int i = 0; i <= n; i++) {
+        Y[i] = 0;
+        for (int j=0; j < N; j++) {
+            Y[i] = Y[i] + std::pow((double)xList[j], i) * (double)yList[j];
+        }
+    }
+    for (int i = 0; i <= n; i++) {
+        for (int j = 0; j <= n; j++) {
+            B[i][j] = X[i + j];
+        }
+    }
+    for (int i = 0; i <= n; i++) {
+        B[i][n + 1] = Y[i];
+    }
+
+    double A[n+1];
+    gaussEliminationLS(n+1, n+2, B, A);
+
+    for(int i = 0; i <= n; i++) {
+        qDebug().nospace() << "B[" << i << "] = " << A[i];
+    }
+
+    util::free2DArray(B, n+1);
+
+    return {(float)A[0], (float)A[1], (float)A[2]};
+}
+
 QValidator *createIntValidator(int min, int max, QObject *parent)
 {
     QIntValidator *validator = new QIntValidator(min, max, parent);
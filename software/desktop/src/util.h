@@ -1,7 +1,9 @@
 #ifndef UTIL_H
 #define UTIL_H
 
+#include <QList>
 #include <QString>
+#include <tuple>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -22,6 +24,13 @@ float decode_f32(const QString &val);
 double **make2DArray(const size_t rows, const size_t cols);
 void free2DArray(double **array, const size_t rows);
 
+/**
+ * Least-squares fit of a second order polynomial to a set of points.
+ *
+ * @return Coefficients of the polynomial, starting with the constant term
+ */
+std::tuple<float, float, float> polyfit(const QList<float> &xList, const QList<float> &yList);
+
 QValidator *createIntValidator(int min, int max, QObject *parent = nullptr);
 QValidator *createFloatValidator(double min, double max, int decimals, QObject *parent = nullptr);
 
@@ -0,0 +1,576 @@
+#include "workspace.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace
+{
+const QByteArray FILE_MAGIC = QByteArrayLiteral("PDWORKSPACE");
+const int FILE_VERSION = 1;
+const qint64 COPY_CHUNK_SIZE = 65536;
+
+// Fixed fields at the start of each row, followed by the computed columns
+enum RowField {
+    RowType = 0,
+    RowValue,
+    RowOffset,
+    RowUncertainty,
+    RowRaw,
+    RowCorrected,
+    RowFlagged,
+    RowTime,
+    RowFixedFields
+};
+
+bool isEmptyRow(const MeasTableRow &row)
+{
+    return row.type.isEmpty() && row.value.isEmpty() && row.computed.isEmpty();
+}
+
+QJsonObject targetToJson(const DensCalTarget &calTarget)
+{
+    QJsonObject jsonLo;
+    jsonLo["density"] = QString::number(calTarget.loDensity(), 'f', 2);
+    jsonLo["reading"] = QString::number(calTarget.loReading(), 'f', 6);
+
+    QJsonObject jsonHi;
+    jsonHi["density"] = QString::number(calTarget.hiDensity(), 'f', 2);
+    jsonHi["reading"] = QString::number(calTarget.hiReading(), 'f', 6);
+
+    QJsonObject jsonTarget;
+    jsonTarget["cal-lo"] = jsonLo;
+    jsonTarget["cal-hi"] = jsonHi;
+    return jsonTarget;
+}
+
+void setError(QString *errorString, const QString &message)
+{
+    if (errorString) {
+        *errorString = message;
+    }
+}
+}
+
+Workspace::Workspace()
+    : currentSession_(0)
+    , modified_(false)
+{
+    clear();
+}
+
+QString Workspace::recoveryFileName()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation))
+            .filePath(QStringLiteral("recovery.pdw"));
+}
+
+QString Workspace::fileName() const
+{
+    return fileName_;
+}
+
+bool Workspace::isModified() const
+{
+    return modified_;
+}
+
+void Workspace::setModified()
+{
+    modified_ = true;
+}
+
+void Workspace::clear()
+{
+    Entry entry;
+    entry.session = QSharedPointer<WorkspaceSession>::create();
+    entry.session->name = QStringLiteral("Session 1");
+    entry.session->created = QDateTime::currentDateTimeUtc();
+    entry.name = entry.session->name;
+    entry.created = entry.session->created;
+
+    entries_.clear();
+    entries_.append(entry);
+    currentSession_ = 0;
+    fileName_.clear();
+    sourceFileName_.clear();
+    modified_ = false;
+}
+
+QJsonObject Workspace::calibrationToJson(const DensCalGain &calGain, const DensCalSlope &calSlope,
+                                         const DensCalTarget &calReflection, const DensCalTarget &calTransmission)
+{
+    QJsonObject jsonCalSensor;
+    if (calGain.isValid()) {
+        QJsonObject jsonCalGain;
+        jsonCalGain["L0"] = QString::number(calGain.low0(), 'f', 6);
+        jsonCalGain["L1"] = QString::number(calGain.low1(), 'f', 6);
+        jsonCalGain["M0"] = QString::number(calGain.med0(), 'f', 6);
+        jsonCalGain["M1"] = QString::number(calGain.med1(), 'f', 6);
+        jsonCalGain["H0"] = QString::number(calGain.high0(), 'f', 6);
+        jsonCalGain["H1"] = QString::number(calGain.high1(), 'f', 6);
+        jsonCalGain["X0"] = QString::number(calGain.max0(), 'f', 6);
+        jsonCalGain["X1"] = QString::number(calGain.max1(), 'f', 6);
+        jsonCalSensor["gain"] = jsonCalGain;
+    }
+    if (calSlope.isValid()) {
+        QJsonObject jsonCalSlope;
+        jsonCalSlope["B0"] = QString::number(calSlope.b0(), 'f', 6);
+        jsonCalSlope["B1"] = QString::number(calSlope.b1(), 'f', 6);
+        jsonCalSlope["B2"] = QString::number(calSlope.b2(), 'f', 6);
+        jsonCalSensor["slope"] = jsonCalSlope;
+    }
+
+    QJsonObject jsonCalTarget;
+    if (calReflection.isValidReflection()) {
+        jsonCalTarget["reflection"] = targetToJson(calReflection);
+    }
+    if (calTransmission.isValidTransmission()) {
+        jsonCalTarget["transmission"] = targetToJson(calTransmission);
+    }
+
+    QJsonObject jsonCal;
+    if (!jsonCalSensor.isEmpty()) {
+        jsonCal["sensor"] = jsonCalSensor;
+    }
+    if (!jsonCalTarget.isEmpty()) {
+        jsonCal["target"] = jsonCalTarget;
+    }
+    return jsonCal;
+}
+
+bool Workspace::load(const QString &fileName, QString *errorString)
+{
+    if (!read(fileName, nullptr, errorString)) {
+        return false;
+    }
+    fileName_ = fileName;
+    modified_ = false;
+    return true;
+}
+
+bool Workspace::read(const QString &fileName, QString *originalFileName, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(errorString, file.errorString());
+        return false;
+    }
+
+    // Header line, with the format version and index length
+    const QList<QByteArray> header = file.readLine(256).trimmed().split(' ');
+    if (header.size() != 3 || header.at(0) != FILE_MAGIC) {
+        setError(errorString, QStringLiteral("Not a workspace file"));
+        return false;
+    }
+    bool versionOk;
+    bool lengthOk;
+    const int version = header.at(1).toInt(&versionOk);
+    const qint64 indexLength = header.at(2).toLongLong(&lengthOk);
+    if (!versionOk || version != FILE_VERSION) {
+        setError(errorString, QStringLiteral("Unsupported workspace version: %1").arg(QString::fromLatin1(header.at(1))));
+        return false;
+    }
+    if (!lengthOk || indexLength <= 0 || indexLength > file.size() - file.pos()) {
+        setError(errorString, QStringLiteral("Workspace index is truncated"));
+        return false;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.read(indexLength), &parseError);
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        setError(errorString, QStringLiteral("Workspace index is invalid: %1").arg(parseError.errorString()));
+        return false;
+    }
+    file.read(1);
+    const qint64 dataStart = file.pos();
+    const qint64 dataSize = file.size() - dataStart;
+
+    // Only the index is read here, with session contents left in the file
+    const QJsonObject index = doc.object();
+    const QJsonArray jsonSessions = index["sessions"].toArray();
+    QVector<Entry> entries;
+    for (const QJsonValue &value : jsonSessions) {
+        const QJsonObject jsonSession = value.toObject();
+        Entry entry;
+        entry.name = jsonSession["name"].toString();
+        entry.created = QDateTime::fromString(jsonSession["created"].toString(), Qt::ISODateWithMs);
+        entry.readingCount = jsonSession["readings"].toInt();
+        entry.offset = static_cast<qint64>(jsonSession["offset"].toDouble(-1));
+        entry.size = static_cast<qint64>(jsonSession["size"].toDouble(-1));
+        if (entry.offset < 0 || entry.size <= 0 || entry.offset + entry.size > dataSize) {
+            setError(errorString, QStringLiteral("Session \"%1\" is truncated").arg(entry.name));
+            return false;
+        }
+        entry.offset += dataStart;
+        entries.append(entry);
+    }
+    if (entries.isEmpty()) {
+        setError(errorString, QStringLiteral("Workspace has no sessions"));
+        return false;
+    }
+
+    entries_ = entries;
+    currentSession_ = qBound(0, index["current"].toInt(), entries_.size() - 1);
+    sourceFileName_ = fileName;
+    if (originalFileName) {
+        *originalFileName = index["file"].toString();
+    }
+    return true;
+}
+
+bool Workspace::save(const QString &fileName, QString *errorString)
+{
+    if (!write(fileName, errorString)) {
+        return false;
+    }
+
+    fileName_ = fileName;
+    modified_ = false;
+    discardRecovery();
+    return true;
+}
+
+bool Workspace::autosave(QString *errorString)
+{
+    QFileInfo(recoveryFileName()).absoluteDir().mkpath(QStringLiteral("."));
+    return write(recoveryFileName(), errorString);
+}
+
+bool Workspace::recover(QString *errorString)
+{
+    QString originalFileName;
+    if (!read(recoveryFileName(), &originalFileName, errorString)) {
+        return false;
+    }
+    fileName_ = originalFileName;
+    modified_ = true;
+    return true;
+}
+
+void Workspace::discardRecovery()
+{
+    QFile::remove(recoveryFileName());
+}
+
+bool Workspace::write(const QString &fileName, QString *errorString)
+{
+    // Sessions that have been accessed are written out again, while the
+    // rest are copied across from the previous file as they are
+    QVector<QByteArray> contents(entries_.size());
+    QVector<qint64> sizes(entries_.size());
+    for (int i = 0; i < entries_.size(); i++) {
+        if (entries_.at(i).session) {
+            contents[i] = sessionToJson(*entries_.at(i).session);
+            sizes[i] = contents.at(i).size();
+        } else {
+            sizes[i] = entries_.at(i).size;
+        }
+    }
+
+    QFile sourceFile(sourceFileName_);
+    for (const Entry &entry : qAsConst(entries_)) {
+        if (!entry.session) {
+            if (!sourceFile.open(QIODevice::ReadOnly)) {
+                setError(errorString, QStringLiteral("Unable to read previous workspace file: %1").arg(sourceFile.errorString()));
+                return false;
+            }
+            break;
+        }
+    }
+
+    QJsonArray jsonSessions;
+    qint64 offset = 0;
+    for (int i = 0; i < entries_.size(); i++) {
+        const Entry &entry = entries_.at(i);
+        QJsonObject jsonSession;
+        jsonSession["name"] = entry.session ? entry.session->name : entry.name;
+        jsonSession["created"] = (entry.session ? entry.session->created : entry.created).toString(Qt::ISODateWithMs);
+        jsonSession["readings"] = entry.session ? countReadings(entry.session->rows) : entry.readingCount;
+        jsonSession["offset"] = static_cast<double>(offset);
+        jsonSession["size"] = static_cast<double>(sizes.at(i));
+        jsonSessions.append(jsonSession);
+        offset += sizes.at(i) + 1;
+    }
+
+    QJsonObject index;
+    index["version"] = QString::number(FILE_VERSION);
+    index["date"] = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm");
+    index["current"] = currentSession_;
+    if (fileName == recoveryFileName()) {
+        index["file"] = fileName_;
+    }
+    index["sessions"] = jsonSessions;
+    const QByteArray indexData = QJsonDocument(index).toJson(QJsonDocument::Compact);
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        setError(errorString, file.errorString());
+        return false;
+    }
+
+    file.write(FILE_MAGIC + ' ' + QByteArray::number(FILE_VERSION) + ' ' + QByteArray::number(indexData.size()) + '\n');
+    file.write(indexData + '\n');
+
+    QVector<qint64> offsets(entries_.size());
+    for (int i = 0; i < entries_.size(); i++) {
+        offsets[i] = file.pos();
+        if (entries_.at(i).session) {
+            file.write(contents.at(i));
+        } else {
+            sourceFile.seek(entries_.at(i).offset);
+            qint64 remaining = entries_.at(i).size;
+            while (remaining > 0) {
+                const QByteArray chunk = sourceFile.read(qMin(remaining, COPY_CHUNK_SIZE));
+                if (chunk.isEmpty()) {
+                    file.cancelWriting();
+                    break;
+                }
+                file.write(chunk);
+                remaining -= chunk.size();
+            }
+        }
+        file.write("\n", 1);
+    }
+
+    // Nothing replaces the previous file unless everything was written
+    if (!file.commit()) {
+        setError(errorString, file.errorString());
+        return false;
+    }
+
+    for (int i = 0; i < entries_.size(); i++) {
+        Entry &entry = entries_[i];
+        entry.offset = offsets.at(i);
+        entry.size = sizes.at(i);
+        if (entry.session) {
+            entry.name = entry.session->name;
+            entry.created = entry.session->created;
+            entry.readingCount = countReadings(entry.session->rows);
+        }
+    }
+    sourceFileName_ = fileName;
+    return true;
+}
+
+int Workspace::sessionCount() const
+{
+    return entries_.size();
+}
+
+QString Workspace::sessionName(int index) const
+{
+    if (index < 0 || index >= entries_.size()) { return QString(); }
+    const Entry &entry = entries_.at(index);
+    return entry.session ? entry.session->name : entry.name;
+}
+
+int Workspace::sessionReadingCount(int index) const
+{
+    if (index < 0 || index >= entries_.size()) { return 0; }
+    const Entry &entry = entries_.at(index);
+    return entry.session ? countReadings(entry.session->rows) : entry.readingCount;
+}
+
+int Workspace::currentSession() const
+{
+    return currentSession_;
+}
+
+void Workspace::setCurrentSession(int index)
+{
+    if (index < 0 || index >= entries_.size()) { return; }
+    currentSession_ = index;
+}
+
+QSharedPointer<WorkspaceSession> Workspace::session(int index, QString *errorString)
+{
+    if (index < 0 || index >= entries_.size()) { return QSharedPointer<WorkspaceSession>(); }
+
+    Entry &entry = entries_[index];
+    if (entry.session) {
+        return entry.session;
+    }
+
+    QFile file(sourceFileName_);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(entry.offset)) {
+        setError(errorString, file.errorString());
+        return QSharedPointer<WorkspaceSession>();
+    }
+    const QByteArray data = file.read(entry.size);
+    if (data.size() != entry.size) {
+        setError(errorString, QStringLiteral("Session \"%1\" is truncated").arg(entry.name));
+        return QSharedPointer<WorkspaceSession>();
+    }
+
+    WorkspaceSession *session = sessionFromJson(data, errorString);
+    if (!session) {
+        return QSharedPointer<WorkspaceSession>();
+    }
+
+    // Renaming a session that was never read only changes the index,
+    // so the name there is the one to keep
+    session->name = entry.name;
+    entry.session = QSharedPointer<WorkspaceSession>(session);
+    return entry.session;
+}
+
+int Workspace::addSession(const QString &name)
+{
+    Entry entry;
+    entry.session = QSharedPointer<WorkspaceSession>::create();
+    entry.session->name = name;
+    entry.session->created = QDateTime::currentDateTimeUtc();
+    entry.name = name;
+    entry.created = entry.session->created;
+    entries_.append(entry);
+    modified_ = true;
+    return entries_.size() - 1;
+}
+
+void Workspace::removeSession(int index)
+{
+    if (index < 0 || index >= entries_.size()) { return; }
+
+    entries_.remove(index);
+    if (entries_.isEmpty()) {
+        addSession(QStringLiteral("Session 1"));
+    }
+    if (currentSession_ >= index && currentSession_ > 0) {
+        currentSession_--;
+    }
+    modified_ = true;
+}
+
+void Workspace::renameSession(int index, const QString &name)
+{
+    if (index < 0 || index >= entries_.size()) { return; }
+
+    Entry &entry = entries_[index];
+    entry.name = name;
+    if (entry.session) {
+        entry.session->name = name;
+    }
+    modified_ = true;
+}
+
+int Workspace::countReadings(const QVector<MeasTableRow> &rows)
+{
+    int count = 0;
+    for (const MeasTableRow &row : rows) {
+        if (!row.value.isEmpty()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+QByteArray Workspace::sessionToJson(const WorkspaceSession &session)
+{
+    // Empty rows at the end of the table are just padding
+    int rowCount = session.rows.size();
+    while (rowCount > 0 && isEmptyRow(session.rows.at(rowCount - 1))) {
+        rowCount--;
+    }
+
+    QStringList columns = session.columns;
+    for (int i = 0; i < rowCount; i++) {
+        for (auto it = session.rows.at(i).computed.constBegin(); it != session.rows.at(i).computed.constEnd(); ++it) {
+            if (!columns.contains(it.key())) {
+                columns.append(it.key());
+            }
+        }
+    }
+
+    QJsonArray jsonRows;
+    for (int i = 0; i < rowCount; i++) {
+        const MeasTableRow &row = session.rows.at(i);
+        QJsonArray jsonRow;
+        jsonRow.append(row.type);
+        jsonRow.append(row.value);
+        jsonRow.append(row.offset);
+        jsonRow.append(row.uncertainty);
+        jsonRow.append(row.raw);
+        jsonRow.append(row.corrected);
+        jsonRow.append(row.flagged ? row.flaggedToolTip : QString());
+        jsonRow.append(row.time.isValid() ? row.time.toUTC().toString(Qt::ISODateWithMs) : QString());
+        for (const QString &column : qAsConst(columns)) {
+            jsonRow.append(row.computed.value(column));
+        }
+        jsonRows.append(jsonRow);
+    }
+
+    QJsonObject jsonSystem;
+    jsonSystem["name"] = session.deviceName;
+    jsonSystem["version"] = session.deviceVersion;
+    jsonSystem["uid"] = session.uniqueId;
+
+    QJsonObject jsonSession;
+    jsonSession["name"] = session.name;
+    jsonSession["notes"] = session.notes;
+    jsonSession["created"] = session.created.toString(Qt::ISODateWithMs);
+    jsonSession["system"] = jsonSystem;
+    jsonSession["calibration"] = session.calibration;
+    jsonSession["columns"] = QJsonArray::fromStringList(columns);
+    jsonSession["rows"] = jsonRows;
+    return QJsonDocument(jsonSession).toJson(QJsonDocument::Compact);
+}
+
+WorkspaceSession *Workspace::sessionFromJson(const QByteArray &data, QString *errorString)
+{
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        setError(errorString, QStringLiteral("Session is invalid: %1").arg(parseError.errorString()));
+        return nullptr;
+    }
+
+    const QJsonObject jsonSession = doc.object();
+    const QJsonObject jsonSystem = jsonSession["system"].toObject();
+
+    WorkspaceSession *session = new WorkspaceSession();
+    session->name = jsonSession["name"].toString();
+    session->notes = jsonSession["notes"].toString();
+    session->created = QDateTime::fromString(jsonSession["created"].toString(), Qt::ISODateWithMs);
+    session->deviceName = jsonSystem["name"].toString();
+    session->deviceVersion = jsonSystem["version"].toString();
+    session->uniqueId = jsonSystem["uid"].toString();
+    session->calibration = jsonSession["calibration"].toObject();
+
+    const QJsonArray jsonColumns = jsonSession["columns"].toArray();
+    for (const QJsonValue &value : jsonColumns) {
+        session->columns.append(value.toString());
+    }
+
+    const QJsonArray jsonRows = jsonSession["rows"].toArray();
+    session->rows.reserve(jsonRows.size());
+    for (const QJsonValue &value : jsonRows) {
+        const QJsonArray jsonRow = value.toArray();
+        MeasTableRow row = MeasTableRow();
+        row.type = jsonRow.at(RowType).toString();
+        row.value = jsonRow.at(RowValue).toString();
+        row.offset = jsonRow.at(RowOffset).toString();
+        row.uncertainty = jsonRow.at(RowUncertainty).toString();
+        row.raw = jsonRow.at(RowRaw).toString();
+        row.corrected = jsonRow.at(RowCorrected).toString();
+        row.flaggedToolTip = jsonRow.at(RowFlagged).toString();
+        row.flagged = !row.flaggedToolTip.isEmpty();
+        const QString time = jsonRow.at(RowTime).toString();
+        if (!time.isEmpty()) {
+            row.time = QDateTime::fromString(time, Qt::ISODateWithMs);
+        }
+        for (int i = 0; i < session->columns.size() && RowFixedFields + i < jsonRow.size(); i++) {
+            const QString computed = jsonRow.at(RowFixedFields + i).toString();
+            if (!computed.isEmpty()) {
+                row.computed.insert(session->columns.at(i), computed);
+            }
+        }
+        session->rows.append(row);
+    }
+
+    return session;
+}
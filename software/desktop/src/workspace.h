@@ -0,0 +1,135 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <QDateTime>
+#include <QJsonObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "undocommands.h"
+
+/**
+ * A named measurement session within a workspace.
+ */
+struct WorkspaceSession
+{
+    QString name;
+    QString notes;
+    QDateTime created;
+
+    // Device used for the most recent reading in the session
+    QString deviceName;
+    QString deviceVersion;
+    QString uniqueId;
+
+    // Calibration in effect for the most recent reading, in the same
+    // layout as the "calibration" object of an exported settings file
+    QJsonObject calibration;
+
+    // Computed columns, and the rows of the measurement table
+    QStringList columns;
+    QVector<MeasTableRow> rows;
+};
+
+/**
+ * Project file holding multiple measurement sessions.
+ *
+ * The file starts with a header line giving the format version and the
+ * length of an index. The index is a JSON object listing each session's
+ * name, reading count, and the location of its contents. Session contents
+ * follow the index, each as a separate compact JSON object.
+ *
+ * Loading a workspace only reads the index. The contents of a session
+ * are read the first time the session is accessed, so large projects
+ * open quickly. When the workspace is saved, sessions that were never
+ * accessed are copied across from the previous file without being parsed.
+ *
+ * Files are always written through a temporary file that replaces the
+ * original once it has been completely written, so an interrupted save
+ * leaves the previous file intact. Autosaves go to a separate recovery
+ * file, so the workspace's own file only changes when it is saved.
+ */
+class Workspace
+{
+public:
+    Workspace();
+
+    /** File used to autosave the workspace between saves */
+    static QString recoveryFileName();
+
+    /**
+     * Calibration snapshot in the same layout as the "calibration" object
+     * of an exported settings file, with only the valid values included.
+     */
+    static QJsonObject calibrationToJson(const DensCalGain &calGain, const DensCalSlope &calSlope,
+                                         const DensCalTarget &calReflection, const DensCalTarget &calTransmission);
+
+    QString fileName() const;
+    bool isModified() const;
+    void setModified();
+
+    /** Replace the contents of the workspace with a single empty session */
+    void clear();
+
+    bool load(const QString &fileName, QString *errorString = nullptr);
+    bool save(const QString &fileName, QString *errorString = nullptr);
+
+    /**
+     * Write the workspace to the recovery file. This does not change
+     * the workspace's own file, or clear the modified state.
+     */
+    bool autosave(QString *errorString = nullptr);
+
+    /**
+     * Load the recovery file, as a modified copy of the workspace
+     * it was autosaved from.
+     */
+    bool recover(QString *errorString = nullptr);
+
+    /** Remove the recovery file, once its changes are saved or discarded */
+    static void discardRecovery();
+
+    int sessionCount() const;
+    QString sessionName(int index) const;
+    int sessionReadingCount(int index) const;
+    int currentSession() const;
+    void setCurrentSession(int index);
+
+    /**
+     * Get the contents of a session, reading them from the file if
+     * the session has not been accessed yet.
+     *
+     * @return The session, or null if its contents could not be read
+     */
+    QSharedPointer<WorkspaceSession> session(int index, QString *errorString = nullptr);
+
+    /** Add an empty session, returning its index */
+    int addSession(const QString &name);
+    void removeSession(int index);
+    void renameSession(int index, const QString &name);
+
+private:
+    struct Entry {
+        QString name;
+        QDateTime created;
+        int readingCount = 0;
+        qint64 offset = 0;
+        qint64 size = 0;
+        QSharedPointer<WorkspaceSession> session;
+    };
+
+    static int countReadings(const QVector<MeasTableRow> &rows);
+    static QByteArray sessionToJson(const WorkspaceSession &session);
+    static WorkspaceSession *sessionFromJson(const QByteArray &data, QString *errorString);
+    bool read(const QString &fileName, QString *originalFileName, QString *errorString);
+    bool write(const QString &fileName, QString *errorString);
+
+    QString fileName_;
+    QString sourceFileName_;
+    QVector<Entry> entries_;
+    int currentSession_;
+    bool modified_;
+};
+
+#endif // WORKSPACE_H
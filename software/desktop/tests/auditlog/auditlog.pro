@@ -0,0 +1,17 @@
+QT += testlib
+QT -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_auditlog
+
+SRC_DIR = ../../src
+INCLUDEPATH += $$SRC_DIR
+
+SOURCES += \
+    tst_auditlog.cpp \
+    $$SRC_DIR/auditlog.cpp
+
+HEADERS += \
+    $$SRC_DIR/auditlog.h
@@ -0,0 +1,332 @@
+#include <QtTest>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+
+#include "auditlog.h"
+
+/*
+ * Tests for the audit log hash chain, as checked by --verify-audit.
+ * Each test writes a log through AuditLog, tampers with the file the
+ * way someone editing it by hand would, and checks what verify() finds.
+ */
+class TestAuditLog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void intact();
+    void untrackedChange();
+    void untrackedChangeWhilePending();
+    void cancelledChange();
+    void alteredEntry();
+    void brokenLink();
+    void gap();
+    void reordered();
+    void malformedEntry();
+    void truncated();
+    void truncatedToEmpty();
+    void missingFile();
+
+private:
+    QString writeLog(const QString &fileName);
+    static QList<QByteArray> readLines(const QString &fileName);
+    static void writeLines(const QString &fileName, const QList<QByteArray> &lines);
+    static QJsonObject entryAt(const QList<QByteArray> &lines, int index);
+    static QByteArray toLine(const QJsonObject &entry);
+    static void rehash(QJsonObject *entry);
+
+    QTemporaryDir tempDir_;
+    QString fileName_;
+};
+
+void TestAuditLog::initTestCase()
+{
+    QVERIFY(tempDir_.isValid());
+
+    // Keep the default log and its anchor in the settings away from
+    // those of a real installation
+    QStandardPaths::setTestModeEnabled(true);
+    QCoreApplication::setOrganizationName(QStringLiteral("tst_auditlog"));
+    QCoreApplication::setApplicationName(QStringLiteral("tst_auditlog"));
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, tempDir_.path());
+}
+
+void TestAuditLog::init()
+{
+    fileName_ = tempDir_.filePath(QStringLiteral("%1.jsonl").arg(QTest::currentTestFunction()));
+}
+
+void TestAuditLog::cleanup()
+{
+    QFile::remove(fileName_);
+    QFile::remove(AuditLog::defaultFileName());
+    QSettings().clear();
+}
+
+QString TestAuditLog::writeLog(const QString &fileName)
+{
+    // Four entries: the first sight of a device, two changes made to it,
+    // then its state read back after those changes
+    AuditLog log(fileName);
+    log.recordDeviceState(QStringLiteral("DEV1"), 3, QStringLiteral("aaaa"));
+    log.recordWrite(QStringLiteral("DEV1"), QStringLiteral("GAIN"), QStringLiteral("1,2"), QStringLiteral("3,4"));
+    log.recordWrite(QStringLiteral("DEV1"), QStringLiteral("SLOPE"), QString(), QStringLiteral("5,6,7"));
+    log.recordDeviceState(QStringLiteral("DEV1"), 5, QStringLiteral("bbbb"));
+    return fileName;
+}
+
+QList<QByteArray> TestAuditLog::readLines(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) { return QList<QByteArray>(); }
+    return file.readAll().trimmed().split('\n');
+}
+
+void TestAuditLog::writeLines(const QString &fileName, const QList<QByteArray> &lines)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) { return; }
+    for (const QByteArray &line : lines) {
+        file.write(line + '\n');
+    }
+}
+
+QJsonObject TestAuditLog::entryAt(const QList<QByteArray> &lines, int index)
+{
+    return QJsonDocument::fromJson(lines.at(index)).object();
+}
+
+QByteArray TestAuditLog::toLine(const QJsonObject &entry)
+{
+    return QJsonDocument(entry).toJson(QJsonDocument::Compact);
+}
+
+void TestAuditLog::rehash(QJsonObject *entry)
+{
+    // Same hash as AuditLog writes, as anyone reading the format could
+    // work out, so edits can be made that only break the chain
+    QJsonObject content = *entry;
+    content.remove("hash");
+    const QByteArray data = QJsonDocument(content).toJson(QJsonDocument::Compact);
+    entry->insert("hash", QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex()));
+}
+
+void TestAuditLog::intact()
+{
+    writeLog(fileName_);
+    QCOMPARE(readLines(fileName_).size(), 4);
+
+    QStringList issues;
+    QVERIFY(AuditLog::verify(fileName_, &issues));
+    QVERIFY2(issues.isEmpty(), qPrintable(issues.join('\n')));
+
+    // Reopening the log continues the same chain
+    AuditLog log(fileName_);
+    QVERIFY(log.recordWrite(QStringLiteral("DEV1"), QStringLiteral("LIGHT"), QString(), QStringLiteral("8,9")));
+    QVERIFY(AuditLog::verify(fileName_, &issues));
+    QVERIFY(issues.isEmpty());
+}
+
+void TestAuditLog::untrackedChange()
+{
+    writeLog(fileName_);
+    {
+        AuditLog log(fileName_);
+        QCOMPARE(log.recordDeviceState(QStringLiteral("DEV1"), 5, QStringLiteral("bbbb")), AuditLog::DeviceUnchanged);
+        QCOMPARE(log.recordDeviceState(QStringLiteral("DEV1"), 6, QStringLiteral("cccc")), AuditLog::DeviceUntracked);
+    }
+
+    // Reported, but the chain itself is still intact
+    QStringList issues;
+    QVERIFY(AuditLog::verify(fileName_, &issues));
+    QCOMPARE(issues, QStringList() << QStringLiteral("Line 5: untracked change on device DEV1 (5,bbbb -> 6,cccc)"));
+}
+
+void TestAuditLog::untrackedChangeWhilePending()
+{
+    writeLog(fileName_);
+    {
+        AuditLog log(fileName_);
+
+        // One more change than was sent from here, made on the device
+        // while the logged changes were pending
+        log.recordWrite(QStringLiteral("DEV1"), QStringLiteral("LIGHT"), QString(), QStringLiteral("8,9"));
+        log.recordWrite(QStringLiteral("DEV1"), QStringLiteral("REFL"), QString(), QStringLiteral("0.1,2.0"));
+        QCOMPARE(log.recordDeviceState(QStringLiteral("DEV1"), 8, QStringLiteral("cccc")), AuditLog::DeviceUntracked);
+
+        // Fewer changes than were sent is not accepted either
+        log.recordWrite(QStringLiteral("DEV1"), QStringLiteral("TRAN"), QString(), QStringLiteral("3.0"));
+        log.recordWrite(QStringLiteral("DEV1"), QStringLiteral("SLOPE"), QString(), QStringLiteral("1,2,3"));
+        QCOMPARE(log.recordDeviceState(QStringLiteral("DEV1"), 9, QStringLiteral("dddd")), AuditLog::DeviceUntracked);
+
+        // Only the exact number of changes is in sync
+        log.recordWrite(QStringLiteral("DEV1"), QStringLiteral("GAIN"), QString(), QStringLiteral("5,6"));
+        QCOMPARE(log.recordDeviceState(QStringLiteral("DEV1"), 10, QStringLiteral("eeee")), AuditLog::DeviceSynced);
+    }
+
+    // The pending changes are counted again when the log is reopened
+    {
+        AuditLog log(fileName_);
+        log.recordWrite(QStringLiteral("DEV1"), QStringLiteral("LIGHT"), QString(), QStringLiteral("7,7"));
+    }
+    {
+        AuditLog log(fileName_);
+        QCOMPARE(log.recordDeviceState(QStringLiteral("DEV1"), 12, QStringLiteral("ffff")), AuditLog::DeviceUntracked);
+    }
+
+    QStringList issues;
+    QVERIFY(AuditLog::verify(fileName_, &issues));
+    QCOMPARE(issues, QStringList()
+             << QStringLiteral("Line 7: untracked change on device DEV1 (5,bbbb -> 8,cccc)")
+             << QStringLiteral("Line 10: untracked change on device DEV1 (8,cccc -> 9,dddd)")
+             << QStringLiteral("Line 14: untracked change on device DEV1 (10,eeee -> 12,ffff)"));
+}
+
+void TestAuditLog::cancelledChange()
+{
+    writeLog(fileName_);
+    {
+        AuditLog log(fileName_);
+
+        // Nothing to cancel without a pending change
+        QVERIFY(!log.recordCancel(QStringLiteral("DEV1"), QStringLiteral("GAIN")));
+
+        log.recordWrite(QStringLiteral("DEV1"), QStringLiteral("GAIN"), QStringLiteral("3,4"), QStringLiteral("MEASURE"));
+        log.recordWrite(QStringLiteral("DEV1"), QStringLiteral("SLOPE"), QString(), QStringLiteral("1,2,3"));
+        QVERIFY(log.recordCancel(QStringLiteral("DEV1"), QStringLiteral("GAIN")));
+    }
+    {
+        AuditLog log(fileName_);
+        QCOMPARE(log.recordDeviceState(QStringLiteral("DEV1"), 6, QStringLiteral("cccc")), AuditLog::DeviceSynced);
+    }
+
+    QStringList issues;
+    QVERIFY(AuditLog::verify(fileName_, &issues));
+    QVERIFY2(issues.isEmpty(), qPrintable(issues.join('\n')));
+}
+
+void TestAuditLog::alteredEntry()
+{
+    QList<QByteArray> lines = readLines(writeLog(fileName_));
+    QJsonObject entry = entryAt(lines, 1);
+    entry.insert("new", QStringLiteral("3,5"));
+    lines[1] = toLine(entry);
+    writeLines(fileName_, lines);
+
+    QStringList issues;
+    QVERIFY(!AuditLog::verify(fileName_, &issues));
+    QCOMPARE(issues, QStringList() << QStringLiteral("Line 2: entry 2 does not match its hash"));
+}
+
+void TestAuditLog::brokenLink()
+{
+    // The entry is consistent with its own hash, but no longer follows
+    // the one before it, as if it had been copied in from another log
+    QList<QByteArray> lines = readLines(writeLog(fileName_));
+    QJsonObject entry = entryAt(lines, 3);
+    entry.insert("prev", entryAt(lines, 1).value("hash").toString());
+    rehash(&entry);
+    lines[3] = toLine(entry);
+    writeLines(fileName_, lines);
+
+    QStringList issues;
+    QVERIFY(!AuditLog::verify(fileName_, &issues));
+    QCOMPARE(issues, QStringList() << QStringLiteral("Line 4: entry 4 does not link to the previous entry"));
+}
+
+void TestAuditLog::gap()
+{
+    QList<QByteArray> lines = readLines(writeLog(fileName_));
+    lines.removeAt(1);
+    writeLines(fileName_, lines);
+
+    QStringList issues;
+    QVERIFY(!AuditLog::verify(fileName_, &issues));
+    QCOMPARE(issues, QStringList()
+             << QStringLiteral("Line 2: expected entry 2, found 3")
+             << QStringLiteral("Line 2: entry 3 does not link to the previous entry"));
+}
+
+void TestAuditLog::reordered()
+{
+    QList<QByteArray> lines = readLines(writeLog(fileName_));
+    std::swap(lines[1], lines[2]);
+    writeLines(fileName_, lines);
+
+    QStringList issues;
+    QVERIFY(!AuditLog::verify(fileName_, &issues));
+    QCOMPARE(issues, QStringList()
+             << QStringLiteral("Line 2: expected entry 2, found 3")
+             << QStringLiteral("Line 2: entry 3 does not link to the previous entry")
+             << QStringLiteral("Line 3: expected entry 4, found 2")
+             << QStringLiteral("Line 3: entry 2 does not link to the previous entry")
+             << QStringLiteral("Line 4: expected entry 3, found 4")
+             << QStringLiteral("Line 4: entry 4 does not link to the previous entry"));
+}
+
+void TestAuditLog::malformedEntry()
+{
+    QList<QByteArray> lines = readLines(writeLog(fileName_));
+    lines[1].chop(1);
+    writeLines(fileName_, lines);
+
+    // The chain carries on from the last readable entry
+    QStringList issues;
+    QVERIFY(!AuditLog::verify(fileName_, &issues));
+    QCOMPARE(issues, QStringList()
+             << QStringLiteral("Line 2: not a valid entry")
+             << QStringLiteral("Line 3: expected entry 2, found 3")
+             << QStringLiteral("Line 3: entry 3 does not link to the previous entry"));
+}
+
+void TestAuditLog::truncated()
+{
+    const QString fileName = writeLog(AuditLog::defaultFileName());
+    QStringList issues;
+    QVERIFY(AuditLog::verify(fileName, &issues));
+    QVERIFY(issues.isEmpty());
+
+    // What is left is a valid chain, so only the anchor can catch this
+    QList<QByteArray> lines = readLines(fileName);
+    lines.removeLast();
+    writeLines(fileName, lines);
+
+    QVERIFY(!AuditLog::verify(fileName, &issues));
+    QCOMPARE(issues, QStringList() << QStringLiteral("Log ends at entry 3, but entry 4 was the last one written"));
+
+    // Other log files have no anchor, so the same edit goes unnoticed
+    writeLines(fileName_, lines);
+    issues.clear();
+    QVERIFY(AuditLog::verify(fileName_, &issues));
+    QVERIFY(issues.isEmpty());
+}
+
+void TestAuditLog::truncatedToEmpty()
+{
+    const QString fileName = writeLog(AuditLog::defaultFileName());
+    writeLines(fileName, QList<QByteArray>());
+
+    QStringList issues;
+    QVERIFY(!AuditLog::verify(fileName, &issues));
+    QCOMPARE(issues, QStringList() << QStringLiteral("Log ends at entry 0, but entry 4 was the last one written"));
+}
+
+void TestAuditLog::missingFile()
+{
+    QStringList issues;
+    QVERIFY(!AuditLog::verify(fileName_, &issues));
+    QCOMPARE(issues, QStringList() << QStringLiteral("Unable to open audit log: %1").arg(fileName_));
+}
+
+QTEST_GUILESS_MAIN(TestAuditLog)
+
+#include "tst_auditlog.moc"
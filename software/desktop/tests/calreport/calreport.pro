@@ -0,0 +1,39 @@
+QT += testlib gui widgets printsupport serialport network
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_calreport
+
+SRC_DIR = ../../src
+INCLUDEPATH += $$SRC_DIR
+
+SOURCES += \
+    tst_calreport.cpp \
+    $$SRC_DIR/calreport.cpp \
+    $$SRC_DIR/cgats.cpp \
+    $$SRC_DIR/denscalvalues.cpp \
+    $$SRC_DIR/denscommand.cpp \
+    $$SRC_DIR/densinterface.cpp \
+    $$SRC_DIR/denstransport.cpp \
+    $$SRC_DIR/settingsschema.cpp \
+    $$SRC_DIR/steptablet.cpp \
+    $$SRC_DIR/util.cpp
+
+HEADERS += \
+    $$SRC_DIR/calreport.h \
+    $$SRC_DIR/cgats.h \
+    $$SRC_DIR/denscalvalues.h \
+    $$SRC_DIR/denscommand.h \
+    $$SRC_DIR/densinterface.h \
+    $$SRC_DIR/denstransport.h \
+    $$SRC_DIR/settingsschema.h \
+    $$SRC_DIR/steptablet.h \
+    $$SRC_DIR/util.h
+
+# Built-in report template and logo
+RESOURCES += \
+    ../../assets/densitometer.qrc
+
+OTHER_FILES += \
+    data/device.pds
@@ -0,0 +1,303 @@
+#include <QtTest>
+#include <QApplication>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+
+#include "calreport.h"
+#include "steptablet.h"
+
+/*
+ * Tests for the calibration certificate, rendered from a saved device
+ * settings file with the offscreen platform, the same way reports are
+ * generated headlessly from the command line.
+ */
+class TestCalReport : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void fromSnapshot();
+    void htmlFields();
+    void verification();
+    void verificationFromTablet();
+    void escaping();
+    void customTemplate();
+    void pdfSinglePage();
+    void pdfMultiplePages();
+    void outputFileName();
+    void invalidSnapshot();
+
+private:
+    CalReport makeReport() const;
+    static QList<CalReportReading> makeReadings(int count, float error);
+    static int pdfPageCount(const QString &fileName);
+    static QString htmlRow(const QStringList &cells);
+
+    QTemporaryDir tempDir_;
+};
+
+void TestCalReport::initTestCase()
+{
+    QVERIFY(tempDir_.isValid());
+}
+
+CalReport TestCalReport::makeReport() const
+{
+    QString errorString;
+    CalReport report = CalReport::fromSnapshot(QFINDTESTDATA("data/device.pds"), &errorString);
+    if (!errorString.isEmpty()) { qWarning() << errorString; }
+
+    // Fixed, so the rendered report is the same every time
+    report.setDate(QDateTime(QDate(2024, 3, 1), QTime(9, 15)));
+    report.setOperatorName(QStringLiteral("J. Smith"));
+    report.setTabletName(QStringLiteral("#T21-0042 (21 patches)"));
+    return report;
+}
+
+QList<CalReportReading> TestCalReport::makeReadings(int count, float error)
+{
+    QList<CalReportReading> readings;
+    for (int i = 0; i < count; i++) {
+        CalReportReading reading;
+        reading.target = 0.05F + (0.15F * (i % 21));
+        reading.measured = reading.target + ((i % 2) ? error : -error);
+        readings.append(reading);
+    }
+    return readings;
+}
+
+int TestCalReport::pdfPageCount(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) { return -1; }
+    const QByteArray data = file.readAll();
+    if (!data.startsWith("%PDF-")) { return -1; }
+
+    // Page objects, but not the page tree node that holds them
+    const QRegularExpression pageType(QStringLiteral("/Type\\s*/Page(?!s)"));
+    return QString::fromLatin1(data).count(pageType);
+}
+
+QString TestCalReport::htmlRow(const QStringList &cells)
+{
+    QString row = QStringLiteral("<tr>");
+    for (const QString &cell : cells) {
+        row += QStringLiteral("<td>%1</td>").arg(cell);
+    }
+    row += QStringLiteral("</tr>");
+    return row;
+}
+
+void TestCalReport::fromSnapshot()
+{
+    const CalReport report = makeReport();
+    QVERIFY(report.isValid());
+    QCOMPARE(report.deviceName(), QStringLiteral("Printalyzer Densitometer"));
+    QCOMPARE(report.uniqueId(), QStringLiteral("004A0027594B500920373233"));
+    QCOMPARE(report.version(), QStringLiteral("v0.7.0"));
+    QCOMPARE(report.tolerance(), 0.02F);
+    QVERIFY(report.readings().isEmpty());
+}
+
+void TestCalReport::htmlFields()
+{
+    const QString html = makeReport().toHtml();
+
+    // Every placeholder in the built-in template is filled in
+    QVERIFY(!html.contains(QStringLiteral("{{")));
+    QVERIFY(html.contains(QStringLiteral("<title>Calibration Certificate 004A0027594B500920373233</title>")));
+    QVERIFY(html.contains(QStringLiteral("<td>Printalyzer Densitometer</td>")));
+    QVERIFY(html.contains(QStringLiteral("<td>004A0027594B500920373233</td>")));
+    QVERIFY(html.contains(QStringLiteral("<td>v0.7.0 (v0.7.0-3-g1a2b3c4, 9c41e07d)</td>")));
+    QVERIFY(html.contains(QStringLiteral("<td>2024-03-01 09:15</td>")));
+    QVERIFY(html.contains(QStringLiteral("<td>J. Smith</td>")));
+    QVERIFY(html.contains(QStringLiteral("<td>#T21-0042 (21 patches)</td>")));
+    QVERIFY(html.contains(QStringLiteral("<img src=\"data:image/png;base64,")));
+
+    // Calibration values, as tables
+    QVERIFY(html.contains(htmlRow({ "Low", "1.000000", "1.000000" })));
+    QVERIFY(html.contains(htmlRow({ "Medium", "24.523111", "25.107422" })));
+    QVERIFY(html.contains(htmlRow({ "High", "392.104828", "401.977203" })));
+    QVERIFY(html.contains(htmlRow({ "Maximum", "8912.314453", "9104.622070" })));
+    QVERIFY(html.contains(htmlRow({ "-0.048313", "0.934861", "0.013247" })));
+    QVERIFY(html.contains(htmlRow({ "Low", "0.08", "0.328112" })));
+    QVERIFY(html.contains(htmlRow({ "High", "1.99", "0.004512" })));
+    QVERIFY(html.contains(htmlRow({ "Low", "0.00", "2.412091" })));
+    QVERIFY(html.contains(htmlRow({ "High", "3.01", "0.002344" })));
+
+    // Nothing to verify against
+    QVERIFY(html.contains(QStringLiteral("Tolerance: &plusmn;0.02 D")));
+    QVERIFY(html.contains(QStringLiteral("<p>No verification readings.</p>")));
+    QVERIFY(html.contains(QStringLiteral("<b>Result: Not verified</b>")));
+}
+
+void TestCalReport::verification()
+{
+    CalReport report = makeReport();
+    report.setReadings(makeReadings(5, 0.01F));
+    QVERIFY(report.passed());
+
+    QString html = report.toHtml();
+    QVERIFY(html.contains(QStringLiteral("<th>Patch</th><th>Target</th><th>Measured</th><th>Deviation</th><th>Result</th>")));
+    QVERIFY(html.contains(htmlRow({ "1", "0.05", "0.04", "-0.01", "Pass" })));
+    QVERIFY(html.contains(htmlRow({ "2", "0.20", "0.21", "0.01", "Pass" })));
+    QVERIFY(html.contains(QStringLiteral("<b>Result: Pass</b>")));
+
+    // A single reading out of tolerance fails the whole report
+    QList<CalReportReading> readings = makeReadings(5, 0.01F);
+    readings[3].measured = readings[3].target + 0.05F;
+    report.setReadings(readings);
+    QVERIFY(!report.passed());
+    html = report.toHtml();
+    QVERIFY(html.contains(htmlRow({ "4", "0.50", "0.55", "0.05", "Fail" })));
+    QVERIFY(html.contains(QStringLiteral("<b>Result: Fail</b>")));
+
+    // Which passes with a wider tolerance
+    report.setTolerance(0.06F);
+    QVERIFY(report.passed());
+    html = report.toHtml();
+    QVERIFY(html.contains(QStringLiteral("Tolerance: &plusmn;0.06 D")));
+    QVERIFY(html.contains(QStringLiteral("<b>Result: Pass</b>")));
+
+    // A missing measurement is never within tolerance
+    readings[1].measured = qQNaN();
+    report.setReadings(readings);
+    QVERIFY(!report.passed());
+    QVERIFY(report.toHtml().contains(htmlRow({ "2", "0.20", "-", "-", "Fail" })));
+}
+
+void TestCalReport::verificationFromTablet()
+{
+    const QString fileName = tempDir_.filePath(QStringLiteral("readings.txt"));
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write("# Measured after calibration\nDensity\n0.06\n0.51\n1.00\n");
+    file.close();
+
+    // Readings without targets take them from the tablet, in patch order
+    const StepTablet tablet(QStringLiteral("T5-0001"), QStringLiteral("Check strip"), { 0.05F, 0.50F, 0.99F, 1.52F, 2.01F });
+    CalReport report = makeReport();
+    report.setTabletName(QString());
+    QString errorString;
+    QVERIFY2(report.loadReadings(fileName, tablet, &errorString), qPrintable(errorString));
+    QCOMPARE(report.readings().size(), 3);
+    QCOMPARE(report.tabletName(), tablet.displayName());
+
+    const QString html = report.toHtml();
+    QVERIFY(html.contains(QStringLiteral("<td>#T5-0001 - Check strip (5 patches)</td>")));
+    QVERIFY(html.contains(htmlRow({ "3", "0.99", "1.00", "0.01", "Pass" })));
+    QVERIFY(html.contains(QStringLiteral("<b>Result: Pass</b>")));
+
+    // More readings than the tablet has patches
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate));
+    file.write("0.06\n0.51\n1.00\n1.50\n2.00\n2.50\n");
+    file.close();
+    QVERIFY(!report.loadReadings(fileName, tablet, &errorString));
+    QCOMPARE(errorString, QStringLiteral("More readings than tablet patches"));
+    QCOMPARE(report.readings().size(), 3);
+}
+
+void TestCalReport::escaping()
+{
+    CalReport report = makeReport();
+    report.setOperatorName(QStringLiteral("<b>Lab & Co</b>"));
+
+    const QString html = report.toHtml();
+    QVERIFY(html.contains(QStringLiteral("<td>&lt;b&gt;Lab &amp; Co&lt;/b&gt;</td>")));
+    QVERIFY(!html.contains(QStringLiteral("<b>Lab")));
+}
+
+void TestCalReport::customTemplate()
+{
+    const QString fileName = tempDir_.filePath(QStringLiteral("template.html"));
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write("<html><body><p>{{UID}}|{{OPERATOR}}|{{RESULT}}|{{UNKNOWN}}</p>{{SLOPE_TABLE}}</body></html>\n");
+    file.close();
+
+    CalReport report = makeReport();
+    QString errorString;
+    QVERIFY2(report.setTemplateFile(fileName, &errorString), qPrintable(errorString));
+
+    const QString html = report.toHtml();
+    QVERIFY(html.contains(QStringLiteral("<p>004A0027594B500920373233|J. Smith|Not verified|{{UNKNOWN}}</p>")));
+    QVERIFY(html.contains(htmlRow({ "-0.048313", "0.934861", "0.013247" })));
+    QVERIFY(!html.contains(QStringLiteral("Sensor Gain")));
+
+    QVERIFY(!report.setTemplateFile(tempDir_.filePath(QStringLiteral("missing.html")), &errorString));
+    QVERIFY(!errorString.isEmpty());
+}
+
+void TestCalReport::pdfSinglePage()
+{
+    CalReport report = makeReport();
+    report.setReadings(makeReadings(11, 0.01F));
+
+    const QString fileName = tempDir_.filePath(QStringLiteral("report.pdf"));
+    QString errorString;
+    QVERIFY2(report.write(fileName, &errorString), qPrintable(errorString));
+
+    // The certificate for a full calibration fits on one page
+    QCOMPARE(pdfPageCount(fileName), 1);
+
+    // The same report as HTML
+    const QString htmlFileName = tempDir_.filePath(QStringLiteral("report.html"));
+    QVERIFY2(report.write(htmlFileName, &errorString), qPrintable(errorString));
+    QFile htmlFile(htmlFileName);
+    QVERIFY(htmlFile.open(QIODevice::ReadOnly | QIODevice::Text));
+    QCOMPARE(QString::fromUtf8(htmlFile.readAll()), report.toHtml());
+}
+
+void TestCalReport::pdfMultiplePages()
+{
+    // A long verification table continues onto further pages
+    CalReport report = makeReport();
+    report.setReadings(makeReadings(84, 0.01F));
+
+    const QString fileName = tempDir_.filePath(QStringLiteral("long.pdf"));
+    QString errorString;
+    QVERIFY2(report.write(fileName, &errorString), qPrintable(errorString));
+
+    const int pages = pdfPageCount(fileName);
+    QVERIFY2(pages >= 2 && pages <= 4, qPrintable(QString::number(pages)));
+}
+
+void TestCalReport::outputFileName()
+{
+    const CalReport report = makeReport();
+    QCOMPARE(report.outputFileName(QStringLiteral("cert-{uid}.pdf")), QStringLiteral("cert-004A0027594B500920373233.pdf"));
+    QCOMPARE(report.outputFileName(QStringLiteral("cert.pdf")), QStringLiteral("cert.pdf"));
+}
+
+void TestCalReport::invalidSnapshot()
+{
+    QString errorString;
+    CalReport report = CalReport::fromSnapshot(tempDir_.filePath(QStringLiteral("missing.pds")), &errorString);
+    QVERIFY(!report.isValid());
+    QVERIFY(!errorString.isEmpty());
+
+    const QString fileName = tempDir_.filePath(QStringLiteral("broken.pds"));
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write("{ \"header\": ");
+    file.close();
+
+    errorString.clear();
+    report = CalReport::fromSnapshot(fileName, &errorString);
+    QVERIFY(!report.isValid());
+    QVERIFY(!errorString.isEmpty());
+}
+
+int main(int argc, char *argv[])
+{
+    // Reports are generated without a display, so test them that way
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    TestCalReport test;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_calreport.moc"
@@ -0,0 +1,21 @@
+QT += testlib
+QT -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_cgats
+
+SRC_DIR = ../../src
+INCLUDEPATH += $$SRC_DIR
+
+SOURCES += \
+    tst_cgats.cpp \
+    $$SRC_DIR/cgats.cpp
+
+HEADERS += \
+    $$SRC_DIR/cgats.h
+
+OTHER_FILES += \
+    data/chart.ti3 \
+    data/measurements.cgats
@@ -0,0 +1,233 @@
+#include <QtTest>
+#include <QBuffer>
+#include <QTemporaryDir>
+
+#include "cgats.h"
+
+/*
+ * Tests for reading and writing CGATS.17 and Argyll .ti3 files. Every
+ * file that is read and written again must read back the same, and
+ * writing it a second time must give the same text.
+ */
+class TestCgats : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void readMeasurements();
+    void readArgyll();
+
+    void roundTrip_data();
+    void roundTrip();
+    void roundTripValues_data();
+    void roundTripValues();
+
+    void readErrors_data();
+    void readErrors();
+    void isCgatsLine();
+
+private:
+    static void compareTables(const QList<CgatsTable> &actual, const QList<CgatsTable> &expected);
+    static QByteArray readAll(const QString &fileName);
+
+    QTemporaryDir tempDir_;
+};
+
+void TestCgats::initTestCase()
+{
+    QVERIFY(tempDir_.isValid());
+}
+
+void TestCgats::compareTables(const QList<CgatsTable> &actual, const QList<CgatsTable> &expected)
+{
+    QCOMPARE(actual.size(), expected.size());
+    for (int i = 0; i < actual.size(); i++) {
+        QCOMPARE(actual[i].identifier(), expected[i].identifier());
+        QCOMPARE(actual[i].keywords(), expected[i].keywords());
+        QCOMPARE(actual[i].fields(), expected[i].fields());
+        QCOMPARE(actual[i].rows(), expected[i].rows());
+    }
+}
+
+QByteArray TestCgats::readAll(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) { return QByteArray(); }
+    return file.readAll();
+}
+
+void TestCgats::readMeasurements()
+{
+    QString errorString;
+    const QList<CgatsTable> tables = CgatsReader::readFile(QFINDTESTDATA("data/measurements.cgats"), &errorString);
+    QVERIFY2(errorString.isEmpty(), qPrintable(errorString));
+    QCOMPARE(tables.size(), 1);
+
+    const CgatsTable &table = tables.first();
+    QCOMPARE(table.identifier(), QStringLiteral("CGATS.17"));
+
+    // KEYWORD declarations are not kept as keywords of their own
+    QCOMPARE(table.keywords().size(), 8);
+    QVERIFY(!table.hasKeyword("KEYWORD"));
+    QCOMPARE(table.keyword("created"), QStringLiteral("2022-11-05T14:32:10"));
+    QCOMPARE(table.keyword("CAL_REFL_LO_DENSITY"), QStringLiteral("0.08"));
+    QCOMPARE(table.keyword("NOTE"), QStringLiteral("Strip #3, \"as received\""));
+
+    QCOMPARE(table.fields(), QStringList({ "SAMPLE_ID", "SAMPLE_NAME", "MEAS_MODE", "D_VIS", "D_UNCERTAINTY" }));
+    QCOMPARE(table.densityField(), 3);
+
+    // Rows may span lines, and comments may follow them
+    QCOMPARE(table.rowCount(), 4);
+    QCOMPARE(table.rows().at(1), QStringList({ "2", "Step 2", "R", "0.52", "0.01" }));
+    QCOMPARE(table.rows().at(2), QStringList({ "3", "Step 3", "R", "1.07", "0.02" }));
+    QCOMPARE(table.value(3, 1), QString(""));
+    QCOMPARE(table.value(3, 3), QStringLiteral("-0.01"));
+}
+
+void TestCgats::readArgyll()
+{
+    QString errorString;
+    const QList<CgatsTable> tables = CgatsReader::readFile(QFINDTESTDATA("data/chart.ti3"), &errorString);
+    QVERIFY2(errorString.isEmpty(), qPrintable(errorString));
+    QCOMPARE(tables.size(), 2);
+
+    QCOMPARE(tables[0].identifier(), QStringLiteral("CTI3"));
+    QCOMPARE(tables[0].keyword("CREATED"), QStringLiteral("Sat Nov  5 14:32:10 2022"));
+    QCOMPARE(tables[0].keyword("COLOR_REP"), QStringLiteral("RGB_XYZ"));
+    QCOMPARE(tables[0].rowCount(), 4);
+    QCOMPARE(tables[0].value(3, tables[0].fieldIndex("SAMPLE_LOC")), QStringLiteral("A4"));
+    QCOMPARE(tables[0].value(3, tables[0].fieldIndex("XYZ_Z")), QStringLiteral("1.4132"));
+    QCOMPARE(tables[0].densityField(), -1);
+
+    QCOMPARE(tables[1].identifier(), QStringLiteral("CAL"));
+    QCOMPARE(tables[1].keyword("DEVICE_CLASS"), QStringLiteral("DISPLAY"));
+    QCOMPARE(tables[1].fields(), QStringList({ "RGB_I", "RGB_R", "RGB_G", "RGB_B" }));
+    QCOMPARE(tables[1].rowCount(), 3);
+}
+
+void TestCgats::roundTrip_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<QString>("suffix");
+
+    QTest::newRow("measurements") << QFINDTESTDATA("data/measurements.cgats") << QStringLiteral("cgats");
+    QTest::newRow("argyll") << QFINDTESTDATA("data/chart.ti3") << QStringLiteral("ti3");
+}
+
+void TestCgats::roundTrip()
+{
+    QFETCH(QString, fileName);
+    QFETCH(QString, suffix);
+
+    QString errorString;
+    const QList<CgatsTable> original = CgatsReader::readFile(fileName, &errorString);
+    QVERIFY2(!original.isEmpty(), qPrintable(errorString));
+
+    const QString firstFile = tempDir_.filePath(QStringLiteral("first.") + suffix);
+    QVERIFY2(CgatsWriter::writeFile(firstFile, original, &errorString), qPrintable(errorString));
+    const QList<CgatsTable> reread = CgatsReader::readFile(firstFile, &errorString);
+    compareTables(reread, original);
+
+    // Nothing is lost or added by a second pass either
+    const QString secondFile = tempDir_.filePath(QStringLiteral("second.") + suffix);
+    QVERIFY2(CgatsWriter::writeFile(secondFile, reread, &errorString), qPrintable(errorString));
+    QCOMPARE(readAll(secondFile), readAll(firstFile));
+}
+
+void TestCgats::roundTripValues_data()
+{
+    QTest::addColumn<QString>("value");
+
+    QTest::newRow("empty") << QString("");
+    QTest::newRow("number") << QStringLiteral("1.25");
+    QTest::newRow("negative") << QStringLiteral("-0.01");
+    QTest::newRow("exponent") << QStringLiteral("1.5e-3");
+    QTest::newRow("word") << QStringLiteral("R");
+    QTest::newRow("spaces") << QStringLiteral("Base  +  fog");
+    QTest::newRow("leading space") << QStringLiteral(" 1.25");
+    QTest::newRow("trailing tab") << QStringLiteral("1.25\t");
+    QTest::newRow("comment") << QStringLiteral("#3");
+    QTest::newRow("quotes") << QStringLiteral("\"quoted\"");
+    QTest::newRow("lone quote") << QStringLiteral("5\" x 7\"");
+}
+
+void TestCgats::roundTripValues()
+{
+    QFETCH(QString, value);
+
+    CgatsTable table(QStringLiteral("CGATS.17"));
+    table.setKeyword("DESCRIPTOR", value);
+    table.setKeyword("CUSTOM_KEYWORD", value);
+    table.setFields(QStringList() << "SAMPLE_ID" << "SAMPLE_NAME" << "D_VIS");
+    table.appendRow(QStringList() << "1" << value << "0.50");
+    table.appendRow(QStringList() << "2" << "after" << value);
+
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::ReadWrite | QIODevice::Text));
+    {
+        CgatsWriter writer(&buffer);
+        writer.writeTable(table);
+    }
+
+    buffer.seek(0);
+    CgatsReader reader(&buffer);
+    CgatsTable reread;
+    QVERIFY2(reader.readTable(&reread), qPrintable(reader.errorString()));
+    compareTables(QList<CgatsTable>() << reread, QList<CgatsTable>() << table);
+}
+
+void TestCgats::readErrors_data()
+{
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<QString>("error");
+
+    QTest::newRow("unterminated quote")
+            << QByteArray("CGATS.17\nDESCRIPTOR \"open\n")
+            << QStringLiteral("Unterminated quote on line 2");
+    QTest::newRow("data without format")
+            << QByteArray("CGATS.17\nBEGIN_DATA\n1\nEND_DATA\n")
+            << QStringLiteral("Data without a data format on line 2");
+    QTest::newRow("field count")
+            << QByteArray("CGATS.17\nNUMBER_OF_FIELDS 3\nBEGIN_DATA_FORMAT\nSAMPLE_ID D_VIS\nEND_DATA_FORMAT\n")
+            << QStringLiteral("Data format has 2 fields, expected 3 on line 5");
+    QTest::newRow("incomplete row")
+            << QByteArray("CGATS.17\nBEGIN_DATA_FORMAT\nSAMPLE_ID D_VIS\nEND_DATA_FORMAT\nBEGIN_DATA\n1 0.5\n2\nEND_DATA\n")
+            << QStringLiteral("Incomplete data row before line 8");
+    QTest::newRow("stray end")
+            << QByteArray("CGATS.17\nEND_DATA\n")
+            << QStringLiteral("Unexpected END_DATA on line 2");
+    QTest::newRow("truncated")
+            << QByteArray("CGATS.17\nBEGIN_DATA_FORMAT\nSAMPLE_ID D_VIS\nEND_DATA_FORMAT\nBEGIN_DATA\n1 0.5\n")
+            << QStringLiteral("Data set \"CGATS.17\" ends without any data");
+}
+
+void TestCgats::readErrors()
+{
+    QFETCH(QByteArray, text);
+    QFETCH(QString, error);
+
+    const QString fileName = tempDir_.filePath(QStringLiteral("error.txt"));
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(text);
+    file.close();
+
+    // A file with an error gives no data sets at all
+    QString errorString;
+    QVERIFY(CgatsReader::readFile(fileName, &errorString).isEmpty());
+    QCOMPARE(errorString, error);
+}
+
+void TestCgats::isCgatsLine()
+{
+    QVERIFY(CgatsReader::isCgatsLine(QStringLiteral("CGATS.17")));
+    QVERIFY(CgatsReader::isCgatsLine(QStringLiteral("  CTI3   ")));
+    QVERIFY(CgatsReader::isCgatsLine(QStringLiteral("IT8.7/2")));
+    QVERIFY(!CgatsReader::isCgatsLine(QStringLiteral("SAMPLE_ID,D_VIS")));
+}
+
+QTEST_GUILESS_MAIN(TestCgats)
+
+#include "tst_cgats.moc"
@@ -0,0 +1,275 @@
+#include <QtTest>
+#include <QtEndian>
+#include <QLoggingCategory>
+
+#include "crashreport.h"
+#include "densinterface.h"
+#include "denstransport.h"
+
+Q_DECLARE_METATYPE(CrashReport::CrashType)
+
+/*
+ * Tests for decoding the crash record, fed to DensInterface as the
+ * "GD CRASH" output of the device over an in-process pipe.
+ */
+class TestCrashReport : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void watchdogRecord();
+    void crashTypes_data();
+    void crashTypes();
+    void noRecord();
+    void tornRecord();
+    void badChecksum();
+    void badHeader();
+
+private:
+    bool connectDevice();
+    QByteArray receiveRecord(const QByteArray &output);
+
+    static QByteArray makeRecord(CrashReport::CrashType type);
+    static void updateChecksum(QByteArray &record);
+    static QByteArray crashOutput(const QByteArray &record);
+
+    DensInterface *densInterface_ = nullptr;
+    DensPipeTransport *host_ = nullptr;
+    DensPipeTransport *device_ = nullptr;
+};
+
+void TestCrashReport::initTestCase()
+{
+    QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false"));
+    qRegisterMetaType<CrashReport::CrashType>();
+}
+
+void TestCrashReport::init()
+{
+    const QPair<DensPipeTransport *, DensPipeTransport *> pair = DensPipeTransport::createPair(this);
+    host_ = pair.first;
+    device_ = pair.second;
+    QVERIFY(host_->open());
+    QVERIFY(device_->open());
+    densInterface_ = new DensInterface(this);
+    QVERIFY(connectDevice());
+}
+
+void TestCrashReport::cleanup()
+{
+    densInterface_->disconnectFromDevice();
+    delete densInterface_;
+    delete host_;
+    delete device_;
+    densInterface_ = nullptr;
+    host_ = nullptr;
+    device_ = nullptr;
+}
+
+bool TestCrashReport::connectDevice()
+{
+    if (!densInterface_->connectToDevice(host_)) { return false; }
+
+    if (!QTest::qWaitFor([this]() { return device_->canReadLine(); }, 1000)) { return false; }
+    if (device_->readLine() != "GS V\r\n") { return false; }
+    device_->write("GS V,\"Printalyzer Densitometer\",\"v0.0.0-test\",3,7\r\n");
+
+    return QTest::qWaitFor([this]() { return densInterface_->connected(); }, 1000);
+}
+
+QByteArray TestCrashReport::receiveRecord(const QByteArray &output)
+{
+    QSignalSpy recordSpy(densInterface_, &DensInterface::diagCrashRecord);
+
+    if (!densInterface_->sendGetDiagCrashRecord()) { return QByteArray("not sent"); }
+    if (!QTest::qWaitFor([this]() { return device_->canReadLine(); }, 1000)) { return QByteArray("no command"); }
+    if (device_->readLine() != "GD CRASH\r\n") { return QByteArray("wrong command"); }
+
+    device_->write(output);
+    if (!recordSpy.wait(1000) && recordSpy.isEmpty()) { return QByteArray("no response"); }
+    return recordSpy.at(0).at(0).toByteArray();
+}
+
+QByteArray TestCrashReport::makeRecord(CrashReport::CrashType type)
+{
+    // Laid out as the firmware's crash_record_t, which is little-endian
+    QByteArray record(372, '\0');
+    uchar *data = reinterpret_cast<uchar *>(record.data());
+
+    qToLittleEndian<quint32>(0x48535243UL, data + 0);
+    qToLittleEndian<quint16>(1, data + 4);
+    qToLittleEndian<quint16>(372, data + 6);
+    qToLittleEndian<quint32>(type, data + 12);
+    qToLittleEndian<quint32>(123456, data + 16);
+    qToLittleEndian<quint32>(0x89ABCDEFUL, data + 20);
+    for (int i = 0; i < 8; i++) {
+        qToLittleEndian<quint32>(0x100 + i, data + 24 + (i * 4));
+    }
+    qToLittleEndian<quint32>(0x20004F00UL, data + 56);
+    qToLittleEndian<quint32>(0x0000080BUL, data + 60);
+    record.replace(68, 6, "sensor");
+    record.replace(84, 16, "deadline 2000 ms");
+    for (int i = 0; i < 16; i++) {
+        qToLittleEndian<quint32>(0x08008001UL + (i * 0x10), data + 116 + (i * 4));
+    }
+    const QByteArray logTail("I/sensor Reading started\nW/watchdog Task sensor stalled\n");
+    record.replace(180, logTail.size(), logTail);
+
+    updateChecksum(record);
+    return record;
+}
+
+void TestCrashReport::updateChecksum(QByteArray &record)
+{
+    uint32_t crc = 0xFFFFFFFFUL;
+    for (int i = 12; i < record.size(); i++) {
+        crc ^= static_cast<uint8_t>(record.at(i));
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1UL)));
+        }
+    }
+    qToLittleEndian<quint32>(~crc, reinterpret_cast<uchar *>(record.data()) + 8);
+}
+
+QByteArray TestCrashReport::crashOutput(const QByteArray &record)
+{
+    // Lines of 32 bytes in hex, as sent by the firmware
+    QByteArray output("GD CRASH,[[\r\n");
+    for (int i = 0; i < record.size(); i += 32) {
+        output.append(record.mid(i, 32).toHex().toUpper());
+        output.append("\r\n");
+    }
+    output.append("]]\r\n");
+    return output;
+}
+
+void TestCrashReport::watchdogRecord()
+{
+    const QByteArray record = makeRecord(CrashReport::CrashWatchdog);
+
+    // Same record as the firmware host test, so both ends agree on the format
+    QCOMPARE(qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(record.constData() + 8)), 0x0905DC31U);
+    QVERIFY(crashOutput(record).startsWith(
+                "GD CRASH,[[\r\n435253480100740131DC05090700000040E20100EFCDAB890001000001010000\r\n"));
+
+    const QByteArray data = receiveRecord(crashOutput(record));
+    QCOMPARE(data, record);
+
+    const CrashReport report = CrashReport::fromRecord(data);
+    QVERIFY(report.isValid());
+    QCOMPARE(report.type(), CrashReport::CrashWatchdog);
+    QCOMPARE(report.typeName(), QStringLiteral("Task watchdog"));
+    QCOMPARE(report.uptime(), 123456U);
+    QCOMPARE(report.appChecksum(), 0xEFCDAB89U);
+    QCOMPARE(report.lr(), 0x105U);
+    QCOMPARE(report.pc(), 0x106U);
+    QCOMPARE(report.sp(), 0x20004F00U);
+    QCOMPARE(report.taskName(), QStringLiteral("sensor"));
+    QCOMPARE(report.detail(), QStringLiteral("deadline 2000 ms"));
+    QCOMPARE(report.stack().size(), 16);
+    QCOMPARE(report.stack().first(), 0x08008001U);
+    QCOMPARE(report.stack().last(), 0x080080F1U);
+    QVERIFY(report.logTail().endsWith(QStringLiteral("Task sensor stalled\n")));
+
+    const QString text = report.toText(QStringLiteral("v0.0.0-test"), 0xEFCDAB89U);
+    QVERIFY(text.contains(QStringLiteral("Crash type: Task watchdog\n")));
+    QVERIFY(text.contains(QStringLiteral("Detail: deadline 2000 ms\n")));
+    QVERIFY(text.contains(QStringLiteral("Task: sensor\n")));
+    QVERIFY(text.contains(QStringLiteral("Active exception: 7\n")));
+    QVERIFY(text.contains(QStringLiteral("  PC = 0x00000106\n")));
+    QVERIFY(text.contains(QStringLiteral("  [SP+60] 0x080080f1\n")));
+    QVERIFY(!text.contains(QStringLiteral("WARNING")));
+
+    // A different build on the device is called out
+    QVERIFY(report.toText(QStringLiteral("v0.0.1-test"), 0x12345678U).contains(QStringLiteral("WARNING")));
+}
+
+void TestCrashReport::crashTypes_data()
+{
+    QTest::addColumn<CrashReport::CrashType>("type");
+    QTest::addColumn<QString>("name");
+
+    QTest::newRow("hard fault") << CrashReport::CrashHardFault << QStringLiteral("Hard fault");
+    QTest::newRow("nmi") << CrashReport::CrashNmi << QStringLiteral("Non-maskable interrupt");
+    QTest::newRow("stack overflow") << CrashReport::CrashStackOverflow << QStringLiteral("Stack overflow");
+    QTest::newRow("malloc failed") << CrashReport::CrashMallocFailed << QStringLiteral("Memory allocation failed");
+    QTest::newRow("assert") << CrashReport::CrashAssert << QStringLiteral("Assertion failed");
+    QTest::newRow("error handler") << CrashReport::CrashErrorHandler << QStringLiteral("Error handler");
+    QTest::newRow("watchdog") << CrashReport::CrashWatchdog << QStringLiteral("Task watchdog");
+    QTest::newRow("unknown") << static_cast<CrashReport::CrashType>(42) << QStringLiteral("Unknown (42)");
+}
+
+void TestCrashReport::crashTypes()
+{
+    QFETCH(CrashReport::CrashType, type);
+    QFETCH(QString, name);
+
+    const CrashReport report = CrashReport::fromRecord(receiveRecord(crashOutput(makeRecord(type))));
+    QVERIFY(report.isValid());
+    QCOMPARE(report.type(), type);
+    QCOMPARE(report.typeName(), name);
+}
+
+void TestCrashReport::noRecord()
+{
+    const QByteArray data = receiveRecord("GD CRASH,NONE\r\n");
+    QVERIFY(data.isEmpty());
+    QVERIFY(!CrashReport::fromRecord(data).isValid());
+}
+
+void TestCrashReport::tornRecord()
+{
+    // The output stops partway through the record
+    QByteArray output = crashOutput(makeRecord(CrashReport::CrashWatchdog));
+    const int cut = output.indexOf("\r\n", output.size() / 2) + 2;
+    output = output.left(cut) + "]]\r\n";
+
+    const QByteArray data = receiveRecord(output);
+    QVERIFY(!data.isEmpty());
+    QVERIFY(data.size() < 372);
+    QVERIFY(!CrashReport::fromRecord(data).isValid());
+
+    // A record captured over an older one, that was cut short by a reset
+    QByteArray record = makeRecord(CrashReport::CrashHardFault);
+    const QByteArray older = makeRecord(CrashReport::CrashWatchdog);
+    record.replace(200, older.size() - 200, older.mid(200));
+    QVERIFY(!CrashReport::fromRecord(receiveRecord(crashOutput(record))).isValid());
+}
+
+void TestCrashReport::badChecksum()
+{
+    QByteArray record = makeRecord(CrashReport::CrashWatchdog);
+    record[100] = static_cast<char>(record.at(100) ^ 0x01);
+    QVERIFY(!CrashReport::fromRecord(receiveRecord(crashOutput(record))).isValid());
+
+    record = makeRecord(CrashReport::CrashWatchdog);
+    record[8] = static_cast<char>(record.at(8) ^ 0x80);
+    QVERIFY(!CrashReport::fromRecord(receiveRecord(crashOutput(record))).isValid());
+
+    const CrashReport report;
+    QCOMPARE(report.toText(QString(), 0), QStringLiteral("Invalid crash record\n"));
+}
+
+void TestCrashReport::badHeader()
+{
+    // Checked separately from the checksum, which does not cover the header
+    QByteArray record = makeRecord(CrashReport::CrashWatchdog);
+    record[0] = 'D';
+    QVERIFY(!CrashReport::fromRecord(record).isValid());
+
+    record = makeRecord(CrashReport::CrashWatchdog);
+    qToLittleEndian<quint16>(2, reinterpret_cast<uchar *>(record.data()) + 4);
+    QVERIFY(!CrashReport::fromRecord(record).isValid());
+
+    record = makeRecord(CrashReport::CrashWatchdog);
+    qToLittleEndian<quint16>(368, reinterpret_cast<uchar *>(record.data()) + 6);
+    QVERIFY(!CrashReport::fromRecord(record).isValid());
+}
+
+QTEST_GUILESS_MAIN(TestCrashReport)
+
+#include "tst_crashreport.moc"
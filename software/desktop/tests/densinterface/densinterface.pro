@@ -0,0 +1,25 @@
+QT += testlib gui serialport network
+QT -= widgets
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_densinterface
+
+SRC_DIR = ../../src
+INCLUDEPATH += $$SRC_DIR
+
+SOURCES += \
+    tst_densinterface.cpp \
+    $$SRC_DIR/denscalvalues.cpp \
+    $$SRC_DIR/denscommand.cpp \
+    $$SRC_DIR/densinterface.cpp \
+    $$SRC_DIR/denstransport.cpp \
+    $$SRC_DIR/util.cpp
+
+HEADERS += \
+    $$SRC_DIR/denscalvalues.h \
+    $$SRC_DIR/denscommand.h \
+    $$SRC_DIR/densinterface.h \
+    $$SRC_DIR/denstransport.h \
+    $$SRC_DIR/util.h
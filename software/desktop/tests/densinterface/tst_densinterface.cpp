@@ -0,0 +1,321 @@
+#include <QtTest>
+#include <QLoggingCategory>
+
+#include "densinterface.h"
+#include "denstransport.h"
+#include "util.h"
+
+Q_DECLARE_METATYPE(DensCommand::CommandType)
+Q_DECLARE_METATYPE(DensCommand::CommandCategory)
+
+/*
+ * Tests for DensInterface, run against an in-process pipe in place of
+ * the device, so nothing here depends on a serial port or on timing.
+ */
+class TestDensInterface : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void connectRefused();
+    void commandRefused();
+    void commandRefusedWhileDisconnected();
+    void writeBufferFull();
+    void profileValuesStopAtRefusal();
+    void densityReadings();
+    void readingQuality();
+    void measurementFormatFallback();
+
+    void parseThroughput_data();
+    void parseThroughput();
+
+private:
+    bool connectDevice();
+    QList<QByteArray> readCommands();
+    static QByteArray densityLine(char prefix, float value);
+
+    DensInterface *densInterface_ = nullptr;
+    DensPipeTransport *host_ = nullptr;
+    DensPipeTransport *device_ = nullptr;
+};
+
+void TestDensInterface::initTestCase()
+{
+    // Every reading is logged at debug level, which would otherwise
+    // dominate both the output and the benchmark timings
+    QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false"));
+    qRegisterMetaType<DensInterface::DensityType>();
+    qRegisterMetaType<DensInterface::ReadingQuality>();
+    qRegisterMetaType<DensCommand::CommandType>();
+    qRegisterMetaType<DensCommand::CommandCategory>();
+}
+
+void TestDensInterface::init()
+{
+    const QPair<DensPipeTransport *, DensPipeTransport *> pair = DensPipeTransport::createPair(this);
+    host_ = pair.first;
+    device_ = pair.second;
+    QVERIFY(host_->open());
+    QVERIFY(device_->open());
+    densInterface_ = new DensInterface(this);
+}
+
+void TestDensInterface::cleanup()
+{
+    densInterface_->disconnectFromDevice();
+    delete densInterface_;
+    delete host_;
+    delete device_;
+    densInterface_ = nullptr;
+    host_ = nullptr;
+    device_ = nullptr;
+}
+
+bool TestDensInterface::connectDevice()
+{
+    if (!densInterface_->connectToDevice(host_)) { return false; }
+
+    if (!QTest::qWaitFor([this]() { return device_->canReadLine(); }, 1000)) { return false; }
+    if (device_->readLine() != "GS V\r\n") { return false; }
+    device_->write("GS V,\"Printalyzer Densitometer\",\"v0.0.0-test\",3,7\r\n");
+
+    return QTest::qWaitFor([this]() { return densInterface_->connected(); }, 1000);
+}
+
+QList<QByteArray> TestDensInterface::readCommands()
+{
+    QCoreApplication::processEvents();
+    QList<QByteArray> commands;
+    while (device_->canReadLine()) {
+        commands.append(device_->readLine().trimmed());
+    }
+    return commands;
+}
+
+QByteArray TestDensInterface::densityLine(char prefix, float value)
+{
+    // Extended format, as sent by the device in remote control mode
+    return QStringLiteral("%1+%2D,%3,%4,%5,%6,%7\r\n")
+            .arg(QLatin1Char(prefix))
+            .arg(value, 0, 'f', 2)
+            .arg(util::encode_f32(value))
+            .arg(util::encode_f32(0.0F))
+            .arg(util::encode_f32(value * 1000.0F))
+            .arg(util::encode_f32(value * 1001.0F))
+            .arg(util::encode_f32(0.01F)).toLatin1();
+}
+
+void TestDensInterface::connectRefused()
+{
+    QSignalSpy closedSpy(densInterface_, &DensInterface::connectionClosed);
+    QSignalSpy notSentSpy(densInterface_, &DensInterface::commandNotSent);
+
+    host_->setWriteBufferLimit(0);
+    QVERIFY(!densInterface_->connectToDevice(host_));
+    QVERIFY(!densInterface_->connected());
+    QCOMPARE(notSentSpy.count(), 1);
+    QCOMPARE(closedSpy.count(), 0);
+
+    // Nothing is left behind that would stop a later attempt
+    host_->setWriteBufferLimit(DensTransport::DefaultWriteBufferLimit);
+    QVERIFY(connectDevice());
+}
+
+void TestDensInterface::commandRefused()
+{
+    QVERIFY(connectDevice());
+    QSignalSpy notSentSpy(densInterface_, &DensInterface::commandNotSent);
+
+    host_->setWriteBufferLimit(1);
+    QVERIFY(!densInterface_->sendGetCalGain());
+    QCOMPARE(notSentSpy.count(), 1);
+    QCOMPARE(notSentSpy.at(0).at(0).value<DensCommand::CommandType>(), DensCommand::TypeGet);
+    QCOMPARE(notSentSpy.at(0).at(1).value<DensCommand::CommandCategory>(), DensCommand::CategoryCalibration);
+    QCOMPARE(notSentSpy.at(0).at(2).toString(), QStringLiteral("GAIN"));
+    QVERIFY(readCommands().isEmpty());
+
+    // Commands with arguments are reported the same way
+    QVERIFY(!densInterface_->sendSetMeasurementFormat(DensInterface::FormatExtended));
+    QCOMPARE(notSentSpy.count(), 2);
+
+    host_->setWriteBufferLimit(DensTransport::DefaultWriteBufferLimit);
+    QVERIFY(densInterface_->sendGetCalGain());
+    QCOMPARE(readCommands(), QList<QByteArray>() << "GC GAIN");
+    QCOMPARE(notSentSpy.count(), 2);
+}
+
+void TestDensInterface::commandRefusedWhileDisconnected()
+{
+    QSignalSpy notSentSpy(densInterface_, &DensInterface::commandNotSent);
+
+    QVERIFY(!densInterface_->sendGetSystemBuild());
+    QCOMPARE(notSentSpy.count(), 1);
+
+    // Invalid arguments are caught before anything reaches the transport
+    QVERIFY(connectDevice());
+    QVERIFY(!densInterface_->sendGetSystemMenuSetting(-1));
+    QCOMPARE(notSentSpy.count(), 1);
+}
+
+void TestDensInterface::writeBufferFull()
+{
+    QVERIFY(connectDevice());
+    QSignalSpy notSentSpy(densInterface_, &DensInterface::commandNotSent);
+
+    // Room for exactly one command, until the device has read it
+    host_->setWriteBufferLimit(qstrlen("GC GAIN\r\n"));
+    QVERIFY(densInterface_->sendGetCalGain());
+    QVERIFY(!densInterface_->sendGetCalGain());
+    QCOMPARE(notSentSpy.count(), 1);
+
+    QCOMPARE(readCommands(), QList<QByteArray>() << "GC GAIN");
+    QVERIFY(densInterface_->sendGetCalGain());
+    QCOMPARE(notSentSpy.count(), 1);
+}
+
+void TestDensInterface::profileValuesStopAtRefusal()
+{
+    QVERIFY(connectDevice());
+    QSignalSpy notSentSpy(densInterface_, &DensInterface::commandNotSent);
+
+    host_->setWriteBufferLimit(qstrlen("GC PROFG,0\r\n"));
+    QVERIFY(!densInterface_->sendGetCalProfileValues(0));
+    QCOMPARE(notSentSpy.count(), 1);
+    QCOMPARE(notSentSpy.at(0).at(2).toString(), QStringLiteral("PROFS"));
+
+    // Nothing after the refused part is sent, even once there is room
+    QCOMPARE(readCommands(), QList<QByteArray>() << "GC PROFG,0");
+    QVERIFY(readCommands().isEmpty());
+}
+
+void TestDensInterface::densityReadings()
+{
+    QVERIFY(connectDevice());
+    QSignalSpy readingSpy(densInterface_, &DensInterface::densityReading);
+
+    device_->write("R+0.20D\r\n");
+    device_->write(densityLine('T', 1.25F));
+    QTRY_COMPARE(readingSpy.count(), 2);
+
+    QCOMPARE(readingSpy.at(0).at(0).value<DensInterface::DensityType>(), DensInterface::DensityReflection);
+    QCOMPARE(readingSpy.at(0).at(1).toFloat(), 0.20F);
+    QVERIFY(qIsNaN(readingSpy.at(0).at(3).toFloat()));
+
+    QCOMPARE(readingSpy.at(1).at(0).value<DensInterface::DensityType>(), DensInterface::DensityTransmission);
+    QCOMPARE(readingSpy.at(1).at(1).toFloat(), 1.25F);
+    QCOMPARE(readingSpy.at(1).at(2).toFloat(), 0.0F);
+    QCOMPARE(readingSpy.at(1).at(3).toFloat(), 1250.0F);
+    QCOMPARE(readingSpy.at(1).at(4).toFloat(), 1251.25F);
+    QCOMPARE(readingSpy.at(1).at(5).toFloat(), 0.01F);
+    QCOMPARE(int(readingSpy.at(1).at(6).value<DensInterface::ReadingQuality>()), 0);
+}
+
+void TestDensInterface::readingQuality()
+{
+    QVERIFY(connectDevice());
+    QSignalSpy readingSpy(densInterface_, &DensInterface::densityReading);
+
+    // Quality flags follow the uncertainty, in the extended quality format
+    QByteArray line = densityLine('R', 0.50F);
+    line.insert(line.size() - 2, ",00");
+    device_->write(line);
+    line = densityLine('T', 2.10F);
+    line.insert(line.size() - 2, ",09");
+    device_->write(line);
+    QTRY_COMPARE(readingSpy.count(), 2);
+
+    QCOMPARE(readingSpy.at(0).at(1).toFloat(), 0.50F);
+    QCOMPARE(readingSpy.at(0).at(5).toFloat(), 0.01F);
+    QCOMPARE(int(readingSpy.at(0).at(6).value<DensInterface::ReadingQuality>()), 0);
+
+    const DensInterface::ReadingQuality quality = readingSpy.at(1).at(6).value<DensInterface::ReadingQuality>();
+    QCOMPARE(readingSpy.at(1).at(1).toFloat(), 2.10F);
+    QVERIFY(quality == (DensInterface::QualityMotion | DensInterface::QualityLidOpen));
+    QCOMPARE(DensInterface::readingQualityText(quality).size(), 2);
+    QVERIFY(DensInterface::readingQualityText(DensInterface::ReadingQuality()).isEmpty());
+}
+
+void TestDensInterface::measurementFormatFallback()
+{
+    QVERIFY(connectDevice());
+    QSignalSpy changedSpy(densInterface_, &DensInterface::measurementFormatChanged);
+    QSignalSpy rejectedSpy(densInterface_, &DensInterface::commandRejected);
+
+    QVERIFY(densInterface_->sendSetMeasurementFormat(DensInterface::FormatExtendedQuality));
+    QCOMPARE(readCommands(), QList<QByteArray>() << "SM FORMAT,EXT,U,Q");
+
+    // Older firmware refuses the formats it does not know, one field at a time
+    device_->write("SM FORMAT,NAK\r\n");
+    QTRY_VERIFY(device_->canReadLine());
+    QCOMPARE(readCommands(), QList<QByteArray>() << "SM FORMAT,EXT,U");
+    device_->write("SM FORMAT,NAK\r\n");
+    QTRY_VERIFY(device_->canReadLine());
+    QCOMPARE(readCommands(), QList<QByteArray>() << "SM FORMAT,EXT");
+    device_->write("SM FORMAT,OK\r\n");
+    QTRY_COMPARE(changedSpy.count(), 1);
+    QCOMPARE(rejectedSpy.count(), 0);
+}
+
+void TestDensInterface::parseThroughput_data()
+{
+    QTest::addColumn<int>("readings");
+    QTest::addColumn<int>("responses");
+
+    QTest::newRow("readings") << 500 << 0;
+    QTest::newRow("responses") << 0 << 200;
+    QTest::newRow("mixed") << 400 << 100;
+}
+
+void TestDensInterface::parseThroughput()
+{
+    QFETCH(int, readings);
+    QFETCH(int, responses);
+
+    QVERIFY(connectDevice());
+
+    // Calibration gain responses have the most fields of anything that is
+    // polled, so they stand in for the heaviest command responses
+    QStringList gainArgs;
+    for (int i = 0; i < 8; i++) {
+        gainArgs.append(util::encode_f32(1.0F + (i * 100.0F)));
+    }
+    const QByteArray gainLine = "GC GAIN," + gainArgs.join(QLatin1Char(',')).toLatin1() + "\r\n";
+
+    QByteArray batch;
+    const int total = readings + responses;
+    for (int i = 0; i < total; i++) {
+        if (i < readings) {
+            batch.append(densityLine((i % 2) ? 'T' : 'R', (i % 400) / 100.0F));
+        }
+        if (i < responses) {
+            batch.append(gainLine);
+        }
+    }
+    QVERIFY(batch.size() <= DensTransport::DefaultWriteBufferLimit);
+
+    int readingCount = 0;
+    int responseCount = 0;
+    connect(densInterface_, &DensInterface::densityReading, this, [&readingCount]() { readingCount++; });
+    connect(densInterface_, &DensInterface::calGainResponse, this, [&responseCount]() { responseCount++; });
+
+    QBENCHMARK {
+        readingCount = 0;
+        responseCount = 0;
+        QVERIFY(device_->write(batch));
+        while (readingCount < readings || responseCount < responses) {
+            QCoreApplication::processEvents();
+        }
+    }
+
+    QCOMPARE(readingCount, readings);
+    QCOMPARE(responseCount, responses);
+    QCOMPARE(densInterface_->calGain().max1(), 701.0F);
+}
+
+QTEST_GUILESS_MAIN(TestDensInterface)
+
+#include "tst_densinterface.moc"
@@ -0,0 +1,17 @@
+QT += testlib
+QT -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_firmwareimage
+
+SRC_DIR = ../../src
+INCLUDEPATH += $$SRC_DIR
+
+SOURCES += \
+    tst_firmwareimage.cpp \
+    $$SRC_DIR/firmwareimage.cpp
+
+HEADERS += \
+    $$SRC_DIR/firmwareimage.h
@@ -0,0 +1,454 @@
+#include <QtTest>
+#include <QtEndian>
+#include <QTemporaryDir>
+
+#include "firmwareimage.h"
+
+Q_DECLARE_METATYPE(FirmwareImage::Format)
+
+namespace
+{
+const uint32_t APP_FLASH_START = 0x08008000UL;
+const int APP_FLASH_SIZE = 0x28000;
+const int DESCRIPTOR_OFFSET = 0x27F00;
+
+QString hex32(uint32_t value)
+{
+    return QStringLiteral("%1").arg(value, 8, 16, QLatin1Char('0')).toUpper();
+}
+}
+
+/*
+ * Tests for the firmware image reader, run against application images
+ * synthesized here in the same layout as the linker script and
+ * tools/checksum.pl produce, then wrapped as ELF and UF2 files.
+ */
+class TestFirmwareImage : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void stmCrc32();
+
+    void readImage_data();
+    void readImage();
+    void loadFile_data();
+    void loadFile();
+    void text();
+
+    void badChecksum();
+    void noDescriptor();
+    void wrongAddress();
+
+    void compatible_data();
+    void compatible();
+
+    void diff();
+
+    void invalidUf2();
+    void invalidElf();
+
+private:
+    static QByteArray makeBinary(uint32_t protocolVersion, uint32_t settingsVersion,
+                                 const QByteArray &version = QByteArrayLiteral("v0.7.0"));
+    static void updateChecksum(QByteArray *binary);
+    static QByteArray toElf(const QByteArray &binary);
+    static QByteArray toUf2(const QByteArray &binary, uint32_t baseAddress = APP_FLASH_START);
+    static QByteArray encode(const QByteArray &binary, FirmwareImage::Format format);
+    static void putU32(QByteArray *data, int offset, uint32_t value);
+    static void putU16(QByteArray *data, int offset, uint16_t value);
+
+    QTemporaryDir tempDir_;
+};
+
+void TestFirmwareImage::initTestCase()
+{
+    QVERIFY(tempDir_.isValid());
+}
+
+void TestFirmwareImage::putU32(QByteArray *data, int offset, uint32_t value)
+{
+    qToLittleEndian<quint32>(value, reinterpret_cast<uchar *>(data->data() + offset));
+}
+
+void TestFirmwareImage::putU16(QByteArray *data, int offset, uint16_t value)
+{
+    qToLittleEndian<quint16>(value, reinterpret_cast<uchar *>(data->data() + offset));
+}
+
+QByteArray TestFirmwareImage::makeBinary(uint32_t protocolVersion, uint32_t settingsVersion, const QByteArray &version)
+{
+    QByteArray binary(APP_FLASH_SIZE, static_cast<char>(0xFF));
+
+    // Stack pointer and reset vector, then some program code
+    putU32(&binary, 0, 0x20005000UL);
+    putU32(&binary, 4, 0x08008101UL);
+    for (int i = 0xC0; i < 0x4000; i++) {
+        binary[i] = static_cast<char>((i * 31) & 0xFF);
+    }
+
+    // App descriptor at the end of application flash
+    QByteArray desc(256, '\0');
+    putU32(&desc, 0, 0xABCD7654UL);
+    putU32(&desc, 4, protocolVersion);
+    putU32(&desc, 8, settingsVersion);
+    desc.replace(16, 24, QByteArrayLiteral("Printalyzer-Densitometer"));
+    desc.replace(48, version.size(), version);
+    desc.replace(80, 16, QByteArrayLiteral("2022-11-05 14:32"));
+    desc.replace(100, 17, QByteArrayLiteral("v0.7.0-0-g1a2b3c4"));
+    binary.replace(DESCRIPTOR_OFFSET, desc.size(), desc);
+
+    updateChecksum(&binary);
+    return binary;
+}
+
+void TestFirmwareImage::updateChecksum(QByteArray *binary)
+{
+    // Everything up to the checksum itself, as tools/checksum.pl does
+    const int crcOffset = DESCRIPTOR_OFFSET + 252;
+    putU32(binary, crcOffset, FirmwareImage::stmCrc32(0xFFFFFFFFUL, binary->left(crcOffset)));
+}
+
+QByteArray TestFirmwareImage::toElf(const QByteArray &binary)
+{
+    // Program code in flash, initialized data stored in flash but linked
+    // in RAM, and a zero-initialized segment with nothing in the file
+    struct Segment { uint32_t vaddr; uint32_t paddr; int start; int size; };
+    const Segment segments[] = {
+        { APP_FLASH_START, APP_FLASH_START, 0, 0x20000 },
+        { 0x20000000UL, APP_FLASH_START + 0x20000UL, 0x20000, binary.size() - 0x20000 },
+        { 0x20008000UL, 0x20008000UL, 0, 0 }
+    };
+    const int headerSize = 52;
+    const int phentsize = 32;
+    const int dataOffset = 0x100;
+
+    QByteArray elf(dataOffset, '\0');
+    elf.replace(0, 7, QByteArray("\x7F" "ELF\x01\x01\x01", 7));
+    putU16(&elf, 16, 2);
+    putU16(&elf, 18, 40);
+    putU32(&elf, 28, headerSize);
+    putU16(&elf, 40, headerSize);
+    putU16(&elf, 42, phentsize);
+    putU16(&elf, 44, 3);
+
+    for (int i = 0; i < 3; i++) {
+        const int ph = headerSize + (i * phentsize);
+        putU32(&elf, ph, 1);
+        putU32(&elf, ph + 4, static_cast<uint32_t>(dataOffset + segments[i].start));
+        putU32(&elf, ph + 8, segments[i].vaddr);
+        putU32(&elf, ph + 12, segments[i].paddr);
+        putU32(&elf, ph + 16, static_cast<uint32_t>(segments[i].size));
+        putU32(&elf, ph + 20, static_cast<uint32_t>(segments[i].size ? segments[i].size : 0x400));
+    }
+    elf.append(binary);
+    return elf;
+}
+
+QByteArray TestFirmwareImage::toUf2(const QByteArray &binary, uint32_t baseAddress)
+{
+    const int payloadSize = 256;
+    const int blockCount = binary.size() / payloadSize;
+
+    QByteArray uf2;
+    for (int i = 0; i <= blockCount; i++) {
+        QByteArray block(512, '\0');
+        putU32(&block, 0, 0x0A324655UL);
+        putU32(&block, 4, 0x9E5D5157UL);
+        putU32(&block, 24, static_cast<uint32_t>(blockCount + 1));
+        putU32(&block, 28, 0x202E3A91UL);
+        putU32(&block, 508, 0x0AB16F30UL);
+
+        if (i < blockCount) {
+            putU32(&block, 8, 0x00002000UL);
+            putU32(&block, 12, baseAddress + static_cast<uint32_t>(i * payloadSize));
+            putU32(&block, 16, payloadSize);
+            putU32(&block, 20, static_cast<uint32_t>(i));
+            block.replace(32, payloadSize, binary.mid(i * payloadSize, payloadSize));
+        } else {
+            // Not for main flash, and far outside it, so it must be skipped
+            putU32(&block, 8, 0x00002001UL);
+            putU32(&block, 12, 0x00000000UL);
+            putU32(&block, 16, payloadSize);
+            putU32(&block, 20, static_cast<uint32_t>(i));
+        }
+        uf2.append(block);
+    }
+    return uf2;
+}
+
+QByteArray TestFirmwareImage::encode(const QByteArray &binary, FirmwareImage::Format format)
+{
+    switch (format) {
+    case FirmwareImage::FormatElf:
+        return toElf(binary);
+    case FirmwareImage::FormatUf2:
+        return toUf2(binary);
+    default:
+        return binary;
+    }
+}
+
+void TestFirmwareImage::stmCrc32()
+{
+    // Reference values from the algorithm in tools/checksum.pl, the
+    // first being the well known result of the STM32 CRC unit
+    QByteArray word(4, '\0');
+    putU32(&word, 0, 0x12345678UL);
+    QCOMPARE(FirmwareImage::stmCrc32(0xFFFFFFFFUL, word), 0xDF8A8A2BU);
+    QCOMPARE(FirmwareImage::stmCrc32(0xFFFFFFFFUL, QByteArray("\x01\x02\x03\x04\x05\x06\x07\x08", 8)), 0xA3141BDAU);
+
+    // Only whole words are included
+    QCOMPARE(FirmwareImage::stmCrc32(0xFFFFFFFFUL, word + QByteArray("\x01\x02", 2)), 0xDF8A8A2BU);
+    QCOMPARE(FirmwareImage::stmCrc32(0xFFFFFFFFUL, QByteArray()), 0xFFFFFFFFU);
+}
+
+void TestFirmwareImage::readImage_data()
+{
+    QTest::addColumn<FirmwareImage::Format>("format");
+
+    QTest::newRow("binary") << FirmwareImage::FormatBinary;
+    QTest::newRow("elf") << FirmwareImage::FormatElf;
+    QTest::newRow("uf2") << FirmwareImage::FormatUf2;
+}
+
+void TestFirmwareImage::readImage()
+{
+    QFETCH(FirmwareImage::Format, format);
+
+    const QByteArray binary = makeBinary(3, 7);
+    QString errorString;
+    const FirmwareImage image = FirmwareImage::fromData(encode(binary, format), format, &errorString);
+    QVERIFY2(image.isValid(), qPrintable(errorString));
+
+    // Every format flattens to the same contents of application flash
+    QCOMPARE(image.format(), format);
+    QCOMPARE(image.baseAddress(), APP_FLASH_START);
+    QCOMPARE(image.data(), binary);
+
+    QVERIFY(image.hasDescriptor());
+    QCOMPARE(image.descriptorAddress(), 0x0802FF00U);
+    QCOMPARE(image.projectName(), QStringLiteral("Printalyzer-Densitometer"));
+    QCOMPARE(image.version(), QStringLiteral("v0.7.0"));
+    QCOMPARE(image.buildDate(), QStringLiteral("2022-11-05 14:32"));
+    QCOMPARE(image.buildDescribe(), QStringLiteral("v0.7.0-0-g1a2b3c4"));
+    QCOMPARE(image.protocolVersion(), 3U);
+    QCOMPARE(image.settingsVersion(), 7U);
+
+    // Checksums are reported in the same byte order as the device uses
+    QVERIFY(image.isChecksumValid());
+    QCOMPARE(image.checksum(), image.calculatedChecksum());
+    QCOMPARE(image.checksum(), qbswap(FirmwareImage::stmCrc32(0xFFFFFFFFUL, binary.left(DESCRIPTOR_OFFSET + 252))));
+}
+
+void TestFirmwareImage::loadFile_data()
+{
+    QTest::addColumn<QString>("suffix");
+    QTest::addColumn<FirmwareImage::Format>("format");
+    QTest::addColumn<FirmwareImage::Format>("expected");
+
+    QTest::newRow("bin") << QStringLiteral("bin") << FirmwareImage::FormatBinary << FirmwareImage::FormatBinary;
+    QTest::newRow("elf") << QStringLiteral("elf") << FirmwareImage::FormatElf << FirmwareImage::FormatElf;
+    QTest::newRow("uf2") << QStringLiteral("uf2") << FirmwareImage::FormatUf2 << FirmwareImage::FormatUf2;
+
+    // ELF and UF2 files are recognized by their contents, not their names
+    QTest::newRow("elf without suffix") << QStringLiteral("out") << FirmwareImage::FormatElf << FirmwareImage::FormatElf;
+    QTest::newRow("uf2 named bin") << QStringLiteral("bin") << FirmwareImage::FormatUf2 << FirmwareImage::FormatUf2;
+    QTest::newRow("binary without suffix") << QStringLiteral("dat") << FirmwareImage::FormatBinary << FirmwareImage::FormatUnknown;
+}
+
+void TestFirmwareImage::loadFile()
+{
+    QFETCH(QString, suffix);
+    QFETCH(FirmwareImage::Format, format);
+    QFETCH(FirmwareImage::Format, expected);
+
+    const QString fileName = tempDir_.filePath(QStringLiteral("image.") + suffix);
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(encode(makeBinary(3, 7), format));
+    file.close();
+
+    QString errorString;
+    const FirmwareImage image = FirmwareImage::load(fileName, &errorString);
+    QCOMPARE(image.format(), expected);
+    if (expected == FirmwareImage::FormatUnknown) {
+        QCOMPARE(errorString, QStringLiteral("Unrecognized image format"));
+    } else {
+        QVERIFY(image.isChecksumValid());
+    }
+}
+
+void TestFirmwareImage::text()
+{
+    const FirmwareImage image = FirmwareImage::fromData(makeBinary(3, 7), FirmwareImage::FormatBinary);
+    const QStringList lines = image.toText().split(QLatin1Char('\n'));
+    QCOMPARE(lines.size(), 10);
+    QCOMPARE(lines.at(0), QStringLiteral("Format: Binary"));
+    QCOMPARE(lines.at(1), QStringLiteral("Address range: 08008000-0802FFFF"));
+    QCOMPARE(lines.at(2), QStringLiteral("App descriptor: 0802FF00"));
+    QCOMPARE(lines.at(7), QStringLiteral("Protocol version: 3"));
+    QCOMPARE(lines.at(8), QStringLiteral("Settings schema: 7"));
+    QCOMPARE(lines.at(9), QStringLiteral("Checksum: %1 (valid)").arg(hex32(image.checksum())));
+
+    const FirmwareImage unversioned = FirmwareImage::fromData(makeBinary(0, 0), FirmwareImage::FormatBinary);
+    QVERIFY(unversioned.toText().contains(QStringLiteral("Protocol version: Unversioned\nSettings schema: Unversioned")));
+}
+
+void TestFirmwareImage::badChecksum()
+{
+    QByteArray binary = makeBinary(3, 7);
+    binary[0x1000] = static_cast<char>(binary.at(0x1000) ^ 0x01);
+
+    const FirmwareImage image = FirmwareImage::fromData(binary, FirmwareImage::FormatBinary);
+    QVERIFY(image.hasDescriptor());
+    QVERIFY(!image.isChecksumValid());
+    QVERIFY(image.toText().contains(QStringLiteral("invalid, expected %1").arg(hex32(image.calculatedChecksum()))));
+
+    QString reason;
+    QVERIFY(!image.isCompatible(7, &reason));
+    QCOMPARE(reason, QStringLiteral("Image checksum is not valid"));
+}
+
+void TestFirmwareImage::noDescriptor()
+{
+    QByteArray binary = makeBinary(3, 7);
+    binary.replace(DESCRIPTOR_OFFSET, 4, QByteArray(4, '\0'));
+
+    const FirmwareImage image = FirmwareImage::fromData(binary, FirmwareImage::FormatBinary);
+    QVERIFY(image.isValid());
+    QVERIFY(!image.hasDescriptor());
+    QVERIFY(!image.isChecksumValid());
+    QVERIFY(image.toText().endsWith(QStringLiteral("App descriptor: Not found")));
+
+    QString reason;
+    QVERIFY(!image.isCompatible(7, &reason));
+    QCOMPARE(reason, QStringLiteral("Image has no app descriptor"));
+}
+
+void TestFirmwareImage::wrongAddress()
+{
+    // A consistent image, but linked where the bootloader itself lives
+    const FirmwareImage image = FirmwareImage::fromData(toUf2(makeBinary(3, 7), 0x08000000UL), FirmwareImage::FormatUf2);
+    QVERIFY(image.isChecksumValid());
+    QCOMPARE(image.descriptorAddress(), 0x08027F00U);
+
+    QString reason;
+    QVERIFY(!image.isCompatible(7, &reason));
+    QCOMPARE(reason, QStringLiteral("Image is not laid out for application flash"));
+}
+
+void TestFirmwareImage::compatible_data()
+{
+    QTest::addColumn<uint>("protocolVersion");
+    QTest::addColumn<uint>("imageSettings");
+    QTest::addColumn<uint>("deviceSettings");
+    QTest::addColumn<QString>("reason");
+
+    QTest::newRow("same schema") << 3U << 7U << 7U << QString();
+    QTest::newRow("newer schema") << 3U << 8U << 7U << QString();
+    QTest::newRow("older schema") << 3U << 6U << 7U
+                                  << QStringLiteral("Image settings schema 6 is older than the device schema 7");
+    QTest::newRow("unversioned device") << 3U << 7U << 0U << QString();
+    QTest::newRow("unversioned image on legacy device") << 0U << 0U << 1U << QString();
+    QTest::newRow("unversioned image") << 0U << 0U << 2U
+                                       << QStringLiteral("Image settings schema 1 is older than the device schema 2");
+    QTest::newRow("protocol not checked") << 0xFFFFFFFFU << 7U << 7U << QString();
+}
+
+void TestFirmwareImage::compatible()
+{
+    QFETCH(uint, protocolVersion);
+    QFETCH(uint, imageSettings);
+    QFETCH(uint, deviceSettings);
+    QFETCH(QString, reason);
+
+    // The same rule as the bootloader applies, in all three formats
+    const QByteArray binary = makeBinary(protocolVersion, imageSettings);
+    for (FirmwareImage::Format format : { FirmwareImage::FormatBinary, FirmwareImage::FormatElf, FirmwareImage::FormatUf2 }) {
+        const FirmwareImage image = FirmwareImage::fromData(encode(binary, format), format);
+        QString actualReason;
+        QCOMPARE(image.isCompatible(deviceSettings, &actualReason), reason.isEmpty());
+        QCOMPARE(actualReason, reason);
+    }
+}
+
+void TestFirmwareImage::diff()
+{
+    QByteArray changed = makeBinary(3, 7, QByteArrayLiteral("v0.7.1"));
+    changed[0x1000] = static_cast<char>(changed.at(0x1000) ^ 0xFF);
+    updateChecksum(&changed);
+
+    const FirmwareImage a = FirmwareImage::fromData(makeBinary(3, 7), FirmwareImage::FormatBinary);
+    const FirmwareImage b = FirmwareImage::fromData(toUf2(changed), FirmwareImage::FormatUf2);
+    QVERIFY(b.isChecksumValid());
+
+    // The descriptor ends at the end of flash, so there is no trailing data
+    const QList<FirmwareImage::DiffRegion> regions = FirmwareImage::diff(a, b);
+    QCOMPARE(regions.size(), 3);
+
+    QCOMPARE(regions.at(0).name, QStringLiteral("Vector table"));
+    QCOMPARE(regions.at(0).start, APP_FLASH_START);
+    QCOMPARE(regions.at(0).end, APP_FLASH_START + 0xC0U);
+    QCOMPARE(regions.at(0).changedBytes, 0U);
+
+    QCOMPARE(regions.at(1).name, QStringLiteral("Program"));
+    QCOMPARE(regions.at(1).end, 0x0802FF00U);
+    QCOMPARE(regions.at(1).changedBytes, 1U);
+    QCOMPARE(regions.at(1).firstChange, APP_FLASH_START + 0x1000U);
+
+    // Only the version and checksum differ within the descriptor
+    QCOMPARE(regions.at(2).name, QStringLiteral("App descriptor"));
+    QCOMPARE(regions.at(2).start, 0x0802FF00U);
+    QCOMPARE(regions.at(2).end, 0x08030000U);
+    QVERIFY(regions.at(2).changedBytes >= 2 && regions.at(2).changedBytes <= 5);
+    QCOMPARE(regions.at(2).firstChange, 0x0802FF00U + 48U + 5U);
+
+    // Identical images have nothing that differs
+    for (const FirmwareImage::DiffRegion &region : FirmwareImage::diff(a, a)) {
+        QCOMPARE(region.changedBytes, 0U);
+    }
+}
+
+void TestFirmwareImage::invalidUf2()
+{
+    QByteArray uf2 = toUf2(makeBinary(3, 7));
+    QString errorString;
+
+    QVERIFY(!FirmwareImage::fromData(uf2.left(uf2.size() - 1), FirmwareImage::FormatUf2, &errorString).isValid());
+    QCOMPARE(errorString, QStringLiteral("UF2 file is not a whole number of blocks"));
+
+    QByteArray badMagic = uf2;
+    putU32(&badMagic, 512 + 508, 0);
+    QVERIFY(!FirmwareImage::fromData(badMagic, FirmwareImage::FormatUf2, &errorString).isValid());
+    QCOMPARE(errorString, QStringLiteral("Invalid UF2 block at offset 512"));
+
+    QByteArray badSize = uf2;
+    putU32(&badSize, 1024 + 16, 477);
+    QVERIFY(!FirmwareImage::fromData(badSize, FirmwareImage::FormatUf2, &errorString).isValid());
+    QCOMPARE(errorString, QStringLiteral("Invalid UF2 payload size at offset 1024"));
+}
+
+void TestFirmwareImage::invalidElf()
+{
+    const QByteArray elf = toElf(makeBinary(3, 7));
+    QString errorString;
+
+    // 64-bit, as from a host toolchain
+    QByteArray elf64 = elf;
+    elf64[4] = 2;
+    QVERIFY(!FirmwareImage::fromData(elf64, FirmwareImage::FormatElf, &errorString).isValid());
+    QCOMPARE(errorString, QStringLiteral("Unsupported ELF class or byte order"));
+
+    QVERIFY(!FirmwareImage::fromData(elf.left(elf.size() - 16), FirmwareImage::FormatElf, &errorString).isValid());
+    QCOMPARE(errorString, QStringLiteral("Truncated ELF segment"));
+
+    QVERIFY(!FirmwareImage::fromData(elf.left(70), FirmwareImage::FormatElf, &errorString).isValid());
+    QCOMPARE(errorString, QStringLiteral("Truncated ELF program header"));
+}
+
+QTEST_GUILESS_MAIN(TestFirmwareImage)
+
+#include "tst_firmwareimage.moc"
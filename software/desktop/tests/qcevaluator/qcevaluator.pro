@@ -0,0 +1,22 @@
+QT += testlib
+QT -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_qcevaluator
+
+SRC_DIR = ../../src
+INCLUDEPATH += $$SRC_DIR
+
+SOURCES += \
+    tst_qcevaluator.cpp \
+    $$SRC_DIR/cgats.cpp \
+    $$SRC_DIR/qcevaluator.cpp
+
+HEADERS += \
+    $$SRC_DIR/cgats.h \
+    $$SRC_DIR/qcevaluator.h
+
+OTHER_FILES += \
+    data/qc-spec.cgats
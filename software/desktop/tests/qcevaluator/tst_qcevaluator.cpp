@@ -0,0 +1,371 @@
+#include <QtTest>
+#include <cmath>
+
+#include "cgats.h"
+#include "qcevaluator.h"
+
+Q_DECLARE_METATYPE(QcResult::Status)
+
+/*
+ * Tests for QC evaluation: loading a specification, matching readings
+ * to patches, and classifying them against the tolerance limits.
+ */
+class TestQcEvaluator : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void classify_data();
+    void classify();
+
+    void loadSpec();
+    void loadSpecWithoutTargets();
+    void specDensityField();
+    void specMissingTolerance();
+    void specSkipsRowsWithoutTarget();
+
+    void matchSequence();
+    void matchSelected();
+    void modeMismatch();
+    void noSpec();
+    void reset();
+
+    void stats();
+    void statsTooFewReadings();
+    void reportTables();
+
+private:
+    static QcPatch makePatch(float target, float tolMinus, float tolPlus, float warnMinus, float warnPlus,
+                             const QString &mode = QString());
+    static CgatsTable makeTable(const QStringList &fields, const QList<QStringList> &rows);
+};
+
+QcPatch TestQcEvaluator::makePatch(float target, float tolMinus, float tolPlus, float warnMinus, float warnPlus,
+                                   const QString &mode)
+{
+    QcPatch patch;
+    patch.name = QStringLiteral("P");
+    patch.mode = mode;
+    patch.target = target;
+    patch.tolMinus = tolMinus;
+    patch.tolPlus = tolPlus;
+    patch.warnMinus = warnMinus;
+    patch.warnPlus = warnPlus;
+    return patch;
+}
+
+CgatsTable TestQcEvaluator::makeTable(const QStringList &fields, const QList<QStringList> &rows)
+{
+    CgatsTable table(QStringLiteral("CGATS.17"));
+    table.setFields(fields);
+    for (const QStringList &row : rows) {
+        table.appendRow(row);
+    }
+    return table;
+}
+
+void TestQcEvaluator::classify_data()
+{
+    QTest::addColumn<float>("density");
+    QTest::addColumn<QcResult::Status>("status");
+
+    // Limits that are exact in binary, so each boundary is tested exactly:
+    // tolerance -0.25/+0.5, warning -0.125/+0.25, around a target of 1.0
+    QTest::newRow("on target") << 1.0F << QcResult::Pass;
+    QTest::newRow("at upper warning") << 1.25F << QcResult::Pass;
+    QTest::newRow("above upper warning") << std::nextafter(1.25F, 2.0F) << QcResult::Warn;
+    QTest::newRow("at upper tolerance") << 1.5F << QcResult::Warn;
+    QTest::newRow("above upper tolerance") << std::nextafter(1.5F, 2.0F) << QcResult::Fail;
+    QTest::newRow("at lower warning") << 0.875F << QcResult::Pass;
+    QTest::newRow("below lower warning") << std::nextafter(0.875F, 0.0F) << QcResult::Warn;
+    QTest::newRow("at lower tolerance") << 0.75F << QcResult::Warn;
+    QTest::newRow("below lower tolerance") << std::nextafter(0.75F, 0.0F) << QcResult::Fail;
+    QTest::newRow("far off") << 3.0F << QcResult::Fail;
+    QTest::newRow("no reading") << qQNaN() << QcResult::Fail;
+}
+
+void TestQcEvaluator::classify()
+{
+    QFETCH(float, density);
+    QFETCH(QcResult::Status, status);
+
+    const QcPatch patch = makePatch(1.0F, 0.25F, 0.5F, 0.125F, 0.25F);
+    QCOMPARE(QcEvaluator::classify(patch, density), status);
+
+    // Without a separate warning band, anything within tolerance passes
+    const QcPatch noWarn = makePatch(1.0F, 0.25F, 0.5F, 0.25F, 0.5F);
+    QCOMPARE(QcEvaluator::classify(noWarn, density), status == QcResult::Fail ? QcResult::Fail : QcResult::Pass);
+}
+
+void TestQcEvaluator::loadSpec()
+{
+    // The first data set has no densities, so the second one is used
+    QString errorString;
+    const QList<QcPatch> patches = QcEvaluator::loadSpec(QFINDTESTDATA("data/qc-spec.cgats"), &errorString);
+    QVERIFY2(errorString.isEmpty(), qPrintable(errorString));
+    QCOMPARE(patches.size(), 4);
+
+    // Limits from the D_TOL and D_WARN keywords
+    QCOMPARE(patches[0].name, QStringLiteral("Base + fog"));
+    QCOMPARE(patches[0].mode, QStringLiteral("T"));
+    QCOMPARE(patches[0].target, 0.25F);
+    QCOMPARE(patches[0].tolMinus, 0.10F);
+    QCOMPARE(patches[0].tolPlus, 0.10F);
+    QCOMPARE(patches[0].warnMinus, 0.05F);
+    QCOMPARE(patches[0].warnPlus, 0.05F);
+
+    // Warning limits are never wider than the tolerance
+    QCOMPARE(patches[1].mode, QStringLiteral("R"));
+    QCOMPARE(patches[1].tolMinus, 0.04F);
+    QCOMPARE(patches[1].tolPlus, 0.08F);
+    QCOMPARE(patches[1].warnMinus, 0.04F);
+    QCOMPARE(patches[1].warnPlus, 0.05F);
+
+    QVERIFY(patches[2].mode.isEmpty());
+    QCOMPARE(patches[2].warnMinus, 0.10F);
+    QCOMPARE(patches[2].warnPlus, 0.10F);
+
+    QCOMPARE(patches[3].lowerLimit(), 2.70F);
+    QCOMPARE(patches[3].upperLimit(), 3.15F);
+    QCOMPARE(patches[3].warnMinus, 0.02F);
+}
+
+void TestQcEvaluator::loadSpecWithoutTargets()
+{
+    const CgatsTable table = makeTable(QStringList() << "SAMPLE_ID" << "SAMPLE_NAME",
+                                       QList<QStringList>() << (QStringList() << "1" << "A"));
+    QString errorString;
+    QVERIFY(QcEvaluator::specFromTable(table, &errorString).isEmpty());
+    QCOMPARE(errorString, QStringLiteral("File does not contain any target densities"));
+
+    errorString.clear();
+    QVERIFY(QcEvaluator::loadSpec(QStringLiteral("does-not-exist.cgats"), &errorString).isEmpty());
+    QVERIFY(!errorString.isEmpty());
+}
+
+void TestQcEvaluator::specDensityField()
+{
+    // Measurements of a reference strip work as a specification,
+    // with the measured densities as targets
+    const CgatsTable table = makeTable(QStringList() << "SAMPLE_ID" << "D_VIS" << "D_TOL",
+                                       QList<QStringList>()
+                                       << (QStringList() << "1" << "0.50" << "0.05")
+                                       << (QStringList() << "2" << "1.00" << "0.10"));
+    QString errorString;
+    const QList<QcPatch> patches = QcEvaluator::specFromTable(table, &errorString);
+    QCOMPARE(patches.size(), 2);
+    QCOMPARE(patches[0].name, QStringLiteral("1"));
+    QCOMPARE(patches[0].target, 0.50F);
+    QCOMPARE(patches[1].target, 1.00F);
+    QCOMPARE(patches[1].tolMinus, 0.10F);
+    QCOMPARE(patches[1].warnPlus, 0.10F);
+}
+
+void TestQcEvaluator::specMissingTolerance()
+{
+    const CgatsTable table = makeTable(QStringList() << "SAMPLE_NAME" << "D_TARGET" << "D_TOL",
+                                       QList<QStringList>()
+                                       << (QStringList() << "A" << "0.50" << "0.05")
+                                       << (QStringList() << "B" << "1.00" << "-"));
+    QString errorString;
+    QVERIFY(QcEvaluator::specFromTable(table, &errorString).isEmpty());
+    QCOMPARE(errorString, QStringLiteral("Patch B has no tolerance"));
+}
+
+void TestQcEvaluator::specSkipsRowsWithoutTarget()
+{
+    CgatsTable table = makeTable(QStringList() << "D_TARGET",
+                                 QList<QStringList>()
+                                 << (QStringList() << "0.50")
+                                 << (QStringList() << "n/a")
+                                 << (QStringList() << "1.50"));
+    table.setKeyword("D_TOL", "0.1");
+
+    const QList<QcPatch> patches = QcEvaluator::specFromTable(table);
+    QCOMPARE(patches.size(), 2);
+
+    // Unnamed patches are named by their row
+    QCOMPARE(patches[0].name, QStringLiteral("1"));
+    QCOMPARE(patches[1].name, QStringLiteral("3"));
+}
+
+void TestQcEvaluator::matchSequence()
+{
+    QcEvaluator evaluator;
+    evaluator.setSpec(QcEvaluator::loadSpec(QFINDTESTDATA("data/qc-spec.cgats")));
+    QVERIFY(evaluator.hasSpec());
+    QCOMPARE(evaluator.matching(), QcEvaluator::MatchSequence);
+
+    QcResult result = evaluator.evaluate(QStringLiteral("T"), 0.27F);
+    QCOMPARE(result.patch, 0);
+    QCOMPARE(result.status, QcResult::Pass);
+    QCOMPARE(result.deviation, 0.27F - 0.25F);
+
+    result = evaluator.evaluate(QStringLiteral("R"), 0.70F);
+    QCOMPARE(result.patch, 1);
+    QCOMPARE(result.status, QcResult::Fail);
+
+    // A patch without a mode accepts either
+    result = evaluator.evaluate(QStringLiteral("T"), 1.58F);
+    QCOMPARE(result.patch, 2);
+    QCOMPARE(result.status, QcResult::Pass);
+
+    result = evaluator.evaluate(QStringLiteral("T"), 2.80F);
+    QCOMPARE(result.patch, 3);
+    QCOMPARE(result.status, QcResult::Warn);
+
+    // The sequence starts over after the last patch
+    QCOMPARE(evaluator.currentPatch(), 0);
+    result = evaluator.evaluate(QStringLiteral("T"), 0.40F);
+    QCOMPARE(result.patch, 0);
+    QCOMPARE(result.status, QcResult::Fail);
+
+    QCOMPARE(evaluator.statusCount(0, QcResult::Pass), 1);
+    QCOMPARE(evaluator.statusCount(0, QcResult::Fail), 1);
+    QCOMPARE(evaluator.statusCount(1, QcResult::Fail), 1);
+    QCOMPARE(evaluator.statusCount(3, QcResult::Warn), 1);
+    QCOMPARE(evaluator.stats(0).count(), 2);
+    QCOMPARE(evaluator.records().size(), 5);
+}
+
+void TestQcEvaluator::matchSelected()
+{
+    QcEvaluator evaluator;
+    evaluator.setSpec(QcEvaluator::loadSpec(QFINDTESTDATA("data/qc-spec.cgats")));
+    evaluator.setMatching(QcEvaluator::MatchSelected);
+    evaluator.setCurrentPatch(2);
+
+    QCOMPARE(evaluator.evaluate(QStringLiteral("R"), 1.50F).patch, 2);
+    QCOMPARE(evaluator.evaluate(QStringLiteral("R"), 1.55F).patch, 2);
+    QCOMPARE(evaluator.currentPatch(), 2);
+    QCOMPARE(evaluator.stats(2).count(), 2);
+
+    // Out of range selections are ignored
+    evaluator.setCurrentPatch(4);
+    QCOMPARE(evaluator.currentPatch(), 2);
+    evaluator.setCurrentPatch(-1);
+    QCOMPARE(evaluator.currentPatch(), 2);
+}
+
+void TestQcEvaluator::modeMismatch()
+{
+    QcEvaluator evaluator;
+    evaluator.setSpec(QcEvaluator::loadSpec(QFINDTESTDATA("data/qc-spec.cgats")));
+
+    // A reflection reading of a transmission patch fails, even on target,
+    // and the same patch has to be measured again
+    QcResult result = evaluator.evaluate(QStringLiteral("R"), 0.25F);
+    QCOMPARE(result.patch, 0);
+    QCOMPARE(result.status, QcResult::Fail);
+    QVERIFY(result.modeMismatch);
+    QCOMPARE(evaluator.currentPatch(), 0);
+    QCOMPARE(evaluator.stats(0).count(), 0);
+    QCOMPARE(evaluator.statusCount(0, QcResult::Fail), 1);
+
+    result = evaluator.evaluate(QStringLiteral("T"), 0.25F);
+    QCOMPARE(result.patch, 0);
+    QCOMPARE(result.status, QcResult::Pass);
+    QVERIFY(!result.modeMismatch);
+    QCOMPARE(evaluator.currentPatch(), 1);
+    QCOMPARE(evaluator.stats(0).count(), 1);
+}
+
+void TestQcEvaluator::noSpec()
+{
+    QcEvaluator evaluator;
+    QVERIFY(!evaluator.hasSpec());
+
+    const QcResult result = evaluator.evaluate(QStringLiteral("R"), 1.0F);
+    QCOMPARE(result.patch, -1);
+    QCOMPARE(result.status, QcResult::Fail);
+    QVERIFY(evaluator.records().isEmpty());
+    QCOMPARE(evaluator.stats(0).count(), 0);
+    QCOMPARE(evaluator.statusCount(0, QcResult::Fail), 0);
+}
+
+void TestQcEvaluator::reset()
+{
+    QcEvaluator evaluator;
+    evaluator.setSpec(QcEvaluator::loadSpec(QFINDTESTDATA("data/qc-spec.cgats")));
+    evaluator.evaluate(QStringLiteral("T"), 0.25F);
+    evaluator.evaluate(QStringLiteral("R"), 0.75F);
+    QCOMPARE(evaluator.currentPatch(), 2);
+
+    evaluator.reset();
+    QCOMPARE(evaluator.currentPatch(), 0);
+    QVERIFY(evaluator.records().isEmpty());
+    QCOMPARE(evaluator.stats(0).count(), 0);
+    QCOMPARE(evaluator.statusCount(1, QcResult::Pass), 0);
+    QCOMPARE(evaluator.patches().size(), 4);
+}
+
+void TestQcEvaluator::stats()
+{
+    QcPatchStats stats;
+    stats.add(1.0F);
+    stats.add(2.0F);
+    stats.add(3.0F);
+    stats.add(4.0F);
+
+    QCOMPARE(stats.count(), 4);
+    QCOMPARE(stats.mean(), 2.5F);
+    QCOMPARE(stats.stddev(), static_cast<float>(std::sqrt(5.0 / 3.0)));
+    QCOMPARE(stats.min(), 1.0F);
+    QCOMPARE(stats.max(), 4.0F);
+    QCOMPARE(stats.trend(), 1.0F);
+
+    // The nearer limit decides the capability
+    QCOMPARE(stats.cpk(0.0F, 6.0F), static_cast<float>(2.5 / (3.0 * std::sqrt(5.0 / 3.0))));
+    QCOMPARE(stats.cpk(-10.0F, 3.0F), static_cast<float>(0.5 / (3.0 * std::sqrt(5.0 / 3.0))));
+
+    // A process that is off target has a negative capability
+    QVERIFY(stats.cpk(3.0F, 5.0F) < 0.0F);
+}
+
+void TestQcEvaluator::statsTooFewReadings()
+{
+    QcPatchStats stats;
+    QVERIFY(qIsNaN(stats.mean()));
+    QVERIFY(qIsNaN(stats.min()));
+
+    stats.add(1.5F);
+    QCOMPARE(stats.mean(), 1.5F);
+    QVERIFY(qIsNaN(stats.stddev()));
+    QVERIFY(qIsNaN(stats.trend()));
+    QVERIFY(qIsNaN(stats.cpk(1.0F, 2.0F)));
+
+    // Identical readings have no spread to judge capability by
+    stats.add(1.5F);
+    QCOMPARE(stats.stddev(), 0.0F);
+    QCOMPARE(stats.trend(), 0.0F);
+    QVERIFY(qIsNaN(stats.cpk(1.0F, 2.0F)));
+}
+
+void TestQcEvaluator::reportTables()
+{
+    QcEvaluator evaluator;
+    evaluator.setSpec(QcEvaluator::loadSpec(QFINDTESTDATA("data/qc-spec.cgats")));
+    evaluator.evaluate(QStringLiteral("R"), 0.25F);
+    evaluator.evaluate(QStringLiteral("T"), 0.31F);
+
+    const CgatsTable readings = evaluator.readingsTable();
+    QCOMPARE(readings.rowCount(), 2);
+    const int statusField = readings.fieldIndex("QC_STATUS");
+    QCOMPARE(readings.value(0, statusField), QStringLiteral("FAIL_MODE"));
+    QCOMPARE(readings.value(1, statusField), QStringLiteral("WARN"));
+    QCOMPARE(readings.value(1, readings.fieldIndex("SAMPLE_NAME")), QStringLiteral("Base + fog"));
+    QCOMPARE(readings.value(1, readings.fieldIndex("D_DEVIATION")), QStringLiteral("0.06"));
+
+    const CgatsTable summary = evaluator.summaryTable();
+    QCOMPARE(summary.rowCount(), 4);
+    QCOMPARE(summary.value(0, summary.fieldIndex("COUNT")), QStringLiteral("1"));
+    QCOMPARE(summary.value(0, summary.fieldIndex("WARN")), QStringLiteral("1"));
+    QCOMPARE(summary.value(0, summary.fieldIndex("FAIL")), QStringLiteral("1"));
+    QCOMPARE(summary.value(0, summary.fieldIndex("D_MEAN")), QStringLiteral("0.310"));
+    QVERIFY(summary.value(0, summary.fieldIndex("D_STDEV")).isEmpty());
+    QCOMPARE(summary.value(1, summary.fieldIndex("COUNT")), QStringLiteral("0"));
+}
+
+QTEST_GUILESS_MAIN(TestQcEvaluator)
+
+#include "tst_qcevaluator.moc"
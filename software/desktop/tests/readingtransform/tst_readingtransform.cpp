@@ -0,0 +1,308 @@
+#include <QtTest>
+#include <QLoggingCategory>
+#include <QTemporaryDir>
+
+#include "readingtransform.h"
+
+/*
+ * Tests for the scripted computed columns, run on fixed readings the
+ * same way the --replay command line option runs them on recorded ones.
+ */
+class TestReadingTransform : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void computedColumns();
+    void columnOrder();
+    void noScripts();
+    void loadErrors();
+    void runtimeErrors();
+    void divisionByZero();
+    void missingColumns();
+    void timeBudget();
+
+private:
+    struct Result {
+        QStringList columns;
+        QStringList values;
+        QString value(const QString &column) const { return values.value(columns.indexOf(column)); }
+    };
+
+    QString writeScript(const QString &name, const QByteArray &source);
+    QList<Result> run(ReadingTransform *transform, const QList<TransformReading> &readings);
+
+    static TransformReading reading(DensInterface::DensityType type, float dValue, float dZero = qSNaN());
+
+    QTemporaryDir tempDir_;
+};
+
+void TestReadingTransform::initTestCase()
+{
+    QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false"));
+    QVERIFY(tempDir_.isValid());
+}
+
+QString TestReadingTransform::writeScript(const QString &name, const QByteArray &source)
+{
+    const QString fileName = tempDir_.filePath(name);
+    QFile file(fileName);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+        file.write(source);
+    }
+    return fileName;
+}
+
+QList<TestReadingTransform::Result> TestReadingTransform::run(ReadingTransform *transform, const QList<TransformReading> &readings)
+{
+    QList<Result> results;
+    quint64 lastSequence = 0;
+    bool done = false;
+
+    QMetaObject::Connection connection = connect(transform, &ReadingTransform::readingTransformed,
+            [&](const TransformReading &reading, const QStringList &columns, const QStringList &values) {
+        results.append(Result{columns, values});
+        if (reading.sequence == lastSequence) { done = true; }
+    });
+
+    for (const TransformReading &reading : readings) {
+        lastSequence = transform->processReading(reading.type, reading.dValue, reading.dZero,
+                                                 reading.rawValue, reading.corrValue, reading.dUncertainty);
+    }
+    QTest::qWaitFor([&done]() { return done; }, 5000);
+    disconnect(connection);
+    return results;
+}
+
+TransformReading TestReadingTransform::reading(DensInterface::DensityType type, float dValue, float dZero)
+{
+    TransformReading reading;
+    reading.type = type;
+    reading.dValue = dValue;
+    reading.dZero = dZero;
+    reading.rawValue = 120.5F;
+    reading.corrValue = 0.25F;
+    reading.dUncertainty = 0.004F;
+    return reading;
+}
+
+void TestReadingTransform::computedColumns()
+{
+    ReadingTransform transform;
+    transform.setScripts({ writeScript("delta.js",
+                                       "// Deviation from the aim density\n"
+                                       "var AIM = 1.0;\n"
+                                       "function transform(reading) {\n"
+                                       "    return {\n"
+                                       "        Delta: reading.density - AIM,\n"
+                                       "        Mode: reading.mode,\n"
+                                       "        Log: Math.log10(reading.corrected),\n"
+                                       "        Zeroed: reading.zero !== null\n"
+                                       "    };\n"
+                                       "}\n") });
+    QVERIFY(transform.isActive());
+    QSignalSpy errorSpy(&transform, &ReadingTransform::scriptError);
+
+    const QList<Result> results = run(&transform, {
+        reading(DensInterface::DensityReflection, 1.5F, 0.25F),
+        reading(DensInterface::DensityTransmission, 2.5F),
+        reading(DensInterface::DensityReflection, 0.5F, 0.0F)
+    });
+    QCOMPARE(results.size(), 3);
+    QVERIFY(errorSpy.isEmpty());
+
+    QCOMPARE(results.at(0).columns, QStringList({ "Delta", "Mode", "Log", "Zeroed" }));
+    QCOMPARE(results.at(0).value("Delta"), QStringLiteral("0.25"));
+    QCOMPARE(results.at(0).value("Mode"), QStringLiteral("R"));
+    QCOMPARE(results.at(0).value("Log"), QStringLiteral("-0.6021"));
+    QCOMPARE(results.at(0).value("Zeroed"), QStringLiteral("true"));
+
+    QCOMPARE(results.at(1).value("Delta"), QStringLiteral("1.5"));
+    QCOMPARE(results.at(1).value("Mode"), QStringLiteral("T"));
+    QCOMPARE(results.at(1).value("Zeroed"), QStringLiteral("false"));
+
+    QCOMPARE(results.at(2).value("Delta"), QStringLiteral("-0.5"));
+}
+
+void TestReadingTransform::columnOrder()
+{
+    // Columns keep the order of the scripts, and later scripts can replace
+    // the value of a column added by an earlier one
+    ReadingTransform transform;
+    transform.setScripts({
+        writeScript("first.js", "function transform(r) { return { A: 1, B: 2 }; }\n"),
+        writeScript("second.js", "function transform(r) { return { C: 3, A: 'replaced' }; }\n")
+    });
+
+    const QList<Result> results = run(&transform, { reading(DensInterface::DensityReflection, 0.5F) });
+    QCOMPARE(results.size(), 1);
+    QCOMPARE(results.at(0).columns, QStringList({ "A", "B", "C" }));
+    QCOMPARE(results.at(0).values, QStringList({ "replaced", "2", "3" }));
+}
+
+void TestReadingTransform::noScripts()
+{
+    ReadingTransform transform;
+    QVERIFY(!transform.isActive());
+
+    const QList<Result> results = run(&transform, { reading(DensInterface::DensityReflection, 0.5F) });
+    QCOMPARE(results.size(), 1);
+    QVERIFY(results.at(0).columns.isEmpty());
+}
+
+void TestReadingTransform::loadErrors()
+{
+    ReadingTransform transform;
+    QSignalSpy errorSpy(&transform, &ReadingTransform::scriptError);
+
+    // Scripts that fail to load are skipped, and the others still run
+    transform.setScripts({
+        writeScript("syntax.js", "function transform(r) {\n    return { A: 1 ;\n}\n"),
+        writeScript("nofunction.js", "var transform = 42;\n"),
+        tempDir_.filePath("missing.js"),
+        writeScript("good.js", "function transform(r) { return { Good: r.mode }; }\n")
+    });
+
+    const QList<Result> results = run(&transform, { reading(DensInterface::DensityTransmission, 1.5F) });
+    QCOMPARE(results.size(), 1);
+    QCOMPARE(results.at(0).columns, QStringList({ "Good" }));
+    QCOMPARE(results.at(0).values, QStringList({ "T" }));
+
+    QCOMPARE(errorSpy.size(), 3);
+    const QString syntaxError = errorSpy.at(0).at(0).toString();
+    QVERIFY2(syntaxError.startsWith(QStringLiteral("syntax.js:2: SyntaxError")), qPrintable(syntaxError));
+    QCOMPARE(errorSpy.at(1).at(0).toString(),
+             QStringLiteral("nofunction.js: Script does not define a transform(reading) function"));
+    QVERIFY(errorSpy.at(2).at(0).toString().startsWith(QStringLiteral("missing.js: ")));
+}
+
+void TestReadingTransform::runtimeErrors()
+{
+    ReadingTransform transform;
+    QSignalSpy errorSpy(&transform, &ReadingTransform::scriptError);
+    transform.setScripts({
+        writeScript("throws.js",
+                    "function transform(r) {\n"
+                    "    if (r.mode === 'T') { throw new Error('No transmission aim'); }\n"
+                    "    return { Aim: 1.2 };\n"
+                    "}\n"),
+        writeScript("undefined.js", "function transform(r) { return { B: notDefined * 2 }; }\n"),
+        writeScript("good.js", "function transform(r) { return { Good: r.value }; }\n")
+    });
+
+    const QList<Result> results = run(&transform, {
+        reading(DensInterface::DensityTransmission, 1.5F),
+        reading(DensInterface::DensityTransmission, 1.6F),
+        reading(DensInterface::DensityReflection, 0.5F),
+        reading(DensInterface::DensityTransmission, 1.7F)
+    });
+    QCOMPARE(results.size(), 4);
+
+    // A failing script adds nothing, without affecting the other scripts
+    QCOMPARE(results.at(0).columns, QStringList({ "Good" }));
+    QCOMPARE(results.at(0).values, QStringList({ "1.5" }));
+    QCOMPARE(results.at(2).columns, QStringList({ "Aim", "Good" }));
+    QCOMPARE(results.at(3).columns, QStringList({ "Good" }));
+
+    // Each script reports the first of a run of errors, and again once it
+    // has recovered and failed again
+    QCOMPARE(errorSpy.size(), 3);
+    QCOMPARE(errorSpy.at(0).at(0).toString(), QStringLiteral("throws.js:2: Error: No transmission aim"));
+    QVERIFY(errorSpy.at(1).at(0).toString().startsWith(QStringLiteral("undefined.js:1: ReferenceError")));
+    QCOMPARE(errorSpy.at(2).at(0).toString(), QStringLiteral("throws.js:2: Error: No transmission aim"));
+}
+
+void TestReadingTransform::divisionByZero()
+{
+    ReadingTransform transform;
+    QSignalSpy errorSpy(&transform, &ReadingTransform::scriptError);
+    transform.setScripts({ writeScript("ratio.js",
+                                       "function transform(r) {\n"
+                                       "    return {\n"
+                                       "        Ratio: r.value / r.zero,\n"
+                                       "        Contrast: r.density / (r.value - r.value),\n"
+                                       "        Relative: (r.value - r.value) / (r.zero - r.zero),\n"
+                                       "        Check: 1 / 4\n"
+                                       "    };\n"
+                                       "}\n") });
+
+    const QList<Result> results = run(&transform, {
+        reading(DensInterface::DensityReflection, 1.5F, 0.0F),
+        reading(DensInterface::DensityReflection, 1.5F, 0.5F)
+    });
+    QCOMPARE(results.size(), 2);
+
+    // Dividing by zero is not a script error, but it has no value
+    QVERIFY(errorSpy.isEmpty());
+    QCOMPARE(results.at(0).columns, QStringList({ "Ratio", "Contrast", "Relative", "Check" }));
+    QCOMPARE(results.at(0).values, QStringList({ "", "", "", "0.25" }));
+    QCOMPARE(results.at(1).values, QStringList({ "3", "", "", "0.25" }));
+}
+
+void TestReadingTransform::missingColumns()
+{
+    ReadingTransform transform;
+    QSignalSpy errorSpy(&transform, &ReadingTransform::scriptError);
+    transform.setScripts({
+        writeScript("opacity.js",
+                    "function transform(r) {\n"
+                    "    if (r.mode !== 'T') { return {}; }\n"
+                    "    return { Opacity: Math.pow(10, r.density) };\n"
+                    "}\n"),
+        writeScript("missing.js",
+                    "function transform(r) {\n"
+                    "    return { Temperature: r.temperature, Corrected: r.temperature * 2, Zero: r.zero };\n"
+                    "}\n"),
+        writeScript("nothing.js", "function transform(r) { return r.mode === 'R' ? 42 : undefined; }\n")
+    });
+
+    const QList<Result> results = run(&transform, {
+        reading(DensInterface::DensityReflection, 0.5F),
+        reading(DensInterface::DensityTransmission, 2.0F, 0.0F)
+    });
+    QCOMPARE(results.size(), 2);
+    QVERIFY(errorSpy.isEmpty());
+
+    // Columns a script leaves out for a reading are not added for it
+    QCOMPARE(results.at(0).columns, QStringList({ "Temperature", "Corrected", "Zero" }));
+    QCOMPARE(results.at(1).columns, QStringList({ "Opacity", "Temperature", "Corrected", "Zero" }));
+    QCOMPARE(results.at(1).value("Opacity"), QStringLiteral("100"));
+
+    // Properties the reading does not have are left empty, as is the zero
+    // of a reading taken without one
+    QCOMPARE(results.at(0).values, QStringList({ "", "", "" }));
+    QCOMPARE(results.at(1).value("Zero"), QStringLiteral("0"));
+}
+
+void TestReadingTransform::timeBudget()
+{
+    ReadingTransform transform;
+    transform.setTimeBudget(20);
+    QSignalSpy errorSpy(&transform, &ReadingTransform::scriptError);
+    transform.setScripts({
+        writeScript("loop.js",
+                    "function transform(r) {\n"
+                    "    while (r.mode === 'T') { }\n"
+                    "    return { Loop: 'done' };\n"
+                    "}\n"),
+        writeScript("good.js", "function transform(r) { return { Good: r.mode }; }\n")
+    });
+
+    const QList<Result> results = run(&transform, {
+        reading(DensInterface::DensityTransmission, 1.5F),
+        reading(DensInterface::DensityReflection, 0.5F)
+    });
+    QCOMPARE(results.size(), 2);
+
+    // The stuck script is stopped, and the reading still comes through
+    QCOMPARE(results.at(0).columns, QStringList({ "Good" }));
+    QCOMPARE(results.at(1).columns, QStringList({ "Loop", "Good" }));
+    QCOMPARE(errorSpy.size(), 1);
+    QCOMPARE(errorSpy.at(0).at(0).toString(), QStringLiteral("loop.js: Script exceeded its time budget"));
+}
+
+QTEST_GUILESS_MAIN(TestReadingTransform)
+
+#include "tst_readingtransform.moc"
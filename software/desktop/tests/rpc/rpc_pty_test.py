@@ -0,0 +1,384 @@
+#!/usr/bin/env python3
+"""
+End-to-end test of the headless JSON-RPC mode, run against a simulated
+device on a pseudo-terminal.
+
+The application is started with --rpc and connected to the slave side
+of a pty, while this script answers its serial commands on the master
+side. Besides checking the RPC methods, it measures how long readings
+take to come out as measurement.reading notifications, and how many
+notifications per second get through when readings arrive back to back.
+
+This only runs on Linux and macOS. The application needs a display
+platform, so QT_QPA_PLATFORM defaults to offscreen.
+
+Usage: rpc_pty_test.py [--readings N] [--rate HZ] path/to/densitometer
+"""
+
+import argparse
+import json
+import os
+import queue
+import statistics
+import struct
+import subprocess
+import sys
+import threading
+import time
+import tty
+
+RPC_TIMEOUT = 5.0
+ERROR_TIMEOUT = -32001
+ERROR_DEVICE = -32002
+
+
+def encode_f32(value):
+    return struct.pack('>f', value).hex().upper()
+
+
+def encode_f32_list(values):
+    return ','.join(encode_f32(v) for v in values)
+
+
+class FakeDevice:
+    """Answers the serial commands the application sends, in order."""
+
+    CAL_GAIN = [1.0, 1.0, 24.5, 25.1, 390.0, 402.0, 8900.0, 9100.0]
+    CAL_SLOPE = [0.0, 1.0, 0.0]
+    CAL_REFL = [0.08, 320.0, 1.5, 12.0]
+    CAL_TRAN = [0.0, 1500.0, 2.9, 5.0]
+
+    def __init__(self):
+        self.master, self.slave = os.openpty()
+        tty.setraw(self.slave)
+        self.port = os.ttyname(self.slave)
+        self.write_lock = threading.Lock()
+        self.rejected = {}
+        self.delayed = {}
+        self.temperature = '25.0C'
+        self.commands = []
+        self.running = True
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+
+    def close(self):
+        self.running = False
+        os.close(self.slave)
+        os.close(self.master)
+
+    def write_line(self, line):
+        data = (line + '\r\n').encode('latin-1')
+        with self.write_lock:
+            while data:
+                n = os.write(self.master, data)
+                data = data[n:]
+
+    def reject_once(self, command, reply):
+        """Answer the next matching command with ERR or NAK."""
+        self.rejected[command] = reply
+
+    def delay_once(self, command, seconds):
+        """Hold up the answer to the next matching command, and everything after it."""
+        self.delayed[command] = seconds
+
+    def run(self):
+        buf = b''
+        while self.running:
+            try:
+                data = os.read(self.master, 1024)
+            except OSError:
+                break
+            if not data:
+                break
+            buf += data
+            while b'\n' in buf:
+                line, buf = buf.split(b'\n', 1)
+                line = line.strip().decode('latin-1')
+                if line:
+                    self.commands.append(line)
+                    self.handle(line)
+
+    def handle(self, line):
+        command, _, args = line.partition(',')
+        if command in self.rejected:
+            reply = '{},{}'.format(command, self.rejected.pop(command))
+        else:
+            reply = self.reply(command)
+        if command in self.delayed:
+            time.sleep(self.delayed.pop(command))
+        self.write_line(reply)
+
+    def reply(self, command):
+        if command == 'GS V':
+            return 'GS V,"Printalyzer Densitometer","v0.0.0-test",3,7'
+        elif command == 'GS B':
+            return 'GS B,2026-01-01 00:00,gtest,1234ABCD'
+        elif command == 'GS DEV':
+            return 'GS DEV,1.12.0,0x447,0x1000,32MHz'
+        elif command == 'GS UID':
+            return 'GS UID,00000000DEADBEEF12345678'
+        elif command == 'GS ISEN':
+            return 'GS ISEN,3.30V,{}'.format(self.temperature)
+        elif command == 'GD CRASH':
+            return 'GD CRASH,NONE'
+        elif command in ('SM FORMAT', 'SM UNCAL'):
+            return '{},OK'.format(command)
+        elif command == 'GC GAIN':
+            return 'GC GAIN,' + encode_f32_list(self.CAL_GAIN)
+        elif command == 'GC SLOPE':
+            return 'GC SLOPE,' + encode_f32_list(self.CAL_SLOPE)
+        elif command == 'GC REFL':
+            return 'GC REFL,' + encode_f32_list(self.CAL_REFL)
+        elif command == 'GC TRAN':
+            return 'GC TRAN,' + encode_f32_list(self.CAL_TRAN)
+        elif command in ('SC GAIN', 'SC SLOPE', 'SC REFL', 'SC TRAN'):
+            return '{},OK'.format(command)
+        else:
+            return '{},NAK'.format(command)
+
+    def send_reading(self, index, quality=0):
+        """Send a reading in the extended quality format, tagged with its index."""
+        self.write_line('R+0.50D,{},{},{},{},{},{:02X}'.format(
+            encode_f32(0.5), encode_f32(0.0), encode_f32(float(index)), encode_f32(1.0),
+            encode_f32(0.01), quality))
+
+
+class RpcClient:
+    """Talks to the application over its stdin and stdout."""
+
+    def __init__(self, executable, port):
+        env = dict(os.environ)
+        env.setdefault('QT_QPA_PLATFORM', 'offscreen')
+        self.process = subprocess.Popen(
+            [executable, '--rpc', '--port', 'serial:' + port],
+            stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+            env=env)
+        self.next_id = 1
+        self.responses = {}
+        self.responses_cond = threading.Condition()
+        self.notifications = queue.Queue()
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+
+    def run(self):
+        for line in self.process.stdout:
+            received = time.perf_counter()
+            message = json.loads(line)
+            if 'id' in message:
+                with self.responses_cond:
+                    self.responses[message['id']] = message
+                    self.responses_cond.notify_all()
+            else:
+                self.notifications.put((received, message))
+
+    def send(self, method, params=None):
+        request_id = self.next_id
+        self.next_id += 1
+        message = {'jsonrpc': '2.0', 'id': request_id, 'method': method}
+        if params is not None:
+            message['params'] = params
+        self.process.stdin.write((json.dumps(message) + '\n').encode('utf-8'))
+        self.process.stdin.flush()
+        return request_id
+
+    def wait(self, request_id, timeout=RPC_TIMEOUT * 2):
+        deadline = time.monotonic() + timeout
+        with self.responses_cond:
+            while request_id not in self.responses:
+                remaining = deadline - time.monotonic()
+                if remaining <= 0:
+                    raise AssertionError('No response to request {}'.format(request_id))
+                self.responses_cond.wait(remaining)
+            return self.responses.pop(request_id)
+
+    def call(self, method, params=None, timeout=RPC_TIMEOUT * 2):
+        return self.wait(self.send(method, params), timeout)
+
+    def close(self):
+        self.process.stdin.close()
+        try:
+            return self.process.wait(timeout=RPC_TIMEOUT)
+        except subprocess.TimeoutExpired:
+            self.process.kill()
+            return None
+
+
+def check(condition, message):
+    if not condition:
+        raise AssertionError(message)
+
+
+def expect_result(response):
+    check('result' in response, 'Expected a result: {}'.format(response))
+    return response['result']
+
+
+def expect_error(response, code):
+    check('error' in response, 'Expected an error: {}'.format(response))
+    check(response['error']['code'] == code,
+          'Expected error {}: {}'.format(code, response['error']))
+    return response['error']
+
+
+def test_info(device, client):
+    result = expect_result(client.call('device.info'))
+    check(result['uid'] == '00000000DEADBEEF12345678', 'Wrong unique id')
+    check(result['settingsVersion'] == 7, 'Wrong settings version')
+
+
+def test_late_response(device, client):
+    # The first request times out waiting on the device, which then
+    # answers it while the second request is waiting on the same kind
+    # of response. The late answer must not complete the second request.
+    device.delay_once('GS ISEN', RPC_TIMEOUT + 1.5)
+    expect_error(client.call('device.info'), ERROR_TIMEOUT)
+    device.temperature = '31.5C'
+    result = expect_result(client.call('device.info'))
+    check(result['temperature'] == '31.5C',
+          'Late response completed the next request: {}'.format(result['temperature']))
+
+
+def test_rejected_set(device, client):
+    calibration = expect_result(client.call('calibration.get'))
+    device.reject_once('SC SLOPE', 'ERR')
+    error = expect_error(client.call('calibration.set', {'calibration': calibration}), ERROR_DEVICE)
+    check('SLOPE' in error['message'], 'Error does not name the command: {}'.format(error))
+
+    # The responses to the other values of the failed request are
+    # consumed, and do not complete this one early
+    check(expect_result(client.call('calibration.set', {'calibration': calibration})) is True,
+          'Calibration was not set')
+
+
+def test_nak(device, client):
+    device.reject_once('GD CRASH', 'NAK')
+    expect_error(client.call('diagnostics.crashRecord'), ERROR_DEVICE)
+    result = expect_result(client.call('diagnostics.crashRecord'))
+    check(result['present'] is False, 'Unexpected crash record')
+
+
+def drain_notifications(client):
+    while True:
+        try:
+            client.notifications.get_nowait()
+        except queue.Empty:
+            return
+
+
+def collect_readings(client, count, timeout):
+    readings = {}
+    deadline = time.monotonic() + timeout
+    while len(readings) < count:
+        remaining = deadline - time.monotonic()
+        if remaining <= 0:
+            break
+        try:
+            received, message = client.notifications.get(timeout=remaining)
+        except queue.Empty:
+            break
+        if message.get('method') == 'measurement.reading':
+            readings[int(message['params']['raw'])] = received
+    return readings
+
+
+def test_quality(device, client):
+    check(expect_result(client.call('measurement.subscribe')) is True, 'Unable to subscribe')
+    drain_notifications(client)
+    device.send_reading(0, 0x09)
+    deadline = time.monotonic() + RPC_TIMEOUT
+    params = None
+    while params is None and time.monotonic() < deadline:
+        try:
+            _, message = client.notifications.get(timeout=max(0.0, deadline - time.monotonic()))
+        except queue.Empty:
+            break
+        if message.get('method') == 'measurement.reading':
+            params = message['params']
+    check(params is not None, 'No reading notification')
+    check(params.get('quality') == 0x09, 'Wrong quality flags: {}'.format(params.get('quality')))
+    check(expect_result(client.call('measurement.unsubscribe')) is True, 'Unable to unsubscribe')
+
+
+def test_streaming(device, client, count, rate):
+    check(expect_result(client.call('measurement.subscribe')) is True, 'Unable to subscribe')
+    drain_notifications(client)
+
+    # Latency, with readings paced like a device being used continuously
+    sent = {}
+    interval = 1.0 / rate
+    start = time.perf_counter()
+    for i in range(count):
+        target = start + i * interval
+        while time.perf_counter() < target:
+            time.sleep(min(0.001, max(0.0, target - time.perf_counter())))
+        sent[i] = time.perf_counter()
+        device.send_reading(i)
+    readings = collect_readings(client, count, RPC_TIMEOUT)
+    check(len(readings) == count, 'Lost {} of {} paced readings'.format(count - len(readings), count))
+
+    latencies = sorted((readings[i] - sent[i]) * 1000.0 for i in range(count))
+    print('Notification latency at {} Hz, {} readings: median {:.2f} ms, '
+          'p95 {:.2f} ms, p99 {:.2f} ms, max {:.2f} ms'.format(
+              rate, count,
+              statistics.median(latencies),
+              latencies[int(len(latencies) * 0.95) - 1],
+              latencies[int(len(latencies) * 0.99) - 1],
+              latencies[-1]))
+
+    # Throughput, with readings sent back to back
+    drain_notifications(client)
+    start = time.perf_counter()
+    for i in range(count):
+        device.send_reading(i)
+    readings = collect_readings(client, count, RPC_TIMEOUT * 2)
+    check(len(readings) == count, 'Lost {} of {} burst readings'.format(count - len(readings), count))
+    elapsed = max(readings.values()) - start
+    print('Notification throughput, {} readings back to back: {:.0f} readings/s'.format(
+        count, count / elapsed))
+
+    check(expect_result(client.call('measurement.unsubscribe')) is True, 'Unable to unsubscribe')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='End-to-end test of the --rpc mode against a pty')
+    parser.add_argument('executable', help='Path to the densitometer application')
+    parser.add_argument('--readings', type=int, default=2000, help='Readings to stream')
+    parser.add_argument('--rate', type=float, default=100.0, help='Paced reading rate in Hz')
+    args = parser.parse_args()
+
+    device = FakeDevice()
+    client = RpcClient(args.executable, device.port)
+    failures = 0
+    try:
+        result = expect_result(client.call('connect'))
+        check(result['name'] == 'Printalyzer Densitometer', 'Wrong device name')
+
+        tests = [
+            ('info', lambda: test_info(device, client)),
+            ('late_response', lambda: test_late_response(device, client)),
+            ('rejected_set', lambda: test_rejected_set(device, client)),
+            ('nak', lambda: test_nak(device, client)),
+            ('quality', lambda: test_quality(device, client)),
+            ('streaming', lambda: test_streaming(device, client, args.readings, args.rate)),
+        ]
+        for name, test in tests:
+            try:
+                test()
+                print('PASS', name)
+            except AssertionError as ex:
+                print('FAIL', name, ex)
+                failures += 1
+
+        expect_result(client.call('disconnect'))
+    finally:
+        status = client.close()
+        device.close()
+
+    if status != 0:
+        print('FAIL exit status', status)
+        failures += 1
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,25 @@
+QT += testlib gui
+QT -= widgets
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_settingsschema
+
+SRC_DIR = ../../src
+INCLUDEPATH += $$SRC_DIR
+
+SOURCES += \
+    tst_settingsschema.cpp \
+    $$SRC_DIR/denscalvalues.cpp \
+    $$SRC_DIR/settingsschema.cpp \
+    $$SRC_DIR/util.cpp
+
+HEADERS += \
+    $$SRC_DIR/denscalvalues.h \
+    $$SRC_DIR/settingsschema.h \
+    $$SRC_DIR/util.h
+
+OTHER_FILES += \
+    data/settings-v1.json \
+    data/settings-v1-unset.json
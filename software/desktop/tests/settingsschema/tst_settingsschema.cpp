@@ -0,0 +1,383 @@
+#include <QtTest>
+#include <QJsonDocument>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "settingsschema.h"
+
+typedef QVector<float> FloatList;
+
+/*
+ * Tests for settings files: exporting and loading again must give back
+ * the same bits, and files from older versions must load with the
+ * values they were written with.
+ */
+class TestSettingsSchema : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void roundTripUnsetParts();
+
+    void migrateVersion1();
+    void migrateVersion1Unset();
+    void migrateUnversioned();
+    void migrateThenExportExact();
+    void migrateCurrentUnchanged();
+    void migrateRejectsNewer();
+    void migrateRejectsBadVersion_data();
+    void migrateRejectsBadVersion();
+
+    void validateReportsEveryIssue();
+
+private:
+    static quint32 bits(float value);
+    static QJsonObject readFixture(const QString &name);
+    static QJsonObject exportAndReload(const DensCalGain &calGain, const DensCalSlope &calSlope,
+                                       const DensCalTarget &calReflection, const DensCalTarget &calTransmission,
+                                       SettingsSchema::FloatEncoding encoding);
+};
+
+quint32 TestSettingsSchema::bits(float value)
+{
+    quint32 result;
+    std::memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+QJsonObject TestSettingsSchema::readFixture(const QString &name)
+{
+    QFile file(QFINDTESTDATA(QStringLiteral("data/") + name));
+    if (!file.open(QIODevice::ReadOnly)) { return QJsonObject(); }
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+QJsonObject TestSettingsSchema::exportAndReload(const DensCalGain &calGain, const DensCalSlope &calSlope,
+                                                const DensCalTarget &calReflection, const DensCalTarget &calTransmission,
+                                                SettingsSchema::FloatEncoding encoding)
+{
+    // Same document layout as SettingsExporter writes, through text and back
+    QJsonObject root;
+    root["header"] = SettingsSchema::header(encoding);
+    root["calibration"] = SettingsSchema::calibrationToJson(calGain, calSlope, calReflection, calTransmission, encoding);
+    const QByteArray text = QJsonDocument(root).toJson();
+    return QJsonDocument::fromJson(text).object();
+}
+
+void TestSettingsSchema::roundTrip_data()
+{
+    QTest::addColumn<int>("encoding");
+    QTest::addColumn<FloatList>("gain");
+    QTest::addColumn<FloatList>("slope");
+    QTest::addColumn<FloatList>("reflection");
+    QTest::addColumn<FloatList>("transmission");
+
+    const FloatList typicalGain = { 1.0F, 1.0F, 24.523111F, 25.107422F, 392.104828F, 401.977203F, 8912.314453F, 9104.622070F };
+    const FloatList typicalSlope = { -0.048313F, 0.934861F, 0.013247F };
+    const FloatList typicalRefl = { 0.08F, 0.328112F, 1.99F, 0.004512F };
+    const FloatList typicalTran = { 0.0F, 2.412091F, 3.01F, 0.002344F };
+
+    // Values that do not survive being rounded to a fixed number of places,
+    // including the smallest steps away from values that do
+    const float third = 1.0F / 3.0F;
+    const FloatList awkwardGain = {
+        1.0F, std::nextafter(1.0F, 2.0F),
+        std::nextafter(24.5F, 25.0F), 24.5F + third,
+        400.0F + third, std::nextafter(401.0F, 0.0F),
+        std::nextafter(9000.0F, 10000.0F), 10000.0F
+    };
+    const FloatList awkwardSlope = { -third, std::numeric_limits<float>::denorm_min(), std::numeric_limits<float>::max() };
+    const FloatList awkwardRefl = { 0.1F, third, 2.5F, std::numeric_limits<float>::min() };
+    const FloatList awkwardTran = { 0.0F, 1.0e7F + 1.0F, 5.0F, std::nextafter(0.0F, 1.0F) };
+
+    QTest::newRow("exact typical") << int(SettingsSchema::FloatExact) << typicalGain << typicalSlope << typicalRefl << typicalTran;
+    QTest::newRow("exact awkward") << int(SettingsSchema::FloatExact) << awkwardGain << awkwardSlope << awkwardRefl << awkwardTran;
+    QTest::newRow("exact negative zero")
+            << int(SettingsSchema::FloatExact) << typicalGain << FloatList({ -0.0F, 1.0F, 0.0F })
+            << typicalRefl << typicalTran;
+
+    // JSON numbers are written with enough digits to give back the same
+    // double, which holds every float exactly
+    QTest::newRow("decimal typical") << int(SettingsSchema::FloatDecimal) << typicalGain << typicalSlope << typicalRefl << typicalTran;
+    QTest::newRow("decimal awkward") << int(SettingsSchema::FloatDecimal) << awkwardGain << awkwardSlope << awkwardRefl << awkwardTran;
+}
+
+void TestSettingsSchema::roundTrip()
+{
+    QFETCH(int, encoding);
+    QFETCH(FloatList, gain);
+    QFETCH(FloatList, slope);
+    QFETCH(FloatList, reflection);
+    QFETCH(FloatList, transmission);
+
+    DensCalGain calGain;
+    calGain.setLow0(gain[0]);
+    calGain.setLow1(gain[1]);
+    calGain.setMed0(gain[2]);
+    calGain.setMed1(gain[3]);
+    calGain.setHigh0(gain[4]);
+    calGain.setHigh1(gain[5]);
+    calGain.setMax0(gain[6]);
+    calGain.setMax1(gain[7]);
+    QVERIFY(calGain.isValid());
+
+    DensCalSlope calSlope;
+    calSlope.setB0(slope[0]);
+    calSlope.setB1(slope[1]);
+    calSlope.setB2(slope[2]);
+
+    DensCalTarget calReflection;
+    calReflection.setLoDensity(reflection[0]);
+    calReflection.setLoReading(reflection[1]);
+    calReflection.setHiDensity(reflection[2]);
+    calReflection.setHiReading(reflection[3]);
+    QVERIFY(calReflection.isValidReflection());
+
+    DensCalTarget calTransmission;
+    calTransmission.setLoDensity(transmission[0]);
+    calTransmission.setLoReading(transmission[1]);
+    calTransmission.setHiDensity(transmission[2]);
+    calTransmission.setHiReading(transmission[3]);
+    QVERIFY(calTransmission.isValidTransmission());
+
+    QJsonObject root = exportAndReload(calGain, calSlope, calReflection, calTransmission,
+                                       static_cast<SettingsSchema::FloatEncoding>(encoding));
+    const QList<SettingsSchema::Issue> issues = SettingsSchema::load(&root);
+    QVERIFY2(issues.isEmpty(), qPrintable(SettingsSchema::formatIssues(issues)));
+
+    DensCalGain readGain;
+    DensCalSlope readSlope;
+    DensCalTarget readReflection;
+    DensCalTarget readTransmission;
+    QVERIFY(SettingsSchema::readCalGain(root, &readGain));
+    QVERIFY(SettingsSchema::readCalSlope(root, &readSlope));
+    QVERIFY(SettingsSchema::readCalReflection(root, &readReflection));
+    QVERIFY(SettingsSchema::readCalTransmission(root, &readTransmission));
+
+    QCOMPARE(bits(readGain.low0()), bits(gain[0]));
+    QCOMPARE(bits(readGain.low1()), bits(gain[1]));
+    QCOMPARE(bits(readGain.med0()), bits(gain[2]));
+    QCOMPARE(bits(readGain.med1()), bits(gain[3]));
+    QCOMPARE(bits(readGain.high0()), bits(gain[4]));
+    QCOMPARE(bits(readGain.high1()), bits(gain[5]));
+    QCOMPARE(bits(readGain.max0()), bits(gain[6]));
+    QCOMPARE(bits(readGain.max1()), bits(gain[7]));
+
+    QCOMPARE(bits(readSlope.b0()), bits(slope[0]));
+    QCOMPARE(bits(readSlope.b1()), bits(slope[1]));
+    QCOMPARE(bits(readSlope.b2()), bits(slope[2]));
+
+    QCOMPARE(bits(readReflection.loDensity()), bits(reflection[0]));
+    QCOMPARE(bits(readReflection.loReading()), bits(reflection[1]));
+    QCOMPARE(bits(readReflection.hiDensity()), bits(reflection[2]));
+    QCOMPARE(bits(readReflection.hiReading()), bits(reflection[3]));
+
+    QCOMPARE(bits(readTransmission.loDensity()), bits(transmission[0]));
+    QCOMPARE(bits(readTransmission.loReading()), bits(transmission[1]));
+    QCOMPARE(bits(readTransmission.hiDensity()), bits(transmission[2]));
+    QCOMPARE(bits(readTransmission.hiReading()), bits(transmission[3]));
+}
+
+void TestSettingsSchema::roundTripUnsetParts()
+{
+    DensCalSlope calSlope;
+    calSlope.setB0(-0.048313F);
+    calSlope.setB1(0.934861F);
+    calSlope.setB2(0.013247F);
+
+    // Calibration that was never set on the device is left out, not
+    // written as placeholder values that would later fail to load
+    QJsonObject root = exportAndReload(DensCalGain(), calSlope, DensCalTarget(), DensCalTarget(),
+                                       SettingsSchema::FloatExact);
+    const QList<SettingsSchema::Issue> issues = SettingsSchema::load(&root);
+    QVERIFY2(issues.isEmpty(), qPrintable(SettingsSchema::formatIssues(issues)));
+
+    QVERIFY(!SettingsSchema::readCalGain(root, nullptr));
+    QVERIFY(SettingsSchema::readCalSlope(root, nullptr));
+    QVERIFY(!SettingsSchema::readCalReflection(root, nullptr));
+    QVERIFY(!SettingsSchema::readCalTransmission(root, nullptr));
+}
+
+void TestSettingsSchema::migrateVersion1()
+{
+    QJsonObject root = readFixture(QStringLiteral("settings-v1.json"));
+    QVERIFY(!root.isEmpty());
+
+    const QList<SettingsSchema::Issue> issues = SettingsSchema::load(&root);
+    QVERIFY2(issues.isEmpty(), qPrintable(SettingsSchema::formatIssues(issues)));
+
+    const QJsonObject jsonHeader = root["header"].toObject();
+    QCOMPARE(jsonHeader["version"].toInt(), SettingsSchema::CurrentVersion);
+    QCOMPARE(jsonHeader["floats"].toString(), QStringLiteral("decimal"));
+    QCOMPARE(jsonHeader["date"].toString(), QStringLiteral("2022-11-05 14:32"));
+    QCOMPARE(root["system"].toObject()["uid"].toString(), QStringLiteral("0039003A3235510B37333439"));
+
+    // Each value is exactly what version 1 would have read from its string
+    DensCalGain calGain;
+    QVERIFY(SettingsSchema::readCalGain(root, &calGain));
+    QCOMPARE(bits(calGain.low0()), bits(QStringLiteral("1.000000").toFloat()));
+    QCOMPARE(bits(calGain.med0()), bits(QStringLiteral("24.523111").toFloat()));
+    QCOMPARE(bits(calGain.high1()), bits(QStringLiteral("401.977203").toFloat()));
+    QCOMPARE(bits(calGain.max1()), bits(QStringLiteral("9104.622070").toFloat()));
+
+    DensCalSlope calSlope;
+    QVERIFY(SettingsSchema::readCalSlope(root, &calSlope));
+    QCOMPARE(bits(calSlope.b0()), bits(QStringLiteral("-0.048313").toFloat()));
+    QCOMPARE(bits(calSlope.b2()), bits(QStringLiteral("0.013247").toFloat()));
+
+    DensCalTarget calReflection;
+    QVERIFY(SettingsSchema::readCalReflection(root, &calReflection));
+    QCOMPARE(bits(calReflection.loDensity()), bits(QStringLiteral("0.08").toFloat()));
+    QCOMPARE(bits(calReflection.hiReading()), bits(QStringLiteral("0.004512").toFloat()));
+
+    DensCalTarget calTransmission;
+    QVERIFY(SettingsSchema::readCalTransmission(root, &calTransmission));
+    QCOMPARE(bits(calTransmission.loDensity()), bits(0.0F));
+    QCOMPARE(bits(calTransmission.hiDensity()), bits(QStringLiteral("3.01").toFloat()));
+}
+
+void TestSettingsSchema::migrateVersion1Unset()
+{
+    // Version 1 wrote calibration that was never set as "nan"
+    QJsonObject root = readFixture(QStringLiteral("settings-v1-unset.json"));
+    QVERIFY(!root.isEmpty());
+
+    const QList<SettingsSchema::Issue> issues = SettingsSchema::load(&root);
+    QVERIFY2(issues.isEmpty(), qPrintable(SettingsSchema::formatIssues(issues)));
+
+    QVERIFY(SettingsSchema::readCalGain(root, nullptr));
+    QVERIFY(SettingsSchema::readCalSlope(root, nullptr));
+    QVERIFY(SettingsSchema::readCalReflection(root, nullptr));
+    QVERIFY(!SettingsSchema::readCalTransmission(root, nullptr));
+}
+
+void TestSettingsSchema::migrateUnversioned()
+{
+    QJsonObject root = readFixture(QStringLiteral("settings-v1.json"));
+    QJsonObject jsonHeader = root["header"].toObject();
+    jsonHeader.remove("version");
+    root["header"] = jsonHeader;
+
+    const QList<SettingsSchema::Issue> issues = SettingsSchema::load(&root);
+    QVERIFY2(issues.isEmpty(), qPrintable(SettingsSchema::formatIssues(issues)));
+    QCOMPARE(root["header"].toObject()["version"].toInt(), SettingsSchema::CurrentVersion);
+}
+
+void TestSettingsSchema::migrateThenExportExact()
+{
+    QJsonObject root = readFixture(QStringLiteral("settings-v1.json"));
+    QVERIFY(SettingsSchema::load(&root).isEmpty());
+
+    DensCalGain calGain;
+    DensCalSlope calSlope;
+    DensCalTarget calReflection;
+    DensCalTarget calTransmission;
+    QVERIFY(SettingsSchema::readCalGain(root, &calGain));
+    QVERIFY(SettingsSchema::readCalSlope(root, &calSlope));
+    QVERIFY(SettingsSchema::readCalReflection(root, &calReflection));
+    QVERIFY(SettingsSchema::readCalTransmission(root, &calTransmission));
+
+    // An upgraded file saved again in the current format keeps its values
+    QJsonObject exported = exportAndReload(calGain, calSlope, calReflection, calTransmission,
+                                           SettingsSchema::FloatExact);
+    QVERIFY(SettingsSchema::load(&exported).isEmpty());
+
+    DensCalGain exportedGain;
+    DensCalTarget exportedTransmission;
+    QVERIFY(SettingsSchema::readCalGain(exported, &exportedGain));
+    QVERIFY(SettingsSchema::readCalTransmission(exported, &exportedTransmission));
+    QCOMPARE(bits(exportedGain.med1()), bits(calGain.med1()));
+    QCOMPARE(bits(exportedGain.max0()), bits(calGain.max0()));
+    QCOMPARE(bits(exportedTransmission.loReading()), bits(calTransmission.loReading()));
+    QCOMPARE(bits(exportedTransmission.hiReading()), bits(calTransmission.hiReading()));
+}
+
+void TestSettingsSchema::migrateCurrentUnchanged()
+{
+    DensCalSlope calSlope;
+    calSlope.setB0(0.1F);
+    calSlope.setB1(0.2F);
+    calSlope.setB2(0.3F);
+
+    QJsonObject root = exportAndReload(DensCalGain(), calSlope, DensCalTarget(), DensCalTarget(),
+                                       SettingsSchema::FloatDecimal);
+    const QJsonObject original = root;
+
+    QList<SettingsSchema::Issue> issues;
+    QVERIFY(SettingsSchema::migrate(&root, &issues));
+    QVERIFY(issues.isEmpty());
+    QCOMPARE(root, original);
+}
+
+void TestSettingsSchema::migrateRejectsNewer()
+{
+    QJsonObject root = readFixture(QStringLiteral("settings-v1.json"));
+    QJsonObject jsonHeader = root["header"].toObject();
+    jsonHeader["version"] = SettingsSchema::CurrentVersion + 1;
+    root["header"] = jsonHeader;
+    const QJsonObject original = root;
+
+    QList<SettingsSchema::Issue> issues;
+    QVERIFY(!SettingsSchema::migrate(&root, &issues));
+    QCOMPARE(issues.size(), 1);
+    QCOMPARE(issues.at(0).path, QStringLiteral("header.version"));
+    QCOMPARE(root, original);
+}
+
+void TestSettingsSchema::migrateRejectsBadVersion_data()
+{
+    QTest::addColumn<QJsonValue>("version");
+
+    QTest::newRow("text") << QJsonValue(QStringLiteral("one"));
+    QTest::newRow("fraction") << QJsonValue(1.5);
+    QTest::newRow("boolean") << QJsonValue(true);
+}
+
+void TestSettingsSchema::migrateRejectsBadVersion()
+{
+    QFETCH(QJsonValue, version);
+
+    QJsonObject root = readFixture(QStringLiteral("settings-v1.json"));
+    QJsonObject jsonHeader = root["header"].toObject();
+    jsonHeader["version"] = version;
+    root["header"] = jsonHeader;
+
+    const QList<SettingsSchema::Issue> issues = SettingsSchema::load(&root);
+    QCOMPARE(issues.size(), 1);
+    QCOMPARE(issues.at(0).path, QStringLiteral("header.version"));
+}
+
+void TestSettingsSchema::validateReportsEveryIssue()
+{
+    QJsonObject root = readFixture(QStringLiteral("settings-v1.json"));
+    QVERIFY(SettingsSchema::migrate(&root, nullptr));
+
+    QJsonObject jsonCal = root["calibration"].toObject();
+    QJsonObject jsonSensor = jsonCal["sensor"].toObject();
+    QJsonObject jsonGain = jsonSensor["gain"].toObject();
+    jsonGain["M0"] = QStringLiteral("24.5");
+    jsonGain.remove("X1");
+    jsonSensor["gain"] = jsonGain;
+    QJsonObject jsonSlope = jsonSensor["slope"].toObject();
+    jsonSlope["B3"] = 0.0;
+    jsonSensor["slope"] = jsonSlope;
+    jsonCal["sensor"] = jsonSensor;
+    root["calibration"] = jsonCal;
+
+    QStringList paths;
+    const QList<SettingsSchema::Issue> issues = SettingsSchema::validate(root);
+    for (const SettingsSchema::Issue &issue : issues) {
+        paths.append(issue.path);
+    }
+    paths.sort();
+    QCOMPARE(paths, QStringList({ "calibration.sensor.gain.M0",
+                                  "calibration.sensor.gain.X1",
+                                  "calibration.sensor.slope.B3" }));
+}
+
+QTEST_GUILESS_MAIN(TestSettingsSchema)
+
+#include "tst_settingsschema.moc"
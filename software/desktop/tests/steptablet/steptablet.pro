@@ -0,0 +1,23 @@
+QT += testlib
+QT -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_steptablet
+
+SRC_DIR = ../../src
+INCLUDEPATH += $$SRC_DIR
+
+SOURCES += \
+    tst_steptablet.cpp \
+    $$SRC_DIR/cgats.cpp \
+    $$SRC_DIR/steptablet.cpp
+
+HEADERS += \
+    $$SRC_DIR/cgats.h \
+    $$SRC_DIR/steptablet.h
+
+OTHER_FILES += \
+    data/tablet11.cgats \
+    data/tablet31.csv
@@ -0,0 +1,257 @@
+#include <QtTest>
+#include <cmath>
+
+#include "steptablet.h"
+
+/*
+ * Tests for aligning captured readings to the patches of a step tablet.
+ * Readings are generated from the reference densities with a slope error,
+ * an offset and a little per-patch noise, the way the densitometer would
+ * read them before slope calibration.
+ */
+class TestStepTablet : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void fullScan();
+    void missingSteps_data();
+    void missingSteps();
+    void reversedScan_data();
+    void reversedScan();
+    void partialScan();
+    void coarserReference();
+    void wrongReference();
+    void tooManyReadings();
+    void outOfOrder();
+    void invalidReadings();
+
+private:
+    static QList<float> tablet21();
+    static QList<float> readings(const QList<float> &densities, const QList<int> &patches);
+    static QList<int> range(int first, int last);
+    static QList<float> reversed(const QList<float> &list);
+    static QList<int> reversed(const QList<int> &list);
+};
+
+QList<float> TestStepTablet::tablet21()
+{
+    return QList<float>({ 0.05F, 0.21F, 0.36F, 0.50F, 0.66F, 0.81F, 0.97F, 1.11F, 1.27F, 1.41F, 1.58F,
+                          1.72F, 1.88F, 2.03F, 2.18F, 2.33F, 2.49F, 2.64F, 2.79F, 2.95F, 3.09F });
+}
+
+QList<float> TestStepTablet::readings(const QList<float> &densities, const QList<int> &patches)
+{
+    static const float noise[] = { 0.004F, -0.006F, 0.002F, 0.008F, -0.003F, -0.008F, 0.005F };
+
+    QList<float> result;
+    for (int patch : patches) {
+        const float density = (1.03F * densities.at(patch)) + 0.02F + noise[patch % 7];
+        result.append(std::pow(10.0F, -density));
+    }
+    return result;
+}
+
+QList<int> TestStepTablet::range(int first, int last)
+{
+    QList<int> result;
+    for (int i = first; i <= last; i++) {
+        result.append(i);
+    }
+    return result;
+}
+
+QList<float> TestStepTablet::reversed(const QList<float> &list)
+{
+    QList<float> result;
+    for (float value : list) {
+        result.prepend(value);
+    }
+    return result;
+}
+
+QList<int> TestStepTablet::reversed(const QList<int> &list)
+{
+    QList<int> result;
+    for (int value : list) {
+        result.prepend(value);
+    }
+    return result;
+}
+
+void TestStepTablet::fullScan()
+{
+    const StepTablet tablet(QStringLiteral("T21"), QString(), tablet21());
+    const StepTabletAlignment alignment = tablet.align(readings(tablet21(), range(0, 20)));
+
+    QVERIFY2(alignment.valid, qPrintable(alignment.message));
+    QVERIFY(!alignment.reversed);
+    QCOMPARE(alignment.patches, range(0, 20));
+    QVERIFY(alignment.skipped.isEmpty());
+    QCOMPARE(alignment.monotonicErrors, 0);
+    QVERIFY(alignment.correlation > 0.9999F);
+    QVERIFY(alignment.maxResidual < 0.02F);
+}
+
+void TestStepTablet::missingSteps_data()
+{
+    QTest::addColumn<QList<int>>("missing");
+
+    QTest::newRow("first") << QList<int>({ 0 });
+    QTest::newRow("middle") << QList<int>({ 7 });
+    QTest::newRow("last") << QList<int>({ 20 });
+    QTest::newRow("two") << QList<int>({ 4, 13 });
+}
+
+void TestStepTablet::missingSteps()
+{
+    QFETCH(QList<int>, missing);
+
+    QList<int> patches = range(0, 20);
+    for (int patch : qAsConst(missing)) {
+        patches.removeOne(patch);
+    }
+
+    const StepTablet tablet(QStringLiteral("T21"), QString(), tablet21());
+    const StepTabletAlignment alignment = tablet.align(readings(tablet21(), patches));
+
+    QVERIFY2(alignment.valid, qPrintable(alignment.message));
+    QVERIFY(!alignment.reversed);
+    QCOMPARE(alignment.patches, patches);
+    QCOMPARE(alignment.skipped, missing);
+}
+
+void TestStepTablet::reversedScan_data()
+{
+    QTest::addColumn<QList<int>>("missing");
+
+    QTest::newRow("complete") << QList<int>();
+    QTest::newRow("first") << QList<int>({ 0 });
+    QTest::newRow("middle") << QList<int>({ 7 });
+    QTest::newRow("two") << QList<int>({ 4, 13 });
+}
+
+void TestStepTablet::reversedScan()
+{
+    QFETCH(QList<int>, missing);
+
+    QList<int> patches = range(0, 20);
+    for (int patch : qAsConst(missing)) {
+        patches.removeOne(patch);
+    }
+
+    // Captured from the dense end, so patches are reported in that order
+    const StepTablet tablet(QStringLiteral("T21"), QString(), tablet21());
+    const StepTabletAlignment alignment = tablet.align(reversed(readings(tablet21(), patches)));
+
+    QVERIFY2(alignment.valid, qPrintable(alignment.message));
+    QVERIFY(alignment.reversed);
+    QCOMPARE(alignment.patches, reversed(patches));
+    QCOMPARE(alignment.skipped, missing);
+    QCOMPARE(alignment.monotonicErrors, 0);
+}
+
+void TestStepTablet::partialScan()
+{
+    // A longer tablet, of which only the middle patches were read
+    QString errorString;
+    const StepTablet tablet = StepTablet::fromFile(QFINDTESTDATA("data/tablet31.csv"), &errorString);
+    QVERIFY2(tablet.isValid(), qPrintable(errorString));
+    QCOMPARE(tablet.serial(), QStringLiteral("tablet31"));
+    QCOMPARE(tablet.densities().size(), 31);
+
+    const QList<float> values = readings(tablet.densities(), range(5, 25));
+    StepTabletAlignment alignment = tablet.align(values);
+    QVERIFY2(alignment.valid, qPrintable(alignment.message));
+    QCOMPARE(alignment.patches, range(5, 25));
+    QCOMPARE(alignment.skipped, range(0, 4) + range(26, 30));
+
+    alignment = tablet.align(reversed(values));
+    QVERIFY2(alignment.valid, qPrintable(alignment.message));
+    QVERIFY(alignment.reversed);
+    QCOMPARE(alignment.patches, reversed(range(5, 25)));
+}
+
+void TestStepTablet::coarserReference()
+{
+    // Every other patch of the 21 step tablet, against an 11 step reference
+    QString errorString;
+    const StepTablet tablet = StepTablet::fromFile(QFINDTESTDATA("data/tablet11.cgats"), &errorString);
+    QVERIFY2(tablet.isValid(), qPrintable(errorString));
+    QCOMPARE(tablet.serial(), QStringLiteral("T11-0042"));
+    QCOMPARE(tablet.name(), QStringLiteral("11 step tablet"));
+    QCOMPARE(tablet.densities().size(), 11);
+
+    QList<int> patches;
+    for (int i = 0; i < 21; i += 2) {
+        patches.append(i);
+    }
+    const StepTabletAlignment alignment = tablet.align(readings(tablet21(), patches));
+    QVERIFY2(alignment.valid, qPrintable(alignment.message));
+    QCOMPARE(alignment.patches, range(0, 10));
+    QVERIFY(alignment.skipped.isEmpty());
+}
+
+void TestStepTablet::wrongReference()
+{
+    // Readings of the 21 step tablet, matched against the 31 step reference.
+    // The densities cover the same range, so they still correlate well, but
+    // individual readings are too far from the patches they are matched to.
+    const StepTablet tablet = StepTablet::fromFile(QFINDTESTDATA("data/tablet31.csv"));
+    QVERIFY(tablet.isValid());
+
+    const QList<float> values = readings(tablet21(), range(0, 20));
+    StepTabletAlignment alignment = tablet.align(values);
+    QVERIFY(!alignment.valid);
+    QCOMPARE(alignment.monotonicErrors, 0);
+    QVERIFY(alignment.correlation > 0.99F);
+    QVERIFY(alignment.maxResidual > 0.04F);
+    QVERIFY(alignment.message.startsWith(QStringLiteral("Readings do not match the tablet")));
+
+    alignment = tablet.align(reversed(values));
+    QVERIFY(!alignment.valid);
+    QVERIFY(alignment.reversed);
+}
+
+void TestStepTablet::tooManyReadings()
+{
+    const StepTablet tablet = StepTablet::fromFile(QFINDTESTDATA("data/tablet11.cgats"));
+    QVERIFY(tablet.isValid());
+
+    const StepTabletAlignment alignment = tablet.align(readings(tablet21(), range(0, 20)));
+    QVERIFY(!alignment.valid);
+    QCOMPARE(alignment.message, QStringLiteral("More readings (21) than tablet patches (11)"));
+    QVERIFY(alignment.patches.isEmpty());
+}
+
+void TestStepTablet::outOfOrder()
+{
+    QList<float> values = readings(tablet21(), range(0, 20));
+    std::swap(values[8], values[9]);
+
+    const StepTablet tablet(QStringLiteral("T21"), QString(), tablet21());
+    const StepTabletAlignment alignment = tablet.align(values);
+    QVERIFY(!alignment.valid);
+    QVERIFY(!alignment.reversed);
+    QCOMPARE(alignment.monotonicErrors, 1);
+    QCOMPARE(alignment.message, QStringLiteral("Readings are out of order in 1 place(s)"));
+}
+
+void TestStepTablet::invalidReadings()
+{
+    const StepTablet tablet(QStringLiteral("T21"), QString(), tablet21());
+
+    StepTabletAlignment alignment = tablet.align(readings(tablet21(), range(0, 1)));
+    QVERIFY(!alignment.valid);
+    QCOMPARE(alignment.message, QStringLiteral("At least 3 readings are required"));
+
+    QList<float> values = readings(tablet21(), range(0, 5));
+    values[3] = 0.0F;
+    alignment = tablet.align(values);
+    QVERIFY(!alignment.valid);
+    QVERIFY(alignment.message.startsWith(QStringLiteral("Invalid reading")));
+}
+
+QTEST_GUILESS_MAIN(TestStepTablet)
+
+#include "tst_steptablet.moc"
@@ -0,0 +1,34 @@
+#-------------------------------------------------------------------------------
+# Unit tests and benchmarks for the desktop application
+#
+# Build and run with:
+#   qmake tests.pro && make && make check
+#
+# The end-to-end test of the --rpc mode runs the application itself against
+# a simulated device on a pseudo-terminal, and prints the latency and
+# throughput of measurement.reading notifications. It needs Python 3 on
+# Linux or macOS, and the application built from ../densitometer.pro:
+#   make check-rpc DENSITOMETER=path/to/densitometer
+#-------------------------------------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    auditlog \
+    calreport \
+    cgats \
+    crashreport \
+    densinterface \
+    firmwareimage \
+    qcevaluator \
+    readingtransform \
+    settingsschema \
+    steptablet \
+    undocommands \
+    workspace
+
+unix {
+    check_rpc.target = check-rpc
+    check_rpc.commands = python3 $$PWD/rpc/rpc_pty_test.py $(DENSITOMETER)
+    QMAKE_EXTRA_TARGETS += check_rpc
+}
@@ -0,0 +1,475 @@
+#include <QtTest>
+#include <QLoggingCategory>
+#include <QUndoStack>
+
+#include "densinterface.h"
+#include "denstransport.h"
+#include "undocommands.h"
+#include "util.h"
+
+/*
+ * Tests for the undo commands of the measurement table and the calibration
+ * edits. Table commands restore into a snapshot held by the test, the way
+ * MainWindow restores into its table model. Calibration commands write to
+ * a device on the other end of an in-process pipe, where the test reads
+ * back the commands they send.
+ */
+class TestUndoCommands : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void measAddReading();
+    void measDeleteRows();
+    void measMergedEdits();
+    void measEditsOfDifferentCells();
+    void measEditReverted();
+    void calGain();
+    void calSlope();
+    void calLight();
+    void calReflection();
+    void calTransmission();
+    void calNoPreviousValue();
+    void calDisconnected();
+
+private:
+    bool connectDevice();
+    QByteArray readDeviceLine();
+    bool deviceIdle();
+    void pushMeas(const QString &text, const MeasTableState &after, const QString &mergeKey = QString());
+
+    static MeasTableRow makeRow(const QString &type, const QString &value);
+    static MeasTableState makeState(const QVector<MeasTableRow> &rows, int currentRow);
+    static QByteArray gainLine(const DensCalGain &calGain);
+    static QByteArray targetLine(const QString &action, const DensCalTarget &calTarget);
+    static DensCalGain makeGain(float scale);
+    static DensCalTarget makeTarget(float hiDensity, float hiReading);
+
+    DensInterface *densInterface_ = nullptr;
+    DensPipeTransport *host_ = nullptr;
+    DensPipeTransport *device_ = nullptr;
+    QUndoStack *stack_ = nullptr;
+    MeasTableState table_;
+    int restoreCount_ = 0;
+};
+
+void TestUndoCommands::initTestCase()
+{
+    QLoggingCategory::setFilterRules(QStringLiteral("*.debug=false"));
+}
+
+void TestUndoCommands::init()
+{
+    const QPair<DensPipeTransport *, DensPipeTransport *> pair = DensPipeTransport::createPair(this);
+    host_ = pair.first;
+    device_ = pair.second;
+    QVERIFY(host_->open());
+    QVERIFY(device_->open());
+    densInterface_ = new DensInterface(this);
+    QVERIFY(connectDevice());
+
+    stack_ = new QUndoStack(this);
+    table_ = makeState(QVector<MeasTableRow>(), -1);
+    restoreCount_ = 0;
+}
+
+void TestUndoCommands::cleanup()
+{
+    delete stack_;
+    densInterface_->disconnectFromDevice();
+    delete densInterface_;
+    delete host_;
+    delete device_;
+    stack_ = nullptr;
+    densInterface_ = nullptr;
+    host_ = nullptr;
+    device_ = nullptr;
+}
+
+bool TestUndoCommands::connectDevice()
+{
+    if (!densInterface_->connectToDevice(host_)) { return false; }
+
+    if (!QTest::qWaitFor([this]() { return device_->canReadLine(); }, 1000)) { return false; }
+    if (device_->readLine() != "GS V\r\n") { return false; }
+    device_->write("GS V,\"Printalyzer Densitometer\",\"v0.0.0-test\",3,7\r\n");
+
+    return QTest::qWaitFor([this]() { return densInterface_->connected(); }, 1000);
+}
+
+QByteArray TestUndoCommands::readDeviceLine()
+{
+    if (!QTest::qWaitFor([this]() { return device_->canReadLine(); }, 1000)) { return QByteArray(); }
+    return device_->readLine();
+}
+
+bool TestUndoCommands::deviceIdle()
+{
+    QTest::qWait(50);
+    return !device_->canReadLine();
+}
+
+void TestUndoCommands::pushMeas(const QString &text, const MeasTableState &after, const QString &mergeKey)
+{
+    // Made to the table first, then recorded, as MainWindow does
+    const MeasTableState before = table_;
+    table_ = after;
+    stack_->push(new MeasTableCommand(text, before, after, [this](const MeasTableState &state) {
+        table_ = state;
+        restoreCount_++;
+    }, mergeKey));
+}
+
+MeasTableRow TestUndoCommands::makeRow(const QString &type, const QString &value)
+{
+    MeasTableRow row;
+    row.type = type;
+    row.value = value;
+    row.offset = QStringLiteral("0.00");
+    row.flagged = false;
+    row.time = QDateTime(QDate(2024, 3, 1), QTime(12, 0), Qt::UTC);
+    return row;
+}
+
+MeasTableState TestUndoCommands::makeState(const QVector<MeasTableRow> &rows, int currentRow)
+{
+    MeasTableState state;
+    state.rows = rows;
+    state.currentRow = currentRow;
+    return state;
+}
+
+QByteArray TestUndoCommands::gainLine(const DensCalGain &calGain)
+{
+    const QStringList args = QStringList()
+            << util::encode_f32(calGain.med0()) << util::encode_f32(calGain.med1())
+            << util::encode_f32(calGain.high0()) << util::encode_f32(calGain.high1())
+            << util::encode_f32(calGain.max0()) << util::encode_f32(calGain.max1());
+    return "SC GAIN," + args.join(QLatin1Char(',')).toLatin1() + "\r\n";
+}
+
+QByteArray TestUndoCommands::targetLine(const QString &action, const DensCalTarget &calTarget)
+{
+    const QStringList args = QStringList()
+            << util::encode_f32(calTarget.loDensity()) << util::encode_f32(calTarget.loReading())
+            << util::encode_f32(calTarget.hiDensity()) << util::encode_f32(calTarget.hiReading());
+    return "SC " + action.toLatin1() + "," + args.join(QLatin1Char(',')).toLatin1() + "\r\n";
+}
+
+DensCalGain TestUndoCommands::makeGain(float scale)
+{
+    DensCalGain calGain;
+    calGain.setLow0(1.0F);
+    calGain.setLow1(1.0F);
+    calGain.setMed0(24.8F * scale);
+    calGain.setMed1(25.2F * scale);
+    calGain.setHigh0(404.0F * scale);
+    calGain.setHigh1(406.0F * scale);
+    calGain.setMax0(9330.0F * scale);
+    calGain.setMax1(9900.0F * scale);
+    return calGain;
+}
+
+DensCalTarget TestUndoCommands::makeTarget(float hiDensity, float hiReading)
+{
+    DensCalTarget calTarget;
+    calTarget.setLoDensity(0.08F);
+    calTarget.setLoReading(42.5F);
+    calTarget.setHiDensity(hiDensity);
+    calTarget.setHiReading(hiReading);
+    return calTarget;
+}
+
+void TestUndoCommands::measAddReading()
+{
+    const MeasTableState empty = table_;
+    const MeasTableState one = makeState(QVector<MeasTableRow>() << makeRow("R", "0.12"), 0);
+    const MeasTableState two = makeState(QVector<MeasTableRow>() << makeRow("R", "0.12") << makeRow("T", "1.85"), 1);
+
+    pushMeas(QStringLiteral("Add Reading"), one);
+    pushMeas(QStringLiteral("Add Reading"), two);
+
+    // Pushing does not restore anything, since the table already has the change
+    QCOMPARE(restoreCount_, 0);
+    QCOMPARE(stack_->count(), 2);
+    QCOMPARE(stack_->undoText(), QStringLiteral("Add Reading"));
+
+    stack_->undo();
+    QVERIFY(table_ == one);
+    stack_->undo();
+    QVERIFY(table_ == empty);
+    QVERIFY(!stack_->canUndo());
+
+    stack_->redo();
+    QVERIFY(table_ == one);
+    stack_->redo();
+    QVERIFY(table_ == two);
+    QVERIFY(!stack_->canRedo());
+    QCOMPARE(restoreCount_, 4);
+}
+
+void TestUndoCommands::measDeleteRows()
+{
+    QVector<MeasTableRow> rows;
+    for (int i = 0; i < 5; i++) {
+        rows.append(makeRow("R", QString::number(0.1 * (i + 1), 'f', 2)));
+    }
+    rows[2].flagged = true;
+    rows[2].flaggedToolTip = QStringLiteral("Outside tolerance");
+    rows[3].computed.insert(QStringLiteral("Delta"), QStringLiteral("0.05"));
+    const MeasTableState full = makeState(rows, 3);
+    pushMeas(QStringLiteral("Add Readings"), full);
+
+    QVector<MeasTableRow> remaining = rows;
+    remaining.remove(1, 3);
+    pushMeas(QStringLiteral("Delete Readings"), makeState(remaining, 1));
+
+    // Every field of the deleted rows comes back, along with the current row
+    stack_->undo();
+    QVERIFY(table_ == full);
+    QCOMPARE(table_.currentRow, 3);
+    QVERIFY(table_.rows.at(2).flagged);
+    QCOMPARE(table_.rows.at(3).computed.value(QStringLiteral("Delta")), QStringLiteral("0.05"));
+
+    stack_->redo();
+    QCOMPARE(table_.rows.size(), 2);
+    QCOMPARE(table_.currentRow, 1);
+    QCOMPARE(table_.rows.at(1).value, QStringLiteral("0.50"));
+}
+
+void TestUndoCommands::measMergedEdits()
+{
+    const MeasTableState original = makeState(QVector<MeasTableRow>() << makeRow("R", "0.12") << makeRow("R", "0.34"), 1);
+    pushMeas(QStringLiteral("Add Readings"), original);
+
+    // Typing into the same cell several times is a single undo step
+    MeasTableState edited = original;
+    const QStringList values = QStringList() << "0.3" << "0.35" << "0.36";
+    for (const QString &value : values) {
+        edited.rows[1].value = value;
+        pushMeas(QStringLiteral("Edit Reading"), edited, QStringLiteral("edit 1,1"));
+    }
+    QCOMPARE(stack_->count(), 2);
+
+    const MeasTableCommand *command = static_cast<const MeasTableCommand *>(stack_->command(1));
+    QVERIFY(command->before() == original);
+    QVERIFY(command->after() == edited);
+
+    stack_->undo();
+    QVERIFY(table_ == original);
+    stack_->redo();
+    QCOMPARE(table_.rows.at(1).value, QStringLiteral("0.36"));
+
+    // A command without a merge key is never merged
+    MeasTableState added = edited;
+    added.rows.append(makeRow("T", "2.10"));
+    pushMeas(QStringLiteral("Add Reading"), added);
+    QCOMPARE(stack_->count(), 3);
+
+    // An edit after an unrelated change starts a new step, even for the same cell
+    MeasTableState editedAgain = added;
+    editedAgain.rows[1].value = QStringLiteral("0.40");
+    pushMeas(QStringLiteral("Edit Reading"), editedAgain, QStringLiteral("edit 1,1"));
+    QCOMPARE(stack_->count(), 4);
+
+    stack_->undo();
+    QVERIFY(table_ == added);
+    stack_->undo();
+    QVERIFY(table_ == edited);
+    stack_->undo();
+    QVERIFY(table_ == original);
+}
+
+void TestUndoCommands::measEditsOfDifferentCells()
+{
+    const MeasTableState original = makeState(QVector<MeasTableRow>() << makeRow("R", "0.12") << makeRow("R", "0.34"), 0);
+    pushMeas(QStringLiteral("Add Readings"), original);
+
+    MeasTableState first = original;
+    first.rows[0].value = QStringLiteral("0.13");
+    pushMeas(QStringLiteral("Edit Reading"), first, QStringLiteral("edit 0,1"));
+
+    MeasTableState second = first;
+    second.rows[0].offset = QStringLiteral("0.01");
+    pushMeas(QStringLiteral("Edit Reading"), second, QStringLiteral("edit 0,2"));
+
+    MeasTableState third = second;
+    third.rows[1].value = QStringLiteral("0.33");
+    pushMeas(QStringLiteral("Edit Reading"), third, QStringLiteral("edit 1,1"));
+
+    QCOMPARE(stack_->count(), 4);
+    stack_->undo();
+    QVERIFY(table_ == second);
+    stack_->undo();
+    QVERIFY(table_ == first);
+    stack_->undo();
+    QVERIFY(table_ == original);
+}
+
+void TestUndoCommands::measEditReverted()
+{
+    const MeasTableState original = makeState(QVector<MeasTableRow>() << makeRow("R", "0.12"), 0);
+    pushMeas(QStringLiteral("Add Reading"), original);
+
+    // Changing a cell and then typing its old value back leaves nothing to undo
+    MeasTableState edited = original;
+    edited.rows[0].value = QStringLiteral("0.9");
+    pushMeas(QStringLiteral("Edit Reading"), edited, QStringLiteral("edit 0,1"));
+    QCOMPARE(stack_->count(), 2);
+
+    pushMeas(QStringLiteral("Edit Reading"), original, QStringLiteral("edit 0,1"));
+    QCOMPARE(stack_->count(), 1);
+    QCOMPARE(stack_->undoText(), QStringLiteral("Add Reading"));
+    QVERIFY(table_ == original);
+}
+
+void TestUndoCommands::calGain()
+{
+    const DensCalGain previous = makeGain(1.0F);
+    const DensCalGain value = makeGain(1.02F);
+    QSignalSpy writeSpy(densInterface_, &DensInterface::settingsWriteSent);
+
+    // Pushing the command sends the new value
+    stack_->push(new CalSetCommand<DensCalGain>(
+                     QStringLiteral("Set Sensor Gain"), densInterface_, &DensInterface::sendSetCalGain,
+                     previous, value));
+    QCOMPARE(readDeviceLine(), gainLine(value));
+
+    // Undo writes back the value that was read from the device
+    stack_->undo();
+    QCOMPARE(readDeviceLine(), gainLine(previous));
+
+    stack_->redo();
+    QCOMPARE(readDeviceLine(), gainLine(value));
+    QVERIFY(deviceIdle());
+
+    // Each write is recorded in the audit log
+    QCOMPARE(writeSpy.count(), 3);
+    QCOMPARE(writeSpy.at(1).at(0).toString(), QStringLiteral("GAIN"));
+    QCOMPARE(stack_->count(), 1);
+}
+
+void TestUndoCommands::calSlope()
+{
+    DensCalSlope previous;
+    previous.setB0(0.0F);
+    previous.setB1(1.0F);
+    previous.setB2(0.0F);
+    DensCalSlope value;
+    value.setB0(-0.02F);
+    value.setB1(0.98F);
+    value.setB2(0.01F);
+
+    const QByteArray previousLine = "SC SLOPE," + QStringList({ util::encode_f32(0.0F), util::encode_f32(1.0F),
+                                                                util::encode_f32(0.0F) }).join(',').toLatin1() + "\r\n";
+    const QByteArray valueLine = "SC SLOPE," + QStringList({ util::encode_f32(-0.02F), util::encode_f32(0.98F),
+                                                             util::encode_f32(0.01F) }).join(',').toLatin1() + "\r\n";
+
+    stack_->push(new CalSetCommand<DensCalSlope>(
+                     QStringLiteral("Set Slope Calibration"), densInterface_, &DensInterface::sendSetCalSlope,
+                     previous, value));
+    QCOMPARE(readDeviceLine(), valueLine);
+    stack_->undo();
+    QCOMPARE(readDeviceLine(), previousLine);
+    stack_->redo();
+    QCOMPARE(readDeviceLine(), valueLine);
+}
+
+void TestUndoCommands::calLight()
+{
+    DensCalLight previous;
+    previous.setReflectionValue(128);
+    previous.setTransmissionValue(120);
+    DensCalLight value;
+    value.setReflectionValue(128);
+    value.setTransmissionValue(96);
+
+    stack_->push(new CalSetCommand<DensCalLight>(
+                     QStringLiteral("Set Measurement Light"), densInterface_, &DensInterface::sendSetCalLight,
+                     previous, value));
+    QCOMPARE(readDeviceLine(), QByteArray("SC LIGHT,128,96\r\n"));
+    stack_->undo();
+    QCOMPARE(readDeviceLine(), QByteArray("SC LIGHT,128,120\r\n"));
+    stack_->redo();
+    QCOMPARE(readDeviceLine(), QByteArray("SC LIGHT,128,96\r\n"));
+}
+
+void TestUndoCommands::calReflection()
+{
+    const DensCalTarget previous = makeTarget(1.95F, 0.52F);
+    const DensCalTarget value = makeTarget(2.05F, 0.41F);
+
+    stack_->push(new CalSetCommand<DensCalTarget>(
+                     QStringLiteral("Set Reflection Calibration"), densInterface_, &DensInterface::sendSetCalReflection,
+                     previous, value));
+    QCOMPARE(readDeviceLine(), targetLine("REFL", value));
+    stack_->undo();
+    QCOMPARE(readDeviceLine(), targetLine("REFL", previous));
+    stack_->redo();
+    QCOMPARE(readDeviceLine(), targetLine("REFL", value));
+}
+
+void TestUndoCommands::calTransmission()
+{
+    DensCalTarget previous = makeTarget(3.01F, 0.04F);
+    previous.setLoDensity(0.0F);
+    DensCalTarget value = makeTarget(2.98F, 0.05F);
+    value.setLoDensity(0.0F);
+
+    // Two edits in a row are separate steps, and undo in order
+    const DensCalTarget last = makeTarget(3.10F, 0.03F);
+    stack_->push(new CalSetCommand<DensCalTarget>(
+                     QStringLiteral("Set Transmission Calibration"), densInterface_, &DensInterface::sendSetCalTransmission,
+                     previous, value));
+    QCOMPARE(readDeviceLine(), targetLine("TRAN", value));
+    stack_->push(new CalSetCommand<DensCalTarget>(
+                     QStringLiteral("Set Transmission Calibration"), densInterface_, &DensInterface::sendSetCalTransmission,
+                     value, last));
+    QCOMPARE(readDeviceLine(), targetLine("TRAN", last));
+    QCOMPARE(stack_->count(), 2);
+
+    stack_->undo();
+    QCOMPARE(readDeviceLine(), targetLine("TRAN", value));
+    stack_->undo();
+    QCOMPARE(readDeviceLine(), targetLine("TRAN", previous));
+    QVERIFY(deviceIdle());
+}
+
+void TestUndoCommands::calNoPreviousValue()
+{
+    // The value was never read back from the device, so there is nothing to undo to
+    const DensCalGain value = makeGain(1.0F);
+    stack_->push(new CalSetCommand<DensCalGain>(
+                     QStringLiteral("Set Sensor Gain"), densInterface_, &DensInterface::sendSetCalGain,
+                     DensCalGain(), value));
+    QCOMPARE(readDeviceLine(), gainLine(value));
+
+    stack_->undo();
+    QVERIFY(deviceIdle());
+    QCOMPARE(stack_->count(), 0);
+}
+
+void TestUndoCommands::calDisconnected()
+{
+    const DensCalGain previous = makeGain(1.0F);
+    const DensCalGain value = makeGain(1.02F);
+    stack_->push(new CalSetCommand<DensCalGain>(
+                     QStringLiteral("Set Sensor Gain"), densInterface_, &DensInterface::sendSetCalGain,
+                     previous, value));
+    QCOMPARE(readDeviceLine(), gainLine(value));
+
+    // Nothing is written once the device is gone, and the command is dropped
+    densInterface_->disconnectFromDevice();
+    QVERIFY(!densInterface_->connected());
+    stack_->undo();
+    QVERIFY(deviceIdle());
+    QCOMPARE(stack_->count(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestUndoCommands)
+
+#include "tst_undocommands.moc"
@@ -0,0 +1,430 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+
+#include "workspace.h"
+
+/*
+ * Tests for workspace files: saving and loading sessions, writes that
+ * leave the previous file intact when they fail, autosave and recovery,
+ * and how long a workspace with hundreds of thousands of readings
+ * takes to open.
+ */
+class TestWorkspace : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+
+    void roundTrip();
+    void unaccessedSessionsCopied();
+    void loadIsLazy();
+    void loadFailureKeepsWorkspace();
+    void truncatedFile();
+    void failedSaveKeepsFile();
+    void autosaveAndRecover();
+
+    void loadAtScale();
+    void loadAtScaleBenchmark();
+    void sessionAtScaleBenchmark();
+
+private:
+    static QVector<MeasTableRow> makeRows(int count, int seed);
+    static QByteArray readAll(const QString &fileName);
+    QString largeWorkspace();
+
+    QTemporaryDir tempDir_;
+    QString largeFileName_;
+};
+
+namespace
+{
+// Large enough to be well past the size of any real job
+const int LARGE_SESSIONS = 25;
+const int LARGE_ROWS = 10000;
+
+// Opening the index should take milliseconds, so this only fails
+// if session contents start being read on load
+const qint64 LARGE_LOAD_LIMIT_MS = 1000;
+}
+
+void TestWorkspace::initTestCase()
+{
+    QVERIFY(tempDir_.isValid());
+
+    // Keep the recovery file away from that of a real installation
+    QStandardPaths::setTestModeEnabled(true);
+    QCoreApplication::setOrganizationName(QStringLiteral("tst_workspace"));
+    QCoreApplication::setApplicationName(QStringLiteral("tst_workspace"));
+}
+
+void TestWorkspace::cleanup()
+{
+    Workspace::discardRecovery();
+}
+
+QVector<MeasTableRow> TestWorkspace::makeRows(int count, int seed)
+{
+    const QDateTime start = QDateTime::fromString(QStringLiteral("2022-11-05T14:32:10.125Z"), Qt::ISODateWithMs);
+
+    QVector<MeasTableRow> rows;
+    rows.reserve(count);
+    for (int i = 0; i < count; i++) {
+        const float density = ((i + seed) % 400) / 100.0F;
+        MeasTableRow row = MeasTableRow();
+        row.type = (i % 2) ? QStringLiteral("T") : QStringLiteral("R");
+        row.value = QString::number(density, 'f', 2);
+        row.offset = QStringLiteral("0.08");
+        row.uncertainty = QStringLiteral("0.01");
+        row.raw = QString::number(density * 1000.0F, 'f', 6);
+        row.corrected = QString::number(density * 1001.0F, 'f', 6);
+        if (i % 97 == 0) {
+            row.flagged = true;
+            row.flaggedToolTip = QStringLiteral("Outside tolerance");
+        }
+        row.computed.insert(QStringLiteral("dR"), QString::number(density - 0.08F, 'f', 2));
+        row.time = start.addMSecs(static_cast<qint64>(i) * 1500);
+        rows.append(row);
+    }
+    return rows;
+}
+
+QByteArray TestWorkspace::readAll(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) { return QByteArray(); }
+    return file.readAll();
+}
+
+QString TestWorkspace::largeWorkspace()
+{
+    if (!largeFileName_.isEmpty()) { return largeFileName_; }
+
+    Workspace workspace;
+    for (int i = 0; i < LARGE_SESSIONS; i++) {
+        const int index = (i == 0) ? 0 : workspace.addSession(QStringLiteral("Session %1").arg(i + 1));
+        QSharedPointer<WorkspaceSession> session = workspace.session(index);
+        session->columns = QStringList() << QStringLiteral("dR");
+        session->rows = makeRows(LARGE_ROWS, i);
+    }
+
+    const QString fileName = tempDir_.filePath(QStringLiteral("large.pdw"));
+    QString errorString;
+    if (!workspace.save(fileName, &errorString)) {
+        qWarning() << "Unable to write large workspace:" << errorString;
+        return QString();
+    }
+    largeFileName_ = fileName;
+    return largeFileName_;
+}
+
+void TestWorkspace::roundTrip()
+{
+    DensCalGain calGain;
+    calGain.setLow0(1.0F);
+    calGain.setLow1(1.0F);
+    calGain.setMed0(16.5F);
+    calGain.setMed1(16.75F);
+    calGain.setHigh0(256.25F);
+    calGain.setHigh1(257.5F);
+    calGain.setMax0(490.0F);
+    calGain.setMax1(495.125F);
+    DensCalTarget calReflection;
+    calReflection.setLoDensity(0.08F);
+    calReflection.setLoReading(0.3375F);
+    calReflection.setHiDensity(1.46F);
+    calReflection.setHiReading(0.01425F);
+
+    Workspace workspace;
+    QSharedPointer<WorkspaceSession> first = workspace.session(0);
+    first->notes = QStringLiteral("Step wedge, \"as received\"\nSecond line");
+    first->deviceName = QStringLiteral("Printalyzer Densitometer");
+    first->deviceVersion = QStringLiteral("v0.7.0");
+    first->uniqueId = QStringLiteral("0039003A3235510B37333439");
+    first->calibration = Workspace::calibrationToJson(calGain, DensCalSlope(), calReflection, DensCalTarget());
+    first->columns = QStringList() << QStringLiteral("dR");
+    first->rows = makeRows(20, 0);
+
+    // Columns only found in the rows are kept, and trailing empty rows
+    // are padding that is not saved
+    first->rows[3].computed.insert(QStringLiteral("Extra"), QStringLiteral("x"));
+    first->rows.append(MeasTableRow());
+    first->rows.append(MeasTableRow());
+
+    const int second = workspace.addSession(QStringLiteral("Empty"));
+    workspace.setCurrentSession(second);
+
+    const QString fileName = tempDir_.filePath(QStringLiteral("roundtrip.pdw"));
+    QString errorString;
+    QVERIFY2(workspace.save(fileName, &errorString), qPrintable(errorString));
+    QVERIFY(!workspace.isModified());
+    QCOMPARE(workspace.fileName(), fileName);
+
+    Workspace loaded;
+    QVERIFY2(loaded.load(fileName, &errorString), qPrintable(errorString));
+    QCOMPARE(loaded.fileName(), fileName);
+    QVERIFY(!loaded.isModified());
+    QCOMPARE(loaded.sessionCount(), 2);
+    QCOMPARE(loaded.currentSession(), 1);
+    QCOMPARE(loaded.sessionName(0), QStringLiteral("Session 1"));
+    QCOMPARE(loaded.sessionName(1), QStringLiteral("Empty"));
+    QCOMPARE(loaded.sessionReadingCount(0), 20);
+    QCOMPARE(loaded.sessionReadingCount(1), 0);
+
+    QSharedPointer<WorkspaceSession> reread = loaded.session(0, &errorString);
+    QVERIFY2(reread, qPrintable(errorString));
+    QCOMPARE(reread->name, first->name);
+    QCOMPARE(reread->created, first->created);
+    QCOMPARE(reread->notes, first->notes);
+    QCOMPARE(reread->deviceName, first->deviceName);
+    QCOMPARE(reread->deviceVersion, first->deviceVersion);
+    QCOMPARE(reread->uniqueId, first->uniqueId);
+    QCOMPARE(reread->calibration, first->calibration);
+    QCOMPARE(reread->columns, QStringList() << QStringLiteral("dR") << QStringLiteral("Extra"));
+    QCOMPARE(reread->rows.size(), 20);
+    QVERIFY(reread->rows == first->rows.mid(0, 20));
+
+    QSharedPointer<WorkspaceSession> empty = loaded.session(1, &errorString);
+    QVERIFY2(empty, qPrintable(errorString));
+    QVERIFY(empty->rows.isEmpty());
+}
+
+void TestWorkspace::unaccessedSessionsCopied()
+{
+    Workspace workspace;
+    workspace.session(0)->rows = makeRows(50, 1);
+    workspace.session(workspace.addSession(QStringLiteral("Second")))->rows = makeRows(30, 2);
+    workspace.session(workspace.addSession(QStringLiteral("Third")))->rows = makeRows(10, 3);
+
+    const QString fileName = tempDir_.filePath(QStringLiteral("copied.pdw"));
+    QString errorString;
+    QVERIFY2(workspace.save(fileName, &errorString), qPrintable(errorString));
+
+    // Change one session, rename another without reading it, and leave
+    // the third untouched
+    Workspace loaded;
+    QVERIFY2(loaded.load(fileName, &errorString), qPrintable(errorString));
+    loaded.session(1)->rows.append(makeRows(1, 4));
+    loaded.renameSession(2, QStringLiteral("Renamed"));
+    QVERIFY(loaded.isModified());
+
+    const QString otherFileName = tempDir_.filePath(QStringLiteral("copied-other.pdw"));
+    QVERIFY2(loaded.save(otherFileName, &errorString), qPrintable(errorString));
+
+    Workspace reloaded;
+    QVERIFY2(reloaded.load(otherFileName, &errorString), qPrintable(errorString));
+    QCOMPARE(reloaded.sessionCount(), 3);
+    QCOMPARE(reloaded.sessionReadingCount(0), 50);
+    QCOMPARE(reloaded.sessionReadingCount(1), 31);
+    QCOMPARE(reloaded.sessionName(2), QStringLiteral("Renamed"));
+    QVERIFY(reloaded.session(0)->rows == makeRows(50, 1));
+    QVERIFY(reloaded.session(1)->rows == makeRows(30, 2) + makeRows(1, 4));
+    QVERIFY(reloaded.session(2)->rows == makeRows(10, 3));
+    QCOMPARE(reloaded.session(2)->name, QStringLiteral("Renamed"));
+
+    // Saving over the file the untouched session is copied from also works
+    QVERIFY2(loaded.save(otherFileName, &errorString), qPrintable(errorString));
+    Workspace resaved;
+    QVERIFY2(resaved.load(otherFileName, &errorString), qPrintable(errorString));
+    QVERIFY(resaved.session(2)->rows == makeRows(10, 3));
+}
+
+void TestWorkspace::loadIsLazy()
+{
+    Workspace workspace;
+    workspace.session(0)->rows = makeRows(10, 0);
+    workspace.session(workspace.addSession(QStringLiteral("Second")))->rows = makeRows(10, 1);
+    const QString fileName = tempDir_.filePath(QStringLiteral("lazy.pdw"));
+    QString errorString;
+    QVERIFY2(workspace.save(fileName, &errorString), qPrintable(errorString));
+
+    // Overwrite the contents of the second session, which is the last
+    // thing in the file, without changing its length
+    QByteArray data = readAll(fileName);
+    const int start = data.lastIndexOf("\n{") + 1;
+    QVERIFY(start > 0);
+    data.replace(start, data.size() - start - 1, QByteArray(data.size() - start - 1, 'x'));
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(data);
+    file.close();
+
+    // Nothing is noticed until that session is read
+    Workspace loaded;
+    QVERIFY2(loaded.load(fileName, &errorString), qPrintable(errorString));
+    QCOMPARE(loaded.sessionReadingCount(1), 10);
+    QVERIFY(loaded.session(0));
+    QVERIFY(!loaded.session(1, &errorString));
+    QVERIFY(errorString.startsWith(QStringLiteral("Session is invalid")));
+}
+
+void TestWorkspace::loadFailureKeepsWorkspace()
+{
+    Workspace workspace;
+    workspace.session(0)->rows = makeRows(5, 0);
+    const QString fileName = tempDir_.filePath(QStringLiteral("keep.pdw"));
+    QString errorString;
+    QVERIFY2(workspace.save(fileName, &errorString), qPrintable(errorString));
+
+    const QString otherFileName = tempDir_.filePath(QStringLiteral("keep-other.pdw"));
+    QFile file(otherFileName);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write("SAMPLE_ID,D_VIS\n1,0.25\n");
+    file.close();
+
+    QVERIFY(!workspace.load(otherFileName, &errorString));
+    QCOMPARE(errorString, QStringLiteral("Not a workspace file"));
+    QCOMPARE(workspace.fileName(), fileName);
+    QCOMPARE(workspace.sessionCount(), 1);
+    QCOMPARE(workspace.sessionReadingCount(0), 5);
+}
+
+void TestWorkspace::truncatedFile()
+{
+    Workspace workspace;
+    workspace.session(0)->rows = makeRows(5, 0);
+    workspace.session(workspace.addSession(QStringLiteral("Last")))->rows = makeRows(5, 1);
+    const QString fileName = tempDir_.filePath(QStringLiteral("truncated.pdw"));
+    QString errorString;
+    QVERIFY2(workspace.save(fileName, &errorString), qPrintable(errorString));
+
+    QFile file(fileName);
+    QVERIFY(file.resize(file.size() - 2));
+
+    Workspace loaded;
+    QVERIFY(!loaded.load(fileName, &errorString));
+    QCOMPARE(errorString, QStringLiteral("Session \"Last\" is truncated"));
+
+    QVERIFY(file.resize(64));
+    QVERIFY(!loaded.load(fileName, &errorString));
+    QCOMPARE(errorString, QStringLiteral("Workspace index is truncated"));
+}
+
+void TestWorkspace::failedSaveKeepsFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString sourceFileName = dir.filePath(QStringLiteral("source.pdw"));
+    const QString targetFileName = dir.filePath(QStringLiteral("target.pdw"));
+    QString errorString;
+
+    Workspace target;
+    target.session(0)->rows = makeRows(5, 0);
+    QVERIFY2(target.save(targetFileName, &errorString), qPrintable(errorString));
+    const QByteArray targetData = readAll(targetFileName);
+
+    Workspace source;
+    source.session(0)->rows = makeRows(100, 1);
+    source.session(source.addSession(QStringLiteral("Second")))->rows = makeRows(100, 2);
+    QVERIFY2(source.save(sourceFileName, &errorString), qPrintable(errorString));
+
+    // Cut the file off after loading, so the save runs out of data part
+    // way through copying the sessions that were never read
+    Workspace loaded;
+    QVERIFY2(loaded.load(sourceFileName, &errorString), qPrintable(errorString));
+    loaded.renameSession(0, QStringLiteral("Renamed"));
+    QFile sourceFile(sourceFileName);
+    QVERIFY(sourceFile.resize(sourceFile.size() - 100));
+
+    errorString.clear();
+    QVERIFY(!loaded.save(targetFileName, &errorString));
+    QVERIFY(!errorString.isEmpty());
+
+    // The file being replaced is untouched, with nothing left beside it
+    QCOMPARE(readAll(targetFileName), targetData);
+    QCOMPARE(QDir(dir.path()).entryList(QDir::Files | QDir::Hidden),
+             QStringList() << QStringLiteral("source.pdw") << QStringLiteral("target.pdw"));
+    QCOMPARE(loaded.fileName(), sourceFileName);
+    QVERIFY(loaded.isModified());
+}
+
+void TestWorkspace::autosaveAndRecover()
+{
+    Workspace workspace;
+    workspace.session(0)->rows = makeRows(5, 0);
+    const QString fileName = tempDir_.filePath(QStringLiteral("autosave.pdw"));
+    QString errorString;
+    QVERIFY2(workspace.save(fileName, &errorString), qPrintable(errorString));
+    const QByteArray savedData = readAll(fileName);
+
+    workspace.session(0)->rows.append(makeRows(2, 1));
+    workspace.setModified();
+    QVERIFY2(workspace.autosave(&errorString), qPrintable(errorString));
+
+    // Autosaves never touch the workspace's own file
+    QVERIFY(QFile::exists(Workspace::recoveryFileName()));
+    QCOMPARE(readAll(fileName), savedData);
+    QVERIFY(workspace.isModified());
+
+    Workspace recovered;
+    QVERIFY2(recovered.recover(&errorString), qPrintable(errorString));
+    QCOMPARE(recovered.fileName(), fileName);
+    QVERIFY(recovered.isModified());
+    QCOMPARE(recovered.sessionReadingCount(0), 7);
+    QVERIFY(recovered.session(0)->rows == makeRows(5, 0) + makeRows(2, 1));
+
+    // Once the changes are saved, the recovery file is no longer needed
+    QVERIFY2(recovered.save(recovered.fileName(), &errorString), qPrintable(errorString));
+    QVERIFY(!QFile::exists(Workspace::recoveryFileName()));
+    QVERIFY(!recovered.isModified());
+}
+
+void TestWorkspace::loadAtScale()
+{
+    const QString fileName = largeWorkspace();
+    QVERIFY(!fileName.isEmpty());
+
+    QElapsedTimer timer;
+    timer.start();
+    Workspace workspace;
+    QString errorString;
+    QVERIFY2(workspace.load(fileName, &errorString), qPrintable(errorString));
+    const qint64 elapsed = timer.elapsed();
+
+    // Reading counts come from the index, without reading any sessions
+    int readingCount = 0;
+    for (int i = 0; i < workspace.sessionCount(); i++) {
+        readingCount += workspace.sessionReadingCount(i);
+    }
+    QCOMPARE(workspace.sessionCount(), LARGE_SESSIONS);
+    QCOMPARE(readingCount, LARGE_SESSIONS * LARGE_ROWS);
+
+    QVERIFY2(elapsed < LARGE_LOAD_LIMIT_MS,
+             qPrintable(QStringLiteral("Loading %1 readings from %2 bytes took %3 ms")
+                        .arg(readingCount).arg(QFileInfo(fileName).size()).arg(elapsed)));
+
+    // Only the session that is read is parsed, and it comes back whole
+    QSharedPointer<WorkspaceSession> session = workspace.session(LARGE_SESSIONS - 1, &errorString);
+    QVERIFY2(session, qPrintable(errorString));
+    QVERIFY(session->rows == makeRows(LARGE_ROWS, LARGE_SESSIONS - 1));
+}
+
+void TestWorkspace::loadAtScaleBenchmark()
+{
+    const QString fileName = largeWorkspace();
+    QVERIFY(!fileName.isEmpty());
+
+    QBENCHMARK {
+        Workspace workspace;
+        QVERIFY(workspace.load(fileName));
+    }
+}
+
+void TestWorkspace::sessionAtScaleBenchmark()
+{
+    const QString fileName = largeWorkspace();
+    QVERIFY(!fileName.isEmpty());
+
+    // Opening a single session, as when switching to it in the window
+    QBENCHMARK {
+        Workspace workspace;
+        QVERIFY(workspace.load(fileName));
+        QVERIFY(workspace.session(0));
+    }
+}
+
+QTEST_GUILESS_MAIN(TestWorkspace)
+
+#include "tst_workspace.moc"
@@ -0,0 +1,20 @@
+QT += testlib widgets
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_workspace
+
+SRC_DIR = ../../src
+INCLUDEPATH += $$SRC_DIR
+
+SOURCES += \
+    tst_workspace.cpp \
+    $$SRC_DIR/denscalvalues.cpp \
+    $$SRC_DIR/undocommands.cpp \
+    $$SRC_DIR/workspace.cpp
+
+HEADERS += \
+    $$SRC_DIR/denscalvalues.h \
+    $$SRC_DIR/undocommands.h \
+    $$SRC_DIR/workspace.h
@@ -32,7 +32,10 @@
 /* enable log output. */
 #define ELOG_OUTPUT_ENABLE
 /* setting static output log level. range: from ELOG_LVL_ASSERT to ELOG_LVL_VERBOSE */
+/* levels above this are compiled out entirely, and it may be overridden from the build flags */
+#ifndef ELOG_OUTPUT_LVL
 #define ELOG_OUTPUT_LVL                          ELOG_LVL_VERBOSE
+#endif
 /* enable assert check */
 #define ELOG_ASSERT_ENABLE
 /* buffer size for every line's log */
@@ -344,6 +344,15 @@ void elog_set_filter_lvl(uint8_t level) {
     elog.filter.level = level;
 }
 
+/**
+ * get log filter's level
+ *
+ * @return level
+ */
+uint8_t elog_get_filter_lvl(void) {
+    return elog.filter.level;
+}
+
 /**
  * set log filter's tag
  *
@@ -495,6 +504,68 @@ uint8_t elog_get_filter_tag_lvl(const char *tag)
     return level;
 }
 
+/**
+ * get a tag's level filter by its index in the filter array
+ *
+ * @param index filter index, from 0 to ELOG_FILTER_TAG_LVL_MAX_NUM - 1
+ * @param tag buffer of at least ELOG_FILTER_TAG_MAX_LEN + 1 bytes for the tag
+ * @param level the tag's filter level
+ *
+ * @return true if the filter at this index is in use
+ */
+bool elog_get_filter_tag_lvl_entry(uint8_t index, char *tag, uint8_t *level)
+{
+    ELOG_ASSERT(tag != ((void *)0));
+    ELOG_ASSERT(level != ((void *)0));
+    bool result = false;
+
+    if (!elog.init_ok || index >= ELOG_FILTER_TAG_LVL_MAX_NUM) {
+        return false;
+    }
+
+    elog_output_lock();
+    if (elog.filter.tag_lvl[index].tag_use_flag) {
+        strncpy(tag, elog.filter.tag_lvl[index].tag, ELOG_FILTER_TAG_MAX_LEN);
+        tag[ELOG_FILTER_TAG_MAX_LEN] = '\0';
+        *level = elog.filter.tag_lvl[index].level;
+        result = true;
+    }
+    elog_output_unlock();
+
+    return result;
+}
+
+/**
+ * check if a log with this level and tag would pass the output filters
+ *
+ * This is used by the log macros to skip the evaluation of the log arguments
+ * and the call into the formatting code for logs that would be discarded.
+ * The filters are only read here, without taking the output lock, so a log
+ * may slip through (or be dropped) while a filter is being changed.
+ *
+ * @param level level
+ * @param tag tag
+ *
+ * @return true if the log should be output
+ */
+bool elog_output_check(uint8_t level, const char *tag)
+{
+    uint8_t i = 0;
+
+    if (!elog.output_enabled || level > elog.filter.level) {
+        return false;
+    }
+
+    for (i = 0; i < ELOG_FILTER_TAG_LVL_MAX_NUM; i++) {
+        if (elog.filter.tag_lvl[i].tag_use_flag == true &&
+            !strncmp(tag, elog.filter.tag_lvl[i].tag, ELOG_FILTER_TAG_MAX_LEN)) {
+            return level <= elog.filter.tag_lvl[i].level;
+        }
+    }
+
+    return true;
+}
+
 /**
  * output RAW format log
  *
@@ -36,6 +36,7 @@
 #include "FreeRTOS.h"
 #include "semphr.h"
 #include "cdc_handler.h"
+#include "crash_record.h"
 
 static osMutexId_t elog_mutex = NULL;
 static const osMutexAttr_t elog_mutex_attributes = {
@@ -73,6 +74,8 @@ void elog_port_deinit(void)
  */
 void elog_port_output(const char *log, size_t size)
 {
+    crash_record_log_append(log, size);
+
     if (output_callback) {
         output_callback(log, size);
     } else {
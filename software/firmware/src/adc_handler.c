@@ -23,6 +23,12 @@ static const osSemaphoreAttr_t adc_semaphore_attrs = {
     .name = "adc_semaphore"
 };
 
+/* Mutex used to allow ADC reads from different tasks */
+static osMutexId_t adc_mutex = NULL;
+static const osMutexAttr_t adc_mutex_attrs = {
+    .name = "adc_mutex"
+};
+
 osStatus_t adc_handler_init()
 {
     osStatus_t ret = osOK;
@@ -37,6 +43,14 @@ osStatus_t adc_handler_init()
             break;
         }
 
+        /* Create the mutex used to serialize reads */
+        adc_mutex = osMutexNew(&adc_mutex_attrs);
+        if (!adc_mutex) {
+            log_e("adc_mutex create error");
+            ret = osErrorNoMemory;
+            break;
+        }
+
         /* Run the ADC calibration in single-ended mode */
         hret = HAL_ADCEx_Calibration_Start(&hadc, ADC_SINGLE_ENDED);
         if (hret != HAL_OK) {
@@ -60,6 +74,8 @@ osStatus_t adc_read(adc_readings_t *readings)
         return osErrorParameter;
     }
 
+    osMutexAcquire(adc_mutex, portMAX_DELAY);
+
     do {
         /* Start ADC conversion on regular group with transfer by DMA */
         hret = HAL_ADC_Start_DMA(&hadc, (uint32_t *)adc_converted_values, ADC_BUFFER_SIZE);
@@ -113,6 +129,8 @@ osStatus_t adc_read(adc_readings_t *readings)
 
     } while (0);
 
+    osMutexRelease(adc_mutex);
+
     return ret;
 }
 
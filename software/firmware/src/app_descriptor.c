@@ -1,7 +1,12 @@
 #include "app_descriptor.h"
 
+#include "cdc_handler.h"
+#include "settings.h"
+
 const __attribute__((section(".app_descriptor"))) app_descriptor_t app_descriptor = {
     .magic_word = APP_DESCRIPTOR_MAGIC_WORD,
+    .protocol_version = CDC_PROTOCOL_VERSION,
+    .settings_version = SETTINGS_SCHEMA_VERSION,
     .project_name = "Printalyzer Densitometer",
     .version = "v1.1.0",
     .build_date = APP_BUILD_DATE,
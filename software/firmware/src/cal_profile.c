@@ -0,0 +1,241 @@
+#include "cal_profile.h"
+
+#include <string.h>
+#include <math.h>
+
+#include "util.h"
+
+static bool cal_profile_write_record(const cal_profile_store_t *store, uint32_t address,
+    const settings_cal_profile_t *profile);
+static bool cal_profile_read_record(const cal_profile_store_t *store, uint32_t address,
+    settings_cal_profile_t *profile);
+static bool cal_profile_write_active(const cal_profile_store_t *store, uint32_t value);
+static uint8_t cal_profile_valid_slot(const cal_profile_store_t *store, uint32_t index);
+
+static uint32_t cal_profile_slot_address(const cal_profile_store_t *store, uint8_t index)
+{
+    return store->slots_address + (index * CAL_PROFILE_SLOT_SIZE);
+}
+
+bool cal_profile_write(const cal_profile_store_t *store, uint8_t index, const settings_cal_profile_t *profile)
+{
+    if (!store || index >= SETTING_CAL_PROFILE_COUNT || !profile) { return false; }
+    return cal_profile_write_record(store, cal_profile_slot_address(store, index), profile);
+}
+
+bool cal_profile_read(const cal_profile_store_t *store, uint8_t index, settings_cal_profile_t *profile)
+{
+    if (!store || index >= SETTING_CAL_PROFILE_COUNT || !profile) { return false; }
+
+    if (!cal_profile_read_record(store, cal_profile_slot_address(store, index), profile)) {
+        return false;
+    }
+
+    /* An empty name marks an unused slot */
+    return profile->name[0] != '\0';
+}
+
+bool cal_profile_select(const cal_profile_store_t *store, uint8_t index, uint8_t active)
+{
+    settings_cal_profile_t profile;
+    settings_cal_profile_t backup;
+
+    if (!cal_profile_read(store, index, &profile)) {
+        return false;
+    }
+
+    /* Save the live calibration, so an interrupted select can be undone */
+    memset(&backup, 0, sizeof(settings_cal_profile_t));
+    store->get_live(&backup);
+    if (!cal_profile_write_record(store, store->page_address + CAL_PROFILE_PAGE_BACKUP, &backup)) {
+        return false;
+    }
+
+    /* Mark the select as pending, recording where to return to */
+    if (!cal_profile_write_active(store, CAL_PROFILE_ACTIVE_PENDING | ((uint32_t)active << 8) | index)) {
+        cal_profile_write_active(store, active);
+        return false;
+    }
+
+    if (store->set_live(&profile) && cal_profile_write_active(store, index)) {
+        return true;
+    }
+
+    /*
+     * Put back the calibration that was in place before the select.
+     * If that fails too, the select is left pending so the backup is
+     * restored at the next startup.
+     */
+    if (store->set_live(&backup)) {
+        cal_profile_write_active(store, active);
+    }
+    return false;
+}
+
+uint8_t cal_profile_recover(const cal_profile_store_t *store)
+{
+    uint8_t buf[4];
+
+    if (!store || !store->read(store->page_address + CAL_PROFILE_PAGE_ACTIVE, buf, sizeof(buf))) {
+        return SETTING_CAL_PROFILE_NONE;
+    }
+    uint32_t value = copy_to_u32(buf);
+
+    if ((value & CAL_PROFILE_ACTIVE_PENDING) == 0) {
+        return cal_profile_valid_slot(store, value);
+    }
+
+    uint8_t previous = (value >> 8) & 0xFF;
+    uint8_t index = value & 0xFF;
+    settings_cal_profile_t cal;
+
+    if (cal_profile_read_record(store, store->page_address + CAL_PROFILE_PAGE_BACKUP, &cal)) {
+        /* Undo the interrupted select */
+        if (store->set_live(&cal) && cal_profile_write_active(store, previous)) {
+            return cal_profile_valid_slot(store, previous);
+        }
+    } else if (cal_profile_read(store, index, &cal)) {
+        /* Without a usable backup, the only consistent choice is to finish the select */
+        if (store->set_live(&cal) && cal_profile_write_active(store, index)) {
+            return index;
+        }
+    } else {
+        cal_profile_write_active(store, SETTING_CAL_PROFILE_NONE);
+    }
+    return SETTING_CAL_PROFILE_NONE;
+}
+
+bool cal_profile_write_unc_block(const cal_profile_store_t *store, uint32_t address,
+    const float *values, size_t count, uint32_t values_crc)
+{
+    uint8_t buf[CAL_PROFILE_UNC_SIZE];
+    if (!store || count + 2 > sizeof(buf) / 4) { return false; }
+
+    for (size_t i = 0; i < count; i++) {
+        copy_from_f32(&buf[i * 4], values[i]);
+    }
+    copy_from_u32(&buf[count * 4], values_crc);
+
+    uint32_t crc = store->crc(buf, count + 1);
+    copy_from_u32(&buf[(count + 1) * 4], crc);
+
+    return store->write(address, buf, (count + 2) * 4);
+}
+
+bool cal_profile_read_unc_block(const cal_profile_store_t *store, uint32_t address,
+    float *values, size_t count, uint32_t values_crc)
+{
+    uint8_t buf[CAL_PROFILE_UNC_SIZE];
+    if (!store || count + 2 > sizeof(buf) / 4) { return false; }
+
+    if (!store->read(address, buf, (count + 2) * 4)) {
+        return false;
+    }
+
+    uint32_t crc = copy_to_u32(&buf[(count + 1) * 4]);
+    uint32_t calculated_crc = store->crc(buf, count + 1);
+    if (crc != calculated_crc || copy_to_u32(&buf[count * 4]) != values_crc) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        values[i] = copy_to_f32(&buf[i * 4]);
+    }
+    return true;
+}
+
+static bool cal_profile_write_record(const cal_profile_store_t *store, uint32_t address,
+    const settings_cal_profile_t *profile)
+{
+    uint8_t buf[CAL_PROFILE_RECORD_SIZE];
+    memset(buf, 0, sizeof(buf));
+    strncpy((char *)buf, profile->name, SETTING_CAL_PROFILE_NAME_LEN);
+    copy_from_f32(&buf[16], profile->gain.ch0_medium);
+    copy_from_f32(&buf[20], profile->gain.ch1_medium);
+    copy_from_f32(&buf[24], profile->gain.ch0_high);
+    copy_from_f32(&buf[28], profile->gain.ch1_high);
+    copy_from_f32(&buf[32], profile->gain.ch0_maximum);
+    copy_from_f32(&buf[36], profile->gain.ch1_maximum);
+    copy_from_f32(&buf[40], profile->slope.b0);
+    copy_from_f32(&buf[44], profile->slope.b1);
+    copy_from_f32(&buf[48], profile->slope.b2);
+    copy_from_f32(&buf[52], profile->reflection.lo_d);
+    copy_from_f32(&buf[56], profile->reflection.lo_value);
+    copy_from_f32(&buf[60], profile->reflection.hi_d);
+    copy_from_f32(&buf[64], profile->reflection.hi_value);
+    copy_from_f32(&buf[68], profile->transmission.zero_value);
+    copy_from_f32(&buf[72], profile->transmission.hi_d);
+    copy_from_f32(&buf[76], profile->transmission.hi_value);
+
+    uint32_t crc = store->crc(buf, 20);
+    copy_from_u32(&buf[80], crc);
+
+    if (!store->write(address, buf, sizeof(buf))) {
+        return false;
+    }
+
+    const float unc[] = {
+        profile->reflection.lo_unc, profile->reflection.hi_unc, profile->transmission.hi_unc
+    };
+    return cal_profile_write_unc_block(store, address + CAL_PROFILE_UNC, unc, 3, crc);
+}
+
+static bool cal_profile_read_record(const cal_profile_store_t *store, uint32_t address,
+    settings_cal_profile_t *profile)
+{
+    uint8_t buf[CAL_PROFILE_RECORD_SIZE];
+
+    memset(profile, 0, sizeof(settings_cal_profile_t));
+
+    if (!store->read(address, buf, sizeof(buf))) {
+        return false;
+    }
+
+    uint32_t crc = copy_to_u32(&buf[80]);
+    uint32_t calculated_crc = store->crc(buf, 20);
+    if (crc != calculated_crc) {
+        return false;
+    }
+
+    strncpy(profile->name, (const char *)buf, SETTING_CAL_PROFILE_NAME_LEN);
+    profile->gain.ch0_medium = copy_to_f32(&buf[16]);
+    profile->gain.ch1_medium = copy_to_f32(&buf[20]);
+    profile->gain.ch0_high = copy_to_f32(&buf[24]);
+    profile->gain.ch1_high = copy_to_f32(&buf[28]);
+    profile->gain.ch0_maximum = copy_to_f32(&buf[32]);
+    profile->gain.ch1_maximum = copy_to_f32(&buf[36]);
+    profile->slope.b0 = copy_to_f32(&buf[40]);
+    profile->slope.b1 = copy_to_f32(&buf[44]);
+    profile->slope.b2 = copy_to_f32(&buf[48]);
+    profile->reflection.lo_d = copy_to_f32(&buf[52]);
+    profile->reflection.lo_value = copy_to_f32(&buf[56]);
+    profile->reflection.hi_d = copy_to_f32(&buf[60]);
+    profile->reflection.hi_value = copy_to_f32(&buf[64]);
+    profile->transmission.zero_value = copy_to_f32(&buf[68]);
+    profile->transmission.hi_d = copy_to_f32(&buf[72]);
+    profile->transmission.hi_value = copy_to_f32(&buf[76]);
+
+    float unc[3] = { NAN, NAN, NAN };
+    cal_profile_read_unc_block(store, address + CAL_PROFILE_UNC, unc, 3, crc);
+    profile->reflection.lo_unc = unc[0];
+    profile->reflection.hi_unc = unc[1];
+    profile->transmission.hi_unc = unc[2];
+
+    return true;
+}
+
+static bool cal_profile_write_active(const cal_profile_store_t *store, uint32_t value)
+{
+    uint8_t buf[4];
+    copy_from_u32(buf, value);
+    return store->write(store->page_address + CAL_PROFILE_PAGE_ACTIVE, buf, sizeof(buf));
+}
+
+static uint8_t cal_profile_valid_slot(const cal_profile_store_t *store, uint32_t index)
+{
+    settings_cal_profile_t profile;
+    if (index < SETTING_CAL_PROFILE_COUNT && cal_profile_read(store, (uint8_t)index, &profile)) {
+        return (uint8_t)index;
+    }
+    return SETTING_CAL_PROFILE_NONE;
+}
@@ -0,0 +1,100 @@
+#ifndef CAL_PROFILE_H
+#define CAL_PROFILE_H
+
+/*
+ * Storage of the calibration profile slots, and switching between them.
+ *
+ * These functions only reach the EEPROM and the live calibration through
+ * the functions in a cal_profile_store_t, so that the slot records and
+ * the select transaction can be built and exercised on a host machine
+ * against an in-memory EEPROM, separately from settings.c.
+ *
+ * Selecting a profile rewrites several live calibration records, so it
+ * is journaled to keep an interrupted select from leaving a mix of two
+ * profiles behind. The live calibration is first copied into a backup
+ * record, and the active slot word is marked pending, before any of it
+ * is replaced. Only once every record has been written is the active
+ * slot word committed. A pending select found at startup is undone from
+ * the backup record.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "settings.h"
+
+/* Layout of the profile page, relative to its start */
+#define CAL_PROFILE_PAGE_ACTIVE     (4U)  /* Active slot word */
+#define CAL_PROFILE_PAGE_BACKUP     (8U)  /* Live calibration saved by a pending select */
+
+/* Layout of each profile slot, relative to its start */
+#define CAL_PROFILE_SLOT_SIZE       (128U)
+#define CAL_PROFILE_RECORD_SIZE     (84U)
+#define CAL_PROFILE_UNC             (84U)
+#define CAL_PROFILE_UNC_SIZE        (20U)
+
+/* Flag in the active slot word for a select that has not completed */
+#define CAL_PROFILE_ACTIVE_PENDING  (0x80000000UL)
+
+/**
+ * Access to the EEPROM and live calibration, provided by settings.c
+ * on the device and by an in-memory EEPROM in the host tests.
+ */
+typedef struct {
+    uint32_t page_address;  /*!< Address of the profile page */
+    uint32_t slots_address; /*!< Address of the first profile slot */
+    bool (*read)(uint32_t address, uint8_t *data, size_t data_len);
+    bool (*write)(uint32_t address, const uint8_t *data, size_t data_len);
+    uint32_t (*crc)(const uint8_t *data, size_t word_count);
+    void (*get_live)(settings_cal_profile_t *cal);
+    bool (*set_live)(const settings_cal_profile_t *cal);
+} cal_profile_store_t;
+
+/**
+ * Write a profile into one of the slots.
+ */
+bool cal_profile_write(const cal_profile_store_t *store, uint8_t index, const settings_cal_profile_t *profile);
+
+/**
+ * Read the profile stored in one of the slots.
+ *
+ * @return True if the slot holds a profile that passed its CRC check,
+ *         and is not an unused slot
+ */
+bool cal_profile_read(const cal_profile_store_t *store, uint8_t index, settings_cal_profile_t *profile);
+
+/**
+ * Replace the live calibration with a stored profile.
+ *
+ * If any part of the switch fails, the live calibration that was in
+ * place beforehand is restored.
+ *
+ * @param index Slot of the profile to select
+ * @param active Slot that is currently active, or SETTING_CAL_PROFILE_NONE
+ * @return True if the profile is now active
+ */
+bool cal_profile_select(const cal_profile_store_t *store, uint8_t index, uint8_t active);
+
+/**
+ * Finish any select that was interrupted, and get the active slot.
+ *
+ * @return Active slot, or SETTING_CAL_PROFILE_NONE if none is active
+ */
+uint8_t cal_profile_recover(const cal_profile_store_t *store);
+
+/**
+ * Write a block of uncertainty values, tied to the CRC of the record
+ * holding the values they belong to.
+ */
+bool cal_profile_write_unc_block(const cal_profile_store_t *store, uint32_t address,
+    const float *values, size_t count, uint32_t values_crc);
+
+/**
+ * Read a block of uncertainty values, which is only accepted if it is
+ * intact and still belongs to the record with the given CRC.
+ */
+bool cal_profile_read_unc_block(const cal_profile_store_t *store, uint32_t address,
+    float *values, size_t count, uint32_t values_crc);
+
+#endif /* CAL_PROFILE_H */
@@ -0,0 +1,200 @@
+#include "cdc_command.h"
+
+#include <string.h>
+#include <math.h>
+
+#ifndef MIN
+#define MIN(a, b)  (((a) < (b)) ? (a) : (b))
+#endif
+
+static uint8_t decode_hex_char(char ch, bool *ok);
+
+void cdc_line_reset(cdc_line_t *line)
+{
+    memset(line, 0, sizeof(cdc_line_t));
+}
+
+cdc_line_status_t cdc_line_put(cdc_line_t *line, char ch)
+{
+    if (ch == '\r' || ch == '\n') {
+        /* Accept the line as soon as a line break is sent */
+        if (line->overflow) {
+            cdc_line_reset(line);
+            return CDC_LINE_OVERFLOW;
+        } else if (line->len > 0) {
+            line->buf[line->len] = '\0';
+            return CDC_LINE_READY;
+        }
+    } else if (ch >= 0x20 && ch < 0x7F) {
+        /* Only fill the buffer with printable characters */
+        if (line->len < CDC_COMMAND_LINE_LEN) {
+            line->buf[line->len++] = ch;
+        } else {
+            line->overflow = true;
+        }
+    } else if (ch == 0x08 || ch == 0x7F) {
+        /* Handle backspace behavior */
+        if (line->len > 0 && !line->overflow) {
+            line->len--;
+            line->buf[line->len] = '\0';
+        }
+    }
+    return CDC_LINE_PENDING;
+}
+
+bool cdc_command_parse(cdc_command_t *cmd, const char *buf, size_t len)
+{
+    cmd_type_t type;
+    cmd_category_t category;
+
+    if (!cmd || !buf || len < 2 || buf[0] == '\0') {
+        return false;
+    }
+
+    switch (buf[0]) {
+    case 'S':
+        type = CMD_TYPE_SET;
+        break;
+    case 'G':
+        type = CMD_TYPE_GET;
+        break;
+    case 'I':
+        type = CMD_TYPE_INVOKE;
+        break;
+    default:
+        return false;
+    }
+
+    switch (buf[1]) {
+    case 'S':
+        category = CMD_CATEGORY_SYSTEM;
+        break;
+    case 'M':
+        category = CMD_CATEGORY_MEASUREMENT;
+        break;
+    case 'C':
+        category = CMD_CATEGORY_CALIBRATION;
+        break;
+    case 'D':
+        category = CMD_CATEGORY_DIAGNOSTICS;
+        break;
+    default:
+        return false;
+    }
+
+    if (len > 2 && buf[2] != ' ') {
+        return false;
+    }
+
+    cmd->type = type;
+    cmd->category = category;
+    memset(cmd->action, 0, sizeof(cmd->action));
+    memset(cmd->args, 0, sizeof(cmd->args));
+
+    if (len > 3) {
+        const char *p = strchr(buf + 3, ',');
+        if (p) {
+            strncpy(cmd->action, buf + 3, MIN((size_t)(p - (buf + 3)), sizeof(cmd->action) - 1));
+            strncpy(cmd->args, p + 1, MIN(len - (size_t)((p + 1) - buf), sizeof(cmd->args) - 1));
+        } else {
+            strncpy(cmd->action, buf + 3, MIN(len - 3, sizeof(cmd->action) - 1));
+        }
+    }
+
+    return true;
+}
+
+size_t cdc_encode_f32(char *out, float value)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+
+    for (size_t i = 0; i < 8; i++) {
+        out[i] = hex[(bits >> (28 - (i * 4))) & 0x0F];
+    }
+    out[8] = '\0';
+    return 8;
+}
+
+uint8_t decode_hex_char(char ch, bool *ok)
+{
+    uint8_t val;
+    bool valid = true;
+    if ('0' <= ch && ch <= '9') {
+        val = (uint8_t)(ch - '0');
+    } else if ('A' <= ch && ch <= 'F') {
+        val = (uint8_t)(ch - 'A' + 10);
+    } else if ('a' <= ch && ch <= 'f') {
+        val = (uint8_t)(ch - 'a' + 10);
+    } else {
+        val = 0;
+        valid = false;
+    }
+    if (ok) { *ok = valid; }
+    return val;
+}
+
+float cdc_decode_f32(const char *buf)
+{
+    uint32_t bits = 0;
+    float value;
+    bool ok;
+
+    if (strlen(buf) != 8) {
+        return NAN;
+    }
+
+    for (size_t i = 0; i < 8; i++) {
+        bits = (bits << 4) | decode_hex_char(buf[i], &ok);
+        if (!ok) { return NAN; }
+    }
+
+    memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+void cdc_encode_f32_array(char *buf, const float *array, size_t len)
+{
+    size_t offset = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (i > 0) {
+            buf[offset++] = ',';
+        }
+        offset += cdc_encode_f32(buf + offset, array[i]);
+    }
+    buf[offset] = '\0';
+}
+
+size_t cdc_decode_f32_array(const char *args, float *elements, size_t len)
+{
+    char numbuf[16];
+    size_t n = 0;
+    size_t p, q;
+
+    p = 0;
+    q = p;
+    while (n < len) {
+        if (args[q] == ',' || args[q] == '\0') {
+            if (p >= q) { break; }
+            if (q - p < sizeof(numbuf) - 1) {
+                memset(numbuf, 0, sizeof(numbuf));
+                strncpy(numbuf, args + p, q - p);
+                elements[n] = cdc_decode_f32(numbuf);
+            } else {
+                elements[n] = NAN;
+            }
+            n++;
+            if (args[q] == '\0') {
+                break;
+            } else {
+                p = q + 1;
+                q = p;
+            }
+        } else {
+            q++;
+        }
+    }
+
+    return n;
+}
@@ -0,0 +1,107 @@
+/*
+ * Line assembly, parsing and value encoding for the commands received
+ * over the USB CDC interface.
+ *
+ * This module has no hardware dependencies, so that it can be built
+ * and exercised on the host.
+ */
+#ifndef CDC_COMMAND_H
+#define CDC_COMMAND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Longest command line that is accepted, not including the line break.
+ */
+#define CDC_COMMAND_LINE_LEN 64
+
+typedef enum {
+    CMD_TYPE_SET,
+    CMD_TYPE_GET,
+    CMD_TYPE_INVOKE
+} cmd_type_t;
+
+typedef enum {
+    CMD_CATEGORY_SYSTEM,
+    CMD_CATEGORY_MEASUREMENT,
+    CMD_CATEGORY_CALIBRATION,
+    CMD_CATEGORY_DIAGNOSTICS
+} cmd_category_t;
+
+/**
+ * Parsed command.
+ *
+ * The arguments are sized to hold everything after the shortest
+ * possible prefix of a full length line, such as "SS X,".
+ */
+typedef struct {
+    cmd_type_t type;
+    cmd_category_t category;
+    char action[12];
+    char args[CDC_COMMAND_LINE_LEN - 4];
+} cdc_command_t;
+
+typedef enum {
+    CDC_LINE_PENDING = 0, /*!< More characters are needed */
+    CDC_LINE_READY,       /*!< A complete line is in the buffer */
+    CDC_LINE_OVERFLOW     /*!< A line that was too long has been discarded */
+} cdc_line_status_t;
+
+/**
+ * Buffer for assembling a command line from received characters.
+ */
+typedef struct {
+    char buf[CDC_COMMAND_LINE_LEN + 1];
+    size_t len;
+    bool overflow;
+} cdc_line_t;
+
+void cdc_line_reset(cdc_line_t *line);
+
+/**
+ * Add a received character to the line.
+ *
+ * Only printable characters are kept, and backspace removes the last
+ * one. A line longer than CDC_COMMAND_LINE_LEN is discarded as a whole
+ * once its line break arrives, rather than being cut short, since a
+ * truncated set command could still be valid.
+ *
+ * Once this returns CDC_LINE_READY, the null terminated line is in
+ * the buffer until the line is reset.
+ */
+cdc_line_status_t cdc_line_put(cdc_line_t *line, char ch);
+
+/**
+ * Parse a command line of the form "TC ACTION,args".
+ *
+ * @return True if the line has a valid type and category
+ */
+bool cdc_command_parse(cdc_command_t *cmd, const char *buf, size_t len);
+
+/**
+ * Encode a float as 8 hex digits of its big-endian IEEE-754 bits.
+ *
+ * @return Number of characters written, not including the null
+ */
+size_t cdc_encode_f32(char *out, float value);
+
+/**
+ * Decode a float encoded by cdc_encode_f32(), or NaN if it is invalid.
+ */
+float cdc_decode_f32(const char *buf);
+
+/**
+ * Encode an array of floats as a comma separated list.
+ */
+void cdc_encode_f32_array(char *buf, const float *array, size_t len);
+
+/**
+ * Decode up to len comma separated floats.
+ *
+ * @return Number of elements found
+ */
+size_t cdc_decode_f32_array(const char *args, float *elements, size_t len);
+
+#endif /* CDC_COMMAND_H */
@@ -28,41 +28,35 @@
 #include "app_descriptor.h"
 #include "util.h"
 #include "keypad.h"
+#include "crash_record.h"
+#include "crash_record_format.h"
+#include "log_filter.h"
+#include "hid_handler.h"
+#include "settings_desc.h"
+#include "ui_strings.h"
+#include "power.h"
+#include "selftest.h"
+#include "selftest_policy.h"
+#include "task_watchdog.h"
+#include "cdc_command.h"
 
-#define CMD_DATA_SIZE 64
 #define CDC_TX_TIMEOUT 200
 #define CDC_MIN_BIT_RATE 9600
 
-typedef enum {
-    CMD_TYPE_SET,
-    CMD_TYPE_GET,
-    CMD_TYPE_INVOKE
-} cmd_type_t;
-
-typedef enum {
-    CMD_CATEGORY_SYSTEM,
-    CMD_CATEGORY_MEASUREMENT,
-    CMD_CATEGORY_CALIBRATION,
-    CMD_CATEGORY_DIAGNOSTICS
-} cmd_category_t;
-
-typedef struct {
-    cmd_type_t type;
-    cmd_category_t category;
-    char action[8];
-    char args[56];
-} cdc_command_t;
+/* Long enough for the slowest command, which is a gain calibration */
+#define CDC_WATCHDOG_DEADLINE_MS 10000U
 
 typedef enum {
     READING_FORMAT_BASIC,
-    READING_FORMAT_EXT
+    READING_FORMAT_EXT,
+    READING_FORMAT_EXT_UNCERTAINTY,
+    READING_FORMAT_EXT_QUALITY
 } cdc_reading_format_t;
 
 static volatile bool cdc_initialized = false;
 static volatile bool cdc_host_connected = false;
 static volatile bool cdc_logging_redirected = false;
-static uint8_t cmd_buffer[CMD_DATA_SIZE];
-static size_t cmd_buffer_len = 0;
+static cdc_line_t cmd_line;
 static bool cdc_remote_enabled = false;
 static volatile bool cdc_remote_active = false;
 static volatile bool cdc_remote_sensor_active = false;
@@ -89,21 +83,17 @@ static const osMutexAttr_t cdc_mutex_attrs = {
 static void cdc_task_loop();
 static void cdc_set_connected(bool connected);
 static void cdc_process_command(const char *buf, size_t len);
-static bool cdc_parse_command(cdc_command_t *cmd, const char *buf, size_t len);
 static bool cdc_process_command_system(const cdc_command_t *cmd);
 static bool cdc_process_command_measurement(const cdc_command_t *cmd);
 static bool cdc_process_command_calibration(const cdc_command_t *cmd);
+static bool cdc_process_command_cal_profile(const cdc_command_t *cmd);
 static bool cdc_invoke_gain_calibration_callback(sensor_gain_calibration_status_t status, int param, void *user_data);
 static bool cdc_process_command_diagnostics(const cdc_command_t *cmd);
+static void cdc_send_selftest_result(selftest_check_t check, const selftest_result_t *result, void *user_data);
 
-static void cdc_send_response(const char *str);
+void cdc_send_response(const char *str);
 static void cdc_send_command_response(const cdc_command_t *cmd, const char *str);
 
-static void encode_f32_array_response(char *buf, const float *array, size_t len);
-static size_t encode_f32(char *out, float value);
-static uint8_t decode_hex_char(char ch, bool *ok);
-static float decode_f32(const char *buf);
-static size_t decode_f32_array_args(const char *args, float *elements, size_t len);
 
 extern I2C_HandleTypeDef hi2c1;
 
@@ -142,11 +132,15 @@ void task_cdc_run(void *argument)
         return;
     }
 
+    task_watchdog_register(CDC_WATCHDOG_DEADLINE_MS);
+
     while (1) {
         /* Process data */
+        task_watchdog_checkin();
         cdc_task_loop();
 
         /* Block for new data */
+        task_watchdog_idle();
         if (osSemaphoreAcquire(cdc_rx_semaphore, portMAX_DELAY) != osOK) {
             log_e("Unable to acquire cdc_rx_semaphore");
         }
@@ -193,6 +187,7 @@ void tud_cdc_rx_cb(uint8_t itf)
 {
     /* log_d("tud_cdc_rx_cb: itf=%d", itf); */
     if (!cdc_initialized) { return; }
+    power_activity(POWER_SOURCE_USB);
     osSemaphoreRelease(cdc_rx_semaphore);
 }
 
@@ -211,28 +206,12 @@ void cdc_task_loop()
         uint32_t count = tud_cdc_read(buf, sizeof(buf));
 
         for (size_t i = 0; i < count; i++) {
-            /* Fill buffer as long as there is space */
-            if (cmd_buffer_len < CMD_DATA_SIZE) {
-                if (buf[i] >= 0x20 && buf[i] < 0x7F) {
-                    /* Only fill buffer with printable characters */
-                    cmd_buffer[cmd_buffer_len++] = buf[i];
-                } else if (buf[i] == 0x08 || buf[i] == 0x7F) {
-                    /* Handle backspace behavior */
-                    if (cmd_buffer_len > 0) {
-                        cmd_buffer_len--;
-                        cmd_buffer[cmd_buffer_len] = '\0';
-                    }
-                }
-            }
-            /* Accept command as soon as a line break is sent */
-            if ((buf[i] == '\r' || buf[i] == '\n') && cmd_buffer_len > 0) {
-                /* Accept command */
-                cmd_buffer[cmd_buffer_len] = '\0';
-                cdc_process_command((const char *)cmd_buffer, cmd_buffer_len);
-
-                /* Clear command buffer */
-                memset(cmd_buffer, 0, sizeof(cmd_buffer));
-                cmd_buffer_len = 0;
+            cdc_line_status_t status = cdc_line_put(&cmd_line, buf[i]);
+            if (status == CDC_LINE_READY) {
+                cdc_process_command(cmd_line.buf, cmd_line.len);
+                cdc_line_reset(&cmd_line);
+            } else if (status == CDC_LINE_OVERFLOW) {
+                log_w("Command too long");
             }
         }
     }
@@ -271,8 +250,10 @@ void cdc_process_command(const char *buf, size_t len)
         return;
     }
 
-    if (cdc_parse_command(&cmd, buf, len)) {
+    if (cdc_command_parse(&cmd, buf, len)) {
         bool result = false;
+        log_i("Command: [%c][%c] {%s},\"%s\"", buf[0], buf[1], cmd.action, cmd.args);
+
         switch (cmd.category) {
         case CMD_CATEGORY_SYSTEM:
             result = cdc_process_command_system(&cmd);
@@ -295,72 +276,6 @@ void cdc_process_command(const char *buf, size_t len)
     }
 }
 
-bool cdc_parse_command(cdc_command_t *cmd, const char *buf, size_t len)
-{
-    cmd_type_t type;
-    cmd_category_t category;
-
-    if (!cmd || !buf || len < 2 || buf[0] == '\0') {
-        return false;
-    }
-
-    switch (buf[0]) {
-    case 'S':
-        type = CMD_TYPE_SET;
-        break;
-    case 'G':
-        type = CMD_TYPE_GET;
-        break;
-    case 'I':
-        type = CMD_TYPE_INVOKE;
-        break;
-    default:
-        return false;
-    }
-
-    switch (buf[1]) {
-    case 'S':
-        category = CMD_CATEGORY_SYSTEM;
-        break;
-    case 'M':
-        category = CMD_CATEGORY_MEASUREMENT;
-        break;
-    case 'C':
-        category = CMD_CATEGORY_CALIBRATION;
-        break;
-    case 'D':
-        category = CMD_CATEGORY_DIAGNOSTICS;
-        break;
-    default:
-        return false;
-    }
-
-    if (len > 2 && buf[2] != ' ') {
-        return false;
-    }
-
-    cmd->type = type;
-    cmd->category = category;
-
-    if (len > 3) {
-        char *p = strchr(buf + 3, ',');
-        if (p) {
-            strncpy(cmd->action, buf + 3, MIN(p - (buf + 3), sizeof(cmd->action) - 1));
-            strncpy(cmd->args, p + 1, MIN(len - ((p + 1) - buf), sizeof(cmd->args) - 1));
-        } else {
-            strncpy(cmd->action, buf + 3, MIN(len - 3, sizeof(cmd->action) - 1));
-            bzero(cmd->args, sizeof(cmd->args));
-        }
-    } else {
-        bzero(cmd->action, sizeof(cmd->action));
-        bzero(cmd->args, sizeof(cmd->args));
-    }
-
-    log_i("Command: [%c][%c] {%s},\"%s\"", buf[0], buf[1], cmd->action, cmd->args);
-
-    return true;
-}
-
 bool cdc_process_command_system(const cdc_command_t *cmd)
 {
     /*
@@ -370,7 +285,19 @@ bool cdc_process_command_system(const cdc_command_t *cmd)
      * "GS DEV"  -> Get device information (HAL version, MCU Rev ID, MCU Dev ID, SysClock)
      * "GS RTOS" -> Get FreeRTOS information
      * "GS UID"  -> Get device unique ID
+     * "GS AUDIT" -> Get the settings change count and hash
+     * "GS POWER" -> Get power governor state and time spent in each power state
      * "GS ISEN" -> Internal sensor readings
+     * "GS LOG"  -> Get log level filters
+     * "SS LOG,tag,l" -> Set log level filter for a tag ("*" for all tags)
+     * "SS LOG,SAVE"  -> Save the current log level filters
+     * "SS LOG,RESET" -> Reset the log level filters to their defaults
+     * "GS HIDT" -> Get the HID output template
+     * "SS HIDT,text" -> Set and save the HID output template
+     * "GS SETD"   -> Get the number of menu settings
+     * "GS SETD,n" -> Get the descriptor and current value of a menu setting
+     * "GS SETC,n" -> Get the allowed values of a menu setting
+     * "SS SETV,key,value" -> Set and save the value of a menu setting
      * "IS REMOTE,n" -> Invoke remote control mode (enable = 1, disable = 0)
      * "SS DISP,text" -> Write text to the display [remote]
      */
@@ -382,9 +309,11 @@ bool cdc_process_command_system(const cdc_command_t *cmd)
     if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "V") == 0) {
         /*
          * Output format:
-         * Project name, Version
+         * Project name, Version, Protocol version, Settings schema version
          */
-        sprintf(buf, "\"%s\",\"%s\"", app_descriptor->project_name, app_descriptor->version);
+        sprintf(buf, "\"%s\",\"%s\",%lu,%lu",
+            app_descriptor->project_name, app_descriptor->version,
+            app_descriptor->protocol_version, settings_get_schema_version());
         cdc_send_command_response(cmd, buf);
         return true;
     } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "B") == 0) {
@@ -434,6 +363,25 @@ bool cdc_process_command_system(const cdc_command_t *cmd)
             __bswap32(HAL_GetUIDw2()));
         cdc_send_command_response(cmd, buf);
         return true;
+    } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "AUDIT") == 0) {
+        uint32_t count;
+        uint32_t hash;
+        settings_get_audit(&count, &hash);
+        sprintf(buf, "%lu,%08lX", count, hash);
+        cdc_send_command_response(cmd, buf);
+        return true;
+    } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "POWER") == 0) {
+        power_stats_t stats;
+        power_get_stats(&stats);
+        sprintf(buf, "%s,%lu,%lu,%lu,%lu,%lu",
+            (stats.clock == POWER_CLOCK_FULL) ? "FULL" : "REDUCED",
+            stats.awake_ms[POWER_CLOCK_FULL],
+            stats.awake_ms[POWER_CLOCK_REDUCED],
+            stats.sleep_ms,
+            stats.upshift_count,
+            stats.upshift_max_us);
+        cdc_send_command_response(cmd, buf);
+        return true;
     } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "ISEN") == 0) {
         /*
          * Output format:
@@ -447,6 +395,145 @@ bool cdc_process_command_system(const cdc_command_t *cmd)
             cdc_send_command_response(cmd, "ERR");
         }
         return true;
+    } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "LOG") == 0) {
+        /*
+         * Output format:
+         * Global level, followed by tag and level pairs
+         */
+        settings_user_log_level_t log_level;
+        log_filter_get(&log_level);
+
+        size_t offset = sprintf(buf, "%c", log_filter_level_char(log_level.level));
+        for (size_t i = 0; i < SETTING_LOG_LEVEL_TAG_COUNT; i++) {
+            if (log_level.tags[i].tag[0] != '\0') {
+                offset += sprintf(buf + offset, ",%s,%c",
+                    log_level.tags[i].tag,
+                    log_filter_level_char(log_level.tags[i].level));
+            }
+        }
+        cdc_send_command_response(cmd, buf);
+        return true;
+    } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "LOG") == 0) {
+        if (strcmp(cmd->args, "SAVE") == 0) {
+            if (log_filter_save()) {
+                cdc_send_command_response(cmd, "OK");
+            } else {
+                cdc_send_command_response(cmd, "ERR");
+            }
+            return true;
+        } else if (strcmp(cmd->args, "RESET") == 0) {
+            settings_user_log_level_t log_level;
+            memset(&log_level, 0, sizeof(settings_user_log_level_t));
+            log_level.level = ELOG_LVL_VERBOSE;
+            log_filter_apply(&log_level);
+            cdc_send_command_response(cmd, "OK");
+            return true;
+        }
+
+        /* Split the arguments into the tag and the level */
+        strcpy(buf, cmd->args);
+        char *p = strrchr(buf, ',');
+        if (!p) { return false; }
+        *p++ = '\0';
+
+        uint8_t level;
+        if (!log_filter_parse_level(p, &level)) {
+            return false;
+        }
+
+        if (log_filter_set(buf, level)) {
+            cdc_send_command_response(cmd, "OK");
+        } else {
+            cdc_send_command_response(cmd, "ERR");
+        }
+        return true;
+    } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "HIDT") == 0) {
+        /*
+         * Output format:
+         * Quoted template text
+         */
+        char text[SETTING_HID_TEMPLATE_LEN + 1];
+        hid_handler_get_template(text, sizeof(text));
+        sprintf(buf, "\"%s\"", text);
+        cdc_send_command_response(cmd, buf);
+        return true;
+    } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "HIDT") == 0) {
+        if (cmd->args[0] == '\0') { return false; }
+
+        if (hid_handler_set_template(cmd->args)) {
+            cdc_send_command_response(cmd, "OK");
+        } else {
+            cdc_send_command_response(cmd, "ERR");
+        }
+        return true;
+    } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "SETD") == 0) {
+        if (cmd->args[0] == '\0') {
+            sprintf(buf, "%d", settings_desc_count());
+            cdc_send_command_response(cmd, buf);
+            return true;
+        }
+
+        /*
+         * Output format:
+         * Index, Key, Type (B, C or R), Group, Name, Current value
+         * Numeric settings (R) add: Minimum, Maximum, Step, Unit
+         */
+        size_t index = atoi(cmd->args);
+        const settings_desc_t *desc = settings_desc_at(index);
+        if (!desc) { return false; }
+
+        char type;
+        if (desc->type == SETTINGS_DESC_TYPE_BOOL) {
+            type = 'B';
+        } else if (desc->type == SETTINGS_DESC_TYPE_RANGE) {
+            type = 'R';
+        } else {
+            type = 'C';
+        }
+
+        size_t offset = sprintf(buf, "%d,%s,%c,\"%s\",\"%s\",%d",
+            index, desc->key, type,
+            ui_str_lang(UI_LANGUAGE_EN, desc->group), desc->name,
+            settings_desc_get(desc));
+        if (desc->type == SETTINGS_DESC_TYPE_RANGE) {
+            sprintf(buf + offset, ",%d,%d,%d,\"%s\"",
+                desc->min, desc->max, desc->step, desc->unit ? desc->unit : "");
+        }
+        cdc_send_command_response(cmd, buf);
+        return true;
+    } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "SETC") == 0) {
+        /*
+         * Output format:
+         * Index, followed by value and label pairs
+         * (only the values with a special meaning, for numeric settings)
+         */
+        size_t index = atoi(cmd->args);
+        const settings_desc_t *desc = settings_desc_at(index);
+        if (!desc || cmd->args[0] == '\0') { return false; }
+
+        size_t offset = sprintf(buf, "%d", index);
+        for (uint8_t i = 0; i < desc->choice_count; i++) {
+            offset += sprintf(buf + offset, ",%d,\"%s\"",
+                desc->choices[i].value, ui_str_lang(UI_LANGUAGE_EN, desc->choices[i].label));
+        }
+        cdc_send_command_response(cmd, buf);
+        return true;
+    } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "SETV") == 0) {
+        /* Split the arguments into the key and the value */
+        strcpy(buf, cmd->args);
+        char *p = strchr(buf, ',');
+        if (!p || *(p + 1) == '\0') { return false; }
+        *p++ = '\0';
+
+        const settings_desc_t *desc = settings_desc_find(buf);
+        if (!desc) { return false; }
+
+        if (settings_desc_set(desc, atoi(p))) {
+            cdc_send_command_response(cmd, "OK");
+        } else {
+            cdc_send_command_response(cmd, "ERR");
+        }
+        return true;
     } else if (cmd->type == CMD_TYPE_INVOKE && strcmp(cmd->action, "REMOTE") == 0) {
         bool enable;
         if (cmd->args[0] == '0' && cmd->args[1] == '\0') {
@@ -497,19 +584,19 @@ bool cdc_process_command_measurement(const cdc_command_t *cmd)
      * Measurement Commands
      * "GM REFL" -> Get last reflection measurement
      * "GM TRAN" -> Get last transmission measurement
-     * "SM FORMAT,x" -> Set measurement data format ("BASIC", "EXT")
+     * "SM FORMAT,x" -> Set measurement data format ("BASIC", "EXT", "EXT,U", "EXT,U,Q")
      * "SM UNCAL,x" -> Allow uncalibrated readings (0=false, 1=true)
      */
     if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "REFL") == 0) {
         char buf[32];
         float reading = densitometer_get_display_d(densitometer_reflection());
-        encode_f32(buf, reading);
+        cdc_encode_f32(buf, reading);
         cdc_send_command_response(cmd, buf);
         return true;
     } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "TRAN") == 0) {
         char buf[32];
         float reading = densitometer_get_display_d(densitometer_transmission());
-        encode_f32(buf, reading);
+        cdc_encode_f32(buf, reading);
         cdc_send_command_response(cmd, buf);
         return true;
     } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "FORMAT") == 0) {
@@ -517,6 +604,10 @@ bool cdc_process_command_measurement(const cdc_command_t *cmd)
             reading_format = READING_FORMAT_BASIC;
         } else if (strcmp(cmd->args, "EXT") == 0) {
             reading_format = READING_FORMAT_EXT;
+        } else if (strcmp(cmd->args, "EXT,U") == 0) {
+            reading_format = READING_FORMAT_EXT_UNCERTAINTY;
+        } else if (strcmp(cmd->args, "EXT,U,Q") == 0) {
+            reading_format = READING_FORMAT_EXT_QUALITY;
         } else {
             return false;
         }
@@ -541,6 +632,8 @@ bool cdc_process_command_calibration(const cdc_command_t *cmd)
     /*
      * Calibration Commands
      * "IC GAIN" -> Invoke the sensor gain calibration process [remote]
+     * "IC GAIN,RESUME" -> Resume an interrupted sensor gain calibration process [remote]
+     * "GC GAINCP" -> Get the saved sensor gain calibration checkpoint
      * "GC LIGHT" -> Get measurement light calibration values
      * "SC LIGHT" -> Set measurement light calibration values
      * "GC GAIN" -> Get sensor gain calibration values
@@ -551,15 +644,49 @@ bool cdc_process_command_calibration(const cdc_command_t *cmd)
      * "SC REFL" -> Set reflection density calibration values
      * "GC TRAN" -> Get transmission density calibration values
      * "SC TRAN" -> Set transmission density calibration values
+     * "GC TEMP" -> Get calibration temperatures and temperature coefficients
+     * "SC TEMP" -> Set temperature coefficients
+     * "GC PROFC" -> Get the number of calibration profile slots and the active slot
+     * "GC PROF,n" -> Get the name of the calibration profile in slot n
+     * "SC PROF,n" -> Select the calibration profile in slot n
+     * "SC PROFN,n,name" -> Rename the calibration profile in slot n
+     * "IC PROF,SAVE,n" -> Save the current calibration into slot n
+     * "IC PROF,COPY,n,m" -> Copy the calibration profile in slot n into slot m
+     * "IC PROF,CLEAR,n" -> Clear the calibration profile in slot n
+     * "GC PROFG,n" -> Get the gain values of the calibration profile in slot n
+     * "SC PROFG,n,..." -> Set the gain values of the calibration profile in slot n
+     * "GC PROFS,n" -> Get the slope values of the calibration profile in slot n
+     * "SC PROFS,n,..." -> Set the slope values of the calibration profile in slot n
+     * "GC PROFR,n" -> Get the reflection values of the calibration profile in slot n
+     * "SC PROFR,n,..." -> Set the reflection values of the calibration profile in slot n
+     * "GC PROFT,n" -> Get the transmission values of the calibration profile in slot n
+     * "SC PROFT,n,..." -> Set the transmission values of the calibration profile in slot n
      */
     if (cmd->type == CMD_TYPE_INVOKE && strcmp(cmd->action, "GAIN") == 0 && cdc_remote_active) {
-        osStatus_t result = sensor_gain_calibration(cdc_invoke_gain_calibration_callback, (void *)cmd);
+        osStatus_t result;
+        if (strlen(cmd->args) == 0) {
+            result = sensor_gain_calibration(cdc_invoke_gain_calibration_callback, (void *)cmd);
+        } else if (strcmp(cmd->args, "RESUME") == 0) {
+            result = sensor_gain_calibration_resume(cdc_invoke_gain_calibration_callback, (void *)cmd);
+        } else {
+            return false;
+        }
         if (result == osOK) {
             cdc_send_command_response(cmd, "OK");
         } else {
             cdc_send_command_response(cmd, "ERR");
         }
         return true;
+    } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "GAINCP") == 0) {
+        char buf[32];
+        settings_cal_gain_checkpoint_t checkpoint;
+
+        settings_get_cal_gain_checkpoint(&checkpoint);
+        sprintf(buf, "%d,%d,%d", checkpoint.stage,
+            checkpoint.measurement_brightness, checkpoint.max_gain_brightness);
+
+        cdc_send_command_response(cmd, buf);
+        return true;
     }
 #ifdef TEST_LIGHT_CAL
     else if (cmd->type == CMD_TYPE_INVOKE && strcmp(cmd->action, "LR") == 0 && cdc_remote_active) {
@@ -638,13 +765,13 @@ bool cdc_process_command_calibration(const cdc_command_t *cmd)
         gain_val[6] = cal_gain.ch0_maximum;
         gain_val[7] = cal_gain.ch1_maximum;
 
-        encode_f32_array_response(buf, gain_val, 8);
+        cdc_encode_f32_array(buf, gain_val, 8);
 
         cdc_send_command_response(cmd, buf);
         return true;
     } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "GAIN") == 0) {
-        float gain_val[6] = {0};
-        size_t n = decode_f32_array_args(cmd->args, gain_val, 8);
+        float gain_val[8] = {0};
+        size_t n = cdc_decode_f32_array(cmd->args, gain_val, 8);
         if (n == 6) {
             settings_cal_gain_t cal_gain = {0};
             cal_gain.ch0_medium = gain_val[0];
@@ -655,6 +782,7 @@ bool cdc_process_command_calibration(const cdc_command_t *cmd)
             cal_gain.ch1_maximum = gain_val[5];
 
             if (settings_set_cal_gain(&cal_gain)) {
+                sensor_record_cal_temperature(SENSOR_CAL_TEMP_GAIN);
                 cdc_send_command_response(cmd, "OK");
             } else {
                 cdc_send_command_response(cmd, "ERR");
@@ -672,13 +800,13 @@ bool cdc_process_command_calibration(const cdc_command_t *cmd)
         slope_val[0] = cal_slope.b0;
         slope_val[1] = cal_slope.b1;
         slope_val[2] = cal_slope.b2;
-        encode_f32_array_response(buf, slope_val, 3);
+        cdc_encode_f32_array(buf, slope_val, 3);
 
         cdc_send_command_response(cmd, buf);
         return true;
     } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "SLOPE") == 0) {
         float slope_val[3] = {0};
-        size_t n = decode_f32_array_args(cmd->args, slope_val, 3);
+        size_t n = cdc_decode_f32_array(cmd->args, slope_val, 3);
         if (n == 3) {
             settings_cal_slope_t cal_slope = {0};
             cal_slope.b0 = slope_val[0];
@@ -686,6 +814,7 @@ bool cdc_process_command_calibration(const cdc_command_t *cmd)
             cal_slope.b2 = slope_val[2];
 
             if (settings_set_cal_slope(&cal_slope)) {
+                sensor_record_cal_temperature(SENSOR_CAL_TEMP_SLOPE);
                 cdc_send_command_response(cmd, "OK");
             } else {
                 cdc_send_command_response(cmd, "ERR");
@@ -703,21 +832,24 @@ bool cdc_process_command_calibration(const cdc_command_t *cmd)
         refl_val[2] = cal_reflection.hi_d;
         refl_val[3] = cal_reflection.hi_value;
 
-        encode_f32_array_response(buf, refl_val, 4);
+        cdc_encode_f32_array(buf, refl_val, 4);
 
         cdc_send_command_response(cmd, buf);
         return true;
     } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "REFL") == 0) {
-        float refl_val[4] = {0};
-        size_t n = decode_f32_array_args(cmd->args, refl_val, 4);
-        if (n == 4) {
+        float refl_val[6] = {0};
+        size_t n = cdc_decode_f32_array(cmd->args, refl_val, 6);
+        if (n == 4 || n == 6) {
             settings_cal_reflection_t cal_reflection = {0};
             cal_reflection.lo_d = refl_val[0];
             cal_reflection.lo_value = refl_val[1];
             cal_reflection.hi_d = refl_val[2];
             cal_reflection.hi_value = refl_val[3];
+            cal_reflection.lo_unc = (n == 6) ? refl_val[4] : NAN;
+            cal_reflection.hi_unc = (n == 6) ? refl_val[5] : NAN;
 
             if (settings_set_cal_reflection(&cal_reflection)) {
+                sensor_record_cal_temperature(SENSOR_CAL_TEMP_REFLECTION);
                 cdc_send_command_response(cmd, "OK");
             } else {
                 cdc_send_command_response(cmd, "ERR");
@@ -736,25 +868,214 @@ bool cdc_process_command_calibration(const cdc_command_t *cmd)
         tran_val[2] = cal_transmission.hi_d;
         tran_val[3] = cal_transmission.hi_value;
 
-        encode_f32_array_response(buf, tran_val, 4);
+        cdc_encode_f32_array(buf, tran_val, 4);
 
         cdc_send_command_response(cmd, buf);
         return true;
     } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "TRAN") == 0) {
-        float tran_val[4] = {0};
-        size_t n = decode_f32_array_args(cmd->args, tran_val, 4);
-        if (n == 4 && tran_val[0] < 0.001F) {
+        float tran_val[5] = {0};
+        size_t n = cdc_decode_f32_array(cmd->args, tran_val, 5);
+        if ((n == 4 || n == 5) && tran_val[0] < 0.001F) {
             settings_cal_transmission_t cal_transmission = {0};
             cal_transmission.zero_value = tran_val[1];
             cal_transmission.hi_d = tran_val[2];
             cal_transmission.hi_value = tran_val[3];
+            cal_transmission.hi_unc = (n == 5) ? tran_val[4] : NAN;
 
             if (settings_set_cal_transmission(&cal_transmission)) {
+                sensor_record_cal_temperature(SENSOR_CAL_TEMP_TRANSMISSION);
+                cdc_send_command_response(cmd, "OK");
+            } else {
+                cdc_send_command_response(cmd, "ERR");
+            }
+
+            return true;
+        }
+    } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "TEMP") == 0) {
+        char buf[64];
+        settings_cal_temperature_t cal_temperature;
+        float temp_val[6] = {0};
+
+        settings_get_cal_temperature(&cal_temperature);
+        temp_val[0] = cal_temperature.gain_temp;
+        temp_val[1] = cal_temperature.slope_temp;
+        temp_val[2] = cal_temperature.reflection_temp;
+        temp_val[3] = cal_temperature.transmission_temp;
+        temp_val[4] = cal_temperature.coef_a;
+        temp_val[5] = cal_temperature.coef_b;
+
+        cdc_encode_f32_array(buf, temp_val, 6);
+
+        cdc_send_command_response(cmd, buf);
+        return true;
+    } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "TEMP") == 0) {
+        float temp_val[2] = {0};
+        size_t n = cdc_decode_f32_array(cmd->args, temp_val, 2);
+        if (n == 2) {
+            /* Only the coefficients are set, the temperatures are recorded by the device */
+            settings_cal_temperature_t cal_temperature;
+            settings_get_cal_temperature(&cal_temperature);
+            cal_temperature.coef_a = temp_val[0];
+            cal_temperature.coef_b = temp_val[1];
+
+            if (settings_validate_cal_temperature(&cal_temperature)
+                && settings_set_cal_temperature(&cal_temperature)) {
                 cdc_send_command_response(cmd, "OK");
             } else {
                 cdc_send_command_response(cmd, "ERR");
             }
 
+            return true;
+        }
+    } else if (strncmp(cmd->action, "PROF", 4) == 0) {
+        return cdc_process_command_cal_profile(cmd);
+    }
+
+    return false;
+}
+
+bool cdc_process_command_cal_profile(const cdc_command_t *cmd)
+{
+    char buf[64];
+    settings_cal_profile_t profile;
+
+    /* All profile commands except the slot count start with a slot number */
+    const char *p = cmd->args;
+    uint8_t index = SETTING_CAL_PROFILE_NONE;
+    if (isdigit((unsigned char)p[0])) {
+        index = (uint8_t)(p[0] - '0');
+        p++;
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return false;
+        }
+    }
+
+    if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "PROFC") == 0) {
+        uint8_t active = settings_get_active_cal_profile();
+        if (active == SETTING_CAL_PROFILE_NONE) {
+            sprintf(buf, "%d,", SETTING_CAL_PROFILE_COUNT);
+        } else {
+            sprintf(buf, "%d,%d", SETTING_CAL_PROFILE_COUNT, active);
+        }
+        cdc_send_command_response(cmd, buf);
+        return true;
+    } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "PROF") == 0) {
+        if (index < SETTING_CAL_PROFILE_COUNT && *p == '\0') {
+            if (settings_get_cal_profile(index, &profile)) {
+                sprintf(buf, "%d,%s", index, profile.name);
+            } else {
+                sprintf(buf, "%d,", index);
+            }
+            cdc_send_command_response(cmd, buf);
+            return true;
+        }
+    } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "PROF") == 0) {
+        if (index < SETTING_CAL_PROFILE_COUNT && *p == '\0') {
+            cdc_send_command_response(cmd, settings_select_cal_profile(index) ? "OK" : "ERR");
+            return true;
+        }
+    } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "PROFN") == 0) {
+        if (index < SETTING_CAL_PROFILE_COUNT && settings_validate_cal_profile_name(p)) {
+            if (settings_get_cal_profile(index, &profile)) {
+                strcpy(profile.name, p);
+                cdc_send_command_response(cmd, settings_set_cal_profile(index, &profile) ? "OK" : "ERR");
+            } else {
+                cdc_send_command_response(cmd, "ERR");
+            }
+            return true;
+        }
+    } else if (cmd->type == CMD_TYPE_INVOKE && strcmp(cmd->action, "PROF") == 0) {
+        /* Invoke commands put the operation ahead of the slot number */
+        const char *q = strchr(cmd->args, ',');
+        if (!q || !isdigit((unsigned char)q[1])) { return false; }
+        index = (uint8_t)(q[1] - '0');
+        if (index >= SETTING_CAL_PROFILE_COUNT) { return false; }
+
+        bool result;
+        if (strncmp(cmd->args, "SAVE,", 5) == 0 && q[2] == '\0') {
+            result = settings_save_cal_profile(index, NULL);
+        } else if (strncmp(cmd->args, "CLEAR,", 6) == 0 && q[2] == '\0') {
+            result = settings_clear_cal_profile(index);
+        } else if (strncmp(cmd->args, "COPY,", 5) == 0 && q[2] == ','
+                   && isdigit((unsigned char)q[3]) && q[4] == '\0') {
+            uint8_t dest = (uint8_t)(q[3] - '0');
+            if (dest >= SETTING_CAL_PROFILE_COUNT) { return false; }
+            result = settings_get_cal_profile(index, &profile) && settings_set_cal_profile(dest, &profile);
+        } else {
+            return false;
+        }
+        cdc_send_command_response(cmd, result ? "OK" : "ERR");
+        return true;
+    } else if (strlen(cmd->action) == 5 && index < SETTING_CAL_PROFILE_COUNT) {
+        /* Calibration values within a profile */
+        float values[6] = {0};
+        size_t first;
+        size_t len;
+        switch (cmd->action[4]) {
+        case 'G':
+            first = 0;
+            len = 6;
+            break;
+        case 'S':
+            first = 6;
+            len = 3;
+            break;
+        case 'R':
+            first = 9;
+            len = 4;
+            break;
+        case 'T':
+            first = 13;
+            len = 3;
+            break;
+        default:
+            return false;
+        }
+
+        /* Profile fields in the order of the value groups above */
+        bool valid = settings_get_cal_profile(index, &profile);
+        float *fields[] = {
+            &profile.gain.ch0_medium, &profile.gain.ch1_medium,
+            &profile.gain.ch0_high, &profile.gain.ch1_high,
+            &profile.gain.ch0_maximum, &profile.gain.ch1_maximum,
+            &profile.slope.b0, &profile.slope.b1, &profile.slope.b2,
+            &profile.reflection.lo_d, &profile.reflection.lo_value,
+            &profile.reflection.hi_d, &profile.reflection.hi_value,
+            &profile.transmission.zero_value, &profile.transmission.hi_d,
+            &profile.transmission.hi_value
+        };
+
+        if (cmd->type == CMD_TYPE_GET && *p == '\0') {
+            if (!valid) {
+                cdc_send_command_response(cmd, "ERR");
+                return true;
+            }
+            for (size_t i = 0; i < len; i++) {
+                values[i] = *fields[first + i];
+            }
+            sprintf(buf, "%d,", index);
+            cdc_encode_f32_array(buf + 2, values, len);
+            cdc_send_command_response(cmd, buf);
+            return true;
+        } else if (cmd->type == CMD_TYPE_SET && cdc_decode_f32_array(p, values, len) == len) {
+            /* Values can only be set into a slot that has already been named */
+            if (!valid) {
+                cdc_send_command_response(cmd, "ERR");
+                return true;
+            }
+            for (size_t i = 0; i < len; i++) {
+                *fields[first + i] = values[i];
+            }
+            /* The recorded uncertainty no longer applies to new target values */
+            if (cmd->action[4] == 'R') {
+                profile.reflection.lo_unc = NAN;
+                profile.reflection.hi_unc = NAN;
+            } else if (cmd->action[4] == 'T') {
+                profile.transmission.hi_unc = NAN;
+            }
+            cdc_send_command_response(cmd, settings_set_cal_profile(index, &profile) ? "OK" : "ERR");
             return true;
         }
     }
@@ -777,6 +1098,7 @@ bool cdc_process_command_diagnostics(const cdc_command_t *cmd)
     /*
      * Diagnostics Commands
      * "GD DISP" -> Get display screenshot (multi-line response)
+     * "GD CRASH" -> Get and clear the crash record (multi-line response)
      *
      * "SD LR,nnn" -> Set reflection light duty cycle (nnn/127) [remote]
      * "SD LT,nnn" -> Set transmission light duty cycle (nnn/127) [remote]
@@ -790,6 +1112,12 @@ bool cdc_process_command_diagnostics(const cdc_command_t *cmd)
      *
      * "ID WIPE,UIDw2,CKSUM" -> Factory reset of configuration EEPROM
      *
+     * "ID SELFTEST" -> Run the built-in self-test (multi-line response) [remote]
+     *
+     * "GD TEMP" -> Get the die temperature used for measurement compensation
+     * "SD TEMP,n.n" -> Override the die temperature used for measurement compensation
+     * "SD TEMP,OFF" -> Clear the die temperature override
+     *
      * "SD LOG,U" -> Set logging output to USB CDC device
      * "SD LOG,D" -> Set logging output to debug port UART
      */
@@ -801,6 +1129,52 @@ bool cdc_process_command_diagnostics(const cdc_command_t *cmd)
         display_capture_screenshot();
         cdc_send_response("]]\r\n");
         return true;
+    } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "CRASH") == 0) {
+        const crash_record_t *crash_record = crash_record_get();
+        if (!crash_record) {
+            cdc_send_command_response(cmd, "NONE");
+            return true;
+        }
+
+        /* Send the raw record as lines of hex, for decoding on the host */
+        char buf[CRASH_RECORD_LINE_SIZE];
+        cdc_send_command_response(cmd, "[[");
+        for (size_t i = 0; i < sizeof(crash_record_t); i += CRASH_RECORD_LINE_BYTES) {
+            size_t n = crash_record_format_line(crash_record, i, buf);
+            cdc_write(buf, n);
+        }
+        cdc_send_response("]]\r\n");
+
+        crash_record_clear();
+        return true;
+    } else if (cmd->type == CMD_TYPE_GET && strcmp(cmd->action, "TEMP") == 0) {
+        /*
+         * Output format:
+         * Temperature, Override active (0/1)
+         */
+        char buf[32];
+        float temp_c = sensor_read_temperature();
+        if (!isnanf(temp_c)) {
+            sprintf_(buf, "%.1fC,%d", temp_c, isnanf(sensor_get_temperature_override()) ? 0 : 1);
+            cdc_send_command_response(cmd, buf);
+        } else {
+            cdc_send_command_response(cmd, "ERR");
+        }
+        return true;
+    } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "TEMP") == 0) {
+        if (strcmp(cmd->args, "OFF") == 0) {
+            sensor_set_temperature_override(NAN);
+            cdc_send_command_response(cmd, "OK");
+            return true;
+        } else if (cmd->args[0] != '\0') {
+            char *endptr = NULL;
+            float temp_c = strtof(cmd->args, &endptr);
+            if (endptr && *endptr == '\0' && temp_c >= -40.0F && temp_c <= 125.0F) {
+                sensor_set_temperature_override(temp_c);
+                cdc_send_command_response(cmd, "OK");
+                return true;
+            }
+        }
     } else if (cmd->type == CMD_TYPE_SET && strcmp(cmd->action, "LR") == 0 && cdc_remote_active) {
         uint8_t value = atoi(cmd->args);
         if (value > 128) { value = 128; }
@@ -893,6 +1267,20 @@ bool cdc_process_command_diagnostics(const cdc_command_t *cmd)
             }
             return true;
         }
+    } else if (cmd->type == CMD_TYPE_INVOKE && strcmp(cmd->action, "SELFTEST") == 0
+        && cdc_remote_active && !cdc_remote_sensor_active) {
+        /*
+         * Output format, one line per check followed by a summary line:
+         * Check name, PASS/FAIL/SKIP, Value
+         * RESULT, PASS/FAIL, Failure count
+         */
+        char buf[SELFTEST_LINE_SIZE];
+        cdc_send_command_response(cmd, "[[");
+        uint8_t failures = selftest_run(cdc_send_selftest_result, NULL);
+        size_t n = selftest_policy_format_summary(buf, sizeof(buf), failures);
+        cdc_write(buf, n);
+        cdc_send_response("]]\r\n");
+        return true;
     } else if (cmd->type == CMD_TYPE_INVOKE && strcmp(cmd->action, "WIPE") == 0 && cdc_remote_active) {
         char exp_buf[32];
         const app_descriptor_t *app_descriptor = app_descriptor_get();
@@ -928,6 +1316,13 @@ bool cdc_process_command_diagnostics(const cdc_command_t *cmd)
     return false;
 }
 
+void cdc_send_selftest_result(selftest_check_t check, const selftest_result_t *result, void *user_data)
+{
+    char buf[SELFTEST_LINE_SIZE];
+    size_t n = selftest_policy_format_result(buf, sizeof(buf), check, result);
+    cdc_write(buf, n);
+}
+
 void cdc_send_response(const char *str)
 {
     size_t len = strlen(str);
@@ -976,7 +1371,8 @@ void cdc_send_command_response(const cdc_command_t *cmd, const char *str)
     cdc_write(buf, n);
 }
 
-void cdc_send_density_reading(char prefix, float d_value, float d_zero, float raw_value, float corr_value)
+void cdc_send_density_reading(char prefix, float d_value, float d_zero, float raw_value, float corr_value,
+    float d_uncertainty, uint8_t quality)
 {
     float d_display;
     char buf[16];
@@ -1012,18 +1408,26 @@ void cdc_send_density_reading(char prefix, float d_value, float d_zero, float ra
         buf[1] = '+';
     }
 
-    if (reading_format == READING_FORMAT_EXT) {
-        char extbuf[48];
+    if (reading_format == READING_FORMAT_EXT || reading_format == READING_FORMAT_EXT_UNCERTAINTY
+        || reading_format == READING_FORMAT_EXT_QUALITY) {
+        char extbuf[64];
         n -= 2;
         strncpy(extbuf, buf, n);
         extbuf[n++] = ',';
-        n += encode_f32(extbuf + n, d_value);
+        n += cdc_encode_f32(extbuf + n, d_value);
         extbuf[n++] = ',';
-        n += encode_f32(extbuf + n, d_zero);
+        n += cdc_encode_f32(extbuf + n, d_zero);
         extbuf[n++] = ',';
-        n += encode_f32(extbuf + n, raw_value);
+        n += cdc_encode_f32(extbuf + n, raw_value);
         extbuf[n++] = ',';
-        n += encode_f32(extbuf + n, corr_value);
+        n += cdc_encode_f32(extbuf + n, corr_value);
+        if (reading_format == READING_FORMAT_EXT_UNCERTAINTY || reading_format == READING_FORMAT_EXT_QUALITY) {
+            extbuf[n++] = ',';
+            n += cdc_encode_f32(extbuf + n, d_uncertainty);
+        }
+        if (reading_format == READING_FORMAT_EXT_QUALITY) {
+            n += sprintf_(extbuf + n, ",%02X", quality);
+        }
         extbuf[n++] = '\r';
         extbuf[n++] = '\n';
         extbuf[n] = '\0';
@@ -1094,97 +1498,4 @@ void cdc_write(const char *buf, size_t len)
     osMutexRelease(cdc_mutex);
 }
 
-void encode_f32_array_response(char *buf, const float *array, size_t len)
-{
-    size_t offset = 0;
-    for (size_t i = 0; i < len; i++) {
-        if (i > 0) {
-            buf[offset++] = ',';
-        }
-        offset += encode_f32(buf + offset, array[i]);
-    }
-    buf[offset] = '\0';
-}
-
-size_t encode_f32(char *out, float value)
-{
-    uint8_t buf[4];
-    memset(buf, 0, sizeof(buf));
-    copy_from_f32(buf, value);
-    return sprintf(out, "%02X%02X%02X%02X", buf[0], buf[1], buf[2], buf[3]);
-}
-
-uint8_t decode_hex_char(char ch, bool *ok)
-{
-    uint8_t val;
-    bool valid = true;
-    if ('0' <= ch && ch <= '9') {
-        val = (uint8_t)(ch - '0');
-    } else if ('A' <= ch && ch <= 'F') {
-        val = (uint8_t)(ch - 'A' + 10);
-    } else if ('a' <= ch && ch <= 'f') {
-        val = (uint8_t)(ch - 'a' + 10);
-    } else {
-        val = 0;
-        valid = false;
-    }
-    if (ok) { *ok = valid; }
-    return val;
-}
-
-float decode_f32(const char *buf)
-{
-    uint8_t hexbuf[4];
-    uint8_t nib1;
-    uint8_t nib2;
-    bool ok;
-
-    if (strlen(buf) != 8) {
-        return NAN;
-    }
-
-    for (size_t i = 0; i < 8; i += 2) {
-        nib1 = decode_hex_char(buf[i], &ok);
-        if (!ok) { return NAN; }
-
-        nib2 = decode_hex_char(buf[i + 1], &ok);
-        if (!ok) { return NAN; }
 
-        hexbuf[i / 2] = (nib1 << 4) + nib2;
-    }
-
-    return copy_to_f32(hexbuf);
-}
-
-size_t decode_f32_array_args(const char *args, float *elements, size_t len)
-{
-    char numbuf[16];
-    size_t n = 0;
-    size_t p, q;
-
-    p = 0;
-    q = p;
-    while (n < len) {
-        if (args[q] == ',' || args[q] == '\0') {
-            if (p >= q) { break; }
-            if (q - p < sizeof(numbuf) - 1) {
-                bzero(numbuf, sizeof(numbuf));
-                strncpy(numbuf, args + p, q - p);
-                elements[n] = decode_f32(numbuf);
-            } else {
-                elements[n] = NAN;
-            }
-            n++;
-            if (args[q] == '\0') {
-                break;
-            } else {
-                p = q + 1;
-                q = p;
-            }
-        } else {
-            q++;
-        }
-    }
-
-    return n;
-}
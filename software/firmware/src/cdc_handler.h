@@ -6,6 +6,14 @@
 
 #include "sensor.h"
 
+/**
+ * Version of the host protocol implemented by this firmware.
+ *
+ * This is recorded in the app descriptor, and should be incremented
+ * whenever a change is made that host software needs to know about.
+ */
+#define CDC_PROTOCOL_VERSION 1
+
 void task_cdc_run(void *argument);
 
 /**
@@ -29,8 +37,11 @@ bool cdc_is_connected();
  * @param d_zero The density "zero" offset
  * @param raw_value The raw sensor reading, in basic counts
  * @param corr_value The slope corrected sensor reading, in basic counts
+ * @param d_uncertainty The standard uncertainty of the density reading
+ * @param quality The quality flags of the reading, as SENSOR_QUALITY_* values
  */
-void cdc_send_density_reading(char prefix, float d_value, float d_zero, float raw_value, float corr_value);
+void cdc_send_density_reading(char prefix, float d_value, float d_zero, float raw_value, float corr_value,
+    float d_uncertainty, uint8_t quality);
 
 /**
  * Send a message containing raw sensor data for diagnostic purposes
@@ -0,0 +1,218 @@
+#include "crash_record.h"
+
+#include "stm32l0xx_hal.h"
+
+#include <string.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "app_descriptor.h"
+#include "crash_record_format.h"
+
+/* End of the RAM available to the stack, from the linker script */
+extern uint32_t _estack;
+
+/*
+ * The crash record lives in its own linker section, which is placed
+ * in a region of RAM that neither the bootloader nor the startup code
+ * will touch. This allows it to persist across a warm reset.
+ */
+static crash_record_t crash_record __attribute__((section(".noinit")));
+
+static char log_tail_buf[CRASH_RECORD_LOG_LEN];
+static size_t log_tail_pos = 0;
+static bool log_tail_wrapped = false;
+static bool log_tail_escape = false;
+
+static void crash_record_fill(crash_type_t type, const uint32_t *frame, uint32_t sp);
+static void crash_record_copy_log_tail(char *out);
+
+void crash_record_init(uint32_t reset_flags)
+{
+    /*
+     * The contents of RAM are undefined after a power-on reset,
+     * so the record is only trusted after some type of warm reset.
+     */
+    if ((reset_flags & RCC_CSR_PORRSTF) || !crash_record_get()) {
+        crash_record_clear();
+    }
+}
+
+const crash_record_t *crash_record_get()
+{
+    if (!crash_record_is_valid(&crash_record)) {
+        return NULL;
+    }
+    return &crash_record;
+}
+
+void crash_record_clear()
+{
+    memset(&crash_record, 0, sizeof(crash_record_t));
+}
+
+void crash_record_log_append(const char *log, size_t size)
+{
+    if (!log) { return; }
+
+    for (size_t i = 0; i < size; i++) {
+        char ch = log[i];
+
+        /* Skip terminal color sequences, which waste space in the buffer */
+        if (log_tail_escape) {
+            if ((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z')) {
+                log_tail_escape = false;
+            }
+            continue;
+        } else if (ch == '\033') {
+            log_tail_escape = true;
+            continue;
+        } else if (ch == '\r') {
+            continue;
+        }
+
+        log_tail_buf[log_tail_pos++] = ch;
+        if (log_tail_pos >= CRASH_RECORD_LOG_LEN) {
+            log_tail_pos = 0;
+            log_tail_wrapped = true;
+        }
+    }
+}
+
+void crash_record_capture_fault(crash_type_t type, const uint32_t *frame)
+{
+    /* Ignore the frame if it does not point somewhere sensible */
+    if ((uint32_t)frame < SRAM_BASE || (uint32_t)(frame + 8) > (uint32_t)&_estack) {
+        crash_record_fill(type, NULL, (uint32_t)frame);
+    } else {
+        crash_record_fill(type, frame, (uint32_t)(frame + 8));
+    }
+}
+
+void crash_record_capture(crash_type_t type, const char *detail)
+{
+    uint32_t sp;
+    if (__get_CONTROL() & CONTROL_SPSEL_Msk) {
+        sp = __get_PSP();
+    } else {
+        sp = __get_MSP();
+    }
+
+    crash_record_fill(type, NULL, sp);
+
+    /* There is no stacked frame, so use the caller as the crash location */
+    crash_record.lr = (uint32_t)__builtin_return_address(0);
+    crash_record.pc = crash_record.lr;
+
+    if (detail) {
+        strncpy(crash_record.detail, detail, CRASH_RECORD_DETAIL_LEN - 1);
+    }
+
+    crash_record.checksum = crash_record_checksum(&crash_record);
+}
+
+void crash_record_capture_task(crash_type_t type, const char *task_name,
+    const uint32_t *frame, const char *detail)
+{
+    if (frame) {
+        crash_record_capture_fault(type, frame);
+    } else {
+        crash_record_fill(type, NULL, 0);
+    }
+
+    memset(crash_record.task_name, 0, CRASH_RECORD_TASK_LEN);
+    if (task_name) {
+        strncpy(crash_record.task_name, task_name, CRASH_RECORD_TASK_LEN - 1);
+    }
+    if (detail) {
+        strncpy(crash_record.detail, detail, CRASH_RECORD_DETAIL_LEN - 1);
+    }
+
+    crash_record.checksum = crash_record_checksum(&crash_record);
+}
+
+void crash_record_reset()
+{
+    __disable_irq();
+#ifdef DEBUG
+    __ASM volatile("BKPT #01");
+#endif
+    NVIC_SystemReset();
+    while (1) { }
+}
+
+void crash_record_fill(crash_type_t type, const uint32_t *frame, uint32_t sp)
+{
+    memset(&crash_record, 0, sizeof(crash_record_t));
+
+    crash_record.magic = CRASH_RECORD_MAGIC;
+    crash_record.version = CRASH_RECORD_VERSION;
+    crash_record.size = sizeof(crash_record_t);
+    crash_record.type = type;
+    /* The HAL tick is stopped during tickless idle, so use the kernel tick once running */
+    if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+        crash_record.uptime = xTaskGetTickCount();
+    } else {
+        crash_record.uptime = HAL_GetTick();
+    }
+    crash_record.app_crc32 = app_descriptor_get()->crc32;
+
+    if (frame) {
+        crash_record.r0 = frame[0];
+        crash_record.r1 = frame[1];
+        crash_record.r2 = frame[2];
+        crash_record.r3 = frame[3];
+        crash_record.r12 = frame[4];
+        crash_record.lr = frame[5];
+        crash_record.pc = frame[6];
+        crash_record.psr = frame[7];
+    }
+
+    crash_record.sp = sp;
+    crash_record.icsr = SCB->ICSR;
+    crash_record.shcsr = SCB->SHCSR;
+
+    if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+        const char *name = pcTaskGetName(NULL);
+        if (name) {
+            strncpy(crash_record.task_name, name, CRASH_RECORD_TASK_LEN - 1);
+        }
+    }
+
+    /* Copy as much of the stack as is actually within RAM */
+    if (sp >= SRAM_BASE && (sp & 0x3UL) == 0) {
+        const uint32_t *stack = (const uint32_t *)sp;
+        for (size_t i = 0; i < CRASH_RECORD_STACK_WORDS; i++) {
+            if ((uint32_t)(stack + i + 1) > (uint32_t)&_estack) {
+                break;
+            }
+            crash_record.stack[i] = stack[i];
+        }
+    }
+
+    crash_record_copy_log_tail(crash_record.log_tail);
+
+    crash_record.checksum = crash_record_checksum(&crash_record);
+}
+
+void crash_record_copy_log_tail(char *out)
+{
+    /*
+     * Unwrap the ring buffer so the oldest data comes first, leaving room
+     * for a terminating null.
+     */
+    size_t len;
+    size_t start;
+    if (log_tail_wrapped) {
+        len = CRASH_RECORD_LOG_LEN - 1;
+        start = (log_tail_pos + 1) % CRASH_RECORD_LOG_LEN;
+    } else {
+        len = log_tail_pos;
+        start = 0;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        out[i] = log_tail_buf[(start + i) % CRASH_RECORD_LOG_LEN];
+    }
+    out[len] = '\0';
+}
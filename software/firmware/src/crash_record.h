@@ -0,0 +1,137 @@
+/*
+ * Crash record capture, stored in a region of RAM that is not
+ * initialized on startup so that it survives a warm reset.
+ */
+#ifndef CRASH_RECORD_H
+#define CRASH_RECORD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CRASH_RECORD_MAGIC       0x48535243UL /* "CRSH" */
+#define CRASH_RECORD_VERSION     1
+#define CRASH_RECORD_TASK_LEN    16
+#define CRASH_RECORD_DETAIL_LEN  32
+#define CRASH_RECORD_STACK_WORDS 16
+#define CRASH_RECORD_LOG_LEN     192
+
+/**
+ * Cause of the captured crash.
+ */
+typedef enum {
+    CRASH_TYPE_NONE = 0,
+    CRASH_TYPE_HARD_FAULT,
+    CRASH_TYPE_NMI,
+    CRASH_TYPE_STACK_OVERFLOW,
+    CRASH_TYPE_MALLOC_FAILED,
+    CRASH_TYPE_ASSERT,
+    CRASH_TYPE_ERROR_HANDLER,
+    CRASH_TYPE_WATCHDOG
+} crash_type_t;
+
+/**
+ * Crash record data structure.
+ *
+ * This structure is transferred to the host as-is, so its layout must
+ * only change along with an increment of the version field.
+ */
+typedef struct {
+    uint32_t magic;         /*!< Set to CRASH_RECORD_MAGIC when valid */
+    uint16_t version;       /*!< Structure version */
+    uint16_t size;          /*!< Structure size, in bytes */
+    uint32_t checksum;      /*!< CRC-32 of everything after this field */
+    uint32_t type;          /*!< Crash cause, from crash_type_t */
+    uint32_t uptime;        /*!< Tick count at the time of the crash */
+    uint32_t app_crc32;     /*!< Checksum from the app descriptor */
+    uint32_t r0;            /*!< Stacked R0 */
+    uint32_t r1;            /*!< Stacked R1 */
+    uint32_t r2;            /*!< Stacked R2 */
+    uint32_t r3;            /*!< Stacked R3 */
+    uint32_t r12;           /*!< Stacked R12 */
+    uint32_t lr;            /*!< Stacked LR */
+    uint32_t pc;            /*!< Stacked PC */
+    uint32_t psr;           /*!< Stacked xPSR */
+    uint32_t sp;            /*!< Stack pointer at the time of the crash */
+    uint32_t icsr;          /*!< Interrupt Control and State Register */
+    uint32_t shcsr;         /*!< System Handler Control and State Register */
+    char task_name[CRASH_RECORD_TASK_LEN];     /*!< Name of the active task */
+    char detail[CRASH_RECORD_DETAIL_LEN];      /*!< Cause-specific detail text */
+    uint32_t stack[CRASH_RECORD_STACK_WORDS];  /*!< Stack excerpt, starting at SP */
+    char log_tail[CRASH_RECORD_LOG_LEN];       /*!< Most recent log output */
+} crash_record_t;
+
+#ifndef __CDT_PARSER__
+_Static_assert(sizeof(crash_record_t) == 372, "crash_record_t should be 372 bytes");
+#endif
+
+/**
+ * Validate the crash record left over from before the last reset.
+ *
+ * This must be called early in the startup process. If the last reset
+ * was a power-on reset, or the record is not intact, then it is cleared.
+ *
+ * @param reset_flags Reset cause flags, in the format of RCC->CSR
+ */
+void crash_record_init(uint32_t reset_flags);
+
+/**
+ * Get the crash record left over from before the last reset.
+ *
+ * @return Pointer to the record, or NULL if there is no valid record
+ */
+const crash_record_t *crash_record_get();
+
+/**
+ * Clear the crash record.
+ */
+void crash_record_clear();
+
+/**
+ * Append data to the log tail buffer.
+ *
+ * This should be called by the log output port with all log data,
+ * so the most recent output can be included in a crash record.
+ * Terminal escape sequences are stripped from the buffered data.
+ *
+ * @param log Log data
+ * @param size Length of the log data
+ */
+void crash_record_log_append(const char *log, size_t size);
+
+/**
+ * Capture a crash record from a hard fault exception.
+ *
+ * @param type Crash cause
+ * @param frame Exception stack frame, as pushed by the processor
+ */
+void crash_record_capture_fault(crash_type_t type, const uint32_t *frame);
+
+/**
+ * Capture a crash record from a software detected failure.
+ *
+ * @param type Crash cause
+ * @param detail Cause-specific detail text, may be NULL
+ */
+void crash_record_capture(crash_type_t type, const char *detail);
+
+/**
+ * Capture a crash record on behalf of a task other than the current one,
+ * such as one that has stopped responding.
+ *
+ * @param type Crash cause
+ * @param task_name Name of the task responsible for the crash
+ * @param frame Exception stack frame saved when the task was switched out, may be NULL
+ * @param detail Cause-specific detail text, may be NULL
+ */
+void crash_record_capture_task(crash_type_t type, const char *task_name,
+    const uint32_t *frame, const char *detail);
+
+/**
+ * Reset the system after a crash record has been captured.
+ *
+ * In debug builds, this will break into the debugger first.
+ */
+void crash_record_reset() __attribute__((noreturn));
+
+#endif /* CRASH_RECORD_H */
@@ -0,0 +1,50 @@
+#include "crash_record_format.h"
+
+uint32_t crash_record_checksum(const crash_record_t *record)
+{
+    /*
+     * This is a plain software CRC-32, since it may need to run before
+     * the CRC peripheral is initialized or after it is left in an
+     * unknown state.
+     */
+    const uint8_t *data = (const uint8_t *)record + offsetof(crash_record_t, type);
+    size_t len = sizeof(crash_record_t) - offsetof(crash_record_t, type);
+    uint32_t crc = 0xFFFFFFFFUL;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (uint8_t j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1UL)));
+        }
+    }
+
+    return ~crc;
+}
+
+bool crash_record_is_valid(const crash_record_t *record)
+{
+    return record
+        && record->magic == CRASH_RECORD_MAGIC
+        && record->version == CRASH_RECORD_VERSION
+        && record->size == sizeof(crash_record_t)
+        && record->checksum == crash_record_checksum(record);
+}
+
+size_t crash_record_format_line(const crash_record_t *record, size_t offset, char *buf)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    const uint8_t *data = (const uint8_t *)record;
+    size_t n = 0;
+
+    for (size_t i = offset; i < offset + CRASH_RECORD_LINE_BYTES && i < sizeof(crash_record_t); i++) {
+        buf[n++] = hex[data[i] >> 4];
+        buf[n++] = hex[data[i] & 0x0F];
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    buf[n++] = '\r';
+    buf[n++] = '\n';
+    return n;
+}
@@ -0,0 +1,44 @@
+#ifndef CRASH_RECORD_FORMAT_H
+#define CRASH_RECORD_FORMAT_H
+
+/*
+ * Validation and transfer encoding of the crash record.
+ *
+ * These functions only depend on the C standard library, so that the
+ * record format can be built and exercised on a host machine separately
+ * from the capture code in crash_record.c.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "crash_record.h"
+
+/* Record bytes sent on each line of the "GD CRASH" response */
+#define CRASH_RECORD_LINE_BYTES 32
+
+/* Buffer size needed for one line, including the line ending */
+#define CRASH_RECORD_LINE_SIZE  ((CRASH_RECORD_LINE_BYTES * 2) + 2)
+
+/**
+ * Calculate the CRC-32 of everything after the checksum field.
+ */
+uint32_t crash_record_checksum(const crash_record_t *record);
+
+/**
+ * Check whether the record header and checksum are intact.
+ */
+bool crash_record_is_valid(const crash_record_t *record);
+
+/**
+ * Format one line of the record, as hex, for transfer to the host.
+ *
+ * @param record Record to format
+ * @param offset Offset of the first byte on the line, a multiple of CRASH_RECORD_LINE_BYTES
+ * @param buf Buffer of at least CRASH_RECORD_LINE_SIZE bytes
+ * @return Length of the line, or 0 once the offset is past the end of the record
+ */
+size_t crash_record_format_line(const crash_record_t *record, size_t offset, char *buf);
+
+#endif /* CRASH_RECORD_FORMAT_H */
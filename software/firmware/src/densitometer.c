@@ -13,12 +13,16 @@
 #include "cdc_handler.h"
 #include "hid_handler.h"
 #include "util.h"
+#include "density_calc.h"
 
 static densitometer_result_t reflection_measure(densitometer_t *densitometer, sensor_read_callback_t callback, void *user_data);
 static densitometer_result_t transmission_measure(densitometer_t *densitometer, sensor_read_callback_t callback, void *user_data);
+static float densitometer_temperature_factor(float corr_value, float ref_temp_c);
 
 struct __densitometer_t {
     float last_d;
+    float last_uncertainty;
+    uint8_t last_quality;
     float zero_d;
     const float max_d;
     const sensor_light_t read_light;
@@ -27,6 +31,8 @@ struct __densitometer_t {
 
 static densitometer_t reflection_data = {
     .last_d = NAN,
+    .last_uncertainty = NAN,
+    .last_quality = SENSOR_QUALITY_OK,
     .zero_d = NAN,
     .max_d = REFLECTION_MAX_D,
     .read_light = SENSOR_LIGHT_REFLECTION,
@@ -35,6 +41,8 @@ static densitometer_t reflection_data = {
 
 static densitometer_t transmission_data = {
     .last_d = NAN,
+    .last_uncertainty = NAN,
+    .last_quality = SENSOR_QUALITY_OK,
     .zero_d = NAN,
     .max_d = TRANSMISSION_MAX_D,
     .read_light = SENSOR_LIGHT_TRANSMISSION,
@@ -62,7 +70,12 @@ densitometer_result_t densitometer_measure(densitometer_t *densitometer, sensor_
 {
     if (!densitometer) { return DENSITOMETER_CAL_ERROR; }
 
-    return densitometer->measure_func(densitometer, callback, user_data);
+    /* Keep the calibration profile from changing partway through the measurement */
+    settings_cal_lock();
+    densitometer_result_t result = densitometer->measure_func(densitometer, callback, user_data);
+    settings_cal_unlock();
+
+    return result;
 }
 
 void densitometer_set_idle_light(const densitometer_t *densitometer, bool enabled)
@@ -90,6 +103,7 @@ void densitometer_set_idle_light(const densitometer_t *densitometer, bool enable
 densitometer_result_t reflection_measure(densitometer_t *densitometer, sensor_read_callback_t callback, void *user_data)
 {
     settings_cal_reflection_t cal_reflection;
+    settings_cal_temperature_t cal_temperature;
     bool use_target_cal = true;
 
     /* Get the current calibration values */
@@ -100,10 +114,13 @@ densitometer_result_t reflection_measure(densitometer_t *densitometer, sensor_re
             return DENSITOMETER_CAL_ERROR;
         }
     }
+    settings_get_cal_temperature(&cal_temperature);
 
     /* Perform sensor read */
     float ch0_basic;
-    if (sensor_read_target(densitometer->read_light, &ch0_basic, NULL, callback, user_data) != osOK) {
+    float ch0_unc;
+    uint8_t quality;
+    if (sensor_read_target(densitometer->read_light, &ch0_basic, NULL, &ch0_unc, &quality, callback, user_data) != osOK) {
         log_w("Sensor read error");
         densitometer_set_idle_light(densitometer, true);
         return DENSITOMETER_SENSOR_ERROR;
@@ -111,39 +128,44 @@ densitometer_result_t reflection_measure(densitometer_t *densitometer, sensor_re
 
     /* Combine and correct the basic reading */
     float corr_value = sensor_apply_slope_calibration(ch0_basic);
+    float corr_unc = sensor_apply_slope_calibration_uncertainty(ch0_basic, ch0_unc);
 
-    if (use_target_cal) {
-        /* Convert all values into log units */
-        float meas_ll = log10f(corr_value);
-        float cal_hi_ll = log10f(cal_reflection.hi_value);
-        float cal_lo_ll = log10f(cal_reflection.lo_value);
-
-        /* Calculate the slope of the line */
-        float m = (cal_reflection.hi_d - cal_reflection.lo_d) / (cal_hi_ll - cal_lo_ll);
+    /* Compensate for any die temperature change since target calibration */
+    float temp_factor = densitometer_temperature_factor(corr_value, cal_temperature.reflection_temp);
+    corr_value *= temp_factor;
+    corr_unc *= temp_factor;
 
+    if (use_target_cal) {
         /* Calculate the measured density */
-        float meas_d = (m * (meas_ll - cal_lo_ll)) + cal_reflection.lo_d;
+        float meas_d = density_calc_reflection(corr_value, corr_unc,
+            cal_reflection.lo_d, cal_reflection.lo_value, cal_reflection.lo_unc,
+            cal_reflection.hi_d, cal_reflection.hi_value, cal_reflection.hi_unc,
+            &densitometer->last_uncertainty);
 
-        log_i("D=%.2f, VALUE=%f,%f", meas_d, ch0_basic, corr_value);
+        log_i("D=%.2f, VALUE=%f,%f, U=%.3f", meas_d, ch0_basic, corr_value, densitometer->last_uncertainty);
 
         /* Clamp the return value to be within an acceptable range */
         if (meas_d <= 0.0F) { meas_d = 0.0F; }
         else if (meas_d > densitometer->max_d) { meas_d = densitometer->max_d; }
 
         densitometer->last_d = meas_d;
+        densitometer->last_quality = quality;
 
     } else {
         log_i("D=<uncal>, VALUE=%f,%f", ch0_basic, corr_value);
 
         /* Assign a default reading when missing target calibration */
         densitometer->last_d = 0.0F;
+        densitometer->last_uncertainty = NAN;
+        densitometer->last_quality = quality;
     }
 
     /* Set light back to idle */
     densitometer_set_idle_light(densitometer, true);
 
     if (cdc_is_connected()) {
-        cdc_send_density_reading('R', densitometer->last_d, densitometer->zero_d, ch0_basic, corr_value);
+        cdc_send_density_reading('R', densitometer->last_d, densitometer->zero_d, ch0_basic, corr_value,
+            densitometer->last_uncertainty, densitometer->last_quality);
     } else {
         hid_send_density_reading('R', densitometer->last_d, densitometer->zero_d);
     }
@@ -154,6 +176,7 @@ densitometer_result_t reflection_measure(densitometer_t *densitometer, sensor_re
 densitometer_result_t transmission_measure(densitometer_t *densitometer, sensor_read_callback_t callback, void *user_data)
 {
     settings_cal_transmission_t cal_transmission;
+    settings_cal_temperature_t cal_temperature;
     bool use_target_cal = true;
 
     /* Get the current calibration values */
@@ -164,10 +187,13 @@ densitometer_result_t transmission_measure(densitometer_t *densitometer, sensor_
             return DENSITOMETER_CAL_ERROR;
         }
     }
+    settings_get_cal_temperature(&cal_temperature);
 
     /* Perform sensor read */
     float ch0_basic;
-    if (sensor_read_target(densitometer->read_light, &ch0_basic, NULL, callback, user_data) != osOK) {
+    float ch0_unc;
+    uint8_t quality;
+    if (sensor_read_target(densitometer->read_light, &ch0_basic, NULL, &ch0_unc, &quality, callback, user_data) != osOK) {
         log_w("Sensor read error");
         densitometer_set_idle_light(densitometer, true);
         return DENSITOMETER_SENSOR_ERROR;
@@ -175,40 +201,44 @@ densitometer_result_t transmission_measure(densitometer_t *densitometer, sensor_
 
     /* Combine and correct the basic reading */
     float corr_value = sensor_apply_slope_calibration(ch0_basic);
+    float corr_unc = sensor_apply_slope_calibration_uncertainty(ch0_basic, ch0_unc);
 
-    if (use_target_cal) {
-        /* Calculate the measured CAL-HI density relative to the zero value */
-        float cal_hi_meas_d = -1.0F * log10f(cal_transmission.hi_value / cal_transmission.zero_value);
-
-        /* Calculate the measured target density relative to the zero value */
-        float meas_d = -1.0F * log10f(corr_value / cal_transmission.zero_value);
-
-        /* Calculate the adjustment factor */
-        float adj_factor = cal_transmission.hi_d / cal_hi_meas_d;
+    /* Compensate for any die temperature change since target calibration */
+    float temp_factor = densitometer_temperature_factor(corr_value, cal_temperature.transmission_temp);
+    corr_value *= temp_factor;
+    corr_unc *= temp_factor;
 
+    if (use_target_cal) {
         /* Calculate the calibration corrected density */
-        float corr_d = meas_d * adj_factor;
+        float corr_d = density_calc_transmission(corr_value, corr_unc,
+            cal_transmission.zero_value, cal_transmission.hi_d,
+            cal_transmission.hi_value, cal_transmission.hi_unc,
+            &densitometer->last_uncertainty);
 
-        log_i("D=%.2f, VALUE=%f,%f", corr_d, ch0_basic, corr_value);
+        log_i("D=%.2f, VALUE=%f,%f, U=%.3f", corr_d, ch0_basic, corr_value, densitometer->last_uncertainty);
 
         /* Clamp the return value to be within an acceptable range */
         if (corr_d <= 0.0F) { corr_d = 0.0F; }
         else if (corr_d > densitometer->max_d) { corr_d = densitometer->max_d; }
 
         densitometer->last_d = corr_d;
+        densitometer->last_quality = quality;
 
     } else {
         log_i("D=<uncal>, VALUE=%f,%f", ch0_basic, corr_value);
 
         /* Assign a default reading when missing target calibration */
         densitometer->last_d = 0.0F;
+        densitometer->last_uncertainty = NAN;
+        densitometer->last_quality = quality;
     }
 
     /* Set light back to idle */
     densitometer_set_idle_light(densitometer, true);
 
     if (cdc_is_connected()) {
-        cdc_send_density_reading('T', densitometer->last_d, densitometer->zero_d, ch0_basic, corr_value);
+        cdc_send_density_reading('T', densitometer->last_d, densitometer->zero_d, ch0_basic, corr_value,
+            densitometer->last_uncertainty, densitometer->last_quality);
     } else {
         hid_send_density_reading('T', densitometer->last_d, densitometer->zero_d);
     }
@@ -216,17 +246,40 @@ densitometer_result_t transmission_measure(densitometer_t *densitometer, sensor_
     return DENSITOMETER_OK;
 }
 
-densitometer_result_t densitometer_calibrate(densitometer_t *densitometer, float *cal_value, sensor_read_callback_t callback, void *user_data)
+float densitometer_temperature_factor(float corr_value, float ref_temp_c)
+{
+    /* Skip reading the temperature if there is nothing to compensate against */
+    if (isnanf(ref_temp_c) || !is_valid_number(corr_value) || corr_value <= 0.0F) {
+        return 1.0F;
+    }
+
+    float temp_c = sensor_read_temperature();
+    float comp_value = sensor_apply_temperature_compensation(corr_value, temp_c, ref_temp_c);
+    if (comp_value != corr_value) {
+        log_d("Temperature compensation: %.1fC->%.1fC, %f->%f", temp_c, ref_temp_c, corr_value, comp_value);
+    }
+    return comp_value / corr_value;
+}
+
+densitometer_result_t densitometer_calibrate(densitometer_t *densitometer, float *cal_value, float *cal_uncertainty, sensor_read_callback_t callback, void *user_data)
 {
     if (!densitometer) { return DENSITOMETER_CAL_ERROR; }
 
     /* Perform sensor read */
     float ch0_basic;
-    if (sensor_read_target(densitometer->read_light, &ch0_basic, NULL, callback, user_data) != osOK) {
+    float ch0_unc;
+    uint8_t quality;
+    if (sensor_read_target(densitometer->read_light, &ch0_basic, NULL, &ch0_unc, &quality, callback, user_data) != osOK) {
         log_w("Sensor read error");
         return DENSITOMETER_SENSOR_ERROR;
     }
 
+    /* Never save a calibration value from a reading that failed its quality checks */
+    if (quality != SENSOR_QUALITY_OK) {
+        log_w("Sensor read quality error: 0x%02X", quality);
+        return DENSITOMETER_SENSOR_ERROR;
+    }
+
     /* Combine and correct the basic reading */
     float corr_value = sensor_apply_slope_calibration(ch0_basic);
 
@@ -238,6 +291,9 @@ densitometer_result_t densitometer_calibrate(densitometer_t *densitometer, float
     if (cal_value) {
         *cal_value = corr_value;
     }
+    if (cal_uncertainty) {
+        *cal_uncertainty = sensor_apply_slope_calibration_uncertainty(ch0_basic, ch0_unc);
+    }
 
     return DENSITOMETER_OK;
 }
@@ -267,6 +323,20 @@ float densitometer_get_reading_d(const densitometer_t *densitometer)
     return densitometer->last_d;
 }
 
+float densitometer_get_reading_uncertainty(const densitometer_t *densitometer)
+{
+    if (!densitometer) { return NAN; }
+
+    return densitometer->last_uncertainty;
+}
+
+uint8_t densitometer_get_reading_quality(const densitometer_t *densitometer)
+{
+    if (!densitometer) { return SENSOR_QUALITY_OK; }
+
+    return densitometer->last_quality;
+}
+
 float densitometer_get_display_d(const densitometer_t *densitometer)
 {
     if (!densitometer) { return NAN; }
@@ -62,10 +62,11 @@ densitometer_result_t densitometer_measure(densitometer_t *densitometer, sensor_
  * targets to populate the settings_cal_transmission_t structure.
  *
  * @param cal_value Adjusted raw measurement to save as a calibration value
+ * @param cal_uncertainty Standard uncertainty of the calibration value
  * @param callback Called periodically during the measurement loop
  * @return Result code for the measurement process
  */
-densitometer_result_t densitometer_calibrate(densitometer_t *densitometer, float *cal_value, sensor_read_callback_t callback, void *user_data);
+densitometer_result_t densitometer_calibrate(densitometer_t *densitometer, float *cal_value, float *cal_uncertainty, sensor_read_callback_t callback, void *user_data);
 
 /**
  * Control the idle light for the densitometer mode.
@@ -103,6 +104,27 @@ float densitometer_get_zero_d(const densitometer_t *densitometer);
  */
 float densitometer_get_reading_d(const densitometer_t *densitometer);
 
+/**
+ * Get the standard uncertainty of the last density reading.
+ *
+ * This combines the sensor counting statistics, the spread between
+ * repeated sensor readings, and the uncertainty of the reference targets
+ * used for calibration, expressed in density units.
+ *
+ * @return The last reading uncertainty, or NAN if none is available
+ */
+float densitometer_get_reading_uncertainty(const densitometer_t *densitometer);
+
+/**
+ * Get the quality flags of the last density reading.
+ *
+ * These are set when the sensor readings behind the last density reading
+ * still failed their quality checks after all the allowed retries.
+ *
+ * @return The last reading quality, as SENSOR_QUALITY_* flags
+ */
+uint8_t densitometer_get_reading_quality(const densitometer_t *densitometer);
+
 /**
  * Get the last displayable density reading.
  *
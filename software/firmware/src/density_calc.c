@@ -0,0 +1,101 @@
+#include "density_calc.h"
+
+#include <math.h>
+
+static float cal_uncertainty(float unc);
+static float log_uncertainty(float value, float value_unc);
+
+float density_calc_reflection(float value, float value_unc,
+    float lo_d, float lo_value, float lo_unc,
+    float hi_d, float hi_value, float hi_unc,
+    float *d_unc)
+{
+    /* Convert all values into log units */
+    float meas_ll = log10f(value);
+    float cal_hi_ll = log10f(hi_value);
+    float cal_lo_ll = log10f(lo_value);
+
+    /* Calculate the slope of the line */
+    float m = (hi_d - lo_d) / (cal_hi_ll - cal_lo_ll);
+
+    /* Calculate the measured density */
+    float meas_d = (m * (meas_ll - cal_lo_ll)) + lo_d;
+
+    if (d_unc) {
+        /*
+         * Propagate the reading uncertainty through the log conversion,
+         * then combine it with the uncertainty of the two calibration
+         * points, weighted by where the reading falls between them.
+         */
+        float meas_unc = fabsf(m) * log_uncertainty(value, value_unc);
+        float t = (meas_ll - cal_lo_ll) / (cal_hi_ll - cal_lo_ll);
+        float lo_part = (1.0F - t) * cal_uncertainty(lo_unc);
+        float hi_part = t * cal_uncertainty(hi_unc);
+        *d_unc = sqrtf((meas_unc * meas_unc) + (lo_part * lo_part) + (hi_part * hi_part));
+    }
+
+    return meas_d;
+}
+
+float density_calc_transmission(float value, float value_unc,
+    float zero_value, float hi_d, float hi_value, float hi_unc,
+    float *d_unc)
+{
+    /* Calculate the measured CAL-HI density relative to the zero value */
+    float cal_hi_meas_d = -1.0F * log10f(hi_value / zero_value);
+
+    /* Calculate the measured target density relative to the zero value */
+    float meas_d = -1.0F * log10f(value / zero_value);
+
+    /* Calculate the adjustment factor */
+    float adj_factor = hi_d / cal_hi_meas_d;
+
+    if (d_unc) {
+        /*
+         * Propagate the reading uncertainty through the log conversion,
+         * then combine it with the uncertainty of the CAL-HI point,
+         * which scales with the reading relative to the CAL-HI reading.
+         */
+        float meas_unc = fabsf(adj_factor) * log_uncertainty(value, value_unc);
+        float cal_unc = cal_uncertainty(hi_unc) * fabsf(meas_d / cal_hi_meas_d);
+        *d_unc = sqrtf((meas_unc * meas_unc) + (cal_unc * cal_unc));
+    }
+
+    /* Calculate the calibration corrected density */
+    return meas_d * adj_factor;
+}
+
+float density_calc_cal_point_uncertainty(float value, float value_unc,
+    float base_value, float base_unc)
+{
+    float var = DENSITY_CALC_REF_UNCERTAINTY * DENSITY_CALC_REF_UNCERTAINTY;
+
+    float unc = log_uncertainty(value, value_unc);
+    if (isfinite(unc)) {
+        var += unc * unc;
+    }
+
+    unc = log_uncertainty(base_value, base_unc);
+    if (isfinite(unc)) {
+        var += unc * unc;
+    }
+
+    return sqrtf(var);
+}
+
+float cal_uncertainty(float unc)
+{
+    if (!isfinite(unc) || unc < 0.0F) {
+        return DENSITY_CALC_REF_UNCERTAINTY;
+    }
+    return unc;
+}
+
+float log_uncertainty(float value, float value_unc)
+{
+    /* d(log10(x))/dx = 1 / (x * ln(10)) */
+    if (!(value > 0.0F)) {
+        return NAN;
+    }
+    return value_unc / (value * logf(10.0F));
+}
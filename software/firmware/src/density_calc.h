@@ -0,0 +1,76 @@
+#ifndef DENSITY_CALC_H
+#define DENSITY_CALC_H
+
+/*
+ * Conversion of corrected sensor readings into calibrated density
+ * values, along with their standard uncertainty.
+ *
+ * These functions only depend on the C standard library, so that the
+ * math can be built and checked on a host machine separately from the
+ * measurement process in densitometer.c.
+ */
+
+/**
+ * Standard uncertainty assumed for the density of a reference target,
+ * in density units, when the calibration does not record one.
+ */
+#define DENSITY_CALC_REF_UNCERTAINTY (0.01F)
+
+/**
+ * Calculate a reflection density from its two point target calibration.
+ *
+ * The uncertainty of each calibration point is in density units, and
+ * is replaced with DENSITY_CALC_REF_UNCERTAINTY if it is not a valid
+ * number.
+ *
+ * @param value Corrected sensor reading
+ * @param value_unc Standard uncertainty of the corrected sensor reading
+ * @param lo_d Density of the CAL-LO target
+ * @param lo_value Corrected sensor reading of the CAL-LO target
+ * @param lo_unc Standard uncertainty of the CAL-LO calibration point
+ * @param hi_d Density of the CAL-HI target
+ * @param hi_value Corrected sensor reading of the CAL-HI target
+ * @param hi_unc Standard uncertainty of the CAL-HI calibration point
+ * @param d_unc Standard uncertainty of the result, in density units
+ * @return Measured density, which is not clamped to any range
+ */
+float density_calc_reflection(float value, float value_unc,
+    float lo_d, float lo_value, float lo_unc,
+    float hi_d, float hi_value, float hi_unc,
+    float *d_unc);
+
+/**
+ * Calculate a transmission density from its zero and CAL-HI calibration.
+ *
+ * @param value Corrected sensor reading
+ * @param value_unc Standard uncertainty of the corrected sensor reading
+ * @param zero_value Corrected sensor reading with no target
+ * @param hi_d Density of the CAL-HI target
+ * @param hi_value Corrected sensor reading of the CAL-HI target
+ * @param hi_unc Standard uncertainty of the CAL-HI calibration point
+ * @param d_unc Standard uncertainty of the result, in density units
+ * @return Measured density, which is not clamped to any range
+ */
+float density_calc_transmission(float value, float value_unc,
+    float zero_value, float hi_d, float hi_value, float hi_unc,
+    float *d_unc);
+
+/**
+ * Calculate the standard uncertainty of a calibration point.
+ *
+ * This combines DENSITY_CALC_REF_UNCERTAINTY, for the density of the
+ * reference target, with the uncertainty of the readings the point
+ * was calibrated from. Readings are converted to density units as
+ * if the calibration had a slope of one.
+ *
+ * @param value Corrected sensor reading of the target
+ * @param value_unc Standard uncertainty of that reading
+ * @param base_value Corrected sensor reading the target is measured
+ *                   relative to, such as the transmission zero, or NAN
+ * @param base_unc Standard uncertainty of that reading
+ * @return Standard uncertainty of the point, in density units
+ */
+float density_calc_cal_point_uncertainty(float value, float value_unc,
+    float base_value, float base_unc);
+
+#endif /* DENSITY_CALC_H */
@@ -11,15 +11,19 @@
 #include "keypad.h"
 #include "cdc_handler.h"
 #include "util.h"
+#include "ui_strings.h"
 
 static u8g2_t u8g2;
 static uint8_t display_contrast = 0x7F;
 static bool menu_event_timeout = false;
 
-#define MENU_TIMEOUT_MS 30000
 
 /* Library function declarations */
 void u8g2_DrawSelectionList(u8g2_t *u8g2, u8sl_t *u8sl, u8g2_uint_t y, const char *s);
+uint8_t u8g2_draw_button_line(u8g2_t *u8g2, u8g2_uint_t y, u8g2_uint_t w, uint8_t cursor, const char *s);
+
+/* Space between the text and buttons of a message, from u8g2_message.c */
+#define MESSAGE_BUTTON_SPACING 3
 
 static void display_set_freq(uint8_t value);
 
@@ -81,7 +85,7 @@ uint8_t display_get_contrast()
 static void display_capture_screenshot_callback(const char *s)
 {
     size_t len = strlen(s);
-    if (s > 0) {
+    if (len > 0) {
         cdc_write(s, len);
         watchdog_refresh();
     }
@@ -117,10 +121,11 @@ void display_draw_test_pattern(bool mode)
 static void display_prepare_menu_font()
 {
     /*
-     * This font can show 14 characters per line,
-     * and 4 lines (including the title) in a list.
+     * Each language has its own menu font, which is built so that it
+     * can show 4 lines (including the title) in a list. The English
+     * font can show 14 characters per line.
      */
-    u8g2_SetFont(&u8g2, u8g2_font_pxplusibmvga9_tf);
+    u8g2_SetFont(&u8g2, ui_font());
     u8g2_SetFontMode(&u8g2, 0);
     u8g2_SetDrawColor(&u8g2, 1);
 }
@@ -160,11 +165,12 @@ uint8_t u8x8_GetMenuEvent(u8x8_t *u8x8)
     return 0;
 }
 
-void display_static_list(const char *title, const char *list)
+static void display_draw_list(const char *title, const char *list, uint8_t current_pos, uint8_t *first_pos)
 {
     /*
      * Based off u8g2_UserInterfaceSelectionList() with changes to use
-     * full frame buffer mode and to remove actual menu functionality.
+     * full frame buffer mode and to draw a single frame without
+     * waiting for menu events.
      */
 
     display_prepare_menu_font();
@@ -190,7 +196,17 @@ void display_static_list(const char *title, const char *list)
 
     u8sl.total = u8x8_GetStringLineCnt(list);
     u8sl.first_pos = 0;
-    u8sl.current_pos = -1;
+    u8sl.current_pos = current_pos;
+
+    /* Scroll the list just enough to keep the current line visible */
+    if (first_pos && current_pos < u8sl.total) {
+        if (*first_pos > current_pos) {
+            *first_pos = current_pos;
+        } else if (*first_pos + u8sl.visible <= current_pos) {
+            *first_pos = current_pos - u8sl.visible + 1;
+        }
+        u8sl.first_pos = *first_pos;
+    }
 
     u8g2_SetFontPosBaseline(&u8g2);
 
@@ -205,6 +221,16 @@ void display_static_list(const char *title, const char *list)
     u8g2_SendBuffer(&u8g2);
 }
 
+void display_static_list(const char *title, const char *list)
+{
+    display_draw_list(title, list, UINT8_MAX, NULL);
+}
+
+void display_draw_selection_list(const char *title, const char *list, uint8_t current_pos, uint8_t *first_pos)
+{
+    display_draw_list(title, list, current_pos, first_pos);
+}
+
 void display_static_message(const char *msg)
 {
     uint8_t height;
@@ -243,68 +269,88 @@ void display_static_message(const char *msg)
     u8g2_SendBuffer(&u8g2);
 }
 
-uint8_t display_selection_list(const char *title, uint8_t start_pos, const char *list)
+uint8_t display_message(const char *title1, const char *title2, const char *title3, const char *buttons)
 {
     display_prepare_menu_font();
     keypad_clear_events();
     menu_event_timeout = false;
 
-    uint8_t option = u8g2_UserInterfaceSelectionList(&u8g2, title, start_pos, list);
+    uint8_t option = u8g2_UserInterfaceMessage(&u8g2, title1, title2, title3, buttons);
 
     return menu_event_timeout ? UINT8_MAX : option;
 }
 
-uint8_t display_message(const char *title1, const char *title2, const char *title3, const char *buttons)
+void display_draw_message(const char *title1, const char *title2, const char *title3, const char *buttons, uint8_t current_button)
 {
+    /*
+     * Based off u8g2_UserInterfaceMessage() with changes to use
+     * full frame buffer mode and to draw a single frame without
+     * waiting for menu events.
+     */
+
+    uint8_t height;
+    uint8_t line_height;
+    u8g2_uint_t pixel_height;
+    u8g2_uint_t y;
+
     display_prepare_menu_font();
-    keypad_clear_events();
-    menu_event_timeout = false;
 
-    uint8_t option = u8g2_UserInterfaceMessage(&u8g2, title1, title2, title3, buttons);
+    u8g2_SetFontDirection(&u8g2, 0);
+    u8g2_SetFontPosBaseline(&u8g2);
 
-    return menu_event_timeout ? UINT8_MAX : option;
-}
+    /* Calculate line height */
+    line_height = u8g2_GetAscent(&u8g2);
+    line_height -= u8g2_GetDescent(&u8g2);
 
-static const char *display_f1_2toa(uint16_t v, char sep)
-{
-    static char buf[5];
+    /* Calculate overall height of the message box in lines */
+    height = 1; /* button line */
+    height += u8x8_GetStringLineCnt(title1);
+    if (title2) { height++; }
+    height += u8x8_GetStringLineCnt(title3);
+
+    /* Calculate the height in pixels */
+    pixel_height = height;
+    pixel_height *= line_height;
+    pixel_height += MESSAGE_BUTTON_SPACING;
 
-    buf[0] = '0' + (v % 1000 / 100);
-    buf[1] = sep;
-    buf[2] = '0' + (v % 100 / 10);
-    buf[3] = '0' + (v % 10);
-    buf[4] = '\0';
+    /* Calculate offset from top */
+    y = 0;
+    if (pixel_height < u8g2_GetDisplayHeight(&u8g2)) {
+        y = u8g2_GetDisplayHeight(&u8g2);
+        y -= pixel_height;
+        y /= 2;
+    }
+    y += u8g2_GetAscent(&u8g2);
 
-    return buf;
+    /* Draw the message box */
+    u8g2_ClearBuffer(&u8g2);
+    y += u8g2_DrawUTF8Lines(&u8g2, 0, y, u8g2_GetDisplayWidth(&u8g2), line_height, title1);
+    if (title2) {
+        u8g2_DrawUTF8Line(&u8g2, 0, y, u8g2_GetDisplayWidth(&u8g2), title2, 0, 0);
+        y += line_height;
+    }
+    y += u8g2_DrawUTF8Lines(&u8g2, 0, y, u8g2_GetDisplayWidth(&u8g2), line_height, title3);
+    y += MESSAGE_BUTTON_SPACING;
+    u8g2_draw_button_line(&u8g2, y, u8g2_GetDisplayWidth(&u8g2), current_button, buttons);
+    u8g2_SendBuffer(&u8g2);
 }
 
-uint8_t display_input_value_f1_2(const char *title, const char *pre, uint16_t *value, uint16_t lo, uint16_t hi, char sep, const char *post)
+void display_draw_input_value(const char *title, const char *pre, const char *value, const char *post)
 {
     /*
      * Based off u8g2_UserInterfaceInputValue() with changes to use
-     * full frame buffer mode and to support the N.DD number format.
+     * full frame buffer mode, to draw a single frame without waiting
+     * for menu events, and to take a value that is already formatted.
      */
 
-    /* Do initial state setup */
-    display_prepare_menu_font();
-    keypad_clear_events();
-    menu_event_timeout = false;
-
     uint8_t line_height;
     uint8_t height;
     u8g2_uint_t pixel_height;
-    u8g2_uint_t y, yy;
+    u8g2_uint_t y;
     u8g2_uint_t pixel_width;
-    u8g2_uint_t x, xx;
-
-    uint16_t local_value = *value;
-    uint8_t event;
+    u8g2_uint_t x;
 
-    /* Explicitly constrain input values */
-    if (hi > 999) { hi = 999; }
-    if (lo > 0 && lo > hi) { lo = hi; }
-    if (local_value < lo) { local_value = lo; }
-    else if (local_value > hi) { local_value = hi; }
+    display_prepare_menu_font();
 
     /* Only horizontal strings are supported, so force this here */
     u8g2_SetFontDirection(&u8g2, 0);
@@ -335,7 +381,7 @@ uint8_t display_input_value_f1_2(const char *title, const char *pre, uint16_t *v
     /* Calculate offset from left for the label */
     x = 0;
     pixel_width = u8g2_GetUTF8Width(&u8g2, pre);
-    pixel_width += u8g2_GetUTF8Width(&u8g2, "0") * 4;
+    pixel_width += u8g2_GetUTF8Width(&u8g2, value);
     pixel_width += u8g2_GetUTF8Width(&u8g2, post);
     if (pixel_width < u8g2_GetDisplayWidth(&u8g2)) {
         x = u8g2_GetDisplayWidth(&u8g2);
@@ -343,42 +389,13 @@ uint8_t display_input_value_f1_2(const char *title, const char *pre, uint16_t *v
         x /= 2;
     }
 
-    /* Event loop */
-    for(;;) {
-        /* Render */
-        u8g2_ClearBuffer(&u8g2);
-        yy = y;
-        yy += u8g2_DrawUTF8Lines(&u8g2, 0, yy, u8g2_GetDisplayWidth(&u8g2), line_height, title);
-        xx = x;
-        xx += u8g2_DrawUTF8(&u8g2, xx, yy, pre);
-        xx += u8g2_DrawUTF8(&u8g2, xx, yy, display_f1_2toa(local_value, sep));
-        u8g2_DrawUTF8(&u8g2, xx, yy, post);
-        u8g2_SendBuffer(&u8g2);
-
-        for(;;) {
-            event = u8x8_GetMenuEvent(u8g2_GetU8x8(&u8g2));
-            if (event == U8X8_MSG_GPIO_MENU_SELECT) {
-                *value = local_value;
-                return 1;
-            } else if (event == U8X8_MSG_GPIO_MENU_HOME) {
-                return 0;
-            } else if (event == U8X8_MSG_GPIO_MENU_NEXT || event == U8X8_MSG_GPIO_MENU_UP) {
-                if (local_value >= hi) {
-                    local_value = lo;
-                } else {
-                    local_value++;
-                }
-                break;
-            } else if (event == U8X8_MSG_GPIO_MENU_PREV || event == U8X8_MSG_GPIO_MENU_DOWN) {
-                if (local_value <= lo) {
-                    local_value = hi;
-                } else {
-                    local_value--;
-                }
-                break;
-            }
-        }
-    }
+    /* Render */
+    u8g2_ClearBuffer(&u8g2);
+    y += u8g2_DrawUTF8Lines(&u8g2, 0, y, u8g2_GetDisplayWidth(&u8g2), line_height, title);
+    x += u8g2_DrawUTF8(&u8g2, x, y, pre);
+    x += u8g2_DrawUTF8(&u8g2, x, y, value);
+    u8g2_DrawUTF8(&u8g2, x, y, post);
+    u8g2_SendBuffer(&u8g2);
 }
 
 static bool display_get_main_icon(display_mode_t mode, uint8_t frame, asset_info_t *asset)
@@ -428,7 +445,7 @@ void display_draw_main_elements(const display_main_elements_t *elements)
 
     u8g2_SetDrawColor(&u8g2, 0);
     u8g2_ClearBuffer(&u8g2);
-    u8g2_SetFont(&u8g2, u8g2_font_pxplusibmvga9_tf);
+    u8g2_SetFont(&u8g2, ui_font());
     u8g2_SetDrawColor(&u8g2, 1);
     u8g2_SetBitmapMode(&u8g2, 1);
 
@@ -4,6 +4,9 @@
 #include <stdbool.h>
 #include "stm32l0xx_hal.h"
 
+/* Time after which an idle menu is dismissed */
+#define MENU_TIMEOUT_MS 30000
+
 typedef enum {
     DISPLAY_MODE_REFLECTION,
     DISPLAY_MODE_TRANSMISSION
@@ -31,9 +34,32 @@ void display_capture_screenshot();
 void display_draw_test_pattern(bool mode);
 void display_static_list(const char *title, const char *list);
 void display_static_message(const char *msg);
-uint8_t display_selection_list(const char *title, uint8_t start_pos, const char *list);
+
+/*
+ * Draw a selection list without waiting for menu events, scrolling
+ * first_pos as needed to keep current_pos on screen.
+ */
+void display_draw_selection_list(const char *title, const char *list, uint8_t current_pos, uint8_t *first_pos);
+
+/*
+ * Draw a message box without waiting for menu events,
+ * with current_button shown as selected.
+ */
+void display_draw_message(const char *title1, const char *title2, const char *title3, const char *buttons, uint8_t current_button);
+
+/*
+ * Draw a value input box without waiting for menu events,
+ * with the value already formatted for display.
+ */
+void display_draw_input_value(const char *title, const char *pre, const char *value, const char *post);
+
+/*
+ * Show a message box and wait for a button to be selected.
+ *
+ * @return Selected button, starting from 1, or 0 if dismissed
+ *         and UINT8_MAX if it timed out
+ */
 uint8_t display_message(const char *title1, const char *title2, const char *title3, const char *buttons);
-uint8_t display_input_value_f1_2(const char *title, const char *pre, uint16_t *value, uint16_t lo, uint16_t hi, char sep, const char *post);
 
 void display_draw_main_elements(const display_main_elements_t *elements);
 
@@ -5,13 +5,15 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "util.h"
+#include "crash_record.h"
+#include "power.h"
 
 void vApplicationMallocFailedHook(void)
 {
     log_e("Malloc failed!");
     taskDISABLE_INTERRUPTS();
-    __ASM volatile("BKPT #01");
-    while (1) { }
+    crash_record_capture(CRASH_TYPE_MALLOC_FAILED, NULL);
+    crash_record_reset();
 }
 
 void vApplicationStackOverflowHook(xTaskHandle pxTask, char *pcTaskName)
@@ -20,15 +22,18 @@ void vApplicationStackOverflowHook(xTaskHandle pxTask, char *pcTaskName)
 
     log_e("Stack overflow! task=\"%s\"", pcTaskName);
     taskDISABLE_INTERRUPTS();
-    __ASM volatile("BKPT #01");
-    while (1) { }
+    crash_record_capture(CRASH_TYPE_STACK_OVERFLOW, pcTaskName);
+    crash_record_reset();
 }
 
 void vApplicationIdleHook(void)
 {
     /*
-     * Kicking the watchdog here mostly protects against a task hogging the
-     * whole system and preventing the scheduler from doing its thing.
+     * The watchdog is not refreshed here, since that would keep it happy
+     * with a task stuck waiting on something that will never happen.
+     * The supervisor in task_watchdog.c refreshes it instead.
      */
-    watchdog_refresh();
+
+    /* Drop to the reduced clock if nothing needs full speed */
+    power_idle_hook();
 }
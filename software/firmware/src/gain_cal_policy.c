@@ -0,0 +1,213 @@
+#include "gain_cal_policy.h"
+
+#define LOG_TAG "sensor"
+#include <elog.h>
+
+#include <math.h>
+
+#include "tsl2591.h"
+
+static bool gain_cal_policy_check_brightness(const gain_cal_policy_ops_t *ops,
+    settings_gain_cal_stage_t stage, uint8_t brightness, float expected, bool *valid);
+static void gain_cal_policy_limit(float *gain, float min, float max, float typ, const char *name);
+
+bool gain_cal_policy_reading_matches(float expected, float actual, float tolerance)
+{
+    if (isnan(expected) || isinf(expected) || expected <= 0.0F) {
+        return false;
+    }
+
+    /* A saturated reading is returned as NaN, and always fails the check */
+    if (isnan(actual)) {
+        return false;
+    }
+
+    return fabsf(expected - actual) <= (expected * tolerance);
+}
+
+settings_gain_cal_stage_t gain_cal_policy_resume_stage(settings_gain_cal_stage_t stage,
+    bool led_matches, bool max_led_matches)
+{
+    if (stage <= SETTING_GAIN_CAL_STAGE_NONE || stage >= SETTING_GAIN_CAL_STAGE_MAX) {
+        return SETTING_GAIN_CAL_STAGE_NONE;
+    }
+
+    if (!led_matches) {
+        return SETTING_GAIN_CAL_STAGE_NONE;
+    }
+
+    if (stage >= SETTING_GAIN_CAL_STAGE_MAX_LED && !max_led_matches) {
+        return SETTING_GAIN_CAL_STAGE_HIGH;
+    }
+
+    return stage;
+}
+
+bool gain_cal_policy_run(const gain_cal_policy_ops_t *ops, settings_cal_gain_checkpoint_t *checkpoint)
+{
+    void *user_data = ops->user_data;
+    bool led_used = false;
+
+    if (checkpoint->stage > SETTING_GAIN_CAL_STAGE_NONE) {
+        bool led_valid = false;
+        bool max_led_valid = false;
+
+        if (!ops->resume(checkpoint->stage, user_data)) { return false; }
+
+        /*
+         * Make sure the brightness values found before the interruption
+         * still produce the readings recorded when they were found.
+         * A drifting LED can stay close to the search target while
+         * no longer matching the earlier stages, so the comparison is
+         * against the recorded reading rather than the target.
+         */
+        if (!gain_cal_policy_check_brightness(ops, SETTING_GAIN_CAL_STAGE_LED,
+            checkpoint->measurement_brightness, checkpoint->measurement_reading, &led_valid)) {
+            return false;
+        }
+        led_used = true;
+
+        if (led_valid && checkpoint->stage >= SETTING_GAIN_CAL_STAGE_MAX_LED) {
+            /* Maximum gain brightness only affects the final stage */
+            if (!gain_cal_policy_check_brightness(ops, SETTING_GAIN_CAL_STAGE_MAX_LED,
+                checkpoint->max_gain_brightness, checkpoint->max_gain_reading, &max_led_valid)) {
+                return false;
+            }
+        }
+
+        settings_gain_cal_stage_t resume_stage = gain_cal_policy_resume_stage(checkpoint->stage, led_valid, max_led_valid);
+        if (resume_stage == SETTING_GAIN_CAL_STAGE_NONE) {
+            log_w("Measurement brightness check failed, restarting");
+            ops->clear_checkpoint(checkpoint, user_data);
+        } else if (resume_stage != checkpoint->stage) {
+            log_w("Maximum gain brightness check failed, repeating search");
+            checkpoint->stage = resume_stage;
+        }
+    }
+
+    if (checkpoint->stage < SETTING_GAIN_CAL_STAGE_LED) {
+        /* Wait for LED cool down */
+        if (led_used && !ops->cooldown(user_data)) { return false; }
+
+        /* Find the ideal measurement brightness, which should not saturate at high gain */
+        if (!ops->find_brightness(SETTING_GAIN_CAL_STAGE_LED,
+            &checkpoint->measurement_brightness, &checkpoint->measurement_reading, user_data)
+            || checkpoint->measurement_brightness == 0) {
+            return false;
+        }
+
+        checkpoint->stage = SETTING_GAIN_CAL_STAGE_LED;
+        ops->save_checkpoint(checkpoint, user_data);
+    }
+
+    if (checkpoint->stage < SETTING_GAIN_CAL_STAGE_MEDIUM) {
+        /* Wait for LED cool down */
+        if (!ops->cooldown(user_data)) { return false; }
+
+        /* Calibrate the value for medium gain */
+        log_i("Medium gain calibration");
+        if (!ops->measure_gain(SETTING_GAIN_CAL_STAGE_MEDIUM, GAIN_CAL_POLICY_MEDIUM_BRIGHTNESS,
+            &checkpoint->ch0_medium, &checkpoint->ch1_medium, user_data)) {
+            return false;
+        }
+
+        log_i("Medium gain: CH0=%dx, CH1=%dx", lroundf(checkpoint->ch0_medium), lroundf(checkpoint->ch1_medium));
+
+        gain_cal_policy_limit(&checkpoint->ch0_medium,
+            TSL2591_GAIN_MEDIUM_MIN, TSL2591_GAIN_MEDIUM_MAX, TSL2591_GAIN_MEDIUM_TYP, "Medium CH0");
+        gain_cal_policy_limit(&checkpoint->ch1_medium,
+            TSL2591_GAIN_MEDIUM_MIN, TSL2591_GAIN_MEDIUM_MAX, TSL2591_GAIN_MEDIUM_TYP, "Medium CH1");
+
+        checkpoint->stage = SETTING_GAIN_CAL_STAGE_MEDIUM;
+        ops->save_checkpoint(checkpoint, user_data);
+    }
+
+    if (checkpoint->stage < SETTING_GAIN_CAL_STAGE_HIGH) {
+        /* Wait for LED cool down */
+        if (!ops->cooldown(user_data)) { return false; }
+
+        /* Calibrate the value for high gain, using the calibrated measurement brightness */
+        log_i("High gain calibration");
+        if (!ops->measure_gain(SETTING_GAIN_CAL_STAGE_HIGH, checkpoint->measurement_brightness,
+            &checkpoint->ch0_high, &checkpoint->ch1_high, user_data)) {
+            return false;
+        }
+
+        checkpoint->ch0_high *= checkpoint->ch0_medium;
+        checkpoint->ch1_high *= checkpoint->ch1_medium;
+
+        log_i("High gain: CH0=%dx, CH1=%dx", lroundf(checkpoint->ch0_high), lroundf(checkpoint->ch1_high));
+
+        gain_cal_policy_limit(&checkpoint->ch0_high,
+            TSL2591_GAIN_HIGH_MIN, TSL2591_GAIN_HIGH_MAX, TSL2591_GAIN_HIGH_TYP, "High CH0");
+        gain_cal_policy_limit(&checkpoint->ch1_high,
+            TSL2591_GAIN_HIGH_MIN, TSL2591_GAIN_HIGH_MAX, TSL2591_GAIN_HIGH_TYP, "High CH1");
+
+        checkpoint->stage = SETTING_GAIN_CAL_STAGE_HIGH;
+        ops->save_checkpoint(checkpoint, user_data);
+    }
+
+    if (checkpoint->stage < SETTING_GAIN_CAL_STAGE_MAX_LED) {
+        /* Wait for LED cool down */
+        if (!ops->cooldown(user_data)) { return false; }
+
+        /* Find the ideal brightness for testing maximum gain */
+        if (!ops->find_brightness(SETTING_GAIN_CAL_STAGE_MAX_LED,
+            &checkpoint->max_gain_brightness, &checkpoint->max_gain_reading, user_data)
+            || checkpoint->max_gain_brightness == 0) {
+            return false;
+        }
+
+        checkpoint->stage = SETTING_GAIN_CAL_STAGE_MAX_LED;
+        ops->save_checkpoint(checkpoint, user_data);
+    }
+
+    /* Wait for LED cool down */
+    if (!ops->cooldown(user_data)) { return false; }
+
+    /* Calibrate the value for maximum gain */
+    log_i("Maximum gain calibration");
+    if (!ops->measure_gain(SETTING_GAIN_CAL_STAGE_MAX, checkpoint->max_gain_brightness,
+        &checkpoint->ch0_maximum, &checkpoint->ch1_maximum, user_data)) {
+        return false;
+    }
+
+    checkpoint->ch0_maximum *= checkpoint->ch0_high;
+    checkpoint->ch1_maximum *= checkpoint->ch1_high;
+
+    log_i("Maximum gain: CH0=%dx, CH1=%dx", lroundf(checkpoint->ch0_maximum), lroundf(checkpoint->ch1_maximum));
+
+    gain_cal_policy_limit(&checkpoint->ch0_maximum,
+        TSL2591_GAIN_MAXIMUM_CH0_MIN, TSL2591_GAIN_MAXIMUM_CH0_MAX, TSL2591_GAIN_MAXIMUM_CH0_TYP, "Maximum CH0");
+    gain_cal_policy_limit(&checkpoint->ch1_maximum,
+        TSL2591_GAIN_MAXIMUM_CH1_MIN, TSL2591_GAIN_MAXIMUM_CH1_MAX, TSL2591_GAIN_MAXIMUM_CH1_TYP, "Maximum CH1");
+
+    return true;
+}
+
+static bool gain_cal_policy_check_brightness(const gain_cal_policy_ops_t *ops,
+    settings_gain_cal_stage_t stage, uint8_t brightness, float expected, bool *valid)
+{
+    float reading = NAN;
+
+    if (brightness == 0 || brightness > 128) {
+        *valid = false;
+        return true;
+    }
+
+    if (!ops->read_brightness(stage, brightness, &reading, ops->user_data)) {
+        return false;
+    }
+
+    *valid = gain_cal_policy_reading_matches(expected, reading, GAIN_CAL_POLICY_LED_TOLERANCE);
+    log_d("Brightness check: %f vs %f (%s)", reading, expected, *valid ? "ok" : "changed");
+    return true;
+}
+
+static void gain_cal_policy_limit(float *gain, float min, float max, float typ, const char *name)
+{
+    if (*gain < min || *gain > max) {
+        log_w("%s gain out of range!", name);
+        *gain = typ;
+    }
+}
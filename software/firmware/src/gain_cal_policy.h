@@ -0,0 +1,121 @@
+#ifndef GAIN_CAL_POLICY_H
+#define GAIN_CAL_POLICY_H
+
+/*
+ * Sequencing of a gain calibration run, and the decision logic for
+ * resuming one that was interrupted.
+ *
+ * These functions only depend on the C standard library and the settings
+ * types, and reach the sensor through the operations in a
+ * gain_cal_policy_ops_t, so that the run and the rules for trusting
+ * a saved checkpoint can be built and exercised on a host machine
+ * separately from the sensor code in sensor.c.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "settings.h"
+
+/* LED brightness for measuring medium gain against low gain */
+#define GAIN_CAL_POLICY_MEDIUM_BRIGHTNESS 128
+
+/* Allowed deviation from the recorded reading when re-checking a saved brightness */
+#define GAIN_CAL_POLICY_LED_TOLERANCE (0.05F)
+
+/**
+ * Sensor operations used by a gain calibration run.
+ *
+ * Each operation returns false if it failed or was cancelled,
+ * which ends the run.
+ */
+typedef struct {
+    /**
+     * Notify that the run is resuming after the given completed stage.
+     */
+    bool (*resume)(settings_gain_cal_stage_t stage, void *user_data);
+
+    /**
+     * Wait for the LED to cool down between stages.
+     */
+    bool (*cooldown)(void *user_data);
+
+    /**
+     * Search for the LED brightness used by a stage, either
+     * SETTING_GAIN_CAL_STAGE_LED or SETTING_GAIN_CAL_STAGE_MAX_LED,
+     * and get the CH0 reading it produced.
+     */
+    bool (*find_brightness)(settings_gain_cal_stage_t stage,
+        uint8_t *brightness, float *ch0_reading, void *user_data);
+
+    /**
+     * Get the CH0 reading at a brightness previously found for a stage,
+     * under the same sensor settings it was found with.
+     */
+    bool (*read_brightness)(settings_gain_cal_stage_t stage,
+        uint8_t brightness, float *ch0_reading, void *user_data);
+
+    /**
+     * Measure the ratio between the gain calibrated by a stage, either
+     * SETTING_GAIN_CAL_STAGE_MEDIUM, SETTING_GAIN_CAL_STAGE_HIGH or
+     * SETTING_GAIN_CAL_STAGE_MAX, and the gain below it.
+     */
+    bool (*measure_gain)(settings_gain_cal_stage_t stage, uint8_t brightness,
+        float *ch0_ratio, float *ch1_ratio, void *user_data);
+
+    /**
+     * Save a checkpoint after a stage has completed.
+     */
+    void (*save_checkpoint)(const settings_cal_gain_checkpoint_t *checkpoint, void *user_data);
+
+    /**
+     * Discard the saved checkpoint, and reset the provided one to empty.
+     */
+    void (*clear_checkpoint)(settings_cal_gain_checkpoint_t *checkpoint, void *user_data);
+
+    void *user_data;
+} gain_cal_policy_ops_t;
+
+/**
+ * Perform a gain calibration run.
+ *
+ * If the checkpoint records completed stages, their brightness values are
+ * checked first, and the run continues after the last stage that can
+ * still be trusted. A checkpoint is saved as each stage completes.
+ *
+ * @param ops Sensor operations
+ * @param checkpoint Checkpoint to resume from, or an empty one to start
+ *        a new run, which holds the calibrated gains on success
+ * @return True if the run completed
+ */
+bool gain_cal_policy_run(const gain_cal_policy_ops_t *ops, settings_cal_gain_checkpoint_t *checkpoint);
+
+/**
+ * Check whether a fresh reading matches the one recorded in a checkpoint.
+ *
+ * @param expected Reading recorded when the brightness was originally found
+ * @param actual Reading just taken at the same brightness and sensor settings
+ * @param tolerance Allowed relative deviation from the expected reading
+ * @return True if the reading is within tolerance, false if it has drifted,
+ *         saturated (NaN), or there is no usable expected reading
+ */
+bool gain_cal_policy_reading_matches(float expected, float actual, float tolerance);
+
+/**
+ * Get the stage a resumed calibration run should continue from.
+ *
+ * If the measurement brightness no longer produces its recorded reading,
+ * none of the previous results can be trusted and the run starts over.
+ * If only the maximum gain brightness has drifted, then just its search
+ * is repeated.
+ *
+ * @param stage Last completed stage recorded in the checkpoint
+ * @param led_matches Result of checking the measurement brightness
+ * @param max_led_matches Result of checking the maximum gain brightness,
+ *        which is only consulted if that stage was completed
+ * @return Last completed stage that can still be trusted
+ */
+settings_gain_cal_stage_t gain_cal_policy_resume_stage(settings_gain_cal_stage_t stage,
+    bool led_matches, bool max_led_matches);
+
+#endif /* GAIN_CAL_POLICY_H */
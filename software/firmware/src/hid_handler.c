@@ -1,14 +1,88 @@
 #include "hid_handler.h"
 
+#define LOG_TAG "hid_handler"
+#include <elog.h>
+
 #include <printf.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
 #include "settings.h"
+#include "hid_template.h"
 #include "task_usbd.h"
 #include "util.h"
 
+/* Compiled form of the saved output template */
+static hid_template_t hid_template = {0};
+
+/* Sequence number of the last reading sent with a template */
+static uint32_t hid_sequence = 0;
+
+/* Mutex used to allow the template to be replaced from different tasks */
+static osMutexId_t hid_mutex = NULL;
+static const osMutexAttr_t hid_mutex_attrs = {
+    .name = "hid_mutex"
+};
+
+static void hid_send_template_reading(char prefix, float d_value, float d_zero, char decimal_separator);
+
+osStatus_t hid_handler_init()
+{
+    settings_user_hid_template_t template_setting;
+
+    hid_mutex = osMutexNew(&hid_mutex_attrs);
+    if (!hid_mutex) {
+        log_e("hid_mutex create error");
+        return osErrorNoMemory;
+    }
+
+    settings_get_user_hid_template(&template_setting);
+    if (!hid_template_compile(&hid_template, template_setting.text)) {
+        log_w("Unable to compile saved HID template");
+        hid_template_compile(&hid_template, HID_TEMPLATE_DEFAULT);
+    }
+
+    return osOK;
+}
+
+bool hid_handler_set_template(const char *source)
+{
+    hid_template_t compiled;
+    settings_user_hid_template_t template_setting;
+
+    if (!source || strlen(source) > SETTING_HID_TEMPLATE_LEN) { return false; }
+
+    if (!hid_template_compile(&compiled, source)) {
+        log_w("Invalid HID template");
+        return false;
+    }
+
+    memset(&template_setting, 0, sizeof(settings_user_hid_template_t));
+    strncpy(template_setting.text, source, SETTING_HID_TEMPLATE_LEN);
+    if (!settings_set_user_hid_template(&template_setting)) {
+        return false;
+    }
+
+    osMutexAcquire(hid_mutex, portMAX_DELAY);
+    memcpy(&hid_template, &compiled, sizeof(hid_template_t));
+    hid_sequence = 0;
+    osMutexRelease(hid_mutex);
+
+    return true;
+}
+
+void hid_handler_get_template(char *buf, size_t len)
+{
+    settings_user_hid_template_t template_setting;
+
+    if (!buf || len == 0) { return; }
+
+    settings_get_user_hid_template(&template_setting);
+    strncpy(buf, template_setting.text, len - 1);
+    buf[len - 1] = '\0';
+}
+
 void hid_send_density_reading(char prefix, float d_value, float d_zero)
 {
     float d_display;
@@ -31,6 +105,13 @@ void hid_send_density_reading(char prefix, float d_value, float d_zero)
     /* Abort if this feature is not enabled */
     if (!usb_key.enabled) { return; }
 
+    /* Use the output template if configured to do so */
+    if (usb_key.format == SETTING_KEY_FORMAT_TEMPLATE) {
+        hid_send_template_reading(prefix, d_value, d_zero,
+            (display_format.separator == SETTING_DECIMAL_SEPARATOR_COMMA) ? ',' : '.');
+        return;
+    }
+
     /* Force any invalid values to be zero */
     if (isnanf(d_value) || isinff(d_value)) {
         d_value = 0.0F;
@@ -114,3 +195,25 @@ void hid_send_density_reading(char prefix, float d_value, float d_zero)
     /* Send the formatted string to the HID interface */
     usbd_hid_send(buf + offset, n - offset);
 }
+
+void hid_send_template_reading(char prefix, float d_value, float d_zero, char decimal_separator)
+{
+    char buf[HID_TEMPLATE_OUTPUT_LEN];
+    size_t n;
+
+    hid_template_values_t values = {
+        .mode = prefix,
+        .density = d_value,
+        .zero = d_zero,
+        .sequence = 0,
+        .decimal_separator = decimal_separator
+    };
+
+    osMutexAcquire(hid_mutex, portMAX_DELAY);
+    values.sequence = ++hid_sequence;
+    n = hid_template_expand(&hid_template, &values, buf, sizeof(buf));
+    osMutexRelease(hid_mutex);
+
+    /* Send the formatted string to the HID interface */
+    usbd_hid_send(buf, n);
+}
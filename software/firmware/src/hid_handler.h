@@ -4,6 +4,17 @@
 #ifndef HID_HANDLER_H
 #define HID_HANDLER_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <cmsis_os.h>
+
+/**
+ * Initialize the HID handler, and compile the saved output template.
+ *
+ * This should be called once the settings have been loaded.
+ */
+osStatus_t hid_handler_init();
+
 /**
  * Send a density reading out the HID device.
  *
@@ -13,4 +24,23 @@
  */
 void hid_send_density_reading(char prefix, float d_value, float d_zero);
 
+/**
+ * Validate, compile, and save a new HID output template.
+ *
+ * The template is used for readings when the USB key format is set
+ * to the template option.
+ *
+ * @param source Template source text
+ * @return True if saved, false if invalid or on error
+ */
+bool hid_handler_set_template(const char *source);
+
+/**
+ * Get the source text of the current HID output template.
+ *
+ * @param buf Buffer to populate with the template
+ * @param len Size of the buffer
+ */
+void hid_handler_get_template(char *buf, size_t len);
+
 #endif /* HID_HANDLER_H */
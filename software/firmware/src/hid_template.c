@@ -0,0 +1,267 @@
+#include "hid_template.h"
+
+#include <printf.h>
+#include <string.h>
+#include <math.h>
+
+#define HID_TEMPLATE_DEFAULT_DECIMALS 2
+#define HID_TEMPLATE_MAX_DECIMALS     4
+#define HID_TEMPLATE_MAX_WIDTH        9
+
+/* Conversion factor from density units to f-stops, log2(10) */
+#define DENSITY_TO_FSTOP 3.32192809F
+
+typedef struct {
+    const char *name;
+    uint8_t type;
+    char literal;
+} hid_template_placeholder_t;
+
+static const hid_template_placeholder_t PLACEHOLDERS[] = {
+    { "MODE",  HID_TEMPLATE_OP_MODE,      '\0' },
+    { "D",     HID_TEMPLATE_OP_DENSITY,   '\0' },
+    { "ZERO",  HID_TEMPLATE_OP_ZERO,      '\0' },
+    { "F",     HID_TEMPLATE_OP_FSTOP,     '\0' },
+    { "N",     HID_TEMPLATE_OP_SEQUENCE,  '\0' },
+    { "SEP",   HID_TEMPLATE_OP_SEPARATOR, '\0' },
+    { "TAB",   HID_TEMPLATE_OP_LITERAL,   '\t' },
+    { "ENTER", HID_TEMPLATE_OP_LITERAL,   '\n' },
+    { "SPACE", HID_TEMPLATE_OP_LITERAL,   ' ' }
+};
+
+static bool hid_template_append_literal(hid_template_t *tmpl, char ch);
+static bool hid_template_compile_placeholder(hid_template_t *tmpl, const char *str, size_t len);
+static size_t hid_template_format_number(char *buf, float value, const hid_template_op_t *op, char decimal_separator);
+
+bool hid_template_compile(hid_template_t *tmpl, const char *source)
+{
+    if (!tmpl || !source) { return false; }
+
+    memset(tmpl, 0, sizeof(hid_template_t));
+
+    if (strlen(source) > HID_TEMPLATE_SOURCE_LEN) { return false; }
+
+    const char *p = source;
+    while (*p) {
+        if (*p == '{' && *(p + 1) == '{') {
+            if (!hid_template_append_literal(tmpl, '{')) { return false; }
+            p += 2;
+        } else if (*p == '}' && *(p + 1) == '}') {
+            if (!hid_template_append_literal(tmpl, '}')) { return false; }
+            p += 2;
+        } else if (*p == '{') {
+            const char *end = strchr(p + 1, '}');
+            if (!end) { return false; }
+            if (!hid_template_compile_placeholder(tmpl, p + 1, end - (p + 1))) { return false; }
+            p = end + 1;
+        } else if (*p == '}') {
+            /* Unmatched closing brace */
+            return false;
+        } else if ((uint8_t)*p < 0x20 || (uint8_t)*p > 0x7E) {
+            /* Only printable characters can be typed directly */
+            return false;
+        } else {
+            if (!hid_template_append_literal(tmpl, *p)) { return false; }
+            p++;
+        }
+    }
+
+    return true;
+}
+
+bool hid_template_append_literal(hid_template_t *tmpl, char ch)
+{
+    if (tmpl->literal_len >= sizeof(tmpl->literals)) { return false; }
+
+    /* Extend the previous op if it is literal text that ends at the current position */
+    if (tmpl->op_count > 0) {
+        hid_template_op_t *op = &tmpl->ops[tmpl->op_count - 1];
+        if (op->type == HID_TEMPLATE_OP_LITERAL && op->offset + op->len == tmpl->literal_len) {
+            tmpl->literals[tmpl->literal_len++] = ch;
+            op->len++;
+            return true;
+        }
+    }
+
+    if (tmpl->op_count >= HID_TEMPLATE_MAX_OPS) { return false; }
+
+    hid_template_op_t *op = &tmpl->ops[tmpl->op_count++];
+    op->type = HID_TEMPLATE_OP_LITERAL;
+    op->offset = tmpl->literal_len;
+    op->len = 1;
+    tmpl->literals[tmpl->literal_len++] = ch;
+    return true;
+}
+
+bool hid_template_compile_placeholder(hid_template_t *tmpl, const char *str, size_t len)
+{
+    const hid_template_placeholder_t *placeholder = NULL;
+    size_t name_len = 0;
+    uint8_t flags = 0;
+    int decimals = -1;
+
+    /* Find the end of the placeholder name */
+    while (name_len < len && str[name_len] >= 'A' && str[name_len] <= 'Z') {
+        name_len++;
+    }
+
+    for (size_t i = 0; i < sizeof(PLACEHOLDERS) / sizeof(PLACEHOLDERS[0]); i++) {
+        if (strlen(PLACEHOLDERS[i].name) == name_len && strncmp(PLACEHOLDERS[i].name, str, name_len) == 0) {
+            placeholder = &PLACEHOLDERS[i];
+            break;
+        }
+    }
+    if (!placeholder) { return false; }
+
+    /* Parse the modifiers */
+    size_t i = name_len;
+    if (i < len && str[i] == '+') {
+        flags |= HID_TEMPLATE_FLAG_SIGN;
+        i++;
+    }
+    if (i < len && str[i] == ':') {
+        i++;
+        if (i >= len || str[i] < '0' || str[i] > '9') { return false; }
+        decimals = str[i] - '0';
+        i++;
+    }
+    if (i != len) { return false; }
+
+    if (placeholder->type == HID_TEMPLATE_OP_LITERAL) {
+        if (flags != 0 || decimals >= 0) { return false; }
+        return hid_template_append_literal(tmpl, placeholder->literal);
+    }
+
+    switch (placeholder->type) {
+    case HID_TEMPLATE_OP_DENSITY:
+    case HID_TEMPLATE_OP_ZERO:
+    case HID_TEMPLATE_OP_FSTOP:
+        if (decimals < 0) {
+            decimals = HID_TEMPLATE_DEFAULT_DECIMALS;
+        } else if (decimals > HID_TEMPLATE_MAX_DECIMALS) {
+            return false;
+        }
+        break;
+    case HID_TEMPLATE_OP_SEQUENCE:
+        /* The sequence number is never negative, and its modifier is a width */
+        if (flags != 0 || decimals > HID_TEMPLATE_MAX_WIDTH) { return false; }
+        if (decimals < 0) { decimals = 0; }
+        break;
+    default:
+        if (flags != 0 || decimals >= 0) { return false; }
+        decimals = 0;
+        break;
+    }
+
+    if (tmpl->op_count >= HID_TEMPLATE_MAX_OPS) { return false; }
+
+    hid_template_op_t *op = &tmpl->ops[tmpl->op_count++];
+    op->type = placeholder->type;
+    op->flags = flags;
+    op->decimals = (uint8_t)decimals;
+    return true;
+}
+
+size_t hid_template_expand(const hid_template_t *tmpl, const hid_template_values_t *values, char *buf, size_t len)
+{
+    char field[HID_TEMPLATE_OUTPUT_LEN];
+    size_t offset = 0;
+    float d_value;
+    float d_zero;
+
+    if (!buf || len == 0) { return 0; }
+    buf[0] = '\0';
+    if (!tmpl || !values) { return 0; }
+
+    /* Force any invalid values to be zero */
+    d_value = values->density;
+    if (isnanf(d_value) || isinff(d_value)) {
+        d_value = 0.0F;
+    }
+    d_zero = values->zero;
+    if (isnanf(d_zero) || isinff(d_zero)) {
+        d_zero = 0.0F;
+    }
+
+    for (size_t i = 0; i < tmpl->op_count; i++) {
+        const hid_template_op_t *op = &tmpl->ops[i];
+        const char *str = field;
+        size_t n = 0;
+
+        switch (op->type) {
+        case HID_TEMPLATE_OP_LITERAL:
+            str = &tmpl->literals[op->offset];
+            n = op->len;
+            break;
+        case HID_TEMPLATE_OP_MODE:
+            field[0] = values->mode;
+            n = 1;
+            break;
+        case HID_TEMPLATE_OP_DENSITY:
+            n = hid_template_format_number(field, d_value - d_zero, op, values->decimal_separator);
+            break;
+        case HID_TEMPLATE_OP_ZERO:
+            n = hid_template_format_number(field, d_zero, op, values->decimal_separator);
+            break;
+        case HID_TEMPLATE_OP_FSTOP:
+            n = hid_template_format_number(field, (d_value - d_zero) * DENSITY_TO_FSTOP, op, values->decimal_separator);
+            break;
+        case HID_TEMPLATE_OP_SEQUENCE:
+            n = sprintf_(field, "%0*lu", op->decimals, (unsigned long)values->sequence);
+            break;
+        case HID_TEMPLATE_OP_SEPARATOR:
+            /* Avoid a separator that would be confused with the decimal separator */
+            field[0] = (values->decimal_separator == ',') ? ';' : ',';
+            n = 1;
+            break;
+        default:
+            break;
+        }
+
+        if (offset + n >= len) {
+            n = len - offset - 1;
+        }
+        memcpy(buf + offset, str, n);
+        offset += n;
+        buf[offset] = '\0';
+    }
+
+    return offset;
+}
+
+size_t hid_template_format_number(char *buf, float value, const hid_template_op_t *op, char decimal_separator)
+{
+    size_t n;
+    bool negative;
+
+    n = sprintf_(buf + 1, "%.*f", op->decimals, fabsf(value));
+
+    /* Catch cases where a negative was rounded to zero */
+    negative = false;
+    if (value < 0.0F) {
+        for (size_t i = 1; i <= n; i++) {
+            if (buf[i] >= '1' && buf[i] <= '9') {
+                negative = true;
+                break;
+            }
+        }
+    }
+
+    /* Change the decimal separator if configured to do so */
+    if (decimal_separator != '.') {
+        char *p = strchr(buf + 1, '.');
+        if (p) { *p = decimal_separator; }
+    }
+
+    if (negative) {
+        buf[0] = '-';
+        n++;
+    } else if (op->flags & HID_TEMPLATE_FLAG_SIGN) {
+        buf[0] = '+';
+        n++;
+    } else {
+        memmove(buf, buf + 1, n + 1);
+    }
+
+    return n;
+}
@@ -0,0 +1,104 @@
+/*
+ * Compiler and expander for the templates used to format readings
+ * sent out the USB HID keyboard interface.
+ *
+ * A template is plain text with placeholders in braces, such as
+ * "{MODE}{D+:2}{ENTER}". Each placeholder may be followed by a '+' to
+ * always include the sign, and by ":n" to select the number of decimal
+ * places (or the zero-padded width of the sequence number).
+ * Literal braces are written as "{{" and "}}", and the {TAB}, {ENTER}
+ * and {SPACE} placeholders produce the corresponding keys.
+ *
+ * This module has no hardware dependencies, so that it can be built
+ * and exercised on the host.
+ */
+#ifndef HID_TEMPLATE_H
+#define HID_TEMPLATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Maximum length of the template source text, not including the
+ * terminating null.
+ */
+#define HID_TEMPLATE_SOURCE_LEN 56
+
+/**
+ * Maximum number of ops in a compiled template.
+ */
+#define HID_TEMPLATE_MAX_OPS 24
+
+/**
+ * Maximum length of the output of an expanded template,
+ * including the terminating null.
+ */
+#define HID_TEMPLATE_OUTPUT_LEN 64
+
+/**
+ * Default template, equivalent to the "number" key format with
+ * the "enter" separator.
+ */
+#define HID_TEMPLATE_DEFAULT "{D}{ENTER}"
+
+typedef enum {
+    HID_TEMPLATE_OP_LITERAL = 0, /*!< Literal text */
+    HID_TEMPLATE_OP_MODE,        /*!< {MODE} Reading type, 'R' or 'T' */
+    HID_TEMPLATE_OP_DENSITY,     /*!< {D} Density, relative to any zero */
+    HID_TEMPLATE_OP_ZERO,        /*!< {ZERO} Zero offset, or 0 if not set */
+    HID_TEMPLATE_OP_FSTOP,       /*!< {F} Relative density in f-stops */
+    HID_TEMPLATE_OP_SEQUENCE,    /*!< {N} Reading sequence number */
+    HID_TEMPLATE_OP_SEPARATOR,   /*!< {SEP} Field separator, ',' or ';' */
+    HID_TEMPLATE_OP_MAX
+} hid_template_op_type_t;
+
+#define HID_TEMPLATE_FLAG_SIGN 0x01 /*!< Always include the sign */
+
+typedef struct {
+    uint8_t type;
+    uint8_t flags;
+    uint8_t decimals;
+    uint8_t offset; /*!< Offset of literal text in the literal buffer */
+    uint8_t len;    /*!< Length of literal text */
+} hid_template_op_t;
+
+typedef struct {
+    hid_template_op_t ops[HID_TEMPLATE_MAX_OPS];
+    uint8_t op_count;
+    char literals[HID_TEMPLATE_SOURCE_LEN];
+    uint8_t literal_len;
+} hid_template_t;
+
+typedef struct {
+    char mode;              /*!< Reading type, such as 'R' or 'T' */
+    float density;          /*!< Density reading, without the zero applied */
+    float zero;             /*!< Density zero offset, NaN if not set */
+    uint32_t sequence;      /*!< Sequence number of the reading */
+    char decimal_separator; /*!< Decimal separator, '.' or ',' */
+} hid_template_values_t;
+
+/**
+ * Compile template source text into a list of ops.
+ *
+ * @param tmpl Compiled template to populate
+ * @param source Template source text
+ * @return True if compiled, false if the source is invalid
+ */
+bool hid_template_compile(hid_template_t *tmpl, const char *source);
+
+/**
+ * Expand a compiled template with the values of a reading.
+ *
+ * The output is truncated if it would not fit in the buffer, and is
+ * always null terminated.
+ *
+ * @param tmpl Compiled template
+ * @param values Values of the reading
+ * @param buf Output buffer
+ * @param len Size of the output buffer
+ * @return Length of the expanded output, not including the terminating null
+ */
+size_t hid_template_expand(const hid_template_t *tmpl, const hid_template_values_t *values, char *buf, size_t len);
+
+#endif /* HID_TEMPLATE_H */
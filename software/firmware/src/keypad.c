@@ -15,10 +15,13 @@
 
 #include "stm32l0xx_hal.h"
 #include "board_config.h"
+#include "task_watchdog.h"
+#include "power.h"
 
 #define KEYPAD_INDEX_MAX       5
 #define KEYPAD_REPEAT_DELAY_MS 600
 #define KEYPAD_REPEAT_RATE_S   25
+#define KEYPAD_WATCHDOG_DEADLINE_MS 2000U
 
 /* Internal raw keypad event data */
 typedef struct {
@@ -101,8 +104,16 @@ void task_keypad_run(void *argument)
         return;
     }
 
+    task_watchdog_register(KEYPAD_WATCHDOG_DEADLINE_MS);
+
     for (;;) {
+        task_watchdog_idle();
         if(osMessageQueueGet(keypad_raw_event_queue, &raw_event, NULL, portMAX_DELAY) == osOK) {
+            task_watchdog_checkin();
+
+            /* Restore the full clock before handling a key that may start a measurement */
+            power_activity(POWER_SOURCE_KEYPAD);
+
             if (raw_event.prev_dropped) {
                 log_w("Raw key event missed!");
                 /*
@@ -149,8 +160,14 @@ osStatus_t keypad_flush_events()
 osStatus_t keypad_wait_for_event(keypad_event_t *event, int msecs_to_wait)
 {
     TickType_t ticks = msecs_to_wait < 0 ? portMAX_DELAY : (msecs_to_wait / portTICK_RATE_MS);
+    osStatus_t result;
 
-    if (osMessageQueueGet(keypad_event_queue, event, NULL, ticks) != osOK) {
+    /* Waiting on the user is not a stall, so the watchdog deadline is suspended */
+    task_watchdog_idle();
+    result = osMessageQueueGet(keypad_event_queue, event, NULL, ticks);
+    task_watchdog_checkin();
+
+    if (result != osOK) {
         if (msecs_to_wait > 0) {
             return osErrorTimeout;
         } else {
@@ -319,6 +336,24 @@ bool keypad_is_detect()
     return HAL_GPIO_ReadPin(BTN5_GPIO_Port, BTN5_Pin) == GPIO_PIN_RESET;
 }
 
+uint8_t keypad_get_raw_state()
+{
+    uint8_t state = 0;
+    if (HAL_GPIO_ReadPin(BTN1_GPIO_Port, BTN1_Pin) == GPIO_PIN_SET) {
+        state |= KEYPAD_BUTTON_ACTION;
+    }
+    if (HAL_GPIO_ReadPin(BTN2_GPIO_Port, BTN2_Pin) == GPIO_PIN_SET) {
+        state |= KEYPAD_BUTTON_UP;
+    }
+    if (HAL_GPIO_ReadPin(BTN3_GPIO_Port, BTN3_Pin) == GPIO_PIN_SET) {
+        state |= KEYPAD_BUTTON_DOWN;
+    }
+    if (HAL_GPIO_ReadPin(BTN4_GPIO_Port, BTN4_Pin) == GPIO_PIN_SET) {
+        state |= KEYPAD_BUTTON_MENU;
+    }
+    return state;
+}
+
 uint8_t keypad_keycode_to_index(keypad_key_t keycode)
 {
     switch (keycode) {
@@ -37,6 +37,12 @@ bool keypad_is_key_combo_pressed(const keypad_event_t *event, keypad_key_t key1,
 
 bool keypad_is_detect();
 
+/**
+ * Sample the current state of the front panel buttons, bypassing the
+ * event queue, as a mask of the keypad_key_t values that are pressed.
+ */
+uint8_t keypad_get_raw_state();
+
 void keypad_int_handler(uint16_t gpio_pin);
 
 #endif /* KEYPAD_H */
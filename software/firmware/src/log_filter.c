@@ -0,0 +1,141 @@
+#include "log_filter.h"
+
+#define LOG_TAG "log_filter"
+#include <elog.h>
+
+#include <string.h>
+
+#ifndef __CDT_PARSER__
+_Static_assert(SETTING_LOG_LEVEL_TAG_LEN <= ELOG_FILTER_TAG_MAX_LEN, "Saved tag length exceeds the log filter limit");
+_Static_assert(SETTING_LOG_LEVEL_TAG_COUNT <= ELOG_FILTER_TAG_LVL_MAX_NUM, "Saved tag count exceeds the log filter limit");
+#endif
+
+static const char LEVEL_CHARS[ELOG_LVL_TOTAL_NUM] = { 'A', 'E', 'W', 'I', 'D', 'V' };
+
+static void log_filter_clear_tags();
+
+void log_filter_load()
+{
+    settings_user_log_level_t log_level;
+
+    settings_get_user_log_level(&log_level);
+    log_filter_apply(&log_level);
+
+    if (log_level.level != ELOG_LVL_VERBOSE || log_level.tags[0].tag[0] != '\0') {
+        log_i("Loaded saved log level filters");
+    }
+}
+
+bool log_filter_save()
+{
+    settings_user_log_level_t log_level;
+
+    log_filter_get(&log_level);
+    return settings_set_user_log_level(&log_level);
+}
+
+bool log_filter_set(const char *tag, uint8_t level)
+{
+    char entry_tag[ELOG_FILTER_TAG_MAX_LEN + 1];
+    uint8_t entry_level;
+    size_t count = 0;
+    bool found = false;
+
+    if (!tag || tag[0] == '\0' || level > ELOG_LVL_VERBOSE) { return false; }
+
+    if (strcmp(tag, LOG_FILTER_TAG_GLOBAL) == 0) {
+        elog_set_filter_lvl(level);
+        return true;
+    }
+
+    if (strlen(tag) > SETTING_LOG_LEVEL_TAG_LEN) { return false; }
+
+    /*
+     * Only allow as many tag filters as can be saved, which
+     * is fewer than the logging library itself supports.
+     */
+    for (uint8_t i = 0; i < ELOG_FILTER_TAG_LVL_MAX_NUM; i++) {
+        if (elog_get_filter_tag_lvl_entry(i, entry_tag, &entry_level)) {
+            if (strcmp(entry_tag, tag) == 0) {
+                found = true;
+            }
+            count++;
+        }
+    }
+    if (!found && level != ELOG_FILTER_LVL_ALL && count >= SETTING_LOG_LEVEL_TAG_COUNT) {
+        return false;
+    }
+
+    elog_set_filter_tag_lvl(tag, level);
+    return true;
+}
+
+void log_filter_get(settings_user_log_level_t *log_level)
+{
+    char entry_tag[ELOG_FILTER_TAG_MAX_LEN + 1];
+    uint8_t entry_level;
+    size_t count = 0;
+
+    if (!log_level) { return; }
+
+    memset(log_level, 0, sizeof(settings_user_log_level_t));
+    log_level->level = elog_get_filter_lvl();
+
+    for (uint8_t i = 0; i < ELOG_FILTER_TAG_LVL_MAX_NUM && count < SETTING_LOG_LEVEL_TAG_COUNT; i++) {
+        if (elog_get_filter_tag_lvl_entry(i, entry_tag, &entry_level)) {
+            strncpy(log_level->tags[count].tag, entry_tag, SETTING_LOG_LEVEL_TAG_LEN);
+            log_level->tags[count].level = entry_level;
+            count++;
+        }
+    }
+}
+
+void log_filter_apply(const settings_user_log_level_t *log_level)
+{
+    if (!log_level) { return; }
+
+    log_filter_clear_tags();
+
+    elog_set_filter_lvl(log_level->level <= ELOG_LVL_VERBOSE ? log_level->level : ELOG_LVL_VERBOSE);
+
+    for (size_t i = 0; i < SETTING_LOG_LEVEL_TAG_COUNT; i++) {
+        if (log_level->tags[i].tag[0] != '\0' && log_level->tags[i].level <= ELOG_LVL_VERBOSE) {
+            elog_set_filter_tag_lvl(log_level->tags[i].tag, log_level->tags[i].level);
+        }
+    }
+}
+
+void log_filter_clear_tags()
+{
+    char entry_tag[ELOG_FILTER_TAG_MAX_LEN + 1];
+    uint8_t entry_level;
+
+    for (uint8_t i = 0; i < ELOG_FILTER_TAG_LVL_MAX_NUM; i++) {
+        if (elog_get_filter_tag_lvl_entry(i, entry_tag, &entry_level)) {
+            elog_set_filter_tag_lvl(entry_tag, ELOG_FILTER_LVL_ALL);
+        }
+    }
+}
+
+bool log_filter_parse_level(const char *str, uint8_t *level)
+{
+    if (!str || !level || str[0] == '\0' || str[1] != '\0') { return false; }
+
+    if (str[0] >= '0' && str[0] <= '5') {
+        *level = (uint8_t)(str[0] - '0');
+        return true;
+    }
+
+    for (uint8_t i = 0; i < ELOG_LVL_TOTAL_NUM; i++) {
+        if (str[0] == LEVEL_CHARS[i]) {
+            *level = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+char log_filter_level_char(uint8_t level)
+{
+    return (level < ELOG_LVL_TOTAL_NUM) ? LEVEL_CHARS[level] : '?';
+}
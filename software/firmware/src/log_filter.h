@@ -0,0 +1,74 @@
+/*
+ * Runtime log level filters, which can be changed on a per-tag basis
+ * and optionally saved to the user settings.
+ */
+#ifndef LOG_FILTER_H
+#define LOG_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "settings.h"
+
+/**
+ * Tag used to refer to the global log level filter.
+ */
+#define LOG_FILTER_TAG_GLOBAL "*"
+
+/**
+ * Apply the log level filters saved in the user settings.
+ *
+ * This should be called once the settings have been loaded.
+ */
+void log_filter_load();
+
+/**
+ * Save the current log level filters to the user settings.
+ *
+ * @return True if saved, false on error
+ */
+bool log_filter_save();
+
+/**
+ * Set the log level filter for a tag.
+ *
+ * Setting a tag to the verbose level removes its filter, and
+ * using LOG_FILTER_TAG_GLOBAL as the tag sets the global filter.
+ *
+ * @param tag Log tag
+ * @param level Maximum log level to output for the tag
+ * @return True if set, false if the tag is invalid or there are
+ *         already too many tag filters
+ */
+bool log_filter_set(const char *tag, uint8_t level);
+
+/**
+ * Get the current log level filters.
+ *
+ * @param log_level Struct to be populated with the current filters
+ */
+void log_filter_get(settings_user_log_level_t *log_level);
+
+/**
+ * Replace the current log level filters.
+ *
+ * @param log_level Filters to apply
+ */
+void log_filter_apply(const settings_user_log_level_t *log_level);
+
+/**
+ * Parse a log level from its single letter name (A/E/W/I/D/V)
+ * or its numeric value.
+ *
+ * @param str String to parse
+ * @param level Parsed log level
+ * @return True if parsed, false if invalid
+ */
+bool log_filter_parse_level(const char *str, uint8_t *level);
+
+/**
+ * Get the single letter name of a log level.
+ */
+char log_filter_level_char(uint8_t level);
+
+#endif /* LOG_FILTER_H */
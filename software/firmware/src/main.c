@@ -5,6 +5,7 @@
 #include <elog.h>
 
 #include <printf.h>
+#include <string.h>
 #include <cmsis_os.h>
 #include <machine/endian.h>
 
@@ -16,6 +17,7 @@
 #include "task_main.h"
 #include "task_sensor.h"
 #include "app_descriptor.h"
+#include "crash_record.h"
 #include "state_suspend.h"
 #include "util.h"
 
@@ -94,8 +96,8 @@ void system_clock_config(void)
 
     PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_USART1 | RCC_PERIPHCLK_I2C1
         | RCC_PERIPHCLK_RTC | RCC_PERIPHCLK_USB;
-    PeriphClkInit.Usart1ClockSelection = RCC_USART1CLKSOURCE_PCLK2;
-    PeriphClkInit.I2c1ClockSelection = RCC_I2C1CLKSOURCE_PCLK1;
+    PeriphClkInit.Usart1ClockSelection = RCC_USART1CLKSOURCE_HSI;
+    PeriphClkInit.I2c1ClockSelection = RCC_I2C1CLKSOURCE_HSI;
     PeriphClkInit.RTCClockSelection = RCC_RTCCLKSOURCE_LSI;
     PeriphClkInit.UsbClockSelection = RCC_USBCLKSOURCE_HSI48;
     if (HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit) != HAL_OK) {
@@ -118,6 +120,15 @@ void read_startup_flags(void)
     if (startup_bkp0r == 0) {
         startup_bkp0r = RCC->CSR & 0xFF000000UL;
     }
+
+    /*
+     * Clear the reset flags, so the next startup only sees the cause
+     * of its own reset. This is necessary to tell whether the contents
+     * of the crash record can be trusted.
+     */
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+
+    crash_record_init(startup_bkp0r);
 }
 
 void iwdg_init(void)
@@ -279,14 +290,20 @@ void i2c1_init(void)
     hi2c1.Instance = I2C1;
 
     /*
-     * CubeMX calculated value for the following configuration:
+     * Derived from the CubeMX calculated value at 32MHz, 0x00B0122A,
+     * for the following configuration:
      * - I2C Frequency: 400kHz
      * - Rise Time: 250ns
      * - Fall Time: 100ns
      * - Coefficient of Digital Filter: 0
      * - Analog Filter: Enabled
+     *
+     * I2C1 runs from the 16MHz HSI, rather than PCLK1, so that its
+     * timing does not change when the power governor reduces the
+     * system clock. Each period of the original value is halved and
+     * rounded up, so none of them are any shorter.
      */
-    hi2c1.Init.Timing = 0x00B0122A;
+    hi2c1.Init.Timing = 0x00500915;
 
     hi2c1.Init.OwnAddress1 = 0;
     hi2c1.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
@@ -521,6 +538,12 @@ void startup_log_messages(void)
         log_i("Low-Power reset");
     }
 
+    const crash_record_t *crash_record = crash_record_get();
+    if (crash_record) {
+        log_w("Crash record present: type=%lu, pc=0x%08lX, task=\"%s\"",
+            crash_record->type, crash_record->pc, crash_record->task_name);
+    }
+
     log_i("-----------------------");
 }
 
@@ -625,8 +648,8 @@ void HAL_RTCEx_WakeUpTimerEventCallback(RTC_HandleTypeDef *hrtc)
 void error_handler(void)
 {
     __disable_irq();
-    __ASM volatile("BKPT #01");
-    while (1) { }
+    crash_record_capture(CRASH_TYPE_ERROR_HANDLER, NULL);
+    crash_record_reset();
 }
 
 #ifdef USE_FULL_ASSERT
@@ -639,6 +662,13 @@ void error_handler(void)
  */
 void assert_failed(uint8_t *file, uint32_t line)
 {
+    char buf[CRASH_RECORD_DETAIL_LEN];
+    const char *name = strrchr((const char *)file, '/');
+
     printf("Assert failed: file %s on line %ld", file, line);
+
+    snprintf(buf, sizeof(buf), "%s:%lu", name ? name + 1 : (const char *)file, line);
+    crash_record_capture(CRASH_TYPE_ASSERT, buf);
+    crash_record_reset();
 }
 #endif /* USE_FULL_ASSERT */
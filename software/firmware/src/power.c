@@ -0,0 +1,255 @@
+#include "power.h"
+
+#define LOG_TAG "power"
+#include <elog.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "stm32l0xx_hal.h"
+#include "util.h"
+
+/*
+ * Longest tickless idle period. The watchdog supervisor task wakes up
+ * far more often than this, so it mostly guards against a bad
+ * expected idle time keeping the system asleep.
+ */
+#define POWER_SLEEP_MAX_TICKS 250UL
+
+/*
+ * SysTick counts lost while the timer is stopped to reconfigure it,
+ * taken from the FreeRTOS Cortex-M0 port.
+ */
+#define POWER_MISSED_COUNTS_FACTOR 45UL
+
+extern TIM_HandleTypeDef htim2;
+
+static power_policy_state_t power_state = { 0, 0, POWER_CLOCK_FULL, false };
+static uint32_t power_full_clock_hz = 0;
+
+/* Power state instrumentation, in kernel ticks */
+static uint32_t power_clock_since = 0;
+static uint32_t power_clock_ticks[POWER_CLOCK_MAX] = {0};
+static uint32_t power_sleep_ticks[POWER_CLOCK_MAX] = {0};
+static uint32_t power_upshift_count = 0;
+static uint32_t power_upshift_max_us = 0;
+
+static void power_set_clock(power_clock_t clock);
+
+void power_init()
+{
+    taskENTER_CRITICAL();
+    power_full_clock_hz = SystemCoreClock;
+    power_clock_since = xTaskGetTickCount();
+    power_policy_start(&power_state, power_clock_since);
+    taskEXIT_CRITICAL();
+
+    log_d("Power governor started");
+}
+
+void power_request(power_source_t source)
+{
+    taskENTER_CRITICAL();
+    const power_clock_t clock = power_policy_request(&power_state, source);
+    if (clock != POWER_CLOCK_MAX) {
+        power_set_clock(clock);
+    }
+    taskEXIT_CRITICAL();
+}
+
+void power_release(power_source_t source)
+{
+    taskENTER_CRITICAL();
+    power_policy_release(&power_state, source, xTaskGetTickCount());
+    taskEXIT_CRITICAL();
+}
+
+void power_activity(power_source_t source)
+{
+    taskENTER_CRITICAL();
+    const power_clock_t clock = power_policy_activity(&power_state, source, xTaskGetTickCount());
+    if (clock != POWER_CLOCK_MAX) {
+        power_set_clock(clock);
+    }
+    taskEXIT_CRITICAL();
+}
+
+void power_idle_hook()
+{
+    if (!power_state.enabled || power_state.clock != POWER_CLOCK_FULL) { return; }
+
+    taskENTER_CRITICAL();
+    const power_clock_t clock = power_policy_idle(&power_state, xTaskGetTickCount());
+    if (clock != POWER_CLOCK_MAX) {
+        power_set_clock(clock);
+    }
+    taskEXIT_CRITICAL();
+}
+
+void power_set_clock(power_clock_t clock)
+{
+    /*
+     * This must be called with interrupts disabled. The PLL is left
+     * running while the clock is reduced, so switching back to the
+     * full clock does not have to wait for it to lock. That leaves
+     * the upshift latency as the time to switch the clock mux and
+     * reconfigure the HAL tick timer, which is measured below and
+     * reported by the GS POWER command.
+     *
+     * The APB dividers are left alone, so PCLK1 and PCLK2 follow
+     * SYSCLK down to the HSI speed. The peripherals on them are
+     * handled as follows:
+     * - I2C1 runs from the HSI, so its timing does not change.
+     * - TIM2 drives the LED PWM, so its prescaler is adjusted to
+     *   keep the frequency required by the LED drivers.
+     * - TIM6 provides the HAL tick, and is reconfigured by
+     *   HAL_RCC_ClockConfig() for the new clock speed.
+     * - SPI1 drives the display, which just updates more slowly.
+     * USART1, the ADC, USB, the RTC and the watchdog all run from
+     * their own clocks.
+     */
+    RCC_ClkInitTypeDef clk_init = {0};
+    const uint32_t now = xTaskGetTickCount();
+    const uint32_t start_val = SysTick->VAL;
+    const uint32_t start_load = SysTick->LOAD + 1UL;
+
+    clk_init.ClockType = RCC_CLOCKTYPE_SYSCLK;
+    clk_init.SYSCLKSource = (clock == POWER_CLOCK_FULL) ? RCC_SYSCLKSOURCE_PLLCLK : RCC_SYSCLKSOURCE_HSI;
+    if (HAL_RCC_ClockConfig(&clk_init, FLASH_LATENCY_1) != HAL_OK) {
+        return;
+    }
+
+    const uint32_t end_val = SysTick->VAL;
+
+    __HAL_TIM_SET_PRESCALER(&htim2, power_policy_timer_prescaler(
+        htim2.Init.Prescaler, power_full_clock_hz, SystemCoreClock));
+
+    /* Restart the kernel tick at the new clock speed */
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    SysTick->LOAD = (SystemCoreClock / configTICK_RATE_HZ) - 1UL;
+    SysTick->VAL = 0UL;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    if (clock == POWER_CLOCK_FULL) {
+        /*
+         * Part of the switch is counted at the full clock, so converting
+         * at the reduced clock gives an upper bound on how long it took.
+         */
+        const uint32_t elapsed_us = power_policy_elapsed_us(start_val, end_val, start_load, HSI_VALUE);
+        if (elapsed_us > power_upshift_max_us) {
+            power_upshift_max_us = elapsed_us;
+        }
+        power_upshift_count++;
+    }
+
+    power_clock_ticks[power_state.clock] += now - power_clock_since;
+    power_clock_since = now;
+    power_state.clock = clock;
+}
+
+void power_get_stats(power_stats_t *stats)
+{
+    if (!stats) { return; }
+
+    taskENTER_CRITICAL();
+    const uint32_t now = xTaskGetTickCount();
+    stats->clock = power_state.clock;
+    stats->sleep_ms = 0;
+    for (uint8_t i = 0; i < POWER_CLOCK_MAX; i++) {
+        uint32_t ticks = power_clock_ticks[i];
+        if (i == power_state.clock && power_state.enabled) {
+            ticks += now - power_clock_since;
+        }
+        stats->awake_ms[i] = (ticks - power_sleep_ticks[i]) * portTICK_PERIOD_MS;
+        stats->sleep_ms += power_sleep_ticks[i] * portTICK_PERIOD_MS;
+    }
+    stats->upshift_count = power_upshift_count;
+    stats->upshift_max_us = power_upshift_max_us;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * Tickless idle implementation, replacing the one provided by the
+ * FreeRTOS port.
+ *
+ * The port calculates its SysTick constants once from the clock speed
+ * at startup, so this version derives them from the current clock
+ * speed instead. It also limits the sleep period, stops the HAL tick
+ * timer while sleeping, and records the time spent asleep.
+ */
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime)
+{
+    const uint32_t counts_per_tick = SystemCoreClock / configTICK_RATE_HZ;
+    const uint32_t max_ticks = MIN(SysTick_LOAD_RELOAD_Msk / counts_per_tick, POWER_SLEEP_MAX_TICKS);
+    uint32_t reload_value;
+    uint32_t complete_tick_periods;
+    uint32_t systick_ctrl;
+
+    xExpectedIdleTime = power_policy_sleep_ticks(xExpectedIdleTime, max_ticks);
+
+    /* Stop the SysTick momentarily */
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+    /* Calculate the reload value required to wait the expected idle time */
+    reload_value = SysTick->VAL + (counts_per_tick * (xExpectedIdleTime - 1UL));
+    if (reload_value > POWER_MISSED_COUNTS_FACTOR) {
+        reload_value -= POWER_MISSED_COUNTS_FACTOR;
+    }
+
+    __disable_irq();
+
+    if (eTaskConfirmSleepModeStatus() == eAbortSleep) {
+        /* Restart from whatever is left in the count register */
+        SysTick->LOAD = SysTick->VAL;
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        SysTick->LOAD = counts_per_tick - 1UL;
+        __enable_irq();
+        return;
+    }
+
+    SysTick->LOAD = reload_value;
+    SysTick->VAL = 0UL;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    /* Sleep until the expected idle time elapses, or an interrupt occurs */
+    HAL_SuspendTick();
+    __DSB();
+    __WFI();
+    __ISB();
+    HAL_ResumeTick();
+
+    /* Stop the SysTick to work out how long the sleep lasted */
+    systick_ctrl = SysTick->CTRL;
+    SysTick->CTRL = systick_ctrl & ~SysTick_CTRL_ENABLE_Msk;
+
+    __enable_irq();
+
+    if ((systick_ctrl & SysTick_CTRL_COUNTFLAG_Msk) != 0) {
+        /*
+         * The tick interrupt has already run, so load whatever remains
+         * of the current tick period.
+         */
+        uint32_t calculated_load = (counts_per_tick - 1UL) - (reload_value - SysTick->VAL);
+        if (calculated_load < POWER_MISSED_COUNTS_FACTOR || calculated_load > counts_per_tick) {
+            calculated_load = counts_per_tick - 1UL;
+        }
+        SysTick->LOAD = calculated_load;
+
+        /* The pended tick accounts for the final tick period */
+        complete_tick_periods = xExpectedIdleTime - 1UL;
+    } else {
+        /* Something other than the tick interrupt ended the sleep */
+        const uint32_t completed_decrements = (xExpectedIdleTime * counts_per_tick) - SysTick->VAL;
+        complete_tick_periods = completed_decrements / counts_per_tick;
+        SysTick->LOAD = ((complete_tick_periods + 1UL) * counts_per_tick) - completed_decrements;
+    }
+
+    /* Restart SysTick, then restore its standard reload value */
+    SysTick->VAL = 0UL;
+    taskENTER_CRITICAL();
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+    vTaskStepTick(complete_tick_periods);
+    SysTick->LOAD = counts_per_tick - 1UL;
+    power_sleep_ticks[power_state.clock] += complete_tick_periods;
+    taskEXIT_CRITICAL();
+}
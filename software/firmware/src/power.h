@@ -0,0 +1,64 @@
+/*
+ * Power governor, which runs the system clock at a reduced speed while
+ * the device is idle, and lets the kernel suppress its tick interrupt
+ * while no task needs to run.
+ */
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "power_policy.h"
+
+/**
+ * Time spent in each power state, in milliseconds.
+ */
+typedef struct {
+    power_clock_t clock;                 /*!< Current system clock speed */
+    uint32_t awake_ms[POWER_CLOCK_MAX];  /*!< Time running at each clock speed */
+    uint32_t sleep_ms;                   /*!< Time in tickless idle sleep */
+    uint32_t upshift_count;              /*!< Number of switches to the full clock */
+    uint32_t upshift_max_us;             /*!< Upper bound on the longest switch to the full clock */
+} power_stats_t;
+
+/**
+ * Start the power governor.
+ *
+ * This should be called once the system has finished starting up,
+ * since the clock will not be reduced until then.
+ */
+void power_init();
+
+/**
+ * Request that the system run at full speed.
+ *
+ * If the clock is currently reduced, it is restored before this
+ * function returns. The request is held until it is released.
+ * This function must not be called from an ISR.
+ */
+void power_request(power_source_t source);
+
+/**
+ * Release a request for the system to run at full speed.
+ *
+ * The clock is not reduced until the idle task next runs, and the
+ * hold period for the source has elapsed.
+ */
+void power_release(power_source_t source);
+
+/**
+ * Note activity from a source, which restores the full clock
+ * and holds it for a period afterwards.
+ */
+void power_activity(power_source_t source);
+
+/**
+ * Reduce the clock speed if the policy allows it.
+ * This is called from the FreeRTOS idle hook.
+ */
+void power_idle_hook();
+
+void power_get_stats(power_stats_t *stats);
+
+#endif /* POWER_H */
@@ -0,0 +1,96 @@
+#include "power_policy.h"
+
+#define POWER_HOLD_USB_TICKS     1000UL
+#define POWER_HOLD_DEFAULT_TICKS 100UL
+
+power_clock_t power_policy_select_clock(const power_policy_input_t *input)
+{
+    if (!input || !input->reduced_allowed) {
+        return POWER_CLOCK_FULL;
+    }
+
+    if (input->requests != 0) {
+        return POWER_CLOCK_FULL;
+    }
+
+    /* Keep full speed until the hold period has elapsed */
+    if (((int32_t)input->hold_ticks - (int32_t)input->now_ticks) > 0) {
+        return POWER_CLOCK_FULL;
+    }
+
+    return POWER_CLOCK_REDUCED;
+}
+
+uint32_t power_policy_sleep_ticks(uint32_t expected_ticks, uint32_t max_ticks)
+{
+    if (max_ticks > 0 && expected_ticks > max_ticks) {
+        return max_ticks;
+    }
+    return expected_ticks;
+}
+
+uint32_t power_policy_hold_ticks(power_source_t source)
+{
+    switch (source) {
+    case POWER_SOURCE_USB:
+        return POWER_HOLD_USB_TICKS;
+    default:
+        return POWER_HOLD_DEFAULT_TICKS;
+    }
+}
+
+void power_policy_start(power_policy_state_t *state, uint32_t now_ticks)
+{
+    state->hold_ticks = now_ticks + power_policy_hold_ticks(POWER_SOURCE_USB);
+    state->enabled = true;
+}
+
+power_clock_t power_policy_request(power_policy_state_t *state, power_source_t source)
+{
+    state->requests |= source;
+    return (state->clock != POWER_CLOCK_FULL) ? POWER_CLOCK_FULL : POWER_CLOCK_MAX;
+}
+
+void power_policy_release(power_policy_state_t *state, power_source_t source, uint32_t now_ticks)
+{
+    if ((state->requests & source) != 0) {
+        state->requests &= ~source;
+        state->hold_ticks = now_ticks + power_policy_hold_ticks(source);
+    }
+}
+
+power_clock_t power_policy_activity(power_policy_state_t *state, power_source_t source, uint32_t now_ticks)
+{
+    state->hold_ticks = now_ticks + power_policy_hold_ticks(source);
+    return (state->clock != POWER_CLOCK_FULL) ? POWER_CLOCK_FULL : POWER_CLOCK_MAX;
+}
+
+power_clock_t power_policy_idle(const power_policy_state_t *state, uint32_t now_ticks)
+{
+    if (state->clock != POWER_CLOCK_FULL) { return POWER_CLOCK_MAX; }
+
+    const power_policy_input_t input = {
+        .requests = state->requests,
+        .now_ticks = now_ticks,
+        .hold_ticks = state->hold_ticks,
+        .reduced_allowed = state->enabled
+    };
+    return (power_policy_select_clock(&input) == POWER_CLOCK_REDUCED) ? POWER_CLOCK_REDUCED : POWER_CLOCK_MAX;
+}
+
+uint32_t power_policy_elapsed_us(uint32_t start_val, uint32_t end_val, uint32_t period, uint32_t clock_hz)
+{
+    const uint32_t elapsed = (start_val >= end_val)
+        ? (start_val - end_val) : (start_val + period - end_val);
+    const uint32_t counts_per_us = clock_hz / 1000000UL;
+    if (counts_per_us == 0) { return 0; }
+    return (elapsed + counts_per_us - 1UL) / counts_per_us;
+}
+
+uint32_t power_policy_timer_prescaler(uint32_t full_prescaler, uint32_t full_hz, uint32_t clock_hz)
+{
+    if (full_hz == 0 || clock_hz >= full_hz) { return full_prescaler; }
+
+    const uint64_t divider = ((uint64_t)(full_prescaler + 1UL) * clock_hz) / full_hz;
+    return (divider > 0) ? (uint32_t)(divider - 1UL) : 0;
+}
@@ -0,0 +1,134 @@
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+/*
+ * Decision logic for the power governor.
+ *
+ * These functions only depend on the C standard library, so that the
+ * governor's policy can be built and exercised on a host machine
+ * separately from the hardware specific code in power.c.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * System clock speeds selected by the power governor.
+ */
+typedef enum {
+    POWER_CLOCK_FULL = 0,
+    POWER_CLOCK_REDUCED,
+    POWER_CLOCK_MAX
+} power_clock_t;
+
+/**
+ * Sources that need the system to run at full speed.
+ */
+typedef enum {
+    POWER_SOURCE_SENSOR  = 0x01, /*!< Sensor running for a measurement or calibration */
+    POWER_SOURCE_USB     = 0x02, /*!< USB CDC traffic */
+    POWER_SOURCE_SUSPEND = 0x04, /*!< USB suspend, which restores the full clock on wakeup */
+    POWER_SOURCE_KEYPAD  = 0x08  /*!< Key events, which may start a measurement */
+} power_source_t;
+
+typedef struct {
+    uint32_t requests;        /*!< Bitmask of active power_source_t requests */
+    uint32_t now_ticks;       /*!< Current kernel tick count */
+    uint32_t hold_ticks;      /*!< Tick count until which recent activity holds full speed */
+    bool reduced_allowed;     /*!< Whether the reduced clock may be used at all */
+} power_policy_input_t;
+
+/**
+ * State of the power governor.
+ *
+ * The functions that update it return the clock speed the governor has
+ * to switch to, or POWER_CLOCK_MAX to leave the clock as it is. The
+ * caller makes the switch, and then records the new speed in the state.
+ */
+typedef struct {
+    uint32_t requests;        /*!< Bitmask of active power_source_t requests */
+    uint32_t hold_ticks;      /*!< Tick count until which recent activity holds full speed */
+    power_clock_t clock;      /*!< Current system clock speed */
+    bool enabled;             /*!< Whether the governor has been started */
+} power_policy_state_t;
+
+/**
+ * Select the system clock speed for the current conditions.
+ *
+ * The reduced clock is only chosen when nothing has requested full speed,
+ * and the hold period following the last activity has elapsed.
+ */
+power_clock_t power_policy_select_clock(const power_policy_input_t *input);
+
+/**
+ * Limit the length of a tickless idle period.
+ *
+ * @param expected_ticks Idle period expected by the kernel
+ * @param max_ticks Longest period allowed, such as by the watchdog timeout
+ * @return Number of ticks to sleep for
+ */
+uint32_t power_policy_sleep_ticks(uint32_t expected_ticks, uint32_t max_ticks);
+
+/**
+ * Get the hold time to apply following activity from a source.
+ *
+ * USB activity tends to arrive in bursts, so a short hold keeps the
+ * clock from bouncing between speeds on every packet.
+ */
+uint32_t power_policy_hold_ticks(power_source_t source);
+
+/**
+ * Start the governor, holding the full clock briefly so that the
+ * host has a chance to enumerate the USB device.
+ */
+void power_policy_start(power_policy_state_t *state, uint32_t now_ticks);
+
+/**
+ * Add a request for the full clock, which is restored straight away.
+ */
+power_clock_t power_policy_request(power_policy_state_t *state, power_source_t source);
+
+/**
+ * Release a request for the full clock, starting the hold period for
+ * the source. The clock is never changed here, only when idle.
+ */
+void power_policy_release(power_policy_state_t *state, power_source_t source, uint32_t now_ticks);
+
+/**
+ * Note activity from a source, restoring the full clock straight away
+ * and holding it for the hold period of the source.
+ */
+power_clock_t power_policy_activity(power_policy_state_t *state, power_source_t source, uint32_t now_ticks);
+
+/**
+ * Decide whether to reduce the clock, when the system is idle.
+ */
+power_clock_t power_policy_idle(const power_policy_state_t *state, uint32_t now_ticks);
+
+/**
+ * Convert the SysTick counts that elapsed during an operation into
+ * microseconds.
+ *
+ * SysTick counts down from its reload value, so this handles the
+ * counter having wrapped once during the operation.
+ *
+ * @param start_val Counter value at the start
+ * @param end_val Counter value at the end
+ * @param period Counts in one SysTick period, its reload value plus one
+ * @param clock_hz Clock the elapsed counts are converted at
+ * @return Elapsed time, rounded up to the next microsecond
+ */
+uint32_t power_policy_elapsed_us(uint32_t start_val, uint32_t end_val, uint32_t period, uint32_t clock_hz);
+
+/**
+ * Get the timer prescaler that keeps a timer counting at the same rate
+ * after the clock it runs from changes speed.
+ *
+ * @param full_prescaler Prescaler register value at the full clock
+ * @param full_hz Full clock speed
+ * @param clock_hz New clock speed
+ * @return Prescaler register value for the new clock speed
+ */
+uint32_t power_policy_timer_prescaler(uint32_t full_prescaler, uint32_t full_hz, uint32_t clock_hz);
+
+#endif /* POWER_POLICY_H */
@@ -0,0 +1,127 @@
+#include "quality_policy.h"
+
+#include <string.h>
+#include <math.h>
+
+/*
+ * Limits on the spread between repeated target readings, beyond which the
+ * target is assumed to have moved. The spread has to exceed both a fraction
+ * of the reading and a multiple of its counting statistics, so that dense
+ * targets are not flagged for ordinary sensor noise.
+ */
+#define QUALITY_SPREAD_RATIO (0.02F)
+#define QUALITY_SPREAD_SIGMA (5.0F)
+
+/* Variance of uniform quantization noise, in raw counts (1/12) */
+#define QUALITY_QUANTIZATION_VARIANCE (0.083333F)
+
+void quality_policy_init(quality_policy_t *policy, bool check_detect)
+{
+    if (!policy) { return; }
+    memset(policy, 0, sizeof(quality_policy_t));
+    policy->check_detect = check_detect;
+}
+
+bool quality_policy_is_saturated(uint16_t ch0_val, uint16_t ch1_val, tsl2591_time_t time)
+{
+    uint16_t limit;
+    if (time == TSL2591_TIME_100MS) {
+        limit = TSL2591_ANALOG_SATURATION;
+    } else {
+        limit = TSL2591_DIGITAL_SATURATION;
+    }
+    return ch0_val >= limit || ch1_val >= limit;
+}
+
+uint8_t quality_policy_add_reading(quality_policy_t *policy, const quality_reading_t *reading)
+{
+    uint8_t quality = SENSOR_QUALITY_OK;
+
+    if (!policy || !reading || policy->count >= QUALITY_POLICY_MAX_READINGS) {
+        return SENSOR_QUALITY_INVALID;
+    }
+
+    if (quality_policy_is_saturated(reading->ch0_val, reading->ch1_val, reading->time)) {
+        quality |= SENSOR_QUALITY_SATURATED;
+    }
+    if ((reading->status & TSL2591_STATUS_AVALID) == 0) {
+        quality |= SENSOR_QUALITY_INVALID;
+    }
+    if (policy->check_detect && !reading->detect) {
+        quality |= SENSOR_QUALITY_LID_OPEN;
+    }
+
+    policy->ch0_sum += reading->ch0_basic;
+    policy->ch1_sum += reading->ch1_basic;
+    policy->ch0_values[policy->count] = reading->ch0_basic;
+
+    /*
+     * Treat the raw count as Poisson distributed, with an added
+     * term for the ADC quantization, and scale the resulting
+     * variance into basic counts.
+     */
+    if (reading->ch0_val > 0) {
+        float scale = reading->ch0_basic / (float)reading->ch0_val;
+        policy->ch0_count_var_sum += (scale * scale) * ((float)reading->ch0_val + QUALITY_QUANTIZATION_VARIANCE);
+    }
+
+    policy->count++;
+    policy->quality |= quality;
+    return quality;
+}
+
+uint8_t quality_policy_finish(quality_policy_t *policy,
+    float *ch0_result, float *ch1_result, float *ch0_uncertainty)
+{
+    if (!policy || policy->count < 2) {
+        if (ch0_result) { *ch0_result = NAN; }
+        if (ch1_result) { *ch1_result = NAN; }
+        if (ch0_uncertainty) { *ch0_uncertainty = NAN; }
+        return SENSOR_QUALITY_INVALID;
+    }
+
+    const float count = (float)policy->count;
+    float ch0_avg = policy->ch0_sum / count;
+    float ch1_avg = policy->ch1_sum / count;
+
+    /*
+     * Combine the counting statistics of the averaged readings with
+     * the standard error of the mean across the repeated readings.
+     * These overlap somewhat, so the result is slightly conservative.
+     */
+    float ch0_min = policy->ch0_values[0];
+    float ch0_max = policy->ch0_values[0];
+    float ch0_spread_var = 0;
+    for (uint8_t i = 0; i < policy->count; i++) {
+        float diff = policy->ch0_values[i] - ch0_avg;
+        ch0_spread_var += diff * diff;
+        if (policy->ch0_values[i] < ch0_min) { ch0_min = policy->ch0_values[i]; }
+        if (policy->ch0_values[i] > ch0_max) { ch0_max = policy->ch0_values[i]; }
+    }
+    ch0_spread_var /= (count - 1.0F);
+
+    /*
+     * Repeated readings of a still target should only differ by the
+     * counting statistics of a single reading, so anything well beyond
+     * that means the target moved during the measurement.
+     */
+    float count_sd = sqrtf(policy->ch0_count_var_sum / count);
+    float spread_limit = fmaxf(QUALITY_SPREAD_RATIO * ch0_avg, QUALITY_SPREAD_SIGMA * count_sd);
+    if ((ch0_max - ch0_min) > spread_limit) {
+        policy->quality |= SENSOR_QUALITY_UNSTABLE;
+    }
+
+    if (ch0_result) { *ch0_result = ch0_avg; }
+    if (ch1_result) { *ch1_result = ch1_avg; }
+    if (ch0_uncertainty) {
+        *ch0_uncertainty = sqrtf(
+            (policy->ch0_count_var_sum / (count * count))
+            + (ch0_spread_var / count));
+    }
+    return policy->quality;
+}
+
+bool quality_policy_should_retry(uint8_t attempt, uint8_t quality)
+{
+    return quality != SENSOR_QUALITY_OK && attempt < QUALITY_POLICY_RETRIES;
+}
@@ -0,0 +1,107 @@
+#ifndef QUALITY_POLICY_H
+#define QUALITY_POLICY_H
+
+/*
+ * Quality checks for target measurements.
+ *
+ * These functions only depend on the C standard library and the sensor
+ * register definitions, so that the checks made across a measurement
+ * and the retry decision can be built and exercised on a host machine
+ * separately from the sensor code in sensor.c.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "tsl2591.h"
+
+/**
+ * Quality flags for a target reading, set when the reading failed one
+ * of the checks made across the measurement.
+ */
+#define SENSOR_QUALITY_OK        0x00 /*!< Reading passed all checks */
+#define SENSOR_QUALITY_UNSTABLE  0x01 /*!< Repeated readings disagreed, likely from target movement */
+#define SENSOR_QUALITY_SATURATED 0x02 /*!< A sensor channel saturated */
+#define SENSOR_QUALITY_INVALID   0x04 /*!< Sensor did not report a valid integration cycle */
+#define SENSOR_QUALITY_LID_OPEN  0x08 /*!< Detect switch opened during the measurement */
+
+/* Most readings that can be combined into one measurement */
+#define QUALITY_POLICY_MAX_READINGS 8
+
+/* Number of times a target read is repeated if it fails its quality checks */
+#define QUALITY_POLICY_RETRIES 2
+
+/**
+ * A single raw reading taken as part of a target measurement.
+ */
+typedef struct {
+    uint16_t ch0_val;     /*!< CH0 raw reading */
+    uint16_t ch1_val;     /*!< CH1 raw reading */
+    tsl2591_time_t time;  /*!< Integration time of the reading */
+    uint8_t status;       /*!< Sensor status register */
+    float ch0_basic;      /*!< CH0 reading, in basic counts */
+    float ch1_basic;      /*!< CH1 reading, in basic counts */
+    bool detect;          /*!< Whether the detect switch was closed after the reading */
+} quality_reading_t;
+
+/**
+ * State accumulated across the readings of one measurement attempt.
+ */
+typedef struct {
+    bool check_detect;
+    uint8_t count;
+    uint8_t quality;
+    float ch0_sum;
+    float ch1_sum;
+    float ch0_count_var_sum;
+    float ch0_values[QUALITY_POLICY_MAX_READINGS];
+} quality_policy_t;
+
+/**
+ * Start a new measurement attempt.
+ *
+ * @param check_detect Whether the detect switch has to stay closed,
+ *        which is only the case if it was closed at the start
+ */
+void quality_policy_init(quality_policy_t *policy, bool check_detect);
+
+/**
+ * Check whether a raw reading has saturated either channel.
+ */
+bool quality_policy_is_saturated(uint16_t ch0_val, uint16_t ch1_val, tsl2591_time_t time);
+
+/**
+ * Check a reading and add it to the measurement.
+ *
+ * A reading that fails a check is still added, so that the attempt
+ * can complete and report everything that went wrong with it.
+ *
+ * @return Quality flags for this reading alone
+ */
+uint8_t quality_policy_add_reading(quality_policy_t *policy, const quality_reading_t *reading);
+
+/**
+ * Combine the readings of the measurement and check their consistency.
+ *
+ * The standard uncertainty of the Channel 0 result combines the counting
+ * statistics of each raw reading with the spread between the repeated
+ * readings, and is expressed in basic counts.
+ *
+ * @param ch0_result Channel 0 average, in basic counts
+ * @param ch1_result Channel 1 average, in basic counts
+ * @param ch0_uncertainty Channel 0 standard uncertainty, in basic counts
+ * @return Quality flags for the whole measurement
+ */
+uint8_t quality_policy_finish(quality_policy_t *policy,
+    float *ch0_result, float *ch1_result, float *ch0_uncertainty);
+
+/**
+ * Decide whether a failed measurement attempt should be repeated.
+ *
+ * @param attempt Zero based index of the attempt that just completed
+ * @param quality Quality flags of that attempt
+ * @return True if another attempt should be made
+ */
+bool quality_policy_should_retry(uint8_t attempt, uint8_t quality);
+
+#endif /* QUALITY_POLICY_H */
@@ -0,0 +1,128 @@
+#include "selftest.h"
+#include "selftest_policy.h"
+
+#define LOG_TAG "selftest"
+#include <elog.h>
+
+#include <cmsis_os.h>
+
+#include "tsl2591.h"
+#include "sensor.h"
+#include "task_sensor.h"
+#include "settings.h"
+#include "adc_handler.h"
+#include "display.h"
+#include "u8g2_stm32_hal.h"
+#include "keypad.h"
+
+/* Sensor configuration used for the dark and light readings */
+#define SELFTEST_SENSOR_GAIN     TSL2591_GAIN_MEDIUM
+#define SELFTEST_SENSOR_TIME     TSL2591_TIME_100MS
+
+/* Samples used to look for stuck buttons */
+#define SELFTEST_KEYPAD_SAMPLES  10
+#define SELFTEST_KEYPAD_DELAY_MS 10
+
+static void selftest_read_sensor(selftest_inputs_t *inputs);
+static void selftest_read_settings(selftest_inputs_t *inputs);
+static void selftest_read_adc(selftest_inputs_t *inputs);
+static void selftest_read_display(selftest_inputs_t *inputs);
+static void selftest_read_keypad(selftest_inputs_t *inputs);
+
+uint8_t selftest_run(selftest_callback_t callback, void *user_data)
+{
+    selftest_inputs_t inputs = {0};
+    selftest_result_t results[SELFTEST_COUNT];
+    uint8_t failures;
+
+    log_i("Starting self-test");
+
+    selftest_read_sensor(&inputs);
+    selftest_read_settings(&inputs);
+    selftest_read_adc(&inputs);
+    selftest_read_display(&inputs);
+    selftest_read_keypad(&inputs);
+
+    failures = selftest_policy_evaluate(&inputs, results);
+
+    for (size_t i = 0; i < SELFTEST_COUNT; i++) {
+        if (results[i].status == SELFTEST_FAIL) {
+            log_w("Self-test %s failed: %ld", selftest_check_name(i), results[i].value);
+        }
+        if (callback) {
+            callback(i, &results[i], user_data);
+        }
+    }
+
+    log_i("Self-test complete, %d failed", failures);
+
+    return failures;
+}
+
+void selftest_read_sensor(selftest_inputs_t *inputs)
+{
+    uint16_t ch1 = 0;
+
+    osStatus_t ret = sensor_self_check(&inputs->sensor_id, &inputs->sensor_reg_errors);
+    if (ret != osOK) {
+        log_w("Sensor check error: %d", ret);
+        return;
+    }
+    inputs->sensor_responded = true;
+
+    /* The readings are meaningless if the sensor itself is not responding */
+    if (!selftest_policy_sensor_usable(inputs)) { return; }
+
+    ret = sensor_read_target_raw(SENSOR_LIGHT_OFF,
+        SELFTEST_SENSOR_GAIN, SELFTEST_SENSOR_TIME, &inputs->dark_ch0, &ch1);
+    inputs->dark_read = (ret == osOK);
+
+    if (!selftest_policy_dark_usable(inputs)) { return; }
+
+    ret = sensor_read_target_raw(SENSOR_LIGHT_REFLECTION,
+        SELFTEST_SENSOR_GAIN, SELFTEST_SENSOR_TIME, &inputs->refl_ch0, &ch1);
+    inputs->refl_read = (ret == osOK);
+
+    ret = sensor_read_target_raw(SENSOR_LIGHT_TRANSMISSION,
+        SELFTEST_SENSOR_GAIN, SELFTEST_SENSOR_TIME, &inputs->tran_ch0, &ch1);
+    inputs->tran_read = (ret == osOK);
+}
+
+void selftest_read_settings(selftest_inputs_t *inputs)
+{
+    settings_check_integrity(&inputs->settings_failed);
+}
+
+void selftest_read_adc(selftest_inputs_t *inputs)
+{
+    adc_readings_t readings;
+
+    if (adc_read(&readings) == osOK) {
+        inputs->adc_read = true;
+        inputs->vdda_mv = readings.vdda_mv;
+        inputs->temp_c = readings.temp_c;
+    }
+}
+
+void selftest_read_display(selftest_inputs_t *inputs)
+{
+    /*
+     * The display cannot acknowledge anything it receives, so the best
+     * available check is to send it a harmless command and make sure
+     * the transfer completes without a bus error.
+     */
+    uint32_t errors = u8g2_stm32_hal_get_error_count();
+    display_set_contrast(display_get_contrast());
+    inputs->display_errors = u8g2_stm32_hal_get_error_count() - errors;
+}
+
+void selftest_read_keypad(selftest_inputs_t *inputs)
+{
+    /* Only a button that reads as pressed in every sample is considered stuck */
+    uint8_t stuck = 0xFF;
+    for (int i = 0; i < SELFTEST_KEYPAD_SAMPLES; i++) {
+        stuck &= keypad_get_raw_state();
+        osDelay(pdMS_TO_TICKS(SELFTEST_KEYPAD_DELAY_MS));
+    }
+    inputs->keypad_stuck = stuck;
+}
@@ -0,0 +1,61 @@
+/*
+ * Built-in self-test, which exercises each major hardware subsystem
+ * and reports a pass/fail result along with the value it was based on.
+ */
+#ifndef SELFTEST_H
+#define SELFTEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Outcome of a single self-test check.
+ */
+typedef enum {
+    SELFTEST_PASS = 0,
+    SELFTEST_FAIL,
+    SELFTEST_SKIP /*!< Not run, because a check it depends on failed */
+} selftest_status_t;
+
+/**
+ * Self-test checks, in the order they are run.
+ */
+typedef enum {
+    SELFTEST_SENSOR_ID = 0, /*!< Sensor device ID register */
+    SELFTEST_SENSOR_REG,    /*!< Sensor config registers, as a count of mismatches */
+    SELFTEST_SENSOR_DARK,   /*!< Sensor CH0 reading with both lights off */
+    SELFTEST_LIGHT_REFL,    /*!< Increase in CH0 with the reflection light on */
+    SELFTEST_LIGHT_TRAN,    /*!< Increase in CH0 with the transmission light on */
+    SELFTEST_SETTINGS,      /*!< Mask of settings records with a bad CRC */
+    SELFTEST_VDDA,          /*!< Analog supply voltage, in millivolts */
+    SELFTEST_TEMP,          /*!< MCU temperature, in tenths of a degree C */
+    SELFTEST_DISPLAY,       /*!< Display bus transfer errors */
+    SELFTEST_KEYPAD,        /*!< Mask of buttons that read as held down */
+    SELFTEST_COUNT
+} selftest_check_t;
+
+typedef struct {
+    selftest_status_t status;
+    int32_t value;
+} selftest_result_t;
+
+/**
+ * Called once for each check, in order, after all of them have run.
+ */
+typedef void (*selftest_callback_t)(selftest_check_t check, const selftest_result_t *result, void *user_data);
+
+/**
+ * Run every self-test check.
+ *
+ * The sensor checks drive the sensor and its lights directly, so this
+ * must only be called while nothing else is using them. For the light
+ * checks to be meaningful, the device should be closed with nothing
+ * between the sensor and the lights.
+ *
+ * @param callback Function to receive each result
+ * @param user_data Passed through to the callback
+ * @return Number of checks that failed
+ */
+uint8_t selftest_run(selftest_callback_t callback, void *user_data);
+
+#endif /* SELFTEST_H */
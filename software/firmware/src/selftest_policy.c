@@ -0,0 +1,161 @@
+#include "selftest_policy.h"
+
+#include <printf.h>
+#include <limits.h>
+#include <math.h>
+
+#include "tsl2591.h"
+
+/* Smallest increase in CH0 counts that shows a light is working */
+#define SELFTEST_LIGHT_MIN_DELTA 50
+
+/* Acceptable range for the analog supply, in millivolts */
+#define SELFTEST_VDDA_MIN        3000
+#define SELFTEST_VDDA_MAX        3600
+
+/* Acceptable range for the MCU temperature, in degrees C */
+#define SELFTEST_TEMP_MIN        (-20.0F)
+#define SELFTEST_TEMP_MAX        (85.0F)
+
+static void selftest_set(selftest_result_t *result, bool pass, int32_t value)
+{
+    result->status = pass ? SELFTEST_PASS : SELFTEST_FAIL;
+    result->value = value;
+}
+
+bool selftest_policy_sensor_usable(const selftest_inputs_t *inputs)
+{
+    return inputs && inputs->sensor_responded && inputs->sensor_id == TSL2591_DEVICE_ID;
+}
+
+bool selftest_policy_dark_usable(const selftest_inputs_t *inputs)
+{
+    /* With the lights off, the sensor should be nowhere near saturation */
+    return selftest_policy_sensor_usable(inputs)
+        && inputs->dark_read && inputs->dark_ch0 < TSL2591_ANALOG_SATURATION;
+}
+
+static void selftest_evaluate_light(selftest_result_t *result, bool read, uint16_t ch0, uint16_t dark_ch0)
+{
+    if (!read) {
+        selftest_set(result, false, -1);
+        return;
+    }
+
+    /* A saturated reading still shows that the light is working */
+    int32_t delta = (ch0 == USHRT_MAX) ? USHRT_MAX : (int32_t)ch0 - (int32_t)dark_ch0;
+    selftest_set(result, delta >= SELFTEST_LIGHT_MIN_DELTA, delta);
+}
+
+uint8_t selftest_policy_evaluate(const selftest_inputs_t *inputs, selftest_result_t *results)
+{
+    uint8_t failures = 0;
+
+    if (!inputs || !results) { return 0; }
+
+    for (size_t i = 0; i < SELFTEST_COUNT; i++) {
+        results[i].status = SELFTEST_SKIP;
+        results[i].value = 0;
+    }
+
+    if (!inputs->sensor_responded) {
+        selftest_set(&results[SELFTEST_SENSOR_ID], false, -1);
+    } else {
+        selftest_set(&results[SELFTEST_SENSOR_ID],
+            inputs->sensor_id == TSL2591_DEVICE_ID, inputs->sensor_id);
+        selftest_set(&results[SELFTEST_SENSOR_REG],
+            inputs->sensor_reg_errors == 0, inputs->sensor_reg_errors);
+    }
+
+    /* The readings are meaningless if the sensor itself is not responding */
+    if (selftest_policy_sensor_usable(inputs)) {
+        if (!inputs->dark_read) {
+            selftest_set(&results[SELFTEST_SENSOR_DARK], false, -1);
+        } else {
+            selftest_set(&results[SELFTEST_SENSOR_DARK],
+                selftest_policy_dark_usable(inputs), inputs->dark_ch0);
+        }
+        if (selftest_policy_dark_usable(inputs)) {
+            selftest_evaluate_light(&results[SELFTEST_LIGHT_REFL], inputs->refl_read, inputs->refl_ch0, inputs->dark_ch0);
+            selftest_evaluate_light(&results[SELFTEST_LIGHT_TRAN], inputs->tran_read, inputs->tran_ch0, inputs->dark_ch0);
+        }
+    }
+
+    selftest_set(&results[SELFTEST_SETTINGS], inputs->settings_failed == 0, (int32_t)inputs->settings_failed);
+
+    if (!inputs->adc_read) {
+        selftest_set(&results[SELFTEST_VDDA], false, -1);
+        selftest_set(&results[SELFTEST_TEMP], false, -1);
+    } else {
+        selftest_set(&results[SELFTEST_VDDA],
+            inputs->vdda_mv >= SELFTEST_VDDA_MIN && inputs->vdda_mv <= SELFTEST_VDDA_MAX,
+            inputs->vdda_mv);
+        selftest_set(&results[SELFTEST_TEMP],
+            inputs->temp_c >= SELFTEST_TEMP_MIN && inputs->temp_c <= SELFTEST_TEMP_MAX,
+            isnan(inputs->temp_c) ? -1 : (int32_t)lroundf(inputs->temp_c * 10.0F));
+    }
+
+    selftest_set(&results[SELFTEST_DISPLAY], inputs->display_errors == 0, (int32_t)inputs->display_errors);
+    selftest_set(&results[SELFTEST_KEYPAD], inputs->keypad_stuck == 0, inputs->keypad_stuck);
+
+    for (size_t i = 0; i < SELFTEST_COUNT; i++) {
+        if (results[i].status == SELFTEST_FAIL) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+size_t selftest_policy_format_result(char *buf, size_t len, selftest_check_t check, const selftest_result_t *result)
+{
+    int n = snprintf(buf, len, "%s,%s,%ld\r\n",
+        selftest_check_name(check), selftest_status_name(result->status), (long)result->value);
+    return (n < 0) ? 0 : (size_t)n;
+}
+
+size_t selftest_policy_format_summary(char *buf, size_t len, uint8_t failures)
+{
+    int n = snprintf(buf, len, "RESULT,%s,%d\r\n", failures == 0 ? "PASS" : "FAIL", failures);
+    return (n < 0) ? 0 : (size_t)n;
+}
+
+const char *selftest_check_name(selftest_check_t check)
+{
+    switch (check) {
+    case SELFTEST_SENSOR_ID:
+        return "SENSOR_ID";
+    case SELFTEST_SENSOR_REG:
+        return "SENSOR_REG";
+    case SELFTEST_SENSOR_DARK:
+        return "SENSOR_DARK";
+    case SELFTEST_LIGHT_REFL:
+        return "LIGHT_REFL";
+    case SELFTEST_LIGHT_TRAN:
+        return "LIGHT_TRAN";
+    case SELFTEST_SETTINGS:
+        return "SETTINGS";
+    case SELFTEST_VDDA:
+        return "VDDA";
+    case SELFTEST_TEMP:
+        return "TEMP";
+    case SELFTEST_DISPLAY:
+        return "DISPLAY";
+    case SELFTEST_KEYPAD:
+        return "KEYPAD";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+const char *selftest_status_name(selftest_status_t status)
+{
+    switch (status) {
+    case SELFTEST_PASS:
+        return "PASS";
+    case SELFTEST_FAIL:
+        return "FAIL";
+    case SELFTEST_SKIP:
+    default:
+        return "SKIP";
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef SELFTEST_POLICY_H
+#define SELFTEST_POLICY_H
+
+/*
+ * Pass/fail decisions and result formatting for the built-in self-test.
+ *
+ * These functions only depend on the C standard library, the printf
+ * library and the sensor register definitions, so that the decisions made from the raw hardware readings,
+ * and the lines reported for them, can be built and exercised on a host
+ * machine separately from the hardware access in selftest.c.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "selftest.h"
+
+/* Longest line produced for a single check or the summary, including CRLF */
+#define SELFTEST_LINE_SIZE 48
+
+/**
+ * Raw readings gathered from the hardware for the self-test.
+ *
+ * Readings that depend on an earlier check are only gathered if that
+ * check passed, as reported by selftest_policy_sensor_usable() and
+ * selftest_policy_dark_usable(), and are otherwise ignored.
+ */
+typedef struct {
+    bool sensor_responded;     /*!< Sensor answered its register reads */
+    uint8_t sensor_id;         /*!< Sensor device ID register */
+    uint8_t sensor_reg_errors; /*!< Sensor configs that did not read back as written */
+    bool dark_read;            /*!< Dark reading completed */
+    uint16_t dark_ch0;         /*!< CH0 with both lights off */
+    bool refl_read;            /*!< Reflection light reading completed */
+    uint16_t refl_ch0;         /*!< CH0 with the reflection light on */
+    bool tran_read;            /*!< Transmission light reading completed */
+    uint16_t tran_ch0;         /*!< CH0 with the transmission light on */
+    uint32_t settings_failed;  /*!< Mask from settings_check_integrity() */
+    bool adc_read;             /*!< ADC conversion completed */
+    uint16_t vdda_mv;          /*!< Analog supply voltage */
+    float temp_c;              /*!< MCU temperature */
+    uint32_t display_errors;   /*!< Display bus errors during a test transfer */
+    uint8_t keypad_stuck;      /*!< Buttons that read as held down in every sample */
+} selftest_inputs_t;
+
+/**
+ * Check whether the sensor responded well enough to take readings with.
+ */
+bool selftest_policy_sensor_usable(const selftest_inputs_t *inputs);
+
+/**
+ * Check whether the dark reading is usable as a baseline for the light checks.
+ */
+bool selftest_policy_dark_usable(const selftest_inputs_t *inputs);
+
+/**
+ * Decide the result of every check from the gathered readings.
+ *
+ * @param inputs Readings gathered from the hardware
+ * @param results Array of SELFTEST_COUNT results to populate
+ * @return Number of checks that failed
+ */
+uint8_t selftest_policy_evaluate(const selftest_inputs_t *inputs, selftest_result_t *results);
+
+/**
+ * Format the line reported for one check, as `<CHECK>,<STATUS>,<VALUE>`.
+ *
+ * @return Length of the line, including the trailing CRLF
+ */
+size_t selftest_policy_format_result(char *buf, size_t len, selftest_check_t check, const selftest_result_t *result);
+
+/**
+ * Format the summary line, as `RESULT,<STATUS>,<FAILURES>`.
+ *
+ * @return Length of the line, including the trailing CRLF
+ */
+size_t selftest_policy_format_summary(char *buf, size_t len, uint8_t failures);
+
+const char *selftest_check_name(selftest_check_t check);
+const char *selftest_status_name(selftest_status_t status);
+
+#endif /* SELFTEST_POLICY_H */
@@ -15,23 +15,39 @@
 #include "task_sensor.h"
 #include "tsl2591.h"
 #include "light.h"
+#include "adc_handler.h"
+#include "keypad.h"
 #include "util.h"
+#include "task_watchdog.h"
+#include "gain_cal_policy.h"
+#include "quality_policy.h"
 
 #define SENSOR_TARGET_READ_ITERATIONS 2
 #define SENSOR_GAIN_CAL_READ_ITERATIONS 5
 #define SENSOR_GAIN_LED_CHECK_READ_ITERATIONS 2
 
+
 /* These constants are for the matte white stage plate */
-#define GAIN_CAL_BRIGHTNESS_LOW_MED   128
 #define GAIN_CAL_BRIGHTNESS_MED_HIGH  128  /* actual value determined dynamically */
 #define GAIN_CAL_BRIGHTNESS_HIGH_MAX  8    /* actual value determined dynamically */
 
 #define LIGHT_CAL_CH0_TARGET_FACTOR   (0.98F)
 #define GAIN_CAL_CH0_TARGET_FACTOR    (0.75F)
 
+/* State shared with the gain calibration operations */
+typedef struct {
+    sensor_gain_calibration_callback_t callback;
+    void *user_data;
+    osStatus_t ret;
+} sensor_gain_cal_context_t;
+
+/* Reference temperature for the temperature compensation model */
+#define TEMP_COMP_REFERENCE_C (25.0F)
+
 /* Number of iterations to use for light source calibration */
 #define LIGHT_CAL_ITERATIONS 600
 
+static osStatus_t sensor_gain_calibration_run(bool resume, sensor_gain_calibration_callback_t callback, void *user_data);
 static osStatus_t sensor_gain_calibration_loop(
     tsl2591_gain_t gain0, tsl2591_gain_t gain1, tsl2591_time_t time,
     uint8_t led_brightness,
@@ -39,19 +55,47 @@ static osStatus_t sensor_gain_calibration_loop(
     sensor_gain_calibration_status_t callback_status,
     sensor_gain_calibration_callback_t callback, void *user_data);
 static bool sensor_gain_calibration_cooldown(sensor_gain_calibration_callback_t callback, void *user_data);
-static osStatus_t sensor_find_gain_brightness(uint8_t *led_brightness,
+static osStatus_t sensor_find_gain_brightness(uint8_t *led_brightness, float *ch0_reading,
     tsl2591_gain_t gain, tsl2591_time_t time,
     uint8_t start_brightness, uint8_t end_brightness,
     float target_factor,
     sensor_gain_calibration_callback_t callback, void *user_data);
+static osStatus_t sensor_read_gain_brightness(float *ch0_reading, uint8_t led_brightness,
+    tsl2591_gain_t gain, tsl2591_time_t time);
+static bool sensor_gain_cal_resume(settings_gain_cal_stage_t stage, void *user_data);
+static bool sensor_gain_cal_cooldown(void *user_data);
+static bool sensor_gain_cal_find_brightness(settings_gain_cal_stage_t stage,
+    uint8_t *brightness, float *ch0_reading, void *user_data);
+static bool sensor_gain_cal_read_brightness(settings_gain_cal_stage_t stage,
+    uint8_t brightness, float *ch0_reading, void *user_data);
+static bool sensor_gain_cal_measure_gain(settings_gain_cal_stage_t stage, uint8_t brightness,
+    float *ch0_ratio, float *ch1_ratio, void *user_data);
+static void sensor_gain_cal_save_checkpoint(const settings_cal_gain_checkpoint_t *checkpoint, void *user_data);
+static void sensor_gain_cal_clear_checkpoint(settings_cal_gain_checkpoint_t *checkpoint, void *user_data);
 static bool gain_status_callback(
     sensor_gain_calibration_callback_t callback,
     sensor_gain_calibration_status_t status, int param,
     void *user_data);
 static osStatus_t sensor_raw_read_loop(uint8_t count, float *ch0_avg, float *ch1_avg);
+static osStatus_t sensor_read_target_attempt(sensor_light_t light_source, uint8_t light_value, bool check_detect,
+    float *ch0_result, float *ch1_result, float *ch0_uncertainty, uint8_t *quality,
+    sensor_read_callback_t callback, void *user_data);
 static uint8_t sensor_get_read_brightness(sensor_light_t light_source);
 
+/* Diagnostic temperature override, NaN when not in use */
+static volatile float sensor_temperature_override = NAN;
+
 osStatus_t sensor_gain_calibration(sensor_gain_calibration_callback_t callback, void *user_data)
+{
+    return sensor_gain_calibration_run(false, callback, user_data);
+}
+
+osStatus_t sensor_gain_calibration_resume(sensor_gain_calibration_callback_t callback, void *user_data)
+{
+    return sensor_gain_calibration_run(true, callback, user_data);
+}
+
+osStatus_t sensor_gain_calibration_run(bool resume, sensor_gain_calibration_callback_t callback, void *user_data)
 {
     /*
      * The sensor gain calibration process currently uses hand-picked
@@ -59,22 +103,41 @@ osStatus_t sensor_gain_calibration(sensor_gain_calibration_callback_t callback,
      * Eventually, some mechanism for auto-ranging on the ideal LED
      * brightness for each step should be implemented, but the current
      * approach is likely good enough for now.
+     *
+     * The results of each completed stage are saved as a checkpoint,
+     * so that an interrupted run can be resumed without repeating
+     * the stages that have already finished.
      */
 
     osStatus_t ret = osOK;
-    uint8_t measurement_led_brightness = 0;
-    uint8_t max_gain_led_brightness = 0;
-    settings_cal_light_t cal_light = {0};
-    float gain_med_ch0 = NAN;
-    float gain_med_ch1 = NAN;
-    float gain_high_ch0 = NAN;
-    float gain_high_ch1 = NAN;
-    float gain_max_ch0 = NAN;
-    float gain_max_ch1 = NAN;
-
-    settings_get_cal_light(&cal_light);
-
-    log_i("Starting gain calibration");
+    settings_cal_gain_checkpoint_t checkpoint;
+    sensor_gain_cal_context_t context = {
+        .callback = callback,
+        .user_data = user_data,
+        .ret = osOK
+    };
+    const gain_cal_policy_ops_t ops = {
+        .resume = sensor_gain_cal_resume,
+        .cooldown = sensor_gain_cal_cooldown,
+        .find_brightness = sensor_gain_cal_find_brightness,
+        .read_brightness = sensor_gain_cal_read_brightness,
+        .measure_gain = sensor_gain_cal_measure_gain,
+        .save_checkpoint = sensor_gain_cal_save_checkpoint,
+        .clear_checkpoint = sensor_gain_cal_clear_checkpoint,
+        .user_data = &context
+    };
+
+    if (resume) {
+        if (!settings_get_cal_gain_checkpoint(&checkpoint)) {
+            log_w("No gain calibration checkpoint to resume");
+            return osErrorResource;
+        }
+        log_i("Resuming gain calibration from stage %d", checkpoint.stage);
+    } else {
+        settings_clear_cal_gain_checkpoint();
+        settings_get_cal_gain_checkpoint(&checkpoint);
+        log_i("Starting gain calibration");
+    }
 
     if (!gain_status_callback(callback, SENSOR_GAIN_CALIBRATION_STATUS_INIT, 0, user_data)) { return osError; }
 
@@ -91,105 +154,8 @@ osStatus_t sensor_gain_calibration(sensor_gain_calibration_callback_t callback,
         /* Wait for things to stabilize */
         osDelay(1000);
 
-        /* Find the ideal measurement brightness, which should not saturate at high gain */
-        ret = sensor_find_gain_brightness(&measurement_led_brightness,
-            TSL2591_GAIN_HIGH, TSL2591_TIME_200MS,
-            128, 64, LIGHT_CAL_CH0_TARGET_FACTOR,
-            callback, user_data);
-        if (ret != osOK || measurement_led_brightness == 0) { break; }
-
-        /* Wait for LED cool down */
-        if (!sensor_gain_calibration_cooldown(callback, user_data)) {
-            ret = osError;
-            break;
-        }
-
-        /* Calibrate the value for medium gain */
-        log_i("Medium gain calibration");
-        ret = sensor_gain_calibration_loop(
-            TSL2591_GAIN_LOW, TSL2591_GAIN_MEDIUM, TSL2591_TIME_600MS,
-            GAIN_CAL_BRIGHTNESS_LOW_MED, &gain_med_ch0, &gain_med_ch1,
-            SENSOR_GAIN_CALIBRATION_STATUS_MEDIUM, callback, user_data);
-        if (ret != osOK) { break; }
-
-        log_i("Medium gain: CH0=%dx, CH1=%dx", lroundf(gain_med_ch0), lroundf(gain_med_ch1));
-
-        if (gain_med_ch0 < TSL2591_GAIN_MEDIUM_MIN || gain_med_ch0 > TSL2591_GAIN_MEDIUM_MAX) {
-            log_w("Medium CH0 gain out of range!");
-            gain_med_ch0 = TSL2591_GAIN_MEDIUM_TYP;
-        }
-        if (gain_med_ch1 < TSL2591_GAIN_MEDIUM_MIN || gain_med_ch1 > TSL2591_GAIN_MEDIUM_MAX) {
-            log_w("Medium CH1 gain out of range!");
-            gain_med_ch1 = TSL2591_GAIN_MEDIUM_TYP;
-        }
-
-        /* Wait for LED cool down */
-        if (!sensor_gain_calibration_cooldown(callback, user_data)) {
-            ret = osError;
-            break;
-        }
-
-        /* Calibrate the value for high gain, using the calibrated measurement brightness */
-        log_i("High gain calibration");
-        ret = sensor_gain_calibration_loop(
-            TSL2591_GAIN_MEDIUM, TSL2591_GAIN_HIGH, TSL2591_TIME_200MS,
-            measurement_led_brightness, &gain_high_ch0, &gain_high_ch1,
-            SENSOR_GAIN_CALIBRATION_STATUS_HIGH, callback, user_data);
-        if (ret != osOK) { break; }
-
-        gain_high_ch0 *= gain_med_ch0;
-        gain_high_ch1 *= gain_med_ch1;
-
-        log_i("High gain: CH0=%dx, CH1=%dx", lroundf(gain_high_ch0), lroundf(gain_high_ch1));
-
-        if (gain_high_ch0 < TSL2591_GAIN_HIGH_MIN || gain_high_ch0 > TSL2591_GAIN_HIGH_MAX) {
-            log_w("High CH0 gain out of range!");
-            gain_high_ch0 = TSL2591_GAIN_HIGH_TYP;
-        }
-        if (gain_high_ch1 < TSL2591_GAIN_HIGH_MIN || gain_high_ch1 > TSL2591_GAIN_HIGH_MAX) {
-            log_w("High CH1 gain out of range!");
-            gain_high_ch1 = TSL2591_GAIN_HIGH_TYP;
-        }
-
-        /* Wait for LED cool down */
-        if (!sensor_gain_calibration_cooldown(callback, user_data)) {
-            ret = osError;
-            break;
-        }
-
-        /* Find the ideal brightness for testing maximum gain */
-        ret = sensor_find_gain_brightness(&max_gain_led_brightness,
-            TSL2591_GAIN_MAXIMUM, TSL2591_TIME_200MS,
-            4, 16, GAIN_CAL_CH0_TARGET_FACTOR,
-            callback, user_data);
-        if (ret != osOK || max_gain_led_brightness == 0) { break; }
-
-        /* Wait for LED cool down */
-        if (!sensor_gain_calibration_cooldown(callback, user_data)) {
-            ret = osError;
-            break;
-        }
-
-        /* Calibrate the value for maximum gain */
-        log_i("Maximum gain calibration");
-        ret = sensor_gain_calibration_loop(
-            TSL2591_GAIN_HIGH, TSL2591_GAIN_MAXIMUM, TSL2591_TIME_200MS,
-            max_gain_led_brightness, &gain_max_ch0, &gain_max_ch1,
-            SENSOR_GAIN_CALIBRATION_STATUS_MAXIMUM, callback, user_data);
-        if (ret != osOK) { break; }
-
-        gain_max_ch0 *= gain_high_ch0;
-        gain_max_ch1 *= gain_high_ch1;
-
-        log_i("Maximum gain: CH0=%dx, CH1=%dx", lroundf(gain_max_ch0), lroundf(gain_max_ch1));
-
-        if (gain_max_ch0 < TSL2591_GAIN_MAXIMUM_CH0_MIN || gain_max_ch0 > TSL2591_GAIN_MAXIMUM_CH0_MAX) {
-            log_w("Maximum CH0 gain out of range!");
-            gain_max_ch0 = TSL2591_GAIN_MAXIMUM_CH0_TYP;
-        }
-        if (gain_max_ch1 < TSL2591_GAIN_MAXIMUM_CH1_MIN || gain_max_ch1 > TSL2591_GAIN_MAXIMUM_CH1_MAX) {
-            log_w("Maximum CH1 gain out of range!");
-            gain_max_ch1 = TSL2591_GAIN_MAXIMUM_CH1_TYP;
+        if (!gain_cal_policy_run(&ops, &checkpoint)) {
+            ret = (context.ret != osOK) ? context.ret : osError;
         }
     } while (0);
 
@@ -208,31 +174,41 @@ osStatus_t sensor_gain_calibration(sensor_gain_calibration_callback_t callback,
     if (ret == osOK) {
         log_i("Gain calibration complete");
 
-        log_d("Measurement light -> %d / 128", measurement_led_brightness);
+        log_d("Measurement light -> %d / 128", checkpoint.measurement_brightness);
         log_d("Low -> 1.000000 1.000000");
-        log_d("Med -> %f %f", gain_med_ch0, gain_med_ch1);
-        log_d("High -> %f %f", gain_high_ch0, gain_high_ch1);
-        log_d("Max -> %f %f", gain_max_ch0, gain_max_ch1);
+        log_d("Med -> %f %f", checkpoint.ch0_medium, checkpoint.ch1_medium);
+        log_d("High -> %f %f", checkpoint.ch0_high, checkpoint.ch1_high);
+        log_d("Max -> %f %f", checkpoint.ch0_maximum, checkpoint.ch1_maximum);
+
+        /* Both results are saved as one audited change */
+        settings_audit_begin();
 
         settings_cal_light_t cal_light = {0};
         cal_light.reflection = 128;
-        cal_light.transmission = measurement_led_brightness;
+        cal_light.transmission = checkpoint.measurement_brightness;
         if (settings_set_cal_light(&cal_light)) {
             log_i("Measurement light calibration saved");
         }
 
         settings_cal_gain_t cal_gain = {0};
-        cal_gain.ch0_medium = gain_med_ch0;
-        cal_gain.ch1_medium = gain_med_ch1;
-        cal_gain.ch0_high = gain_high_ch0;
-        cal_gain.ch1_high = gain_high_ch1;
-        cal_gain.ch0_maximum = gain_max_ch0;
-        cal_gain.ch1_maximum = gain_max_ch1;
-        if (settings_set_cal_gain(&cal_gain)) {
+        cal_gain.ch0_medium = checkpoint.ch0_medium;
+        cal_gain.ch1_medium = checkpoint.ch1_medium;
+        cal_gain.ch0_high = checkpoint.ch0_high;
+        cal_gain.ch1_high = checkpoint.ch1_high;
+        cal_gain.ch0_maximum = checkpoint.ch0_maximum;
+        cal_gain.ch1_maximum = checkpoint.ch1_maximum;
+        bool gain_saved = settings_set_cal_gain(&cal_gain);
+        settings_audit_end();
+
+        if (gain_saved) {
             log_i("Gain calibration saved");
+            sensor_record_cal_temperature(SENSOR_CAL_TEMP_GAIN);
         }
+
+        /* The run is complete, so there is nothing left to resume */
+        settings_clear_cal_gain_checkpoint();
     } else {
-        log_e("Gain calibration failed");
+        log_e("Gain calibration failed at stage %d", checkpoint.stage);
     }
 
     return ret;
@@ -372,17 +348,15 @@ osStatus_t sensor_light_calibration(sensor_light_t light_source, sensor_light_ca
 #endif
 
 osStatus_t sensor_read_target(sensor_light_t light_source,
-    float *ch0_result, float *ch1_result,
+    float *ch0_result, float *ch1_result, float *ch0_uncertainty, uint8_t *quality,
     sensor_read_callback_t callback, void *user_data)
 {
     osStatus_t ret = osOK;
     uint8_t light_value = 0;
-    sensor_reading_t reading;
-    tsl2591_gain_t target_read_gain;
-    float ch0_sum = 0;
-    float ch1_sum = 0;
     float ch0_avg = NAN;
     float ch1_avg = NAN;
+    float ch0_unc = NAN;
+    uint8_t read_quality = SENSOR_QUALITY_OK;
 
     if (light_source != SENSOR_LIGHT_REFLECTION && light_source != SENSOR_LIGHT_TRANSMISSION) {
         return osErrorParameter;
@@ -390,8 +364,57 @@ osStatus_t sensor_read_target(sensor_light_t light_source,
 
     light_value = sensor_get_read_brightness(light_source);
 
+    /*
+     * Only check the detect switch if it starts out closed, so that
+     * measurements started without it, such as over USB, still work.
+     * This is sampled once, so that a retry started after the switch
+     * has opened is still flagged.
+     */
+    bool check_detect = keypad_is_detect();
+
     log_i("Starting sensor target read (light=%d)", light_value);
 
+    for (uint8_t attempt = 0; ; attempt++) {
+        ret = sensor_read_target_attempt(light_source, light_value, check_detect,
+            &ch0_avg, &ch1_avg, &ch0_unc, &read_quality,
+            callback, user_data);
+
+        /* Turn off the sensor */
+        sensor_stop();
+        sensor_set_light_mode(SENSOR_LIGHT_OFF, false, 0);
+
+        if (ret != osOK || !quality_policy_should_retry(attempt, read_quality)) { break; }
+
+        log_w("Retrying sensor target read (quality=0x%02X)", read_quality);
+    }
+
+    if (ret == osOK) {
+        if (read_quality == SENSOR_QUALITY_OK) {
+            log_i("Sensor read complete");
+        } else {
+            log_w("Sensor read complete with quality=0x%02X", read_quality);
+        }
+        if (ch0_result) { *ch0_result = ch0_avg; }
+        if (ch1_result) { *ch1_result = ch1_avg; }
+        if (ch0_uncertainty) { *ch0_uncertainty = ch0_unc; }
+        if (quality) { *quality = read_quality; }
+    } else {
+        log_e("Sensor read failed: ret=%d", ret);
+    }
+    return ret;
+}
+
+osStatus_t sensor_read_target_attempt(sensor_light_t light_source, uint8_t light_value, bool check_detect,
+    float *ch0_result, float *ch1_result, float *ch0_uncertainty, uint8_t *quality,
+    sensor_read_callback_t callback, void *user_data)
+{
+    osStatus_t ret = osOK;
+    sensor_reading_t reading;
+    tsl2591_gain_t target_read_gain;
+    quality_policy_t policy;
+
+    quality_policy_init(&policy, check_detect);
+
     do {
         /* Put the sensor and light into a known initial state, with maximum gain */
         ret = sensor_set_config(TSL2591_GAIN_MAXIMUM, TSL2591_TIME_100MS);
@@ -434,9 +457,6 @@ osStatus_t sensor_read_target(sensor_light_t light_source,
 
         /* Take the actual target measurement readings */
         for (int i = 0; i < SENSOR_TARGET_READ_ITERATIONS; i++) {
-            float ch0_basic = 0;
-            float ch1_basic = 0;
-
             ret = sensor_get_next_reading(&reading, 500);
             if (ret != osOK) { break; }
             log_v("TSL2591[%d]: CH0=%d, CH1=%d", reading.reading_count, reading.ch0_val, reading.ch1_val);
@@ -451,37 +471,35 @@ osStatus_t sensor_read_target(sensor_light_t light_source,
                 break;
             }
 
-            /* Make sure we didn't unexpectedly saturate */
-            if (sensor_is_reading_saturated(&reading)) {
-                log_e("Unexpected sensor saturation");
-                ret = osError;
-                break;
+            /* Flag any reading that cannot be trusted, but keep going so the attempt can complete */
+            quality_reading_t quality_reading = {
+                .ch0_val = reading.ch0_val,
+                .ch1_val = reading.ch1_val,
+                .time = reading.time,
+                .status = reading.status,
+                .detect = check_detect ? keypad_is_detect() : true
+            };
+            sensor_convert_to_basic_counts(&reading, &quality_reading.ch0_basic, &quality_reading.ch1_basic);
+
+            uint8_t reading_quality = quality_policy_add_reading(&policy, &quality_reading);
+            if (reading_quality & SENSOR_QUALITY_SATURATED) {
+                log_w("Unexpected sensor saturation");
+            }
+            if (reading_quality & SENSOR_QUALITY_INVALID) {
+                log_w("Sensor reading not valid: status=0x%02X", reading.status);
+            }
+            if (reading_quality & SENSOR_QUALITY_LID_OPEN) {
+                log_w("Detect switch opened during read");
             }
-
-            sensor_convert_to_basic_counts(&reading, &ch0_basic, &ch1_basic);
-            ch0_sum += ch0_basic;
-            ch1_sum += ch1_basic;
         }
         if (ret != osOK) { break; }
 
-        ch0_avg = (ch0_sum / (float)SENSOR_TARGET_READ_ITERATIONS);
-        ch1_avg = (ch1_sum / (float)SENSOR_TARGET_READ_ITERATIONS);
+        *quality = quality_policy_finish(&policy, ch0_result, ch1_result, ch0_uncertainty);
+        if (*quality & SENSOR_QUALITY_UNSTABLE) {
+            log_w("Inconsistent sensor readings");
+        }
     } while (0);
 
-    /* Turn off the sensor */
-    sensor_stop();
-    sensor_set_light_mode(SENSOR_LIGHT_OFF, false, 0);
-
-    if (ret == osOK) {
-        log_i("Sensor read complete");
-        if (ch0_result) { *ch0_result = ch0_avg; }
-        if (ch1_result) { *ch1_result = ch1_avg; }
-    } else {
-        log_e("Sensor read failed: ret=%d", ret);
-        if (ret == osOK) {
-            ret = osError;
-        }
-    }
     return ret;
 }
 
@@ -761,6 +779,9 @@ bool gain_status_callback(
     sensor_gain_calibration_status_t status, int param,
     void *user_data)
 {
+    /* Calibration steps can wait a while without taking any readings */
+    task_watchdog_checkin();
+
     if (callback) {
         return callback(status, param, user_data);
     } else {
@@ -775,13 +796,14 @@ bool gain_status_callback(
  * the bottom of the brightness range without coming too close to saturation.
  *
  * @param led_brightness Brightness to use for further measurements
+ * @param ch0_reading CH0 reading at the selected brightness
  * @param gain Gain setting for measurements
  * @param time Integration time for measurements
  * @param start_brightness Starting brightness value, inclusive
  * @param end_brightness Ending brightness value, inclusive
  * @param target_factor Multiplier to determine how close to saturation is allowed
  */
-static osStatus_t sensor_find_gain_brightness(uint8_t *led_brightness,
+static osStatus_t sensor_find_gain_brightness(uint8_t *led_brightness, float *ch0_reading,
     tsl2591_gain_t gain, tsl2591_time_t time,
     uint8_t start_brightness, uint8_t end_brightness,
     float target_factor,
@@ -893,29 +915,160 @@ static osStatus_t sensor_find_gain_brightness(uint8_t *led_brightness,
         if (led_brightness) {
             *led_brightness = closest_led;
         }
+        if (ch0_reading) {
+            *ch0_reading = closest_ch0;
+        }
         log_d("Selected brightness: %d (%f)", closest_led, closest_ch0);
     }
 
     return ret;
 }
 
-bool sensor_is_reading_saturated(const sensor_reading_t *reading)
+/**
+ * Read a previously selected LED brightness, so it can be checked against
+ * the reading recorded when it was originally found.
+ *
+ * @param ch0_reading Average CH0 reading, or NaN if saturated
+ * @param led_brightness Brightness to read
+ * @param gain Gain setting for measurements
+ * @param time Integration time for measurements
+ */
+static osStatus_t sensor_read_gain_brightness(float *ch0_reading, uint8_t led_brightness,
+    tsl2591_gain_t gain, tsl2591_time_t time)
 {
-    if (!reading) {
+    osStatus_t ret = osOK;
+    sensor_reading_t discard_reading;
+
+    if (!ch0_reading || led_brightness == 0 || led_brightness > 128) {
+        return osErrorParameter;
+    }
+
+    log_d("Checking brightness: %d", led_brightness);
+
+    do {
+        /* Setup for sensor configuration */
+        ret = sensor_set_config(gain, time);
+        if (ret != osOK) { break; }
+
+        /* Wait for the first reading at the new settings to come through */
+        ret = sensor_get_next_reading(&discard_reading, 2000);
+        if (ret != osOK) { break; }
+
+        /* Set the LED to target brightness on the next cycle */
+        sensor_set_light_mode(SENSOR_LIGHT_TRANSMISSION, /*next_cycle*/true, led_brightness);
+
+        /* Wait for the next cycle which will turn the LED on */
+        ret = sensor_get_next_reading(&discard_reading, 2000);
+        if (ret != osOK) { break; }
+
+        ret = sensor_raw_read_loop(SENSOR_GAIN_LED_CHECK_READ_ITERATIONS, ch0_reading, NULL);
+        if (ret != osOK) { break; }
+    } while (0);
+
+    /* Turn off the LED */
+    sensor_set_light_mode(SENSOR_LIGHT_OFF, false, 0);
+
+    return ret;
+}
+
+bool sensor_gain_cal_resume(settings_gain_cal_stage_t stage, void *user_data)
+{
+    sensor_gain_cal_context_t *context = user_data;
+    if (!gain_status_callback(context->callback, SENSOR_GAIN_CALIBRATION_STATUS_RESUME, stage, context->user_data)) {
+        context->ret = osError;
+        return false;
+    }
+    return true;
+}
+
+bool sensor_gain_cal_cooldown(void *user_data)
+{
+    sensor_gain_cal_context_t *context = user_data;
+    if (!sensor_gain_calibration_cooldown(context->callback, context->user_data)) {
+        context->ret = osError;
         return false;
     }
+    return true;
+}
 
-    uint16_t limit;
-    if (reading->time == TSL2591_TIME_100MS) {
-        limit = TSL2591_ANALOG_SATURATION;
+bool sensor_gain_cal_find_brightness(settings_gain_cal_stage_t stage,
+    uint8_t *brightness, float *ch0_reading, void *user_data)
+{
+    sensor_gain_cal_context_t *context = user_data;
+    if (stage == SETTING_GAIN_CAL_STAGE_LED) {
+        context->ret = sensor_find_gain_brightness(brightness, ch0_reading,
+            TSL2591_GAIN_HIGH, TSL2591_TIME_200MS,
+            128, 64, LIGHT_CAL_CH0_TARGET_FACTOR,
+            context->callback, context->user_data);
+    } else if (stage == SETTING_GAIN_CAL_STAGE_MAX_LED) {
+        context->ret = sensor_find_gain_brightness(brightness, ch0_reading,
+            TSL2591_GAIN_MAXIMUM, TSL2591_TIME_200MS,
+            4, 16, GAIN_CAL_CH0_TARGET_FACTOR,
+            context->callback, context->user_data);
     } else {
-        limit = TSL2591_DIGITAL_SATURATION;
+        context->ret = osErrorParameter;
     }
-    if (reading->ch0_val >= limit || reading->ch1_val >= limit) {
-        return true;
+    return context->ret == osOK;
+}
+
+bool sensor_gain_cal_read_brightness(settings_gain_cal_stage_t stage,
+    uint8_t brightness, float *ch0_reading, void *user_data)
+{
+    sensor_gain_cal_context_t *context = user_data;
+    if (stage == SETTING_GAIN_CAL_STAGE_LED) {
+        context->ret = sensor_read_gain_brightness(ch0_reading, brightness, TSL2591_GAIN_HIGH, TSL2591_TIME_200MS);
+    } else if (stage == SETTING_GAIN_CAL_STAGE_MAX_LED) {
+        context->ret = sensor_read_gain_brightness(ch0_reading, brightness, TSL2591_GAIN_MAXIMUM, TSL2591_TIME_200MS);
+    } else {
+        context->ret = osErrorParameter;
+    }
+    return context->ret == osOK;
+}
+
+bool sensor_gain_cal_measure_gain(settings_gain_cal_stage_t stage, uint8_t brightness,
+    float *ch0_ratio, float *ch1_ratio, void *user_data)
+{
+    sensor_gain_cal_context_t *context = user_data;
+    if (stage == SETTING_GAIN_CAL_STAGE_MEDIUM) {
+        context->ret = sensor_gain_calibration_loop(
+            TSL2591_GAIN_LOW, TSL2591_GAIN_MEDIUM, TSL2591_TIME_600MS,
+            brightness, ch0_ratio, ch1_ratio,
+            SENSOR_GAIN_CALIBRATION_STATUS_MEDIUM, context->callback, context->user_data);
+    } else if (stage == SETTING_GAIN_CAL_STAGE_HIGH) {
+        context->ret = sensor_gain_calibration_loop(
+            TSL2591_GAIN_MEDIUM, TSL2591_GAIN_HIGH, TSL2591_TIME_200MS,
+            brightness, ch0_ratio, ch1_ratio,
+            SENSOR_GAIN_CALIBRATION_STATUS_HIGH, context->callback, context->user_data);
+    } else if (stage == SETTING_GAIN_CAL_STAGE_MAX) {
+        context->ret = sensor_gain_calibration_loop(
+            TSL2591_GAIN_HIGH, TSL2591_GAIN_MAXIMUM, TSL2591_TIME_200MS,
+            brightness, ch0_ratio, ch1_ratio,
+            SENSOR_GAIN_CALIBRATION_STATUS_MAXIMUM, context->callback, context->user_data);
     } else {
+        context->ret = osErrorParameter;
+    }
+    return context->ret == osOK;
+}
+
+void sensor_gain_cal_save_checkpoint(const settings_cal_gain_checkpoint_t *checkpoint, void *user_data)
+{
+    UNUSED(user_data);
+    settings_set_cal_gain_checkpoint(checkpoint);
+}
+
+void sensor_gain_cal_clear_checkpoint(settings_cal_gain_checkpoint_t *checkpoint, void *user_data)
+{
+    UNUSED(user_data);
+    settings_clear_cal_gain_checkpoint();
+    settings_get_cal_gain_checkpoint(checkpoint);
+}
+
+bool sensor_is_reading_saturated(const sensor_reading_t *reading)
+{
+    if (!reading) {
         return false;
     }
+    return quality_policy_is_saturated(reading->ch0_val, reading->ch1_val, reading->time);
 }
 
 void sensor_convert_to_basic_counts(const sensor_reading_t *reading, float *ch0_basic, float *ch1_basic)
@@ -994,3 +1147,124 @@ uint8_t sensor_get_read_brightness(sensor_light_t light_source)
         return 128;
     }
 }
+
+float sensor_apply_slope_calibration_uncertainty(float basic_reading, float basic_uncertainty)
+{
+    settings_cal_slope_t cal_slope;
+
+    bool valid = settings_get_cal_slope(&cal_slope);
+
+    if (isnanf(basic_reading) || isinff(basic_reading) || basic_reading <= 0.0F) {
+        return NAN;
+    }
+
+    if (!valid) {
+        return basic_uncertainty;
+    }
+
+    /*
+     * The correction is a quadratic in log space, so its derivative is:
+     * d(corr)/d(reading) = (corr / reading) * (b1 + 2 * b2 * log10(reading))
+     */
+    float l_reading = log10f(basic_reading);
+    float l_expected = cal_slope.b0 + (cal_slope.b1 * l_reading) + (cal_slope.b2 * powf(l_reading, 2.0F));
+    float corr_reading = powf(10.0F, l_expected);
+    float sensitivity = (corr_reading / basic_reading) * (cal_slope.b1 + (2.0F * cal_slope.b2 * l_reading));
+
+    return fabsf(sensitivity) * basic_uncertainty;
+}
+
+float sensor_read_temperature()
+{
+    float override = sensor_temperature_override;
+    if (!isnanf(override)) {
+        return override;
+    }
+
+    adc_readings_t readings;
+    if (adc_read(&readings) != osOK) {
+        log_w("Unable to read temperature");
+        return NAN;
+    }
+    return readings.temp_c;
+}
+
+void sensor_set_temperature_override(float temp_c)
+{
+    if (isnanf(temp_c)) {
+        log_i("Temperature override cleared");
+    } else {
+        log_i("Temperature override set to %.1fC", temp_c);
+    }
+    sensor_temperature_override = temp_c;
+}
+
+float sensor_get_temperature_override()
+{
+    return sensor_temperature_override;
+}
+
+bool sensor_record_cal_temperature(sensor_cal_temp_t cal_temp)
+{
+    settings_cal_temperature_t cal_temperature;
+    settings_get_cal_temperature(&cal_temperature);
+
+    float temp_c = sensor_read_temperature();
+
+    switch (cal_temp) {
+    case SENSOR_CAL_TEMP_GAIN:
+        cal_temperature.gain_temp = temp_c;
+        break;
+    case SENSOR_CAL_TEMP_SLOPE:
+        cal_temperature.slope_temp = temp_c;
+        break;
+    case SENSOR_CAL_TEMP_REFLECTION:
+        cal_temperature.reflection_temp = temp_c;
+        break;
+    case SENSOR_CAL_TEMP_TRANSMISSION:
+        cal_temperature.transmission_temp = temp_c;
+        break;
+    default:
+        return false;
+    }
+
+    if (!settings_validate_cal_temperature(&cal_temperature)) {
+        log_w("Calibration temperature out of range: %.1fC", temp_c);
+        return false;
+    }
+
+    log_d("Recorded calibration temperature: %d -> %.1fC", cal_temp, temp_c);
+    return settings_set_cal_temperature(&cal_temperature);
+}
+
+static float sensor_temperature_response(const settings_cal_temperature_t *cal_temperature, float temp_c)
+{
+    float delta = temp_c - TEMP_COMP_REFERENCE_C;
+    return 1.0F + (cal_temperature->coef_a * delta) + (cal_temperature->coef_b * delta * delta);
+}
+
+float sensor_apply_temperature_compensation(float corr_reading, float temp_c, float ref_temp_c)
+{
+    settings_cal_temperature_t cal_temperature;
+
+    if (!settings_get_cal_temperature(&cal_temperature)) {
+        return corr_reading;
+    }
+
+    if (cal_temperature.coef_a == 0.0F && cal_temperature.coef_b == 0.0F) {
+        return corr_reading;
+    }
+
+    if (!is_valid_number(corr_reading) || !is_valid_number(temp_c) || !is_valid_number(ref_temp_c)) {
+        return corr_reading;
+    }
+
+    float response = sensor_temperature_response(&cal_temperature, temp_c);
+    float ref_response = sensor_temperature_response(&cal_temperature, ref_temp_c);
+    if (response <= 0.0F || ref_response <= 0.0F) {
+        log_w("Temperature response out of range: %f, %f", response, ref_response);
+        return corr_reading;
+    }
+
+    return corr_reading * (ref_response / response);
+}
@@ -10,6 +10,7 @@
 
 #include "stm32l0xx_hal.h"
 #include "tsl2591.h"
+#include "quality_policy.h"
 
 /**
  * Sensor read light selection.
@@ -28,9 +29,20 @@ typedef enum {
     SENSOR_GAIN_CALIBRATION_STATUS_FAILED,
     SENSOR_GAIN_CALIBRATION_STATUS_LED,
     SENSOR_GAIN_CALIBRATION_STATUS_COOLDOWN,
-    SENSOR_GAIN_CALIBRATION_STATUS_DONE
+    SENSOR_GAIN_CALIBRATION_STATUS_DONE,
+    SENSOR_GAIN_CALIBRATION_STATUS_RESUME
 } sensor_gain_calibration_status_t;
 
+/**
+ * Calibration steps with a recorded die temperature.
+ */
+typedef enum {
+    SENSOR_CAL_TEMP_GAIN = 0,
+    SENSOR_CAL_TEMP_SLOPE,
+    SENSOR_CAL_TEMP_REFLECTION,
+    SENSOR_CAL_TEMP_TRANSMISSION
+} sensor_cal_temp_t;
+
 /**
  * Sensor reading data structure.
  */
@@ -42,6 +54,7 @@ typedef struct {
     uint32_t reading_ticks; /*!< Tick time when the integration cycle finished */
     uint32_t light_ticks;   /*!< Tick time when the light state last changed */
     uint32_t reading_count; /*!< Number of integration cycles since the sensor was enabled */
+    uint8_t status;         /*!< Sensor status register at the end of the integration cycle */
 } sensor_reading_t;
 
 typedef bool (*sensor_gain_calibration_callback_t)(sensor_gain_calibration_status_t status, int param, void *user_data);
@@ -56,11 +69,28 @@ typedef void (*sensor_read_callback_t)(void *user_data);
  * gain values that correspond to each gain setting on the sensor.
  * The results will be saved for use in future sensor data calculations.
  *
+ * A checkpoint is saved after each completed stage of the process,
+ * and any previously saved checkpoint is discarded when this function
+ * is called.
+ *
  * @param callback Callback to monitor progress of the calibration
  * @return osOK on success
  */
 osStatus_t sensor_gain_calibration(sensor_gain_calibration_callback_t callback, void *user_data);
 
+/**
+ * Resume an interrupted sensor gain calibration process.
+ *
+ * This function will re-validate the LED brightness values recorded in the
+ * saved checkpoint, then continue the calibration process from the last
+ * completed stage. If the measurement brightness no longer produces the
+ * expected reading, the process will start over from the beginning.
+ *
+ * @param callback Callback to monitor progress of the calibration
+ * @return osOK on success, osErrorResource if there is no checkpoint
+ */
+osStatus_t sensor_gain_calibration_resume(sensor_gain_calibration_callback_t callback, void *user_data);
+
 #ifdef TEST_LIGHT_CAL
 /**
  * Run the sensor light source calibration process.
@@ -83,13 +113,26 @@ osStatus_t sensor_light_calibration(sensor_light_t light_source, sensor_light_ca
  * using automatic gain adjustment to arrive at a result in basic counts
  * from which target density can be calculated.
  *
+ * The standard uncertainty of the Channel 0 result combines the counting
+ * statistics of each raw reading with the spread between the repeated
+ * readings, and is expressed in basic counts.
+ *
+ * The readings are checked for consistency, saturation, a valid
+ * integration cycle, and the detect switch staying closed if it was
+ * closed at the start. A measurement that fails any of these checks
+ * is retried a limited number of times, after which the result of
+ * the last attempt is returned with the failed checks in its quality
+ * flags.
+ *
  * @param light_source Light source to use for target measurement
  * @param ch0_result Channel 0 result, in basic counts
  * @param ch1_result Channel 1 result, in basic counts
+ * @param ch0_uncertainty Channel 0 standard uncertainty, in basic counts
+ * @param quality Quality flags of the result, as SENSOR_QUALITY_* values
  * @return osOK on success
  */
 osStatus_t sensor_read_target(sensor_light_t light_source,
-    float *ch0_result, float *ch1_result,
+    float *ch0_result, float *ch1_result, float *ch0_uncertainty, uint8_t *quality,
     sensor_read_callback_t callback, void *user_data);
 
 /**
@@ -151,4 +194,76 @@ void sensor_convert_to_basic_counts(const sensor_reading_t *reading, float *ch0_
  */
 float sensor_apply_slope_calibration(float basic_reading);
 
+/**
+ * Propagate the uncertainty of a sensor reading through the configured
+ * slope correction formula.
+ *
+ * If the slope correction values are not correctly configured, then
+ * the input uncertainty will be returned unmodified, matching the
+ * behavior of the correction itself.
+ *
+ * @param basic_reading Sensor reading in combined basic counts
+ * @param basic_uncertainty Standard uncertainty of the reading, in basic counts
+ * @return Standard uncertainty of the slope corrected sensor reading
+ */
+float sensor_apply_slope_calibration_uncertainty(float basic_reading, float basic_uncertainty);
+
+/**
+ * Read the current die temperature of the microcontroller.
+ *
+ * This is used as a proxy for the temperature of the sensor, as both
+ * are on the same board and warm up together. If a temperature override
+ * has been set, then that value will be returned instead.
+ *
+ * @return Temperature in degrees Celsius, or NaN on error
+ */
+float sensor_read_temperature();
+
+/**
+ * Override the die temperature used for measurement compensation.
+ *
+ * This is a diagnostic feature that allows the temperature correction
+ * to be verified without physically heating or cooling the device.
+ * The override is not persisted across a reset.
+ *
+ * @param temp_c Temperature in degrees Celsius, or NaN to clear the override
+ */
+void sensor_set_temperature_override(float temp_c);
+
+/**
+ * Get the current die temperature override.
+ *
+ * @return Temperature in degrees Celsius, or NaN if not set
+ */
+float sensor_get_temperature_override();
+
+/**
+ * Record the current die temperature alongside a calibration step.
+ *
+ * This should be called whenever the values for the associated
+ * calibration step are saved.
+ *
+ * @param cal_temp Calibration step to record the temperature for
+ * @return True if recorded, false on error
+ */
+bool sensor_record_cal_temperature(sensor_cal_temp_t cal_temp);
+
+/**
+ * Apply the configured temperature compensation to a corrected reading.
+ *
+ * The reading is scaled by the ratio of the modeled sensor response at
+ * the reference temperature to the response at the current temperature,
+ * so that it matches what would have been measured at the reference
+ * temperature.
+ *
+ * If either temperature is unavailable, or no coefficients have been
+ * configured, then the input will be returned unmodified.
+ *
+ * @param corr_reading Slope corrected sensor reading
+ * @param temp_c Die temperature at the time of the reading
+ * @param ref_temp_c Die temperature recorded at calibration time
+ * @return Temperature compensated sensor reading
+ */
+float sensor_apply_temperature_compensation(float corr_reading, float temp_c, float ref_temp_c);
+
 #endif /* SENSOR_H */
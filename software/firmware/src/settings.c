@@ -6,8 +6,12 @@
 #include <string.h>
 #include <math.h>
 #include <elog.h>
+#include <cmsis_os.h>
 
 #include "util.h"
+#include "hid_template.h"
+#include "cal_profile.h"
+#include "ui_strings_data.h"
 
 extern CRC_HandleTypeDef hcrc;
 
@@ -20,14 +24,22 @@ static bool settings_init_cal_target(bool force_clear);
 static bool settings_clear_cal_target();
 static bool settings_init_user_settings(bool force_clear);
 static bool settings_clear_user_settings();
+static bool settings_init_user_templates(bool force_clear);
+static bool settings_clear_user_templates();
+static bool settings_init_cal_profiles(bool force_clear);
+static bool settings_clear_cal_profiles();
 
 
 static void settings_set_cal_light_defaults(settings_cal_light_t *cal_light);
 static bool settings_load_cal_light();
 static void settings_set_cal_gain_defaults(settings_cal_gain_t *cal_gain);
 static bool settings_load_cal_gain();
+static void settings_set_cal_gain_checkpoint_defaults(settings_cal_gain_checkpoint_t *checkpoint);
+static bool settings_load_cal_gain_checkpoint();
 static void settings_set_cal_slope_defaults(settings_cal_slope_t *cal_slope);
 static bool settings_load_cal_slope();
+static void settings_set_cal_temperature_defaults(settings_cal_temperature_t *cal_temperature);
+static bool settings_load_cal_temperature();
 static void settings_set_cal_reflection_defaults(settings_cal_reflection_t *cal_reflection);
 static bool settings_load_cal_reflection();
 static void settings_set_cal_transmission_defaults(settings_cal_transmission_t *cal_transmission);
@@ -38,10 +50,27 @@ static void settings_set_user_idle_light_defaults(settings_user_idle_light_t *id
 static bool settings_load_user_idle_light();
 static void settings_set_user_display_format_defaults(settings_user_display_format_t *display_format);
 static bool settings_load_user_display_format();
+static void settings_set_user_log_level_defaults(settings_user_log_level_t *log_level);
+static bool settings_load_user_log_level();
+static bool settings_load_user_log_level_v5();
+static bool settings_load_user_language();
+static bool settings_load_user_language_v6();
+static void settings_set_user_hid_template_defaults(settings_user_hid_template_t *hid_template);
+static bool settings_load_user_hid_template();
+
+static HAL_StatusTypeDef settings_write_unc_block(uint32_t address, const float *values, size_t count, uint32_t values_crc);
+static bool settings_read_unc_block(uint32_t address, float *values, size_t count, uint32_t values_crc);
+
+static bool settings_store_read(uint32_t address, uint8_t *data, size_t data_len);
+static bool settings_store_write(uint32_t address, const uint8_t *data, size_t data_len);
+static uint32_t settings_store_crc(const uint8_t *data, size_t word_count);
+static void settings_store_get_live_cal(settings_cal_profile_t *cal);
+static bool settings_store_set_live_cal(const settings_cal_profile_t *cal);
 
 static HAL_StatusTypeDef settings_read_buffer(uint32_t address, uint8_t *data, size_t data_len);
 static HAL_StatusTypeDef settings_write_buffer(uint32_t address, const uint8_t *data, size_t data_len);
 static HAL_StatusTypeDef settings_erase_page(uint32_t address, size_t len);
+static void settings_audit_record(uint32_t address, const uint8_t *data, size_t data_len);
 #if 0
 static float settings_read_float(uint32_t address);
 static HAL_StatusTypeDef settings_write_float(uint32_t address, float val);
@@ -60,6 +89,9 @@ static HAL_StatusTypeDef settings_write_uint32(uint32_t address, uint32_t val);
 #define HEADER_MAGIC       (PAGE_HEADER + 0U) /* "DENSITOMETER\0" */
 #define HEADER_START       (PAGE_HEADER + 16U)
 #define HEADER_VERSION     1UL
+#define HEADER_SCHEMA      (PAGE_HEADER + 20U)
+#define HEADER_AUDIT_COUNT (PAGE_HEADER + 24U) /* Number of settings writes */
+#define HEADER_AUDIT_HASH  (PAGE_HEADER + 28U) /* Hash chained across settings writes */
 
 /*
  * Sensor Calibration Data (128b)
@@ -70,7 +102,7 @@ static HAL_StatusTypeDef settings_write_uint32(uint32_t address, uint32_t val);
  */
 #define PAGE_CAL_SENSOR             (DATA_EEPROM_BASE + 0x0080UL)
 #define PAGE_CAL_SENSOR_SIZE        (128)
-#define PAGE_CAL_SENSOR_VERSION     1UL
+#define PAGE_CAL_SENSOR_VERSION     4UL
 
 #define CONFIG_CAL_GAIN             (PAGE_CAL_SENSOR + 4U)
 #define CONFIG_CAL_GAIN_SIZE        (28U)
@@ -81,6 +113,12 @@ static HAL_StatusTypeDef settings_write_uint32(uint32_t address, uint32_t val);
 #define CONFIG_CAL_LIGHT            (PAGE_CAL_SENSOR + 48U)
 #define CONFIG_CAL_LIGHT_SIZE       (12U)
 
+#define CONFIG_CAL_GAIN_CHECKPOINT      (PAGE_CAL_SENSOR + 60U)
+#define CONFIG_CAL_GAIN_CHECKPOINT_SIZE (40U)
+
+#define CONFIG_CAL_TEMPERATURE      (PAGE_CAL_SENSOR + 100U)
+#define CONFIG_CAL_TEMPERATURE_SIZE (28U)
+
 /*
  * Target Calibration Data (128b)
  * This page contains data specific to calibration against reference targets
@@ -98,13 +136,25 @@ static HAL_StatusTypeDef settings_write_uint32(uint32_t address, uint32_t val);
 #define CONFIG_CAL_TRANSMISSION            (PAGE_CAL_TARGET + 24U)
 #define CONFIG_CAL_TRANSMISSION_SIZE       (16U)
 
+/*
+ * The uncertainty of the calibration points was added after the values,
+ * so it is kept in separate blocks that older firmware ignores. Each
+ * block records the CRC of the values it was written with, and is
+ * ignored if the values have since been written without it.
+ */
+#define CONFIG_CAL_REFLECTION_UNC          (PAGE_CAL_TARGET + 40U)
+#define CONFIG_CAL_REFLECTION_UNC_SIZE     (16U)
+
+#define CONFIG_CAL_TRANSMISSION_UNC        (PAGE_CAL_TARGET + 56U)
+#define CONFIG_CAL_TRANSMISSION_UNC_SIZE   (12U)
+
 /*
  * User Settings (128b)
  * This page contains any user settings that the device may need to store.
  */
 #define PAGE_USER_SETTINGS         (DATA_EEPROM_BASE + 0x0180UL)
 #define PAGE_USER_SETTINGS_SIZE    (128)
-#define PAGE_USER_SETTINGS_VERSION 3UL
+#define PAGE_USER_SETTINGS_VERSION 7UL
 
 #define CONFIG_USER_USB_KEY        (PAGE_USER_SETTINGS + 4U)
 #define CONFIG_USER_USB_KEY_SIZE   (12U)
@@ -115,14 +165,107 @@ static HAL_StatusTypeDef settings_write_uint32(uint32_t address, uint32_t val);
 #define CONFIG_USER_DISPLAY_FORMAT      (PAGE_USER_SETTINGS + 28U)
 #define CONFIG_USER_DISPLAY_FORMAT_SIZE (8U)
 
+/*
+ * Log level filters, with the global level, then the tag names, then one
+ * byte for the level of each tag, then the CRC. Version 5 of the page
+ * stored these without a CRC, with each tag followed by its level as a
+ * word, in CONFIG_USER_LOG_LEVEL_V5_SIZE bytes.
+ */
+#define CONFIG_USER_LOG_LEVEL      (PAGE_USER_SETTINGS + 36U)
+#define CONFIG_USER_LOG_LEVEL_SIZE (76U)
+#define CONFIG_USER_LOG_LEVEL_V5_SIZE (84U)
+
+/*
+ * Display language, followed by its CRC. Versions 5 and 6 of the page
+ * stored the language without a CRC, in CONFIG_USER_LANGUAGE_V6_SIZE bytes.
+ */
+#define CONFIG_USER_LANGUAGE      (PAGE_USER_SETTINGS + 120U)
+#define CONFIG_USER_LANGUAGE_SIZE (8U)
+#define CONFIG_USER_LANGUAGE_V6_SIZE (4U)
+
+/*
+ * User Templates (128b)
+ * This page contains user settings that consist of larger blocks of text,
+ * which do not fit within the user settings page.
+ */
+#define PAGE_USER_TEMPLATES         (DATA_EEPROM_BASE + 0x0200UL)
+#define PAGE_USER_TEMPLATES_SIZE    (128)
+#define PAGE_USER_TEMPLATES_VERSION 1UL
+
+#define CONFIG_USER_HID_TEMPLATE      (PAGE_USER_TEMPLATES + 4U)
+#define CONFIG_USER_HID_TEMPLATE_SIZE (64U)
+
+/*
+ * Calibration Profiles (128b)
+ * This page records which of the calibration profile slots was last
+ * selected, along with the backup of the live calibration kept while
+ * a select is in progress. The slots themselves follow, one per page,
+ * with each slot holding a complete copy of the gain, slope and target
+ * calibration. The layout within these pages is defined in cal_profile.h.
+ */
+#define PAGE_CAL_PROFILES           (DATA_EEPROM_BASE + 0x0280UL)
+#define PAGE_CAL_PROFILES_SIZE      (128)
+#define PAGE_CAL_PROFILES_VERSION   1UL
+
+#define CONFIG_CAL_PROFILE_ACTIVE   (PAGE_CAL_PROFILES + CAL_PROFILE_PAGE_ACTIVE)
+
+#define PAGE_CAL_PROFILE_SLOTS      (DATA_EEPROM_BASE + 0x0300UL)
+#define PAGE_CAL_PROFILE_SLOT_SIZE  (CAL_PROFILE_SLOT_SIZE)
+#define CONFIG_CAL_PROFILE_SIZE     (CAL_PROFILE_RECORD_SIZE)
+#define CONFIG_CAL_PROFILE_UNC      (CAL_PROFILE_UNC)
+#define CONFIG_CAL_PROFILE_UNC_SIZE (CAL_PROFILE_UNC_SIZE)
+
+#ifndef __CDT_PARSER__
+_Static_assert(SETTING_HID_TEMPLATE_LEN == HID_TEMPLATE_SOURCE_LEN, "Saved template length does not match the template compiler limit");
+_Static_assert(SETTING_HID_TEMPLATE_LEN < CONFIG_USER_HID_TEMPLATE_SIZE - 4, "Saved template does not fit in its field");
+_Static_assert(68 + SETTING_LOG_LEVEL_TAG_COUNT <= CONFIG_USER_LOG_LEVEL_SIZE - 4, "Log level filters do not fit in their field");
+_Static_assert(4 + (SETTING_LOG_LEVEL_TAG_COUNT * SETTING_LOG_LEVEL_TAG_LEN) <= 68, "Log level tags overlap their levels");
+_Static_assert(CONFIG_USER_LOG_LEVEL + CONFIG_USER_LOG_LEVEL_V5_SIZE <= CONFIG_USER_LANGUAGE, "Log level filters overlap the language");
+_Static_assert(CONFIG_USER_LANGUAGE + CONFIG_USER_LANGUAGE_SIZE <= PAGE_USER_SETTINGS + PAGE_USER_SETTINGS_SIZE, "Language does not fit in its page");
+_Static_assert(SETTING_LANGUAGE_DEFAULT < UI_LANGUAGE_COUNT, "Default language is not in the string tables");
+_Static_assert(SETTING_CAL_PROFILE_NAME_LEN < 16, "Profile name does not fit in its field");
+_Static_assert(CONFIG_CAL_PROFILE_UNC + CONFIG_CAL_PROFILE_UNC_SIZE <= PAGE_CAL_PROFILE_SLOT_SIZE, "Profile does not fit in its page");
+_Static_assert(CAL_PROFILE_PAGE_BACKUP + CONFIG_CAL_PROFILE_UNC + CONFIG_CAL_PROFILE_UNC_SIZE <= PAGE_CAL_PROFILES_SIZE, "Profile backup does not fit in its page");
+#endif
+
 static settings_cal_light_t setting_cal_light = {0};
 static settings_cal_gain_t setting_cal_gain = {0};
+static settings_cal_gain_checkpoint_t setting_cal_gain_checkpoint = {0};
 static settings_cal_slope_t setting_cal_slope = {0};
+static settings_cal_temperature_t setting_cal_temperature = {0};
 static settings_cal_reflection_t setting_cal_reflection = {0};
 static settings_cal_transmission_t setting_cal_transmission = {0};
 static settings_user_usb_key_t setting_user_usb_key = {0};
 static settings_user_idle_light_t setting_user_idle_light = {0};
 static settings_user_display_format_t setting_user_display_format = {0};
+static settings_user_log_level_t setting_user_log_level = {0};
+static uint8_t setting_user_language = SETTING_LANGUAGE_DEFAULT;
+static settings_user_hid_template_t setting_user_hid_template = {0};
+static uint8_t setting_cal_profile_active = SETTING_CAL_PROFILE_NONE;
+static char setting_cal_profile_active_name[SETTING_CAL_PROFILE_NAME_LEN + 1] = {0};
+
+static const cal_profile_store_t settings_cal_profile_store = {
+    .page_address = PAGE_CAL_PROFILES,
+    .slots_address = PAGE_CAL_PROFILE_SLOTS,
+    .read = settings_store_read,
+    .write = settings_store_write,
+    .crc = settings_store_crc,
+    .get_live = settings_store_get_live_cal,
+    .set_live = settings_store_set_live_cal
+};
+
+/* Change audit state, which only tracks writes made after startup */
+static bool settings_audit_active = false;
+static uint32_t setting_audit_count = 0;
+static uint32_t setting_audit_hash = 0;
+static uint8_t setting_audit_depth = 0;
+static bool setting_audit_changed = false;
+
+/* Mutex used to keep profile changes from overlapping with measurements */
+static osMutexId_t settings_cal_mutex = NULL;
+static const osMutexAttr_t settings_cal_mutex_attrs = {
+    .name = "settings_cal_mutex"
+};
 
 HAL_StatusTypeDef settings_init()
 {
@@ -132,6 +275,14 @@ HAL_StatusTypeDef settings_init()
     do {
         log_i("Settings init");
 
+        /* Create the mutex used to switch calibration profiles */
+        if (!settings_cal_mutex) {
+            settings_cal_mutex = osMutexNew(&settings_cal_mutex_attrs);
+            if (!settings_cal_mutex) {
+                log_e("settings_cal_mutex create error");
+            }
+        }
+
         /* Certain EEPROM operations can take a long time */
         watchdog_slow();
 
@@ -145,6 +296,8 @@ HAL_StatusTypeDef settings_init()
         if (!settings_init_cal_sensor(!valid)) { break; }
         if (!settings_init_cal_target(!valid)) { break; }
         if (!settings_init_user_settings(!valid)) { break; }
+        if (!settings_init_user_templates(!valid)) { break; }
+        if (!settings_init_cal_profiles(!valid)) { break; }
 
         watchdog_refresh();
 
@@ -153,8 +306,18 @@ HAL_StatusTypeDef settings_init()
             ret = settings_write_header();
             if (ret != HAL_OK) { break; }
             watchdog_refresh();
+        } else if (settings_read_uint32(HEADER_SCHEMA) != SETTINGS_SCHEMA_VERSION) {
+            /* Record that all pages have been migrated to the current schema */
+            log_i("Updating settings schema to %d", SETTINGS_SCHEMA_VERSION);
+            ret = settings_write_uint32(HEADER_SCHEMA, SETTINGS_SCHEMA_VERSION);
+            if (ret != HAL_OK) { break; }
         }
 
+        /* Load the change audit state, which is zero on a fresh header */
+        setting_audit_count = settings_read_uint32(HEADER_AUDIT_COUNT);
+        setting_audit_hash = settings_read_uint32(HEADER_AUDIT_HASH);
+        settings_audit_active = true;
+
         log_i("Settings loaded");
 
     } while (0);
@@ -165,6 +328,88 @@ HAL_StatusTypeDef settings_init()
     return ret;
 }
 
+uint32_t settings_get_schema_version()
+{
+    return settings_read_uint32(HEADER_SCHEMA);
+}
+
+void settings_get_audit(uint32_t *count, uint32_t *hash)
+{
+    if (count) { *count = setting_audit_count; }
+    if (hash) { *hash = setting_audit_hash; }
+}
+
+uint8_t settings_check_integrity(uint32_t *failed)
+{
+    static const struct {
+        uint32_t address;
+        uint8_t size;
+    } records[] = {
+        { CONFIG_CAL_LIGHT, CONFIG_CAL_LIGHT_SIZE },
+        { CONFIG_CAL_GAIN, CONFIG_CAL_GAIN_SIZE },
+        { CONFIG_CAL_GAIN_CHECKPOINT, CONFIG_CAL_GAIN_CHECKPOINT_SIZE },
+        { CONFIG_CAL_SLOPE, CONFIG_CAL_SLOPE_SIZE },
+        { CONFIG_CAL_TEMPERATURE, CONFIG_CAL_TEMPERATURE_SIZE },
+        { CONFIG_CAL_REFLECTION, CONFIG_CAL_REFLECTION_SIZE },
+        { CONFIG_CAL_REFLECTION_UNC, CONFIG_CAL_REFLECTION_UNC_SIZE },
+        { CONFIG_CAL_TRANSMISSION, CONFIG_CAL_TRANSMISSION_SIZE },
+        { CONFIG_CAL_TRANSMISSION_UNC, CONFIG_CAL_TRANSMISSION_UNC_SIZE },
+        { CONFIG_USER_HID_TEMPLATE, CONFIG_USER_HID_TEMPLATE_SIZE }
+    };
+    const uint8_t record_count = sizeof(records) / sizeof(records[0]);
+    uint8_t buf[CONFIG_CAL_PROFILE_SIZE];
+    uint32_t result = 0;
+    uint8_t count = 0;
+    bool valid = false;
+
+    if (settings_read_header(&valid) != HAL_OK || !valid) {
+        result |= 0x01;
+    }
+    count++;
+
+    for (uint8_t i = 0; i < record_count + (SETTING_CAL_PROFILE_COUNT * 2); i++) {
+        uint32_t address;
+        size_t size;
+        if (i < record_count) {
+            address = records[i].address;
+            size = records[i].size;
+        } else if (i < record_count + SETTING_CAL_PROFILE_COUNT) {
+            address = PAGE_CAL_PROFILE_SLOTS + ((i - record_count) * PAGE_CAL_PROFILE_SLOT_SIZE);
+            size = CONFIG_CAL_PROFILE_SIZE;
+        } else {
+            address = PAGE_CAL_PROFILE_SLOTS + CONFIG_CAL_PROFILE_UNC
+                + ((i - record_count - SETTING_CAL_PROFILE_COUNT) * PAGE_CAL_PROFILE_SLOT_SIZE);
+            size = CONFIG_CAL_PROFILE_UNC_SIZE;
+        }
+        count++;
+
+        if (settings_read_buffer(address, buf, size) != HAL_OK) {
+            result |= (1UL << (count - 1));
+            continue;
+        }
+
+        /* Skip records that are still in their erased state */
+        bool blank = true;
+        for (size_t j = 0; j < size; j++) {
+            if (buf[j] != 0) {
+                blank = false;
+                break;
+            }
+        }
+        if (blank) { continue; }
+
+        uint32_t crc = copy_to_u32(&buf[size - 4]);
+        uint32_t calculated_crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, (size - 4) / 4);
+        if (crc != calculated_crc) {
+            log_w("Invalid CRC at %08X: %08X != %08X", address, crc, calculated_crc);
+            result |= (1UL << (count - 1));
+        }
+    }
+
+    if (failed) { *failed = result; }
+    return count;
+}
+
 HAL_StatusTypeDef settings_wipe()
 {
     HAL_StatusTypeDef ret = HAL_OK;
@@ -196,6 +441,21 @@ HAL_StatusTypeDef settings_wipe()
         ret = settings_erase_page(PAGE_USER_SETTINGS, PAGE_USER_SETTINGS_SIZE);
         watchdog_refresh();
         if (ret != HAL_OK) { break; }
+
+        ret = settings_erase_page(PAGE_USER_TEMPLATES, PAGE_USER_TEMPLATES_SIZE);
+        watchdog_refresh();
+        if (ret != HAL_OK) { break; }
+
+        ret = settings_erase_page(PAGE_CAL_PROFILES, PAGE_CAL_PROFILES_SIZE);
+        watchdog_refresh();
+        if (ret != HAL_OK) { break; }
+
+        for (uint8_t i = 0; i < SETTING_CAL_PROFILE_COUNT; i++) {
+            ret = settings_erase_page(PAGE_CAL_PROFILE_SLOTS + (i * PAGE_CAL_PROFILE_SLOT_SIZE), PAGE_CAL_PROFILE_SLOT_SIZE);
+            watchdog_refresh();
+            if (ret != HAL_OK) { break; }
+        }
+        if (ret != HAL_OK) { break; }
     } while (0);
 
     /* Return watchdog to normal window */
@@ -257,6 +517,7 @@ HAL_StatusTypeDef settings_write_header()
     memset(data, 0, sizeof(data));
     memcpy(data, "DENSITOMETER\0", 13);
     copy_from_u32(&data[HEADER_START - PAGE_HEADER], HEADER_VERSION);
+    copy_from_u32(&data[HEADER_SCHEMA - PAGE_HEADER], SETTINGS_SCHEMA_VERSION);
 
     /* Write the buffer */
     ret = settings_write_buffer(PAGE_HEADER, data, sizeof(data));
@@ -273,6 +534,8 @@ bool settings_init_cal_sensor(bool force_clear)
     settings_set_cal_light_defaults(&setting_cal_light);
     settings_set_cal_gain_defaults(&setting_cal_gain);
     settings_set_cal_slope_defaults(&setting_cal_slope);
+    settings_set_cal_gain_checkpoint_defaults(&setting_cal_gain_checkpoint);
+    settings_set_cal_temperature_defaults(&setting_cal_temperature);
 
     /* Load settings if the version matches */
     uint32_t version = force_clear ? 0 : settings_read_uint32(PAGE_CAL_SENSOR);
@@ -281,6 +544,39 @@ bool settings_init_cal_sensor(bool force_clear)
         settings_load_cal_light();
         settings_load_cal_gain();
         settings_load_cal_slope();
+        settings_load_cal_gain_checkpoint();
+        settings_load_cal_temperature();
+        result = true;
+    } else if (version >= 1 && version <= 3) {
+        log_i("Migrating sensor cal from %d->%d", version, PAGE_CAL_SENSOR_VERSION);
+        do {
+            /* Load unchanged settings */
+            settings_load_cal_light();
+            settings_load_cal_gain();
+            settings_load_cal_slope();
+
+            /*
+             * Older checkpoints do not record the readings needed to
+             * check them on resume, so they are discarded
+             */
+            if (!settings_clear_cal_gain_checkpoint()) {
+                break;
+            }
+
+            /* Set defaults for new settings */
+            if (version == 3) {
+                settings_load_cal_temperature();
+            } else {
+                settings_cal_temperature_t cal_temperature;
+                settings_set_cal_temperature_defaults(&cal_temperature);
+                if (!settings_set_cal_temperature(&cal_temperature)) {
+                    break;
+                }
+            }
+
+            /* Update the page version */
+            settings_write_uint32(PAGE_CAL_SENSOR, PAGE_CAL_SENSOR_VERSION);
+        } while (0);
         result = true;
     } else {
         /* Version is bad, initialize a blank page */
@@ -315,6 +611,18 @@ bool settings_clear_cal_sensor()
         return false;
     }
 
+    /* Write an empty gain cal checkpoint struct */
+    if (!settings_clear_cal_gain_checkpoint()) {
+        return false;
+    }
+
+    /* Write an empty temperature cal struct */
+    settings_cal_temperature_t cal_temperature;
+    settings_set_cal_temperature_defaults(&cal_temperature);
+    if (!settings_set_cal_temperature(&cal_temperature)) {
+        return false;
+    }
+
     /* Write the page version */
     if (settings_write_uint32(PAGE_CAL_SENSOR, PAGE_CAL_SENSOR_VERSION) != HAL_OK) {
         return false;
@@ -385,6 +693,8 @@ bool settings_init_user_settings(bool force_clear)
     /* Initialize all fields to their default values */
     settings_set_user_usb_key_defaults(&setting_user_usb_key);
     settings_set_user_idle_light_defaults(&setting_user_idle_light);
+    settings_set_user_log_level_defaults(&setting_user_log_level);
+    setting_user_language = SETTING_LANGUAGE_DEFAULT;
 
     /* Load settings if the version matches */
     uint32_t version = force_clear ? 0 : settings_read_uint32(PAGE_USER_SETTINGS);
@@ -393,8 +703,10 @@ bool settings_init_user_settings(bool force_clear)
         settings_load_user_usb_key();
         settings_load_user_idle_light();
         settings_load_user_display_format();
+        settings_load_user_log_level();
+        settings_load_user_language();
         result = true;
-    } else if (version == 1 || version == 2) {
+    } else if (version >= 1 && version <= 6) {
         log_i("Migrating user settings from %d->%d", version, PAGE_USER_SETTINGS_VERSION);
         /* Handle the migration from version 1->2 */
         do {
@@ -425,7 +737,49 @@ bool settings_init_user_settings(bool force_clear)
                 if (!settings_set_user_display_format(&display_format)) {
                     break;
                 }
+            } else if (version == 3) {
+                /* Load unchanged settings */
+                settings_load_user_usb_key();
+                settings_load_user_idle_light();
+                settings_load_user_display_format();
+            } else if (version == 4 || version == 5) {
+                /* Load unchanged settings */
+                settings_load_user_usb_key();
+                settings_load_user_idle_light();
+                settings_load_user_display_format();
+                settings_load_user_log_level_v5();
+                if (version == 5) {
+                    settings_load_user_language_v6();
+                }
+            } else if (version == 6) {
+                /* Load unchanged settings */
+                settings_load_user_usb_key();
+                settings_load_user_idle_light();
+                settings_load_user_display_format();
+                settings_load_user_log_level();
+                settings_load_user_language_v6();
+            }
+
+            if (version < 6) {
+                /*
+                 * Rewrite the log levels with their CRC, using the defaults
+                 * for settings new to version 4 or values that fail validation
+                 */
+                settings_user_log_level_t log_level;
+                settings_get_user_log_level(&log_level);
+                if (!settings_set_user_log_level(&log_level)) {
+                    break;
+                }
+            }
+
+            /*
+             * Rewrite the language with its CRC, using the default for
+             * settings new to version 5 or a value that fails validation
+             */
+            if (!settings_set_user_language(settings_get_user_language())) {
+                break;
             }
+
             /* Update the page version */
             settings_write_uint32(PAGE_USER_SETTINGS, PAGE_USER_SETTINGS_VERSION);
         } while (0);
@@ -472,6 +826,18 @@ bool settings_clear_user_settings()
         return false;
     }
 
+    /* Write an empty log level settings struct */
+    settings_user_log_level_t log_level;
+    settings_set_user_log_level_defaults(&log_level);
+    if (!settings_set_user_log_level(&log_level)) {
+        return false;
+    }
+
+    /* Write the default display language */
+    if (!settings_set_user_language(SETTING_LANGUAGE_DEFAULT)) {
+        return false;
+    }
+
     /* Write the page version */
     if (settings_write_uint32(PAGE_USER_SETTINGS, PAGE_USER_SETTINGS_VERSION) != HAL_OK) {
         return false;
@@ -480,6 +846,111 @@ bool settings_clear_user_settings()
     return true;
 }
 
+bool settings_init_user_templates(bool force_clear)
+{
+    bool result;
+    /* Initialize all fields to their default values */
+    settings_set_user_hid_template_defaults(&setting_user_hid_template);
+
+    /* Load settings if the version matches */
+    uint32_t version = force_clear ? 0 : settings_read_uint32(PAGE_USER_TEMPLATES);
+    if (version == PAGE_USER_TEMPLATES_VERSION) {
+        /* Version is good, load data with per-field validation */
+        settings_load_user_hid_template();
+        result = true;
+    } else {
+        /* Version is bad, initialize a blank page */
+        if (!force_clear && version != 0) {
+            log_w("Unexpected user templates version: %d != %d", version, PAGE_USER_TEMPLATES_VERSION);
+        }
+        result = settings_clear_user_templates();
+    }
+    return result;
+}
+
+bool settings_clear_user_templates()
+{
+    log_i("Clearing user templates page");
+
+    /* Zero the entire page */
+    uint8_t data[PAGE_USER_TEMPLATES_SIZE];
+    memset(data, 0, sizeof(data));
+    if (settings_write_buffer(PAGE_USER_TEMPLATES, data, sizeof(data)) != HAL_OK) {
+        return false;
+    }
+
+    /* Write an empty HID template settings struct */
+    settings_user_hid_template_t hid_template;
+    settings_set_user_hid_template_defaults(&hid_template);
+    if (!settings_set_user_hid_template(&hid_template)) {
+        return false;
+    }
+
+    /* Write the page version */
+    if (settings_write_uint32(PAGE_USER_TEMPLATES, PAGE_USER_TEMPLATES_VERSION) != HAL_OK) {
+        return false;
+    }
+
+    return true;
+}
+
+bool settings_init_cal_profiles(bool force_clear)
+{
+    bool result;
+    setting_cal_profile_active = SETTING_CAL_PROFILE_NONE;
+    memset(setting_cal_profile_active_name, 0, sizeof(setting_cal_profile_active_name));
+
+    /* Load the active profile if the version matches */
+    uint32_t version = force_clear ? 0 : settings_read_uint32(PAGE_CAL_PROFILES);
+    if (version == PAGE_CAL_PROFILES_VERSION) {
+        /* Undo any select that was interrupted before it could finish */
+        settings_cal_profile_t profile;
+        uint8_t active = cal_profile_recover(&settings_cal_profile_store);
+        if (active != SETTING_CAL_PROFILE_NONE && settings_get_cal_profile(active, &profile)) {
+            setting_cal_profile_active = active;
+            strcpy(setting_cal_profile_active_name, profile.name);
+        }
+        result = true;
+    } else {
+        /* Version is bad, initialize a blank page */
+        if (!force_clear) {
+            log_w("Unexpected cal profiles version: %d != %d", version, PAGE_CAL_PROFILES_VERSION);
+        }
+        result = settings_clear_cal_profiles();
+    }
+
+    return result;
+}
+
+bool settings_clear_cal_profiles()
+{
+    log_i("Clearing cal profile pages");
+
+    /* Zero the page version */
+    if (settings_write_uint32(PAGE_CAL_PROFILES, 0UL) != HAL_OK) {
+        return false;
+    }
+
+    /* Mark all profile slots as unused */
+    for (uint8_t i = 0; i < SETTING_CAL_PROFILE_COUNT; i++) {
+        if (!settings_clear_cal_profile(i)) {
+            return false;
+        }
+        watchdog_refresh();
+    }
+
+    if (settings_write_uint32(CONFIG_CAL_PROFILE_ACTIVE, SETTING_CAL_PROFILE_NONE) != HAL_OK) {
+        return false;
+    }
+
+    /* Write the page version */
+    if (settings_write_uint32(PAGE_CAL_PROFILES, PAGE_CAL_PROFILES_VERSION) != HAL_OK) {
+        return false;
+    }
+
+    return true;
+}
+
 void settings_set_cal_light_defaults(settings_cal_light_t *cal_light)
 {
     if (!cal_light) { return; }
@@ -500,7 +971,9 @@ bool settings_set_cal_light(const settings_cal_light_t *cal_light)
     uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 2);
     copy_from_u32(&buf[8], crc);
 
+    settings_audit_begin();
     ret = settings_write_buffer(CONFIG_CAL_LIGHT, buf, sizeof(buf));
+    settings_audit_end();
 
     if (ret == HAL_OK) {
         memcpy(&setting_cal_light, cal_light, sizeof(settings_cal_light_t));
@@ -590,7 +1063,9 @@ bool settings_set_cal_gain(const settings_cal_gain_t *cal_gain)
     uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 6);
     copy_from_u32(&buf[24], crc);
 
+    settings_audit_begin();
     ret = settings_write_buffer(CONFIG_CAL_GAIN, buf, sizeof(buf));
+    settings_audit_end();
 
     if (ret == HAL_OK) {
         memcpy(&setting_cal_gain, cal_gain, sizeof(settings_cal_gain_t));
@@ -705,6 +1180,147 @@ bool settings_validate_cal_gain(const settings_cal_gain_t *cal_gain)
     return true;
 }
 
+void settings_set_cal_gain_checkpoint_defaults(settings_cal_gain_checkpoint_t *checkpoint)
+{
+    if (!checkpoint) { return; }
+    memset(checkpoint, 0, sizeof(settings_cal_gain_checkpoint_t));
+    checkpoint->stage = SETTING_GAIN_CAL_STAGE_NONE;
+    checkpoint->measurement_reading = NAN;
+    checkpoint->max_gain_reading = NAN;
+    checkpoint->ch0_medium = NAN;
+    checkpoint->ch1_medium = NAN;
+    checkpoint->ch0_high = NAN;
+    checkpoint->ch1_high = NAN;
+    checkpoint->ch0_maximum = NAN;
+    checkpoint->ch1_maximum = NAN;
+}
+
+bool settings_set_cal_gain_checkpoint(const settings_cal_gain_checkpoint_t *checkpoint)
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+    if (!checkpoint) { return false; }
+
+    uint8_t buf[CONFIG_CAL_GAIN_CHECKPOINT_SIZE];
+    buf[0] = (uint8_t)checkpoint->stage;
+    buf[1] = checkpoint->measurement_brightness;
+    buf[2] = checkpoint->max_gain_brightness;
+    buf[3] = 0;
+    copy_from_f32(&buf[4], checkpoint->measurement_reading);
+    copy_from_f32(&buf[8], checkpoint->max_gain_reading);
+    copy_from_f32(&buf[12], checkpoint->ch0_medium);
+    copy_from_f32(&buf[16], checkpoint->ch1_medium);
+    copy_from_f32(&buf[20], checkpoint->ch0_high);
+    copy_from_f32(&buf[24], checkpoint->ch1_high);
+    copy_from_f32(&buf[28], checkpoint->ch0_maximum);
+    copy_from_f32(&buf[32], checkpoint->ch1_maximum);
+
+    uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 9);
+    copy_from_u32(&buf[36], crc);
+
+    ret = settings_write_buffer(CONFIG_CAL_GAIN_CHECKPOINT, buf, sizeof(buf));
+
+    if (ret == HAL_OK) {
+        memcpy(&setting_cal_gain_checkpoint, checkpoint, sizeof(settings_cal_gain_checkpoint_t));
+        return true;
+    } else {
+        return false;
+    }
+}
+
+bool settings_load_cal_gain_checkpoint()
+{
+    uint8_t buf[CONFIG_CAL_GAIN_CHECKPOINT_SIZE];
+
+    if (settings_read_buffer(CONFIG_CAL_GAIN_CHECKPOINT, buf, sizeof(buf)) != HAL_OK) {
+        return false;
+    }
+
+    uint32_t crc = copy_to_u32(&buf[36]);
+    uint32_t calculated_crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 9);
+
+    if (crc != calculated_crc) {
+        log_w("Invalid cal gain checkpoint CRC: %08X != %08X", crc, calculated_crc);
+        return false;
+    } else {
+        setting_cal_gain_checkpoint.stage = buf[0];
+        setting_cal_gain_checkpoint.measurement_brightness = buf[1];
+        setting_cal_gain_checkpoint.max_gain_brightness = buf[2];
+        setting_cal_gain_checkpoint.measurement_reading = copy_to_f32(&buf[4]);
+        setting_cal_gain_checkpoint.max_gain_reading = copy_to_f32(&buf[8]);
+        setting_cal_gain_checkpoint.ch0_medium = copy_to_f32(&buf[12]);
+        setting_cal_gain_checkpoint.ch1_medium = copy_to_f32(&buf[16]);
+        setting_cal_gain_checkpoint.ch0_high = copy_to_f32(&buf[20]);
+        setting_cal_gain_checkpoint.ch1_high = copy_to_f32(&buf[24]);
+        setting_cal_gain_checkpoint.ch0_maximum = copy_to_f32(&buf[28]);
+        setting_cal_gain_checkpoint.ch1_maximum = copy_to_f32(&buf[32]);
+        return true;
+    }
+}
+
+bool settings_get_cal_gain_checkpoint(settings_cal_gain_checkpoint_t *checkpoint)
+{
+    if (!checkpoint) { return false; }
+
+    /* Copy over the settings values */
+    memcpy(checkpoint, &setting_cal_gain_checkpoint, sizeof(settings_cal_gain_checkpoint_t));
+
+    /* Set default values if validation fails or nothing is resumable */
+    if (!settings_validate_cal_gain_checkpoint(checkpoint)
+        || checkpoint->stage == SETTING_GAIN_CAL_STAGE_NONE) {
+        settings_set_cal_gain_checkpoint_defaults(checkpoint);
+        return false;
+    } else {
+        return true;
+    }
+}
+
+bool settings_clear_cal_gain_checkpoint()
+{
+    settings_cal_gain_checkpoint_t checkpoint;
+    settings_set_cal_gain_checkpoint_defaults(&checkpoint);
+    return settings_set_cal_gain_checkpoint(&checkpoint);
+}
+
+bool settings_validate_cal_gain_checkpoint(const settings_cal_gain_checkpoint_t *checkpoint)
+{
+    if (!checkpoint) { return false; }
+
+    /* Validate the stage itself */
+    if (checkpoint->stage >= SETTING_GAIN_CAL_STAGE_MAX) {
+        return false;
+    }
+
+    /* Validate the fields populated by each completed stage */
+    if (checkpoint->stage >= SETTING_GAIN_CAL_STAGE_LED) {
+        if (checkpoint->measurement_brightness == 0 || checkpoint->measurement_brightness > 128) {
+            return false;
+        }
+        if (!is_valid_number(checkpoint->measurement_reading) || checkpoint->measurement_reading <= 0.0F) {
+            return false;
+        }
+    }
+    if (checkpoint->stage >= SETTING_GAIN_CAL_STAGE_MEDIUM) {
+        if (!is_valid_number(checkpoint->ch0_medium) || !is_valid_number(checkpoint->ch1_medium)) {
+            return false;
+        }
+    }
+    if (checkpoint->stage >= SETTING_GAIN_CAL_STAGE_HIGH) {
+        if (!is_valid_number(checkpoint->ch0_high) || !is_valid_number(checkpoint->ch1_high)) {
+            return false;
+        }
+    }
+    if (checkpoint->stage >= SETTING_GAIN_CAL_STAGE_MAX_LED) {
+        if (checkpoint->max_gain_brightness == 0 || checkpoint->max_gain_brightness > 128) {
+            return false;
+        }
+        if (!is_valid_number(checkpoint->max_gain_reading) || checkpoint->max_gain_reading <= 0.0F) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void settings_set_cal_slope_defaults(settings_cal_slope_t *cal_slope)
 {
     if (!cal_slope) { return; }
@@ -727,7 +1343,9 @@ bool settings_set_cal_slope(const settings_cal_slope_t *cal_slope)
     uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 3);
     copy_from_u32(&buf[12], crc);
 
+    settings_audit_begin();
     ret = settings_write_buffer(CONFIG_CAL_SLOPE, buf, sizeof(buf));
+    settings_audit_end();
 
     if (ret == HAL_OK) {
         memcpy(&setting_cal_slope, cal_slope, sizeof(settings_cal_slope_t));
@@ -793,59 +1411,187 @@ bool settings_validate_cal_slope(const settings_cal_slope_t *cal_slope)
     return true;
 }
 
-void settings_set_cal_reflection_defaults(settings_cal_reflection_t *cal_reflection)
+void settings_set_cal_temperature_defaults(settings_cal_temperature_t *cal_temperature)
 {
-    if (!cal_reflection) { return; }
-    memset(cal_reflection, 0, sizeof(settings_cal_reflection_t));
-    cal_reflection->lo_d = NAN;
-    cal_reflection->lo_value = NAN;
-    cal_reflection->hi_d = NAN;
-    cal_reflection->hi_value = NAN;
+    if (!cal_temperature) { return; }
+    memset(cal_temperature, 0, sizeof(settings_cal_temperature_t));
+    cal_temperature->gain_temp = NAN;
+    cal_temperature->slope_temp = NAN;
+    cal_temperature->reflection_temp = NAN;
+    cal_temperature->transmission_temp = NAN;
+    cal_temperature->coef_a = 0.0F;
+    cal_temperature->coef_b = 0.0F;
 }
 
-bool settings_set_cal_reflection(const settings_cal_reflection_t *cal_reflection)
+bool settings_set_cal_temperature(const settings_cal_temperature_t *cal_temperature)
 {
     HAL_StatusTypeDef ret = HAL_OK;
-    if (!cal_reflection) { return false; }
+    if (!cal_temperature) { return false; }
 
-    uint8_t buf[CONFIG_CAL_REFLECTION_SIZE];
-    copy_from_f32(&buf[0], cal_reflection->lo_d);
-    copy_from_f32(&buf[4], cal_reflection->lo_value);
-    copy_from_f32(&buf[8], cal_reflection->hi_d);
-    copy_from_f32(&buf[12], cal_reflection->hi_value);
+    uint8_t buf[CONFIG_CAL_TEMPERATURE_SIZE];
+    copy_from_f32(&buf[0], cal_temperature->gain_temp);
+    copy_from_f32(&buf[4], cal_temperature->slope_temp);
+    copy_from_f32(&buf[8], cal_temperature->reflection_temp);
+    copy_from_f32(&buf[12], cal_temperature->transmission_temp);
+    copy_from_f32(&buf[16], cal_temperature->coef_a);
+    copy_from_f32(&buf[20], cal_temperature->coef_b);
 
-    uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 4);
-    copy_from_u32(&buf[16], crc);
+    uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 6);
+    copy_from_u32(&buf[24], crc);
 
-    ret = settings_write_buffer(CONFIG_CAL_REFLECTION, buf, sizeof(buf));
+    ret = settings_write_buffer(CONFIG_CAL_TEMPERATURE, buf, sizeof(buf));
 
     if (ret == HAL_OK) {
-        memcpy(&setting_cal_reflection, cal_reflection, sizeof(settings_cal_reflection_t));
+        memcpy(&setting_cal_temperature, cal_temperature, sizeof(settings_cal_temperature_t));
         return true;
     } else {
         return false;
     }
 }
 
-bool settings_load_cal_reflection()
+bool settings_load_cal_temperature()
 {
-    uint8_t buf[CONFIG_CAL_REFLECTION_SIZE];
+    uint8_t buf[CONFIG_CAL_TEMPERATURE_SIZE];
 
-    if (settings_read_buffer(CONFIG_CAL_REFLECTION, buf, sizeof(buf)) != HAL_OK) {
+    if (settings_read_buffer(CONFIG_CAL_TEMPERATURE, buf, sizeof(buf)) != HAL_OK) {
         return false;
     }
 
-    uint32_t crc = copy_to_u32(&buf[16]);
-    uint32_t calculated_crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 4);
+    uint32_t crc = copy_to_u32(&buf[24]);
+    uint32_t calculated_crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 6);
 
     if (crc != calculated_crc) {
-        log_w("Invalid cal reflection CRC: %08X != %08X", crc, calculated_crc);
+        log_w("Invalid cal temperature CRC: %08X != %08X", crc, calculated_crc);
         return false;
     } else {
-        setting_cal_reflection.lo_d = copy_to_f32(&buf[0]);
-        setting_cal_reflection.lo_value = copy_to_f32(&buf[4]);
+        setting_cal_temperature.gain_temp = copy_to_f32(&buf[0]);
+        setting_cal_temperature.slope_temp = copy_to_f32(&buf[4]);
+        setting_cal_temperature.reflection_temp = copy_to_f32(&buf[8]);
+        setting_cal_temperature.transmission_temp = copy_to_f32(&buf[12]);
+        setting_cal_temperature.coef_a = copy_to_f32(&buf[16]);
+        setting_cal_temperature.coef_b = copy_to_f32(&buf[20]);
+        return true;
+    }
+}
+
+bool settings_get_cal_temperature(settings_cal_temperature_t *cal_temperature)
+{
+    if (!cal_temperature) { return false; }
+
+    /* Copy over the settings values */
+    memcpy(cal_temperature, &setting_cal_temperature, sizeof(settings_cal_temperature_t));
+
+    /* Set default values if validation fails */
+    if (!settings_validate_cal_temperature(cal_temperature)) {
+        settings_set_cal_temperature_defaults(cal_temperature);
+        return false;
+    } else {
+        return true;
+    }
+}
+
+static bool settings_validate_cal_temperature_field(float temp)
+{
+    /* Temperatures are optional, but must be within the range of the sensor */
+    if (isnanf(temp)) {
+        return true;
+    }
+    if (isinff(temp) || temp < -40.0F || temp > 125.0F) {
+        return false;
+    }
+    return true;
+}
+
+bool settings_validate_cal_temperature(const settings_cal_temperature_t *cal_temperature)
+{
+    if (!cal_temperature) { return false; }
+
+    /* Validate the recorded temperatures */
+    if (!settings_validate_cal_temperature_field(cal_temperature->gain_temp)
+        || !settings_validate_cal_temperature_field(cal_temperature->slope_temp)
+        || !settings_validate_cal_temperature_field(cal_temperature->reflection_temp)
+        || !settings_validate_cal_temperature_field(cal_temperature->transmission_temp)) {
+        return false;
+    }
+
+    /* Validate the coefficients, which must be small enough to be plausible */
+    if (!is_valid_number(cal_temperature->coef_a) || fabsf(cal_temperature->coef_a) > 0.1F) {
+        return false;
+    }
+    if (!is_valid_number(cal_temperature->coef_b) || fabsf(cal_temperature->coef_b) > 0.01F) {
+        return false;
+    }
+
+    return true;
+}
+
+void settings_set_cal_reflection_defaults(settings_cal_reflection_t *cal_reflection)
+{
+    if (!cal_reflection) { return; }
+    memset(cal_reflection, 0, sizeof(settings_cal_reflection_t));
+    cal_reflection->lo_d = NAN;
+    cal_reflection->lo_value = NAN;
+    cal_reflection->hi_d = NAN;
+    cal_reflection->hi_value = NAN;
+    cal_reflection->lo_unc = NAN;
+    cal_reflection->hi_unc = NAN;
+}
+
+bool settings_set_cal_reflection(const settings_cal_reflection_t *cal_reflection)
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+    if (!cal_reflection) { return false; }
+
+    uint8_t buf[CONFIG_CAL_REFLECTION_SIZE];
+    copy_from_f32(&buf[0], cal_reflection->lo_d);
+    copy_from_f32(&buf[4], cal_reflection->lo_value);
+    copy_from_f32(&buf[8], cal_reflection->hi_d);
+    copy_from_f32(&buf[12], cal_reflection->hi_value);
+
+    uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 4);
+    copy_from_u32(&buf[16], crc);
+
+    settings_audit_begin();
+    ret = settings_write_buffer(CONFIG_CAL_REFLECTION, buf, sizeof(buf));
+
+    if (ret == HAL_OK) {
+        const float unc[] = { cal_reflection->lo_unc, cal_reflection->hi_unc };
+        ret = settings_write_unc_block(CONFIG_CAL_REFLECTION_UNC, unc, 2, crc);
+    }
+    settings_audit_end();
+
+    if (ret == HAL_OK) {
+        memcpy(&setting_cal_reflection, cal_reflection, sizeof(settings_cal_reflection_t));
+        return true;
+    } else {
+        return false;
+    }
+}
+
+bool settings_load_cal_reflection()
+{
+    uint8_t buf[CONFIG_CAL_REFLECTION_SIZE];
+
+    if (settings_read_buffer(CONFIG_CAL_REFLECTION, buf, sizeof(buf)) != HAL_OK) {
+        return false;
+    }
+
+    uint32_t crc = copy_to_u32(&buf[16]);
+    uint32_t calculated_crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 4);
+
+    if (crc != calculated_crc) {
+        log_w("Invalid cal reflection CRC: %08X != %08X", crc, calculated_crc);
+        return false;
+    } else {
+        setting_cal_reflection.lo_d = copy_to_f32(&buf[0]);
+        setting_cal_reflection.lo_value = copy_to_f32(&buf[4]);
         setting_cal_reflection.hi_d = copy_to_f32(&buf[8]);
         setting_cal_reflection.hi_value = copy_to_f32(&buf[12]);
+
+        float unc[2] = { NAN, NAN };
+        settings_read_unc_block(CONFIG_CAL_REFLECTION_UNC, unc, 2, crc);
+        setting_cal_reflection.lo_unc = unc[0];
+        setting_cal_reflection.hi_unc = unc[1];
         return true;
     }
 }
@@ -886,6 +1632,12 @@ bool settings_validate_cal_reflection(const settings_cal_reflection_t *cal_refle
     if (isnanf(cal_reflection->hi_value) || isinff(cal_reflection->hi_value)) {
         return false;
     }
+    if (isinff(cal_reflection->lo_unc) || cal_reflection->lo_unc < 0.0F) {
+        return false;
+    }
+    if (isinff(cal_reflection->hi_unc) || cal_reflection->hi_unc < 0.0F) {
+        return false;
+    }
 
     /* Validate field values */
     if (cal_reflection->lo_d < 0.0F || cal_reflection->hi_d <= cal_reflection->lo_d
@@ -903,6 +1655,7 @@ void settings_set_cal_transmission_defaults(settings_cal_transmission_t *cal_tra
     cal_transmission->zero_value = NAN;
     cal_transmission->hi_d = NAN;
     cal_transmission->hi_value = NAN;
+    cal_transmission->hi_unc = NAN;
 }
 
 bool settings_set_cal_transmission(const settings_cal_transmission_t *cal_transmission)
@@ -918,8 +1671,14 @@ bool settings_set_cal_transmission(const settings_cal_transmission_t *cal_transm
     uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 3);
     copy_from_u32(&buf[12], crc);
 
+    settings_audit_begin();
     ret = settings_write_buffer(CONFIG_CAL_TRANSMISSION, buf, sizeof(buf));
 
+    if (ret == HAL_OK) {
+        ret = settings_write_unc_block(CONFIG_CAL_TRANSMISSION_UNC, &cal_transmission->hi_unc, 1, crc);
+    }
+    settings_audit_end();
+
     if (ret == HAL_OK) {
         memcpy(&setting_cal_transmission, cal_transmission, sizeof(settings_cal_transmission_t));
         return true;
@@ -946,6 +1705,10 @@ bool settings_load_cal_transmission()
         setting_cal_transmission.zero_value = copy_to_f32(&buf[0]);
         setting_cal_transmission.hi_d = copy_to_f32(&buf[4]);
         setting_cal_transmission.hi_value = copy_to_f32(&buf[8]);
+
+        float unc = NAN;
+        settings_read_unc_block(CONFIG_CAL_TRANSMISSION_UNC, &unc, 1, crc);
+        setting_cal_transmission.hi_unc = unc;
         return true;
     }
 }
@@ -983,6 +1746,9 @@ bool settings_validate_cal_transmission(const settings_cal_transmission_t *cal_t
     if (isnanf(cal_transmission->hi_value) || isinff(cal_transmission->hi_value)) {
         return false;
     }
+    if (isinff(cal_transmission->hi_unc) || cal_transmission->hi_unc < 0.0F) {
+        return false;
+    }
 
     /* Validate field values */
     if (cal_transmission->zero_value <= 0.0F
@@ -994,6 +1760,140 @@ bool settings_validate_cal_transmission(const settings_cal_transmission_t *cal_t
     return true;
 }
 
+bool settings_set_cal_profile(uint8_t index, const settings_cal_profile_t *profile)
+{
+    settings_audit_begin();
+    bool result = cal_profile_write(&settings_cal_profile_store, index, profile);
+    settings_audit_end();
+    if (!result) {
+        return false;
+    }
+
+    /* Keep the active profile name current if its slot was replaced */
+    if (index == setting_cal_profile_active) {
+        if (profile->name[0] == '\0') {
+            setting_cal_profile_active = SETTING_CAL_PROFILE_NONE;
+            memset(setting_cal_profile_active_name, 0, sizeof(setting_cal_profile_active_name));
+        } else {
+            strncpy(setting_cal_profile_active_name, profile->name, SETTING_CAL_PROFILE_NAME_LEN);
+        }
+    }
+    return true;
+}
+
+bool settings_get_cal_profile(uint8_t index, settings_cal_profile_t *profile)
+{
+    return cal_profile_read(&settings_cal_profile_store, index, profile);
+}
+
+bool settings_clear_cal_profile(uint8_t index)
+{
+    settings_cal_profile_t profile;
+    memset(&profile, 0, sizeof(settings_cal_profile_t));
+    return settings_set_cal_profile(index, &profile);
+}
+
+bool settings_save_cal_profile(uint8_t index, const char *name)
+{
+    settings_cal_profile_t profile;
+    if (index >= SETTING_CAL_PROFILE_COUNT) { return false; }
+    if (name && !settings_validate_cal_profile_name(name)) { return false; }
+
+    /* Keep the existing name, or assign a default one to an unused slot */
+    if (!settings_get_cal_profile(index, &profile)) {
+        sprintf_(profile.name, "Profile %d", index + 1);
+    }
+    if (name) {
+        strncpy(profile.name, name, SETTING_CAL_PROFILE_NAME_LEN);
+        profile.name[SETTING_CAL_PROFILE_NAME_LEN] = '\0';
+    }
+
+    settings_cal_lock();
+    memcpy(&profile.gain, &setting_cal_gain, sizeof(settings_cal_gain_t));
+    memcpy(&profile.slope, &setting_cal_slope, sizeof(settings_cal_slope_t));
+    memcpy(&profile.reflection, &setting_cal_reflection, sizeof(settings_cal_reflection_t));
+    memcpy(&profile.transmission, &setting_cal_transmission, sizeof(settings_cal_transmission_t));
+    settings_cal_unlock();
+
+    return settings_set_cal_profile(index, &profile);
+}
+
+bool settings_select_cal_profile(uint8_t index)
+{
+    settings_cal_profile_t profile;
+    bool result = false;
+
+    if (!settings_get_cal_profile(index, &profile)) {
+        return false;
+    }
+
+    settings_cal_lock();
+    settings_audit_begin();
+    if (cal_profile_select(&settings_cal_profile_store, index, setting_cal_profile_active)) {
+        setting_cal_profile_active = index;
+        strcpy(setting_cal_profile_active_name, profile.name);
+        result = true;
+    }
+    settings_audit_end();
+    settings_cal_unlock();
+
+    if (result) {
+        log_i("Selected cal profile %d: %s", index, profile.name);
+    } else {
+        log_w("Unable to select cal profile %d", index);
+    }
+    return result;
+}
+
+uint8_t settings_get_active_cal_profile()
+{
+    return setting_cal_profile_active;
+}
+
+bool settings_get_active_cal_profile_name(char *name)
+{
+    if (!name) { return false; }
+    if (setting_cal_profile_active == SETTING_CAL_PROFILE_NONE) {
+        name[0] = '\0';
+        return false;
+    }
+    strncpy(name, setting_cal_profile_active_name, SETTING_CAL_PROFILE_NAME_LEN);
+    name[SETTING_CAL_PROFILE_NAME_LEN] = '\0';
+    return true;
+}
+
+bool settings_validate_cal_profile_name(const char *name)
+{
+    if (!name) { return false; }
+
+    size_t len = strlen(name);
+    if (len == 0 || len > SETTING_CAL_PROFILE_NAME_LEN) {
+        return false;
+    }
+
+    /* Commas and quotes would conflict with the command protocol */
+    for (size_t i = 0; i < len; i++) {
+        if (name[i] < 0x20 || name[i] > 0x7E || name[i] == ',' || name[i] == '"') {
+            return false;
+        }
+    }
+    return true;
+}
+
+void settings_cal_lock()
+{
+    if (settings_cal_mutex) {
+        osMutexAcquire(settings_cal_mutex, portMAX_DELAY);
+    }
+}
+
+void settings_cal_unlock()
+{
+    if (settings_cal_mutex) {
+        osMutexRelease(settings_cal_mutex);
+    }
+}
+
 void settings_set_user_usb_key_defaults(settings_user_usb_key_t *usb_key)
 {
     if (!usb_key) { return; }
@@ -1013,7 +1913,9 @@ bool settings_set_user_usb_key(const settings_user_usb_key_t *usb_key)
     copy_from_u32(&buf[4], (uint32_t)usb_key->format);
     copy_from_u32(&buf[8], (uint32_t)usb_key->separator);
 
+    settings_audit_begin();
     ret = settings_write_buffer(CONFIG_USER_USB_KEY, buf, sizeof(buf));
+    settings_audit_end();
 
     if (ret == HAL_OK) {
         memcpy(&setting_user_usb_key, usb_key, sizeof(settings_user_usb_key_t));
@@ -1074,7 +1976,9 @@ bool settings_set_user_idle_light(const settings_user_idle_light_t *idle_light)
     copy_from_u32(&buf[4], (uint32_t)idle_light->transmission);
     copy_from_u32(&buf[8], (uint32_t)idle_light->timeout);
 
+    settings_audit_begin();
     ret = settings_write_buffer(CONFIG_USER_IDLE_LIGHT, buf, sizeof(buf));
+    settings_audit_end();
 
     if (ret == HAL_OK) {
         memcpy(&setting_user_idle_light, idle_light, sizeof(settings_user_idle_light_t));
@@ -1133,7 +2037,9 @@ bool settings_set_user_display_format(const settings_user_display_format_t *disp
     copy_from_u32(&buf[0], (uint32_t)display_format->separator);
     copy_from_u32(&buf[4], (uint32_t)display_format->unit);
 
+    settings_audit_begin();
     ret = settings_write_buffer(CONFIG_USER_DISPLAY_FORMAT, buf, sizeof(buf));
+    settings_audit_end();
 
     if (ret == HAL_OK) {
         memcpy(&setting_user_display_format, display_format, sizeof(settings_user_display_format_t));
@@ -1174,6 +2080,241 @@ bool settings_get_user_display_format(settings_user_display_format_t *display_fo
     }
 }
 
+void settings_set_user_log_level_defaults(settings_user_log_level_t *log_level)
+{
+    if (!log_level) { return; }
+    memset(log_level, 0, sizeof(settings_user_log_level_t));
+    log_level->level = ELOG_LVL_VERBOSE;
+}
+
+bool settings_set_user_log_level(const settings_user_log_level_t *log_level)
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+    if (!log_level) { return false; }
+
+    uint8_t buf[CONFIG_USER_LOG_LEVEL_SIZE];
+    memset(buf, 0, sizeof(buf));
+    copy_from_u32(&buf[0], (uint32_t)log_level->level);
+    for (size_t i = 0; i < SETTING_LOG_LEVEL_TAG_COUNT; i++) {
+        strncpy((char *)&buf[4 + (i * SETTING_LOG_LEVEL_TAG_LEN)], log_level->tags[i].tag, SETTING_LOG_LEVEL_TAG_LEN);
+        buf[68 + i] = log_level->tags[i].level;
+    }
+
+    uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 18);
+    copy_from_u32(&buf[72], crc);
+
+    ret = settings_write_buffer(CONFIG_USER_LOG_LEVEL, buf, sizeof(buf));
+
+    if (ret == HAL_OK) {
+        memcpy(&setting_user_log_level, log_level, sizeof(settings_user_log_level_t));
+        return true;
+    } else {
+        return false;
+    }
+}
+
+bool settings_load_user_log_level()
+{
+    uint8_t buf[CONFIG_USER_LOG_LEVEL_SIZE];
+
+    if (settings_read_buffer(CONFIG_USER_LOG_LEVEL, buf, sizeof(buf)) != HAL_OK) {
+        return false;
+    }
+
+    uint32_t crc = copy_to_u32(&buf[72]);
+    uint32_t calculated_crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 18);
+    if (crc != calculated_crc) {
+        log_w("Invalid log level CRC: %08X != %08X", crc, calculated_crc);
+        return false;
+    }
+
+    setting_user_log_level.level = (uint8_t)copy_to_u32(&buf[0]);
+    for (size_t i = 0; i < SETTING_LOG_LEVEL_TAG_COUNT; i++) {
+        memcpy(setting_user_log_level.tags[i].tag, &buf[4 + (i * SETTING_LOG_LEVEL_TAG_LEN)], SETTING_LOG_LEVEL_TAG_LEN);
+        setting_user_log_level.tags[i].tag[SETTING_LOG_LEVEL_TAG_LEN] = '\0';
+        setting_user_log_level.tags[i].level = buf[68 + i];
+    }
+    return true;
+}
+
+bool settings_load_user_log_level_v5()
+{
+    uint8_t buf[CONFIG_USER_LOG_LEVEL_V5_SIZE];
+
+    if (settings_read_buffer(CONFIG_USER_LOG_LEVEL, buf, sizeof(buf)) != HAL_OK) {
+        return false;
+    }
+
+    setting_user_log_level.level = (uint8_t)copy_to_u32(&buf[0]);
+    for (size_t i = 0; i < SETTING_LOG_LEVEL_TAG_COUNT; i++) {
+        const uint8_t *entry = &buf[4 + (i * 20)];
+        memcpy(setting_user_log_level.tags[i].tag, entry, SETTING_LOG_LEVEL_TAG_LEN);
+        setting_user_log_level.tags[i].tag[SETTING_LOG_LEVEL_TAG_LEN] = '\0';
+        setting_user_log_level.tags[i].level = (uint8_t)copy_to_u32(&entry[16]);
+    }
+    return true;
+}
+
+bool settings_get_user_log_level(settings_user_log_level_t *log_level)
+{
+    if (!log_level) { return false; }
+
+    /* Copy over the settings values */
+    memcpy(log_level, &setting_user_log_level, sizeof(settings_user_log_level_t));
+
+    /* Set default values if validation fails */
+    bool valid = log_level->level <= ELOG_LVL_VERBOSE;
+    for (size_t i = 0; i < SETTING_LOG_LEVEL_TAG_COUNT; i++) {
+        if (log_level->tags[i].level > ELOG_LVL_VERBOSE) {
+            valid = false;
+        }
+    }
+
+    if (!valid) {
+        log_w("Invalid log level user settings values");
+        settings_set_user_log_level_defaults(log_level);
+        return false;
+    } else {
+        return true;
+    }
+}
+
+bool settings_set_user_language(uint8_t language)
+{
+    if (language >= UI_LANGUAGE_COUNT) { return false; }
+
+    uint8_t buf[CONFIG_USER_LANGUAGE_SIZE];
+    copy_from_u32(&buf[0], (uint32_t)language);
+
+    uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 1);
+    copy_from_u32(&buf[4], crc);
+
+    if (settings_write_buffer(CONFIG_USER_LANGUAGE, buf, sizeof(buf)) == HAL_OK) {
+        setting_user_language = language;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+bool settings_load_user_language()
+{
+    uint8_t buf[CONFIG_USER_LANGUAGE_SIZE];
+
+    if (settings_read_buffer(CONFIG_USER_LANGUAGE, buf, sizeof(buf)) != HAL_OK) {
+        return false;
+    }
+
+    uint32_t crc = copy_to_u32(&buf[4]);
+    uint32_t calculated_crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 1);
+    if (crc != calculated_crc) {
+        log_w("Invalid language CRC: %08X != %08X", crc, calculated_crc);
+        return false;
+    }
+
+    setting_user_language = (uint8_t)copy_to_u32(&buf[0]);
+    return true;
+}
+
+bool settings_load_user_language_v6()
+{
+    uint8_t buf[CONFIG_USER_LANGUAGE_V6_SIZE];
+
+    if (settings_read_buffer(CONFIG_USER_LANGUAGE, buf, sizeof(buf)) != HAL_OK) {
+        return false;
+    }
+
+    setting_user_language = (uint8_t)copy_to_u32(&buf[0]);
+    return true;
+}
+
+uint8_t settings_get_user_language()
+{
+    /* The language indexes the string tables, so anything past them is replaced */
+    if (setting_user_language >= UI_LANGUAGE_COUNT) {
+        log_w("Invalid language user setting: %d", setting_user_language);
+        return SETTING_LANGUAGE_DEFAULT;
+    }
+    return setting_user_language;
+}
+
+void settings_set_user_hid_template_defaults(settings_user_hid_template_t *hid_template)
+{
+    if (!hid_template) { return; }
+    memset(hid_template, 0, sizeof(settings_user_hid_template_t));
+    strncpy(hid_template->text, HID_TEMPLATE_DEFAULT, SETTING_HID_TEMPLATE_LEN);
+}
+
+bool settings_set_user_hid_template(const settings_user_hid_template_t *hid_template)
+{
+    HAL_StatusTypeDef ret = HAL_OK;
+    if (!hid_template) { return false; }
+
+    uint8_t buf[CONFIG_USER_HID_TEMPLATE_SIZE];
+    memset(buf, 0, sizeof(buf));
+    strncpy((char *)buf, hid_template->text, SETTING_HID_TEMPLATE_LEN);
+
+    uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 15);
+    copy_from_u32(&buf[60], crc);
+
+    settings_audit_begin();
+    ret = settings_write_buffer(CONFIG_USER_HID_TEMPLATE, buf, sizeof(buf));
+    settings_audit_end();
+
+    if (ret == HAL_OK) {
+        memcpy(&setting_user_hid_template, hid_template, sizeof(settings_user_hid_template_t));
+        setting_user_hid_template.text[SETTING_HID_TEMPLATE_LEN] = '\0';
+        return true;
+    } else {
+        return false;
+    }
+}
+
+bool settings_load_user_hid_template()
+{
+    uint8_t buf[CONFIG_USER_HID_TEMPLATE_SIZE];
+
+    if (settings_read_buffer(CONFIG_USER_HID_TEMPLATE, buf, sizeof(buf)) != HAL_OK) {
+        return false;
+    }
+
+    uint32_t crc = copy_to_u32(&buf[60]);
+    uint32_t calculated_crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buf, 15);
+    if (crc != calculated_crc) {
+        log_w("Invalid HID template CRC: %08X != %08X", crc, calculated_crc);
+        return false;
+    }
+
+    memcpy(setting_user_hid_template.text, buf, SETTING_HID_TEMPLATE_LEN);
+    setting_user_hid_template.text[SETTING_HID_TEMPLATE_LEN] = '\0';
+    return true;
+}
+
+bool settings_get_user_hid_template(settings_user_hid_template_t *hid_template)
+{
+    if (!hid_template) { return false; }
+
+    /* Copy over the settings values */
+    memcpy(hid_template, &setting_user_hid_template, sizeof(settings_user_hid_template_t));
+
+    /* Set default values if validation fails */
+    bool valid = hid_template->text[0] != '\0';
+    for (const char *p = hid_template->text; *p; p++) {
+        if ((uint8_t)*p < 0x20 || (uint8_t)*p > 0x7E) {
+            valid = false;
+            break;
+        }
+    }
+
+    if (!valid) {
+        log_w("Invalid HID template user settings values");
+        settings_set_user_hid_template_defaults(hid_template);
+        return false;
+    } else {
+        return true;
+    }
+}
+
 char settings_get_decimal_separator()
 {
     char ch;
@@ -1198,6 +2339,48 @@ char settings_get_unit_suffix()
     return ch;
 }
 
+HAL_StatusTypeDef settings_write_unc_block(uint32_t address, const float *values, size_t count, uint32_t values_crc)
+{
+    return cal_profile_write_unc_block(&settings_cal_profile_store, address, values, count, values_crc)
+        ? HAL_OK : HAL_ERROR;
+}
+
+bool settings_read_unc_block(uint32_t address, float *values, size_t count, uint32_t values_crc)
+{
+    return cal_profile_read_unc_block(&settings_cal_profile_store, address, values, count, values_crc);
+}
+
+bool settings_store_read(uint32_t address, uint8_t *data, size_t data_len)
+{
+    return settings_read_buffer(address, data, data_len) == HAL_OK;
+}
+
+bool settings_store_write(uint32_t address, const uint8_t *data, size_t data_len)
+{
+    return settings_write_buffer(address, data, data_len) == HAL_OK;
+}
+
+uint32_t settings_store_crc(const uint8_t *data, size_t word_count)
+{
+    return HAL_CRC_Calculate(&hcrc, (uint32_t *)data, word_count);
+}
+
+void settings_store_get_live_cal(settings_cal_profile_t *cal)
+{
+    memcpy(&cal->gain, &setting_cal_gain, sizeof(settings_cal_gain_t));
+    memcpy(&cal->slope, &setting_cal_slope, sizeof(settings_cal_slope_t));
+    memcpy(&cal->reflection, &setting_cal_reflection, sizeof(settings_cal_reflection_t));
+    memcpy(&cal->transmission, &setting_cal_transmission, sizeof(settings_cal_transmission_t));
+}
+
+bool settings_store_set_live_cal(const settings_cal_profile_t *cal)
+{
+    return settings_set_cal_gain(&cal->gain)
+        && settings_set_cal_slope(&cal->slope)
+        && settings_set_cal_reflection(&cal->reflection)
+        && settings_set_cal_transmission(&cal->transmission);
+}
+
 HAL_StatusTypeDef settings_read_buffer(uint32_t address, uint8_t *data, size_t data_len)
 {
     if (!IS_FLASH_DATA_ADDRESS(address)) {
@@ -1269,9 +2452,59 @@ HAL_StatusTypeDef settings_write_buffer(uint32_t address, const uint8_t *data, s
         }
     }
     HAL_FLASHEx_DATAEEPROM_Lock();
+
+    /* Only writes made as part of an audited change are recorded */
+    if (ret == HAL_OK && settings_audit_active && setting_audit_depth > 0
+        && (address < PAGE_HEADER || address >= PAGE_HEADER + PAGE_HEADER_SIZE)) {
+        settings_audit_record(address, data, data_len);
+    }
     return ret;
 }
 
+void settings_audit_begin()
+{
+    setting_audit_depth++;
+}
+
+void settings_audit_end()
+{
+    if (setting_audit_depth == 0) { return; }
+    setting_audit_depth--;
+
+    /* Save the audit state once, after all the writes of the change are done */
+    if (setting_audit_depth > 0 || !setting_audit_changed) { return; }
+    setting_audit_changed = false;
+    setting_audit_count++;
+
+    uint8_t buf[8];
+    copy_from_u32(&buf[0], setting_audit_count);
+    copy_from_u32(&buf[4], setting_audit_hash);
+    if (settings_write_buffer(HEADER_AUDIT_COUNT, buf, sizeof(buf)) != HAL_OK) {
+        log_w("Unable to save settings audit state");
+    }
+}
+
+void settings_audit_record(uint32_t address, const uint8_t *data, size_t data_len)
+{
+    /*
+     * Chain the hash of the previous write with the address and
+     * contents of this write, so that the host can tell whether any
+     * changes have happened since it last read the audit state.
+     */
+    uint32_t words[2];
+    words[0] = setting_audit_hash;
+    words[1] = address;
+    uint32_t hash = HAL_CRC_Calculate(&hcrc, words, 2);
+    for (size_t i = 0; i < data_len; i += 4) {
+        uint32_t word = 0;
+        memcpy(&word, data + i, (data_len - i) < 4 ? (data_len - i) : 4);
+        hash = HAL_CRC_Accumulate(&hcrc, &word, 1);
+    }
+
+    setting_audit_hash = hash;
+    setting_audit_changed = true;
+}
+
 HAL_StatusTypeDef settings_erase_page(uint32_t address, size_t len)
 {
     HAL_StatusTypeDef ret = HAL_OK;
@@ -7,6 +7,16 @@
 
 #include "tsl2591.h"
 
+/**
+ * Version of the overall settings EEPROM schema.
+ *
+ * This must be incremented whenever the version of any settings page
+ * is changed. It is recorded in both the app descriptor and the settings
+ * header, so that firmware which would misread the stored settings
+ * can be refused before it is started.
+ */
+#define SETTINGS_SCHEMA_VERSION 10
+
 /*
  * Selections and defaults for the idle light user settings
  */
@@ -35,28 +45,101 @@ typedef struct {
     float ch1_maximum;
 } settings_cal_gain_t;
 
+/**
+ * Stages of the gain calibration process that have been completed
+ * and recorded in a checkpoint.
+ */
+typedef enum {
+    SETTING_GAIN_CAL_STAGE_NONE = 0,
+    SETTING_GAIN_CAL_STAGE_LED,
+    SETTING_GAIN_CAL_STAGE_MEDIUM,
+    SETTING_GAIN_CAL_STAGE_HIGH,
+    SETTING_GAIN_CAL_STAGE_MAX_LED,
+    SETTING_GAIN_CAL_STAGE_MAX
+} settings_gain_cal_stage_t;
+
+typedef struct {
+    settings_gain_cal_stage_t stage;
+    uint8_t measurement_brightness;
+    uint8_t max_gain_brightness;
+    float measurement_reading;  /*!< CH0 reading at measurement_brightness when it was found */
+    float max_gain_reading;     /*!< CH0 reading at max_gain_brightness when it was found */
+    float ch0_medium;
+    float ch1_medium;
+    float ch0_high;
+    float ch1_high;
+    float ch0_maximum;
+    float ch1_maximum;
+} settings_cal_gain_checkpoint_t;
+
 typedef struct {
     float b0;
     float b1;
     float b2;
 } settings_cal_slope_t;
 
+/**
+ * Die temperature recorded when each calibration was performed,
+ * along with the coefficients of the sensor's temperature response.
+ *
+ * Temperatures are in degrees Celsius, and are NaN if not recorded.
+ * The coefficients describe the relative change in sensor response as
+ * a quadratic function of the temperature offset from 25C.
+ */
+typedef struct {
+    float gain_temp;
+    float slope_temp;
+    float reflection_temp;
+    float transmission_temp;
+    float coef_a;
+    float coef_b;
+} settings_cal_temperature_t;
+
+/*
+ * The uncertainty of each target calibration point is recorded at
+ * calibration time, in density units, and is NaN if it is unknown.
+ */
 typedef struct {
     float lo_d;
     float lo_value;
     float hi_d;
     float hi_value;
+    float lo_unc;
+    float hi_unc;
 } settings_cal_reflection_t;
 
 typedef struct {
     float zero_value;
     float hi_d;
     float hi_value;
+    float hi_unc;
 } settings_cal_transmission_t;
 
+/*
+ * Limits for the stored calibration profiles
+ */
+#define SETTING_CAL_PROFILE_COUNT    4
+#define SETTING_CAL_PROFILE_NAME_LEN 11
+#define SETTING_CAL_PROFILE_NONE     UINT8_MAX
+
+/**
+ * Complete set of the calibration values that depend on the light path,
+ * stored so it can be swapped in when changing apertures or adapters.
+ *
+ * A profile with an empty name is an unused slot.
+ */
+typedef struct {
+    char name[SETTING_CAL_PROFILE_NAME_LEN + 1];
+    settings_cal_gain_t gain;
+    settings_cal_slope_t slope;
+    settings_cal_reflection_t reflection;
+    settings_cal_transmission_t transmission;
+} settings_cal_profile_t;
+
 typedef enum {
     SETTING_KEY_FORMAT_NUMBER = 0,
     SETTING_KEY_FORMAT_FULL,
+    SETTING_KEY_FORMAT_TEMPLATE,
     SETTING_KEY_FORMAT_MAX
 } setting_key_format_t;
 
@@ -75,6 +158,15 @@ typedef struct {
     setting_key_separator_t separator;
 } settings_user_usb_key_t;
 
+/*
+ * Maximum length of the saved HID output template text
+ */
+#define SETTING_HID_TEMPLATE_LEN 56
+
+typedef struct {
+    char text[SETTING_HID_TEMPLATE_LEN + 1];
+} settings_user_hid_template_t;
+
 typedef struct {
     uint8_t reflection;
     uint8_t transmission;
@@ -98,10 +190,84 @@ typedef struct {
     settings_display_unit_t unit;
 } settings_user_display_format_t;
 
+/*
+ * Default display language, which is the first language
+ * of the generated string tables.
+ */
+#define SETTING_LANGUAGE_DEFAULT 0
+
+/*
+ * Limits for the saved log level filters, which must fit within
+ * the equivalent limits of the logging library.
+ */
+#define SETTING_LOG_LEVEL_TAG_COUNT 4
+#define SETTING_LOG_LEVEL_TAG_LEN   16
+
+typedef struct {
+    char tag[SETTING_LOG_LEVEL_TAG_LEN + 1];
+    uint8_t level;
+} settings_user_log_level_tag_t;
+
+typedef struct {
+    uint8_t level;
+    settings_user_log_level_tag_t tags[SETTING_LOG_LEVEL_TAG_COUNT];
+} settings_user_log_level_t;
+
 HAL_StatusTypeDef settings_init();
 
+/**
+ * Get the settings schema version recorded in the header page.
+ *
+ * @return Schema version, or 0 if the header predates schema versioning
+ */
+uint32_t settings_get_schema_version();
+
+/**
+ * Get the settings change audit state.
+ *
+ * Every change to a user-visible calibration or settings field made
+ * after startup increments the change count once, and updates the hash
+ * by chaining the previous hash with the address and contents of each
+ * write the change made. Writes the device makes for itself, such as
+ * the gain calibration checkpoint or the calibration temperature, are
+ * not audited. Both are kept in the header page, so they reset to zero
+ * if the settings are wiped.
+ *
+ * @param count Number of settings changes
+ * @param hash Hash of the most recent settings change
+ */
+void settings_get_audit(uint32_t *count, uint32_t *hash);
+
+/**
+ * Start an audited settings change.
+ *
+ * Writes to audited fields are grouped into one change until the matching
+ * call to settings_audit_end(). Changes may be nested, in which case they
+ * are counted once when the outermost one ends.
+ */
+void settings_audit_begin();
+
+/**
+ * Finish an audited settings change, saving the audit state if any
+ * writes were made as part of it.
+ */
+void settings_audit_end();
+
 HAL_StatusTypeDef settings_wipe();
 
+/**
+ * Check the stored settings for corruption.
+ *
+ * This re-reads the header and every record protected by a CRC directly
+ * from the EEPROM, without changing the values loaded at startup.
+ * Records that have never been written are not treated as corrupt.
+ *
+ * @param failed Mask with a bit set for each record that failed its check,
+ *               with bit 0 for the header
+ * @return Number of records checked, including the header
+ */
+uint8_t settings_check_integrity(uint32_t *failed);
+
 /**
  * Set the measurement light calibration values.
  *
@@ -160,6 +326,39 @@ void settings_get_cal_gain_fields(const settings_cal_gain_t *cal_gain, tsl2591_g
  */
 bool settings_validate_cal_gain(const settings_cal_gain_t *cal_gain);
 
+/**
+ * Save a checkpoint of an in-progress gain calibration run.
+ *
+ * @param checkpoint Struct populated with values to save
+ * @return True if saved, false on error
+ */
+bool settings_set_cal_gain_checkpoint(const settings_cal_gain_checkpoint_t *checkpoint);
+
+/**
+ * Get the last saved gain calibration checkpoint.
+ * If a valid checkpoint is not available, but the provided struct is
+ * usable, it will be initialized to an empty checkpoint.
+ *
+ * @param checkpoint Struct to be populated with saved values
+ * @return True if a resumable checkpoint is returned, false otherwise.
+ */
+bool settings_get_cal_gain_checkpoint(settings_cal_gain_checkpoint_t *checkpoint);
+
+/**
+ * Discard any saved gain calibration checkpoint.
+ *
+ * @return True if cleared, false on error
+ */
+bool settings_clear_cal_gain_checkpoint();
+
+/**
+ * Check if the gain calibration checkpoint values are valid
+ *
+ * @param checkpoint Struct to validate
+ * @return True if valid, false if invalid
+ */
+bool settings_validate_cal_gain_checkpoint(const settings_cal_gain_checkpoint_t *checkpoint);
+
 /**
  * Set the slope calibration values.
  *
@@ -186,6 +385,32 @@ bool settings_get_cal_slope(settings_cal_slope_t *cal_slope);
  */
 bool settings_validate_cal_slope(const settings_cal_slope_t *cal_slope);
 
+/**
+ * Set the temperature calibration values.
+ *
+ * @param cal_temperature Struct populated with values to save
+ * @return True if saved, false on error
+ */
+bool settings_set_cal_temperature(const settings_cal_temperature_t *cal_temperature);
+
+/**
+ * Get the temperature calibration values.
+ * If a valid set of values are not available, but the provided struct is
+ * usable, default values will be returned.
+ *
+ * @param cal_temperature Struct to be populated with saved values
+ * @return True if valid values are returned, false otherwise.
+ */
+bool settings_get_cal_temperature(settings_cal_temperature_t *cal_temperature);
+
+/**
+ * Check if the temperature calibration values are valid
+ *
+ * @param cal_temperature Struct to validate
+ * @return True if valid, false if invalid
+ */
+bool settings_validate_cal_temperature(const settings_cal_temperature_t *cal_temperature);
+
 /**
  * Set the reflection density calibration values.
  *
@@ -238,6 +463,88 @@ bool settings_get_cal_transmission(settings_cal_transmission_t *cal_transmission
  */
 bool settings_validate_cal_transmission(const settings_cal_transmission_t *cal_transmission);
 
+/**
+ * Save a calibration profile into one of the profile slots.
+ *
+ * This does not change the current calibration, even if the slot
+ * is the active profile.
+ *
+ * @param index Profile slot, less than SETTING_CAL_PROFILE_COUNT
+ * @param profile Struct populated with values to save
+ * @return True if saved, false on error
+ */
+bool settings_set_cal_profile(uint8_t index, const settings_cal_profile_t *profile);
+
+/**
+ * Get the calibration profile stored in one of the profile slots.
+ *
+ * @param index Profile slot, less than SETTING_CAL_PROFILE_COUNT
+ * @param profile Struct to be populated with saved values
+ * @return True if the slot holds a valid profile, false otherwise.
+ */
+bool settings_get_cal_profile(uint8_t index, settings_cal_profile_t *profile);
+
+/**
+ * Clear one of the profile slots.
+ *
+ * @return True if cleared, false on error
+ */
+bool settings_clear_cal_profile(uint8_t index);
+
+/**
+ * Save the current calibration into one of the profile slots.
+ *
+ * @param index Profile slot, less than SETTING_CAL_PROFILE_COUNT
+ * @param name Profile name, or NULL to keep the existing name of the slot
+ * @return True if saved, false on error
+ */
+bool settings_save_cal_profile(uint8_t index, const char *name);
+
+/**
+ * Replace the current calibration with a stored profile.
+ *
+ * The calibration lock is held while the values are replaced, so that
+ * no measurement can see a mix of values from different profiles.
+ *
+ * @param index Profile slot, less than SETTING_CAL_PROFILE_COUNT
+ * @return True if the profile was applied, false on error
+ */
+bool settings_select_cal_profile(uint8_t index);
+
+/**
+ * Get the slot of the last selected calibration profile.
+ *
+ * Later changes to the current calibration are not saved back to the
+ * profile until it is saved again.
+ *
+ * @return Profile slot, or SETTING_CAL_PROFILE_NONE if none is active
+ */
+uint8_t settings_get_active_cal_profile();
+
+/**
+ * Get the name of the last selected calibration profile.
+ *
+ * @param name Buffer of at least SETTING_CAL_PROFILE_NAME_LEN + 1 bytes
+ * @return True if a profile is active, false otherwise
+ */
+bool settings_get_active_cal_profile_name(char *name);
+
+/**
+ * Check if a string is usable as a calibration profile name
+ */
+bool settings_validate_cal_profile_name(const char *name);
+
+/**
+ * Acquire the lock that keeps the current calibration from changing
+ * to a different profile while it is in use for a measurement.
+ */
+void settings_cal_lock();
+
+/**
+ * Release the lock acquired by settings_cal_lock().
+ */
+void settings_cal_unlock();
+
 /**
  * Set the user settings for the USB key output feature
  *
@@ -286,6 +593,63 @@ bool settings_set_user_display_format(const settings_user_display_format_t *disp
  */
 bool settings_get_user_display_format(settings_user_display_format_t *display_format);
 
+/**
+ * Set the user settings for the log level filters
+ *
+ * Tag entries with an empty tag are unused.
+ *
+ * @param log_level Struct populated with the values to save
+ * @return True if saved, false on error
+ */
+bool settings_set_user_log_level(const settings_user_log_level_t *log_level);
+
+/**
+ * Get the user settings for the log level filters
+ *
+ * @param log_level Struct to be populated with saved values
+ * @return True if valid values are returned, false otherwise.
+ */
+bool settings_get_user_log_level(settings_user_log_level_t *log_level);
+
+/**
+ * Set the user setting for the language of the display
+ *
+ * The language is an index into the generated string tables,
+ * and languages past the end of those tables are refused.
+ *
+ * @param language Language to save
+ * @return True if saved, false if invalid or on error
+ */
+bool settings_set_user_language(uint8_t language);
+
+/**
+ * Get the user setting for the language of the display
+ *
+ * If the saved language is not in the generated string tables,
+ * the default language is returned instead.
+ */
+uint8_t settings_get_user_language();
+
+/**
+ * Set the user settings for the HID output template
+ *
+ * The template is only used when the USB key format is set to
+ * SETTING_KEY_FORMAT_TEMPLATE, and is not validated here beyond
+ * its length and character set.
+ *
+ * @param hid_template Struct populated with the values to save
+ * @return True if saved, false on error
+ */
+bool settings_set_user_hid_template(const settings_user_hid_template_t *hid_template);
+
+/**
+ * Get the user settings for the HID output template
+ *
+ * @param hid_template Struct to be populated with saved values
+ * @return True if valid values are returned, false otherwise.
+ */
+bool settings_get_user_hid_template(settings_user_hid_template_t *hid_template);
+
 /**
  * Convenience function to get the decimal separator from the display format
  *
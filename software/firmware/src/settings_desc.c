@@ -0,0 +1,497 @@
+#include "settings_desc.h"
+
+#define LOG_TAG "settings_desc"
+#include <elog.h>
+
+#include <printf.h>
+#include <string.h>
+
+#include "settings.h"
+#include "task_usbd.h"
+
+static uint16_t idle_light_reflection_get(const settings_desc_t *desc);
+static bool idle_light_reflection_set(const settings_desc_t *desc, uint16_t value);
+static uint16_t idle_light_transmission_get(const settings_desc_t *desc);
+static bool idle_light_transmission_set(const settings_desc_t *desc, uint16_t value);
+static uint16_t idle_light_timeout_get(const settings_desc_t *desc);
+static bool idle_light_timeout_set(const settings_desc_t *desc, uint16_t value);
+static uint16_t display_separator_get(const settings_desc_t *desc);
+static bool display_separator_set(const settings_desc_t *desc, uint16_t value);
+static uint16_t display_unit_get(const settings_desc_t *desc);
+static bool display_unit_set(const settings_desc_t *desc, uint16_t value);
+static uint16_t usb_key_enabled_get(const settings_desc_t *desc);
+static bool usb_key_enabled_set(const settings_desc_t *desc, uint16_t value);
+static uint16_t usb_key_format_get(const settings_desc_t *desc);
+static bool usb_key_format_set(const settings_desc_t *desc, uint16_t value);
+static void usb_key_format_format(const settings_desc_t *desc, uint16_t value, char *buf, size_t len);
+static uint16_t usb_key_separator_get(const settings_desc_t *desc);
+static bool usb_key_separator_set(const settings_desc_t *desc, uint16_t value);
+static void usb_key_separator_format(const settings_desc_t *desc, uint16_t value, char *buf, size_t len);
+static uint16_t language_get(const settings_desc_t *desc);
+static bool language_set(const settings_desc_t *desc, uint16_t value);
+
+static const settings_desc_choice_t CHOICES_IDLE_LIGHT_REFLECTION[] = {
+    { 0,                              STR_VAL_NONE   },
+    { SETTING_IDLE_LIGHT_REFL_LOW,    STR_VAL_LOW    },
+    { SETTING_IDLE_LIGHT_REFL_MEDIUM, STR_VAL_MEDIUM },
+    { SETTING_IDLE_LIGHT_REFL_HIGH,   STR_VAL_HIGH   }
+};
+
+static const settings_desc_choice_t CHOICES_IDLE_LIGHT_TRANSMISSION[] = {
+    { 0,                              STR_VAL_NONE   },
+    { SETTING_IDLE_LIGHT_TRAN_LOW,    STR_VAL_LOW    },
+    { SETTING_IDLE_LIGHT_TRAN_MEDIUM, STR_VAL_MEDIUM },
+    { SETTING_IDLE_LIGHT_TRAN_HIGH,   STR_VAL_HIGH   }
+};
+
+static const settings_desc_choice_t CHOICES_IDLE_LIGHT_TIMEOUT[] = {
+    { 0, STR_VAL_NONE }
+};
+
+static const settings_desc_choice_t CHOICES_DISPLAY_SEPARATOR[] = {
+    { SETTING_DECIMAL_SEPARATOR_PERIOD, STR_VAL_SEP_PERIOD },
+    { SETTING_DECIMAL_SEPARATOR_COMMA,  STR_VAL_SEP_COMMA  }
+};
+
+static const settings_desc_choice_t CHOICES_DISPLAY_UNIT[] = {
+    { SETTING_DISPLAY_UNIT_DENSITY, STR_VAL_UNIT_D },
+    { SETTING_DISPLAY_UNIT_FSTOP,   STR_VAL_UNIT_F }
+};
+
+static const settings_desc_choice_t CHOICES_LANGUAGE[] = {
+    { UI_LANGUAGE_EN, STR_LANGUAGE_EN },
+    { UI_LANGUAGE_DE, STR_LANGUAGE_DE },
+    { UI_LANGUAGE_FR, STR_LANGUAGE_FR },
+    { UI_LANGUAGE_JA, STR_LANGUAGE_JA }
+};
+
+static const settings_desc_choice_t CHOICES_BOOL[] = {
+    { 0, STR_VAL_NO  },
+    { 1, STR_VAL_YES }
+};
+
+static const settings_desc_choice_t CHOICES_USB_KEY_FORMAT[] = {
+    { SETTING_KEY_FORMAT_NUMBER,   STR_VAL_NUMBER },
+    { SETTING_KEY_FORMAT_FULL,     STR_VAL_FULL   },
+    { SETTING_KEY_FORMAT_TEMPLATE, STR_VAL_CUSTOM }
+};
+
+static const settings_desc_choice_t CHOICES_USB_KEY_SEPARATOR[] = {
+    { SETTING_KEY_SEPARATOR_NONE,  STR_VAL_NONE  },
+    { SETTING_KEY_SEPARATOR_ENTER, STR_VAL_ENTER },
+    { SETTING_KEY_SEPARATOR_TAB,   STR_VAL_TAB   },
+    { SETTING_KEY_SEPARATOR_COMMA, STR_VAL_COMMA },
+    { SETTING_KEY_SEPARATOR_SPACE, STR_VAL_SPACE }
+};
+
+#define CHOICES(x) x, (sizeof(x) / sizeof(x[0]))
+
+static const settings_desc_t SETTINGS_DESCS[] = {
+    {
+        .key = "IDLE_REFL", .group = STR_TARGET_LIGHT, .label = STR_SET_IDLE_REFL,
+        .name = "Reflection idle light",
+        .type = SETTINGS_DESC_TYPE_CHOICE,
+        .choices = CHOICES(CHOICES_IDLE_LIGHT_REFLECTION),
+        .get = idle_light_reflection_get, .set = idle_light_reflection_set
+    },
+    {
+        .key = "IDLE_TRAN", .group = STR_TARGET_LIGHT, .label = STR_SET_IDLE_TRAN,
+        .name = "Transmission idle light",
+        .type = SETTINGS_DESC_TYPE_CHOICE,
+        .choices = CHOICES(CHOICES_IDLE_LIGHT_TRANSMISSION),
+        .get = idle_light_transmission_get, .set = idle_light_transmission_set
+    },
+    {
+        .key = "IDLE_TIME", .group = STR_TARGET_LIGHT, .label = STR_SET_IDLE_TIME,
+        .name = "Idle light timeout",
+        .type = SETTINGS_DESC_TYPE_RANGE,
+        .choices = CHOICES(CHOICES_IDLE_LIGHT_TIMEOUT),
+        .min = 0, .max = 240, .step = 10, .unit = "s",
+        .get = idle_light_timeout_get, .set = idle_light_timeout_set
+    },
+    {
+        .key = "DISP_SEP", .group = STR_DISPLAY_FORMAT, .label = STR_SET_DISP_SEP,
+        .name = "Decimal separator",
+        .type = SETTINGS_DESC_TYPE_CHOICE,
+        .choices = CHOICES(CHOICES_DISPLAY_SEPARATOR),
+        .get = display_separator_get, .set = display_separator_set
+    },
+    {
+        .key = "DISP_UNIT", .group = STR_DISPLAY_FORMAT, .label = STR_SET_DISP_UNIT,
+        .name = "Display units",
+        .type = SETTINGS_DESC_TYPE_CHOICE,
+        .choices = CHOICES(CHOICES_DISPLAY_UNIT),
+        .get = display_unit_get, .set = display_unit_set
+    },
+    {
+        .key = "LANGUAGE", .group = STR_DISPLAY_FORMAT, .label = STR_SET_LANGUAGE,
+        .name = "Display language",
+        .type = SETTINGS_DESC_TYPE_CHOICE,
+        .choices = CHOICES(CHOICES_LANGUAGE),
+        .get = language_get, .set = language_set
+    },
+    {
+        .key = "KEY_EN", .group = STR_USB_KEY_OUTPUT, .label = STR_SET_KEY_EN,
+        .name = "USB keyboard output",
+        .type = SETTINGS_DESC_TYPE_BOOL,
+        .choices = CHOICES(CHOICES_BOOL),
+        .get = usb_key_enabled_get, .set = usb_key_enabled_set
+    },
+    {
+        .key = "KEY_FMT", .group = STR_USB_KEY_OUTPUT, .label = STR_SET_KEY_FMT,
+        .name = "USB keyboard format",
+        .type = SETTINGS_DESC_TYPE_CHOICE,
+        .choices = CHOICES(CHOICES_USB_KEY_FORMAT),
+        .get = usb_key_format_get, .set = usb_key_format_set,
+        .format = usb_key_format_format
+    },
+    {
+        .key = "KEY_SEP", .group = STR_USB_KEY_OUTPUT, .label = STR_SET_KEY_SEP,
+        .name = "USB keyboard separator",
+        .type = SETTINGS_DESC_TYPE_CHOICE,
+        .choices = CHOICES(CHOICES_USB_KEY_SEPARATOR),
+        .get = usb_key_separator_get, .set = usb_key_separator_set,
+        .format = usb_key_separator_format
+    }
+};
+
+#define SETTINGS_DESC_COUNT (sizeof(SETTINGS_DESCS) / sizeof(SETTINGS_DESCS[0]))
+
+size_t settings_desc_count()
+{
+    return SETTINGS_DESC_COUNT;
+}
+
+const settings_desc_t *settings_desc_at(size_t index)
+{
+    if (index >= SETTINGS_DESC_COUNT) { return NULL; }
+    return &SETTINGS_DESCS[index];
+}
+
+const settings_desc_t *settings_desc_find(const char *key)
+{
+    if (!key) { return NULL; }
+
+    for (size_t i = 0; i < SETTINGS_DESC_COUNT; i++) {
+        if (strcmp(SETTINGS_DESCS[i].key, key) == 0) {
+            return &SETTINGS_DESCS[i];
+        }
+    }
+    return NULL;
+}
+
+uint16_t settings_desc_get(const settings_desc_t *desc)
+{
+    if (!desc || !desc->get) { return 0; }
+    return desc->get(desc);
+}
+
+bool settings_desc_set(const settings_desc_t *desc, uint16_t value)
+{
+    if (!desc || !desc->set) { return false; }
+
+    if (!settings_desc_is_valid(desc, value)) {
+        log_w("Invalid value for %s: %d", desc->key, value);
+        return false;
+    }
+
+    /* Setting the current value again does not change anything */
+    if (desc->get && desc->get(desc) == value) {
+        return true;
+    }
+
+    return desc->set(desc, value);
+}
+
+bool settings_desc_is_valid(const settings_desc_t *desc, uint16_t value)
+{
+    if (!desc) { return false; }
+
+    if (desc->type == SETTINGS_DESC_TYPE_RANGE) {
+        if (value < desc->min || value > desc->max) { return false; }
+        return desc->step == 0 || (value - desc->min) % desc->step == 0;
+    }
+
+    return settings_desc_value_label(desc, value) != NULL;
+}
+
+uint16_t settings_desc_next_value(const settings_desc_t *desc, uint16_t value)
+{
+    if (!desc) { return value; }
+
+    if (desc->type == SETTINGS_DESC_TYPE_RANGE) {
+        if (value < desc->min || value >= desc->max || desc->step == 0) { return desc->min; }
+
+        /* Move an unaligned value up to the next step */
+        uint16_t next = value + desc->step - ((value - desc->min) % desc->step);
+        return (next > desc->max) ? desc->max : next;
+    }
+
+    if (desc->choice_count == 0) { return value; }
+
+    for (uint8_t i = 0; i < desc->choice_count; i++) {
+        if (desc->choices[i].value == value) {
+            return desc->choices[(i + 1) % desc->choice_count].value;
+        }
+    }
+
+    /* Move an unlisted value to the next listed value above it */
+    for (uint8_t i = 0; i < desc->choice_count; i++) {
+        if (desc->choices[i].value > value) {
+            return desc->choices[i].value;
+        }
+    }
+    return desc->choices[0].value;
+}
+
+uint16_t settings_desc_prev_value(const settings_desc_t *desc, uint16_t value)
+{
+    if (!desc) { return value; }
+
+    if (desc->type == SETTINGS_DESC_TYPE_RANGE) {
+        if (value <= desc->min || value > desc->max || desc->step == 0) { return desc->max; }
+
+        /* Move an unaligned value down to the step below it */
+        uint16_t offset = (value - desc->min) % desc->step;
+        return value - (offset ? offset : desc->step);
+    }
+
+    if (desc->choice_count == 0) { return value; }
+
+    for (uint8_t i = 0; i < desc->choice_count; i++) {
+        if (desc->choices[i].value == value) {
+            return desc->choices[(i + desc->choice_count - 1) % desc->choice_count].value;
+        }
+    }
+
+    /* Move an unlisted value to the next listed value below it */
+    for (uint8_t i = desc->choice_count; i > 0; i--) {
+        if (desc->choices[i - 1].value < value) {
+            return desc->choices[i - 1].value;
+        }
+    }
+    return desc->choices[desc->choice_count - 1].value;
+}
+
+const char *settings_desc_value_label(const settings_desc_t *desc, uint16_t value)
+{
+    if (!desc) { return NULL; }
+
+    for (uint8_t i = 0; i < desc->choice_count; i++) {
+        if (desc->choices[i].value == value) {
+            return ui_str(desc->choices[i].label);
+        }
+    }
+    return NULL;
+}
+
+void settings_desc_format_value(const settings_desc_t *desc, uint16_t value, char *buf, size_t len)
+{
+    if (!buf || len == 0) { return; }
+    buf[0] = '\0';
+    if (!desc) { return; }
+
+    if (desc->format) {
+        desc->format(desc, value, buf, len);
+    } else {
+        const char *label = settings_desc_value_label(desc, value);
+        if (label) {
+            strncpy(buf, label, len);
+        } else if (desc->type == SETTINGS_DESC_TYPE_RANGE) {
+            snprintf_(buf, len, "%d%s", value, desc->unit ? desc->unit : "");
+        } else {
+            strncpy(buf, "?", len);
+        }
+    }
+    buf[len - 1] = '\0';
+}
+
+void settings_desc_format_line(const settings_desc_t *desc, char *buf)
+{
+    char value_buf[SETTINGS_DESC_LINE_SIZE];
+
+    if (!buf) { return; }
+    buf[0] = '\0';
+    if (!desc) { return; }
+
+    settings_desc_format_value(desc, settings_desc_get(desc), value_buf, sizeof(value_buf));
+
+    /*
+     * Right-align the bracketed value, keeping at least one space after the label.
+     * The menu fonts are monospaced, so this is done in character cells rather
+     * than bytes, as some characters are multi-byte or take up two cells.
+     */
+    const char *label = ui_str(desc->label);
+    int pad = (int)ui_line_columns() - (int)ui_text_columns(label) - (int)ui_text_columns(value_buf) - 2;
+    if (pad < 1) { pad = 1; }
+
+    snprintf_(buf, SETTINGS_DESC_LINE_SIZE, "%s%*s[%s]", label, pad, "", value_buf);
+}
+
+uint16_t idle_light_reflection_get(const settings_desc_t *desc)
+{
+    settings_user_idle_light_t idle_light;
+    settings_get_user_idle_light(&idle_light);
+    return idle_light.reflection;
+}
+
+bool idle_light_reflection_set(const settings_desc_t *desc, uint16_t value)
+{
+    settings_user_idle_light_t idle_light;
+    settings_get_user_idle_light(&idle_light);
+    idle_light.reflection = (uint8_t)value;
+    return settings_set_user_idle_light(&idle_light);
+}
+
+uint16_t idle_light_transmission_get(const settings_desc_t *desc)
+{
+    settings_user_idle_light_t idle_light;
+    settings_get_user_idle_light(&idle_light);
+    return idle_light.transmission;
+}
+
+bool idle_light_transmission_set(const settings_desc_t *desc, uint16_t value)
+{
+    settings_user_idle_light_t idle_light;
+    settings_get_user_idle_light(&idle_light);
+    idle_light.transmission = (uint8_t)value;
+    return settings_set_user_idle_light(&idle_light);
+}
+
+uint16_t idle_light_timeout_get(const settings_desc_t *desc)
+{
+    settings_user_idle_light_t idle_light;
+    settings_get_user_idle_light(&idle_light);
+    return idle_light.timeout;
+}
+
+bool idle_light_timeout_set(const settings_desc_t *desc, uint16_t value)
+{
+    settings_user_idle_light_t idle_light;
+    settings_get_user_idle_light(&idle_light);
+    idle_light.timeout = (uint8_t)value;
+    return settings_set_user_idle_light(&idle_light);
+}
+
+uint16_t display_separator_get(const settings_desc_t *desc)
+{
+    settings_user_display_format_t display_format;
+    settings_get_user_display_format(&display_format);
+    return display_format.separator;
+}
+
+bool display_separator_set(const settings_desc_t *desc, uint16_t value)
+{
+    settings_user_display_format_t display_format;
+    settings_get_user_display_format(&display_format);
+    display_format.separator = value;
+    return settings_set_user_display_format(&display_format);
+}
+
+uint16_t display_unit_get(const settings_desc_t *desc)
+{
+    settings_user_display_format_t display_format;
+    settings_get_user_display_format(&display_format);
+    return display_format.unit;
+}
+
+bool display_unit_set(const settings_desc_t *desc, uint16_t value)
+{
+    settings_user_display_format_t display_format;
+    settings_get_user_display_format(&display_format);
+    display_format.unit = value;
+    return settings_set_user_display_format(&display_format);
+}
+
+uint16_t usb_key_enabled_get(const settings_desc_t *desc)
+{
+    settings_user_usb_key_t usb_key;
+    settings_get_user_usb_key(&usb_key);
+    return usb_key.enabled ? 1 : 0;
+}
+
+bool usb_key_enabled_set(const settings_desc_t *desc, uint16_t value)
+{
+    settings_user_usb_key_t usb_key;
+    settings_get_user_usb_key(&usb_key);
+
+    bool enabled = value != 0;
+    if (usb_key.enabled == enabled) { return true; }
+
+    usb_key.enabled = enabled;
+    if (!settings_set_user_usb_key(&usb_key)) {
+        return false;
+    }
+
+    /* The USB descriptors change when the keyboard interface is toggled */
+    usb_device_reconnect();
+    return true;
+}
+
+uint16_t usb_key_format_get(const settings_desc_t *desc)
+{
+    settings_user_usb_key_t usb_key;
+    settings_get_user_usb_key(&usb_key);
+    return usb_key.format;
+}
+
+bool usb_key_format_set(const settings_desc_t *desc, uint16_t value)
+{
+    settings_user_usb_key_t usb_key;
+    settings_get_user_usb_key(&usb_key);
+    usb_key.format = value;
+    return settings_set_user_usb_key(&usb_key);
+}
+
+void usb_key_format_format(const settings_desc_t *desc, uint16_t value, char *buf, size_t len)
+{
+    char separator = settings_get_decimal_separator();
+
+    if (value == SETTING_KEY_FORMAT_FULL) {
+        snprintf_(buf, len, "M+#%c##%c", separator, settings_get_unit_suffix());
+    } else if (value == SETTING_KEY_FORMAT_TEMPLATE) {
+        strncpy(buf, ui_str(STR_VAL_CUSTOM), len);
+    } else {
+        snprintf_(buf, len, "#%c##", separator);
+    }
+}
+
+uint16_t usb_key_separator_get(const settings_desc_t *desc)
+{
+    settings_user_usb_key_t usb_key;
+    settings_get_user_usb_key(&usb_key);
+    return usb_key.separator;
+}
+
+bool usb_key_separator_set(const settings_desc_t *desc, uint16_t value)
+{
+    settings_user_usb_key_t usb_key;
+    settings_get_user_usb_key(&usb_key);
+    usb_key.separator = value;
+    return settings_set_user_usb_key(&usb_key);
+}
+
+void usb_key_separator_format(const settings_desc_t *desc, uint16_t value, char *buf, size_t len)
+{
+    if (usb_key_format_get(desc) == SETTING_KEY_FORMAT_TEMPLATE) {
+        /* Separators are part of the custom template */
+        strncpy(buf, ui_str(STR_VAL_NOT_APPLICABLE), len);
+    } else if (value == SETTING_KEY_SEPARATOR_COMMA) {
+        /* The separator is never the same as the decimal separator */
+        strncpy(buf, (settings_get_decimal_separator() == ',') ? ";" : ",", len);
+    } else {
+        const char *label = settings_desc_value_label(desc, value);
+        strncpy(buf, label ? label : ui_str(STR_VAL_NONE), len);
+    }
+}
+
+uint16_t language_get(const settings_desc_t *desc)
+{
+    return settings_get_user_language();
+}
+
+bool language_set(const settings_desc_t *desc, uint16_t value)
+{
+    /* The menu is redrawn in the new language as soon as this returns */
+    return settings_set_user_language((uint8_t)value);
+}
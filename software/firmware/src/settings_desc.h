@@ -0,0 +1,144 @@
+/*
+ * Descriptors for the user settings that can be changed from the
+ * device menu, so that the menu and the USB command interface can
+ * present and edit them without any setting-specific code.
+ *
+ * Each setting either has a fixed list of allowed values, with a
+ * label for each value, or is a number within a range that changes
+ * in fixed steps. Settings are grouped by the title of the menu
+ * page they appear on. Titles and labels are localized strings,
+ * which the USB command interface always presents in English.
+ */
+#ifndef SETTINGS_DESC_H
+#define SETTINGS_DESC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ui_strings.h"
+
+/**
+ * Size of a buffer for a setting line on the menu, in bytes, which
+ * leaves room for the multi-byte characters of every language.
+ */
+#define SETTINGS_DESC_LINE_SIZE 48
+
+typedef enum {
+    SETTINGS_DESC_TYPE_BOOL = 0, /*!< On/off setting, with values 0 and 1 */
+    SETTINGS_DESC_TYPE_CHOICE,   /*!< Setting chosen from a list of values */
+    SETTINGS_DESC_TYPE_RANGE     /*!< Numeric setting within a range, in fixed steps */
+} settings_desc_type_t;
+
+typedef struct {
+    uint16_t value;
+    ui_string_t label;
+} settings_desc_choice_t;
+
+typedef struct __settings_desc_t settings_desc_t;
+
+struct __settings_desc_t {
+    const char *key;   /*!< Unique key, used by the USB command interface */
+    ui_string_t group; /*!< Title of the menu page for the setting */
+    ui_string_t label; /*!< Short label shown on the menu */
+    const char *name;  /*!< Descriptive name of the setting */
+    settings_desc_type_t type;
+
+    /**
+     * Allowed values, in the order they are cycled through. For numeric
+     * settings, these are labels for any values with a special meaning.
+     */
+    const settings_desc_choice_t *choices;
+    uint8_t choice_count;
+
+    /** Range of a numeric setting, with values from min in multiples of step */
+    uint16_t min;
+    uint16_t max;
+    uint16_t step;
+    const char *unit; /*!< Unit suffix for the values of a numeric setting */
+
+    /** Get the current value of the setting */
+    uint16_t (*get)(const settings_desc_t *desc);
+
+    /** Save a new value for the setting */
+    bool (*set)(const settings_desc_t *desc, uint16_t value);
+
+    /**
+     * Optional function to format the menu label for a value, which
+     * is used when the label depends on other settings.
+     */
+    void (*format)(const settings_desc_t *desc, uint16_t value, char *buf, size_t len);
+};
+
+/**
+ * Get the number of setting descriptors.
+ */
+size_t settings_desc_count();
+
+/**
+ * Get a setting descriptor by index.
+ *
+ * @return Setting descriptor, or NULL if the index is out of range
+ */
+const settings_desc_t *settings_desc_at(size_t index);
+
+/**
+ * Find a setting descriptor by its key.
+ *
+ * @return Setting descriptor, or NULL if there is no such setting
+ */
+const settings_desc_t *settings_desc_find(const char *key);
+
+/**
+ * Get the current value of a setting.
+ */
+uint16_t settings_desc_get(const settings_desc_t *desc);
+
+/**
+ * Set and save the value of a setting.
+ *
+ * @return True if saved, false if the value is not allowed or
+ *         could not be saved
+ */
+bool settings_desc_set(const settings_desc_t *desc, uint16_t value);
+
+/**
+ * Check if a value is one of the allowed values of a setting.
+ */
+bool settings_desc_is_valid(const settings_desc_t *desc, uint16_t value);
+
+/**
+ * Get the value that follows the current value of a setting,
+ * wrapping around at the end of its list of allowed values.
+ */
+uint16_t settings_desc_next_value(const settings_desc_t *desc, uint16_t value);
+
+/**
+ * Get the value that precedes the current value of a setting,
+ * wrapping around at the start of its list of allowed values.
+ */
+uint16_t settings_desc_prev_value(const settings_desc_t *desc, uint16_t value);
+
+/**
+ * Get the label of one of the allowed values of a setting,
+ * in the current display language.
+ *
+ * @return Value label, or NULL if the value has no label
+ */
+const char *settings_desc_value_label(const settings_desc_t *desc, uint16_t value);
+
+/**
+ * Format a value of a setting as it is shown on the menu.
+ */
+void settings_desc_format_value(const settings_desc_t *desc, uint16_t value, char *buf, size_t len);
+
+/**
+ * Format the menu line for a setting, with its label on the left and
+ * its current value on the right.
+ *
+ * @param desc Setting descriptor
+ * @param buf Output buffer, of at least SETTINGS_DESC_LINE_SIZE bytes
+ */
+void settings_desc_format_line(const settings_desc_t *desc, char *buf);
+
+#endif /* SETTINGS_DESC_H */
@@ -13,6 +13,7 @@
 #include "state_main_menu.h"
 #include "state_remote.h"
 #include "state_suspend.h"
+#include "task_watchdog.h"
 
 struct __state_controller_t {
     state_identifier_t current_state;
@@ -63,6 +64,10 @@ void state_controller_loop()
             }
         }
 
+        /* Let the watchdog supervisor know the main loop is still running */
+        task_watchdog_checkin();
+        task_watchdog_set_state(state_controller.current_state);
+
         /* Call the process function for the state */
         if (state && state->state_process) {
             state->state_process(state, &state_controller);
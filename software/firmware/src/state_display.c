@@ -12,6 +12,7 @@
 #include "task_sensor.h"
 #include "densitometer.h"
 #include "settings.h"
+#include "ui_strings.h"
 #include "util.h"
 
 typedef struct {
@@ -28,7 +29,7 @@ typedef struct {
     state_identifier_t measure_state;
     state_identifier_t alternate_state;
     densitometer_t *densitometer;
-    const char *display_title;
+    ui_string_t display_title;
     display_mode_t display_mode;
 } state_display_t;
 
@@ -37,6 +38,7 @@ static void state_reflection_display_entry(state_t *state_base, state_controller
 static void state_transmission_display_entry(state_t *state_base, state_controller_t *controller, state_identifier_t prev_state);
 
 static void state_display_process(state_t *state_base, state_controller_t *controller);
+static const char *state_display_quality_title(uint8_t quality);
 
 static state_display_t state_reflection_display_data = {
     .base = {
@@ -56,7 +58,7 @@ static state_display_t state_reflection_display_data = {
     .measure_state = STATE_REFLECTION_MEASURE,
     .alternate_state = STATE_TRANSMISSION_DISPLAY,
     .densitometer = NULL,
-    .display_title = "Reflection",
+    .display_title = STR_REFLECTION,
     .display_mode = DISPLAY_MODE_REFLECTION
 };
 
@@ -78,7 +80,7 @@ static state_display_t state_transmission_display_data = {
     .measure_state = STATE_TRANSMISSION_MEASURE,
     .alternate_state = STATE_REFLECTION_DISPLAY,
     .densitometer = NULL,
-    .display_title = "Transmission",
+    .display_title = STR_TRANSMISSION,
     .display_mode = DISPLAY_MODE_TRANSMISSION
 };
 
@@ -254,10 +256,23 @@ void state_display_process(state_t *state_base, state_controller_t *controller)
             reading = densitometer_get_display_d(state->densitometer);
         }
 
+        /*
+         * Show the active calibration profile in place of the mode name,
+         * unless the reading failed its quality checks.
+         */
+        char profile_name[SETTING_CAL_PROFILE_NAME_LEN + 1];
+        const char *title = state_display_quality_title(densitometer_get_reading_quality(state->densitometer));
+        if (!title) {
+            title = ui_str(state->display_title);
+            if (settings_get_active_cal_profile_name(profile_name)) {
+                title = profile_name;
+            }
+        }
+
         char sep = settings_get_decimal_separator();
         bool has_zero = !isnanf(densitometer_get_zero_d(state->densitometer));
         display_main_elements_t elements = {
-            .title = state->display_title,
+            .title = title,
             .mode = state->display_mode,
             .density100 = ((!isnanf(reading)) ? lroundf(reading * 100) : 0),
             .decimal_sep = sep,
@@ -269,3 +284,19 @@ void state_display_process(state_t *state_base, state_controller_t *controller)
         state->display_dirty = false;
     }
 }
+
+const char *state_display_quality_title(uint8_t quality)
+{
+    /* Only the most significant problem fits in the title */
+    if (quality & SENSOR_QUALITY_LID_OPEN) {
+        return ui_str(STR_QUALITY_LID_OPEN);
+    } else if (quality & SENSOR_QUALITY_SATURATED) {
+        return ui_str(STR_QUALITY_SATURATED);
+    } else if (quality & SENSOR_QUALITY_INVALID) {
+        return ui_str(STR_QUALITY_INVALID);
+    } else if (quality & SENSOR_QUALITY_UNSTABLE) {
+        return ui_str(STR_QUALITY_MOVED);
+    } else {
+        return NULL;
+    }
+}
@@ -9,6 +9,7 @@
 #include "state_controller.h"
 #include "task_sensor.h"
 #include "display.h"
+#include "ui_strings.h"
 
 typedef struct {
     state_t base;
@@ -38,9 +39,8 @@ void state_home_process(state_t *state_base, state_controller_t *controller)
     if (state->first_run) {
         if (!sensor_is_initialized()) {
             display_message(
-                "Sensor", NULL,
-                "initialization\n"
-                "failed", " OK ");
+                ui_str(STR_SENSOR), NULL,
+                ui_str(STR_INIT_FAILED), ui_str(STR_BUTTON_OK));
         }
         state->first_run = false;
     } else {
@@ -5,81 +5,273 @@
 #include <printf.h>
 #include <math.h>
 #include <string.h>
+#include <cmsis_os.h>
 #include <elog.h>
 
 #include "display.h"
 #include "sensor.h"
 #include "light.h"
 #include "densitometer.h"
+#include "density_calc.h"
 #include "settings.h"
+#include "settings_desc.h"
+#include "ui_strings.h"
 #include "util.h"
 #include "keypad.h"
 #include "tsl2591.h"
 #include "task_sensor.h"
-#include "task_usbd.h"
 #include "sensor.h"
 #include "app_descriptor.h"
 
-extern I2C_HandleTypeDef hi2c1;
+/* Time to wait for key events while a page is polling for updates */
+#define MENU_POLL_WAIT 100
+
+/* Time to wait for the first sensor reading on the diagnostics page */
+#define DIAGNOSTICS_INIT_TIMEOUT 2000
 
 typedef enum {
-    MAIN_MENU_HOME,
-    MAIN_MENU_CALIBRATION,
-    MAIN_MENU_CALIBRATION_REFLECTION,
-    MAIN_MENU_CALIBRATION_TRANSMISSION,
-    MAIN_MENU_CALIBRATION_SENSOR_GAIN,
-    MAIN_MENU_CALIBRATION_SENSOR_SLOPE,
-    MAIN_MENU_SETTINGS,
-    MAIN_MENU_SETTINGS_IDLE_LIGHT,
-    MAIN_MENU_SETTINGS_DISPLAY_FORMAT,
-    MAIN_MENU_SETTINGS_USB_KEY,
-    MAIN_MENU_SETTINGS_DIAGNOSTICS,
-    MAIN_MENU_ABOUT
-} main_menu_state_t;
+    MENU_ITEM_SUBMENU,  /*!< List of child menu items */
+    MENU_ITEM_SETTINGS, /*!< List of the settings in the group given by the label */
+    MENU_ITEM_PAGE      /*!< Page that draws itself and handles its own key events */
+} menu_item_type_t;
 
+typedef enum {
+    MENU_KEY_NONE = 0,
+    MENU_KEY_UP,
+    MENU_KEY_DOWN,
+    MENU_KEY_SELECT,
+    MENU_KEY_BACK
+} menu_key_t;
+
+typedef struct __state_main_menu_t state_main_menu_t;
+
+/**
+ * Page of the menu that does more than list items or settings.
+ *
+ * Pages are driven by the menu state one key event at a time, and
+ * keep everything they need between events in the page state, so
+ * that the state controller is never blocked while a page is open.
+ */
 typedef struct {
+    /** Set up the page state, when the page is opened */
+    void (*enter)(state_main_menu_t *state);
+
+    /** Draw the current screen of the page */
+    void (*draw)(state_main_menu_t *state);
+
+    /** Handle a key event, including key releases */
+    void (*key)(state_main_menu_t *state, const keypad_event_t *event);
+
+    /** Optional function called on every pass while the page is open */
+    void (*poll)(state_main_menu_t *state);
+
+    /** Optional function called when the page is closed */
+    void (*leave)(state_main_menu_t *state);
+} menu_page_t;
+
+typedef struct __menu_item_t menu_item_t;
+
+struct __menu_item_t {
+    ui_string_t label;
+    ui_string_t list; /*!< Labels of the child menu items, pre-joined as one string */
+    menu_item_type_t type;
+    const menu_item_t *items;
+    uint8_t item_count;
+    const menu_page_t *page;
+};
+
+#define MENU_MAX_DEPTH 3
+
+typedef struct {
+    const menu_item_t *menu;
+    uint8_t current_pos;
+    uint8_t first_pos;
+} menu_level_t;
+
+typedef enum {
+    CAL_STEP_LIST = 0,
+    CAL_STEP_INPUT_LO,
+    CAL_STEP_INPUT_HI,
+    CAL_STEP_POSITION_LO, /*!< CAL-LO for reflection, or zero for transmission */
+    CAL_STEP_POSITION_HI
+} cal_step_t;
+
+typedef enum {
+    PROFILE_STEP_LIST = 0,
+    PROFILE_STEP_ACTION
+} profile_step_t;
+
+typedef struct {
+    const menu_page_t *page;
+    const char *title;
+    uint8_t step;        /*!< Current screen of the page */
+    uint8_t current_pos; /*!< Selected line or button of the current screen */
+    uint8_t first_pos;
+    uint16_t input_value;
+
+    /* Message shown over the page, until it is dismissed */
+    bool show_message;
+    bool close_on_message; /*!< Close the page once the message is dismissed */
+    const char *message_title;
+    ui_string_t message;
+
+    union {
+        struct {
+            settings_cal_reflection_t cal;
+            float lo_value_unc;
+            float hi_value_unc;
+        } reflection;
+        struct {
+            settings_cal_transmission_t cal;
+            float zero_value_unc;
+            float hi_value_unc;
+        } transmission;
+        struct {
+            uint8_t index;
+            uint8_t button_count;
+            char title[32];
+        } profiles;
+        struct {
+            tsl2591_gain_t gain;
+            tsl2591_time_t time;
+            uint8_t light_mode;
+            bool display_mode;
+            bool config_changed;
+            bool started;
+            uint32_t start_ticks;
+        } diagnostics;
+        const settings_desc_t *setting;
+    };
+
+    char buf[192]; /*!< Text of the current screen */
+} menu_page_state_t;
+
+struct __state_main_menu_t {
     state_t base;
-    uint8_t home_option;
-    uint8_t cal_option;
-    uint8_t cal_sub_option;
-    uint8_t settings_option;
-    uint8_t settings_sub_option;
-    main_menu_state_t menu_state;
-} state_main_menu_t;
+    menu_level_t levels[MENU_MAX_DEPTH];
+    uint8_t depth;
+    bool display_dirty;
+    uint32_t timeout_ticks;
+    menu_page_state_t page;
+};
 
 static void state_main_menu_entry(state_t *state_base, state_controller_t *controller, state_identifier_t prev_state);
 static void state_main_menu_process(state_t *state_base, state_controller_t *controller);
+static void state_main_menu_exit(state_t *state_base, state_controller_t *controller, state_identifier_t next_state);
 static state_main_menu_t state_main_menu_data = {
     .base = {
         .state_entry = state_main_menu_entry,
         .state_process = state_main_menu_process,
-        .state_exit = NULL
+        .state_exit = state_main_menu_exit
     },
-    .home_option = 1,
-    .cal_option = 1,
-    .cal_sub_option = 1,
-    .settings_option = 1,
-    .settings_sub_option = 1,
-    .menu_state = MAIN_MENU_HOME
+    .depth = 0,
+    .display_dirty = false,
+    .timeout_ticks = 0
 };
 
-static void main_menu_home(state_main_menu_t *state, state_controller_t *controller);
-static void main_menu_calibration(state_main_menu_t *state, state_controller_t *controller);
-static void main_menu_calibration_reflection(state_main_menu_t *state, state_controller_t *controller);
-static void main_menu_calibration_transmission(state_main_menu_t *state, state_controller_t *controller);
-static void main_menu_calibration_sensor_gain(state_main_menu_t *state, state_controller_t *controller);
-static void main_menu_calibration_sensor_slope(state_main_menu_t *state, state_controller_t *controller);
-static void main_menu_settings(state_main_menu_t *state, state_controller_t *controller);
-static void main_menu_settings_idle_light(state_main_menu_t *state, state_controller_t *controller);
-static void main_menu_settings_display_format(state_main_menu_t *state, state_controller_t *controller);
-static void main_menu_settings_usb_key(state_main_menu_t *state, state_controller_t *controller);
-static void main_menu_settings_diagnostics(state_main_menu_t *state, state_controller_t *controller);
-static void main_menu_about(state_main_menu_t *state, state_controller_t *controller);
+static void cal_reflection_enter(state_main_menu_t *state);
+static void cal_reflection_draw(state_main_menu_t *state);
+static void cal_reflection_key(state_main_menu_t *state, const keypad_event_t *event);
+static void cal_transmission_enter(state_main_menu_t *state);
+static void cal_transmission_draw(state_main_menu_t *state);
+static void cal_transmission_key(state_main_menu_t *state, const keypad_event_t *event);
+static void sensor_gain_enter(state_main_menu_t *state);
+static void sensor_slope_enter(state_main_menu_t *state);
+static void text_list_draw(state_main_menu_t *state);
+static void text_list_key(state_main_menu_t *state, const keypad_event_t *event);
+static void profiles_enter(state_main_menu_t *state);
+static void profiles_draw(state_main_menu_t *state);
+static void profiles_key(state_main_menu_t *state, const keypad_event_t *event);
+static void diagnostics_enter(state_main_menu_t *state);
+static void diagnostics_draw(state_main_menu_t *state);
+static void diagnostics_key(state_main_menu_t *state, const keypad_event_t *event);
+static void diagnostics_poll(state_main_menu_t *state);
+static void diagnostics_leave(state_main_menu_t *state);
+static void about_enter(state_main_menu_t *state);
+static void about_draw(state_main_menu_t *state);
+static void about_key(state_main_menu_t *state, const keypad_event_t *event);
+static void setting_edit_enter(state_main_menu_t *state);
+static void setting_edit_draw(state_main_menu_t *state);
+static void setting_edit_key(state_main_menu_t *state, const keypad_event_t *event);
 static void sensor_read_callback(void *user_data);
 
+static const menu_page_t PAGE_CAL_REFLECTION = {
+    .enter = cal_reflection_enter, .draw = cal_reflection_draw, .key = cal_reflection_key
+};
+
+static const menu_page_t PAGE_CAL_TRANSMISSION = {
+    .enter = cal_transmission_enter, .draw = cal_transmission_draw, .key = cal_transmission_key
+};
+
+static const menu_page_t PAGE_SENSOR_GAIN = {
+    .enter = sensor_gain_enter, .draw = text_list_draw, .key = text_list_key
+};
+
+static const menu_page_t PAGE_SENSOR_SLOPE = {
+    .enter = sensor_slope_enter, .draw = text_list_draw, .key = text_list_key
+};
+
+static const menu_page_t PAGE_PROFILES = {
+    .enter = profiles_enter, .draw = profiles_draw, .key = profiles_key
+};
+
+static const menu_page_t PAGE_DIAGNOSTICS = {
+    .enter = diagnostics_enter, .draw = diagnostics_draw, .key = diagnostics_key,
+    .poll = diagnostics_poll, .leave = diagnostics_leave
+};
+
+static const menu_page_t PAGE_ABOUT = {
+    .enter = about_enter, .draw = about_draw, .key = about_key
+};
+
+static const menu_page_t PAGE_SETTING_EDIT = {
+    .enter = setting_edit_enter, .draw = setting_edit_draw, .key = setting_edit_key
+};
+
+#define MENU_ITEMS(x) x, (sizeof(x) / sizeof(x[0]))
+
+static const menu_item_t MENU_CALIBRATION[] = {
+    { .label = STR_REFLECTION,   .type = MENU_ITEM_PAGE, .page = &PAGE_CAL_REFLECTION },
+    { .label = STR_TRANSMISSION, .type = MENU_ITEM_PAGE, .page = &PAGE_CAL_TRANSMISSION },
+    { .label = STR_SENSOR_GAIN,  .type = MENU_ITEM_PAGE, .page = &PAGE_SENSOR_GAIN },
+    { .label = STR_SENSOR_SLOPE, .type = MENU_ITEM_PAGE, .page = &PAGE_SENSOR_SLOPE },
+    { .label = STR_PROFILES,     .type = MENU_ITEM_PAGE, .page = &PAGE_PROFILES }
+};
+
+static const menu_item_t MENU_SETTINGS[] = {
+    { .label = STR_TARGET_LIGHT,   .type = MENU_ITEM_SETTINGS },
+    { .label = STR_DISPLAY_FORMAT, .type = MENU_ITEM_SETTINGS },
+    { .label = STR_USB_KEY_OUTPUT, .type = MENU_ITEM_SETTINGS },
+    { .label = STR_DIAGNOSTICS,    .type = MENU_ITEM_PAGE, .page = &PAGE_DIAGNOSTICS }
+};
+
+static const menu_item_t MENU_HOME[] = {
+    { .label = STR_CALIBRATION, .list = STR_MENU_CALIBRATION, .type = MENU_ITEM_SUBMENU, .items = MENU_ITEMS(MENU_CALIBRATION) },
+    { .label = STR_SETTINGS,    .list = STR_MENU_SETTINGS,    .type = MENU_ITEM_SUBMENU, .items = MENU_ITEMS(MENU_SETTINGS) },
+    { .label = STR_ABOUT,                                     .type = MENU_ITEM_PAGE,    .page = &PAGE_ABOUT }
+};
+
+static const menu_item_t MENU_ROOT = {
+    .label = STR_MAIN_MENU, .list = STR_MENU_HOME, .type = MENU_ITEM_SUBMENU, .items = MENU_ITEMS(MENU_HOME)
+};
+
+static uint8_t main_menu_item_count(const menu_item_t *menu);
+static const settings_desc_t *main_menu_settings_desc(const menu_item_t *menu, uint8_t pos);
+static void main_menu_draw(state_main_menu_t *state);
+static void main_menu_select(state_main_menu_t *state);
+static void main_menu_back(state_main_menu_t *state, state_controller_t *controller);
+static void main_menu_open_page(state_main_menu_t *state, const menu_page_t *page);
+static void main_menu_close_page(state_main_menu_t *state);
+static void main_menu_show_message(state_main_menu_t *state, const char *title, ui_string_t message, bool close);
+static menu_key_t main_menu_key(const keypad_event_t *event);
+static void main_menu_move(uint8_t *current_pos, uint8_t count, menu_key_t key);
+static void main_menu_step_value(uint16_t *value, uint16_t lo, uint16_t hi, menu_key_t key);
+
 #define DENSITY_BUF_SIZE 5
 
 static void format_density_value(char *buf, float value);
+static void format_input_value(char *buf, uint16_t value);
+static uint8_t count_lines(const char *buf);
 
 state_t *state_main_menu()
 {
@@ -89,444 +281,593 @@ state_t *state_main_menu()
 void state_main_menu_entry(state_t *state_base, state_controller_t *controller, state_identifier_t prev_state)
 {
     state_main_menu_t *state = (state_main_menu_t *)state_base;
-    state->home_option = 1;
-    state->cal_option = 1;
-    state->cal_sub_option = 1;
-    state->settings_option = 1;
-    state->settings_sub_option = 1;
-    state->menu_state = MAIN_MENU_HOME;
+    log_i("Main Menu");
+
+    sensor_set_light_mode(SENSOR_LIGHT_OFF, false, 0);
+    keypad_clear_events();
+
+    state->levels[0].menu = &MENU_ROOT;
+    state->levels[0].current_pos = 0;
+    state->levels[0].first_pos = 0;
+    state->depth = 1;
+    state->page.page = NULL;
+    state->display_dirty = true;
+    state->timeout_ticks = osKernelGetTickCount() + MENU_TIMEOUT_MS;
 }
 
 void state_main_menu_process(state_t *state_base, state_controller_t *controller)
 {
     state_main_menu_t *state = (state_main_menu_t *)state_base;
+    const menu_page_t *page = state->page.page;
 
-    sensor_set_light_mode(SENSOR_LIGHT_OFF, false, 0);
+    if (page && page->poll && !state->page.show_message) {
+        page->poll(state);
+    }
 
-    if (state->menu_state == MAIN_MENU_HOME) {
-        main_menu_home(state, controller);
-    } else if (state->menu_state == MAIN_MENU_CALIBRATION) {
-        main_menu_calibration(state, controller);
-    } else if (state->menu_state == MAIN_MENU_CALIBRATION_REFLECTION) {
-        main_menu_calibration_reflection(state, controller);
-    } else if (state->menu_state == MAIN_MENU_CALIBRATION_TRANSMISSION) {
-        main_menu_calibration_transmission(state, controller);
-    } else if (state->menu_state == MAIN_MENU_CALIBRATION_SENSOR_GAIN) {
-        main_menu_calibration_sensor_gain(state, controller);
-    } else if (state->menu_state == MAIN_MENU_CALIBRATION_SENSOR_SLOPE) {
-        main_menu_calibration_sensor_slope(state, controller);
-    } else if (state->menu_state == MAIN_MENU_SETTINGS) {
-        main_menu_settings(state, controller);
-    } else if (state->menu_state == MAIN_MENU_SETTINGS_IDLE_LIGHT) {
-        main_menu_settings_idle_light(state, controller);
-    } else if (state->menu_state == MAIN_MENU_SETTINGS_DISPLAY_FORMAT) {
-        main_menu_settings_display_format(state, controller);
-    } else if (state->menu_state == MAIN_MENU_SETTINGS_USB_KEY) {
-        main_menu_settings_usb_key(state, controller);
-    } else if (state->menu_state == MAIN_MENU_SETTINGS_DIAGNOSTICS) {
-        main_menu_settings_diagnostics(state, controller);
-    } else if (state->menu_state == MAIN_MENU_ABOUT) {
-        main_menu_about(state, controller);
+    if (state->display_dirty) {
+        main_menu_draw(state);
+        state->display_dirty = false;
+    }
+
+    /*
+     * Wait for a single key event and return, rather than blocking within
+     * the menu, so that the state controller can still respond to
+     * state changes requested from elsewhere.
+     */
+    keypad_event_t keypad_event;
+    uint32_t wait = (page && page->poll) ? MENU_POLL_WAIT : STATE_KEYPAD_WAIT;
+    if (keypad_wait_for_event(&keypad_event, wait) == osOK) {
+        state->timeout_ticks = osKernelGetTickCount() + MENU_TIMEOUT_MS;
+
+        if (keypad_event.pressed && keypad_event.key == KEYPAD_FORCE_TIMEOUT) {
+            state_controller_set_next_state(controller, STATE_HOME);
+            return;
+        }
+
+        menu_key_t key = main_menu_key(&keypad_event);
+
+        if (page && state->page.show_message) {
+            /* Any button dismisses the message, as it only has one */
+            if (key == MENU_KEY_SELECT || key == MENU_KEY_BACK) {
+                state->page.show_message = false;
+                if (state->page.close_on_message) {
+                    main_menu_close_page(state);
+                }
+                state->display_dirty = true;
+            }
+            return;
+        } else if (page) {
+            page->key(state, &keypad_event);
+            state->display_dirty = true;
+            return;
+        }
+
+        menu_level_t *level = &state->levels[state->depth - 1];
+
+        switch (key) {
+        case MENU_KEY_UP:
+        case MENU_KEY_DOWN:
+            main_menu_move(&level->current_pos, main_menu_item_count(level->menu), key);
+            state->display_dirty = true;
+            break;
+        case MENU_KEY_SELECT:
+            main_menu_select(state);
+            break;
+        case MENU_KEY_BACK:
+            main_menu_back(state, controller);
+            break;
+        default:
+            break;
+        }
+    } else if (TIME_AFTER(osKernelGetTickCount(), state->timeout_ticks)) {
+        state_controller_set_next_state(controller, STATE_HOME);
     }
 }
 
-void main_menu_home(state_main_menu_t *state, state_controller_t *controller)
+void state_main_menu_exit(state_t *state_base, state_controller_t *controller, state_identifier_t next_state)
 {
-    log_i("Main Menu");
-    state->home_option = display_selection_list(
-        "Main Menu", state->home_option,
-        "Calibration\n"
-        "Settings\n"
-        "About");
-
-    if (state->home_option == 1) {
-        state->menu_state = MAIN_MENU_CALIBRATION;
-    } else if (state->home_option == 2) {
-        state->menu_state = MAIN_MENU_SETTINGS;
-    } else if (state->home_option == 3) {
-        state->menu_state = MAIN_MENU_ABOUT;
-    } else {
-        state_controller_set_next_state(controller, STATE_HOME);
+    state_main_menu_t *state = (state_main_menu_t *)state_base;
+
+    /* Let an open page clean up, if the menu is left from within it */
+    if (state->page.page) {
+        main_menu_close_page(state);
     }
 }
 
-void main_menu_calibration(state_main_menu_t *state, state_controller_t *controller)
+uint8_t main_menu_item_count(const menu_item_t *menu)
 {
-    state->cal_option = display_selection_list(
-        "Calibration", state->cal_option,
-        "Reflection\n"
-        "Transmission\n"
-        "Sensor Gain\n"
-        "Sensor Slope");
-
-    if (state->cal_option == 1) {
-        state->menu_state = MAIN_MENU_CALIBRATION_REFLECTION;
-    } else if (state->cal_option == 2) {
-        state->menu_state = MAIN_MENU_CALIBRATION_TRANSMISSION;
-    } else if (state->cal_option == 3) {
-        state->menu_state = MAIN_MENU_CALIBRATION_SENSOR_GAIN;
-    } else if (state->cal_option == 4) {
-        state->menu_state = MAIN_MENU_CALIBRATION_SENSOR_SLOPE;
-    } else if (state->cal_option == UINT8_MAX) {
-        state_controller_set_next_state(controller, STATE_HOME);
+    if (menu->type == MENU_ITEM_SETTINGS) {
+        uint8_t count = 0;
+        for (size_t i = 0; i < settings_desc_count(); i++) {
+            if (settings_desc_at(i)->group == menu->label) {
+                count++;
+            }
+        }
+        return count;
     } else {
-        state->menu_state = MAIN_MENU_HOME;
-        state->cal_option = 1;
+        return menu->item_count;
     }
 }
 
-void main_menu_calibration_reflection(state_main_menu_t *state, state_controller_t *controller)
+const settings_desc_t *main_menu_settings_desc(const menu_item_t *menu, uint8_t pos)
 {
-    char buf[128];
-    char buf_lo[DENSITY_BUF_SIZE];
-    char buf_hi[DENSITY_BUF_SIZE];
-    settings_cal_reflection_t cal_reflection;
-    uint8_t option = 1;
+    for (size_t i = 0; i < settings_desc_count(); i++) {
+        const settings_desc_t *desc = settings_desc_at(i);
+        if (desc->group == menu->label) {
+            if (pos == 0) {
+                return desc;
+            }
+            pos--;
+        }
+    }
+    return NULL;
+}
 
-    char sep = settings_get_decimal_separator();
-    settings_get_cal_reflection(&cal_reflection);
+void main_menu_draw(state_main_menu_t *state)
+{
+    if (state->page.page && state->page.show_message) {
+        display_draw_message(state->page.message_title, NULL,
+            ui_str(state->page.message), ui_str(STR_BUTTON_OK), 0);
+        return;
+    } else if (state->page.page) {
+        state->page.page->draw(state);
+        return;
+    }
 
-    do {
-        format_density_value(buf_lo, cal_reflection.lo_d);
-        format_density_value(buf_hi, cal_reflection.hi_d);
+    menu_level_t *level = &state->levels[state->depth - 1];
 
-        sprintf_(buf,
-            "CAL-LO  [%s]\n"
-            "CAL-HI  [%s]\n"
-            "** Measure **",
-            buf_lo, buf_hi);
+    if (level->menu->type != MENU_ITEM_SETTINGS) {
+        /* Submenus have their item labels stored as a single string */
+        display_draw_selection_list(ui_str(level->menu->label), ui_str(level->menu->list),
+            level->current_pos, &level->first_pos);
+        return;
+    }
 
-        option = display_selection_list(
-            "Reflection", option, buf);
+    char buf[192];
+    size_t offset = 0;
+    uint8_t item_count = main_menu_item_count(level->menu);
+
+    buf[0] = '\0';
+    for (uint8_t i = 0; i < item_count; i++) {
+        if (offset + SETTINGS_DESC_LINE_SIZE + 1 > sizeof(buf)) { break; }
+        if (i > 0) {
+            buf[offset++] = '\n';
+        }
+        settings_desc_format_line(main_menu_settings_desc(level->menu, i), buf + offset);
+        offset += strlen(buf + offset);
+    }
 
-        if (option == 1) {
-            uint16_t working_value;
-            if (is_valid_number(cal_reflection.lo_d) && cal_reflection.lo_d >= 0.0F) {
-                working_value = lroundf(cal_reflection.lo_d * 100);
-            } else {
-                working_value = 8;
-            }
+    display_draw_selection_list(ui_str(level->menu->label), buf, level->current_pos, &level->first_pos);
+}
 
-            uint8_t input_option = display_input_value_f1_2(
-                "CAL-LO (White)\n",
-                "D=", &working_value,
-                0, 250, sep, NULL);
-            if (input_option == 1) {
-                cal_reflection.lo_d = working_value / 100.0F;
-            } else if (input_option == UINT8_MAX) {
-                option = UINT8_MAX;
+void main_menu_select(state_main_menu_t *state)
+{
+    menu_level_t *level = &state->levels[state->depth - 1];
+
+    if (level->menu->type == MENU_ITEM_SETTINGS) {
+        const settings_desc_t *desc = main_menu_settings_desc(level->menu, level->current_pos);
+        if (desc && desc->type == SETTINGS_DESC_TYPE_RANGE) {
+            /* Numeric settings have too many values to cycle through in place */
+            state->page.setting = desc;
+            main_menu_open_page(state, &PAGE_SETTING_EDIT);
+        } else if (desc) {
+            uint16_t value = settings_desc_next_value(desc, settings_desc_get(desc));
+            if (!settings_desc_set(desc, value)) {
+                log_w("Unable to set %s", desc->key);
             }
+        }
+    } else if (level->current_pos < level->menu->item_count) {
+        const menu_item_t *item = &level->menu->items[level->current_pos];
+        if (item->type == MENU_ITEM_PAGE && item->page) {
+            main_menu_open_page(state, item->page);
+        } else if (item->type != MENU_ITEM_PAGE && state->depth < MENU_MAX_DEPTH) {
+            menu_level_t *next_level = &state->levels[state->depth++];
+            next_level->menu = item;
+            next_level->current_pos = 0;
+            next_level->first_pos = 0;
+        }
+    }
 
-        } else if (option == 2) {
-            uint16_t working_value;
-            if (is_valid_number(cal_reflection.hi_d) && cal_reflection.hi_d >= 0.0F) {
-                working_value = lroundf(cal_reflection.hi_d * 100);
-            } else {
-                working_value = 150;
-            }
+    state->display_dirty = true;
+}
 
-            uint8_t input_option = display_input_value_f1_2(
-                "CAL-HI (Black)\n",
-                "D=", &working_value,
-                0, 250, sep, NULL);
-            if (input_option == 1) {
-                cal_reflection.hi_d = working_value / 100.0F;
-            } else if (input_option == UINT8_MAX) {
-                option = UINT8_MAX;
-            }
+void main_menu_back(state_main_menu_t *state, state_controller_t *controller)
+{
+    if (state->depth > 1) {
+        state->depth--;
+        state->display_dirty = true;
+    } else {
+        state_controller_set_next_state(controller, STATE_HOME);
+    }
+}
 
-        } else if (option == 3) {
-            densitometer_result_t meas_result = DENSITOMETER_OK;
-            bool cal_saved = false;
-            uint8_t meas_option = 1;
-            display_main_elements_t elements = {
-                .title = "Calibrating...",
-                .mode = DISPLAY_MODE_REFLECTION,
-                .density100 = 0,
-                .decimal_sep = sep,
-                .frame = 0
-            };
-
-            do {
-                /* Validate the target densities, just in case */
-                if (!is_valid_number(cal_reflection.lo_d) || !is_valid_number(cal_reflection.hi_d)) {
-                    meas_result = DENSITOMETER_CAL_ERROR;
-                    break;
-                }
-                if (cal_reflection.lo_d < 0.00F || cal_reflection.lo_d > REFLECTION_MAX_D) {
-                    meas_result = DENSITOMETER_CAL_ERROR;
-                    break;
-                }
-                if (cal_reflection.hi_d < 0.00F || cal_reflection.hi_d > REFLECTION_MAX_D) {
-                    meas_result = DENSITOMETER_CAL_ERROR;
-                    break;
-                }
-                if (cal_reflection.lo_d >= cal_reflection.hi_d) {
-                    meas_result = DENSITOMETER_CAL_ERROR;
-                    break;
-                }
+void main_menu_open_page(state_main_menu_t *state, const menu_page_t *page)
+{
+    menu_page_state_t *page_state = &state->page;
+    page_state->page = page;
+    page_state->step = 0;
+    page_state->current_pos = 0;
+    page_state->first_pos = 0;
+    page_state->show_message = false;
+    page_state->close_on_message = false;
+    page_state->buf[0] = '\0';
+
+    page->enter(state);
+    state->display_dirty = true;
+}
 
-                /* Activate the idle light at default brightness */
-                sensor_set_light_mode(SENSOR_LIGHT_REFLECTION, false, SETTING_IDLE_LIGHT_REFL_DEFAULT);
-
-                do {
-                    meas_option = display_message(
-                        "Position\n"
-                        "CAL-LO firmly\n"
-                        "under sensor",
-                        NULL, NULL, " Measure ");
-                } while (!keypad_is_detect() && meas_option != 0 && meas_option != UINT8_MAX);
-
-                if (meas_option == 1) {
-                    densitometer_t *densitometer = densitometer_reflection();
-                    elements.density100 = lroundf(cal_reflection.lo_d * 100);
-                    elements.frame = 0;
-                    display_draw_main_elements(&elements);
-                    meas_result = densitometer_calibrate(densitometer, &(cal_reflection.lo_value), sensor_read_callback, &elements);
-                } else {
-                    break;
-                }
-                if (meas_result != DENSITOMETER_OK) { break; }
-
-                /* Activate the idle light at default brightness */
-                sensor_set_light_mode(SENSOR_LIGHT_REFLECTION, false, SETTING_IDLE_LIGHT_REFL_DEFAULT);
-
-                do {
-                    meas_option = display_message(
-                        "Position\n"
-                        "CAL-HI firmly\n"
-                        "under sensor",
-                        NULL, NULL, " Measure ");
-                } while (!keypad_is_detect() && meas_option != 0 && meas_option != UINT8_MAX);
-
-                if (meas_option == 1) {
-                    densitometer_t *densitometer = densitometer_reflection();
-                    elements.density100 = lroundf(cal_reflection.hi_d * 100);
-                    elements.frame = 0;
-                    display_draw_main_elements(&elements);
-                    meas_result = densitometer_calibrate(densitometer, &(cal_reflection.hi_value), sensor_read_callback, &elements);
-                } else {
-                    break;
-                }
-                if (meas_result != DENSITOMETER_OK) { break; }
+void main_menu_close_page(state_main_menu_t *state)
+{
+    const menu_page_t *page = state->page.page;
+    if (page && page->leave) {
+        page->leave(state);
+    }
+    state->page.page = NULL;
 
-                if (!settings_validate_cal_reflection(&cal_reflection)) {
-                    log_w("Unable to validate cal data");
-                    cal_saved = false;
-                    break;
-                }
+    /* Restore the menu conditions, in case the page changed them */
+    sensor_set_light_mode(SENSOR_LIGHT_OFF, false, 0);
+    state->display_dirty = true;
+}
 
-                if (!settings_set_cal_reflection(&cal_reflection)) {
-                    log_w("Unable to save cal data");
-                    cal_saved = false;
-                    break;
-                }
-                cal_saved = true;
-            } while (0);
+void main_menu_show_message(state_main_menu_t *state, const char *title, ui_string_t message, bool close)
+{
+    state->page.show_message = true;
+    state->page.close_on_message = close;
+    state->page.message_title = title;
+    state->page.message = message;
+    state->display_dirty = true;
+}
 
-            if (meas_option == UINT8_MAX) {
-                option = UINT8_MAX;
-                break;
-            } else if (meas_option == 0) {
-                display_message(
-                    "Reflection", NULL,
-                    "calibration\n"
-                    "canceled", " OK ");
-                break;
-            } else if (!cal_saved) {
-                display_message(
-                    "Reflection", NULL,
-                    "Unable\n"
-                    "to save", " OK ");
-            } else if (meas_result == DENSITOMETER_OK) {
-                display_message(
-                    "Reflection", NULL,
-                    "calibration\n"
-                    "complete", " OK ");
-                break;
-            } else if (meas_result == DENSITOMETER_CAL_ERROR) {
-                display_message(
-                    "Reflection", NULL,
-                    "calibration\n"
-                    "values invalid", " OK ");
-            } else if (meas_result == DENSITOMETER_SENSOR_ERROR) {
-                display_message(
-                    "Reflection", NULL,
-                    "calibration\n"
-                    "failed", " OK ");
-            }
-        }
-    } while (option > 0 && option != UINT8_MAX);
+menu_key_t main_menu_key(const keypad_event_t *event)
+{
+    if (!event->pressed) { return MENU_KEY_NONE; }
+
+    switch (event->key) {
+    case KEYPAD_BUTTON_UP:
+        return MENU_KEY_UP;
+    case KEYPAD_BUTTON_DOWN:
+        return MENU_KEY_DOWN;
+    case KEYPAD_BUTTON_ACTION:
+        return MENU_KEY_SELECT;
+    case KEYPAD_BUTTON_MENU:
+        return MENU_KEY_BACK;
+    default:
+        return MENU_KEY_NONE;
+    }
+}
 
-    if (option == UINT8_MAX) {
-        state_controller_set_next_state(controller, STATE_HOME);
+void main_menu_move(uint8_t *current_pos, uint8_t count, menu_key_t key)
+{
+    if (count == 0) { return; }
+
+    if (key == MENU_KEY_UP) {
+        *current_pos = (*current_pos > 0) ? (*current_pos - 1) : (count - 1);
+    } else if (key == MENU_KEY_DOWN) {
+        *current_pos = (*current_pos + 1 < count) ? (*current_pos + 1) : 0;
+    }
+}
+
+void main_menu_step_value(uint16_t *value, uint16_t lo, uint16_t hi, menu_key_t key)
+{
+    if (key == MENU_KEY_UP) {
+        *value = (*value >= hi) ? lo : (*value + 1);
+    } else if (key == MENU_KEY_DOWN) {
+        *value = (*value <= lo) ? hi : (*value - 1);
+    }
+}
+
+static void cal_measure(densitometer_t *densitometer,
+    display_mode_t mode, float target_d, float *cal_value, float *cal_value_unc,
+    densitometer_result_t *result)
+{
+    display_main_elements_t elements = {
+        .title = ui_str(STR_CALIBRATING),
+        .mode = mode,
+        .density100 = lroundf(target_d * 100),
+        .decimal_sep = settings_get_decimal_separator(),
+        .frame = 0
+    };
+
+    /*
+     * The measurement itself still runs to completion here, as it is a
+     * single sensor operation that animates the display as it goes.
+     */
+    display_draw_main_elements(&elements);
+    *result = densitometer_calibrate(densitometer, cal_value, cal_value_unc, sensor_read_callback, &elements);
+}
+
+static void cal_finish(state_main_menu_t *state, const char *title, densitometer_result_t result, bool saved)
+{
+    sensor_set_light_mode(SENSOR_LIGHT_OFF, false, 0);
+    state->page.step = CAL_STEP_LIST;
+
+    if (result == DENSITOMETER_CAL_ERROR) {
+        main_menu_show_message(state, title, STR_CAL_VALUES_INVALID, false);
+    } else if (result != DENSITOMETER_OK) {
+        main_menu_show_message(state, title, STR_CAL_FAILED, false);
+    } else if (!saved) {
+        main_menu_show_message(state, title, STR_UNABLE_TO_SAVE, false);
     } else {
-        state->menu_state = MAIN_MENU_CALIBRATION;
+        main_menu_show_message(state, title, STR_CAL_COMPLETE, true);
     }
 }
 
-void main_menu_calibration_transmission(state_main_menu_t *state, state_controller_t *controller)
+static void cal_cancel(state_main_menu_t *state, const char *title)
 {
-    char buf[128];
-    char buf_hi[DENSITY_BUF_SIZE];
-    settings_cal_transmission_t cal_transmission;
-    uint8_t option = 1;
+    sensor_set_light_mode(SENSOR_LIGHT_OFF, false, 0);
+    state->page.step = CAL_STEP_LIST;
+    main_menu_show_message(state, title, STR_CAL_CANCELED, true);
+}
 
-    char sep = settings_get_decimal_separator();
-    settings_get_cal_transmission(&cal_transmission);
+static uint16_t cal_input_start(float value, uint16_t default_value)
+{
+    if (is_valid_number(value) && value >= 0.0F) {
+        return lroundf(value * 100);
+    } else {
+        return default_value;
+    }
+}
 
-    do {
-        format_density_value(buf_hi, cal_transmission.hi_d);
+void cal_reflection_enter(state_main_menu_t *state)
+{
+    settings_get_cal_reflection(&state->page.reflection.cal);
+    state->page.reflection.lo_value_unc = NAN;
+    state->page.reflection.hi_value_unc = NAN;
+}
+
+void cal_reflection_draw(state_main_menu_t *state)
+{
+    menu_page_state_t *page = &state->page;
+    char buf_lo[DENSITY_BUF_SIZE];
+    char buf_hi[DENSITY_BUF_SIZE];
 
-        sprintf_(buf,
+    switch (page->step) {
+    case CAL_STEP_LIST:
+        format_density_value(buf_lo, page->reflection.cal.lo_d);
+        format_density_value(buf_hi, page->reflection.cal.hi_d);
+        sprintf_(page->buf,
+            "CAL-LO  [%s]\n"
             "CAL-HI  [%s]\n"
-            "** Measure **",
-            buf_hi);
+            "%s",
+            buf_lo, buf_hi, ui_str(STR_MEASURE));
+        display_draw_selection_list(ui_str(STR_REFLECTION), page->buf, page->current_pos, &page->first_pos);
+        break;
+    case CAL_STEP_INPUT_LO:
+    case CAL_STEP_INPUT_HI:
+        format_input_value(page->buf, page->input_value);
+        display_draw_input_value(
+            ui_str((page->step == CAL_STEP_INPUT_LO) ? STR_CAL_LO_WHITE : STR_CAL_HI_BLACK),
+            "D=", page->buf, "");
+        break;
+    case CAL_STEP_POSITION_LO:
+        display_draw_message(ui_str(STR_POSITION_CAL_LO), NULL, NULL, ui_str(STR_BUTTON_MEASURE), 0);
+        break;
+    case CAL_STEP_POSITION_HI:
+        display_draw_message(ui_str(STR_POSITION_CAL_HI), NULL, NULL, ui_str(STR_BUTTON_MEASURE), 0);
+        break;
+    default:
+        break;
+    }
+}
 
-        option = display_selection_list(
-            "Transmission", option, buf);
+void cal_reflection_key(state_main_menu_t *state, const keypad_event_t *event)
+{
+    menu_page_state_t *page = &state->page;
+    settings_cal_reflection_t *cal = &page->reflection.cal;
+    const char *title = ui_str(STR_REFLECTION);
+    densitometer_result_t result;
+    menu_key_t key = main_menu_key(event);
+
+    switch (page->step) {
+    case CAL_STEP_LIST:
+        if (key == MENU_KEY_BACK) {
+            main_menu_close_page(state);
+        } else if (key == MENU_KEY_SELECT && page->current_pos == 0) {
+            page->input_value = cal_input_start(cal->lo_d, 8);
+            page->step = CAL_STEP_INPUT_LO;
+        } else if (key == MENU_KEY_SELECT && page->current_pos == 1) {
+            page->input_value = cal_input_start(cal->hi_d, 150);
+            page->step = CAL_STEP_INPUT_HI;
+        } else if (key == MENU_KEY_SELECT) {
+            /* Validate the target densities, just in case */
+            if (!is_valid_number(cal->lo_d) || !is_valid_number(cal->hi_d)
+                || cal->lo_d < 0.00F || cal->lo_d > REFLECTION_MAX_D
+                || cal->hi_d < 0.00F || cal->hi_d > REFLECTION_MAX_D
+                || cal->lo_d >= cal->hi_d) {
+                cal_finish(state, title, DENSITOMETER_CAL_ERROR, false);
+                break;
+            }
 
-        if (option == 1) {
-            uint16_t working_value;
-            if (is_valid_number(cal_transmission.hi_d) && cal_transmission.hi_d >= 0.0F) {
-                working_value = lroundf(cal_transmission.hi_d * 100);
+            /* Activate the idle light at default brightness */
+            sensor_set_light_mode(SENSOR_LIGHT_REFLECTION, false, SETTING_IDLE_LIGHT_REFL_DEFAULT);
+            page->step = CAL_STEP_POSITION_LO;
+        } else {
+            main_menu_move(&page->current_pos, 3, key);
+        }
+        break;
+    case CAL_STEP_INPUT_LO:
+    case CAL_STEP_INPUT_HI:
+        if (key == MENU_KEY_SELECT) {
+            if (page->step == CAL_STEP_INPUT_LO) {
+                cal->lo_d = page->input_value / 100.0F;
             } else {
-                working_value = 300;
+                cal->hi_d = page->input_value / 100.0F;
             }
-
-            uint8_t input_option = display_input_value_f1_2(
-                "CAL-HI\n",
-                "D=", &working_value,
-                0, 400, sep, NULL);
-            if (input_option == 1) {
-                cal_transmission.hi_d = working_value / 100.0F;
-            } else if (input_option == UINT8_MAX) {
-                option = UINT8_MAX;
+            page->step = CAL_STEP_LIST;
+        } else if (key == MENU_KEY_BACK) {
+            page->step = CAL_STEP_LIST;
+        } else {
+            main_menu_step_value(&page->input_value, 0, 250, key);
+        }
+        break;
+    case CAL_STEP_POSITION_LO:
+        if (key == MENU_KEY_BACK) {
+            cal_cancel(state, title);
+        } else if (key == MENU_KEY_SELECT && keypad_is_detect()) {
+            cal_measure(densitometer_reflection(), DISPLAY_MODE_REFLECTION,
+                cal->lo_d, &cal->lo_value, &page->reflection.lo_value_unc, &result);
+            if (result != DENSITOMETER_OK) {
+                cal_finish(state, title, result, false);
+                break;
+            }
+            sensor_set_light_mode(SENSOR_LIGHT_REFLECTION, false, SETTING_IDLE_LIGHT_REFL_DEFAULT);
+            page->step = CAL_STEP_POSITION_HI;
+        }
+        break;
+    case CAL_STEP_POSITION_HI:
+        if (key == MENU_KEY_BACK) {
+            cal_cancel(state, title);
+        } else if (key == MENU_KEY_SELECT && keypad_is_detect()) {
+            cal_measure(densitometer_reflection(), DISPLAY_MODE_REFLECTION,
+                cal->hi_d, &cal->hi_value, &page->reflection.hi_value_unc, &result);
+            if (result != DENSITOMETER_OK) {
+                cal_finish(state, title, result, false);
+                break;
             }
 
-        } else if (option == 2) {
-            densitometer_result_t meas_result = DENSITOMETER_OK;
-            bool cal_saved = false;
-            uint8_t meas_option = 1;
-            display_main_elements_t elements = {
-                .title = "Calibrating...",
-                .mode = DISPLAY_MODE_TRANSMISSION,
-                .density100 = 0,
-                .decimal_sep = sep,
-                .frame = 0
-            };
-
-            do {
-                /* Validate the target densities, just in case */
-                if (!is_valid_number(cal_transmission.hi_d)) {
-                    meas_result = DENSITOMETER_CAL_ERROR;
-                    break;
-                }
-                if (cal_transmission.hi_d < 0.00F || cal_transmission.hi_d > TRANSMISSION_MAX_D) {
-                    meas_result = DENSITOMETER_CAL_ERROR;
-                    break;
-                }
+            cal->lo_unc = density_calc_cal_point_uncertainty(cal->lo_value, page->reflection.lo_value_unc, NAN, 0.0F);
+            cal->hi_unc = density_calc_cal_point_uncertainty(cal->hi_value, page->reflection.hi_value_unc, NAN, 0.0F);
 
-                sensor_set_light_mode(SENSOR_LIGHT_TRANSMISSION, false, SETTING_IDLE_LIGHT_TRAN_DEFAULT);
-
-                do {
-                    meas_option = display_message(
-                        "Hold device\n"
-                        "firmly closed\n"
-                        "with no film",
-                        NULL, NULL, " Measure ");
-                } while (!keypad_is_detect() && meas_option != 0 && meas_option != UINT8_MAX);
-
-                if (meas_option == 1) {
-                    densitometer_t *densitometer = densitometer_transmission();
-                    elements.density100 = 0;
-                    elements.frame = 0;
-                    display_draw_main_elements(&elements);
-                    meas_result = densitometer_calibrate(densitometer, &(cal_transmission.zero_value), sensor_read_callback, &elements);
-                } else {
-                    break;
-                }
-                if (meas_result != DENSITOMETER_OK) { break; }
-
-                sensor_set_light_mode(SENSOR_LIGHT_TRANSMISSION, false, SETTING_IDLE_LIGHT_TRAN_DEFAULT);
-
-                do {
-                    meas_option = display_message(
-                        "Position\n"
-                        "CAL-HI firmly\n"
-                        "under sensor",
-                        NULL, NULL, " Measure ");
-                } while (!keypad_is_detect() && meas_option != 0 && meas_option != UINT8_MAX);
-
-                if (meas_option == 1) {
-                    densitometer_t *densitometer = densitometer_transmission();
-                    elements.density100 = lroundf(cal_transmission.hi_d * 100);
-                    elements.frame = 0;
-                    display_draw_main_elements(&elements);
-                    meas_result = densitometer_calibrate(densitometer, &(cal_transmission.hi_value), sensor_read_callback, &elements);
-                } else {
-                    break;
-                }
-                if (meas_result != DENSITOMETER_OK) { break; }
+            bool saved = false;
+            if (!settings_validate_cal_reflection(cal)) {
+                log_w("Unable to validate cal data");
+            } else if (!settings_set_cal_reflection(cal)) {
+                log_w("Unable to save cal data");
+            } else {
+                sensor_record_cal_temperature(SENSOR_CAL_TEMP_REFLECTION);
+                saved = true;
+            }
+            cal_finish(state, title, DENSITOMETER_OK, saved);
+        }
+        break;
+    default:
+        break;
+    }
+}
 
-                if (!settings_validate_cal_transmission(&cal_transmission)) {
-                    log_w("Unable to validate cal data");
-                    cal_saved = false;
-                    break;
-                }
+void cal_transmission_enter(state_main_menu_t *state)
+{
+    settings_get_cal_transmission(&state->page.transmission.cal);
+    state->page.transmission.zero_value_unc = NAN;
+    state->page.transmission.hi_value_unc = NAN;
+}
 
-                if (!settings_set_cal_transmission(&cal_transmission)) {
-                    log_w("Unable to save cal data");
-                    cal_saved = false;
-                    break;
-                }
-                cal_saved = true;
-            } while (0);
+void cal_transmission_draw(state_main_menu_t *state)
+{
+    menu_page_state_t *page = &state->page;
+    char buf_hi[DENSITY_BUF_SIZE];
 
-            if (meas_option == UINT8_MAX) {
-                option = UINT8_MAX;
-                break;
-            } else if (meas_option == 0) {
-                display_message(
-                    "Transmission", NULL,
-                    "calibration\n"
-                    "canceled", " OK ");
+    switch (page->step) {
+    case CAL_STEP_LIST:
+        format_density_value(buf_hi, page->transmission.cal.hi_d);
+        sprintf_(page->buf,
+            "CAL-HI  [%s]\n"
+            "%s",
+            buf_hi, ui_str(STR_MEASURE));
+        display_draw_selection_list(ui_str(STR_TRANSMISSION), page->buf, page->current_pos, &page->first_pos);
+        break;
+    case CAL_STEP_INPUT_HI:
+        format_input_value(page->buf, page->input_value);
+        display_draw_input_value("CAL-HI\n", "D=", page->buf, "");
+        break;
+    case CAL_STEP_POSITION_LO:
+        display_draw_message(ui_str(STR_HOLD_CLOSED), NULL, NULL, ui_str(STR_BUTTON_MEASURE), 0);
+        break;
+    case CAL_STEP_POSITION_HI:
+        display_draw_message(ui_str(STR_POSITION_CAL_HI), NULL, NULL, ui_str(STR_BUTTON_MEASURE), 0);
+        break;
+    default:
+        break;
+    }
+}
+
+void cal_transmission_key(state_main_menu_t *state, const keypad_event_t *event)
+{
+    menu_page_state_t *page = &state->page;
+    settings_cal_transmission_t *cal = &page->transmission.cal;
+    const char *title = ui_str(STR_TRANSMISSION);
+    densitometer_result_t result;
+    menu_key_t key = main_menu_key(event);
+
+    switch (page->step) {
+    case CAL_STEP_LIST:
+        if (key == MENU_KEY_BACK) {
+            main_menu_close_page(state);
+        } else if (key == MENU_KEY_SELECT && page->current_pos == 0) {
+            page->input_value = cal_input_start(cal->hi_d, 300);
+            page->step = CAL_STEP_INPUT_HI;
+        } else if (key == MENU_KEY_SELECT) {
+            /* Validate the target density, just in case */
+            if (!is_valid_number(cal->hi_d) || cal->hi_d < 0.00F || cal->hi_d > TRANSMISSION_MAX_D) {
+                cal_finish(state, title, DENSITOMETER_CAL_ERROR, false);
                 break;
-            } else if (!cal_saved) {
-                display_message(
-                    "Transmission", NULL,
-                    "Unable\n"
-                    "to save", " OK ");
-            } else if (meas_result == DENSITOMETER_OK) {
-                display_message(
-                    "Transmission", NULL,
-                    "calibration\n"
-                    "complete", " OK ");
+            }
+
+            sensor_set_light_mode(SENSOR_LIGHT_TRANSMISSION, false, SETTING_IDLE_LIGHT_TRAN_DEFAULT);
+            page->step = CAL_STEP_POSITION_LO;
+        } else {
+            main_menu_move(&page->current_pos, 2, key);
+        }
+        break;
+    case CAL_STEP_INPUT_HI:
+        if (key == MENU_KEY_SELECT) {
+            cal->hi_d = page->input_value / 100.0F;
+            page->step = CAL_STEP_LIST;
+        } else if (key == MENU_KEY_BACK) {
+            page->step = CAL_STEP_LIST;
+        } else {
+            main_menu_step_value(&page->input_value, 0, 400, key);
+        }
+        break;
+    case CAL_STEP_POSITION_LO:
+        if (key == MENU_KEY_BACK) {
+            cal_cancel(state, title);
+        } else if (key == MENU_KEY_SELECT && keypad_is_detect()) {
+            cal_measure(densitometer_transmission(), DISPLAY_MODE_TRANSMISSION,
+                0.0F, &cal->zero_value, &page->transmission.zero_value_unc, &result);
+            if (result != DENSITOMETER_OK) {
+                cal_finish(state, title, result, false);
                 break;
-            } else if (meas_result == DENSITOMETER_CAL_ERROR) {
-                display_message(
-                    "Transmission", NULL,
-                    "calibration\n"
-                    "values invalid", " OK ");
-            } else if (meas_result == DENSITOMETER_SENSOR_ERROR) {
-                display_message(
-                    "Transmission", NULL,
-                    "calibration\n"
-                    "failed", " OK ");
             }
+            sensor_set_light_mode(SENSOR_LIGHT_TRANSMISSION, false, SETTING_IDLE_LIGHT_TRAN_DEFAULT);
+            page->step = CAL_STEP_POSITION_HI;
         }
-    } while (option > 0 && option != UINT8_MAX);
+        break;
+    case CAL_STEP_POSITION_HI:
+        if (key == MENU_KEY_BACK) {
+            cal_cancel(state, title);
+        } else if (key == MENU_KEY_SELECT && keypad_is_detect()) {
+            cal_measure(densitometer_transmission(), DISPLAY_MODE_TRANSMISSION,
+                cal->hi_d, &cal->hi_value, &page->transmission.hi_value_unc, &result);
+            if (result != DENSITOMETER_OK) {
+                cal_finish(state, title, result, false);
+                break;
+            }
 
-    if (option == UINT8_MAX) {
-        state_controller_set_next_state(controller, STATE_HOME);
-    } else {
-        state->menu_state = MAIN_MENU_CALIBRATION;
+            cal->hi_unc = density_calc_cal_point_uncertainty(
+                cal->hi_value, page->transmission.hi_value_unc,
+                cal->zero_value, page->transmission.zero_value_unc);
+
+            bool saved = false;
+            if (!settings_validate_cal_transmission(cal)) {
+                log_w("Unable to validate cal data");
+            } else if (!settings_set_cal_transmission(cal)) {
+                log_w("Unable to save cal data");
+            } else {
+                sensor_record_cal_temperature(SENSOR_CAL_TEMP_TRANSMISSION);
+                saved = true;
+            }
+            cal_finish(state, title, DENSITOMETER_OK, saved);
+        }
+        break;
+    default:
+        break;
     }
 }
 
-void main_menu_calibration_sensor_gain(state_main_menu_t *state, state_controller_t *controller)
+void sensor_gain_enter(state_main_menu_t *state)
 {
-    char buf[192];
+    char *buf = state->page.buf;
     settings_cal_light_t cal_light;
     settings_cal_gain_t cal_gain;
 
@@ -553,485 +894,347 @@ void main_menu_calibration_sensor_gain(state_main_menu_t *state, state_controlle
     if (sep != '.') {
         replace_all_char(buf, '.', sep);
     }
-
-    state->cal_sub_option = display_selection_list(
-        "Sensor Gain", state->cal_sub_option,
-        buf);
-
-    if (state->cal_sub_option == UINT8_MAX) {
-        state_controller_set_next_state(controller, STATE_HOME);
-    } else if (state->cal_sub_option == 0) {
-        state->menu_state = MAIN_MENU_CALIBRATION;
-        state->cal_sub_option = 1;
-    }
+    state->page.title = ui_str(STR_SENSOR_GAIN);
 }
 
-void main_menu_calibration_sensor_slope(state_main_menu_t *state, state_controller_t *controller)
+void sensor_slope_enter(state_main_menu_t *state)
 {
-    char buf[128];
+    char *buf = state->page.buf;
     settings_cal_slope_t cal_slope;
 
-    if (settings_get_cal_slope(&cal_slope)) {
-        sprintf_(buf,
-            "B0 = %.6f\n"
-            "B1 = %.6f\n"
-            "B2 = %.6f",
-            cal_slope.b0, cal_slope.b1, cal_slope.b2);
+    if (!settings_get_cal_slope(&cal_slope)) {
+        main_menu_show_message(state, ui_str(STR_SENSOR_SLOPE), STR_CAL_NOT_SET, true);
+        return;
+    }
 
-        char sep = settings_get_decimal_separator();
-        if (sep != '.') {
-            replace_all_char(buf, '.', sep);
-        }
+    sprintf_(buf,
+        "B0 = %.6f\n"
+        "B1 = %.6f\n"
+        "B2 = %.6f",
+        cal_slope.b0, cal_slope.b1, cal_slope.b2);
 
-        state->cal_sub_option = display_selection_list(
-            "Sensor Slope", state->cal_sub_option,
-            buf);
-    } else {
-        state->cal_sub_option = display_message(
-            "Sensor Slope", NULL,
-            "calibration\n"
-            "not set",
-            " OK ");
-        if (state->cal_sub_option == 1) {
-            state->cal_sub_option = 0;
-        }
+    char sep = settings_get_decimal_separator();
+    if (sep != '.') {
+        replace_all_char(buf, '.', sep);
     }
+    state->page.title = ui_str(STR_SENSOR_SLOPE);
+}
 
-    if (state->cal_sub_option == UINT8_MAX) {
-        state_controller_set_next_state(controller, STATE_HOME);
-    } else if (state->cal_sub_option == 0) {
-        state->menu_state = MAIN_MENU_CALIBRATION;
-        state->cal_sub_option = 1;
-    }
+void text_list_draw(state_main_menu_t *state)
+{
+    menu_page_state_t *page = &state->page;
+    display_draw_selection_list(page->title, page->buf, page->current_pos, &page->first_pos);
 }
 
-void main_menu_settings(state_main_menu_t *state, state_controller_t *controller)
+void text_list_key(state_main_menu_t *state, const keypad_event_t *event)
 {
-    state->settings_option = display_selection_list(
-        "Settings", state->settings_option,
-        "Target Light\n"
-        "Display Format\n"
-        "USB Key Output\n"
-        "Diagnostics");
-
-    if (state->settings_option == 1) {
-        state->menu_state = MAIN_MENU_SETTINGS_IDLE_LIGHT;
-    } else if (state->settings_option == 2) {
-        state->menu_state = MAIN_MENU_SETTINGS_DISPLAY_FORMAT;
-    } else if (state->settings_option == 3) {
-        state->menu_state = MAIN_MENU_SETTINGS_USB_KEY;
-    } else if (state->settings_option == 4) {
-        state->menu_state = MAIN_MENU_SETTINGS_DIAGNOSTICS;
-    } else if (state->settings_option == UINT8_MAX) {
-        state_controller_set_next_state(controller, STATE_HOME);
+    menu_key_t key = main_menu_key(event);
+
+    if (key == MENU_KEY_BACK) {
+        main_menu_close_page(state);
     } else {
-        state->menu_state = MAIN_MENU_HOME;
-        state->settings_option = 1;
+        main_menu_move(&state->page.current_pos, count_lines(state->page.buf), key);
     }
 }
 
-void main_menu_settings_idle_light(state_main_menu_t *state, state_controller_t *controller)
+void profiles_enter(state_main_menu_t *state)
 {
-    char buf[192];
+    state->page.profiles.index = 0;
+}
 
-    settings_user_idle_light_t idle_light;
-    settings_get_user_idle_light(&idle_light);
-
-    strcpy(buf, "Refl. ");
-    if (idle_light.reflection == 0) {
-        strcat(buf, "  [None]");
-    } else if (idle_light.reflection == SETTING_IDLE_LIGHT_REFL_LOW) {
-        strcat(buf, "   [Low]");
-    } else if (idle_light.reflection == SETTING_IDLE_LIGHT_REFL_MEDIUM) {
-        strcat(buf, "[Medium]");
-    } else if (idle_light.reflection == SETTING_IDLE_LIGHT_REFL_HIGH) {
-        strcat(buf, "  [High]");
-    } else {
-        strcat(buf, "     [?]");
-    }
-    strcat(buf, "\n");
-
-    strcat(buf, "Tran. ");
-    if (idle_light.transmission == 0) {
-        strcat(buf, "  [None]");
-    } else if (idle_light.transmission == SETTING_IDLE_LIGHT_TRAN_LOW) {
-        strcat(buf, "   [Low]");
-    } else if (idle_light.transmission == SETTING_IDLE_LIGHT_TRAN_MEDIUM) {
-        strcat(buf, "[Medium]");
-    } else if (idle_light.transmission == SETTING_IDLE_LIGHT_TRAN_HIGH) {
-        strcat(buf, "  [High]");
-    } else {
-        strcat(buf, "     [?]");
-    }
-    strcat(buf, "\n");
-
-    strcat(buf, "Timeout ");
-    if (idle_light.timeout == 0) {
-        strcat(buf, "[None]");
-    } else if (idle_light.timeout < 10) {
-        sprintf(buf + strlen(buf), "  [%ds]", idle_light.timeout);
-    } else if (idle_light.timeout < 100) {
-        sprintf(buf + strlen(buf), " [%ds]", idle_light.timeout);
-    } else {
-        sprintf(buf + strlen(buf), "[%ds]", idle_light.timeout);
+void profiles_draw(state_main_menu_t *state)
+{
+    menu_page_state_t *page = &state->page;
+    settings_cal_profile_t profile;
+
+    if (page->step == PROFILE_STEP_ACTION) {
+        display_draw_message(page->profiles.title, NULL, NULL,
+            ui_str((page->profiles.button_count > 1) ? STR_BUTTONS_LOAD_SAVE : STR_BUTTON_SAVE),
+            page->current_pos);
+        return;
     }
 
-    state->settings_sub_option = display_selection_list(
-        "Target Light", state->settings_sub_option,
-        buf);
-
-    if (state->settings_sub_option == 1) {
-        if (idle_light.reflection == 0) {
-            idle_light.reflection = SETTING_IDLE_LIGHT_REFL_LOW;
-        } else if (idle_light.reflection == SETTING_IDLE_LIGHT_REFL_LOW) {
-            idle_light.reflection = SETTING_IDLE_LIGHT_REFL_MEDIUM;
-        } else if (idle_light.reflection == SETTING_IDLE_LIGHT_REFL_MEDIUM) {
-            idle_light.reflection = SETTING_IDLE_LIGHT_REFL_HIGH;
-        } else if (idle_light.reflection == SETTING_IDLE_LIGHT_REFL_HIGH) {
-            idle_light.reflection = 0;
-        } else {
-            idle_light.reflection = SETTING_IDLE_LIGHT_REFL_DEFAULT;
+    /* List the profile slots, marking the active profile */
+    size_t offset = 0;
+    uint8_t active = settings_get_active_cal_profile();
+    for (uint8_t i = 0; i < SETTING_CAL_PROFILE_COUNT; i++) {
+        if (i > 0) {
+            page->buf[offset++] = '\n';
         }
-        settings_set_user_idle_light(&idle_light);
-
-    } else if (state->settings_sub_option == 2) {
-        if (idle_light.transmission == 0) {
-            idle_light.transmission = SETTING_IDLE_LIGHT_TRAN_LOW;
-        } else if (idle_light.transmission == SETTING_IDLE_LIGHT_TRAN_LOW) {
-            idle_light.transmission = SETTING_IDLE_LIGHT_TRAN_MEDIUM;
-        } else if (idle_light.transmission == SETTING_IDLE_LIGHT_TRAN_MEDIUM) {
-            idle_light.transmission = SETTING_IDLE_LIGHT_TRAN_HIGH;
-        } else if (idle_light.transmission == SETTING_IDLE_LIGHT_TRAN_HIGH) {
-            idle_light.transmission = 0;
+        if (settings_get_cal_profile(i, &profile)) {
+            offset += sprintf_(page->buf + offset, "%c%s", (i == active) ? '*' : ' ', profile.name);
         } else {
-            idle_light.transmission = SETTING_IDLE_LIGHT_TRAN_DEFAULT;
+            offset += sprintf_(page->buf + offset, " %d: %s", i + 1, ui_str(STR_PROFILE_EMPTY));
         }
-        settings_set_user_idle_light(&idle_light);
-
-    } else if (state->settings_sub_option == 3) {
-        if (idle_light.timeout < 10) {
-            idle_light.timeout = 10;
-        } else if (idle_light.timeout < 30) {
-            idle_light.timeout = 30;
-        } else if (idle_light.timeout < 60) {
-            idle_light.timeout = 60;
-        } else if (idle_light.timeout < 120) {
-            idle_light.timeout = 120;
+    }
+
+    display_draw_selection_list(ui_str(STR_CAL_PROFILES), page->buf, page->profiles.index, &page->first_pos);
+}
+
+void profiles_key(state_main_menu_t *state, const keypad_event_t *event)
+{
+    menu_page_state_t *page = &state->page;
+    settings_cal_profile_t profile;
+    menu_key_t key = main_menu_key(event);
+    uint8_t index = page->profiles.index;
+
+    if (page->step == PROFILE_STEP_LIST) {
+        if (key == MENU_KEY_BACK) {
+            main_menu_close_page(state);
+        } else if (key == MENU_KEY_SELECT) {
+            if (settings_get_cal_profile(index, &profile)) {
+                strncpy(page->profiles.title, profile.name, sizeof(page->profiles.title));
+                page->profiles.title[sizeof(page->profiles.title) - 1] = '\0';
+                page->profiles.button_count = 2;
+            } else {
+                /* Only saving is possible for an empty slot */
+                snprintf_(page->profiles.title, sizeof(page->profiles.title), "%s %d", ui_str(STR_PROFILE_SLOT), index + 1);
+                page->profiles.button_count = 1;
+            }
+            page->current_pos = 0;
+            page->step = PROFILE_STEP_ACTION;
         } else {
-            idle_light.timeout = 0;
+            main_menu_move(&page->profiles.index, SETTING_CAL_PROFILE_COUNT, key);
         }
-        settings_set_user_idle_light(&idle_light);
+        return;
+    }
 
-    } else if (state->settings_sub_option == UINT8_MAX) {
-        state_controller_set_next_state(controller, STATE_HOME);
+    if (key == MENU_KEY_BACK) {
+        page->step = PROFILE_STEP_LIST;
+    } else if (key == MENU_KEY_SELECT) {
+        /* The only button for an empty slot is Save */
+        bool load = page->profiles.button_count > 1 && page->current_pos == 0;
+        page->step = PROFILE_STEP_LIST;
+        if (load && !settings_select_cal_profile(index)) {
+            main_menu_show_message(state, ui_str(STR_PROFILE), STR_UNABLE_TO_LOAD, false);
+        } else if (!load && !settings_save_cal_profile(index, NULL)) {
+            main_menu_show_message(state, ui_str(STR_PROFILE), STR_UNABLE_TO_SAVE, false);
+        }
     } else {
-        state->menu_state = MAIN_MENU_SETTINGS;
-        state->settings_sub_option = 1;
+        main_menu_move(&page->current_pos, page->profiles.button_count, key);
     }
 }
 
-void main_menu_settings_display_format(state_main_menu_t *state, state_controller_t *controller)
+static void diagnostics_apply_light(uint8_t light_mode)
 {
-    char buf[192];
-
-    settings_user_display_format_t display_format;
-    settings_get_user_display_format(&display_format);
-
-    strcpy(buf, "Number  ");
-    if (display_format.separator == SETTING_DECIMAL_SEPARATOR_PERIOD) {
-        strcat(buf, "[#.##]");
-    } else {
-        strcat(buf, "[#,##]");
+    switch (light_mode) {
+    case 1:
+        sensor_set_light_mode(SENSOR_LIGHT_REFLECTION, false, 128);
+        break;
+    case 2:
+        sensor_set_light_mode(SENSOR_LIGHT_TRANSMISSION, false, 128);
+        break;
+    default:
+        sensor_set_light_mode(SENSOR_LIGHT_OFF, false, 0);
+        break;
     }
-    strcat(buf, "\n");
+}
 
-    strcat(buf, "Units      ");
-    if (display_format.unit == SETTING_DISPLAY_UNIT_DENSITY) {
-        strcat(buf, "[D]");
-    } else {
-        strcat(buf, "[F]");
+void diagnostics_enter(state_main_menu_t *state)
+{
+    menu_page_state_t *page = &state->page;
+
+    page->diagnostics.gain = TSL2591_GAIN_LOW;
+    page->diagnostics.time = TSL2591_TIME_100MS;
+    page->diagnostics.light_mode = 0;
+    page->diagnostics.display_mode = false;
+    page->diagnostics.config_changed = false;
+    page->diagnostics.started = false;
+    page->diagnostics.start_ticks = osKernelGetTickCount();
+
+    /* The first reading is checked by the poll function, without waiting here */
+    if (sensor_set_config(page->diagnostics.gain, page->diagnostics.time) != osOK
+        || sensor_start() != osOK) {
+        main_menu_show_message(state, ui_str(STR_SENSOR), STR_INIT_FAILED, true);
+        return;
     }
+    diagnostics_apply_light(page->diagnostics.light_mode);
+}
 
-    state->settings_sub_option = display_selection_list(
-        "Display Format", state->settings_sub_option,
-        buf);
+void diagnostics_draw(state_main_menu_t *state)
+{
+    display_static_list(ui_str(STR_DIAGNOSTICS), state->page.buf);
+}
 
+void diagnostics_key(state_main_menu_t *state, const keypad_event_t *event)
+{
+    menu_page_state_t *page = &state->page;
 
-    if (state->settings_sub_option == 1) {
-        display_format.separator++;
-        if (display_format.separator >= SETTING_DECIMAL_SEPARATOR_MAX) {
-            display_format.separator = 0;
+    if (keypad_is_key_combo_pressed(event, KEYPAD_BUTTON_ACTION, KEYPAD_BUTTON_UP)) {
+        page->diagnostics.display_mode = !page->diagnostics.display_mode;
+    } else if (keypad_is_key_pressed(event, KEYPAD_BUTTON_ACTION) && !event->repeated) {
+        if (page->diagnostics.gain < TSL2591_GAIN_MAXIMUM) {
+            page->diagnostics.gain++;
+        } else {
+            page->diagnostics.gain = TSL2591_GAIN_LOW;
         }
-        settings_set_user_display_format(&display_format);
-    } else if (state->settings_sub_option == 2) {
-        display_format.unit++;
-        if (display_format.unit >= SETTING_DISPLAY_UNIT_MAX) {
-            display_format.unit = 0;
+        page->diagnostics.config_changed = true;
+    } else if (keypad_is_key_pressed(event, KEYPAD_BUTTON_UP) && !event->repeated) {
+        if (page->diagnostics.time < TSL2591_TIME_600MS) {
+            page->diagnostics.time++;
+        } else {
+            page->diagnostics.time = TSL2591_TIME_100MS;
         }
-        settings_set_user_display_format(&display_format);
-    } else if (state->settings_sub_option == UINT8_MAX) {
-        state_controller_set_next_state(controller, STATE_HOME);
-    } else {
-        state->menu_state = MAIN_MENU_SETTINGS;
-        state->settings_sub_option = 1;
+        page->diagnostics.config_changed = true;
+    }
+
+    if (keypad_is_key_pressed(event, KEYPAD_BUTTON_DOWN) && !event->repeated) {
+        page->diagnostics.light_mode = (page->diagnostics.light_mode < 2) ? (page->diagnostics.light_mode + 1) : 0;
+        diagnostics_apply_light(page->diagnostics.light_mode);
+    }
+
+    if (keypad_is_key_pressed(event, KEYPAD_BUTTON_MENU)) {
+        main_menu_close_page(state);
     }
 }
 
-void main_menu_settings_usb_key(state_main_menu_t *state, state_controller_t *controller)
+void diagnostics_poll(state_main_menu_t *state)
 {
-    char separator;
-    char suffix;
-    char buf[192];
-
-    settings_user_usb_key_t usb_key;
-    settings_get_user_usb_key(&usb_key);
+    menu_page_state_t *page = &state->page;
+    sensor_reading_t reading;
+    float ch0_basic = NAN;
+    float ch1_basic = NAN;
+    char gain_ch;
+    char light_ch;
 
-    settings_user_display_format_t display_format;
-    settings_get_user_display_format(&display_format);
+    /* The live readings keep the menu open for as long as they are shown */
+    state->timeout_ticks = osKernelGetTickCount() + MENU_TIMEOUT_MS;
 
-    separator = settings_get_decimal_separator();
-    suffix = settings_get_unit_suffix();
+    if (page->diagnostics.config_changed) {
+        if (sensor_set_config(page->diagnostics.gain, page->diagnostics.time) == osOK) {
+            page->diagnostics.config_changed = false;
+        }
+    }
 
-    strcpy(buf, "Enabled");
-    if (usb_key.enabled) {
-        strcat(buf, "  [Yes]");
-    } else {
-        strcat(buf, "   [No]");
+    if (sensor_get_next_reading(&reading, 0) != osOK) {
+        if (!page->diagnostics.started
+            && osKernelGetTickCount() - page->diagnostics.start_ticks > DIAGNOSTICS_INIT_TIMEOUT) {
+            main_menu_show_message(state, ui_str(STR_SENSOR), STR_INIT_FAILED, true);
+        }
+        return;
     }
-    strcat(buf, "\n");
 
-    strcat(buf, "Fmt.");
-    if (usb_key.format == SETTING_KEY_FORMAT_FULL) {
-        char fmt[16];
-        sprintf(fmt, " [M+#%c##%c]", separator, suffix);
-        strcat(buf, fmt);
-    } else {
-        char fmt[16];
-        sprintf(fmt, "    [#%c##]", separator);
-        strcat(buf, fmt);
+    if (!page->diagnostics.started) {
+        if (reading.gain != page->diagnostics.gain || reading.time != page->diagnostics.time) {
+            main_menu_show_message(state, ui_str(STR_SENSOR), STR_INIT_FAILED, true);
+            return;
+        }
+        page->diagnostics.started = true;
     }
-    strcat(buf, "\n");
 
-    strcat(buf, "Sep.");
-    switch (usb_key.separator) {
-    case SETTING_KEY_SEPARATOR_ENTER:
-        strcat(buf, "   [Enter]");
+    switch (page->diagnostics.gain) {
+    case TSL2591_GAIN_LOW:
+        gain_ch = 'L';
         break;
-    case SETTING_KEY_SEPARATOR_TAB:
-        strcat(buf, "     [Tab]");
+    case TSL2591_GAIN_MEDIUM:
+        gain_ch = 'M';
         break;
-    case SETTING_KEY_SEPARATOR_COMMA:
-        if (separator == ',') {
-            strcat(buf, "       [;]");
-        } else {
-            strcat(buf, "       [,]");
-        }
+    case TSL2591_GAIN_HIGH:
+        gain_ch = 'H';
         break;
-    case SETTING_KEY_SEPARATOR_SPACE:
-        strcat(buf, "   [Space]");
+    case TSL2591_GAIN_MAXIMUM:
+        gain_ch = 'X';
         break;
-    case SETTING_KEY_SEPARATOR_NONE:
     default:
-        strcat(buf, "    [None]");
+        gain_ch = ' ';
         break;
     }
 
-    state->settings_sub_option = display_selection_list(
-        "USB Key Output", state->settings_sub_option,
-        buf);
-
-    if (state->settings_sub_option == 1) {
-        usb_key.enabled = !usb_key.enabled;
-        settings_set_user_usb_key(&usb_key);
-        usb_device_reconnect();
-    } else if (state->settings_sub_option == 2) {
-        usb_key.format++;
-        if (usb_key.format >= SETTING_KEY_FORMAT_MAX) {
-            usb_key.format = 0;
-        }
-        settings_set_user_usb_key(&usb_key);
-    } else if (state->settings_sub_option == 3) {
-        usb_key.separator++;
-        if (usb_key.separator >= SETTING_KEY_SEPARATOR_MAX) {
-            usb_key.separator = 0;
-        }
-        settings_set_user_usb_key(&usb_key);
-    } else if (state->settings_sub_option == UINT8_MAX) {
-        state_controller_set_next_state(controller, STATE_HOME);
+    switch (page->diagnostics.light_mode) {
+    case 0:
+        light_ch = '-';
+        break;
+    case 1:
+        light_ch = 'R';
+        break;
+    case 2:
+        light_ch = 'T';
+        break;
+    default:
+        light_ch = ' ';
+        break;
+    }
+
+    bool is_detect = keypad_is_detect();
+    if (page->diagnostics.display_mode) {
+        sensor_convert_to_basic_counts(&reading, &ch0_basic, &ch1_basic);
+        sprintf_(page->buf,
+            "CH0=%.5f\n"
+            "CH1=%.5f\n"
+            "[%c][%d][%c][%c]",
+            ch0_basic, ch1_basic,
+            gain_ch, tsl2591_get_time_value_ms(page->diagnostics.time), light_ch,
+            (is_detect ? '*' : ' '));
     } else {
-        state->menu_state = MAIN_MENU_SETTINGS;
-        state->settings_sub_option = 1;
+        sprintf_(page->buf,
+            "CH0=%5d\n"
+            "CH1=%5d\n"
+            "[%c][%d][%c][%c]",
+            reading.ch0_val, reading.ch1_val,
+            gain_ch, tsl2591_get_time_value_ms(page->diagnostics.time), light_ch,
+            (is_detect ? '*' : ' '));
     }
+    state->display_dirty = true;
 }
 
-void main_menu_settings_diagnostics(state_main_menu_t *state, state_controller_t *controller)
+void diagnostics_leave(state_main_menu_t *state)
 {
-    osStatus_t ret = osOK;
-    tsl2591_gain_t gain = TSL2591_GAIN_LOW;
-    tsl2591_time_t time = TSL2591_TIME_100MS;
-    sensor_reading_t reading;
-    float ch0_basic = NAN;
-    float ch1_basic = NAN;
-    uint8_t light_mode = 0;
-    char gain_ch = ' ';
-    char light_ch = ' ';
-    bool display_mode = false;
-    bool config_changed = true;
-    bool settings_changed = true;
-    char buf[128];
-
-    do {
-        ret = sensor_set_config(gain, time);
-        if (ret != osOK) { break; }
-        ret = sensor_start();
-        if (ret != osOK) { break; }
-
-        ret = sensor_get_next_reading(&reading, 2000);
-        if (ret != osOK) { break; }
-    } while (0);
-
-    if (ret != osOK || reading.gain != gain || reading.time != time) {
-        display_message(
-            "Sensor", NULL,
-            "initialization\n"
-            "failed", " OK ");
-        state->menu_state = MAIN_MENU_SETTINGS;
-        return;
-    }
-
-    keypad_event_t keypad_event;
-    bool key_changed = false;
-    do {
-        if (key_changed) {
-            key_changed = false;
-
-            if (keypad_is_key_combo_pressed(&keypad_event, KEYPAD_BUTTON_ACTION, KEYPAD_BUTTON_UP)) {
-                display_mode = !display_mode;
-            } else if (keypad_is_key_pressed(&keypad_event, KEYPAD_BUTTON_ACTION) && !keypad_event.repeated) {
-                if (gain < TSL2591_GAIN_MAXIMUM) {
-                    gain++;
-                } else {
-                    gain = TSL2591_GAIN_LOW;
-                }
-                config_changed = true;
-            } else if (keypad_is_key_pressed(&keypad_event, KEYPAD_BUTTON_UP) && !keypad_event.repeated) {
-                if (time < TSL2591_TIME_600MS) {
-                    time++;
-                } else {
-                    time = TSL2591_TIME_100MS;
-                }
-                config_changed = true;
-            }
-
-            if (keypad_is_key_pressed(&keypad_event, KEYPAD_BUTTON_DOWN) && !keypad_event.repeated) {
-                if (light_mode < 2) {
-                    light_mode++;
-                } else {
-                    light_mode = 0;
-                }
-                settings_changed = true;
-            }
-
-            if (keypad_is_key_pressed(&keypad_event, KEYPAD_BUTTON_MENU)) {
-                break;
-            } else if (keypad_event.pressed && keypad_event.key == KEYPAD_FORCE_TIMEOUT) {
-                state_controller_set_next_state(controller, STATE_HOME);
-                break;
-            }
-        }
-
-        if (config_changed) {
-            if (sensor_set_config(gain, time) == osOK) {
-                config_changed = false;
-                settings_changed = true;
-            }
-        }
-
-        if (settings_changed) {
-            switch (gain) {
-            case TSL2591_GAIN_LOW:
-                gain_ch = 'L';
-                break;
-            case TSL2591_GAIN_MEDIUM:
-                gain_ch = 'M';
-                break;
-            case TSL2591_GAIN_HIGH:
-                gain_ch = 'H';
-                break;
-            case TSL2591_GAIN_MAXIMUM:
-                gain_ch = 'X';
-                break;
-            }
-
-            switch (light_mode) {
-            case 0:
-                sensor_set_light_mode(SENSOR_LIGHT_OFF, false, 0);
-                light_ch = '-';
-                break;
-            case 1:
-                sensor_set_light_mode(SENSOR_LIGHT_REFLECTION, false, 128);
-                light_ch = 'R';
-                break;
-            case 2:
-                sensor_set_light_mode(SENSOR_LIGHT_TRANSMISSION, false, 128);
-                light_ch = 'T';
-                break;
-            default:
-                sensor_set_light_mode(SENSOR_LIGHT_OFF, false, 0);
-                light_ch = ' ';
-                break;
-            }
-            settings_changed = false;
-        }
-
-        if (sensor_get_next_reading(&reading, 1000) == osOK) {
-            bool is_detect = keypad_is_detect();
-            if (display_mode) {
-                sensor_convert_to_basic_counts(&reading, &ch0_basic, &ch1_basic);
-                sprintf_(buf,
-                    "CH0=%.5f\n"
-                    "CH1=%.5f\n"
-                    "[%c][%d][%c][%c]",
-                    ch0_basic, ch1_basic,
-                    gain_ch, tsl2591_get_time_value_ms(time), light_ch,
-                    (is_detect ? '*' : ' '));
-            } else {
-                sprintf(buf,
-                    "CH0=%5d\n"
-                    "CH1=%5d\n"
-                    "[%c][%d][%c][%c]",
-                    reading.ch0_val, reading.ch1_val,
-                    gain_ch, tsl2591_get_time_value_ms(time), light_ch,
-                    (is_detect ? '*' : ' '));
-            }
-            display_static_list("Diagnostics", buf);
-        }
-
-        if (keypad_wait_for_event(&keypad_event, 100) == osOK) {
-            key_changed = true;
-        }
-    } while (1);
-
     sensor_stop();
-
-    state->menu_state = MAIN_MENU_SETTINGS;
 }
 
-void main_menu_about(state_main_menu_t *state, state_controller_t *controller)
+void about_enter(state_main_menu_t *state)
 {
     const app_descriptor_t *app_descriptor = app_descriptor_get();
-    char buf[128];
 
-    sprintf(buf,
+    sprintf_(state->page.buf,
         "Printalyzer\n"
         "Densitometer\n"
         "%s", app_descriptor->version);
+}
 
-    uint8_t option = display_message(buf, NULL, NULL, " OK ");
-    if (option == UINT8_MAX) {
-        state_controller_set_next_state(controller, STATE_HOME);
-    } else {
-        state->menu_state = MAIN_MENU_HOME;
+void about_draw(state_main_menu_t *state)
+{
+    display_draw_message(state->page.buf, NULL, NULL, ui_str(STR_BUTTON_OK), 0);
+}
+
+void about_key(state_main_menu_t *state, const keypad_event_t *event)
+{
+    menu_key_t key = main_menu_key(event);
+    if (key == MENU_KEY_SELECT || key == MENU_KEY_BACK) {
+        main_menu_close_page(state);
+    }
+}
+
+void setting_edit_enter(state_main_menu_t *state)
+{
+    state->page.input_value = settings_desc_get(state->page.setting);
+}
+
+void setting_edit_draw(state_main_menu_t *state)
+{
+    const settings_desc_t *desc = state->page.setting;
+    char value_buf[SETTINGS_DESC_LINE_SIZE];
+
+    settings_desc_format_value(desc, state->page.input_value, value_buf, sizeof(value_buf));
+    display_draw_input_value(ui_str(desc->label), "[", value_buf, "]");
+}
+
+void setting_edit_key(state_main_menu_t *state, const keypad_event_t *event)
+{
+    const settings_desc_t *desc = state->page.setting;
+    menu_key_t key = main_menu_key(event);
+
+    if (key == MENU_KEY_UP) {
+        state->page.input_value = settings_desc_next_value(desc, state->page.input_value);
+    } else if (key == MENU_KEY_DOWN) {
+        state->page.input_value = settings_desc_prev_value(desc, state->page.input_value);
+    } else if (key == MENU_KEY_SELECT) {
+        if (!settings_desc_set(desc, state->page.input_value)) {
+            log_w("Unable to set %s", desc->key);
+        }
+        main_menu_close_page(state);
+    } else if (key == MENU_KEY_BACK) {
+        main_menu_close_page(state);
     }
 }
 
@@ -1056,3 +1259,19 @@ void format_density_value(char *buf, float value)
         replace_first_char(buf, '.', sep);
     }
 }
+
+void format_input_value(char *buf, uint16_t value)
+{
+    /* Target densities are entered in hundredths, shown as N.DD */
+    if (value > 999) { value = 999; }
+    sprintf_(buf, "%d%c%02d", value / 100, settings_get_decimal_separator(), value % 100);
+}
+
+uint8_t count_lines(const char *buf)
+{
+    uint8_t count = (buf[0] != '\0') ? 1 : 0;
+    for (const char *p = buf; *p; p++) {
+        if (*p == '\n') { count++; }
+    }
+    return count;
+}
@@ -10,6 +10,7 @@
 #include "light.h"
 #include "densitometer.h"
 #include "settings.h"
+#include "ui_strings.h"
 
 typedef struct {
     state_t base;
@@ -17,7 +18,7 @@ typedef struct {
     bool take_measurement;
     densitometer_t *densitometer;
     state_identifier_t display_state;
-    const char *display_title;
+    ui_string_t display_title;
     display_mode_t display_mode;
 } state_measure_t;
 
@@ -37,7 +38,7 @@ static state_measure_t state_reflection_measure_data = {
     .take_measurement = true,
     .densitometer = NULL,
     .display_state = STATE_REFLECTION_DISPLAY,
-    .display_title = "Reflection",
+    .display_title = STR_REFLECTION,
     .display_mode = DISPLAY_MODE_REFLECTION
 };
 
@@ -51,7 +52,7 @@ static state_measure_t state_transmission_measure_data = {
     .take_measurement = true,
     .densitometer = NULL,
     .display_state = STATE_TRANSMISSION_DISPLAY,
-    .display_title = "Transmission",
+    .display_title = STR_TRANSMISSION,
     .display_mode = DISPLAY_MODE_TRANSMISSION
 };
 
@@ -100,7 +101,7 @@ void state_measure_process(state_t *state_base, state_controller_t *controller)
 
     char sep = settings_get_decimal_separator();
     display_main_elements_t elements = {
-        .title = "Measuring...",
+        .title = ui_str(STR_MEASURING),
         .mode = state->display_mode,
         .density100 = 0,
         .decimal_sep = sep,
@@ -113,15 +114,13 @@ void state_measure_process(state_t *state_base, state_controller_t *controller)
 
         densitometer_result_t result = densitometer_measure(state->densitometer, sensor_read_callback, &elements);
         if (result == DENSITOMETER_CAL_ERROR) {
-            display_static_list(state->display_title,
-                "Invalid\n"
-                "calibration");
+            display_static_list(ui_str(state->display_title),
+                ui_str(STR_INVALID_CALIBRATION));
             osDelay(2000);
             state_controller_set_next_state(controller, state->display_state);
         } else if (result == DENSITOMETER_SENSOR_ERROR) {
-            display_static_list(state->display_title,
-                "Sensor\n"
-                "read error");
+            display_static_list(ui_str(state->display_title),
+                ui_str(STR_SENSOR_READ_ERROR));
             osDelay(2000);
             state_controller_set_next_state(controller, state->display_state);
         } else {
@@ -6,6 +6,7 @@
 #include <cmsis_os.h>
 
 #include "display.h"
+#include "ui_strings.h"
 #include "keypad.h"
 #include "task_sensor.h"
 #include "cdc_handler.h"
@@ -34,7 +35,7 @@ void state_remote_entry(state_t *state_base, state_controller_t *controller, sta
 {
     log_i("Entering remote control state");
     sensor_set_light_mode(SENSOR_LIGHT_OFF, false, 0);
-    display_static_message("Remote\nControl");
+    display_static_message(ui_str(STR_REMOTE_CONTROL));
     cdc_send_remote_state(true);
 }
 
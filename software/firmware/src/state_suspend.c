@@ -12,6 +12,7 @@
 #include "util.h"
 #include "main.h"
 #include "board_config.h"
+#include "power.h"
 
 extern RTC_HandleTypeDef hrtc;
 extern TIM_HandleTypeDef htim2;
@@ -73,6 +74,12 @@ void state_suspend_entry(state_t *state_base, state_controller_t *controller, st
     /* Disable PWM timers */
     __HAL_RCC_TIM2_CLK_DISABLE();
 
+    /*
+     * Return to the full clock, which is what gets restored on wakeup,
+     * and keep it there until suspend is over
+     */
+    power_request(POWER_SOURCE_SUSPEND);
+
     /* Disable HAL and FreeRTOS tick timers */
     SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
     HAL_SuspendTick();
@@ -160,4 +167,6 @@ void state_suspend_exit(state_t *state, state_controller_t *controller, state_id
     display_enable(true);
     display_clear();
     keypad_clear_events();
+
+    power_release(POWER_SOURCE_SUSPEND);
 }
@@ -20,6 +20,7 @@
 #include <tusb.h>
 
 #include "state_suspend.h"
+#include "crash_record.h"
 
 extern DMA_HandleTypeDef hdma_adc;
 extern RTC_HandleTypeDef hrtc;
@@ -34,8 +35,8 @@ extern TIM_HandleTypeDef htim6;
  */
 void NMI_Handler(void)
 {
-    __ASM volatile("BKPT #01");
-    while (1) { }
+    crash_record_capture(CRASH_TYPE_NMI, NULL);
+    crash_record_reset();
 }
 
 /**
@@ -59,71 +60,14 @@ void HardFault_Handler(void)
 
 __attribute__((used)) void HardFault_HandlerC(unsigned long *hardfault_args)
 {
-    //TODO Revisit and clean up this code
-    volatile unsigned long stacked_r0;
-    volatile unsigned long stacked_r1;
-    volatile unsigned long stacked_r2;
-    volatile unsigned long stacked_r3;
-    volatile unsigned long stacked_r12;
-    volatile unsigned long stacked_lr;
-    volatile unsigned long stacked_pc;
-    volatile unsigned long stacked_psr;
-    volatile unsigned long _CFSR;
-    volatile unsigned long _HFSR;
-    volatile unsigned long _DFSR;
-    volatile unsigned long _AFSR;
-    volatile unsigned long _BFAR;
-    volatile unsigned long _MMAR;
-
-    stacked_r0 = ((unsigned long)hardfault_args[0]);
-    stacked_r1 = ((unsigned long)hardfault_args[1]);
-    stacked_r2 = ((unsigned long)hardfault_args[2]);
-    stacked_r3 = ((unsigned long)hardfault_args[3]);
-    stacked_r12 = ((unsigned long)hardfault_args[4]);
-    stacked_lr = ((unsigned long)hardfault_args[5]);
-    stacked_pc = ((unsigned long)hardfault_args[6]);
-    stacked_psr = ((unsigned long)hardfault_args[7]);
-
-    // Configurable Fault Status Register
-    // Consists of MMSR, BFSR and UFSR
-    _CFSR = (*((volatile unsigned long *)(0xE000ED28)));
-
-    // Hard Fault Status Register
-    _HFSR = (*((volatile unsigned long *)(0xE000ED2C)));
-
-    // Debug Fault Status Register
-    _DFSR = (*((volatile unsigned long *)(0xE000ED30)));
-
-    // Auxiliary Fault Status Register
-    _AFSR = (*((volatile unsigned long *)(0xE000ED3C)));
-
-    // Read the Fault Address Registers. These may not contain valid values.
-
-    // Check BFARVALID/MMARVALID to see if they are valid values
-
-    // MemManage Fault Address Register
-    _MMAR = (*((volatile unsigned long *)(0xE000ED34)));
-
-    // Bus Fault Address Register
-    _BFAR = (*((volatile unsigned long *)(0xE000ED38)));
-
-    // Silence compiler warnings
-    UNUSED(stacked_r0);
-    UNUSED(stacked_r1);
-    UNUSED(stacked_r2);
-    UNUSED(stacked_r3);
-    UNUSED(stacked_r12);
-    UNUSED(stacked_lr);
-    UNUSED(stacked_pc);
-    UNUSED(stacked_psr);
-    UNUSED(_CFSR);
-    UNUSED(_HFSR);
-    UNUSED(_DFSR);
-    UNUSED(_AFSR);
-    UNUSED(_BFAR);
-    UNUSED(_MMAR);
-
-    __asm("BKPT #0\n") ; // Break into the debugger
+    /*
+     * The Cortex-M0+ does not have the configurable fault status registers,
+     * so the stacked registers are the most useful information available.
+     * Capture them into the crash record, then reset so the record can
+     * be retrieved after startup.
+     */
+    crash_record_capture_fault(CRASH_TYPE_HARD_FAULT, (const uint32_t *)hardfault_args);
+    crash_record_reset();
 }
 
 /******************************************************************************/
@@ -9,12 +9,16 @@
 
 #include "cdc_handler.h"
 #include "settings.h"
+#include "log_filter.h"
+#include "hid_handler.h"
 #include "keypad.h"
 #include "display.h"
 #include "light.h"
 #include "task_usbd.h"
 #include "task_sensor.h"
 #include "adc_handler.h"
+#include "power.h"
+#include "task_watchdog.h"
 #include "state_controller.h"
 
 extern SPI_HandleTypeDef hspi1;
@@ -47,6 +51,9 @@ static const osSemaphoreAttr_t task_start_semaphore_attributes = {
 
 #define TASK_SENSOR_STACK_SIZE (1024U)
 
+/* Long enough for the slowest measurement or settings operation */
+#define TASK_MAIN_WATCHDOG_DEADLINE_MS 10000U
+
 static task_params_t task_list[] = {
     {
         .task_func = task_main_run,
@@ -101,6 +108,11 @@ osStatus_t task_main_init()
         return osErrorNoMemory;
     }
 
+    /* Create the watchdog supervisor, which takes over refreshing the watchdog */
+    if (task_watchdog_init() != osOK) {
+        return osErrorNoMemory;
+    }
+
     /* Create the main task */
     task_list[0].task_handle = osThreadNew(task_list[0].task_func, NULL, &task_list[0].task_attrs);
     if (!task_list[0].task_handle) {
@@ -131,9 +143,15 @@ void task_main_run(void *argument)
     /* Load system settings */
     settings_init();
 
+    /* Apply any saved log level filters */
+    log_filter_load();
+
     /* Initialize the ADC handler */
     adc_handler_init();
 
+    /* Initialize the HID handler */
+    hid_handler_init();
+
     /* Initialize the state controller */
     state_controller_init();
 
@@ -155,6 +173,12 @@ void task_main_run(void *argument)
 
     main_task_running = true;
 
+    /* Start the power governor now that startup is complete */
+    power_init();
+
+    /* Startup is complete, so the main loop is now expected to keep running */
+    task_watchdog_register(TASK_MAIN_WATCHDOG_DEADLINE_MS);
+
     /* Run the infinite main loop */
     log_i("Starting controller loop");
     state_controller_loop();
@@ -15,6 +15,11 @@
 #include "light.h"
 #include "util.h"
 #include "cdc_handler.h"
+#include "power.h"
+#include "task_watchdog.h"
+
+/* Control events are all short register operations */
+#define SENSOR_WATCHDOG_DEADLINE_MS 2000U
 
 /**
  * Sensor control event types.
@@ -24,7 +29,8 @@ typedef enum {
     SENSOR_CONTROL_START,
     SENSOR_CONTROL_SET_CONFIG,
     SENSOR_CONTROL_SET_LIGHT_MODE,
-    SENSOR_CONTROL_INTERRUPT
+    SENSOR_CONTROL_INTERRUPT,
+    SENSOR_CONTROL_SELF_CHECK
 } sensor_control_event_type_t;
 
 typedef struct {
@@ -44,6 +50,11 @@ typedef struct {
     uint32_t reading_count;
 } sensor_control_interrupt_params_t;
 
+typedef struct {
+    uint8_t *device_id;
+    uint8_t *reg_mismatches;
+} sensor_control_self_check_params_t;
+
 /**
  * Sensor control event data.
  */
@@ -54,6 +65,7 @@ typedef struct {
         sensor_control_config_params_t config;
         sensor_control_light_mode_params_t light_mode;
         sensor_control_interrupt_params_t interrupt;
+        sensor_control_self_check_params_t self_check;
     };
 } sensor_control_event_t;
 
@@ -95,6 +107,7 @@ static osStatus_t sensor_control_stop();
 static osStatus_t sensor_control_set_config(const sensor_control_config_params_t *params);
 static osStatus_t sensor_control_set_light_mode(const sensor_control_light_mode_params_t *params);
 static osStatus_t sensor_control_interrupt(const sensor_control_interrupt_params_t *params);
+static osStatus_t sensor_control_self_check(const sensor_control_self_check_params_t *params);
 
 void task_sensor_run(void *argument)
 {
@@ -140,10 +153,15 @@ void task_sensor_run(void *argument)
         return;
     }
 
+    task_watchdog_register(SENSOR_WATCHDOG_DEADLINE_MS);
+
     /* Start the main control event loop */
     for (;;) {
+        task_watchdog_idle();
         if(osMessageQueueGet(sensor_control_queue, &control_event, NULL, portMAX_DELAY) == osOK) {
             osStatus_t ret = osOK;
+            task_watchdog_checkin();
+            task_watchdog_set_state(control_event.event_type);
             switch (control_event.event_type) {
             case SENSOR_CONTROL_STOP:
                 ret = sensor_control_stop();
@@ -160,6 +178,9 @@ void task_sensor_run(void *argument)
             case SENSOR_CONTROL_INTERRUPT:
                 ret = sensor_control_interrupt(&control_event.interrupt);
                 break;
+            case SENSOR_CONTROL_SELF_CHECK:
+                ret = sensor_control_self_check(&control_event.self_check);
+                break;
             default:
                 break;
             }
@@ -186,6 +207,9 @@ osStatus_t sensor_start()
 {
     if (!sensor_initialized) { return osErrorResource; }
 
+    /* Make sure the system is at full speed before the sensor starts */
+    power_request(POWER_SOURCE_SENSOR);
+
     osStatus_t result = osOK;
     sensor_control_event_t control_event = {
         .event_type = SENSOR_CONTROL_START,
@@ -250,6 +274,7 @@ osStatus_t sensor_stop()
     };
     osMessageQueuePut(sensor_control_queue, &control_event, 0, portMAX_DELAY);
     osSemaphoreAcquire(sensor_control_semaphore, portMAX_DELAY);
+    power_release(POWER_SOURCE_SENSOR);
     return result;
 }
 
@@ -306,6 +331,83 @@ osStatus_t sensor_control_set_config(const sensor_control_config_params_t *param
     return hal_to_os_status(ret);
 }
 
+osStatus_t sensor_self_check(uint8_t *device_id, uint8_t *reg_mismatches)
+{
+    if (!sensor_initialized) { return osErrorResource; }
+
+    osStatus_t result = osOK;
+    sensor_control_event_t control_event = {
+        .event_type = SENSOR_CONTROL_SELF_CHECK,
+        .result = &result,
+        .self_check = {
+            .device_id = device_id,
+            .reg_mismatches = reg_mismatches
+        }
+    };
+    osMessageQueuePut(sensor_control_queue, &control_event, 0, portMAX_DELAY);
+    osSemaphoreAcquire(sensor_control_semaphore, portMAX_DELAY);
+    return result;
+}
+
+osStatus_t sensor_control_self_check(const sensor_control_self_check_params_t *params)
+{
+    /* Configurations that between them set and clear every config bit */
+    static const struct {
+        tsl2591_gain_t gain;
+        tsl2591_time_t time;
+    } patterns[] = {
+        { TSL2591_GAIN_MEDIUM, TSL2591_TIME_200MS },
+        { TSL2591_GAIN_HIGH, TSL2591_TIME_400MS },
+        { TSL2591_GAIN_MAXIMUM, TSL2591_TIME_600MS },
+        { TSL2591_GAIN_LOW, TSL2591_TIME_100MS }
+    };
+    HAL_StatusTypeDef ret = HAL_OK;
+    uint8_t mismatches = 0;
+    log_d("sensor_control_self_check");
+
+    /* Changing the config would disrupt readings in progress */
+    if (sensor_running) {
+        return osErrorResource;
+    }
+
+    do {
+        ret = tsl2591_get_device_id(&hi2c1, params->device_id);
+        if (ret != HAL_OK) { break; }
+
+        ret = tsl2591_set_enable(&hi2c1, TSL2591_ENABLE_PON);
+        if (ret != HAL_OK) { break; }
+
+        for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+            tsl2591_gain_t gain;
+            tsl2591_time_t time;
+
+            ret = tsl2591_set_config(&hi2c1, patterns[i].gain, patterns[i].time);
+            if (ret != HAL_OK) { break; }
+
+            ret = tsl2591_get_config(&hi2c1, &gain, &time);
+            if (ret != HAL_OK) { break; }
+
+            if (gain != patterns[i].gain || time != patterns[i].time) {
+                log_w("Config mismatch: wrote %d,%d, read %d,%d",
+                    patterns[i].gain, patterns[i].time, gain, time);
+                mismatches++;
+            }
+        }
+        if (ret != HAL_OK) { break; }
+
+        /* Leave the config as the next sensor_start() expects to find it */
+        ret = tsl2591_set_config(&hi2c1, sensor_gain, sensor_time);
+    } while (0);
+
+    tsl2591_set_enable(&hi2c1, 0x00);
+
+    if (params->reg_mismatches) {
+        *(params->reg_mismatches) = mismatches;
+    }
+
+    return hal_to_os_status(ret);
+}
+
 osStatus_t sensor_set_light_mode(sensor_light_t light, bool next_cycle, uint8_t value)
 {
     if (!sensor_initialized) { return osErrorResource; }
@@ -371,7 +473,13 @@ osStatus_t sensor_get_next_reading(sensor_reading_t *reading, uint32_t timeout)
         return osErrorParameter;
     }
 
-    return osMessageQueueGet(sensor_reading_queue, reading, NULL, timeout);
+    osStatus_t ret = osMessageQueueGet(sensor_reading_queue, reading, NULL, timeout);
+
+    /* Long measurement loops count as progress for as long as readings keep arriving */
+    if (ret == osOK) {
+        task_watchdog_checkin();
+    }
+    return ret;
 }
 
 void sensor_int_handler()
@@ -442,6 +550,7 @@ osStatus_t sensor_control_interrupt(const sensor_control_interrupt_params_t *par
         reading.reading_ticks = params->sensor_ticks;
         reading.light_ticks = params->light_ticks;
         reading.reading_count = params->reading_count;
+        reading.status = status;
 
         has_channel_data = true;
     } while (0);
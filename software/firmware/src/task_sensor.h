@@ -46,6 +46,19 @@ osStatus_t sensor_stop();
  */
 osStatus_t sensor_set_config(tsl2591_gain_t gain, tsl2591_time_t time);
 
+/**
+ * Check that the sensor responds on the bus and holds its configuration.
+ *
+ * This reads the device ID, then writes a series of configurations and
+ * reads each one back. It can only be used while the sensor is disabled,
+ * and leaves it disabled with its previous configuration.
+ *
+ * @param device_id Value read from the device ID register
+ * @param reg_mismatches Number of configurations that did not read back as written
+ * @return osOK if every bus transfer succeeded, osErrorResource if the sensor is running
+ */
+osStatus_t sensor_self_check(uint8_t *device_id, uint8_t *reg_mismatches);
+
 /**
  * Change the state of the sensor read light sources.
  *
@@ -13,7 +13,7 @@
 static volatile bool usbd_initialized = false;
 static bool suspend_pending = false;
 
-#define HID_BUFFER_LEN 32
+#define HID_BUFFER_LEN 64
 
 static char hid_buffer[HID_BUFFER_LEN];
 static size_t hid_buffer_len = 0;
@@ -227,8 +227,9 @@ void usbd_hid_send(const char *str, size_t len)
     hid_has_key = false;
 
     /* Iterate through the input string, and add HID-supported characters */
-    for (size_t i = 0; i < len; i++) {
+    for (size_t i = 0; i < len && hid_buffer_len < HID_BUFFER_LEN; i++) {
         char ch = str[i];
+        if ((uint8_t)ch >= 128) { continue; }
         uint8_t keycode = hid_conv_table[(size_t)ch][1];
         if (keycode > 0) {
             hid_buffer[hid_buffer_len++] = ch;
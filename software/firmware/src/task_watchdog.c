@@ -0,0 +1,168 @@
+#include "task_watchdog.h"
+
+#define LOG_TAG "task_watchdog"
+#include <elog.h>
+
+#include "stm32l0xx_hal.h"
+#include <printf.h>
+#include <cmsis_os.h>
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "watchdog_policy.h"
+#include "crash_record.h"
+#include "util.h"
+
+/*
+ * The hardware watchdog times out after as little as ~290ms when the LSI
+ * is running at the top of its range, so this leaves plenty of margin.
+ */
+#define TASK_WATCHDOG_PERIOD_MS  100U
+#define TASK_WATCHDOG_STACK_SIZE (512U)
+
+static void task_watchdog_run(void *argument);
+static int task_watchdog_find_client();
+static void task_watchdog_expire(int client, uint32_t late_ticks);
+static const char *task_watchdog_state_name(eTaskState state);
+
+static const osThreadAttr_t task_watchdog_attrs = {
+    .name = "watchdog",
+    .stack_size = TASK_WATCHDOG_STACK_SIZE,
+    .priority = osPriorityAboveNormal
+};
+
+/* Supervisor state, only accessed from within critical sections */
+static watchdog_policy_t watchdog_policy;
+static osThreadId_t watchdog_threads[WATCHDOG_POLICY_MAX_CLIENTS] = {0};
+
+osStatus_t task_watchdog_init()
+{
+    watchdog_policy_init(&watchdog_policy);
+
+    if (!osThreadNew(task_watchdog_run, NULL, &task_watchdog_attrs)) {
+        log_e("watchdog_task create error");
+        return osErrorNoMemory;
+    }
+    return osOK;
+}
+
+void task_watchdog_run(void *argument)
+{
+    UNUSED(argument);
+    log_d("watchdog_task start");
+
+    for (;;) {
+        uint32_t late_ticks = 0;
+
+        taskENTER_CRITICAL();
+        int client = watchdog_policy_find_overdue(&watchdog_policy, osKernelGetTickCount(), &late_ticks);
+        taskEXIT_CRITICAL();
+
+        if (client >= 0) {
+            task_watchdog_expire(client, late_ticks);
+        }
+
+        watchdog_refresh();
+        osDelay(TASK_WATCHDOG_PERIOD_MS);
+    }
+}
+
+osStatus_t task_watchdog_register(uint32_t deadline_ms)
+{
+    osThreadId_t thread = osThreadGetId();
+
+    taskENTER_CRITICAL();
+    int client = watchdog_policy_register(&watchdog_policy, osThreadGetName(thread),
+        pdMS_TO_TICKS(deadline_ms), osKernelGetTickCount());
+    if (client >= 0) {
+        watchdog_threads[client] = thread;
+    }
+    taskEXIT_CRITICAL();
+
+    if (client < 0) {
+        log_e("Unable to supervise task: %s", osThreadGetName(thread));
+        return osErrorResource;
+    }
+    return osOK;
+}
+
+void task_watchdog_checkin()
+{
+    taskENTER_CRITICAL();
+    watchdog_policy_checkin(&watchdog_policy, task_watchdog_find_client(), osKernelGetTickCount());
+    taskEXIT_CRITICAL();
+}
+
+void task_watchdog_idle()
+{
+    taskENTER_CRITICAL();
+    watchdog_policy_idle(&watchdog_policy, task_watchdog_find_client());
+    taskEXIT_CRITICAL();
+}
+
+void task_watchdog_set_state(uint32_t state)
+{
+    taskENTER_CRITICAL();
+    watchdog_policy_set_state(&watchdog_policy, task_watchdog_find_client(), state);
+    taskEXIT_CRITICAL();
+}
+
+int task_watchdog_find_client()
+{
+    const osThreadId_t thread = osThreadGetId();
+    for (int i = 0; i < watchdog_policy.count; i++) {
+        if (watchdog_threads[i] == thread) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void task_watchdog_expire(int client, uint32_t late_ticks)
+{
+    char detail[CRASH_RECORD_DETAIL_LEN];
+    const watchdog_client_t *info = &watchdog_policy.clients[client];
+    TaskHandle_t handle = (TaskHandle_t)watchdog_threads[client];
+    const eTaskState task_state = eTaskGetState(handle);
+
+    snprintf(detail, sizeof(detail), "%s,state=%lu,late=%lums",
+        task_watchdog_state_name(task_state), info->state, late_ticks * portTICK_PERIOD_MS);
+
+    /*
+     * Nothing is logged here, since the stalled task may be holding
+     * the lock on the log output.
+     */
+    taskDISABLE_INTERRUPTS();
+
+    /*
+     * The saved stack pointer is the first member of the task control
+     * block, and the Cortex-M0 port stacks R4-R11 below the exception
+     * frame when switching out a task. This makes it possible to record
+     * where the stalled task was, rather than where the supervisor is.
+     */
+    const uint32_t *frame = NULL;
+    if (task_state == eReady || task_state == eBlocked || task_state == eSuspended) {
+        frame = *(uint32_t * const *)handle + 8;
+    }
+
+    crash_record_capture_task(CRASH_TYPE_WATCHDOG, info->name, frame, detail);
+    crash_record_reset();
+}
+
+const char *task_watchdog_state_name(eTaskState state)
+{
+    switch (state) {
+    case eRunning:
+        return "running";
+    case eReady:
+        return "ready";
+    case eBlocked:
+        return "blocked";
+    case eSuspended:
+        return "suspended";
+    case eDeleted:
+        return "deleted";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,51 @@
+/*
+ * Watchdog supervisor task, which only refreshes the hardware watchdog
+ * while every supervised task is meeting its check-in deadline.
+ */
+
+#ifndef TASK_WATCHDOG_H
+#define TASK_WATCHDOG_H
+
+#include <stdint.h>
+#include <cmsis_os.h>
+
+/**
+ * Creates the supervisor task, which will run when the scheduler is started.
+ *
+ * Once this task is running, it is the only thing that refreshes the
+ * hardware watchdog during normal operation.
+ */
+osStatus_t task_watchdog_init();
+
+/**
+ * Start supervising the calling task.
+ *
+ * The task starts out busy, and must check in at least once per deadline
+ * until it marks itself idle. If it misses a deadline, its name and state
+ * are saved in the crash record and the system is reset.
+ *
+ * @param deadline_ms Longest time allowed between check-ins
+ * @return osOK on success
+ */
+osStatus_t task_watchdog_register(uint32_t deadline_ms);
+
+/**
+ * Check in for the calling task, marking it as busy.
+ *
+ * Does nothing if the calling task is not supervised, so this can be
+ * used from code shared between tasks.
+ */
+void task_watchdog_checkin();
+
+/**
+ * Mark the calling task as idle, before it blocks waiting for work.
+ */
+void task_watchdog_idle();
+
+/**
+ * Set a code describing what the calling task is doing, which is saved
+ * along with its name if it misses a deadline.
+ */
+void task_watchdog_set_state(uint32_t state);
+
+#endif /* TASK_WATCHDOG_H */
@@ -61,7 +61,7 @@ HAL_StatusTypeDef tsl2591_init(I2C_HandleTypeDef *hi2c)
 
     log_i("Device ID: %02X", data);
 
-    if (data != 0x50) {
+    if (data != TSL2591_DEVICE_ID) {
         log_e("Invalid Device ID");
         return HAL_ERROR;
     }
@@ -198,6 +198,23 @@ HAL_StatusTypeDef tsl2591_set_persist(I2C_HandleTypeDef *hi2c, tsl2591_persist_t
     return ret;
 }
 
+HAL_StatusTypeDef tsl2591_get_device_id(I2C_HandleTypeDef *hi2c, uint8_t *id)
+{
+    if (!id) {
+        return HAL_ERROR;
+    }
+
+    HAL_StatusTypeDef ret = HAL_I2C_Mem_Read(hi2c, TSL2591_ADDRESS,
+        TSL2591_CMD_NORMAL | TSL2591_ID, I2C_MEMADD_SIZE_8BIT,
+        id, 1, HAL_MAX_DELAY);
+
+    if (ret != HAL_OK) {
+        log_e("i2c_read_register error: %d", ret);
+    }
+
+    return ret;
+}
+
 HAL_StatusTypeDef tsl2591_get_status(I2C_HandleTypeDef *hi2c, uint8_t *value)
 {
     if (!value) {
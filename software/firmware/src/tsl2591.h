@@ -9,6 +9,9 @@
 
 #include "stm32l0xx_hal.h"
 
+/* Value of the device ID register */
+#define TSL2591_DEVICE_ID 0x50
+
 typedef enum {
     TSL2591_GAIN_LOW = 0,
     TSL2591_GAIN_MEDIUM = 1,
@@ -99,6 +102,8 @@ typedef enum {
 
 HAL_StatusTypeDef tsl2591_init(I2C_HandleTypeDef *hi2c);
 
+HAL_StatusTypeDef tsl2591_get_device_id(I2C_HandleTypeDef *hi2c, uint8_t *id);
+
 HAL_StatusTypeDef tsl2591_set_enable(I2C_HandleTypeDef *hi2c, uint8_t value);
 HAL_StatusTypeDef tsl2591_enable(I2C_HandleTypeDef *hi2c);
 HAL_StatusTypeDef tsl2591_disable(I2C_HandleTypeDef *hi2c);
@@ -9,12 +9,18 @@
 #include "board_config.h"
 
 static SPI_HandleTypeDef *u8g2_hspi;
+static volatile uint32_t u8g2_spi_error_count = 0;
 
 void u8g2_stm32_hal_init(SPI_HandleTypeDef *hspi)
 {
     u8g2_hspi = hspi;
 }
 
+uint32_t u8g2_stm32_hal_get_error_count()
+{
+    return u8g2_spi_error_count;
+}
+
 uint8_t u8g2_stm32_spi_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
 {
     /* log_i("spi_byte_cb: Received a msg: %d, arg_int: %d, arg_ptr: %p", msg, arg_int, arg_ptr); */
@@ -32,6 +38,7 @@ uint8_t u8g2_stm32_spi_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void
         HAL_StatusTypeDef ret = HAL_SPI_Transmit(u8g2_hspi, (uint8_t *)arg_ptr, arg_int, HAL_MAX_DELAY);
         if (ret != HAL_OK) {
             log_e("HAL_SPI_Transmit error: %d", ret);
+            u8g2_spi_error_count++;
         }
         break;
     }
@@ -5,6 +5,14 @@
 #include "u8g2.h"
 
 void u8g2_stm32_hal_init(SPI_HandleTypeDef *hspi);
+
+/**
+ * Get the number of display transfers that have failed since startup.
+ *
+ * The display has no way to acknowledge what it receives, so this is
+ * the only sign of a problem with the bus.
+ */
+uint32_t u8g2_stm32_hal_get_error_count();
 uint8_t u8g2_stm32_spi_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr);
 uint8_t u8g2_stm32_gpio_and_delay_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr);
 
@@ -0,0 +1,57 @@
+#include "ui_strings.h"
+
+#include "settings.h"
+
+extern const ui_language_info_t ui_language_list[UI_LANGUAGE_COUNT];
+
+static const ui_language_info_t *ui_current_language()
+{
+    uint8_t language = settings_get_user_language();
+    if (language >= UI_LANGUAGE_COUNT) {
+        language = UI_LANGUAGE_EN;
+    }
+    return &ui_language_list[language];
+}
+
+const char *ui_str(ui_string_t id)
+{
+    if (id >= STR_COUNT) { return ""; }
+
+    const ui_language_info_t *info = ui_current_language();
+    return info->text + info->index[id];
+}
+
+const char *ui_str_lang(ui_language_t language, ui_string_t id)
+{
+    if (language >= UI_LANGUAGE_COUNT || id >= STR_COUNT) { return ""; }
+
+    const ui_language_info_t *info = &ui_language_list[language];
+    return info->text + info->index[id];
+}
+
+const uint8_t *ui_font()
+{
+    return ui_current_language()->font;
+}
+
+uint8_t ui_line_columns()
+{
+    return ui_current_language()->columns;
+}
+
+size_t ui_text_columns(const char *str)
+{
+    size_t columns = 0;
+    if (!str) { return 0; }
+
+    while (*str) {
+        uint8_t ch = (uint8_t)*str++;
+        if (ch < 0x80) {
+            columns++;
+        } else if ((ch & 0xC0) == 0xC0) {
+            /* Lead bytes of 0xC2 and 0xC3 encode the rest of Latin-1 */
+            columns += (ch <= 0xC3) ? 1 : 2;
+        }
+    }
+    return columns;
+}
@@ -0,0 +1,56 @@
+/*
+ * Localized text for the device display.
+ *
+ * All of the text shown by the menus and states is looked up by ID from
+ * per-language string tables, which are generated from the catalogs in
+ * the strings directory by tools/strings-gen.py as part of the build.
+ * Each language also has its own menu font, which only contains the
+ * glyphs its strings need along with printable ASCII.
+ */
+#ifndef UI_STRINGS_H
+#define UI_STRINGS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ui_strings_data.h"
+
+typedef struct {
+    const char *text;      /*!< Every string of the language, each NUL terminated */
+    const uint16_t *index; /*!< Offset of each string within the text */
+    const uint8_t *font;   /*!< Menu font for the language, in u8g2 format */
+    uint8_t columns;       /*!< Width of a display line, in character cells */
+} ui_language_info_t;
+
+/**
+ * Get a string in the language selected in the user settings.
+ */
+const char *ui_str(ui_string_t id);
+
+/**
+ * Get a string in a specific language.
+ *
+ * This is used where text has to stay the same regardless of the
+ * display language, such as in the USB command interface.
+ */
+const char *ui_str_lang(ui_language_t language, ui_string_t id);
+
+/**
+ * Get the menu font for the language selected in the user settings.
+ */
+const uint8_t *ui_font();
+
+/**
+ * Get the width of a display line in the menu font, in character cells.
+ */
+uint8_t ui_line_columns();
+
+/**
+ * Get the width of a string, in character cells of the menu font.
+ *
+ * Characters from the Latin-1 range take a single cell,
+ * and all other characters are full-width and take two cells.
+ */
+size_t ui_text_columns(const char *str);
+
+#endif /* UI_STRINGS_H */
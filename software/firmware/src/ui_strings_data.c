@@ -0,0 +1,667 @@
+/*
+ * Localized string tables, generated by tools/strings-gen.py
+ * from the catalogs in strings/. Do not edit.
+ */
+#include "ui_strings.h"
+
+#include "u8g2.h"
+
+static const char ui_text_en[935] =
+    "Reflection\nTransmission\nSensor Gain\nSensor Slope\nProfiles\0"
+    "Target Light\nDisplay Format\nUSB Key Output\nDiagnostics\0"
+    "Hold device\nfirmly closed\nwith no film\0"
+    "Position\nCAL-HI firmly\nunder sensor\0"
+    "Position\nCAL-LO firmly\nunder sensor\0"
+    "Calibration\nSettings\nAbout\0"
+    "calibration\nvalues invalid\0"
+    "initialization\nfailed\0"
+    "calibration\ncanceled\0"
+    "calibration\ncomplete\0"
+    "Invalid\ncalibration\0"
+    "calibration\nnot set\0"
+    "calibration\nfailed\0"
+    "Sensor\nread error\0"
+    "CAL-HI (Black)\n\0"
+    "CAL-LO (White)\n\0"
+    "Calibrating...\0"
+    "Display Format\0"
+    "Remote\nControl\0"
+    "USB Key Output\0"
+    "Unable\nto load\0"
+    "Unable\nto save\0"
+    " Load \n Save \0"
+    "** Measure **\0"
+    "Cal Profiles\0"
+    "Measuring...\0"
+    "Read invalid\0"
+    "Sensor Slope\0"
+    "Target Light\0"
+    "Target moved\0"
+    "Transmission\0"
+    "Calibration\0"
+    "Sensor Gain\0"
+    "Lid opened\0"
+    "Reflection\0"
+    " Measure \0"
+    "Main Menu\0"
+    "Saturated\0"
+    "Language\0"
+    "Settings\0"
+    "Enabled\0"
+    "Profile\0"
+    "Timeout\0"
+    " Load \0"
+    "Custom\0"
+    "Medium\0"
+    "Number\0"
+    "Sensor\0"
+    "Comma\0"
+    "Empty\0"
+    "Enter\0"
+    "Refl.\0"
+    "Space\0"
+    "Tran.\0"
+    "Units\0"
+    " OK \0"
+    "#,##\0"
+    "#.##\0"
+    "Fmt.\0"
+    "Full\0"
+    "High\0"
+    "None\0"
+    "Sep.\0"
+    "Slot\0"
+    "Low\0"
+    "N/A\0"
+    "Tab\0"
+    "Yes\0"
+    "DE\0"
+    "EN\0"
+    "FR\0"
+    "JA\0"
+    "No\0"
+    "D\0"
+    "F";
+
+static const uint16_t ui_index_en[STR_COUNT] = {
+    660, 745, 245, 695, 647, 672, 608, 49, 621, 466, 496, 101,
+    555, 819, 224, 0, 58, 716, 569, 762, 806, 451, 582, 634,
+    726, 595, 684, 895, 300, 321, 251, 382, 362, 526, 511, 278,
+    342, 401, 435, 419, 188, 152, 113, 481, 855, 706, 778, 548,
+    541, 831, 843, 770, 799, 849, 736, 754, 870, 890, 885, 900,
+    792, 880, 928, 912, 799, 875, 785, 825, 908, 813, 837, 904,
+    865, 860, 931, 933, 919, 916, 922, 925
+};
+
+/* Glyphs of u8g2_font_pxplusibmvga9_tf used by this language */
+static const uint8_t ui_font_en[1256] U8G2_FONT_SECTION("ui_font_en") =
+    "_\000\003\003\004\004\003\005\005\010\017\000\375\012\375\012\000\001y\003&"
+    "\004\312 \005\000\204\031!\014\244\2069\222CE\244,\222\000\042\012F\275\031"
+    "\042&I(\002#\022\227\2049J\022\311EI\042\222H.J\022\011\000$\022\347tyRYEF"
+    "\034\227\245C\232\244(\025\001%\013\207\204\031\302\231PoC\001&\023\247\204Y"
+    "3\211H\042[\241LD\022\221D$\232\010'\010C\2759*\024\000(\011\244\206Y\022%"
+    "\275))\012\244\206\0312%\275(\001*\015X\2249\042\031\351\020\242\211$\000+"
+    "\012V\225YB\221I(\002,\010C~9*\024\000-\006\027\244\031\007.\006\042\207\031"
+    "\004/\012\207\204\331Q\241^\303\0000\022\250\204Y4\221D\310\042\241H\210D"
+    "\211HF\0021\012\246\205Y\262\021Q\237\0142\015\247\2049\025\231T\250W\331A"
+    "\0003\017\247\2049\025\231T\211,\225\322$\025\0004\016\247\204\231\302\031I"
+    "\242$9J\025\0115\016\247\204\031\007\251\252Y*\245I*\0006\016\247\204Y3\241T"
+    "j\221q\223T\0007\014\247\204\031\007\231TQ\2536\0008\016\247\2049\025\031"
+    "\233\244\042\343&\251\0009\015\247\2049\025\031\233\304\252QD\002:\007r\217"
+    "\031d\002;\012\203\2069\3520\011\005\000<\010\226\205\2312]u=\010F\235\031v"
+    "\250\001>\011\226\205\031R\335t\004\077\015\247\2049\025\031M\250\252\016U"
+    "\002@\014\227\2049\025\031\213\227\211\270\002A\015\247\204y\321\231D\215v"
+    "\240q\023B\023\247\204\031&\025\221D$)\251\210$\042\211\350\020\001C\016\247"
+    "\204Y$\021q\252cD$\242\000D\024\247\204\0315\211HE$\021ID\022\221D$Q)\001E"
+    "\023\247\204\031\027\221D\026\221\304h\222\230T\026\021\035\004F\021\247\204"
+    "\031\027\221D\026\221\304h\222\230T\221\006G\020\247\204Y$\021q\252b\243ID"
+    "\242I\000H\013\247\204\0312n\007\032o\002I\011\244\206\031\024\221~!J\017"
+    "\247\204yD\251.\042\211H\042\022\221\000K\022\247\204\031#\211H\042\222(\321"
+    "h\022\221\212\250$L\014\247\204\031D\251\276ED\007\001M\015\250\204\031\302"
+    "\322\341EB\344Q\000N\015\247\204\031\262\222\345@1\325\270\011O\013\247\2049"
+    "\025\031\177\223T\000P\017\247\204\031&\025\221D$)I5\322\000Q\015\307t9\025"
+    "\031\277DX\252\322\001R\022\247\204\031&\025\221D$)ID*\042\211\250$S\020\247"
+    "\2049\025\031M\042\036\213i4I\005\000T\016\250\204\031\207\211d$\212\211\365"
+    "J\002U\012\247\204\0312\376MR\001V\015\250\204\031B~\224\210dT\031\000W\017"
+    "\250\204\031B\276H(\222\303D\244\005\000X\021\250\204\031B\242D$\243\212\245"
+    "4\221DH\024Y\016\250\204\031BF\211HF\025k%\001Z\015\250\204\031\207\341P\252"
+    "\327\341a\000[\010\244\206\031&\375D\134\012\227\204\031a\351^\305\001]\010"
+    "\244\206\031$\375d^\012G\304y\321\231DM\000_\007\030t\031\207\000`\0103\316"
+    "\031\022\221\000a\017w\2049dQE$\021ID\242\211\000b\022\247\204\031SU\232D"
+    "\244\042\222\210$\042I\005\000c\013w\2049\025\031U\233\244\002d\022\247\204y"
+    "S5\222DI\042\222\210$\042\321D\000e\014w\2049\025\331\201\252&\251\000f\016"
+    "\246\204Y#\211RDF\023j#\001g\024\247l9\023\222D$\021ID\022\221\250*\021\211H"
+    "\000h\021\247\204\031S-\242\211\222D$\021ID%\001i\012\244\2069\042\351H/\004"
+    "j\016\326m\231\352\240\241\036I$\011\005\000k\017\247\204\031SM\022%\032M"
+    "\042\022\225\004l\011\244\206\031#\375\205\000m\021x\204\031#\311a\042\241H("
+    "\022\212\204\242\000n\021w\204\031\222\221\212H\042\222\210$\042\211H\000o"
+    "\013w\2049\025\031o\222\012\000p\023\247l\031\222\221\212H\042\222\210$\042I"
+    "I*\244\001q\021\247l9\023\222D$\021ID\022\221\250\252Hr\015w\204\031\222\321"
+    "DI\042U\244\001s\016w\2049\025\231D<\226\310$\025\000t\015\247\204yQ5\233T"
+    "\027\331\004\000u\021w\204\031\042\211H\042\222\210$\042\211H4\021v\014x\204"
+    "\031B\216\022\221\214*\003w\016x\204\031B.\022\212\3440\021I\000x\017x\204"
+    "\031B\211HF\225\322D\022\241\000y\015\247l\0312\276I\254BI\011\000z\013w\204"
+    "\031\007\221P\267\203\000{\014\246\205y#\241\322T\250u\000|\011\242\207\031"
+    "\207\320a\000}\014\246\205\031S\241\352H\250i\006~\011'\3049\023\312\004\000"
+    "\000\000\000\004\377\377\000\000";
+
+static const char ui_text_de[940] =
+    "Auflicht\nDurchlicht\nSensor-Gain\nSensorsteigung\nProfile\0"
+    "Ziellicht\nAnzeigeformat\nUSB-Tastatur\nDiagnose\0"
+    "CAL-HI fest\nunter den\nSensor legen\0"
+    "CAL-LO fest\nunter den\nSensor legen\0"
+    "Ger\303\244t ohne\nFilm fest\ngeschlossen\0"
+    "Kalibrierung\nEinstellungen\nInfo\0"
+    "Kalibrierung\nfehlgeschlagen\0"
+    "Kalibrierung\nabgeschlossen\0"
+    "Kalibrierung\nnicht gesetzt\0"
+    "Kalibrierung\nabgebrochen\0"
+    "Kalibrierwerte\nung\303\274ltig\0"
+    "Speichern\nfehlgeschlagen\0"
+    "Ung\303\274ltige\nKalibrierung\0"
+    "Laden\nfehlgeschlagen\0"
+    "Start\nfehlgeschlagen\0"
+    "Sensor-\nLesefehler\0"
+    "CAL-HI\n(Schwarz)\0"
+    "CAL-LO (Wei\303\237)\n\0"
+    "Fern-\nsteuerung\0"
+    "Sensorsteigung\0"
+    "Anzeigeformat\0"
+    "Einstellungen\0"
+    "Kalibriere...\0"
+    "Laden\nSichern\0"
+    "** Messen **\0"
+    "Deckel offen\0"
+    "Kal.-Profile\0"
+    "USB-Tastatur\0"
+    "\303\234bersteuert\0"
+    "Sensor-Gain\0"
+    "Durchlicht\0"
+    "Hauptmen\303\274\0"
+    "Ung\303\274ltig\0"
+    "Ziellicht\0"
+    " Messen \0"
+    "Auflicht\0"
+    "Messe...\0"
+    "Einheit\0"
+    "Sprache\0"
+    "Bewegt\0"
+    "Gering\0"
+    "Leerz.\0"
+    "Mittel\0"
+    "Profil\0"
+    "Sensor\0"
+    "Aktiv\0"
+    "Dauer\0"
+    "Eigen\0"
+    "Enter\0"
+    "Keine\0"
+    "Komma\0"
+    "Laden\0"
+    "Platz\0"
+    "Refl.\0"
+    "Trans\0"
+    " OK \0"
+    "#,##\0"
+    "#.##\0"
+    "Fmt.\0"
+    "Hoch\0"
+    "Leer\0"
+    "Nein\0"
+    "Voll\0"
+    "Zahl\0"
+    "k.A.\0"
+    "Tab\0"
+    "Tr.\0"
+    "DE\0"
+    "EN\0"
+    "FR\0"
+    "JA\0"
+    "Ja\0"
+    "D\0"
+    "F";
+
+static const uint16_t ui_index_de[STR_COUNT] = {
+    405, 557, 232, 727, 676, 664, 528, 47, 708, 543, 638, 92,
+    599, 888, 205, 0, 55, 687, 625, 789, 796, 571, 736, 761,
+    651, 698, 612, 845, 319, 265, 344, 237, 292, 369, 418, 439,
+    394, 460, 496, 479, 136, 101, 171, 512, 863, 718, 839, 591,
+    585, 851, 857, 809, 903, 745, 753, 803, 878, 917, 827, 768,
+    782, 883, 893, 933, 903, 898, 815, 821, 913, 833, 775, 908,
+    873, 868, 936, 938, 924, 921, 927, 930
+};
+
+/* Glyphs of u8g2_font_pxplusibmvga9_tf used by this language */
+static const uint8_t ui_font_de[1322] U8G2_FONT_SECTION("ui_font_de") =
+    "c\000\003\003\004\004\003\005\005\010\017\000\375\012\375\012\000\001y\003&"
+    "\005\014 \005\000\204\031!\014\244\2069\222CE\244,\222\000\042\012F\275\031"
+    "\042&I(\002#\022\227\2049J\022\311EI\042\222H.J\022\011\000$\022\347tyRYEF"
+    "\034\227\245C\232\244(\025\001%\013\207\204\031\302\231PoC\001&\023\247\204Y"
+    "3\211H\042[\241LD\022\221D$\232\010'\010C\2759*\024\000(\011\244\206Y\022%"
+    "\275))\012\244\206\0312%\275(\001*\015X\2249\042\031\351\020\242\211$\000+"
+    "\012V\225YB\221I(\002,\010C~9*\024\000-\006\027\244\031\007.\006\042\207\031"
+    "\004/\012\207\204\331Q\241^\303\0000\022\250\204Y4\221D\310\042\241H\210D"
+    "\211HF\0021\012\246\205Y\262\021Q\237\0142\015\247\2049\025\231T\250W\331A"
+    "\0003\017\247\2049\025\231T\211,\225\322$\025\0004\016\247\204\231\302\031I"
+    "\242$9J\025\0115\016\247\204\031\007\251\252Y*\245I*\0006\016\247\204Y3\241T"
+    "j\221q\223T\0007\014\247\204\031\007\231TQ\2536\0008\016\247\2049\025\031"
+    "\233\244\042\343&\251\0009\015\247\2049\025\031\233\304\252QD\002:\007r\217"
+    "\031d\002;\012\203\2069\3520\011\005\000<\010\226\205\2312]u=\010F\235\031v"
+    "\250\001>\011\226\205\031R\335t\004\077\015\247\2049\025\031M\250\252\016U"
+    "\002@\014\227\2049\025\031\213\227\211\270\002A\015\247\204y\321\231D\215v"
+    "\240q\023B\023\247\204\031&\025\221D$)\251\210$\042\211\350\020\001C\016\247"
+    "\204Y$\021q\252cD$\242\000D\024\247\204\0315\211HE$\021ID\022\221D$Q)\001E"
+    "\023\247\204\031\027\221D\026\221\304h\222\230T\026\021\035\004F\021\247\204"
+    "\031\027\221D\026\221\304h\222\230T\221\006G\020\247\204Y$\021q\252b\243ID"
+    "\242I\000H\013\247\204\0312n\007\032o\002I\011\244\206\031\024\221~!J\017"
+    "\247\204yD\251.\042\211H\042\022\221\000K\022\247\204\031#\211H\042\222(\321"
+    "h\022\221\212\250$L\014\247\204\031D\251\276ED\007\001M\015\250\204\031\302"
+    "\322\341EB\344Q\000N\015\247\204\031\262\222\345@1\325\270\011O\013\247\2049"
+    "\025\031\177\223T\000P\017\247\204\031&\025\221D$)I5\322\000Q\015\307t9\025"
+    "\031\277DX\252\322\001R\022\247\204\031&\025\221D$)ID*\042\211\250$S\020\247"
+    "\2049\025\031M\042\036\213i4I\005\000T\016\250\204\031\207\211d$\212\211\365"
+    "J\002U\012\247\204\0312\376MR\001V\015\250\204\031B~\224\210dT\031\000W\017"
+    "\250\204\031B\276H(\222\303D\244\005\000X\021\250\204\031B\242D$\243\212\245"
+    "4\221DH\024Y\016\250\204\031BF\211HF\025k%\001Z\015\250\204\031\207\341P\252"
+    "\327\341a\000[\010\244\206\031&\375D\134\012\227\204\031a\351^\305\001]\010"
+    "\244\206\031$\375d^\012G\304y\321\231DM\000_\007\030t\031\207\000`\0103\316"
+    "\031\022\221\000a\017w\2049dQE$\021ID\242\211\000b\022\247\204\031SU\232D"
+    "\244\042\222\210$\042I\005\000c\013w\2049\025\031U\233\244\002d\022\247\204y"
+    "S5\222DI\042\222\210$\042\321D\000e\014w\2049\025\331\201\252&\251\000f\016"
+    "\246\204Y#\211RDF\023j#\001g\024\247l9\023\222D$\021ID\022\221\250*\021\211H"
+    "\000h\021\247\204\031S-\242\211\222D$\021ID%\001i\012\244\2069\042\351H/\004"
+    "j\016\326m\231\352\240\241\036I$\011\005\000k\017\247\204\031SM\022%\032M"
+    "\042\022\225\004l\011\244\206\031#\375\205\000m\021x\204\031#\311a\042\241H("
+    "\022\212\204\242\000n\021w\204\031\222\221\212H\042\222\210$\042\211H\000o"
+    "\013w\2049\025\031o\222\012\000p\023\247l\031\222\221\212H\042\222\210$\042I"
+    "I*\244\001q\021\247l9\023\222D$\021ID\022\221\250\252Hr\015w\204\031\222\321"
+    "DI\042U\244\001s\016w\2049\025\231D<\226\310$\025\000t\015\247\204yQ5\233T"
+    "\027\331\004\000u\021w\204\031\042\211H\042\222\210$\042\211H4\021v\014x\204"
+    "\031B\216\022\221\214*\003w\016x\204\031B.\022\212\3440\021I\000x\017x\204"
+    "\031B\211HF\225\322D\022\241\000y\015\247l\0312\276I\254BI\011\000z\013w\204"
+    "\031\007\221P\267\203\000{\014\246\205y#\241\322T\250u\000|\011\242\207\031"
+    "\207\320a\000}\014\246\205\031S\241\352H\250i\006~\011'\3049\023\312\004\000"
+    "\334\015\267\204\03129@\306\337$\025\000\337\020\247\2049$\025\221D$QR\221q"
+    "\222\000\344\021\247\204\031\0429\022YT\021ID\022\221h\042\374\024\247\204"
+    "\031\0429\212H\042\222\210$\042\211H\042\022M\004\000\000\000\004\377\377"
+    "\000\000";
+
+static const char ui_text_fr[992] =
+    "R\303\251flexion\nTransmission\nGain capteur\nPente capteur\nProfils\0"
+    "Lumi\303\250re cible\nFormat affich.\nSortie clavier\nDiagnostic\0"
+    "Placer CAL-HI\nfermement sous\nle capteur\0"
+    "Placer CAL-LO\nfermement sous\nle capteur\0"
+    "\303\211talonnage\nR\303\251glages\n\303\200 propos\0"
+    "Enregistrement\nimpossible\0"
+    "initialisation\n\303\251chou\303\251e\0"
+    "valeurs \303\251tal.\ninvalides\0"
+    "\303\251talonnage\nnon d\303\251fini\0"
+    "Erreur lecture\ncapteur\0"
+    "Tenir ferm\303\251\nsans film\0"
+    "Chargement\nimpossible\0"
+    "Commande\n\303\240 distance\0"
+    "\303\211talonnage\ninvalide\0"
+    "\303\251talonnage\ntermin\303\251\0"
+    "\303\251talonnage\n\303\251chou\303\251\0"
+    "\303\251talonnage\nannul\303\251\0"
+    "CAL-LO (Blanc)\n\0"
+    "CAL-HI (Noir)\n\0"
+    "Charger\nSauver\0"
+    "Format affich.\0"
+    "Lumi\303\250re cible\0"
+    "Menu principal\0"
+    "Profils \303\251tal.\0"
+    "Sortie clavier\0"
+    "\303\211talonnage...\0"
+    "** Mesurer **\0"
+    "Cible boug\303\251e\0"
+    "Pente capteur\0"
+    "Capot ouvert\0"
+    "Gain capteur\0"
+    "Transmission\0"
+    "\303\211talonnage\0"
+    "R\303\251flexion\0"
+    " Mesurer \0"
+    "Mesure...\0"
+    "R\303\251glages\0"
+    "Invalide\0"
+    "Activ\303\251\0"
+    "Capteur\0"
+    "Charger\0"
+    "Complet\0"
+    "Entr\303\251e\0"
+    "Satur\303\251\0"
+    "Virgule\0"
+    "\303\211lev\303\251\0"
+    "D\303\251lai\0"
+    "Espace\0"
+    "Faible\0"
+    "Langue\0"
+    "Nombre\0"
+    "Perso.\0"
+    "Profil\0"
+    "R\303\251fl.\0"
+    "Unit\303\251\0"
+    "Aucun\0"
+    "Empl.\0"
+    "Moyen\0"
+    "S\303\251p.\0"
+    "Tran.\0"
+    " OK \0"
+    "#,##\0"
+    "#.##\0"
+    "Fmt.\0"
+    "Vide\0"
+    "N/A\0"
+    "Non\0"
+    "Oui\0"
+    "Tab\0"
+    "DE\0"
+    "EN\0"
+    "FR\0"
+    "JA\0"
+    "D\0"
+    "F";
+
+static const uint16_t ui_index_fr[STR_COUNT] = {
+    716, 759, 217, 728, 703, 690, 663, 51, 560, 545, 605, 104,
+    635, 955, 195, 0, 59, 575, 590, 884, 786, 620, 749, 649,
+    818, 769, 677, 911, 479, 437, 278, 458, 303, 227, 373, 253,
+    416, 327, 499, 515, 155, 115, 350, 395, 935, 739, 794, 538,
+    530, 891, 929, 842, 870, 898, 863, 778, 950, 923, 905, 856,
+    917, 834, 964, 968, 870, 802, 877, 810, 972, 826, 849, 960,
+    945, 940, 988, 990, 979, 976, 982, 985
+};
+
+/* Glyphs of u8g2_font_pxplusibmvga9_tf used by this language */
+static const uint8_t ui_font_fr[1333] U8G2_FONT_SECTION("ui_font_fr") =
+    "d\000\003\003\004\004\003\005\005\010\017\000\375\012\375\012\000\001y\003&"
+    "\005\027 \005\000\204\031!\014\244\2069\222CE\244,\222\000\042\012F\275\031"
+    "\042&I(\002#\022\227\2049J\022\311EI\042\222H.J\022\011\000$\022\347tyRYEF"
+    "\034\227\245C\232\244(\025\001%\013\207\204\031\302\231PoC\001&\023\247\204Y"
+    "3\211H\042[\241LD\022\221D$\232\010'\010C\2759*\024\000(\011\244\206Y\022%"
+    "\275))\012\244\206\0312%\275(\001*\015X\2249\042\031\351\020\242\211$\000+"
+    "\012V\225YB\221I(\002,\010C~9*\024\000-\006\027\244\031\007.\006\042\207\031"
+    "\004/\012\207\204\331Q\241^\303\0000\022\250\204Y4\221D\310\042\241H\210D"
+    "\211HF\0021\012\246\205Y\262\021Q\237\0142\015\247\2049\025\231T\250W\331A"
+    "\0003\017\247\2049\025\231T\211,\225\322$\025\0004\016\247\204\231\302\031I"
+    "\242$9J\025\0115\016\247\204\031\007\251\252Y*\245I*\0006\016\247\204Y3\241T"
+    "j\221q\223T\0007\014\247\204\031\007\231TQ\2536\0008\016\247\2049\025\031"
+    "\233\244\042\343&\251\0009\015\247\2049\025\031\233\304\252QD\002:\007r\217"
+    "\031d\002;\012\203\2069\3520\011\005\000<\010\226\205\2312]u=\010F\235\031v"
+    "\250\001>\011\226\205\031R\335t\004\077\015\247\2049\025\031M\250\252\016U"
+    "\002@\014\227\2049\025\031\213\227\211\270\002A\015\247\204y\321\231D\215v"
+    "\240q\023B\023\247\204\031&\025\221D$)\251\210$\042\211\350\020\001C\016\247"
+    "\204Y$\021q\252cD$\242\000D\024\247\204\0315\211HE$\021ID\022\221D$Q)\001E"
+    "\023\247\204\031\027\221D\026\221\304h\222\230T\026\021\035\004F\021\247\204"
+    "\031\027\221D\026\221\304h\222\230T\221\006G\020\247\204Y$\021q\252b\243ID"
+    "\242I\000H\013\247\204\0312n\007\032o\002I\011\244\206\031\024\221~!J\017"
+    "\247\204yD\251.\042\211H\042\022\221\000K\022\247\204\031#\211H\042\222(\321"
+    "h\022\221\212\250$L\014\247\204\031D\251\276ED\007\001M\015\250\204\031\302"
+    "\322\341EB\344Q\000N\015\247\204\031\262\222\345@1\325\270\011O\013\247\2049"
+    "\025\031\177\223T\000P\017\247\204\031&\025\221D$)I5\322\000Q\015\307t9\025"
+    "\031\277DX\252\322\001R\022\247\204\031&\025\221D$)ID*\042\211\250$S\020\247"
+    "\2049\025\031M\042\036\213i4I\005\000T\016\250\204\031\207\211d$\212\211\365"
+    "J\002U\012\247\204\0312\376MR\001V\015\250\204\031B~\224\210dT\031\000W\017"
+    "\250\204\031B\276H(\222\303D\244\005\000X\021\250\204\031B\242D$\243\212\245"
+    "4\221DH\024Y\016\250\204\031BF\211HF\025k%\001Z\015\250\204\031\207\341P\252"
+    "\327\341a\000[\010\244\206\031&\375D\134\012\227\204\031a\351^\305\001]\010"
+    "\244\206\031$\375d^\012G\304y\321\231DM\000_\007\030t\031\207\000`\0103\316"
+    "\031\022\221\000a\017w\2049dQE$\021ID\242\211\000b\022\247\204\031SU\232D"
+    "\244\042\222\210$\042I\005\000c\013w\2049\025\031U\233\244\002d\022\247\204y"
+    "S5\222DI\042\222\210$\042\321D\000e\014w\2049\025\331\201\252&\251\000f\016"
+    "\246\204Y#\211RDF\023j#\001g\024\247l9\023\222D$\021ID\022\221\250*\021\211H"
+    "\000h\021\247\204\031S-\242\211\222D$\021ID%\001i\012\244\2069\042\351H/\004"
+    "j\016\326m\231\352\240\241\036I$\011\005\000k\017\247\204\031SM\022%\032M"
+    "\042\022\225\004l\011\244\206\031#\375\205\000m\021x\204\031#\311a\042\241H("
+    "\022\212\204\242\000n\021w\204\031\222\221\212H\042\222\210$\042\211H\000o"
+    "\013w\2049\025\031o\222\012\000p\023\247l\031\222\221\212H\042\222\210$\042I"
+    "I*\244\001q\021\247l9\023\222D$\021ID\022\221\250\252Hr\015w\204\031\222\321"
+    "DI\042U\244\001s\016w\2049\025\231D<\226\310$\025\000t\015\247\204yQ5\233T"
+    "\027\331\004\000u\021w\204\031\042\211H\042\222\210$\042\211H4\021v\014x\204"
+    "\031B\216\022\221\214*\003w\016x\204\031B.\022\212\3440\021I\000x\017x\204"
+    "\031B\211HF\225\322D\022\241\000y\015\247l\0312\276I\254BI\011\000z\013w\204"
+    "\031\007\221P\267\203\000{\014\246\205y#\241\322T\250u\000|\011\242\207\031"
+    "\207\320a\000}\014\246\205\031S\241\352H\250i\006~\011'\3049\023\312\004\000"
+    "\300\017\307\204\231bYt&Q\243\035h\334\004\311\020\307\204yBu\340E$\221\226"
+    "\244J\007\001\340\021\267\2049bu\030YT\021ID\022\221h\042\350\017\267\2049bu"
+    "XEv\240\252I*\000\351\016\267\204\231\332\201\025\331\201\252&\251\000\000"
+    "\000\000\004\377\377\000\000";
+
+static const char ui_text_ja[1121] =
+    "\345\217\215\345\260\204\n\351\200\217\351\201\216\n\343\202\273\343\203\263\343\202\265\343\202\262\343\202\244\343\203\263\n\343\202\273\343\203\263\343\202\265\345\202\276\343\201\215\n\343\203\227\343\203\255\343\203\225\343\202\241\343\202\244\343\203\253\0"
+    "\343\203\225\343\202\243\343\203\253\343\203\240\343\201\252\343\201\227\343\201\247\n\343\201\227\343\201\243\343\201\213\343\202\212\n\351\226\211\343\201\230\343\201\246\343\201\217\343\201\240\343\201\225\343\201\204\0"
+    "\343\202\277\343\203\274\343\202\262\343\203\203\343\203\210\345\205\211\n\350\241\250\347\244\272\345\275\242\345\274\217\nUSB\343\202\255\343\203\274\345\207\272\345\212\233\n\350\250\272\346\226\255\0"
+    "CAL-HI\343\202\222\n\343\202\273\343\203\263\343\202\265\343\201\256\344\270\213\343\201\253\n\347\275\256\343\201\204\343\201\246\343\201\217\343\201\240\343\201\225\343\201\204\0"
+    "CAL-LO\343\202\222\n\343\202\273\343\203\263\343\202\265\343\201\256\344\270\213\343\201\253\n\347\275\256\343\201\204\343\201\246\343\201\217\343\201\240\343\201\225\343\201\204\0"
+    "\343\202\273\343\203\263\343\202\265\n\350\252\255\343\201\277\345\217\226\343\202\212\343\202\250\343\203\251\343\203\274\0"
+    "\345\210\235\346\234\237\345\214\226\343\201\253\n\345\244\261\346\225\227\343\201\227\343\201\276\343\201\227\343\201\237\0"
+    "\346\240\241\346\255\243\343\201\214\n\345\256\214\344\272\206\343\201\227\343\201\276\343\201\227\343\201\237\0"
+    "\346\240\241\346\255\243\343\201\253\n\345\244\261\346\225\227\343\201\227\343\201\276\343\201\227\343\201\237\0"
+    "\346\240\241\346\255\243\343\202\222\n\344\270\255\346\255\242\343\201\227\343\201\276\343\201\227\343\201\237\0"
+    "\350\252\255\343\201\277\350\276\274\343\201\277\n\343\201\247\343\201\215\343\201\276\343\201\233\343\202\223\0"
+    "\346\240\241\346\255\243\343\201\214\n\346\234\252\350\250\255\345\256\232\343\201\247\343\201\231\0"
+    "\346\240\241\346\255\243\345\200\244\343\201\214\n\347\204\241\345\212\271\343\201\247\343\201\231\0"
+    "\346\240\241\346\255\243\343\203\227\343\203\255\343\203\225\343\202\241\343\202\244\343\203\253\0"
+    "\344\277\235\345\255\230\n\343\201\247\343\201\215\343\201\276\343\201\233\343\202\223\0"
+    "\346\240\241\346\255\243\343\201\214\n\347\204\241\345\212\271\343\201\247\343\201\231\0"
+    "\343\203\241\343\202\244\343\203\263\343\203\241\343\203\213\343\203\245\343\203\274\0"
+    "\346\240\241\346\255\243\n\350\250\255\345\256\232\n\346\203\205\345\240\261\0"
+    "\343\203\252\343\203\242\343\203\274\343\203\210\n\345\210\266\345\276\241\0"
+    "\343\201\265\343\201\237\343\201\214\351\226\213\343\201\204\343\201\237\0"
+    "\343\202\273\343\203\263\343\202\265\343\202\262\343\202\244\343\203\263\0"
+    "\343\202\277\343\203\274\343\202\262\343\203\203\343\203\210\345\205\211\0"
+    " \350\252\255\350\276\274 \n \344\277\235\345\255\230 \0"
+    "USB\343\202\255\343\203\274\345\207\272\345\212\233\0"
+    "\343\202\273\343\203\263\343\202\265\345\202\276\343\201\215\0"
+    "\347\204\241\345\212\271\343\201\252\346\270\254\345\256\232\0"
+    "CAL-HI (\351\273\222)\n\0"
+    "CAL-LO (\347\231\275)\n\0"
+    "** \346\270\254\345\256\232 **\0"
+    "\343\202\253\343\202\271\343\202\277\343\203\240\0"
+    "\343\202\271\343\203\232\343\203\274\343\202\271\0"
+    "\343\202\271\343\203\255\343\203\203\343\203\210\0"
+    "\344\275\215\347\275\256\343\201\232\343\202\214\0"
+    "\346\240\241\346\255\243\344\270\255...\0"
+    "\346\266\210\347\201\257\346\231\202\351\226\223\0"
+    "\346\270\254\345\256\232\344\270\255...\0"
+    "\350\241\250\347\244\272\345\275\242\345\274\217\0"
+    "\343\201\204\343\201\204\343\201\210\0"
+    "\343\202\253\343\203\263\343\203\236\0"
+    "\343\202\273\343\203\263\343\202\265\0"
+    "\345\214\272\345\210\207\343\202\212\0"
+    " \346\270\254\345\256\232 \0"
+    " \350\252\255\350\276\274 \0"
+    "\343\201\252\343\201\227\0"
+    "\343\201\257\343\201\204\0"
+    "\345\215\230\344\275\215\0"
+    "\345\217\215\345\260\204\0"
+    "\345\256\214\345\205\250\0"
+    "\346\225\260\345\200\244\0"
+    "\346\234\211\345\212\271\0"
+    "\346\240\241\346\255\243\0"
+    "\347\251\272\343\201\215\0"
+    "\350\250\200\350\252\236\0"
+    "\350\250\255\345\256\232\0"
+    "\351\200\217\351\201\216\0"
+    "\351\243\275\345\222\214\0"
+    "Enter\0"
+    " OK \0"
+    "#,##\0"
+    "#.##\0"
+    "Tab\0"
+    "\344\270\255\0"
+    "\344\275\216\0"
+    "\351\253\230\0"
+    "--\0"
+    "DE\0"
+    "EN\0"
+    "FR\0"
+    "JA\0"
+    "D\0"
+    "F";
+
+static const uint16_t ui_index_ja[STR_COUNT] = {
+    1023, 1044, 621, 995, 1051, 667, 739, 49, 686, 903, 723, 173,
+    799, 1030, 607, 0, 125, 585, 514, 49, 936, 864, 890, 851,
+    1058, 755, 648, 838, 404, 346, 488, 375, 462, 539, 433, 314,
+    562, 282, 785, 771, 231, 180, 68, 628, 1071, 956, 965, 714,
+    705, 995, 1051, 877, 1009, 988, 1037, 1016, 909, 946, 974, 1094,
+    1090, 1098, 916, 981, 1009, 1002, 812, 1065, 1086, 926, 825, 1102,
+    1081, 1076, 1117, 1119, 1108, 1105, 1111, 1114
+};
+
+/* Glyphs of u8g2_font_b12_t_japanese2 used by this language */
+static const uint8_t ui_font_ja[3948] U8G2_FONT_SECTION("ui_font_ja") =
+    "\330\000\003\002\004\004\004\005\005\014\014\000\376\012\376\010\377\001P"
+    "\002\244\003\326 \005\000\250-!\007q\013-\006%\042\0103Z-\022K\000#\015e\011"
+    "m*\203RJ\222A\251\000$\016\225\371\254\262\245\242d[\242T\266\010%\012u\011-"
+    "\244)\3534\011&\016u\011m\262$J\262J\042EJ\000'\0061[-\006(\013\223\372\254"
+    "\222(\211jQ\026)\014\223\372,\262(\213*Q\022\001*\014u\011\255*\225-[\232"
+    "\042\000+\012U\031\255\302h\220\302\010,\0103\371l\224!\001-\007\0259-\006"
+    "\001.\007\042\012-\206\000/\013u\011-\2630+f!\0000\012t\012m\224\310S\242"
+    "\0001\011s\012m\022\251\313\0002\013u\011m\226,\314\332\006\0013\014u\011-"
+    "\0061\313T-Y\0004\015u\011\3552))%\203\026&\0005\013u\011-\216C\032j\311\002"
+    "6\015u\011\255\244,\034\222LK\026\0007\013u\011-\0061\013\263\260\0048\015u"
+    "\011m\226LK\226LK\026\0009\015u\011m\226LK\2060\213$\000:\010R\012-\206h\010"
+    ";\011c\371l\214\312\220\000<\010S\032\255\222Z\001=\0105)-\006u\020>\010S"
+    "\032-\262J\011\077\013u\011m\226\2541\207\042\000@\015u\011m\226L\031\222D"
+    "\031\322\005A\013u\011m\226L\033\206\314\026B\016u\011-\206\250\022%S%\032"
+    "\024\000C\013u\011m\226LlK\026\000D\017u\011-\206\250\022%Q\022%\321\240\000"
+    "E\013u\011-\216\341\220\204\341 F\013u\011-\216\341\220\204E\000G\013u\011m"
+    "\226L,m\311\002H\013u\011-2\3330d\266\000I\011s\012-\226\250\313\000J\013u"
+    "\011\255\266\260%\212$\000K\015u\011-2))iIT\311\002L\011u\011-\302\036\007"
+    "\001M\013u\011-\262eI4\267\000N\014u\011-2mR\022i\323\002O\012u\011m\226\314"
+    "[\262\000P\014u\011-\206$\323\006%,\002Q\013u\011m\226\314%\221\042%R\015u"
+    "\011-\206$\323\006\245T\311\002S\013u\011m\226L]\265d\001T\011u\011-\006)"
+    "\354\011U\011u\011-2\337\222\005V\014u\011-2\267\244\224d\021\000W\012u\011-"
+    "2/\211\322\005X\014u\011-2-\251UjZ\000Y\013u\011-2-\251\205M\000Z\012u\011-"
+    "\0061\3538\010[\011\223\372,\206\250O\003\134\012u\011-\3220-\246\001]\011"
+    "\223\372,\246>\015\001^\0105Y\255\262\244\026_\007\025\351,\006\001`\0073Z-"
+    "\262\002a\012U\011m\326d\320\222!b\014u\011-\302pH2\333\240\000c\012U\011m"
+    "\226L\314\222\005d\013u\011-+\203fK\206\000e\012U\011m\226lP\322\005f\013u"
+    "\011\255\244J\266\2055\000g\014u\351l\226\314\226\014a\262\000h\013u\011-"
+    "\302pH2\267\000i\010s\012mB\251ej\013\224\352\354b\255MJ\024\000k\013u\011-"
+    "\302\232\224L\225,l\010s\012-\244^\006m\014U\011-\224\026%Q\022\245\000n\011"
+    "U\011-\022\223f\013o\012U\011m\226\314\226,\000p\014u\351,\206$\263\015J\030"
+    "\002q\013u\351l\006\315\226\014a\001r\011U\011-\022\223X\004s\011U\011m\006"
+    "\365\240\000t\013u\011\255\302h\220\302\252\000u\011U\011-2'E\011v\012U\011-"
+    "2[R\213\000w\012U\011-2K\242t\001x\012U\011-\262\244V\251\005y\012u\351,2[Rk"
+    "\004z\011U\011-\006\255m\020{\013\223\372\254\222\250\222E\265\000|\006\221"
+    "\373,\036}\013\223\372,\262\250\226D\225\010~\0125)m\042%\221\022\000\000"
+    "\000\000\004\377\3770D\023\211\011yr$\214\342$Nr@\012\223b\024\0030H\025\271"
+    "\371\370rH'\014:\222\0039\220\003r\024f\325\0010K\030\252\371\270r(\214\006"
+    "\255T\213\262\250\226di\026&Q\016\250\0000L\031\252\371\270\302$\012\223a+"
+    "\325\242,\252%Y\232\205I\224\003*\0000M\024\267\372\370\342e\310\201\203\016"
+    "dKm\007r`H\0000O\013\244\373\370Jma[\0000U\026\270\372\370r G\222a\220s$\033"
+    "\222\242\222#:2\0010W\014\247\3738\342~M\042M\0030X\020\247\3738\342,\321"
+    "\022\271k\022i\032\0000Y\024\271\371xs$\033\256\361\032\245Q\274#9\020\253"
+    "\0000Z\030\272\371x\223j\222\014\2078\007\346(\216r`\207r$\007d\0000[\025"
+    "\252\371\270\323,\315\206\203\232\245Y\032\3059\226cC\0040_\027\271\371\370r"
+    "$\035\326\034\011\245H\313\221\034\211\302,\014\207\0000`\031\272\371\370r(K"
+    "\206!)\345P\250Eb\016\345P5K\303!\0010c\013V\372\270\026-\0153\0110f\023\231"
+    "\011\271\207;\222\0039\220#9\222C9\264\0000g\025\232\010\271\227a\207\222b"
+    "\224d9\224C9\226c\023\0000j\032\272\371\370r(\007\006)\013\223(\314\322,\215"
+    "\262!\315\304,\0117\0000k\027\251\371xr$\224\042-Gr$G\2620\013\223hHr\0000n"
+    "\027\232\011\371\2064\211\262(K\262P\013\245T\012#1\0074\0000o\030\252\371x"
+    "\322,]\222A\212\2438\212\243l\210jJ\242%\245\0150u\025\252\371\370rl\247\345"
+    "P1\252EY\022FJ\026\217\0000~\027\270\3728s \033\0061\007\226A\007\302!\313"
+    "\226,JF\0000\177\030\252\371x\206\034\312\241r\024\016[\222)Q\226(a\026\346H"
+    "\0100\212\021\266\3738\243,\311D\227(\311\3220\223\0000\214\027\272\371\270r"
+    "(\207\0425\211\242!\013\273\211\231\030%\251\224\0030\222\026\271\3718s$\035"
+    "\326\034\010\225\251&'i\224\346\320\240\0000\223\026\252\3718s(Gr(Grh\316"
+    "\322,\023\243$\225\0000\241\014f\3728N\245-\015C\0000\243\014u\3728k\231\242"
+    "\204\025\0000\244\014\247\372\270\253\305I\212;\0010\250\022z\011y\206A\315"
+    "\241\034\312\241\034J\207C\0000\253\024\270\372\370r \007\302a\320\372\024Fa"
+    "\222\212\012\0000\255\030\271\3718s$G\206d\320\221\034\031\016:\222#9\222#"
+    "\031\0000\262\030\253\371\270\322$J\223h\030\302,\015\2539\226C9\224#:\0000"
+    "\265\026\252\371\370\252Y\232E\303!\253fi\226#9\222\003*\0000\271\025\232"
+    "\371x\206!\207r(Gr(G\312Y\246\356@\0000\273\025\252\370\370r(\207\262C4\210"
+    "\2654\212s(\307\006\0050\277\024\251\3718sd\320\302(\235\224\034\320\201\034"
+    "\210U\0310\303\017w\372\270\302\250RJ\2628\324D\0000\310\015\266\3738\322"
+    "\326-RB\265\0250\313\013j\031\271\206\235\017\017\0010\325\022\231\3718\336"
+    "\221\034\311\201\034\311\201\034\210U\0310\327\030\272\371\370\001\035\210"
+    "\206C\216\344P\216\344P\216\344H\016\310:\0020\332\023\212\031\371\001\035"
+    "\2102I\213\3220\213s,\307\0020\336\022\211\0119\336\221\034\310\201L\212u("
+    "\207\042\0000\340\025\251\3718s$Gr G\252YX\212\206d\010s$0\341\024\251\372"
+    "\370\201\034\311\221LKw$\007\2224\213T\0350\342\024\212\011y\206!\315\241x8d"
+    "9\224C96(\0000\345\013G\012y\206\2704\014\0010\351\023\251\371x\206!\247\016"
+    "w$\007r$\007bq\0050\352\014\246\3738B\037\253a\246\0010\353\026\252\371x\343"
+    "(\216\342(\216\262\250\026uK\262L\313!\0000\355\013\210\0129\236=\017\20780"
+    "\363\023\231\3718t(\315\221\034\310\221\034\310\201X\234\0010\374\010\030J9"
+    "\016\002N\013\030\273\3508\036\324\034\313\261\035\211r \213s,\307r,\307R"
+    "\000N-\030\311\3518s$\034\016Y\246eZ6\034\302\034\311\221\034\311\221\020N"
+    "\206\026\271\3518\336\201\034\210u Gr$Gr$Gr@\004OM\032\313\350\370\312Y\234"
+    "\245\3110Dq\244\204I)+e\245bT\254\016\007ON \313\350\370Bq\220\2454\211\322d"
+    "\030\022%\312\222R\232da\262\204b\022\305R2(\001O\335\036\313\350\270r,\031"
+    "\266$\214\212Q4,b:\034\222l\214\222Z\022\225\264J\030\002P$#\313\350\270\302"
+    "4\031\206(\254\015RRK\224d\220\222Z\224$\203\224\324\242$\031\244$G\222a\020"
+    "P\276\042\313\350\270r,\031\206(\254DC\224$Rb\031\242$j\211\206(I\244\3220"
+    "\205J\024\211\001QI\035\313\350x\343,\012\243b\224\344H<\034\302$G\352@\224"
+    "\003Q\026e\331:\004Qh\032\313\350xs,\207\222\034\310\322\322pPs,\007\0169"
+    "\220c\351p\020Q\372\026\311\3518s$\215\372\3230\244a\226i\231\226i\331p\010R"
+    "\007\036\273\350x\242aH\322(\211\224h\320\242$\215\2224J\242\246%\213\2634"
+    "\314,\000R\035\036\313\350\270r,\032\016R1\252\225Z\242h\252(Q\244DZ\224\225"
+    "\212Q\222)\000R6\037\313\350x\312I-J\006%\222\262h8e\245dP\242\244S\322)\351"
+    "\224$j\226\012R\233\027\311\3518s$G\302\341\230\205Y\230\025\2630J\223XU\000"
+    "R\271\037\313\350\370\312Y6,i2\014IT\322\224\250\022\325JY\224EI-\311B-S\000"
+    "S\026\033\313\350\370\242\034\210r \252\225\262JfK\2628\213\2638+e\245p\010S"
+    ":\031\272\3518\036\344(\216\022)\253da-\311\242,Jr\340A\207\000SX\034\313"
+    "\350\270ja\224\204\303\020F\305a\010\243\3420\344@:\034\324\034\313\261\024S"
+    "\315\032\272\350\270\206A\312\241\034\032\206,\315\222(L\242,\0233-\2222US"
+    "\326\037\274\3508\356@\224\014R5\032\222,j\311\206(\311\242,\034\042MJ\242XL"
+    "\343\000T\214\036\313\3508\345\035\213\006-\312\206A+e\321\222E\212\226\224"
+    "\262\244\224I\321\240\345\000X1\042\314\350\270rhP\006\255e\030\242,J\006M"
+    "\312\222aHj\025iP\2420K\304L\312\212\001Y1\033\313\350xs \312\201(\007\016Y9"
+    "K\207\203\232CI\016diI\007\004[X\031\313\3508s,\036\016b\016%\203\330Q\031"
+    "\006%L\3034L3\015[\214\032\313\350x\323\341\035\222\006)g\031\016b\222#u "
+    "\312\242,[\207\000[\232\033\313\350x\323\341\035\322\241h\030r \307r \032"
+    "\302(\007\2248R\323A\134\004 \313\350\270\342h\010\243b4\034\222(\214\206$*)"
+    "\225AJB1K\302D\012CM\001_\017\033\313\350\270s,\311\221(\031\016r:\354@\224"
+    "\003Y\234\305Ke\325\261\004_b\037\313\350\370\221h\230\262\250\030U\242J\224"
+    "\014S\026e\245\226(M\2420\252EY\224\001_\241!\313\350x\352Hq\210\206E\211*"
+    "\3210$\265(Y\222!\351\224tJZ\006i\220\2628\002`\305!\314\350\270\3028\031"
+    "\206,\214\223a\333Re\270DY\030\015b\224\205\321 FY\030E\022\000eW \313\350"
+    "\270\323!I\243dP\242$\212\006-\212\224\322\020iQ\226\015\221\230\224j\225,"
+    "\015ep \313\350\270\222b\322:\015\207$\312\224,RJI-\211\206E\213\262l\023"
+    "\223R\242\205\001e\255 \313\350\370\322$J\206HQ\302D\012\207\247\226d\211"
+    "\222\304\224(Q%j\031\266\034K\000fB\035\313\350\270\303eXja\222\205\311\360"
+    "\032%\303!\251EI\324\222Fk\016I\000g\011\033\313\350x\343\341\220\346P\016"
+    "\015C(f\3110\025\223lX\3034L3\005g\037\036\313\350\270\352@\224\014O-Q4$CT"
+    "\211\242!\211Z\206\247J-\311\214\231\000g*\032\313\350xs,\007\0169\220c\351p"
+    "PshV\022I\313\324\034K\001h!!\313\350\270\3024L\223\341 %a\224E\212\224$S"
+    "\222iI\224\204Y\222%a\224ek\000kb\036\313\350xs,\307r,\007\242\034\210\006-"
+    "\312\201(\007\242\034\210r J\207\203\000kc\033\273\350x\206s\216\345X\016D"
+    "\203\026\345@\224\003Q\016D9\020\245\303Am\210\034\312\350x\302T*&\221\226"
+    "\224\242a,\016S\022&\321\260D\241\026j\231\000n,!\313\3508r(I\206\244\026%"
+    "\211Ti\031\222Z\224\324\206\244$%-C\322$J5%\026po\036\313\350\270r,\031\206("
+    "\215\222Z\224\210\3250\015\323,\011\263(\213r \207$\000q!\034\313\350\270rl"
+    "\270(MI\247\341\220%\215I\323p\320\321(\211:iQ\001v}\020\307\352\370\3424"
+    "\034\006\325:\134\255\303 y:\027\273\350\270\206!g\033\016j\016D\305(\213"
+    "\262P\254\346\220\012zz\030\313\350x\323\341\251&\325J\265p\312\301a\220s,"
+    "\307\322\341 \177n\033\273\350x\206S%\212\206s:\034\3248\031\266$\314\222aK"
+    "\302l8\004\210h\031\313\350x\343\341\034\017\347t8hI\024JI\244Dr\026O\331*"
+    "\212\000\030\313\350\370\006\235\360\240\023\006\2356\350\244a\010\3230\015"
+    "\207!\002\212-\037\313\350x\0169\020EC\022%i\224$C\250\016\322\032G\321\020%"
+    "Q\255T\211\206M\212: \313\350x\304\034\313\206(\311\201,Y\242r\224,R\016eC"
+    "\242Ii\022e\322\220\210\000\212\236\042\313\350xvpX\206(G\006m\211r \312\206"
+    "C\016\016\311\240DI\226DI\226\014\311\240\000\212\255\035\313\350x\304\034x"
+    "\320rd\220vtX\2260N\222AJ\242\226\250\022%\3036\217\274\033\274\350xB9\314"
+    "\301\034\01479K\322\250\232\204\241\034%:\020\016C\000\220\017\037\314\3508"
+    "\007\261\016\034t`G\332\206(\322\222A\315\0221\213\302(\322\022\035\010\207!"
+    "\220N!\314\350x\007\2551Jv )\017C\262\244Y\222,Y\322-I\226,\011\245D\007\302"
+    "a\010\225\211 \313\3508\006e\330\222lX\206-\311\206eX3e\030\022Q\323\222L"
+    "\252)\221\246#\002\225\213!\313\3508\006e\330\222lX\206-\311\206e\330!e\030"
+    "\022-\311\224aH\244\232\222ej$\225\223 \313\3508\006e\330\222lX\206-\311\206"
+    "e\330!i\220\244,\222\006I\312\042i\220tD\230\375!\313\350\270\262XJ\243dX"
+    "\2060\211\222%\031\262\244\224%\311\220,M]\322$\321\206p\010\232\330\031\312"
+    "\351x\303\341\220\243\303X\034\246\341\240#\322\020I%i\210t@\236\322\034\273"
+    "\350x\206A\213\262l\030\264(\313\206A\316\201\203\034\017\207(\211*YT\000"
+    "\000";
+
+const ui_language_info_t ui_language_list[UI_LANGUAGE_COUNT] = {
+    { ui_text_en, ui_index_en, ui_font_en, 14 },
+    { ui_text_de, ui_index_de, ui_font_de, 14 },
+    { ui_text_fr, ui_index_fr, ui_font_fr, 14 },
+    { ui_text_ja, ui_index_ja, ui_font_ja, 21 }
+};
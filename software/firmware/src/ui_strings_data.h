@@ -0,0 +1,100 @@
+/*
+ * Localized string IDs, generated by tools/strings-gen.py
+ * from the catalogs in strings/. Do not edit.
+ */
+#ifndef UI_STRINGS_DATA_H
+#define UI_STRINGS_DATA_H
+
+typedef enum {
+    UI_LANGUAGE_EN = 0,
+    UI_LANGUAGE_DE,
+    UI_LANGUAGE_FR,
+    UI_LANGUAGE_JA,
+    UI_LANGUAGE_COUNT
+} ui_language_t;
+
+typedef enum {
+    STR_CALIBRATION = 0,
+    STR_SETTINGS,
+    STR_ABOUT,
+    STR_REFLECTION,
+    STR_TRANSMISSION,
+    STR_SENSOR_GAIN,
+    STR_SENSOR_SLOPE,
+    STR_PROFILES,
+    STR_TARGET_LIGHT,
+    STR_DISPLAY_FORMAT,
+    STR_USB_KEY_OUTPUT,
+    STR_DIAGNOSTICS,
+    STR_MEASURE,
+    STR_PROFILE_EMPTY,
+    STR_MENU_HOME,
+    STR_MENU_CALIBRATION,
+    STR_MENU_SETTINGS,
+    STR_MAIN_MENU,
+    STR_CAL_PROFILES,
+    STR_PROFILE,
+    STR_SENSOR,
+    STR_CALIBRATING,
+    STR_MEASURING,
+    STR_QUALITY_MOVED,
+    STR_QUALITY_SATURATED,
+    STR_QUALITY_INVALID,
+    STR_QUALITY_LID_OPEN,
+    STR_PROFILE_SLOT,
+    STR_CAL_CANCELED,
+    STR_CAL_COMPLETE,
+    STR_CAL_VALUES_INVALID,
+    STR_CAL_FAILED,
+    STR_CAL_NOT_SET,
+    STR_UNABLE_TO_SAVE,
+    STR_UNABLE_TO_LOAD,
+    STR_INIT_FAILED,
+    STR_INVALID_CALIBRATION,
+    STR_SENSOR_READ_ERROR,
+    STR_CAL_LO_WHITE,
+    STR_CAL_HI_BLACK,
+    STR_POSITION_CAL_LO,
+    STR_POSITION_CAL_HI,
+    STR_HOLD_CLOSED,
+    STR_REMOTE_CONTROL,
+    STR_BUTTON_OK,
+    STR_BUTTON_MEASURE,
+    STR_BUTTON_LOAD,
+    STR_BUTTON_SAVE,
+    STR_BUTTONS_LOAD_SAVE,
+    STR_SET_IDLE_REFL,
+    STR_SET_IDLE_TRAN,
+    STR_SET_IDLE_TIME,
+    STR_SET_DISP_SEP,
+    STR_SET_DISP_UNIT,
+    STR_SET_LANGUAGE,
+    STR_SET_KEY_EN,
+    STR_SET_KEY_FMT,
+    STR_SET_KEY_SEP,
+    STR_VAL_NONE,
+    STR_VAL_LOW,
+    STR_VAL_MEDIUM,
+    STR_VAL_HIGH,
+    STR_VAL_NO,
+    STR_VAL_YES,
+    STR_VAL_NUMBER,
+    STR_VAL_FULL,
+    STR_VAL_CUSTOM,
+    STR_VAL_ENTER,
+    STR_VAL_TAB,
+    STR_VAL_COMMA,
+    STR_VAL_SPACE,
+    STR_VAL_NOT_APPLICABLE,
+    STR_VAL_SEP_PERIOD,
+    STR_VAL_SEP_COMMA,
+    STR_VAL_UNIT_D,
+    STR_VAL_UNIT_F,
+    STR_LANGUAGE_EN,
+    STR_LANGUAGE_DE,
+    STR_LANGUAGE_FR,
+    STR_LANGUAGE_JA,
+    STR_COUNT
+} ui_string_t;
+
+#endif /* UI_STRINGS_DATA_H */
@@ -0,0 +1,73 @@
+#include "watchdog_policy.h"
+
+#include <string.h>
+
+void watchdog_policy_init(watchdog_policy_t *policy)
+{
+    if (!policy) { return; }
+    memset(policy, 0, sizeof(watchdog_policy_t));
+}
+
+int watchdog_policy_register(watchdog_policy_t *policy, const char *name,
+    uint32_t deadline_ticks, uint32_t now_ticks)
+{
+    if (!policy || policy->count >= WATCHDOG_POLICY_MAX_CLIENTS) {
+        return -1;
+    }
+
+    watchdog_client_t *client = &policy->clients[policy->count];
+    client->name = name;
+    client->deadline_ticks = deadline_ticks;
+    client->checkin_ticks = now_ticks;
+    client->state = 0;
+    client->busy = true;
+
+    return policy->count++;
+}
+
+void watchdog_policy_checkin(watchdog_policy_t *policy, int client, uint32_t now_ticks)
+{
+    if (!policy || client < 0 || client >= policy->count) { return; }
+    policy->clients[client].checkin_ticks = now_ticks;
+    policy->clients[client].busy = true;
+}
+
+void watchdog_policy_idle(watchdog_policy_t *policy, int client)
+{
+    if (!policy || client < 0 || client >= policy->count) { return; }
+    policy->clients[client].busy = false;
+}
+
+void watchdog_policy_set_state(watchdog_policy_t *policy, int client, uint32_t state)
+{
+    if (!policy || client < 0 || client >= policy->count) { return; }
+    policy->clients[client].state = state;
+}
+
+int watchdog_policy_find_overdue(const watchdog_policy_t *policy, uint32_t now_ticks, uint32_t *late_ticks)
+{
+    int result = -1;
+    uint32_t result_late = 0;
+
+    if (!policy) { return -1; }
+
+    for (int i = 0; i < policy->count; i++) {
+        const watchdog_client_t *client = &policy->clients[i];
+        if (!client->busy) { continue; }
+
+        /* Unsigned subtraction keeps this correct across tick count wraparound */
+        const uint32_t elapsed = now_ticks - client->checkin_ticks;
+        if (elapsed > client->deadline_ticks) {
+            const uint32_t late = elapsed - client->deadline_ticks;
+            if (result < 0 || late > result_late) {
+                result = i;
+                result_late = late;
+            }
+        }
+    }
+
+    if (result >= 0 && late_ticks) {
+        *late_ticks = result_late;
+    }
+    return result;
+}
@@ -0,0 +1,72 @@
+#ifndef WATCHDOG_POLICY_H
+#define WATCHDOG_POLICY_H
+
+/*
+ * Decision logic for the task watchdog supervisor.
+ *
+ * These functions only depend on the C standard library, so that the
+ * supervisor's policy can be built and exercised on a host machine
+ * separately from the RTOS specific code in task_watchdog.c.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WATCHDOG_POLICY_MAX_CLIENTS 6
+
+/**
+ * Task being supervised.
+ *
+ * A client is only expected to check in while it is busy. Before it
+ * blocks waiting for work that may legitimately never come, it marks
+ * itself idle, and is then left alone until its next check-in.
+ */
+typedef struct {
+    const char *name;        /*!< Name reported if the deadline is missed */
+    uint32_t deadline_ticks; /*!< Longest time allowed between check-ins */
+    uint32_t checkin_ticks;  /*!< Tick count of the last check-in */
+    uint32_t state;          /*!< Client defined code describing what it is doing */
+    bool busy;               /*!< Whether the client is currently supervised */
+} watchdog_client_t;
+
+typedef struct {
+    watchdog_client_t clients[WATCHDOG_POLICY_MAX_CLIENTS];
+    uint8_t count;
+} watchdog_policy_t;
+
+void watchdog_policy_init(watchdog_policy_t *policy);
+
+/**
+ * Add a client, which starts out busy as of the current time.
+ *
+ * @return Client index, or -1 if there is no room for another client
+ */
+int watchdog_policy_register(watchdog_policy_t *policy, const char *name,
+    uint32_t deadline_ticks, uint32_t now_ticks);
+
+/**
+ * Record that a client is making progress, starting a new deadline.
+ */
+void watchdog_policy_checkin(watchdog_policy_t *policy, int client, uint32_t now_ticks);
+
+/**
+ * Record that a client is about to wait for work, suspending its deadline.
+ */
+void watchdog_policy_idle(watchdog_policy_t *policy, int client);
+
+/**
+ * Set the code reported for a client if it misses its deadline.
+ */
+void watchdog_policy_set_state(watchdog_policy_t *policy, int client, uint32_t state);
+
+/**
+ * Find a client that has missed its deadline.
+ *
+ * The hardware watchdog should only be refreshed while this finds nothing.
+ *
+ * @param late_ticks Set to how far past its deadline the client is, may be NULL
+ * @return Index of the client that is furthest past its deadline, or -1 if all are healthy
+ */
+int watchdog_policy_find_overdue(const watchdog_policy_t *policy, uint32_t now_ticks, uint32_t *late_ticks);
+
+#endif /* WATCHDOG_POLICY_H */
@@ -0,0 +1,25 @@
+/*
+ * Stand-in for the CMSIS-RTOS2 API in host tests, with the types the
+ * firmware headers refer to. Tests provide any functions they need.
+ */
+#ifndef CMSIS_OS_H
+#define CMSIS_OS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    osOK = 0,
+    osError = -1,
+    osErrorTimeout = -2,
+    osErrorResource = -3,
+    osErrorParameter = -4,
+    osErrorNoMemory = -5,
+    osErrorISR = -6
+} osStatus_t;
+
+#define osWaitForever 0xFFFFFFFFU
+
+uint32_t osKernelGetTickCount(void);
+
+#endif /* CMSIS_OS_H */
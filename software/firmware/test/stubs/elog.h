@@ -0,0 +1,14 @@
+/*
+ * Stand-in for EasyLogger in host tests, which discards all log output.
+ */
+#ifndef ELOG_H
+#define ELOG_H
+
+#define log_a(...) ((void)0)
+#define log_e(...) ((void)0)
+#define log_w(...) ((void)0)
+#define log_i(...) ((void)0)
+#define log_d(...) ((void)0)
+#define log_v(...) ((void)0)
+
+#endif /* ELOG_H */
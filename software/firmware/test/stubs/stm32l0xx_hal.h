@@ -0,0 +1,32 @@
+/*
+ * Stand-in for the STM32 HAL in host tests, with only the types the
+ * firmware headers refer to. None of the HAL functions are provided.
+ */
+#ifndef STM32L0XX_HAL_H
+#define STM32L0XX_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef struct {
+    void *Instance;
+} I2C_HandleTypeDef;
+
+typedef struct {
+    void *Instance;
+} SPI_HandleTypeDef;
+
+typedef struct {
+    void *Instance;
+} TIM_HandleTypeDef;
+
+#define UNUSED(X) (void)X
+
+#endif /* STM32L0XX_HAL_H */
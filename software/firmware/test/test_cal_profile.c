@@ -0,0 +1,413 @@
+/*
+ * Host tests for the calibration profile slots, and for switching
+ * between them, against an in-memory EEPROM that can lose power or
+ * fail partway through any write
+ */
+#include <stdbool.h>
+#include <math.h>
+
+#include "test.h"
+#include "cal_profile.h"
+#include "util.h"
+
+#define EEPROM_SIZE   (0x0600)
+#define PAGE_PROFILES (0x0280)
+#define PAGE_SLOTS    (0x0300)
+
+/* Where the simulated device keeps its live calibration records */
+#define LIVE_GAIN     (0x0000)
+#define LIVE_SLOPE    (0x0040)
+#define LIVE_REFL     (0x0080)
+#define LIVE_TRAN     (0x00C0)
+
+static uint8_t eeprom[EEPROM_SIZE];
+
+/* Word writes left before the simulated failure, or -1 for no limit */
+static int write_budget = -1;
+
+/* Whether the failure is a power loss, after which nothing else is written */
+static bool power_loss = false;
+static bool powered_off = false;
+
+static int words_written = 0;
+
+/* Live calibration held in RAM, which is only updated by successful writes */
+static settings_cal_profile_t live;
+
+static bool sim_read(uint32_t address, uint8_t *data, size_t data_len)
+{
+    if (address + data_len > EEPROM_SIZE) { return false; }
+    memcpy(data, &eeprom[address], data_len);
+    return true;
+}
+
+static bool sim_write(uint32_t address, const uint8_t *data, size_t data_len)
+{
+    if (address + data_len > EEPROM_SIZE || (address % 4) != 0 || (data_len % 4) != 0) { return false; }
+    if (powered_off) { return false; }
+
+    for (size_t i = 0; i < data_len; i += 4) {
+        if (write_budget == 0) {
+            if (power_loss) { powered_off = true; }
+            write_budget = -1;
+            return false;
+        }
+        if (write_budget > 0) { write_budget--; }
+        memcpy(&eeprom[address + i], data + i, 4);
+        words_written++;
+    }
+    return true;
+}
+
+static uint32_t sim_crc(const uint8_t *data, size_t word_count)
+{
+    uint32_t crc = 0xFFFFFFFFUL;
+    for (size_t i = 0; i < word_count * 4; i++) {
+        crc ^= (uint32_t)data[i] << 24;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc & 0x80000000UL) ? (crc << 1) ^ 0x04C11DB7UL : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static bool sim_write_floats(uint32_t address, const float *values, size_t count)
+{
+    uint8_t buf[40];
+    for (size_t i = 0; i < count; i++) {
+        copy_from_f32(&buf[i * 4], values[i]);
+    }
+    copy_from_u32(&buf[count * 4], sim_crc(buf, count));
+    return sim_write(address, buf, (count + 1) * 4);
+}
+
+static bool sim_read_floats(uint32_t address, float *values, size_t count)
+{
+    uint8_t buf[40];
+    sim_read(address, buf, (count + 1) * 4);
+    if (copy_to_u32(&buf[count * 4]) != sim_crc(buf, count)) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        values[i] = copy_to_f32(&buf[i * 4]);
+    }
+    return true;
+}
+
+static void sim_get_live(settings_cal_profile_t *cal)
+{
+    cal->gain = live.gain;
+    cal->slope = live.slope;
+    cal->reflection = live.reflection;
+    cal->transmission = live.transmission;
+}
+
+/* Writes each part of the live calibration separately, as settings.c does */
+static bool sim_set_live(const settings_cal_profile_t *cal)
+{
+    const float gain[] = {
+        cal->gain.ch0_medium, cal->gain.ch1_medium, cal->gain.ch0_high,
+        cal->gain.ch1_high, cal->gain.ch0_maximum, cal->gain.ch1_maximum
+    };
+    if (!sim_write_floats(LIVE_GAIN, gain, 6)) { return false; }
+    live.gain = cal->gain;
+
+    const float slope[] = { cal->slope.b0, cal->slope.b1, cal->slope.b2 };
+    if (!sim_write_floats(LIVE_SLOPE, slope, 3)) { return false; }
+    live.slope = cal->slope;
+
+    const float refl[] = {
+        cal->reflection.lo_d, cal->reflection.lo_value, cal->reflection.hi_d,
+        cal->reflection.hi_value, cal->reflection.lo_unc, cal->reflection.hi_unc
+    };
+    if (!sim_write_floats(LIVE_REFL, refl, 6)) { return false; }
+    live.reflection = cal->reflection;
+
+    const float tran[] = {
+        cal->transmission.zero_value, cal->transmission.hi_d,
+        cal->transmission.hi_value, cal->transmission.hi_unc
+    };
+    if (!sim_write_floats(LIVE_TRAN, tran, 4)) { return false; }
+    live.transmission = cal->transmission;
+
+    return true;
+}
+
+static const cal_profile_store_t store = {
+    .page_address = PAGE_PROFILES,
+    .slots_address = PAGE_SLOTS,
+    .read = sim_read,
+    .write = sim_write,
+    .crc = sim_crc,
+    .get_live = sim_get_live,
+    .set_live = sim_set_live
+};
+
+/* Restart the simulated device, loading the live calibration from EEPROM */
+static uint8_t sim_reboot(void)
+{
+    float values[6];
+    write_budget = -1;
+    powered_off = false;
+    memset(&live, 0, sizeof(live));
+
+    if (sim_read_floats(LIVE_GAIN, values, 6)) {
+        live.gain.ch0_medium = values[0];
+        live.gain.ch1_medium = values[1];
+        live.gain.ch0_high = values[2];
+        live.gain.ch1_high = values[3];
+        live.gain.ch0_maximum = values[4];
+        live.gain.ch1_maximum = values[5];
+    }
+    if (sim_read_floats(LIVE_SLOPE, values, 3)) {
+        live.slope.b0 = values[0];
+        live.slope.b1 = values[1];
+        live.slope.b2 = values[2];
+    }
+    if (sim_read_floats(LIVE_REFL, values, 6)) {
+        live.reflection.lo_d = values[0];
+        live.reflection.lo_value = values[1];
+        live.reflection.hi_d = values[2];
+        live.reflection.hi_value = values[3];
+        live.reflection.lo_unc = values[4];
+        live.reflection.hi_unc = values[5];
+    }
+    if (sim_read_floats(LIVE_TRAN, values, 4)) {
+        live.transmission.zero_value = values[0];
+        live.transmission.hi_d = values[1];
+        live.transmission.hi_value = values[2];
+        live.transmission.hi_unc = values[3];
+    }
+
+    return cal_profile_recover(&store);
+}
+
+static void make_profile(settings_cal_profile_t *profile, const char *name, float base)
+{
+    memset(profile, 0, sizeof(settings_cal_profile_t));
+    strncpy(profile->name, name, SETTING_CAL_PROFILE_NAME_LEN);
+    profile->gain.ch0_medium = base + 1.0F;
+    profile->gain.ch1_medium = base + 2.0F;
+    profile->gain.ch0_high = base + 3.0F;
+    profile->gain.ch1_high = base + 4.0F;
+    profile->gain.ch0_maximum = base + 5.0F;
+    profile->gain.ch1_maximum = base + 6.0F;
+    profile->slope.b0 = base + 0.1F;
+    profile->slope.b1 = base + 0.2F;
+    profile->slope.b2 = base + 0.3F;
+    profile->reflection.lo_d = base + 0.4F;
+    profile->reflection.lo_value = base + 0.5F;
+    profile->reflection.hi_d = base + 0.6F;
+    profile->reflection.hi_value = base + 0.7F;
+    profile->reflection.lo_unc = base + 0.01F;
+    profile->reflection.hi_unc = base + 0.02F;
+    profile->transmission.zero_value = base + 0.8F;
+    profile->transmission.hi_d = base + 0.9F;
+    profile->transmission.hi_value = base + 0.75F;
+    profile->transmission.hi_unc = base + 0.03F;
+}
+
+static bool same_cal(const settings_cal_profile_t *a, const settings_cal_profile_t *b)
+{
+    return memcmp(&a->gain, &b->gain, sizeof(a->gain)) == 0
+        && memcmp(&a->slope, &b->slope, sizeof(a->slope)) == 0
+        && memcmp(&a->reflection, &b->reflection, sizeof(a->reflection)) == 0
+        && memcmp(&a->transmission, &b->transmission, sizeof(a->transmission)) == 0;
+}
+
+static settings_cal_profile_t profile_a;
+static settings_cal_profile_t profile_b;
+
+/* A device with profile A in slot 0 as the active calibration, and profile B in slot 1 */
+static void setup_device(void)
+{
+    memset(eeprom, 0, sizeof(eeprom));
+    write_budget = -1;
+    power_loss = false;
+    powered_off = false;
+
+    make_profile(&profile_a, "Paper", 10.0F);
+    make_profile(&profile_b, "Film", 20.0F);
+
+    CHECK(cal_profile_write(&store, 0, &profile_a));
+    CHECK(cal_profile_write(&store, 1, &profile_b));
+    CHECK(sim_set_live(&profile_a));
+
+    uint8_t buf[4];
+    copy_from_u32(buf, 0);
+    CHECK(sim_write(PAGE_PROFILES + CAL_PROFILE_PAGE_ACTIVE, buf, sizeof(buf)));
+    CHECK(sim_reboot() == 0);
+}
+
+static void test_write_read(void)
+{
+    settings_cal_profile_t profile;
+    setup_device();
+
+    CHECK(cal_profile_read(&store, 0, &profile));
+    CHECK_STR(profile.name, "Paper");
+    CHECK(same_cal(&profile, &profile_a));
+
+    CHECK(cal_profile_read(&store, 1, &profile));
+    CHECK_STR(profile.name, "Film");
+    CHECK(same_cal(&profile, &profile_b));
+
+    CHECK(!cal_profile_read(&store, SETTING_CAL_PROFILE_COUNT, &profile));
+    CHECK(!cal_profile_write(&store, SETTING_CAL_PROFILE_COUNT, &profile_a));
+}
+
+static void test_unused_slot(void)
+{
+    settings_cal_profile_t profile;
+    setup_device();
+
+    /* Never written */
+    CHECK(!cal_profile_read(&store, 2, &profile));
+
+    /* Cleared, which leaves a valid record with an empty name */
+    memset(&profile, 0, sizeof(profile));
+    CHECK(cal_profile_write(&store, 3, &profile));
+    CHECK(!cal_profile_read(&store, 3, &profile));
+}
+
+static void test_corrupt_slot(void)
+{
+    settings_cal_profile_t profile;
+
+    /* Every byte of the record, including its CRC, is covered */
+    for (uint32_t i = 0; i < CAL_PROFILE_RECORD_SIZE; i++) {
+        setup_device();
+        eeprom[PAGE_SLOTS + CAL_PROFILE_SLOT_SIZE + i] ^= 0x04;
+        CHECK(!cal_profile_read(&store, 1, &profile));
+    }
+
+    /* Selecting the corrupted slot leaves everything as it was */
+    setup_device();
+    eeprom[PAGE_SLOTS + CAL_PROFILE_SLOT_SIZE + 44] ^= 0x01;
+    words_written = 0;
+    CHECK(!cal_profile_select(&store, 1, 0));
+    CHECK(words_written == 0);
+    CHECK(same_cal(&live, &profile_a));
+    CHECK(sim_reboot() == 0);
+    CHECK(same_cal(&live, &profile_a));
+
+    /* The slot that was active is no longer reported once it is corrupted */
+    setup_device();
+    eeprom[PAGE_SLOTS + 20] ^= 0x01;
+    CHECK(sim_reboot() == SETTING_CAL_PROFILE_NONE);
+}
+
+static void test_corrupt_unc(void)
+{
+    settings_cal_profile_t profile;
+    setup_device();
+
+    /* The profile is still usable, but without its uncertainties */
+    eeprom[PAGE_SLOTS + CAL_PROFILE_SLOT_SIZE + CAL_PROFILE_UNC + 2] ^= 0x10;
+    CHECK(cal_profile_read(&store, 1, &profile));
+    CHECK(profile.gain.ch0_medium == profile_b.gain.ch0_medium);
+    CHECK(isnan(profile.reflection.lo_unc));
+    CHECK(isnan(profile.reflection.hi_unc));
+    CHECK(isnan(profile.transmission.hi_unc));
+}
+
+static void test_select(void)
+{
+    setup_device();
+
+    CHECK(cal_profile_select(&store, 1, 0));
+    CHECK(same_cal(&live, &profile_b));
+    CHECK(sim_reboot() == 1);
+    CHECK(same_cal(&live, &profile_b));
+
+    CHECK(cal_profile_select(&store, 0, 1));
+    CHECK(same_cal(&live, &profile_a));
+    CHECK(sim_reboot() == 0);
+    CHECK(same_cal(&live, &profile_a));
+}
+
+static int select_write_count(void)
+{
+    setup_device();
+    words_written = 0;
+    CHECK(cal_profile_select(&store, 1, 0));
+    return words_written;
+}
+
+static void test_select_power_loss(void)
+{
+    /* Cut the power after every possible number of written words */
+    const int total = select_write_count();
+    int restored = 0;
+    CHECK(total > 0);
+
+    for (int budget = 0; budget <= total; budget++) {
+        setup_device();
+        power_loss = true;
+        write_budget = budget;
+
+        bool selected = cal_profile_select(&store, 1, 0);
+        uint8_t active = sim_reboot();
+
+        /* Either the new profile is complete and committed, or the previous one is untouched */
+        if (selected) {
+            CHECK(budget == total);
+            CHECK(active == 1);
+            CHECK(same_cal(&live, &profile_b));
+        } else {
+            CHECK(budget < total);
+            CHECK(active == 0);
+            CHECK(same_cal(&live, &profile_a));
+            restored++;
+        }
+
+        /* The device can still switch profiles afterwards */
+        CHECK(cal_profile_select(&store, selected ? 0 : 1, active));
+        CHECK(sim_reboot() == (selected ? 0 : 1));
+    }
+    CHECK(restored == total);
+}
+
+static void test_select_write_failure(void)
+{
+    /* A single write fails, without a restart */
+    const int total = select_write_count();
+
+    for (int budget = 0; budget < total; budget++) {
+        setup_device();
+        write_budget = budget;
+
+        CHECK(!cal_profile_select(&store, 1, 0));
+        CHECK(same_cal(&live, &profile_a));
+
+        CHECK(sim_reboot() == 0);
+        CHECK(same_cal(&live, &profile_a));
+    }
+}
+
+static void test_recover_without_backup(void)
+{
+    /* A pending select whose backup was lost is finished instead of undone */
+    setup_device();
+    uint8_t buf[4];
+    copy_from_u32(buf, CAL_PROFILE_ACTIVE_PENDING | (0UL << 8) | 1UL);
+    CHECK(sim_write(PAGE_PROFILES + CAL_PROFILE_PAGE_ACTIVE, buf, sizeof(buf)));
+    memset(&eeprom[PAGE_PROFILES + CAL_PROFILE_PAGE_BACKUP], 0xFF, CAL_PROFILE_RECORD_SIZE);
+
+    CHECK(sim_reboot() == 1);
+    CHECK(same_cal(&live, &profile_b));
+    CHECK(sim_reboot() == 1);
+}
+
+int main(void)
+{
+    RUN_TEST(test_write_read);
+    RUN_TEST(test_unused_slot);
+    RUN_TEST(test_corrupt_slot);
+    RUN_TEST(test_corrupt_unc);
+    RUN_TEST(test_select);
+    RUN_TEST(test_select_power_loss);
+    RUN_TEST(test_select_write_failure);
+    RUN_TEST(test_recover_without_backup);
+    return TEST_RESULT();
+}
@@ -0,0 +1,166 @@
+/*
+ * Host tests for CDC command line assembly, parsing and value encoding
+ */
+#include <stdint.h>
+#include <math.h>
+
+#include "test.h"
+#include "cdc_command.h"
+
+static cdc_line_status_t put_line(cdc_line_t *line, const char *str)
+{
+    cdc_line_status_t status = CDC_LINE_PENDING;
+    for (const char *p = str; *p; p++) {
+        status = cdc_line_put(line, *p);
+        if (status != CDC_LINE_PENDING) {
+            break;
+        }
+    }
+    return status;
+}
+
+static uint32_t f32_bits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    return bits;
+}
+
+static void test_profile_full_length(void)
+{
+    /* The longest profile write is exactly as long as a line can be */
+    const float values[6] = {
+        -0.123456789F, 1.0F / 3.0F, 1.17549435E-38F,
+        3.40282347E+38F, -2.5E-7F, 42.0F
+    };
+    char line_str[128];
+    char encoded[60];
+    cdc_line_t line;
+    cdc_command_t cmd;
+    float decoded[7];
+
+    cdc_encode_f32_array(encoded, values, 6);
+    CHECK(strlen(encoded) == 53);
+    snprintf(line_str, sizeof(line_str), "SC PROFG,3,%s\r", encoded);
+    CHECK(strlen(line_str) == CDC_COMMAND_LINE_LEN + 1);
+
+    cdc_line_reset(&line);
+    CHECK(put_line(&line, line_str) == CDC_LINE_READY);
+    CHECK(line.len == CDC_COMMAND_LINE_LEN);
+    CHECK(line.buf[CDC_COMMAND_LINE_LEN] == '\0');
+
+    CHECK(cdc_command_parse(&cmd, line.buf, line.len));
+    CHECK(cmd.type == CMD_TYPE_SET);
+    CHECK(cmd.category == CMD_CATEGORY_CALIBRATION);
+    CHECK_STR(cmd.action, "PROFG");
+    CHECK(strlen(cmd.args) == 55);
+    CHECK(cmd.args[0] == '3' && cmd.args[1] == ',');
+
+    CHECK(cdc_decode_f32_array(cmd.args + 2, decoded, 7) == 6);
+    for (size_t i = 0; i < 6; i++) {
+        CHECK(f32_bits(decoded[i]) == f32_bits(values[i]));
+    }
+}
+
+static void test_template_full_length(void)
+{
+    /* A template of the longest allowed length fits the arguments */
+    char tmpl[57];
+    char line_str[80];
+    cdc_line_t line;
+    cdc_command_t cmd;
+
+    for (size_t i = 0; i < 56; i++) {
+        tmpl[i] = (char)('A' + (i % 26));
+    }
+    tmpl[56] = '\0';
+    snprintf(line_str, sizeof(line_str), "SS HIDT,%s\n", tmpl);
+    CHECK(strlen(line_str) == CDC_COMMAND_LINE_LEN + 1);
+
+    cdc_line_reset(&line);
+    CHECK(put_line(&line, line_str) == CDC_LINE_READY);
+    CHECK(cdc_command_parse(&cmd, line.buf, line.len));
+    CHECK_STR(cmd.action, "HIDT");
+    CHECK_STR(cmd.args, tmpl);
+}
+
+static void test_line_overflow(void)
+{
+    char line_str[80];
+    cdc_line_t line;
+
+    memset(line_str, 'A', CDC_COMMAND_LINE_LEN + 1);
+    line_str[CDC_COMMAND_LINE_LEN + 1] = '\r';
+    line_str[CDC_COMMAND_LINE_LEN + 2] = '\0';
+
+    cdc_line_reset(&line);
+    CHECK(put_line(&line, line_str) == CDC_LINE_OVERFLOW);
+    CHECK(line.len == 0);
+    CHECK(!line.overflow);
+
+    /* Backspace does not rescue a line that has already overflowed */
+    line_str[CDC_COMMAND_LINE_LEN + 1] = 0x08;
+    line_str[CDC_COMMAND_LINE_LEN + 2] = '\n';
+    line_str[CDC_COMMAND_LINE_LEN + 3] = '\0';
+    CHECK(put_line(&line, line_str) == CDC_LINE_OVERFLOW);
+
+    /* The next line is accepted normally */
+    CHECK(put_line(&line, "GS V\r") == CDC_LINE_READY);
+    CHECK_STR(line.buf, "GS V");
+}
+
+static void test_line_editing(void)
+{
+    cdc_line_t line;
+    cdc_command_t cmd;
+
+    cdc_line_reset(&line);
+    CHECK(cdc_line_put(&line, '\n') == CDC_LINE_PENDING);
+    CHECK(put_line(&line, "GS X\x08V\x01\r") == CDC_LINE_READY);
+    CHECK_STR(line.buf, "GS V");
+
+    CHECK(cdc_command_parse(&cmd, line.buf, line.len));
+    CHECK(cmd.type == CMD_TYPE_GET);
+    CHECK(cmd.category == CMD_CATEGORY_SYSTEM);
+    CHECK_STR(cmd.action, "V");
+    CHECK_STR(cmd.args, "");
+}
+
+static void test_parse_invalid(void)
+{
+    cdc_command_t cmd;
+    CHECK(!cdc_command_parse(&cmd, "X", 1));
+    CHECK(!cdc_command_parse(&cmd, "QS V", 4));
+    CHECK(!cdc_command_parse(&cmd, "GQ V", 4));
+    CHECK(!cdc_command_parse(&cmd, "GSV", 3));
+    CHECK(cdc_command_parse(&cmd, "GS", 2));
+}
+
+static void test_f32_codec(void)
+{
+    char buf[16];
+    float values[3];
+
+    CHECK(cdc_encode_f32(buf, 1.0F) == 8);
+    CHECK_STR(buf, "3F800000");
+    CHECK(cdc_decode_f32("BF800000") == -1.0F);
+    CHECK(cdc_decode_f32("3f800000") == 1.0F);
+    CHECK(isnan(cdc_decode_f32("3F80000")));
+    CHECK(isnan(cdc_decode_f32("3F80000G")));
+
+    CHECK(cdc_decode_f32_array("3F800000,,40000000", values, 3) == 1);
+    CHECK(cdc_decode_f32_array("3F800000,123456789", values, 3) == 2);
+    CHECK(values[0] == 1.0F);
+    CHECK(isnan(values[1]));
+}
+
+int main(void)
+{
+    RUN_TEST(test_profile_full_length);
+    RUN_TEST(test_template_full_length);
+    RUN_TEST(test_line_overflow);
+    RUN_TEST(test_line_editing);
+    RUN_TEST(test_parse_invalid);
+    RUN_TEST(test_f32_codec);
+    return TEST_RESULT();
+}
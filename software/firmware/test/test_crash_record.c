@@ -0,0 +1,205 @@
+/*
+ * Host tests for the crash record format, as validated at startup and
+ * as sent to the host by "GD CRASH"
+ */
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "test.h"
+#include "crash_record_format.h"
+
+/* CRC-32 of the record from make_record(), as calculated by zlib */
+#define RECORD_CHECKSUM 0x0905DC31UL
+
+static void make_record(crash_record_t *record)
+{
+    memset(record, 0, sizeof(crash_record_t));
+    record->magic = CRASH_RECORD_MAGIC;
+    record->version = CRASH_RECORD_VERSION;
+    record->size = sizeof(crash_record_t);
+    record->type = CRASH_TYPE_WATCHDOG;
+    record->uptime = 123456;
+    record->app_crc32 = 0x89ABCDEFUL;
+    record->r0 = 0x100;
+    record->r1 = 0x101;
+    record->r2 = 0x102;
+    record->r3 = 0x103;
+    record->r12 = 0x104;
+    record->lr = 0x105;
+    record->pc = 0x106;
+    record->psr = 0x107;
+    record->sp = 0x20004F00UL;
+    record->icsr = 0x0000080BUL;
+    record->shcsr = 0;
+    strcpy(record->task_name, "sensor");
+    strcpy(record->detail, "deadline 2000 ms");
+    for (size_t i = 0; i < CRASH_RECORD_STACK_WORDS; i++) {
+        record->stack[i] = 0x08008001UL + (i * 0x10);
+    }
+    strcpy(record->log_tail, "I/sensor Reading started\nW/watchdog Task sensor stalled\n");
+    record->checksum = crash_record_checksum(record);
+}
+
+static int hex_value(char ch)
+{
+    if (ch >= '0' && ch <= '9') { return ch - '0'; }
+    if (ch >= 'A' && ch <= 'F') { return ch - 'A' + 10; }
+    return -1;
+}
+
+static void test_layout(void)
+{
+    /* These offsets are also used by the decoder in the desktop application */
+    CHECK(sizeof(crash_record_t) == 372);
+    CHECK(offsetof(crash_record_t, magic) == 0);
+    CHECK(offsetof(crash_record_t, version) == 4);
+    CHECK(offsetof(crash_record_t, size) == 6);
+    CHECK(offsetof(crash_record_t, checksum) == 8);
+    CHECK(offsetof(crash_record_t, type) == 12);
+    CHECK(offsetof(crash_record_t, uptime) == 16);
+    CHECK(offsetof(crash_record_t, app_crc32) == 20);
+    CHECK(offsetof(crash_record_t, r0) == 24);
+    CHECK(offsetof(crash_record_t, sp) == 56);
+    CHECK(offsetof(crash_record_t, icsr) == 60);
+    CHECK(offsetof(crash_record_t, shcsr) == 64);
+    CHECK(offsetof(crash_record_t, task_name) == 68);
+    CHECK(offsetof(crash_record_t, detail) == 84);
+    CHECK(offsetof(crash_record_t, stack) == 116);
+    CHECK(offsetof(crash_record_t, log_tail) == 180);
+}
+
+static void test_valid_record(void)
+{
+    crash_record_t record;
+    make_record(&record);
+
+    CHECK(record.checksum == RECORD_CHECKSUM);
+    CHECK(crash_record_is_valid(&record));
+    CHECK(!crash_record_is_valid(NULL));
+
+    /* A cleared record, as left after a power-on reset */
+    memset(&record, 0, sizeof(crash_record_t));
+    CHECK(!crash_record_is_valid(&record));
+}
+
+static void test_bad_checksum(void)
+{
+    crash_record_t record;
+
+    /* Every byte covered by the checksum is checked */
+    for (size_t i = offsetof(crash_record_t, type); i < sizeof(crash_record_t); i++) {
+        make_record(&record);
+        ((uint8_t *)&record)[i] ^= 0x01;
+        CHECK(!crash_record_is_valid(&record));
+    }
+
+    make_record(&record);
+    record.checksum ^= 0x80000000UL;
+    CHECK(!crash_record_is_valid(&record));
+}
+
+static void test_bad_header(void)
+{
+    crash_record_t record;
+
+    /* The header is not covered by the checksum, so it is checked separately */
+    make_record(&record);
+    record.magic = 0x48535244UL;
+    CHECK(!crash_record_is_valid(&record));
+
+    make_record(&record);
+    record.version = CRASH_RECORD_VERSION + 1;
+    CHECK(!crash_record_is_valid(&record));
+
+    make_record(&record);
+    record.size = sizeof(crash_record_t) - 4;
+    CHECK(!crash_record_is_valid(&record));
+}
+
+static void test_torn_record(void)
+{
+    /*
+     * A reset partway through capturing a new record, on top of an
+     * older one, must not leave anything that passes as valid
+     */
+    crash_record_t old_record;
+    crash_record_t new_record;
+    crash_record_t record;
+
+    make_record(&old_record);
+    make_record(&new_record);
+    new_record.type = CRASH_TYPE_HARD_FAULT;
+    new_record.uptime = 654321;
+    strcpy(new_record.task_name, "display");
+    new_record.checksum = crash_record_checksum(&new_record);
+
+    for (size_t n = 0; n <= sizeof(crash_record_t); n++) {
+        memcpy(&record, &old_record, sizeof(crash_record_t));
+        memcpy(&record, &new_record, n);
+
+        bool complete = memcmp(&record, &old_record, sizeof(crash_record_t)) == 0
+            || memcmp(&record, &new_record, sizeof(crash_record_t)) == 0;
+        CHECK(crash_record_is_valid(&record) == complete);
+    }
+
+    /* The capture code writes the checksum last, after everything else */
+    memcpy(&record, &new_record, sizeof(crash_record_t));
+    record.checksum = old_record.checksum;
+    CHECK(!crash_record_is_valid(&record));
+}
+
+static void test_hex_lines(void)
+{
+    crash_record_t record;
+    crash_record_t decoded;
+    char buf[CRASH_RECORD_LINE_SIZE + 1];
+    size_t lines = 0;
+    size_t pos = 0;
+
+    make_record(&record);
+    memset(&decoded, 0, sizeof(crash_record_t));
+
+    for (size_t offset = 0; ; offset += CRASH_RECORD_LINE_BYTES) {
+        size_t n = crash_record_format_line(&record, offset, buf);
+        if (n == 0) { break; }
+        CHECK(n <= CRASH_RECORD_LINE_SIZE);
+        CHECK(n % 2 == 0);
+        CHECK(buf[n - 2] == '\r' && buf[n - 1] == '\n');
+        buf[n] = '\0';
+
+        if (lines == 0) {
+            CHECK_STR(buf, "435253480100740131DC05090700000040E20100EFCDAB890001000001010000\r\n");
+        }
+
+        /* Decode it the way the host does */
+        for (size_t i = 0; i + 2 < n; i += 2) {
+            int hi = hex_value(buf[i]);
+            int lo = hex_value(buf[i + 1]);
+            CHECK(hi >= 0 && lo >= 0);
+            if (pos < sizeof(crash_record_t)) {
+                ((uint8_t *)&decoded)[pos++] = (uint8_t)((hi << 4) | lo);
+            }
+        }
+        lines++;
+    }
+
+    CHECK(lines == 12);
+    CHECK(pos == sizeof(crash_record_t));
+    CHECK(memcmp(&decoded, &record, sizeof(crash_record_t)) == 0);
+    CHECK(crash_record_is_valid(&decoded));
+
+    /* The last line only holds what is left of the record */
+    CHECK(crash_record_format_line(&record, 11 * CRASH_RECORD_LINE_BYTES, buf) == (20 * 2) + 2);
+    CHECK(crash_record_format_line(&record, sizeof(crash_record_t), buf) == 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_layout);
+    RUN_TEST(test_valid_record);
+    RUN_TEST(test_bad_checksum);
+    RUN_TEST(test_bad_header);
+    RUN_TEST(test_torn_record);
+    RUN_TEST(test_hex_lines);
+    return TEST_RESULT();
+}
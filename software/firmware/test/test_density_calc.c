@@ -0,0 +1,175 @@
+/*
+ * Host tests for the density calculation, checking the analytic
+ * uncertainty against a Monte Carlo simulation of the same inputs
+ */
+#include <stdint.h>
+#include <math.h>
+
+#include "test.h"
+#include "density_calc.h"
+
+#define MC_SAMPLES 200000
+#define MC_TOLERANCE 0.03
+
+static uint64_t rng_state;
+
+static void rng_seed(uint64_t seed)
+{
+    rng_state = seed;
+}
+
+static double rng_uniform(void)
+{
+    /* xorshift64*, which is plenty for this and gives repeatable runs */
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    uint64_t r = rng_state * 0x2545F4914F6CDD1DULL;
+    return ((double)(r >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static double rng_normal(double sd)
+{
+    /* Box-Muller, discarding the second value */
+    double u1 = rng_uniform();
+    double u2 = rng_uniform();
+    return sd * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+typedef struct {
+    double sum;
+    double sum_sq;
+    size_t n;
+} stats_t;
+
+static void stats_add(stats_t *stats, double value)
+{
+    stats->sum += value;
+    stats->sum_sq += value * value;
+    stats->n++;
+}
+
+static double stats_sd(const stats_t *stats)
+{
+    double mean = stats->sum / (double)stats->n;
+    return sqrt((stats->sum_sq / (double)stats->n) - (mean * mean));
+}
+
+static int close_enough(double actual, double expected)
+{
+    double diff = fabs(actual - expected) / expected;
+    if (diff > MC_TOLERANCE) {
+        fprintf(stderr, "  simulated %f, analytic %f (%.1f%%)\n", actual, expected, diff * 100.0);
+        return 0;
+    }
+    return 1;
+}
+
+static int check_reflection(float value, float value_unc,
+    float lo_d, float lo_value, float lo_unc,
+    float hi_d, float hi_value, float hi_unc)
+{
+    float d_unc;
+    float d = density_calc_reflection(value, value_unc,
+        lo_d, lo_value, lo_unc, hi_d, hi_value, hi_unc, &d_unc);
+
+    /* Substitute the default the same way the calculation does */
+    float lo_sd = isnan(lo_unc) ? DENSITY_CALC_REF_UNCERTAINTY : lo_unc;
+    float hi_sd = isnan(hi_unc) ? DENSITY_CALC_REF_UNCERTAINTY : hi_unc;
+
+    stats_t stats = {0};
+    rng_seed(0x5DEECE66DULL);
+    for (size_t i = 0; i < MC_SAMPLES; i++) {
+        float sample = density_calc_reflection(
+            value + (float)rng_normal(value_unc), 0.0F,
+            lo_d + (float)rng_normal(lo_sd), lo_value, lo_unc,
+            hi_d + (float)rng_normal(hi_sd), hi_value, hi_unc, NULL);
+        stats_add(&stats, (double)sample - (double)d);
+    }
+
+    return close_enough(stats_sd(&stats), d_unc);
+}
+
+static int check_transmission(float value, float value_unc,
+    float zero_value, float hi_d, float hi_value, float hi_unc)
+{
+    float d_unc;
+    float d = density_calc_transmission(value, value_unc,
+        zero_value, hi_d, hi_value, hi_unc, &d_unc);
+
+    float hi_sd = isnan(hi_unc) ? DENSITY_CALC_REF_UNCERTAINTY : hi_unc;
+
+    stats_t stats = {0};
+    rng_seed(0x5DEECE66DULL);
+    for (size_t i = 0; i < MC_SAMPLES; i++) {
+        float sample = density_calc_transmission(
+            value + (float)rng_normal(value_unc), 0.0F,
+            zero_value, hi_d + (float)rng_normal(hi_sd), hi_value, hi_unc, NULL);
+        stats_add(&stats, (double)sample - (double)d);
+    }
+
+    return close_enough(stats_sd(&stats), d_unc);
+}
+
+static void test_reflection_values(void)
+{
+    float d_unc;
+
+    /* The calibration points come back as their target densities */
+    CHECK(fabsf(density_calc_reflection(320.0F, 0.0F, 0.08F, 320.0F, NAN, 1.5F, 12.0F, NAN, &d_unc) - 0.08F) < 1e-5F);
+    CHECK(fabsf(d_unc - DENSITY_CALC_REF_UNCERTAINTY) < 1e-6F);
+    CHECK(fabsf(density_calc_reflection(12.0F, 0.0F, 0.08F, 320.0F, NAN, 1.5F, 12.0F, NAN, &d_unc) - 1.5F) < 1e-5F);
+    CHECK(fabsf(d_unc - DENSITY_CALC_REF_UNCERTAINTY) < 1e-6F);
+
+    /* A recorded uncertainty replaces the default */
+    density_calc_reflection(12.0F, 0.0F, 0.08F, 320.0F, 0.002F, 1.5F, 12.0F, 0.004F, &d_unc);
+    CHECK(fabsf(d_unc - 0.004F) < 1e-6F);
+}
+
+static void test_reflection_monte_carlo(void)
+{
+    /* Between the calibration points, with the default point uncertainty */
+    CHECK(check_reflection(60.0F, 0.6F, 0.08F, 320.0F, NAN, 1.5F, 12.0F, NAN));
+
+    /* Close to each point, with recorded point uncertainties */
+    CHECK(check_reflection(300.0F, 1.5F, 0.08F, 320.0F, 0.004F, 1.5F, 12.0F, 0.02F));
+    CHECK(check_reflection(13.0F, 0.2F, 0.08F, 320.0F, 0.004F, 1.5F, 12.0F, 0.02F));
+
+    /* Extrapolated beyond CAL-HI, where the point weights leave [0, 1] */
+    CHECK(check_reflection(2.0F, 0.05F, 0.08F, 320.0F, 0.005F, 1.5F, 12.0F, 0.008F));
+
+    /* Dominated by the reading uncertainty */
+    CHECK(check_reflection(40.0F, 2.0F, 0.08F, 320.0F, 0.001F, 1.5F, 12.0F, 0.001F));
+}
+
+static void test_transmission_monte_carlo(void)
+{
+    CHECK(check_transmission(150.0F, 1.0F, 1500.0F, 2.9F, 5.0F, NAN));
+    CHECK(check_transmission(8.0F, 0.1F, 1500.0F, 2.9F, 5.0F, 0.006F));
+    CHECK(check_transmission(1.0F, 0.03F, 1500.0F, 2.9F, 5.0F, 0.006F));
+}
+
+static void test_cal_point_uncertainty(void)
+{
+    /* Only the reference target, if the readings are exact or unknown */
+    CHECK(fabsf(density_calc_cal_point_uncertainty(100.0F, 0.0F, NAN, 0.0F) - DENSITY_CALC_REF_UNCERTAINTY) < 1e-7F);
+    CHECK(fabsf(density_calc_cal_point_uncertainty(100.0F, NAN, NAN, 0.0F) - DENSITY_CALC_REF_UNCERTAINTY) < 1e-7F);
+
+    /* A 1% reading uncertainty is 0.00434 in density units */
+    float reading = 0.01F / logf(10.0F);
+    float expected = sqrtf((DENSITY_CALC_REF_UNCERTAINTY * DENSITY_CALC_REF_UNCERTAINTY) + (reading * reading));
+    CHECK(fabsf(density_calc_cal_point_uncertainty(100.0F, 1.0F, NAN, 0.0F) - expected) < 1e-6F);
+
+    /* The base reading adds to it */
+    expected = sqrtf((expected * expected) + (reading * reading));
+    CHECK(fabsf(density_calc_cal_point_uncertainty(100.0F, 1.0F, 2000.0F, 20.0F) - expected) < 1e-6F);
+}
+
+int main(void)
+{
+    RUN_TEST(test_reflection_values);
+    RUN_TEST(test_reflection_monte_carlo);
+    RUN_TEST(test_transmission_monte_carlo);
+    RUN_TEST(test_cal_point_uncertainty);
+    return TEST_RESULT();
+}
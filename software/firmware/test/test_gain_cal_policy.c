@@ -0,0 +1,406 @@
+/*
+ * Host tests for the gain calibration run, and for the checks that
+ * decide whether an interrupted run can be resumed from its saved
+ * checkpoint
+ */
+#include <math.h>
+
+#include "test.h"
+#include "gain_cal_policy.h"
+#include "tsl2591.h"
+
+#define TOLERANCE (0.05F)
+
+/* Readings near the light calibration and maximum gain search targets */
+#define LED_READING     (36000.0F)
+#define MAX_LED_READING (27500.0F)
+
+static void test_reading_matches(void)
+{
+    CHECK(gain_cal_policy_reading_matches(LED_READING, LED_READING, TOLERANCE));
+    CHECK(gain_cal_policy_reading_matches(LED_READING, LED_READING * 1.04F, TOLERANCE));
+    CHECK(gain_cal_policy_reading_matches(LED_READING, LED_READING * 0.96F, TOLERANCE));
+
+    CHECK(!gain_cal_policy_reading_matches(LED_READING, LED_READING * 1.06F, TOLERANCE));
+    CHECK(!gain_cal_policy_reading_matches(LED_READING, LED_READING * 0.94F, TOLERANCE));
+}
+
+static void test_drifted_reading(void)
+{
+    /*
+     * An LED that has drifted by 20% can still be within a loose tolerance
+     * of the search target, but no longer matches what the completed
+     * stages were measured with
+     */
+    const float target = 65535.0F * 0.75F;
+    const float found = target * 0.85F;
+    const float drifted = found * 1.20F;
+
+    CHECK(fabsf(target - drifted) <= target * 0.25F);
+    CHECK(!gain_cal_policy_reading_matches(found, drifted, TOLERANCE));
+    CHECK(gain_cal_policy_reading_matches(found, found * 1.01F, TOLERANCE));
+}
+
+static void test_unusable_readings(void)
+{
+    /* A saturated reading comes back as NaN */
+    CHECK(!gain_cal_policy_reading_matches(LED_READING, NAN, TOLERANCE));
+
+    /* Nothing was recorded to compare against */
+    CHECK(!gain_cal_policy_reading_matches(NAN, LED_READING, TOLERANCE));
+    CHECK(!gain_cal_policy_reading_matches(0.0F, 0.0F, TOLERANCE));
+    CHECK(!gain_cal_policy_reading_matches(-1.0F, -1.0F, TOLERANCE));
+    CHECK(!gain_cal_policy_reading_matches(INFINITY, INFINITY, TOLERANCE));
+}
+
+static void test_resume_stage(void)
+{
+    /* Everything still matches, so the run continues where it left off */
+    CHECK(gain_cal_policy_resume_stage(SETTING_GAIN_CAL_STAGE_LED, true, false) == SETTING_GAIN_CAL_STAGE_LED);
+    CHECK(gain_cal_policy_resume_stage(SETTING_GAIN_CAL_STAGE_HIGH, true, false) == SETTING_GAIN_CAL_STAGE_HIGH);
+    CHECK(gain_cal_policy_resume_stage(SETTING_GAIN_CAL_STAGE_MAX_LED, true, true) == SETTING_GAIN_CAL_STAGE_MAX_LED);
+
+    /* A drifted measurement brightness invalidates every earlier stage */
+    CHECK(gain_cal_policy_resume_stage(SETTING_GAIN_CAL_STAGE_LED, false, true) == SETTING_GAIN_CAL_STAGE_NONE);
+    CHECK(gain_cal_policy_resume_stage(SETTING_GAIN_CAL_STAGE_MEDIUM, false, true) == SETTING_GAIN_CAL_STAGE_NONE);
+    CHECK(gain_cal_policy_resume_stage(SETTING_GAIN_CAL_STAGE_MAX_LED, false, true) == SETTING_GAIN_CAL_STAGE_NONE);
+
+    /* A drifted maximum gain brightness only repeats its own search */
+    CHECK(gain_cal_policy_resume_stage(SETTING_GAIN_CAL_STAGE_MAX_LED, true, false) == SETTING_GAIN_CAL_STAGE_HIGH);
+
+    /* Nothing to resume from */
+    CHECK(gain_cal_policy_resume_stage(SETTING_GAIN_CAL_STAGE_NONE, true, true) == SETTING_GAIN_CAL_STAGE_NONE);
+    CHECK(gain_cal_policy_resume_stage(SETTING_GAIN_CAL_STAGE_MAX, true, true) == SETTING_GAIN_CAL_STAGE_NONE);
+}
+
+static void test_resume_from_readings(void)
+{
+    /* From the recorded readings through to the decision, as in sensor.c */
+    bool led_valid = gain_cal_policy_reading_matches(LED_READING, LED_READING * 1.02F, TOLERANCE);
+    bool max_led_valid = gain_cal_policy_reading_matches(MAX_LED_READING, MAX_LED_READING * 1.20F, TOLERANCE);
+    CHECK(gain_cal_policy_resume_stage(SETTING_GAIN_CAL_STAGE_MAX_LED, led_valid, max_led_valid) == SETTING_GAIN_CAL_STAGE_HIGH);
+
+    led_valid = gain_cal_policy_reading_matches(LED_READING, LED_READING * 0.80F, TOLERANCE);
+    CHECK(gain_cal_policy_resume_stage(SETTING_GAIN_CAL_STAGE_HIGH, led_valid, false) == SETTING_GAIN_CAL_STAGE_NONE);
+}
+
+/*
+ * Simulated sensor for driving complete calibration runs.
+ * Readings only depend on the LED brightness and the gain being measured,
+ * so any difference between runs comes from the run itself.
+ */
+typedef struct {
+    float led_scale;        /* CH0 reading per step of brightness at high gain */
+    float max_led_scale;    /* CH0 reading per step of brightness at maximum gain */
+    int ops_left;           /* Operations before the run is interrupted, or -1 */
+    int finds;
+    int reads;
+    int measures;
+    bool saved_valid;       /* Checkpoint held in the simulated EEPROM */
+    settings_cal_gain_checkpoint_t saved;
+} sim_sensor_t;
+
+/* Gain ratios of the simulated sensor, between each gain and the one below it */
+static const float SIM_RATIO_MEDIUM[2] = { 24.8F, 25.2F };
+static const float SIM_RATIO_HIGH[2] = { 16.3F, 16.1F };
+static const float SIM_RATIO_MAX[2] = { 23.1F, 24.4F };
+
+static void sim_init(sim_sensor_t *sim)
+{
+    memset(sim, 0, sizeof(sim_sensor_t));
+    sim->led_scale = 300.0F;
+    sim->max_led_scale = 3000.0F;
+    sim->ops_left = -1;
+}
+
+static bool sim_op(sim_sensor_t *sim)
+{
+    if (sim->ops_left == 0) { return false; }
+    if (sim->ops_left > 0) { sim->ops_left--; }
+    return true;
+}
+
+static bool sim_resume(settings_gain_cal_stage_t stage, void *user_data)
+{
+    (void)stage;
+    return sim_op(user_data);
+}
+
+static bool sim_cooldown(void *user_data)
+{
+    return sim_op(user_data);
+}
+
+static float sim_reading(const sim_sensor_t *sim, settings_gain_cal_stage_t stage, uint8_t brightness)
+{
+    float scale = (stage == SETTING_GAIN_CAL_STAGE_MAX_LED) ? sim->max_led_scale : sim->led_scale;
+    float reading = brightness * scale;
+    return (reading > 65535.0F) ? NAN : reading;
+}
+
+static bool sim_find_brightness(settings_gain_cal_stage_t stage,
+    uint8_t *brightness, float *ch0_reading, void *user_data)
+{
+    sim_sensor_t *sim = user_data;
+    if (!sim_op(sim)) { return false; }
+    sim->finds++;
+
+    /* Highest brightness that stays under the search target */
+    float target = (stage == SETTING_GAIN_CAL_STAGE_MAX_LED) ? MAX_LED_READING : LED_READING;
+    float scale = (stage == SETTING_GAIN_CAL_STAGE_MAX_LED) ? sim->max_led_scale : sim->led_scale;
+    long value = lroundf(floorf(target / scale));
+    *brightness = (uint8_t)((value > 128) ? 128 : value);
+    *ch0_reading = sim_reading(sim, stage, *brightness);
+    return true;
+}
+
+static bool sim_read_brightness(settings_gain_cal_stage_t stage,
+    uint8_t brightness, float *ch0_reading, void *user_data)
+{
+    sim_sensor_t *sim = user_data;
+    if (!sim_op(sim)) { return false; }
+    sim->reads++;
+    *ch0_reading = sim_reading(sim, stage, brightness);
+    return true;
+}
+
+static bool sim_measure_gain(settings_gain_cal_stage_t stage, uint8_t brightness,
+    float *ch0_ratio, float *ch1_ratio, void *user_data)
+{
+    sim_sensor_t *sim = user_data;
+    const float *ratio;
+    if (!sim_op(sim)) { return false; }
+    sim->measures++;
+
+    if (stage == SETTING_GAIN_CAL_STAGE_MEDIUM) {
+        ratio = SIM_RATIO_MEDIUM;
+    } else if (stage == SETTING_GAIN_CAL_STAGE_HIGH) {
+        ratio = SIM_RATIO_HIGH;
+    } else if (stage == SETTING_GAIN_CAL_STAGE_MAX) {
+        ratio = SIM_RATIO_MAX;
+    } else {
+        return false;
+    }
+
+    /* A slight dependence on brightness, so a run measured differently gives different gains */
+    *ch0_ratio = ratio[0] * (1.0F + (brightness * 0.0001F));
+    *ch1_ratio = ratio[1] * (1.0F + (brightness * 0.0001F));
+    return true;
+}
+
+static void sim_save_checkpoint(const settings_cal_gain_checkpoint_t *checkpoint, void *user_data)
+{
+    sim_sensor_t *sim = user_data;
+    sim->saved = *checkpoint;
+    sim->saved_valid = true;
+}
+
+static void sim_clear_checkpoint(settings_cal_gain_checkpoint_t *checkpoint, void *user_data)
+{
+    sim_sensor_t *sim = user_data;
+    sim->saved_valid = false;
+    memset(checkpoint, 0, sizeof(settings_cal_gain_checkpoint_t));
+}
+
+/*
+ * Start a run, resuming from the saved checkpoint if there is one,
+ * the same way sensor.c starts a run from the settings.
+ */
+static bool sim_run(sim_sensor_t *sim, settings_cal_gain_checkpoint_t *result)
+{
+    const gain_cal_policy_ops_t ops = {
+        .resume = sim_resume,
+        .cooldown = sim_cooldown,
+        .find_brightness = sim_find_brightness,
+        .read_brightness = sim_read_brightness,
+        .measure_gain = sim_measure_gain,
+        .save_checkpoint = sim_save_checkpoint,
+        .clear_checkpoint = sim_clear_checkpoint,
+        .user_data = sim
+    };
+    settings_cal_gain_checkpoint_t checkpoint;
+
+    if (sim->saved_valid) {
+        checkpoint = sim->saved;
+    } else {
+        memset(&checkpoint, 0, sizeof(settings_cal_gain_checkpoint_t));
+    }
+
+    sim->finds = 0;
+    sim->reads = 0;
+    sim->measures = 0;
+    if (!gain_cal_policy_run(&ops, &checkpoint)) {
+        return false;
+    }
+
+    /* The run is complete, so there is nothing left to resume */
+    sim->saved_valid = false;
+    *result = checkpoint;
+    return true;
+}
+
+static bool same_gains(const settings_cal_gain_checkpoint_t *a, const settings_cal_gain_checkpoint_t *b)
+{
+    return a->measurement_brightness == b->measurement_brightness
+        && a->ch0_medium == b->ch0_medium && a->ch1_medium == b->ch1_medium
+        && a->ch0_high == b->ch0_high && a->ch1_high == b->ch1_high
+        && a->ch0_maximum == b->ch0_maximum && a->ch1_maximum == b->ch1_maximum;
+}
+
+/* Number of sensor operations in an uninterrupted run */
+static int sim_run_length(void)
+{
+    sim_sensor_t sim;
+    settings_cal_gain_checkpoint_t result;
+    sim_init(&sim);
+    sim.ops_left = 1000;
+    CHECK(sim_run(&sim, &result));
+    return 1000 - sim.ops_left;
+}
+
+static void test_run_complete(void)
+{
+    sim_sensor_t sim;
+    settings_cal_gain_checkpoint_t result;
+    sim_init(&sim);
+
+    CHECK(sim_run(&sim, &result));
+    CHECK(sim.finds == 2);
+    CHECK(sim.measures == 3);
+    CHECK(sim.reads == 0);
+    CHECK(!sim.saved_valid);
+
+    CHECK(result.measurement_brightness == 120);
+    CHECK(result.max_gain_brightness == 9);
+    CHECK(fabsf(result.ch0_medium - (24.8F * 1.0128F)) < 0.001F);
+    CHECK(fabsf(result.ch1_high - (25.2F * 1.0128F * 16.1F * 1.012F)) < 0.01F);
+    CHECK(fabsf(result.ch0_maximum - (result.ch0_high * 23.1F * 1.0009F)) < 0.1F);
+
+    /* Each result is within the range of the sensor, so none were replaced */
+    CHECK(result.ch0_medium != TSL2591_GAIN_MEDIUM_TYP && result.ch1_medium != TSL2591_GAIN_MEDIUM_TYP);
+    CHECK(result.ch0_high != TSL2591_GAIN_HIGH_TYP && result.ch1_high != TSL2591_GAIN_HIGH_TYP);
+    CHECK(result.ch0_maximum != TSL2591_GAIN_MAXIMUM_CH0_TYP && result.ch1_maximum != TSL2591_GAIN_MAXIMUM_CH1_TYP);
+}
+
+static void test_run_interrupted(void)
+{
+    sim_sensor_t sim;
+    settings_cal_gain_checkpoint_t reference;
+    settings_cal_gain_checkpoint_t result;
+    const int total = sim_run_length();
+    int stages_seen[SETTING_GAIN_CAL_STAGE_MAX] = {0};
+
+    sim_init(&sim);
+    CHECK(sim_run(&sim, &reference));
+
+    /* Interrupt the run before each of its operations, then resume it */
+    for (int cut = 0; cut < total; cut++) {
+        sim_init(&sim);
+        sim.ops_left = cut;
+        CHECK(!sim_run(&sim, &result));
+
+        settings_gain_cal_stage_t stage = sim.saved_valid ? sim.saved.stage : SETTING_GAIN_CAL_STAGE_NONE;
+        stages_seen[stage]++;
+
+        sim.ops_left = -1;
+        CHECK(sim_run(&sim, &result));
+        CHECK(same_gains(&result, &reference));
+
+        /* Only the stages after the checkpoint are repeated */
+        CHECK(sim.finds + sim.measures == (int)(SETTING_GAIN_CAL_STAGE_MAX - stage));
+    }
+
+    /* Every checkpoint was resumed from */
+    for (int i = SETTING_GAIN_CAL_STAGE_NONE; i < SETTING_GAIN_CAL_STAGE_MAX; i++) {
+        CHECK(stages_seen[i] > 0);
+    }
+}
+
+static void test_run_interrupted_repeatedly(void)
+{
+    sim_sensor_t sim;
+    settings_cal_gain_checkpoint_t reference;
+    settings_cal_gain_checkpoint_t result;
+    int runs = 0;
+
+    sim_init(&sim);
+    CHECK(sim_run(&sim, &reference));
+
+    /* Every run is cut short, after completing one more stage than the last */
+    sim_init(&sim);
+    do {
+        sim.ops_left = 5;
+        runs++;
+    } while (!sim_run(&sim, &result) && runs < 20);
+
+    CHECK(runs == 3);
+    CHECK(same_gains(&result, &reference));
+}
+
+static void test_resume_after_led_drift(void)
+{
+    sim_sensor_t sim;
+    settings_cal_gain_checkpoint_t reference;
+    settings_cal_gain_checkpoint_t result;
+
+    /* Stop once high gain has been saved */
+    sim_init(&sim);
+    sim.ops_left = 5;
+    CHECK(!sim_run(&sim, &result));
+    CHECK(sim.saved_valid && sim.saved.stage == SETTING_GAIN_CAL_STAGE_HIGH);
+
+    /* The LED is now 20% brighter, so the run starts over */
+    sim.ops_left = -1;
+    sim.led_scale *= 1.20F;
+    CHECK(sim_run(&sim, &result));
+    CHECK(sim.finds == 2);
+    CHECK(sim.measures == 3);
+
+    sim_init(&sim);
+    sim.led_scale *= 1.20F;
+    CHECK(sim_run(&sim, &reference));
+    CHECK(same_gains(&result, &reference));
+    CHECK(result.measurement_brightness == 100);
+}
+
+static void test_resume_after_max_led_drift(void)
+{
+    sim_sensor_t sim;
+    settings_cal_gain_checkpoint_t reference;
+    settings_cal_gain_checkpoint_t result;
+
+    /* Stop once the maximum gain brightness has been saved */
+    sim_init(&sim);
+    sim.ops_left = 8;
+    CHECK(!sim_run(&sim, &result));
+    CHECK(sim.saved_valid && sim.saved.stage == SETTING_GAIN_CAL_STAGE_MAX_LED);
+
+    /* Only the maximum gain search is repeated */
+    sim.ops_left = -1;
+    sim.max_led_scale *= 0.80F;
+    CHECK(sim_run(&sim, &result));
+    CHECK(sim.reads == 2);
+    CHECK(sim.finds == 1);
+    CHECK(sim.measures == 1);
+
+    sim_init(&sim);
+    sim.max_led_scale *= 0.80F;
+    CHECK(sim_run(&sim, &reference));
+    CHECK(same_gains(&result, &reference));
+    CHECK(result.max_gain_brightness == reference.max_gain_brightness);
+}
+
+int main(void)
+{
+    RUN_TEST(test_reading_matches);
+    RUN_TEST(test_drifted_reading);
+    RUN_TEST(test_unusable_readings);
+    RUN_TEST(test_resume_stage);
+    RUN_TEST(test_resume_from_readings);
+    RUN_TEST(test_run_complete);
+    RUN_TEST(test_run_interrupted);
+    RUN_TEST(test_run_interrupted_repeatedly);
+    RUN_TEST(test_resume_after_led_drift);
+    RUN_TEST(test_resume_after_max_led_drift);
+    return TEST_RESULT();
+}
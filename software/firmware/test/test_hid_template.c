@@ -0,0 +1,157 @@
+/*
+ * Host tests for compiling and expanding HID keyboard output templates
+ */
+#include <stdint.h>
+#include <math.h>
+
+#include "test.h"
+#include "hid_template.h"
+
+/* Needed to link the printf library, which only uses it for printf_() */
+void _putchar(char character)
+{
+    (void)character;
+}
+
+static const char *expand(const char *source, const hid_template_values_t *values)
+{
+    static char buf[HID_TEMPLATE_OUTPUT_LEN];
+    hid_template_t tmpl;
+
+    if (!hid_template_compile(&tmpl, source)) {
+        return "<invalid>";
+    }
+    hid_template_expand(&tmpl, values, buf, sizeof(buf));
+    return buf;
+}
+
+static const hid_template_values_t READING = {
+    .mode = 'R',
+    .density = 1.2345F,
+    .zero = NAN,
+    .sequence = 42,
+    .decimal_separator = '.'
+};
+
+static void test_default_template(void)
+{
+    CHECK_STR(expand(HID_TEMPLATE_DEFAULT, &READING), "1.23\n");
+}
+
+static void test_placeholders(void)
+{
+    CHECK_STR(expand("{MODE}{SEP}{D:3}{SEP}{N:4}", &READING), "R,1.235,0042");
+    CHECK_STR(expand("{D+}{TAB}{D:0}{SPACE}{N}", &READING), "+1.23\t1 42");
+    CHECK_STR(expand("{F:1}", &READING), "4.1");
+    CHECK_STR(expand("{ZERO}", &READING), "0.00");
+    CHECK_STR(expand("{{D}}={D}", &READING), "{D}=1.23");
+}
+
+static void test_zero_and_sign(void)
+{
+    hid_template_values_t values = READING;
+    values.zero = 1.5F;
+    CHECK_STR(expand("{D}/{ZERO}", &values), "-0.27/1.50");
+    CHECK_STR(expand("{D+:1}", &values), "-0.3");
+
+    /* A negative that rounds to zero is not shown as negative */
+    values.zero = 1.236F;
+    CHECK_STR(expand("{D}", &values), "0.00");
+    CHECK_STR(expand("{D+}", &values), "+0.00");
+
+    /* Invalid readings are typed as zero */
+    values.density = NAN;
+    values.zero = NAN;
+    CHECK_STR(expand("{D}", &values), "0.00");
+}
+
+static void test_decimal_separator(void)
+{
+    hid_template_values_t values = READING;
+    values.decimal_separator = ',';
+    CHECK_STR(expand("{D}{SEP}{N}", &values), "1,23;42");
+}
+
+static void test_invalid_templates(void)
+{
+    hid_template_t tmpl;
+    CHECK(!hid_template_compile(&tmpl, "{D"));
+    CHECK(!hid_template_compile(&tmpl, "D}"));
+    CHECK(!hid_template_compile(&tmpl, "{X}"));
+    CHECK(!hid_template_compile(&tmpl, "{d}"));
+    CHECK(!hid_template_compile(&tmpl, "{D:5}"));
+    CHECK(!hid_template_compile(&tmpl, "{D:}"));
+    CHECK(!hid_template_compile(&tmpl, "{N+}"));
+    CHECK(!hid_template_compile(&tmpl, "{MODE:1}"));
+    CHECK(!hid_template_compile(&tmpl, "{ENTER+}"));
+    CHECK(!hid_template_compile(&tmpl, "A\tB"));
+    CHECK(!hid_template_compile(NULL, "{D}"));
+    CHECK(!hid_template_compile(&tmpl, NULL));
+}
+
+static void test_source_length(void)
+{
+    char source[HID_TEMPLATE_SOURCE_LEN + 2];
+    hid_template_t tmpl;
+
+    /* The longest template the SS HIDT command can carry */
+    memset(source, 'x', HID_TEMPLATE_SOURCE_LEN);
+    source[HID_TEMPLATE_SOURCE_LEN] = '\0';
+    CHECK(hid_template_compile(&tmpl, source));
+    CHECK(tmpl.op_count == 1);
+    CHECK(tmpl.literal_len == HID_TEMPLATE_SOURCE_LEN);
+
+    source[HID_TEMPLATE_SOURCE_LEN] = 'x';
+    source[HID_TEMPLATE_SOURCE_LEN + 1] = '\0';
+    CHECK(!hid_template_compile(&tmpl, source));
+}
+
+static void test_op_limit(void)
+{
+    char source[HID_TEMPLATE_SOURCE_LEN + 1];
+    hid_template_t tmpl;
+
+    /* Alternating literals and placeholders use one op each */
+    memset(source, 0, sizeof(source));
+    for (size_t i = 0; i < HID_TEMPLATE_MAX_OPS / 2; i++) {
+        strcat(source, "x{N}");
+    }
+    CHECK(hid_template_compile(&tmpl, source));
+    CHECK(tmpl.op_count == HID_TEMPLATE_MAX_OPS);
+
+    strcat(source, "x");
+    CHECK(!hid_template_compile(&tmpl, source));
+}
+
+static void test_output_truncation(void)
+{
+    hid_template_values_t values = READING;
+    hid_template_t tmpl;
+    char buf[HID_TEMPLATE_OUTPUT_LEN];
+
+    /* Eight nine digit fields expand past the output buffer */
+    values.sequence = 123456789;
+    CHECK(hid_template_compile(&tmpl, "{N:9}{N:9}{N:9}{N:9}{N:9}{N:9}{N:9}{N:9}"));
+    CHECK(hid_template_expand(&tmpl, &values, buf, sizeof(buf)) == sizeof(buf) - 1);
+    CHECK(strlen(buf) == sizeof(buf) - 1);
+    CHECK(strncmp(buf, "123456789123456789", 18) == 0);
+
+    /* Small buffers are still null terminated */
+    CHECK(hid_template_expand(&tmpl, &values, buf, 4) == 3);
+    CHECK_STR(buf, "123");
+    CHECK(hid_template_expand(&tmpl, &values, buf, 1) == 0);
+    CHECK_STR(buf, "");
+}
+
+int main(void)
+{
+    RUN_TEST(test_default_template);
+    RUN_TEST(test_placeholders);
+    RUN_TEST(test_zero_and_sign);
+    RUN_TEST(test_decimal_separator);
+    RUN_TEST(test_invalid_templates);
+    RUN_TEST(test_source_length);
+    RUN_TEST(test_op_limit);
+    RUN_TEST(test_output_truncation);
+    return TEST_RESULT();
+}
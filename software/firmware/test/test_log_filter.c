@@ -0,0 +1,270 @@
+/*
+ * Host tests for the runtime log level filters, built against the real
+ * logging library, checking that filtered out log calls never reach the
+ * formatter and measuring how much each suppressed call costs compared
+ * to one that is formatted and output
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define LOG_TAG "test"
+#include <elog.h>
+
+#include "test.h"
+#include "log_filter.h"
+
+#define BENCH_CALLS 200000
+
+static int port_lines = 0;
+static int port_formats = 0;
+static int arg_evaluations = 0;
+static char port_last_line[ELOG_LINE_BUF_SIZE + 1];
+static settings_user_log_level_t saved_log_level;
+
+/* Needed to link the printf library, which only uses it for printf_() */
+void _putchar(char character)
+{
+    (void)character;
+}
+
+/* Stand-ins for the settings that log_filter.c saves to and loads from */
+bool settings_set_user_log_level(const settings_user_log_level_t *log_level)
+{
+    saved_log_level = *log_level;
+    return true;
+}
+
+bool settings_get_user_log_level(settings_user_log_level_t *log_level)
+{
+    *log_level = saved_log_level;
+    return true;
+}
+
+/* Host port of the logging library, which records what it is given */
+ElogErrCode elog_port_init(void)
+{
+    return ELOG_NO_ERR;
+}
+
+void elog_port_deinit(void)
+{
+}
+
+void elog_port_output(const char *log, size_t size)
+{
+    if (size > ELOG_LINE_BUF_SIZE) { size = ELOG_LINE_BUF_SIZE; }
+    memcpy(port_last_line, log, size);
+    port_last_line[size] = '\0';
+    port_lines++;
+}
+
+void elog_port_output_lock(void)
+{
+}
+
+void elog_port_output_unlock(void)
+{
+}
+
+const char *elog_port_get_time(void)
+{
+    /* The time is the first thing the formatter asks for on every line */
+    port_formats++;
+    return "1234";
+}
+
+const char *elog_port_get_p_info(void)
+{
+    return "";
+}
+
+const char *elog_port_get_t_info(void)
+{
+    return "host";
+}
+
+static int counted_arg(int value)
+{
+    arg_evaluations++;
+    return value;
+}
+
+static void reset_counts(void)
+{
+    port_lines = 0;
+    port_formats = 0;
+    arg_evaluations = 0;
+    port_last_line[0] = '\0';
+}
+
+static void reset_filters(void)
+{
+    settings_user_log_level_t log_level;
+    memset(&log_level, 0, sizeof(log_level));
+    log_level.level = ELOG_LVL_VERBOSE;
+    log_filter_apply(&log_level);
+    reset_counts();
+}
+
+static double elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+    return ((double)(end->tv_sec - start->tv_sec) * 1e9) + (double)(end->tv_nsec - start->tv_nsec);
+}
+
+static void test_unfiltered(void)
+{
+    reset_filters();
+
+    log_i("Reading %d", counted_arg(42));
+    elog_d("sensor", "Gain %d", counted_arg(3));
+
+    CHECK(port_lines == 2);
+    CHECK(port_formats == 2);
+    CHECK(arg_evaluations == 2);
+    CHECK(strstr(port_last_line, "sensor") != NULL);
+    CHECK(strstr(port_last_line, "Gain 3") != NULL);
+}
+
+static void test_global_level(void)
+{
+    reset_filters();
+    CHECK(log_filter_set(LOG_FILTER_TAG_GLOBAL, ELOG_LVL_WARN));
+
+    log_v("Verbose %d", counted_arg(1));
+    log_d("Debug %d", counted_arg(2));
+    log_i("Info %d", counted_arg(3));
+    elog_i("sensor", "Info %d", counted_arg(4));
+
+    /* Nothing below the level was formatted, or even had its arguments evaluated */
+    CHECK(port_lines == 0);
+    CHECK(port_formats == 0);
+    CHECK(arg_evaluations == 0);
+
+    log_w("Warning %d", counted_arg(5));
+    log_e("Error %d", counted_arg(6));
+    CHECK(port_lines == 2);
+    CHECK(port_formats == 2);
+    CHECK(arg_evaluations == 2);
+    CHECK(strstr(port_last_line, "Error 6") != NULL);
+}
+
+static void test_tag_level(void)
+{
+    reset_filters();
+    CHECK(log_filter_set("sensor", ELOG_LVL_ERROR));
+    CHECK(log_filter_set("cdc", ELOG_LVL_ASSERT));
+
+    elog_w("sensor", "Warning %d", counted_arg(1));
+    elog_i("sensor", "Info %d", counted_arg(2));
+    elog_e("cdc", "Error %d", counted_arg(3));
+    CHECK(port_lines == 0);
+    CHECK(port_formats == 0);
+    CHECK(arg_evaluations == 0);
+
+    /* Other tags, and levels within the tag filter, still get through */
+    elog_e("sensor", "Error %d", counted_arg(4));
+    elog_d("display", "Debug %d", counted_arg(5));
+    CHECK(port_lines == 2);
+    CHECK(port_formats == 2);
+    CHECK(arg_evaluations == 2);
+    CHECK(strstr(port_last_line, "Debug 5") != NULL);
+
+    /* Tags are matched exactly, not by prefix */
+    reset_counts();
+    elog_i("sensor_task", "Info %d", counted_arg(6));
+    CHECK(port_lines == 1);
+
+    /* Removing the filter lets the tag through again */
+    reset_counts();
+    CHECK(log_filter_set("sensor", ELOG_LVL_VERBOSE));
+    elog_i("sensor", "Info %d", counted_arg(7));
+    CHECK(port_lines == 1);
+    CHECK(arg_evaluations == 1);
+}
+
+static void test_saved_filters(void)
+{
+    settings_user_log_level_t log_level;
+
+    reset_filters();
+    CHECK(log_filter_set(LOG_FILTER_TAG_GLOBAL, ELOG_LVL_INFO));
+    CHECK(log_filter_set("sensor", ELOG_LVL_WARN));
+    CHECK(log_filter_save());
+
+    /* Loading the saved filters restores both the global and tag levels */
+    reset_filters();
+    log_filter_load();
+    log_filter_get(&log_level);
+    CHECK(log_level.level == ELOG_LVL_INFO);
+    CHECK_STR(log_level.tags[0].tag, "sensor");
+    CHECK(log_level.tags[0].level == ELOG_LVL_WARN);
+
+    reset_counts();
+    log_d("Debug %d", counted_arg(1));
+    elog_i("sensor", "Info %d", counted_arg(2));
+    CHECK(port_lines == 0);
+    CHECK(arg_evaluations == 0);
+
+    /* Out of range levels in the saved settings are not applied */
+    saved_log_level.tags[0].level = 0xFF;
+    reset_filters();
+    log_filter_load();
+    reset_counts();
+    elog_v("sensor", "Verbose %d", counted_arg(3));
+    CHECK(port_lines == 0);
+    CHECK(port_formats == 0);
+    elog_i("sensor", "Info %d", counted_arg(4));
+    CHECK(port_lines == 1);
+}
+
+static void test_filter_cost(void)
+{
+    struct timespec start;
+    struct timespec end;
+    double suppressed_ns;
+    double emitted_ns;
+
+    reset_filters();
+    CHECK(log_filter_set("sensor", ELOG_LVL_WARN));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_CALLS; i++) {
+        elog_d("sensor", "Reading %d: CH0=%d CH1=%d", i, i * 2, i * 3);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    suppressed_ns = elapsed_ns(&start, &end) / BENCH_CALLS;
+    CHECK(port_formats == 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_CALLS; i++) {
+        elog_d("display", "Reading %d: CH0=%d CH1=%d", i, i * 2, i * 3);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    emitted_ns = elapsed_ns(&start, &end) / BENCH_CALLS;
+    CHECK(port_formats == BENCH_CALLS);
+    CHECK(port_lines == BENCH_CALLS);
+
+    printf("  suppressed: %.1f ns/call, emitted: %.1f ns/call (%d calls each)\n",
+        suppressed_ns, emitted_ns, BENCH_CALLS);
+
+    /* Skipping the formatter has to be a clear saving, even on a busy host */
+    CHECK(suppressed_ns * 4.0 < emitted_ns);
+}
+
+int main(void)
+{
+    elog_init();
+    for (uint8_t level = ELOG_LVL_ASSERT; level <= ELOG_LVL_VERBOSE; level++) {
+        elog_set_fmt(level, ELOG_FMT_ALL);
+    }
+    elog_set_text_color_enabled(false);
+    elog_start();
+
+    RUN_TEST(test_unfiltered);
+    RUN_TEST(test_global_level);
+    RUN_TEST(test_tag_level);
+    RUN_TEST(test_saved_filters);
+    RUN_TEST(test_filter_cost);
+    return TEST_RESULT();
+}
@@ -0,0 +1,1326 @@
+/*
+ * Host tests for the main menu, which walk the menu with scripted key
+ * events against fake settings and sensor functions, and compare the
+ * screens it draws with the snapshots in test_main_menu.snapshots.
+ * The walks are repeated in every language, checking that no text the
+ * menu draws runs past the edge of the display.
+ *
+ * Run with UPDATE_SNAPSHOTS=1 to rewrite the snapshots after a change
+ * to what the menu draws, and with SHOW_SCREENS=1 to print each screen.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "test.h"
+#include "state_main_menu.h"
+#include "display.h"
+#include "keypad.h"
+#include "settings.h"
+#include "sensor.h"
+#include "task_sensor.h"
+#include "densitometer.h"
+#include "cdc_handler.h"
+#include "task_usbd.h"
+#include "ui_strings.h"
+#include "u8g2_stm32_hal.h"
+#include "u8g2.h"
+#include "app_descriptor.h"
+
+#define SNAPSHOT_FILE "test_main_menu.snapshots"
+#define SNAPSHOT_MAX 128
+
+#define SCREEN_WIDTH  128
+#define SCREEN_HEIGHT 64
+
+extern const ui_language_info_t ui_language_list[UI_LANGUAGE_COUNT];
+
+/*
+ * Fake tick count, keypad and controller
+ */
+
+#define KEY_QUEUE_SIZE 512
+
+static uint32_t fake_ticks = 0;
+static keypad_event_t key_queue[KEY_QUEUE_SIZE];
+static size_t key_head = 0;
+static size_t key_count = 0;
+static bool fake_detect = false;
+static state_identifier_t next_state = STATE_MAX;
+
+uint32_t osKernelGetTickCount(void)
+{
+    return fake_ticks;
+}
+
+osStatus_t keypad_wait_for_event(keypad_event_t *event, int msecs_to_wait)
+{
+    if (key_count == 0) {
+        fake_ticks += msecs_to_wait;
+        return osErrorTimeout;
+    }
+    *event = key_queue[key_head];
+    key_head = (key_head + 1) % KEY_QUEUE_SIZE;
+    key_count--;
+    fake_ticks++;
+    return osOK;
+}
+
+osStatus_t keypad_clear_events()
+{
+    key_count = 0;
+    return osOK;
+}
+
+bool keypad_is_key_pressed(const keypad_event_t *event, keypad_key_t key)
+{
+    return event && (event->keypad_state & key);
+}
+
+bool keypad_is_key_combo_pressed(const keypad_event_t *event, keypad_key_t key1, keypad_key_t key2)
+{
+    if (!event || !event->pressed) { return false; }
+    return (event->key == key1 && keypad_is_key_pressed(event, key2))
+        || (event->key == key2 && keypad_is_key_pressed(event, key1));
+}
+
+bool keypad_is_detect()
+{
+    return fake_detect;
+}
+
+void state_controller_set_next_state(state_controller_t *controller, state_identifier_t state)
+{
+    next_state = state;
+}
+
+/*
+ * Fake settings
+ */
+
+static settings_cal_reflection_t fake_cal_reflection;
+static settings_cal_transmission_t fake_cal_transmission;
+static bool fake_cal_valid = true;
+static int fake_cal_saves = 0;
+static settings_cal_slope_t fake_slope;
+static bool fake_slope_set = false;
+static settings_cal_profile_t fake_profiles[SETTING_CAL_PROFILE_COUNT];
+static bool fake_profile_set[SETTING_CAL_PROFILE_COUNT];
+static uint8_t fake_active_profile = 0;
+static int fake_profile_saved = -1;
+static bool fake_profile_save_ok = true;
+static settings_user_idle_light_t fake_idle_light;
+static settings_user_display_format_t fake_display_format;
+static settings_user_usb_key_t fake_usb_key;
+static uint8_t fake_language = UI_LANGUAGE_EN;
+static uint8_t test_language = UI_LANGUAGE_EN;
+static int fake_usb_reconnects = 0;
+
+bool settings_get_cal_light(settings_cal_light_t *cal_light)
+{
+    cal_light->reflection = 140;
+    cal_light->transmission = 12;
+    return true;
+}
+
+bool settings_get_cal_gain(settings_cal_gain_t *cal_gain)
+{
+    cal_gain->ch0_medium = 24.6F;
+    cal_gain->ch1_medium = 24.8F;
+    cal_gain->ch0_high = 396.2F;
+    cal_gain->ch1_high = 410.7F;
+    cal_gain->ch0_maximum = 9183.41F;
+    cal_gain->ch1_maximum = 9927.05F;
+    return true;
+}
+
+bool settings_get_cal_slope(settings_cal_slope_t *cal_slope)
+{
+    *cal_slope = fake_slope;
+    return fake_slope_set;
+}
+
+bool settings_get_cal_reflection(settings_cal_reflection_t *cal_reflection)
+{
+    *cal_reflection = fake_cal_reflection;
+    return true;
+}
+
+bool settings_validate_cal_reflection(const settings_cal_reflection_t *cal_reflection)
+{
+    return fake_cal_valid;
+}
+
+bool settings_set_cal_reflection(const settings_cal_reflection_t *cal_reflection)
+{
+    fake_cal_reflection = *cal_reflection;
+    fake_cal_saves++;
+    return true;
+}
+
+bool settings_get_cal_transmission(settings_cal_transmission_t *cal_transmission)
+{
+    *cal_transmission = fake_cal_transmission;
+    return true;
+}
+
+bool settings_validate_cal_transmission(const settings_cal_transmission_t *cal_transmission)
+{
+    return fake_cal_valid;
+}
+
+bool settings_set_cal_transmission(const settings_cal_transmission_t *cal_transmission)
+{
+    fake_cal_transmission = *cal_transmission;
+    fake_cal_saves++;
+    return true;
+}
+
+bool settings_get_cal_profile(uint8_t index, settings_cal_profile_t *profile)
+{
+    if (index >= SETTING_CAL_PROFILE_COUNT || !fake_profile_set[index]) { return false; }
+    *profile = fake_profiles[index];
+    return true;
+}
+
+bool settings_save_cal_profile(uint8_t index, const char *name)
+{
+    if (!fake_profile_save_ok) { return false; }
+    fake_profile_saved = index;
+    return true;
+}
+
+bool settings_select_cal_profile(uint8_t index)
+{
+    if (index >= SETTING_CAL_PROFILE_COUNT || !fake_profile_set[index]) { return false; }
+    fake_active_profile = index;
+    return true;
+}
+
+uint8_t settings_get_active_cal_profile()
+{
+    return fake_active_profile;
+}
+
+bool settings_get_user_idle_light(settings_user_idle_light_t *idle_light)
+{
+    *idle_light = fake_idle_light;
+    return true;
+}
+
+bool settings_set_user_idle_light(const settings_user_idle_light_t *idle_light)
+{
+    fake_idle_light = *idle_light;
+    return true;
+}
+
+bool settings_get_user_display_format(settings_user_display_format_t *display_format)
+{
+    *display_format = fake_display_format;
+    return true;
+}
+
+bool settings_set_user_display_format(const settings_user_display_format_t *display_format)
+{
+    fake_display_format = *display_format;
+    return true;
+}
+
+bool settings_get_user_usb_key(settings_user_usb_key_t *usb_key)
+{
+    *usb_key = fake_usb_key;
+    return true;
+}
+
+bool settings_set_user_usb_key(const settings_user_usb_key_t *usb_key)
+{
+    fake_usb_key = *usb_key;
+    return true;
+}
+
+uint8_t settings_get_user_language()
+{
+    return fake_language;
+}
+
+bool settings_set_user_language(uint8_t language)
+{
+    fake_language = language;
+    return true;
+}
+
+char settings_get_decimal_separator()
+{
+    return (fake_display_format.separator == SETTING_DECIMAL_SEPARATOR_COMMA) ? ',' : '.';
+}
+
+char settings_get_unit_suffix()
+{
+    return (fake_display_format.unit == SETTING_DISPLAY_UNIT_FSTOP) ? 'F' : 'D';
+}
+
+void usb_device_reconnect()
+{
+    fake_usb_reconnects++;
+}
+
+/*
+ * Fake sensor and densitometer
+ */
+
+static sensor_light_t fake_light = SENSOR_LIGHT_OFF;
+static uint8_t fake_light_value = 0;
+static tsl2591_gain_t fake_sensor_gain = TSL2591_GAIN_LOW;
+static tsl2591_time_t fake_sensor_time = TSL2591_TIME_100MS;
+static bool fake_sensor_running = false;
+static bool fake_sensor_responds = true;
+static int fake_sensor_configs = 0;
+static sensor_cal_temp_t fake_cal_temp = SENSOR_CAL_TEMP_GAIN;
+
+static char fake_densitometer_reflection;
+static char fake_densitometer_transmission;
+static const densitometer_t *fake_cal_densitometer = NULL;
+static densitometer_result_t fake_cal_result = DENSITOMETER_OK;
+static float fake_cal_values[4];
+static int fake_cal_count = 0;
+
+osStatus_t sensor_set_light_mode(sensor_light_t light, bool next_cycle, uint8_t value)
+{
+    fake_light = light;
+    fake_light_value = value;
+    return osOK;
+}
+
+osStatus_t sensor_set_config(tsl2591_gain_t gain, tsl2591_time_t time)
+{
+    fake_sensor_gain = gain;
+    fake_sensor_time = time;
+    fake_sensor_configs++;
+    return osOK;
+}
+
+osStatus_t sensor_start()
+{
+    fake_sensor_running = true;
+    return osOK;
+}
+
+osStatus_t sensor_stop()
+{
+    fake_sensor_running = false;
+    return osOK;
+}
+
+osStatus_t sensor_get_next_reading(sensor_reading_t *reading, uint32_t timeout)
+{
+    if (!fake_sensor_running || !fake_sensor_responds) {
+        return osErrorTimeout;
+    }
+    memset(reading, 0, sizeof(sensor_reading_t));
+    reading->ch0_val = 12345;
+    reading->ch1_val = 678;
+    reading->gain = fake_sensor_gain;
+    reading->time = fake_sensor_time;
+    reading->reading_ticks = fake_ticks;
+    return osOK;
+}
+
+void sensor_convert_to_basic_counts(const sensor_reading_t *reading, float *ch0_basic, float *ch1_basic)
+{
+    *ch0_basic = reading->ch0_val / 100.0F;
+    *ch1_basic = reading->ch1_val / 100.0F;
+}
+
+bool sensor_record_cal_temperature(sensor_cal_temp_t cal_temp)
+{
+    fake_cal_temp = cal_temp;
+    return true;
+}
+
+uint16_t tsl2591_get_time_value_ms(tsl2591_time_t time)
+{
+    return (time + 1) * 100;
+}
+
+densitometer_t *densitometer_reflection()
+{
+    return (densitometer_t *)&fake_densitometer_reflection;
+}
+
+densitometer_t *densitometer_transmission()
+{
+    return (densitometer_t *)&fake_densitometer_transmission;
+}
+
+densitometer_result_t densitometer_calibrate(densitometer_t *densitometer, float *cal_value, float *cal_uncertainty, sensor_read_callback_t callback, void *user_data)
+{
+    fake_cal_densitometer = densitometer;
+    if (callback) {
+        callback(user_data);
+    }
+    if (fake_cal_result != DENSITOMETER_OK) {
+        return fake_cal_result;
+    }
+    *cal_value = fake_cal_values[fake_cal_count % 4];
+    *cal_uncertainty = *cal_value * 0.001F;
+    fake_cal_count++;
+    return DENSITOMETER_OK;
+}
+
+/*
+ * Fake display hardware and screenshot capture
+ */
+
+static char capture_buf[16384];
+static size_t capture_len = 0;
+
+void u8g2_stm32_hal_init(SPI_HandleTypeDef *hspi)
+{
+}
+
+uint8_t u8g2_stm32_spi_byte_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
+{
+    return 1;
+}
+
+uint8_t u8g2_stm32_gpio_and_delay_cb(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr)
+{
+    return 1;
+}
+
+void cdc_write(const char *buf, size_t len)
+{
+    if (capture_len + len < sizeof(capture_buf)) {
+        memcpy(capture_buf + capture_len, buf, len);
+        capture_len += len;
+        capture_buf[capture_len] = '\0';
+    }
+}
+
+const app_descriptor_t *app_descriptor_get()
+{
+    static app_descriptor_t app_descriptor = {
+        .magic_word = APP_DESCRIPTOR_MAGIC_WORD,
+        .project_name = "Densitometer",
+        .version = "v1.2.3"
+    };
+    return &app_descriptor;
+}
+
+/*
+ * Width checks on the text drawn by the menu. All of the u8g2 text
+ * functions the menu uses end up in u8g2_DrawUTF8(), which is wrapped
+ * at link time to measure each string in the font it is drawn with.
+ */
+
+#define OVERFLOW_REPORT_MAX 32
+
+static char overflow_reported[OVERFLOW_REPORT_MAX][64];
+static size_t overflow_count = 0;
+
+u8g2_uint_t __real_u8g2_DrawUTF8(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, const char *str);
+
+static const char *language_name(uint8_t language)
+{
+    return ui_str_lang(UI_LANGUAGE_EN, STR_LANGUAGE_EN + language);
+}
+
+static uint8_t language_after(int steps)
+{
+    return (test_language + steps) % UI_LANGUAGE_COUNT;
+}
+
+/*
+ * Report each string that does not fit once, rather than on every redraw.
+ * Drawing stops at a newline, so only the text up to it is reported.
+ */
+static void report_overflow(const char *str, unsigned x, unsigned width, unsigned display_width)
+{
+    int len = (int)strcspn(str, "\n");
+    if (len >= (int)sizeof(overflow_reported[0])) { len = sizeof(overflow_reported[0]) - 1; }
+
+    for (size_t i = 0; i < overflow_count; i++) {
+        if (strncmp(overflow_reported[i], str, len) == 0 && overflow_reported[i][len] == '\0') {
+            return;
+        }
+    }
+    if (overflow_count < OVERFLOW_REPORT_MAX) {
+        memcpy(overflow_reported[overflow_count], str, len);
+        overflow_reported[overflow_count][len] = '\0';
+        overflow_count++;
+    }
+    fprintf(stderr, "%s: \"%.*s\" drawn at x=%u is %u pixels wide, past the %u pixel display\n",
+        language_name(fake_language), len, str, x, width, display_width);
+    test_failures++;
+}
+
+u8g2_uint_t __wrap_u8g2_DrawUTF8(u8g2_t *u8g2, u8g2_uint_t x, u8g2_uint_t y, const char *str)
+{
+    /* Positions left of the display wrap around, so they are caught too */
+    u8g2_uint_t width = u8g2_GetUTF8Width(u8g2, str);
+    u8g2_uint_t display_width = u8g2_GetDisplayWidth(u8g2);
+    if ((uint32_t)x + width > display_width) {
+        report_overflow(str, x, width, display_width);
+    }
+    return __real_u8g2_DrawUTF8(u8g2, x, y, str);
+}
+
+/*
+ * Snapshots of the screen, stored as a hash of the frame buffer
+ */
+
+typedef struct {
+    char name[48];
+    uint32_t hash;
+} snapshot_t;
+
+static snapshot_t snapshots[SNAPSHOT_MAX];
+static size_t snapshot_count = 0;
+static bool update_snapshots = false;
+static bool show_screens = false;
+
+static void snapshots_load(void)
+{
+    FILE *fp = fopen(SNAPSHOT_FILE, "r");
+    if (!fp) { return; }
+
+    char name[48];
+    unsigned int hash;
+    while (snapshot_count < SNAPSHOT_MAX && fscanf(fp, "%47s %x", name, &hash) == 2) {
+        strcpy(snapshots[snapshot_count].name, name);
+        snapshots[snapshot_count].hash = hash;
+        snapshot_count++;
+    }
+    fclose(fp);
+}
+
+static bool snapshots_save(void)
+{
+    FILE *fp = fopen(SNAPSHOT_FILE, "w");
+    if (!fp) { return false; }
+
+    for (size_t i = 0; i < snapshot_count; i++) {
+        fprintf(fp, "%s %08x\n", snapshots[i].name, snapshots[i].hash);
+    }
+    fclose(fp);
+    return true;
+}
+
+static snapshot_t *snapshot_find(const char *name)
+{
+    for (size_t i = 0; i < snapshot_count; i++) {
+        if (strcmp(snapshots[i].name, name) == 0) {
+            return &snapshots[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Capture the frame buffer as the firmware does for the screenshot
+ * command, and unpack the XBM data into one byte per pixel.
+ */
+static void screen_capture(uint8_t pixels[SCREEN_HEIGHT][SCREEN_WIDTH])
+{
+    capture_len = 0;
+    capture_buf[0] = '\0';
+    display_capture_screenshot();
+
+    memset(pixels, 0, SCREEN_HEIGHT * SCREEN_WIDTH);
+    const char *p = strchr(capture_buf, '{');
+    size_t index = 0;
+    while (p && (p = strstr(p, "0x")) && index < (SCREEN_WIDTH * SCREEN_HEIGHT) / 8) {
+        uint8_t value = (uint8_t)strtoul(p, NULL, 16);
+        for (int bit = 0; bit < 8; bit++) {
+            size_t pos = (index * 8) + bit;
+            pixels[pos / SCREEN_WIDTH][pos % SCREEN_WIDTH] = (value >> bit) & 1;
+        }
+        index++;
+        p += 2;
+    }
+}
+
+static void screen_print(const char *name, uint8_t pixels[SCREEN_HEIGHT][SCREEN_WIDTH])
+{
+    /* The display is mounted upside down, so the buffer is rotated back */
+    fprintf(stderr, "%s:\n", name);
+    for (int y = SCREEN_HEIGHT - 1; y >= 0; y--) {
+        char line[SCREEN_WIDTH + 1];
+        for (int x = SCREEN_WIDTH - 1; x >= 0; x--) {
+            line[SCREEN_WIDTH - 1 - x] = pixels[y][x] ? '#' : '.';
+        }
+        line[SCREEN_WIDTH] = '\0';
+        fprintf(stderr, "%s\n", line);
+    }
+}
+
+static uint32_t screen_hash(uint8_t pixels[SCREEN_HEIGHT][SCREEN_WIDTH])
+{
+    uint32_t hash = 2166136261UL;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            hash ^= pixels[y][x];
+            hash *= 16777619UL;
+        }
+    }
+    return hash;
+}
+
+#define CHECK_SCREEN(name) check_screen(__FILE__, __LINE__, (name))
+
+static void check_screen(const char *file, int line, const char *name)
+{
+    static uint8_t pixels[SCREEN_HEIGHT][SCREEN_WIDTH];
+    screen_capture(pixels);
+    uint32_t hash = screen_hash(pixels);
+
+    if (show_screens) {
+        screen_print(name, pixels);
+    }
+
+    /* The snapshots are of the English screens, other languages are only width checked */
+    if (test_language != UI_LANGUAGE_EN) {
+        return;
+    }
+
+    snapshot_t *snapshot = snapshot_find(name);
+    if (update_snapshots && !snapshot && snapshot_count < SNAPSHOT_MAX) {
+        strcpy(snapshots[snapshot_count].name, name);
+        snapshots[snapshot_count].hash = hash;
+        snapshot_count++;
+    } else if (!snapshot) {
+        fprintf(stderr, "%s:%d: no snapshot of \"%s\"\n", file, line, name);
+        screen_print(name, pixels);
+        test_failures++;
+    } else if (snapshot->hash != hash) {
+        fprintf(stderr, "%s:%d: screen \"%s\" does not match its snapshot\n", file, line, name);
+        screen_print(name, pixels);
+        test_failures++;
+    }
+}
+
+/*
+ * Menu driver
+ */
+
+static state_t *menu = NULL;
+
+static void push_event(keypad_key_t key, bool pressed, uint16_t keypad_state)
+{
+    if (key_count >= KEY_QUEUE_SIZE) { return; }
+    keypad_event_t *event = &key_queue[(key_head + key_count) % KEY_QUEUE_SIZE];
+    event->key = key;
+    event->pressed = pressed;
+    event->repeated = false;
+    event->keypad_state = keypad_state;
+    key_count++;
+}
+
+/* Queue a press and release of a single key */
+static void press(keypad_key_t key)
+{
+    push_event(key, true, key);
+    push_event(key, false, 0);
+}
+
+static void press_n(keypad_key_t key, int count)
+{
+    for (int i = 0; i < count; i++) {
+        press(key);
+    }
+}
+
+/* Process queued key events, then make one more pass to draw the result */
+static void menu_run(void)
+{
+    while (key_count > 0 && next_state == STATE_MAX) {
+        menu->state_process(menu, NULL);
+    }
+    if (next_state == STATE_MAX) {
+        menu->state_process(menu, NULL);
+    }
+}
+
+static void menu_leave(void)
+{
+    menu->state_exit(menu, NULL, next_state);
+}
+
+static void fakes_reset(void)
+{
+    key_head = 0;
+    key_count = 0;
+    fake_detect = false;
+    next_state = STATE_MAX;
+
+    fake_cal_reflection = (settings_cal_reflection_t) {
+        .lo_d = 0.08F, .lo_value = 0.4F, .hi_d = 1.50F, .hi_value = 0.02F, .lo_unc = NAN, .hi_unc = NAN
+    };
+    fake_cal_transmission = (settings_cal_transmission_t) {
+        .zero_value = 120.0F, .hi_d = 2.00F, .hi_value = 1.2F, .hi_unc = NAN
+    };
+    fake_cal_valid = true;
+    fake_cal_saves = 0;
+    fake_slope = (settings_cal_slope_t) { .b0 = -0.01F, .b1 = 1.02F, .b2 = 0.0001F };
+    fake_slope_set = true;
+
+    memset(fake_profiles, 0, sizeof(fake_profiles));
+    memset(fake_profile_set, 0, sizeof(fake_profile_set));
+    strcpy(fake_profiles[0].name, "Factory");
+    fake_profile_set[0] = true;
+    fake_active_profile = 0;
+    fake_profile_saved = -1;
+    fake_profile_save_ok = true;
+
+    fake_idle_light = (settings_user_idle_light_t) {
+        .reflection = SETTING_IDLE_LIGHT_REFL_MEDIUM, .transmission = SETTING_IDLE_LIGHT_TRAN_LOW, .timeout = 30
+    };
+    fake_display_format = (settings_user_display_format_t) {
+        .separator = SETTING_DECIMAL_SEPARATOR_PERIOD, .unit = SETTING_DISPLAY_UNIT_DENSITY
+    };
+    fake_usb_key = (settings_user_usb_key_t) {
+        .enabled = false, .format = SETTING_KEY_FORMAT_NUMBER, .separator = SETTING_KEY_SEPARATOR_ENTER
+    };
+    fake_language = test_language;
+    fake_usb_reconnects = 0;
+
+    fake_light = SENSOR_LIGHT_OFF;
+    fake_light_value = 0;
+    fake_sensor_running = false;
+    fake_sensor_responds = true;
+    fake_sensor_configs = 0;
+    fake_cal_temp = SENSOR_CAL_TEMP_GAIN;
+    fake_cal_densitometer = NULL;
+    fake_cal_result = DENSITOMETER_OK;
+    fake_cal_count = 0;
+}
+
+/* Reset the fakes and enter the menu, showing the top level */
+static void menu_start(void)
+{
+    fakes_reset();
+    menu->state_entry(menu, NULL, STATE_HOME);
+    menu_run();
+}
+
+/*
+ * Tests
+ */
+
+static void test_menu_tree(void)
+{
+    menu_start();
+    CHECK_SCREEN("root");
+
+    press(KEYPAD_BUTTON_DOWN);
+    menu_run();
+    CHECK_SCREEN("root_settings");
+
+    /* Moving past either end wraps around */
+    press_n(KEYPAD_BUTTON_DOWN, 2);
+    menu_run();
+    CHECK_SCREEN("root");
+    press(KEYPAD_BUTTON_UP);
+    menu_run();
+    CHECK_SCREEN("root_about");
+
+    press_n(KEYPAD_BUTTON_DOWN, 1);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("calibration");
+
+    press(KEYPAD_BUTTON_UP);
+    menu_run();
+    CHECK_SCREEN("calibration_profiles");
+
+    press(KEYPAD_BUTTON_MENU);
+    menu_run();
+    CHECK_SCREEN("root");
+    CHECK(next_state == STATE_MAX);
+
+    /* Going back from the top level leaves the menu */
+    press(KEYPAD_BUTTON_MENU);
+    menu_run();
+    CHECK(next_state == STATE_HOME);
+    menu_leave();
+}
+
+static void test_settings_cycle(void)
+{
+    menu_start();
+    press(KEYPAD_BUTTON_DOWN);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("settings");
+
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("target_light");
+
+    /* Choice settings cycle through their values in place */
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_idle_light.reflection == SETTING_IDLE_LIGHT_REFL_HIGH);
+    CHECK_SCREEN("target_light_refl_high");
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_idle_light.reflection == 0);
+    CHECK(fake_idle_light.transmission == SETTING_IDLE_LIGHT_TRAN_LOW);
+    CHECK(fake_idle_light.timeout == 30);
+
+    press(KEYPAD_BUTTON_MENU);
+    press(KEYPAD_BUTTON_DOWN);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("display_format");
+
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_display_format.separator == SETTING_DECIMAL_SEPARATOR_COMMA);
+    CHECK_SCREEN("display_format_comma");
+
+    /* The menu is redrawn in the new language as soon as it is selected */
+    press_n(KEYPAD_BUTTON_UP, 1);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_language == language_after(1));
+    CHECK_SCREEN("display_format_de");
+    press_n(KEYPAD_BUTTON_ACTION, 2);
+    menu_run();
+    CHECK(fake_language == language_after(3));
+    CHECK_SCREEN("display_format_ja");
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_language == test_language);
+
+    /* Toggling the USB keyboard reconnects the device */
+    press(KEYPAD_BUTTON_MENU);
+    press(KEYPAD_BUTTON_DOWN);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("usb_key_output");
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_usb_key.enabled);
+    CHECK(fake_usb_reconnects == 1);
+
+    press_n(KEYPAD_BUTTON_MENU, 3);
+    menu_run();
+    CHECK(next_state == STATE_HOME);
+    menu_leave();
+}
+
+static void test_setting_range_edit(void)
+{
+    menu_start();
+    press(KEYPAD_BUTTON_DOWN);
+    press_n(KEYPAD_BUTTON_ACTION, 1);
+    press(KEYPAD_BUTTON_ACTION);
+    press_n(KEYPAD_BUTTON_DOWN, 2);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("idle_time_edit");
+
+    /* Values only change in the editor until they are selected */
+    press(KEYPAD_BUTTON_UP);
+    menu_run();
+    CHECK_SCREEN("idle_time_edit_40");
+    CHECK(fake_idle_light.timeout == 30);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_idle_light.timeout == 40);
+    CHECK_SCREEN("target_light_time_40");
+
+    /* The minimum is shown with its label, and stepping past it wraps */
+    press(KEYPAD_BUTTON_ACTION);
+    press_n(KEYPAD_BUTTON_DOWN, 4);
+    menu_run();
+    CHECK_SCREEN("idle_time_edit_none");
+    press(KEYPAD_BUTTON_DOWN);
+    menu_run();
+    CHECK_SCREEN("idle_time_edit_240");
+
+    /* Going back discards the edited value */
+    press(KEYPAD_BUTTON_MENU);
+    menu_run();
+    CHECK(fake_idle_light.timeout == 40);
+    CHECK_SCREEN("target_light_time_40");
+
+    press(KEYPAD_BUTTON_ACTION);
+    press_n(KEYPAD_BUTTON_UP, 21);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_idle_light.timeout == 0);
+    menu_leave();
+}
+
+static void open_calibration_page(int pos)
+{
+    menu_start();
+    press(KEYPAD_BUTTON_ACTION);
+    press_n(KEYPAD_BUTTON_DOWN, pos);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+}
+
+static void test_cal_reflection(void)
+{
+    open_calibration_page(0);
+    CHECK_SCREEN("cal_refl");
+
+    /* Edit the CAL-LO target density */
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("cal_refl_input_lo");
+    press_n(KEYPAD_BUTTON_UP, 2);
+    menu_run();
+    CHECK_SCREEN("cal_refl_input_lo_10");
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("cal_refl_lo_10");
+    CHECK(fake_cal_saves == 0);
+
+    press_n(KEYPAD_BUTTON_DOWN, 2);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("cal_refl_position_lo");
+    CHECK(fake_light == SENSOR_LIGHT_REFLECTION);
+    CHECK(fake_light_value == SETTING_IDLE_LIGHT_REFL_DEFAULT);
+
+    /* Nothing is measured without a target in place */
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_cal_densitometer == NULL);
+    CHECK_SCREEN("cal_refl_position_lo");
+
+    fake_detect = true;
+    fake_cal_values[0] = 0.42F;
+    fake_cal_values[1] = 0.015F;
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_cal_densitometer == densitometer_reflection());
+    CHECK_SCREEN("cal_refl_position_hi");
+
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("cal_refl_complete");
+    CHECK(fake_cal_saves == 1);
+    CHECK(fabsf(fake_cal_reflection.lo_d - 0.10F) < 0.0001F);
+    CHECK(fabsf(fake_cal_reflection.hi_d - 1.50F) < 0.0001F);
+    CHECK(fake_cal_reflection.lo_value == 0.42F);
+    CHECK(fake_cal_reflection.hi_value == 0.015F);
+    CHECK(isfinite(fake_cal_reflection.lo_unc) && fake_cal_reflection.lo_unc > 0.0F);
+    CHECK(isfinite(fake_cal_reflection.hi_unc) && fake_cal_reflection.hi_unc > 0.0F);
+    CHECK(fake_cal_temp == SENSOR_CAL_TEMP_REFLECTION);
+    CHECK(fake_light == SENSOR_LIGHT_OFF);
+
+    /* Dismissing the result returns to the calibration menu */
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("calibration");
+    menu_leave();
+}
+
+static void test_cal_reflection_errors(void)
+{
+    /* Target densities out of order are rejected before measuring */
+    open_calibration_page(0);
+    fake_cal_reflection.lo_d = 2.00F;
+    press(KEYPAD_BUTTON_MENU);
+    press(KEYPAD_BUTTON_ACTION);
+    press_n(KEYPAD_BUTTON_UP, 1);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("cal_refl_values_invalid");
+    CHECK(fake_light == SENSOR_LIGHT_OFF);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("cal_refl_invalid_list");
+    menu_leave();
+
+    /* Canceling at either position closes the page without saving */
+    open_calibration_page(0);
+    press_n(KEYPAD_BUTTON_UP, 1);
+    press(KEYPAD_BUTTON_ACTION);
+    press(KEYPAD_BUTTON_MENU);
+    menu_run();
+    CHECK_SCREEN("cal_refl_canceled");
+    CHECK(fake_light == SENSOR_LIGHT_OFF);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("calibration");
+    CHECK(fake_cal_saves == 0);
+    menu_leave();
+
+    /* A failed measurement leaves the page open, to try again */
+    open_calibration_page(0);
+    fake_detect = true;
+    fake_cal_result = DENSITOMETER_SENSOR_ERROR;
+    press_n(KEYPAD_BUTTON_UP, 1);
+    press_n(KEYPAD_BUTTON_ACTION, 2);
+    menu_run();
+    CHECK_SCREEN("cal_refl_failed");
+    CHECK(fake_light == SENSOR_LIGHT_OFF);
+    press(KEYPAD_BUTTON_MENU);
+    menu_run();
+    CHECK_SCREEN("cal_refl_measure");
+
+    /* Measurements that do not validate are not saved */
+    fake_cal_result = DENSITOMETER_OK;
+    fake_cal_valid = false;
+    press_n(KEYPAD_BUTTON_ACTION, 3);
+    menu_run();
+    CHECK_SCREEN("cal_refl_unable_to_save");
+    CHECK(fake_cal_saves == 0);
+    menu_leave();
+}
+
+static void test_cal_transmission(void)
+{
+    open_calibration_page(1);
+    CHECK_SCREEN("cal_tran");
+
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("cal_tran_input_hi");
+
+    /* The input wraps around from zero to its maximum */
+    press_n(KEYPAD_BUTTON_DOWN, 200);
+    menu_run();
+    CHECK_SCREEN("cal_tran_input_hi_0");
+    press(KEYPAD_BUTTON_DOWN);
+    menu_run();
+    CHECK_SCREEN("cal_tran_input_hi_max");
+    press(KEYPAD_BUTTON_MENU);
+    menu_run();
+
+    press(KEYPAD_BUTTON_DOWN);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("cal_tran_position_zero");
+    CHECK(fake_light == SENSOR_LIGHT_TRANSMISSION);
+    CHECK(fake_light_value == SETTING_IDLE_LIGHT_TRAN_DEFAULT);
+
+    fake_detect = true;
+    fake_cal_values[0] = 130.0F;
+    fake_cal_values[1] = 1.25F;
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_cal_densitometer == densitometer_transmission());
+    CHECK_SCREEN("cal_tran_position_hi");
+
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("cal_tran_complete");
+    CHECK(fake_cal_saves == 1);
+    CHECK(fake_cal_transmission.zero_value == 130.0F);
+    CHECK(fake_cal_transmission.hi_value == 1.25F);
+    CHECK(fabsf(fake_cal_transmission.hi_d - 2.00F) < 0.0001F);
+    CHECK(isfinite(fake_cal_transmission.hi_unc) && fake_cal_transmission.hi_unc > 0.0F);
+    CHECK(fake_cal_temp == SENSOR_CAL_TEMP_TRANSMISSION);
+    menu_leave();
+}
+
+static void test_sensor_pages(void)
+{
+    open_calibration_page(2);
+    CHECK_SCREEN("sensor_gain");
+    press_n(KEYPAD_BUTTON_DOWN, 5);
+    menu_run();
+    CHECK_SCREEN("sensor_gain_scrolled");
+    press(KEYPAD_BUTTON_MENU);
+    menu_run();
+    CHECK_SCREEN("calibration_sensor_gain");
+    menu_leave();
+
+    open_calibration_page(3);
+    CHECK_SCREEN("sensor_slope");
+    menu_leave();
+
+    /* Without a slope calibration, there is only a message to dismiss */
+    fakes_reset();
+    fake_slope_set = false;
+    menu->state_entry(menu, NULL, STATE_HOME);
+    press(KEYPAD_BUTTON_ACTION);
+    press_n(KEYPAD_BUTTON_DOWN, 3);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("sensor_slope_not_set");
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("calibration_sensor_slope");
+    menu_leave();
+}
+
+static void test_profiles(void)
+{
+    open_calibration_page(4);
+    CHECK_SCREEN("profiles");
+
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("profile_load_save");
+    press(KEYPAD_BUTTON_MENU);
+    menu_run();
+    CHECK_SCREEN("profiles");
+
+    /* An empty slot can only be saved to */
+    press(KEYPAD_BUTTON_DOWN);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("profile_save");
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_profile_saved == 1);
+    CHECK_SCREEN("profiles_slot_2");
+
+    /* Loading a profile marks it as active */
+    strcpy(fake_profiles[1].name, "Paper");
+    fake_profile_set[1] = true;
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("profile_load_save_paper");
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_active_profile == 1);
+    CHECK_SCREEN("profiles_paper_active");
+
+    fake_profile_save_ok = false;
+    press(KEYPAD_BUTTON_DOWN);
+    press_n(KEYPAD_BUTTON_ACTION, 2);
+    menu_run();
+    CHECK_SCREEN("profile_unable_to_save");
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("profiles_slot_3");
+    menu_leave();
+}
+
+static void open_diagnostics(void)
+{
+    menu_start();
+    press(KEYPAD_BUTTON_DOWN);
+    press(KEYPAD_BUTTON_ACTION);
+    press_n(KEYPAD_BUTTON_UP, 1);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+}
+
+static void test_diagnostics(void)
+{
+    open_diagnostics();
+    CHECK(fake_sensor_running);
+    CHECK_SCREEN("diagnostics");
+
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_sensor_gain == TSL2591_GAIN_MEDIUM);
+    CHECK_SCREEN("diagnostics_medium");
+
+    press(KEYPAD_BUTTON_UP);
+    menu_run();
+    CHECK(fake_sensor_time == TSL2591_TIME_200MS);
+
+    press(KEYPAD_BUTTON_DOWN);
+    menu_run();
+    CHECK(fake_light == SENSOR_LIGHT_REFLECTION);
+    CHECK_SCREEN("diagnostics_reflection");
+
+    /* Pressing both keys together switches to basic counts */
+    push_event(KEYPAD_BUTTON_ACTION, true, KEYPAD_BUTTON_ACTION);
+    push_event(KEYPAD_BUTTON_UP, true, KEYPAD_BUTTON_ACTION | KEYPAD_BUTTON_UP);
+    push_event(KEYPAD_BUTTON_UP, false, KEYPAD_BUTTON_ACTION);
+    push_event(KEYPAD_BUTTON_ACTION, false, 0);
+    fake_detect = true;
+    menu_run();
+    CHECK_SCREEN("diagnostics_basic");
+
+    /* The live readings keep the menu from timing out */
+    for (int i = 0; i < 600; i++) {
+        menu->state_process(menu, NULL);
+    }
+    CHECK(next_state == STATE_MAX);
+
+    press(KEYPAD_BUTTON_MENU);
+    menu_run();
+    CHECK(!fake_sensor_running);
+    CHECK(fake_light == SENSOR_LIGHT_OFF);
+    CHECK_SCREEN("settings_diagnostics");
+    menu_leave();
+}
+
+static void test_diagnostics_init_failed(void)
+{
+    fakes_reset();
+    fake_sensor_responds = false;
+    menu->state_entry(menu, NULL, STATE_HOME);
+    press(KEYPAD_BUTTON_DOWN);
+    press(KEYPAD_BUTTON_ACTION);
+    press_n(KEYPAD_BUTTON_UP, 1);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_sensor_running);
+
+    /* The page waits for the first reading without blocking the menu */
+    for (int i = 0; i < 25; i++) {
+        menu->state_process(menu, NULL);
+    }
+    CHECK_SCREEN("diagnostics_init_failed");
+
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(!fake_sensor_running);
+    CHECK_SCREEN("settings_diagnostics");
+    menu_leave();
+}
+
+static void test_about(void)
+{
+    menu_start();
+    press(KEYPAD_BUTTON_UP);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("about");
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK_SCREEN("root_about");
+    menu_leave();
+}
+
+static void test_timeouts(void)
+{
+    /* An idle menu returns home once the timeout passes */
+    menu_start();
+    uint32_t start = fake_ticks;
+    int passes = 0;
+    while (next_state == STATE_MAX && passes < 1000) {
+        menu->state_process(menu, NULL);
+        passes++;
+    }
+    CHECK(next_state == STATE_HOME);
+    CHECK(fake_ticks - start >= MENU_TIMEOUT_MS);
+    CHECK(fake_ticks - start <= MENU_TIMEOUT_MS + STATE_KEYPAD_WAIT);
+    menu_leave();
+
+    /* A forced timeout from within a page closes the page on the way out */
+    open_diagnostics();
+    CHECK(fake_sensor_running);
+    push_event(KEYPAD_FORCE_TIMEOUT, true, 0);
+    menu_run();
+    CHECK(next_state == STATE_HOME);
+    menu_leave();
+    CHECK(!fake_sensor_running);
+    CHECK(fake_light == SENSOR_LIGHT_OFF);
+
+    /* So does an idle timeout, on a page without live readings */
+    open_calibration_page(0);
+    press(KEYPAD_BUTTON_UP);
+    press(KEYPAD_BUTTON_ACTION);
+    menu_run();
+    CHECK(fake_light == SENSOR_LIGHT_REFLECTION);
+    for (int i = 0; i < 1000 && next_state == STATE_MAX; i++) {
+        menu->state_process(menu, NULL);
+    }
+    CHECK(next_state == STATE_HOME);
+    menu_leave();
+    CHECK(fake_light == SENSOR_LIGHT_OFF);
+    CHECK(fake_cal_saves == 0);
+}
+
+/* Decode one UTF-8 character, returning 0 at the end of the string */
+static uint16_t utf8_next(const char **p)
+{
+    const uint8_t *s = (const uint8_t *)*p;
+    uint16_t ch;
+    int extra;
+
+    if (*s == '\0') { return 0; }
+    if (*s < 0x80) { ch = *s; extra = 0; }
+    else if ((*s & 0xE0) == 0xC0) { ch = *s & 0x1F; extra = 1; }
+    else { ch = *s & 0x0F; extra = 2; }
+    s++;
+    while (extra-- > 0 && (*s & 0xC0) == 0x80) {
+        ch = (ch << 6) | (*s++ & 0x3F);
+    }
+    *p = (const char *)s;
+    return ch;
+}
+
+static void test_string_tables(void)
+{
+    /* Every line of every string, including those the walks above never reach */
+    static u8g2_t u8g2;
+    char line[128];
+
+    for (uint8_t language = 0; language < UI_LANGUAGE_COUNT; language++) {
+        u8g2_SetFont(&u8g2, ui_language_list[language].font);
+
+        for (int id = 0; id < STR_COUNT; id++) {
+            const char *str = ui_str_lang(language, id);
+            while (str) {
+                const char *end = strchr(str, '\n');
+                size_t len = end ? (size_t)(end - str) : strlen(str);
+                if (len >= sizeof(line)) { len = sizeof(line) - 1; }
+                memcpy(line, str, len);
+                line[len] = '\0';
+                str = end ? end + 1 : NULL;
+
+                /* Missing glyphs would leave the translation cut short on the display */
+                const char *p = line;
+                uint16_t ch;
+                while ((ch = utf8_next(&p)) != 0) {
+                    if (!u8g2_IsGlyph(&u8g2, ch)) {
+                        fprintf(stderr, "%s: string %d \"%s\" has U+%04X, which is not in the font\n",
+                            language_name(language), id, line, ch);
+                        test_failures++;
+                    }
+                }
+
+                u8g2_uint_t width = u8g2_GetUTF8Width(&u8g2, line);
+                if (width > SCREEN_WIDTH) {
+                    fprintf(stderr, "%s: string %d \"%s\" is %u pixels wide, past the %u pixel display\n",
+                        language_name(language), id, line, (unsigned)width, SCREEN_WIDTH);
+                    test_failures++;
+                }
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    update_snapshots = getenv("UPDATE_SNAPSHOTS") != NULL;
+    show_screens = getenv("SHOW_SCREENS") != NULL;
+    if (!update_snapshots) {
+        snapshots_load();
+    }
+
+    display_init(NULL);
+    menu = state_main_menu();
+
+    /* Each walk runs in every language, starting with the snapshots in English */
+    for (test_language = 0; test_language < UI_LANGUAGE_COUNT; test_language++) {
+        printf("%s:\n", language_name(test_language));
+        overflow_count = 0;
+        RUN_TEST(test_menu_tree);
+        RUN_TEST(test_settings_cycle);
+        RUN_TEST(test_setting_range_edit);
+        RUN_TEST(test_cal_reflection);
+        RUN_TEST(test_cal_reflection_errors);
+        RUN_TEST(test_cal_transmission);
+        RUN_TEST(test_sensor_pages);
+        RUN_TEST(test_profiles);
+        RUN_TEST(test_diagnostics);
+        RUN_TEST(test_diagnostics_init_failed);
+        RUN_TEST(test_about);
+        RUN_TEST(test_timeouts);
+    }
+    RUN_TEST(test_string_tables);
+
+    if (update_snapshots && !snapshots_save()) {
+        fprintf(stderr, "Unable to write %s\n", SNAPSHOT_FILE);
+        return 1;
+    }
+    return TEST_RESULT();
+}
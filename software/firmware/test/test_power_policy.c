@@ -0,0 +1,305 @@
+/*
+ * Host tests for the power governor policy, including a simulated run
+ * of the governor to bound how long a measurement waits for the full
+ * clock after a key press
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "test.h"
+#include "power_policy.h"
+
+#define FULL_HZ    32000000UL
+#define REDUCED_HZ 16000000UL
+
+/* TIM2 prescaler at the full clock, from tim2_init() */
+#define LED_PWM_PRESCALER 5UL
+#define LED_PWM_PERIOD    128UL
+
+static power_clock_t select_clock(uint32_t requests, uint32_t now, uint32_t hold)
+{
+    const power_policy_input_t input = {
+        .requests = requests,
+        .now_ticks = now,
+        .hold_ticks = hold,
+        .reduced_allowed = true
+    };
+    return power_policy_select_clock(&input);
+}
+
+static void test_select_clock(void)
+{
+    CHECK(select_clock(0, 1000, 900) == POWER_CLOCK_REDUCED);
+    CHECK(select_clock(0, 1000, 1000) == POWER_CLOCK_REDUCED);
+    CHECK(select_clock(0, 1000, 1001) == POWER_CLOCK_FULL);
+
+    /* Any request holds the full clock, regardless of the hold period */
+    CHECK(select_clock(POWER_SOURCE_SENSOR, 1000, 0) == POWER_CLOCK_FULL);
+    CHECK(select_clock(POWER_SOURCE_USB, 1000, 0) == POWER_CLOCK_FULL);
+    CHECK(select_clock(POWER_SOURCE_SUSPEND, 1000, 0) == POWER_CLOCK_FULL);
+
+    /* The hold period is compared correctly across tick count wraparound */
+    CHECK(select_clock(0, UINT32_MAX - 10, 20) == POWER_CLOCK_FULL);
+    CHECK(select_clock(0, 21, 20) == POWER_CLOCK_REDUCED);
+
+    /* Nothing is reduced until the governor is started */
+    const power_policy_input_t input = { 0, 1000, 0, false };
+    CHECK(power_policy_select_clock(&input) == POWER_CLOCK_FULL);
+    CHECK(power_policy_select_clock(NULL) == POWER_CLOCK_FULL);
+}
+
+static void test_sleep_ticks(void)
+{
+    CHECK(power_policy_sleep_ticks(10, 250) == 10);
+    CHECK(power_policy_sleep_ticks(250, 250) == 250);
+    CHECK(power_policy_sleep_ticks(UINT32_MAX, 250) == 250);
+    CHECK(power_policy_sleep_ticks(1000, 0) == 1000);
+}
+
+static void test_hold_ticks(void)
+{
+    CHECK(power_policy_hold_ticks(POWER_SOURCE_USB) > power_policy_hold_ticks(POWER_SOURCE_SENSOR));
+    CHECK(power_policy_hold_ticks(POWER_SOURCE_SENSOR) > 0);
+    CHECK(power_policy_hold_ticks(POWER_SOURCE_SUSPEND) > 0);
+}
+
+static void test_elapsed_us(void)
+{
+    /* SysTick counts down, with 16000 counts per 1ms tick at 16MHz */
+    CHECK(power_policy_elapsed_us(10000, 9840, 16000, REDUCED_HZ) == 10);
+    CHECK(power_policy_elapsed_us(10000, 9839, 16000, REDUCED_HZ) == 11);
+    CHECK(power_policy_elapsed_us(10000, 10000, 16000, REDUCED_HZ) == 0);
+
+    /* Wrapped past zero and reloaded */
+    CHECK(power_policy_elapsed_us(100, 15940, 16000, REDUCED_HZ) == 10);
+
+    CHECK(power_policy_elapsed_us(100, 0, 16000, 0) == 0);
+}
+
+static void test_timer_prescaler(void)
+{
+    /* The LED PWM frequency is the same at both clock speeds */
+    uint32_t full = power_policy_timer_prescaler(LED_PWM_PRESCALER, FULL_HZ, FULL_HZ);
+    uint32_t reduced = power_policy_timer_prescaler(LED_PWM_PRESCALER, FULL_HZ, REDUCED_HZ);
+    CHECK(full == LED_PWM_PRESCALER);
+    CHECK(reduced == 2);
+    CHECK(FULL_HZ / ((full + 1) * LED_PWM_PERIOD) == REDUCED_HZ / ((reduced + 1) * LED_PWM_PERIOD));
+
+    CHECK(power_policy_timer_prescaler(0, FULL_HZ, REDUCED_HZ) == 0);
+    CHECK(power_policy_timer_prescaler(LED_PWM_PRESCALER, 0, REDUCED_HZ) == LED_PWM_PRESCALER);
+}
+
+/*
+ * Simulation of the governor, making the same calls into the policy as
+ * power.c, with only the clock switch itself modelled. Time is kept in
+ * microseconds, so that the delay added along the path from a key press
+ * to the start of a measurement can be bounded.
+ */
+
+/* Time to switch to the full clock, with the PLL kept locked. GS POWER reports the real bound. */
+#define SIM_UPSHIFT_US 20ULL
+
+/* Key interrupt, up to the keypad task receiving the event */
+#define SIM_KEY_WAKE_CYCLES 1500ULL
+
+/* Key handling and the menu state, up to sensor_start() */
+#define SIM_KEY_HANDLE_CYCLES 40000ULL
+
+/* Most the governor may add to the delay from a key press to the start of a measurement */
+#define WAKE_REGRESSION_MAX_US 100ULL
+
+typedef struct {
+    power_policy_state_t state;
+    uint64_t now_us;
+    uint32_t reduced_ticks;
+    uint32_t switches;
+} sim_governor_t;
+
+static void sim_init(sim_governor_t *gov, power_clock_t clock)
+{
+    memset(gov, 0, sizeof(sim_governor_t));
+    gov->state.clock = clock;
+}
+
+static uint32_t sim_ticks(const sim_governor_t *gov)
+{
+    return (uint32_t)(gov->now_us / 1000ULL);
+}
+
+/* What power_set_clock() does, as far as the time it takes */
+static void sim_set_clock(sim_governor_t *gov, power_clock_t clock)
+{
+    if (clock == POWER_CLOCK_MAX) { return; }
+    if (clock == POWER_CLOCK_FULL) {
+        gov->now_us += SIM_UPSHIFT_US;
+    }
+    gov->state.clock = clock;
+    gov->switches++;
+}
+
+static void sim_start(sim_governor_t *gov)
+{
+    power_policy_start(&gov->state, sim_ticks(gov));
+}
+
+static void sim_request(sim_governor_t *gov, power_source_t source)
+{
+    sim_set_clock(gov, power_policy_request(&gov->state, source));
+}
+
+static void sim_release(sim_governor_t *gov, power_source_t source)
+{
+    power_policy_release(&gov->state, source, sim_ticks(gov));
+}
+
+static void sim_activity(sim_governor_t *gov, power_source_t source)
+{
+    sim_set_clock(gov, power_policy_activity(&gov->state, source, sim_ticks(gov)));
+}
+
+/* A pass of the idle hook, followed by a tick spent at the resulting speed */
+static void sim_idle_tick(sim_governor_t *gov)
+{
+    sim_set_clock(gov, power_policy_idle(&gov->state, sim_ticks(gov)));
+    if (gov->state.clock == POWER_CLOCK_REDUCED) {
+        gov->reduced_ticks++;
+    }
+    gov->now_us += 1000ULL;
+}
+
+/* Run code that takes a number of cycles at the current clock speed */
+static void sim_run(sim_governor_t *gov, uint64_t cycles)
+{
+    const uint64_t hz = (gov->state.clock == POWER_CLOCK_FULL) ? FULL_HZ : REDUCED_HZ;
+    gov->now_us += ((cycles * 1000000ULL) + hz - 1ULL) / hz;
+}
+
+/* A key press that starts a measurement, returning the delay until the sensor starts */
+static uint64_t sim_key_to_measurement(sim_governor_t *gov)
+{
+    const uint64_t start_us = gov->now_us;
+    sim_run(gov, SIM_KEY_WAKE_CYCLES);
+    sim_activity(gov, POWER_SOURCE_KEYPAD);
+    sim_run(gov, SIM_KEY_HANDLE_CYCLES);
+    sim_request(gov, POWER_SOURCE_SENSOR);
+    CHECK(gov->state.clock == POWER_CLOCK_FULL);
+    return gov->now_us - start_us;
+}
+
+static void test_usb_burst(void)
+{
+    sim_governor_t gov;
+    sim_init(&gov, POWER_CLOCK_FULL);
+    sim_start(&gov);
+    const uint32_t hold = power_policy_hold_ticks(POWER_SOURCE_USB);
+
+    /* Packets every 20ms for 2s keep the full clock without bouncing */
+    while (sim_ticks(&gov) < 2000) {
+        if (sim_ticks(&gov) % 20 == 0) {
+            sim_activity(&gov, POWER_SOURCE_USB);
+            CHECK(gov.state.clock == POWER_CLOCK_FULL);
+        }
+        sim_idle_tick(&gov);
+    }
+    CHECK(gov.switches == 0);
+    CHECK(gov.reduced_ticks == 0);
+
+    /* After the last packet, the clock drops once the hold period ends */
+    while (sim_ticks(&gov) < 2000 + (2 * hold)) {
+        if (sim_ticks(&gov) < 1980 + hold) {
+            CHECK(gov.state.clock == POWER_CLOCK_FULL);
+        }
+        sim_idle_tick(&gov);
+    }
+    CHECK(gov.state.clock == POWER_CLOCK_REDUCED);
+    CHECK(gov.switches == 1);
+
+    /* The next packet gets the full clock before it is handled */
+    sim_activity(&gov, POWER_SOURCE_USB);
+    CHECK(gov.state.clock == POWER_CLOCK_FULL);
+    CHECK(gov.switches == 2);
+}
+
+static void test_sensor_request(void)
+{
+    sim_governor_t gov;
+    sim_init(&gov, POWER_CLOCK_REDUCED);
+    sim_start(&gov);
+
+    /* A running sensor holds the full clock for as long as it runs */
+    sim_request(&gov, POWER_SOURCE_SENSOR);
+    CHECK(gov.state.clock == POWER_CLOCK_FULL);
+    while (sim_ticks(&gov) < 10000) {
+        sim_idle_tick(&gov);
+    }
+    CHECK(gov.state.clock == POWER_CLOCK_FULL);
+    CHECK(gov.reduced_ticks == 0);
+
+    /* Releasing it starts the hold period, after which the clock drops */
+    sim_release(&gov, POWER_SOURCE_SENSOR);
+    const uint32_t released = sim_ticks(&gov);
+    while (sim_ticks(&gov) < released + 1000) {
+        if (sim_ticks(&gov) < released + power_policy_hold_ticks(POWER_SOURCE_SENSOR)) {
+            CHECK(gov.state.clock == POWER_CLOCK_FULL);
+        }
+        sim_idle_tick(&gov);
+    }
+    CHECK(gov.state.clock == POWER_CLOCK_REDUCED);
+
+    /* Releasing a source that was not requested changes nothing */
+    const uint32_t hold_ticks = gov.state.hold_ticks;
+    sim_release(&gov, POWER_SOURCE_SENSOR);
+    CHECK(gov.state.hold_ticks == hold_ticks);
+}
+
+static void test_wake_to_measurement(void)
+{
+    const uint32_t hold = power_policy_hold_ticks(POWER_SOURCE_USB);
+    sim_governor_t gov;
+    uint64_t worst_us = 0;
+
+    /* Without the governor started, everything runs at the full clock */
+    sim_init(&gov, POWER_CLOCK_FULL);
+    while (sim_ticks(&gov) < 3 * hold) {
+        sim_idle_tick(&gov);
+    }
+    const uint64_t baseline_us = sim_key_to_measurement(&gov);
+    CHECK(gov.switches == 0);
+    CHECK(gov.reduced_ticks == 0);
+
+    /* Key presses at every stage, from within the startup hold to long after the clock drops */
+    for (uint32_t idle = 0; idle < 3 * hold; idle += 7) {
+        sim_init(&gov, POWER_CLOCK_FULL);
+        sim_start(&gov);
+        while (sim_ticks(&gov) < idle) {
+            sim_idle_tick(&gov);
+        }
+        const bool reduced = gov.state.clock == POWER_CLOCK_REDUCED;
+        const uint32_t switches = gov.switches;
+
+        const uint64_t delay_us = sim_key_to_measurement(&gov);
+        CHECK(delay_us >= baseline_us);
+        CHECK(delay_us <= baseline_us + WAKE_REGRESSION_MAX_US);
+
+        /* A single switch back to the full clock, made as soon as the keypad task runs */
+        CHECK(gov.switches == switches + (reduced ? 1 : 0));
+        if (delay_us > worst_us) { worst_us = delay_us; }
+    }
+
+    printf("  key to measurement: %llu us without the governor, at most %llu us with it (limit %llu us)\n",
+        (unsigned long long)baseline_us, (unsigned long long)worst_us,
+        (unsigned long long)(baseline_us + WAKE_REGRESSION_MAX_US));
+}
+
+int main(void)
+{
+    RUN_TEST(test_select_clock);
+    RUN_TEST(test_sleep_ticks);
+    RUN_TEST(test_hold_ticks);
+    RUN_TEST(test_elapsed_us);
+    RUN_TEST(test_timer_prescaler);
+    RUN_TEST(test_usb_burst);
+    RUN_TEST(test_sensor_request);
+    RUN_TEST(test_wake_to_measurement);
+    return TEST_RESULT();
+}
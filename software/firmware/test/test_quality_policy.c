@@ -0,0 +1,265 @@
+/*
+ * Host tests for the target measurement quality checks, driven by a
+ * simulated sensor that can inject target movement, saturation, invalid
+ * integration cycles and the detect switch opening
+ */
+#include <stdint.h>
+#include <math.h>
+
+#include "test.h"
+#include "quality_policy.h"
+
+/* Matches SENSOR_TARGET_READ_ITERATIONS in sensor.c */
+#define READ_ITERATIONS 2
+
+/* Conversion from raw counts at maximum gain and 200ms into basic counts */
+#define BASIC_SCALE (1.0F / (9876.0F * 200.0F / 53.0F))
+
+typedef enum {
+    SIM_FAULT_NONE = 0,
+    SIM_FAULT_MOTION,    /*!< Target shifts between the repeated readings */
+    SIM_FAULT_SATURATE,  /*!< CH1 saturates on the second reading */
+    SIM_FAULT_INVALID,   /*!< ALS valid flag is clear on the first reading */
+    SIM_FAULT_LID_OPEN   /*!< Detect switch opens after the first reading */
+} sim_fault_t;
+
+typedef struct {
+    uint16_t ch0_val;              /*!< Raw CH0 count of the still target */
+    uint16_t ch1_val;              /*!< Raw CH1 count of the still target */
+    const sim_fault_t *faults;     /*!< Fault injected on each attempt */
+    uint8_t fault_count;           /*!< Attempts that have a fault, after which the target is clean */
+    uint8_t attempts;              /*!< Number of attempts made so far */
+} sim_sensor_t;
+
+static quality_reading_t sim_reading(uint16_t ch0, uint16_t ch1, uint8_t status, bool detect)
+{
+    quality_reading_t reading = {
+        .ch0_val = ch0,
+        .ch1_val = ch1,
+        .time = TSL2591_TIME_200MS,
+        .status = status,
+        .ch0_basic = (float)ch0 * BASIC_SCALE,
+        .ch1_basic = (float)ch1 * BASIC_SCALE,
+        .detect = detect
+    };
+    return reading;
+}
+
+/*
+ * Take one measurement attempt from the simulated sensor, in the same
+ * sequence as sensor_read_target_attempt()
+ */
+static uint8_t sim_attempt(sim_sensor_t *sim, bool check_detect, float *ch0, float *ch1, float *ch0_unc)
+{
+    sim_fault_t fault = (sim->attempts < sim->fault_count) ? sim->faults[sim->attempts] : SIM_FAULT_NONE;
+    quality_policy_t policy;
+
+    sim->attempts++;
+    quality_policy_init(&policy, check_detect);
+
+    for (int i = 0; i < READ_ITERATIONS; i++) {
+        uint16_t ch0_val = sim->ch0_val;
+        uint16_t ch1_val = sim->ch1_val;
+        uint8_t status = TSL2591_STATUS_AVALID;
+        bool detect = true;
+
+        switch (fault) {
+        case SIM_FAULT_MOTION:
+            if (i > 0) { ch0_val = (uint16_t)(ch0_val * 0.7F); }
+            break;
+        case SIM_FAULT_SATURATE:
+            if (i > 0) { ch1_val = TSL2591_DIGITAL_SATURATION; }
+            break;
+        case SIM_FAULT_INVALID:
+            if (i == 0) { status = 0; }
+            break;
+        case SIM_FAULT_LID_OPEN:
+            if (i > 0) { detect = false; }
+            break;
+        default:
+            break;
+        }
+
+        const quality_reading_t reading = sim_reading(ch0_val, ch1_val, status, detect);
+        quality_policy_add_reading(&policy, &reading);
+    }
+
+    return quality_policy_finish(&policy, ch0, ch1, ch0_unc);
+}
+
+/*
+ * Run a full measurement with retries, in the same sequence as
+ * sensor_read_target()
+ */
+static uint8_t sim_measure(sim_sensor_t *sim, bool check_detect, float *ch0, float *ch0_unc)
+{
+    uint8_t quality;
+    float ch1;
+    for (uint8_t attempt = 0; ; attempt++) {
+        quality = sim_attempt(sim, check_detect, ch0, &ch1, ch0_unc);
+        if (!quality_policy_should_retry(attempt, quality)) { break; }
+    }
+    return quality;
+}
+
+static uint8_t sim_measure_with(sim_fault_t fault, uint8_t fault_count, bool check_detect, uint8_t *attempts)
+{
+    sim_fault_t faults[QUALITY_POLICY_RETRIES + 1];
+    for (int i = 0; i < QUALITY_POLICY_RETRIES + 1; i++) { faults[i] = fault; }
+
+    sim_sensor_t sim = {
+        .ch0_val = 21000, .ch1_val = 9000,
+        .faults = faults, .fault_count = fault_count
+    };
+    float ch0;
+    float ch0_unc;
+    uint8_t quality = sim_measure(&sim, check_detect, &ch0, &ch0_unc);
+    if (attempts) { *attempts = sim.attempts; }
+    return quality;
+}
+
+static void test_clean_reading(void)
+{
+    sim_sensor_t sim = { .ch0_val = 21000, .ch1_val = 9000 };
+    float ch0;
+    float ch0_unc;
+
+    CHECK(sim_measure(&sim, true, &ch0, &ch0_unc) == SENSOR_QUALITY_OK);
+    CHECK(sim.attempts == 1);
+    CHECK(fabsf(ch0 - 21000.0F * BASIC_SCALE) < 1e-6F);
+
+    /* Identical readings leave only the counting statistics */
+    const float expected_unc = sqrtf(2.0F * BASIC_SCALE * BASIC_SCALE * (21000.0F + 0.083333F)) / 2.0F;
+    CHECK(fabsf(ch0_unc - expected_unc) < expected_unc * 1e-4F);
+}
+
+static void test_motion_spread(void)
+{
+    uint8_t attempts;
+    CHECK(sim_measure_with(SIM_FAULT_MOTION, 3, true, &attempts) == SENSOR_QUALITY_UNSTABLE);
+    CHECK(attempts == QUALITY_POLICY_RETRIES + 1);
+}
+
+static void test_noise_is_not_motion(void)
+{
+    /* Counting noise on a dense target should not be mistaken for movement */
+    quality_policy_t policy;
+    quality_policy_init(&policy, false);
+    const quality_reading_t a = sim_reading(40, 20, TSL2591_STATUS_AVALID, true);
+    const quality_reading_t b = sim_reading(52, 24, TSL2591_STATUS_AVALID, true);
+    quality_policy_add_reading(&policy, &a);
+    quality_policy_add_reading(&policy, &b);
+    CHECK(quality_policy_finish(&policy, NULL, NULL, NULL) == SENSOR_QUALITY_OK);
+
+    /* The same relative spread on a bright target is */
+    quality_policy_init(&policy, false);
+    const quality_reading_t c = sim_reading(40000, 20000, TSL2591_STATUS_AVALID, true);
+    const quality_reading_t d = sim_reading(52000, 24000, TSL2591_STATUS_AVALID, true);
+    quality_policy_add_reading(&policy, &c);
+    quality_policy_add_reading(&policy, &d);
+    CHECK(quality_policy_finish(&policy, NULL, NULL, NULL) == SENSOR_QUALITY_UNSTABLE);
+}
+
+static void test_saturated_channel(void)
+{
+    uint8_t attempts;
+    CHECK(sim_measure_with(SIM_FAULT_SATURATE, 3, true, &attempts) == SENSOR_QUALITY_SATURATED);
+    CHECK(attempts == QUALITY_POLICY_RETRIES + 1);
+
+    CHECK(quality_policy_is_saturated(TSL2591_ANALOG_SATURATION, 0, TSL2591_TIME_100MS));
+    CHECK(!quality_policy_is_saturated(TSL2591_ANALOG_SATURATION, 0, TSL2591_TIME_200MS));
+    CHECK(quality_policy_is_saturated(0, TSL2591_DIGITAL_SATURATION, TSL2591_TIME_200MS));
+    CHECK(!quality_policy_is_saturated(TSL2591_DIGITAL_SATURATION - 1, 0, TSL2591_TIME_600MS));
+}
+
+static void test_als_invalid(void)
+{
+    CHECK(sim_measure_with(SIM_FAULT_INVALID, 3, true, NULL) == SENSOR_QUALITY_INVALID);
+}
+
+static void test_lid_open(void)
+{
+    uint8_t attempts;
+    CHECK(sim_measure_with(SIM_FAULT_LID_OPEN, 3, true, &attempts) == SENSOR_QUALITY_LID_OPEN);
+    CHECK(attempts == QUALITY_POLICY_RETRIES + 1);
+
+    /* Measurements started with the switch open do not check it */
+    CHECK(sim_measure_with(SIM_FAULT_LID_OPEN, 3, false, &attempts) == SENSOR_QUALITY_OK);
+    CHECK(attempts == 1);
+}
+
+static void test_retry_recovers(void)
+{
+    /* The target settles after the first attempt */
+    uint8_t attempts;
+    CHECK(sim_measure_with(SIM_FAULT_MOTION, 1, true, &attempts) == SENSOR_QUALITY_OK);
+    CHECK(attempts == 2);
+
+    /* Or on the last attempt the budget allows */
+    CHECK(sim_measure_with(SIM_FAULT_LID_OPEN, QUALITY_POLICY_RETRIES, true, &attempts) == SENSOR_QUALITY_OK);
+    CHECK(attempts == QUALITY_POLICY_RETRIES + 1);
+
+    /* Different faults on each attempt still recover */
+    const sim_fault_t faults[] = { SIM_FAULT_SATURATE, SIM_FAULT_INVALID };
+    sim_sensor_t sim = { .ch0_val = 21000, .ch1_val = 9000, .faults = faults, .fault_count = 2 };
+    float ch0;
+    float ch0_unc;
+    CHECK(sim_measure(&sim, true, &ch0, &ch0_unc) == SENSOR_QUALITY_OK);
+    CHECK(sim.attempts == 3);
+}
+
+static void test_exhausted_budget(void)
+{
+    /* The last attempt is returned with its own flags, not those of earlier attempts */
+    const sim_fault_t faults[] = { SIM_FAULT_SATURATE, SIM_FAULT_INVALID, SIM_FAULT_MOTION, SIM_FAULT_MOTION };
+    sim_sensor_t sim = { .ch0_val = 21000, .ch1_val = 9000, .faults = faults, .fault_count = 4 };
+    float ch0;
+    float ch0_unc;
+    CHECK(sim_measure(&sim, true, &ch0, &ch0_unc) == SENSOR_QUALITY_UNSTABLE);
+    CHECK(sim.attempts == QUALITY_POLICY_RETRIES + 1);
+    CHECK(!isnan(ch0) && !isnan(ch0_unc));
+
+    CHECK(quality_policy_should_retry(0, SENSOR_QUALITY_LID_OPEN));
+    CHECK(quality_policy_should_retry(QUALITY_POLICY_RETRIES - 1, SENSOR_QUALITY_LID_OPEN));
+    CHECK(!quality_policy_should_retry(QUALITY_POLICY_RETRIES, SENSOR_QUALITY_LID_OPEN));
+    CHECK(!quality_policy_should_retry(0, SENSOR_QUALITY_OK));
+}
+
+static void test_combined_flags(void)
+{
+    /* Every failed check of one attempt is reported together */
+    quality_policy_t policy;
+    quality_policy_init(&policy, true);
+    const quality_reading_t a = sim_reading(30000, TSL2591_DIGITAL_SATURATION, 0, true);
+    const quality_reading_t b = sim_reading(15000, 9000, TSL2591_STATUS_AVALID, false);
+    CHECK(quality_policy_add_reading(&policy, &a) == (SENSOR_QUALITY_SATURATED | SENSOR_QUALITY_INVALID));
+    CHECK(quality_policy_add_reading(&policy, &b) == SENSOR_QUALITY_LID_OPEN);
+    CHECK(quality_policy_finish(&policy, NULL, NULL, NULL) == (SENSOR_QUALITY_UNSTABLE
+        | SENSOR_QUALITY_SATURATED | SENSOR_QUALITY_INVALID | SENSOR_QUALITY_LID_OPEN));
+}
+
+static void test_too_few_readings(void)
+{
+    quality_policy_t policy;
+    float ch0 = 0;
+    quality_policy_init(&policy, false);
+    const quality_reading_t a = sim_reading(30000, 9000, TSL2591_STATUS_AVALID, true);
+    quality_policy_add_reading(&policy, &a);
+    CHECK(quality_policy_finish(&policy, &ch0, NULL, NULL) == SENSOR_QUALITY_INVALID);
+    CHECK(isnan(ch0));
+}
+
+int main(void)
+{
+    RUN_TEST(test_clean_reading);
+    RUN_TEST(test_motion_spread);
+    RUN_TEST(test_noise_is_not_motion);
+    RUN_TEST(test_saturated_channel);
+    RUN_TEST(test_als_invalid);
+    RUN_TEST(test_lid_open);
+    RUN_TEST(test_retry_recovers);
+    RUN_TEST(test_exhausted_budget);
+    RUN_TEST(test_combined_flags);
+    RUN_TEST(test_too_few_readings);
+    return TEST_RESULT();
+}
@@ -0,0 +1,288 @@
+/*
+ * Host tests for the built-in self-test decisions, with faults injected
+ * into stubbed sensor, EEPROM and ADC results, and for the lines that
+ * `ID SELFTEST` reports them with
+ */
+#include <stdint.h>
+#include <math.h>
+
+#include "test.h"
+#include "selftest_policy.h"
+#include "tsl2591.h"
+
+/* Needed to link the printf library, which only uses it for printf_() */
+void _putchar(char character)
+{
+    (void)character;
+}
+
+/* Settings integrity mask bits, from settings_check_integrity() */
+#define SETTINGS_FAILED_HEADER    0x01U
+#define SETTINGS_FAILED_CAL_GAIN  0x04U
+
+/* Readings from a healthy device, closed with nothing in the light path */
+static selftest_inputs_t healthy_inputs(void)
+{
+    selftest_inputs_t inputs = {
+        .sensor_responded = true,
+        .sensor_id = 0x50,
+        .sensor_reg_errors = 0,
+        .dark_read = true,
+        .dark_ch0 = 3,
+        .refl_read = true,
+        .refl_ch0 = 2150,
+        .tran_read = true,
+        .tran_ch0 = 65535,
+        .settings_failed = 0,
+        .adc_read = true,
+        .vdda_mv = 3298,
+        .temp_c = 24.56F,
+        .display_errors = 0,
+        .keypad_stuck = 0
+    };
+    return inputs;
+}
+
+/* Render the full `ID SELFTEST` body, as cdc_handler.c writes it */
+static size_t render(const selftest_inputs_t *inputs, char *out, size_t len)
+{
+    selftest_result_t results[SELFTEST_COUNT];
+    char line[SELFTEST_LINE_SIZE];
+    size_t total = 0;
+
+    uint8_t failures = selftest_policy_evaluate(inputs, results);
+    for (size_t i = 0; i < SELFTEST_COUNT; i++) {
+        size_t n = selftest_policy_format_result(line, sizeof(line), i, &results[i]);
+        CHECK(n < sizeof(line));
+        CHECK(total + n < len);
+        memcpy(out + total, line, n);
+        total += n;
+    }
+    size_t n = selftest_policy_format_summary(line, sizeof(line), failures);
+    memcpy(out + total, line, n);
+    total += n;
+    out[total] = '\0';
+    return total;
+}
+
+static void test_all_pass(void)
+{
+    const selftest_inputs_t inputs = healthy_inputs();
+    selftest_result_t results[SELFTEST_COUNT];
+
+    CHECK(selftest_policy_evaluate(&inputs, results) == 0);
+    for (size_t i = 0; i < SELFTEST_COUNT; i++) {
+        CHECK(results[i].status == SELFTEST_PASS);
+    }
+    CHECK(results[SELFTEST_LIGHT_REFL].value == 2147);
+    CHECK(results[SELFTEST_TEMP].value == 246);
+}
+
+static void test_sensor_not_responding(void)
+{
+    selftest_inputs_t inputs = healthy_inputs();
+    selftest_result_t results[SELFTEST_COUNT];
+
+    /* Nothing beyond the failed register read is gathered from the sensor */
+    inputs.sensor_responded = false;
+    inputs.sensor_id = 0;
+    inputs.dark_read = false;
+    inputs.refl_read = false;
+    inputs.tran_read = false;
+    CHECK(!selftest_policy_sensor_usable(&inputs));
+
+    CHECK(selftest_policy_evaluate(&inputs, results) == 1);
+    CHECK(results[SELFTEST_SENSOR_ID].status == SELFTEST_FAIL);
+    CHECK(results[SELFTEST_SENSOR_ID].value == -1);
+    CHECK(results[SELFTEST_SENSOR_REG].status == SELFTEST_SKIP);
+    CHECK(results[SELFTEST_SENSOR_DARK].status == SELFTEST_SKIP);
+    CHECK(results[SELFTEST_LIGHT_REFL].status == SELFTEST_SKIP);
+    CHECK(results[SELFTEST_LIGHT_TRAN].status == SELFTEST_SKIP);
+
+    /* The other subsystems are still checked */
+    CHECK(results[SELFTEST_SETTINGS].status == SELFTEST_PASS);
+    CHECK(results[SELFTEST_VDDA].status == SELFTEST_PASS);
+}
+
+static void test_sensor_wrong_id(void)
+{
+    selftest_inputs_t inputs = healthy_inputs();
+    selftest_result_t results[SELFTEST_COUNT];
+
+    inputs.sensor_id = 0x12;
+    inputs.sensor_reg_errors = 2;
+    CHECK(!selftest_policy_sensor_usable(&inputs));
+
+    /* Readings gathered anyway are ignored */
+    CHECK(selftest_policy_evaluate(&inputs, results) == 2);
+    CHECK(results[SELFTEST_SENSOR_ID].value == 0x12);
+    CHECK(results[SELFTEST_SENSOR_REG].status == SELFTEST_FAIL);
+    CHECK(results[SELFTEST_SENSOR_REG].value == 2);
+    CHECK(results[SELFTEST_SENSOR_DARK].status == SELFTEST_SKIP);
+}
+
+static void test_dark_and_lights(void)
+{
+    selftest_inputs_t inputs = healthy_inputs();
+    selftest_result_t results[SELFTEST_COUNT];
+
+    /* A light leak saturates the dark reading, so the lights cannot be judged */
+    inputs.dark_ch0 = TSL2591_ANALOG_SATURATION;
+    CHECK(!selftest_policy_dark_usable(&inputs));
+    CHECK(selftest_policy_evaluate(&inputs, results) == 1);
+    CHECK(results[SELFTEST_SENSOR_DARK].status == SELFTEST_FAIL);
+    CHECK(results[SELFTEST_LIGHT_REFL].status == SELFTEST_SKIP);
+    CHECK(results[SELFTEST_LIGHT_TRAN].status == SELFTEST_SKIP);
+
+    /* A dead light barely changes the reading */
+    inputs = healthy_inputs();
+    inputs.refl_ch0 = inputs.dark_ch0 + 49;
+    CHECK(selftest_policy_evaluate(&inputs, results) == 1);
+    CHECK(results[SELFTEST_LIGHT_REFL].status == SELFTEST_FAIL);
+    CHECK(results[SELFTEST_LIGHT_REFL].value == 49);
+
+    /* A light reading that could not be taken */
+    inputs = healthy_inputs();
+    inputs.tran_read = false;
+    CHECK(selftest_policy_evaluate(&inputs, results) == 1);
+    CHECK(results[SELFTEST_LIGHT_TRAN].status == SELFTEST_FAIL);
+    CHECK(results[SELFTEST_LIGHT_TRAN].value == -1);
+}
+
+static void test_bad_eeprom_crc(void)
+{
+    selftest_inputs_t inputs = healthy_inputs();
+    selftest_result_t results[SELFTEST_COUNT];
+
+    inputs.settings_failed = SETTINGS_FAILED_HEADER | SETTINGS_FAILED_CAL_GAIN;
+    CHECK(selftest_policy_evaluate(&inputs, results) == 1);
+    CHECK(results[SELFTEST_SETTINGS].status == SELFTEST_FAIL);
+    CHECK(results[SELFTEST_SETTINGS].value == 5);
+}
+
+static void test_vdda_range(void)
+{
+    selftest_inputs_t inputs = healthy_inputs();
+    selftest_result_t results[SELFTEST_COUNT];
+
+    inputs.vdda_mv = 3000;
+    CHECK(selftest_policy_evaluate(&inputs, results) == 0);
+    inputs.vdda_mv = 3600;
+    CHECK(selftest_policy_evaluate(&inputs, results) == 0);
+
+    inputs.vdda_mv = 2999;
+    CHECK(selftest_policy_evaluate(&inputs, results) == 1);
+    CHECK(results[SELFTEST_VDDA].status == SELFTEST_FAIL);
+    CHECK(results[SELFTEST_VDDA].value == 2999);
+
+    inputs.vdda_mv = 3601;
+    CHECK(selftest_policy_evaluate(&inputs, results) == 1);
+    CHECK(results[SELFTEST_VDDA].status == SELFTEST_FAIL);
+}
+
+static void test_temp_range(void)
+{
+    selftest_inputs_t inputs = healthy_inputs();
+    selftest_result_t results[SELFTEST_COUNT];
+
+    inputs.temp_c = -20.0F;
+    CHECK(selftest_policy_evaluate(&inputs, results) == 0);
+    CHECK(results[SELFTEST_TEMP].value == -200);
+
+    inputs.temp_c = 85.1F;
+    CHECK(selftest_policy_evaluate(&inputs, results) == 1);
+    CHECK(results[SELFTEST_TEMP].status == SELFTEST_FAIL);
+    CHECK(results[SELFTEST_TEMP].value == 851);
+
+    inputs.temp_c = -40.0F;
+    CHECK(selftest_policy_evaluate(&inputs, results) == 1);
+    CHECK(results[SELFTEST_TEMP].value == -400);
+
+    inputs.temp_c = NAN;
+    CHECK(selftest_policy_evaluate(&inputs, results) == 1);
+    CHECK(results[SELFTEST_TEMP].status == SELFTEST_FAIL);
+    CHECK(results[SELFTEST_TEMP].value == -1);
+}
+
+static void test_adc_not_responding(void)
+{
+    selftest_inputs_t inputs = healthy_inputs();
+    selftest_result_t results[SELFTEST_COUNT];
+
+    inputs.adc_read = false;
+    CHECK(selftest_policy_evaluate(&inputs, results) == 2);
+    CHECK(results[SELFTEST_VDDA].status == SELFTEST_FAIL && results[SELFTEST_VDDA].value == -1);
+    CHECK(results[SELFTEST_TEMP].status == SELFTEST_FAIL && results[SELFTEST_TEMP].value == -1);
+}
+
+static void test_report_pass(void)
+{
+    const selftest_inputs_t inputs = healthy_inputs();
+    char out[1024];
+
+    render(&inputs, out, sizeof(out));
+    CHECK_STR(out,
+        "SENSOR_ID,PASS,80\r\n"
+        "SENSOR_REG,PASS,0\r\n"
+        "SENSOR_DARK,PASS,3\r\n"
+        "LIGHT_REFL,PASS,2147\r\n"
+        "LIGHT_TRAN,PASS,65535\r\n"
+        "SETTINGS,PASS,0\r\n"
+        "VDDA,PASS,3298\r\n"
+        "TEMP,PASS,246\r\n"
+        "DISPLAY,PASS,0\r\n"
+        "KEYPAD,PASS,0\r\n"
+        "RESULT,PASS,0\r\n");
+}
+
+static void test_report_faults(void)
+{
+    selftest_inputs_t inputs = healthy_inputs();
+    char out[1024];
+
+    inputs.sensor_responded = false;
+    inputs.settings_failed = SETTINGS_FAILED_HEADER;
+    inputs.vdda_mv = 2875;
+    inputs.temp_c = -25.04F;
+    inputs.keypad_stuck = 0x09;
+
+    render(&inputs, out, sizeof(out));
+    CHECK_STR(out,
+        "SENSOR_ID,FAIL,-1\r\n"
+        "SENSOR_REG,SKIP,0\r\n"
+        "SENSOR_DARK,SKIP,0\r\n"
+        "LIGHT_REFL,SKIP,0\r\n"
+        "LIGHT_TRAN,SKIP,0\r\n"
+        "SETTINGS,FAIL,1\r\n"
+        "VDDA,FAIL,2875\r\n"
+        "TEMP,FAIL,-250\r\n"
+        "DISPLAY,PASS,0\r\n"
+        "KEYPAD,FAIL,9\r\n"
+        "RESULT,FAIL,5\r\n");
+}
+
+static void test_line_size(void)
+{
+    /* The longest possible line still fits the buffer the handler uses */
+    const selftest_result_t result = { SELFTEST_FAIL, INT32_MIN };
+    char line[SELFTEST_LINE_SIZE];
+    size_t n = selftest_policy_format_result(line, sizeof(line), SELFTEST_SENSOR_DARK, &result);
+    CHECK(n < sizeof(line));
+    CHECK_STR(line, "SENSOR_DARK,FAIL,-2147483648\r\n");
+}
+
+int main(void)
+{
+    RUN_TEST(test_all_pass);
+    RUN_TEST(test_sensor_not_responding);
+    RUN_TEST(test_sensor_wrong_id);
+    RUN_TEST(test_dark_and_lights);
+    RUN_TEST(test_bad_eeprom_crc);
+    RUN_TEST(test_vdda_range);
+    RUN_TEST(test_temp_range);
+    RUN_TEST(test_adc_not_responding);
+    RUN_TEST(test_report_pass);
+    RUN_TEST(test_report_faults);
+    RUN_TEST(test_line_size);
+    return TEST_RESULT();
+}
@@ -0,0 +1,204 @@
+/*
+ * Host tests for the task watchdog supervisor policy, driven by a
+ * simulated tick count
+ */
+#include <stdint.h>
+
+#include "test.h"
+#include "watchdog_policy.h"
+
+/* Matches the supervisor period in task_watchdog.c, at a 1ms tick */
+#define SUPERVISOR_PERIOD 100U
+
+typedef struct {
+    int client;
+    uint32_t interval; /*!< Ticks between check-ins, or 0 if never */
+    uint32_t stall_at; /*!< Tick at which check-ins stop, or 0 if never */
+} sim_task_t;
+
+/*
+ * Run the supervisor loop against tasks checking in on their own
+ * schedules, and return the tick at which it would stop refreshing
+ * the hardware watchdog and reset, or 0 if it never does.
+ */
+static uint32_t simulate(watchdog_policy_t *policy, const sim_task_t *tasks, size_t task_count,
+    uint32_t start, uint32_t duration, int *overdue, uint32_t *late)
+{
+    for (uint32_t t = start; t - start < duration; t++) {
+        for (size_t i = 0; i < task_count; i++) {
+            const sim_task_t *task = &tasks[i];
+            if (task->stall_at && t - start >= task->stall_at) { continue; }
+            if (task->interval && (t - start) % task->interval == 0) {
+                watchdog_policy_checkin(policy, task->client, t);
+            }
+        }
+        if ((t - start) % SUPERVISOR_PERIOD == 0) {
+            int client = watchdog_policy_find_overdue(policy, t, late);
+            if (client >= 0) {
+                if (overdue) { *overdue = client; }
+                return t;
+            }
+        }
+    }
+    return 0;
+}
+
+static void test_healthy_tasks(void)
+{
+    watchdog_policy_t policy;
+    watchdog_policy_init(&policy);
+    int a = watchdog_policy_register(&policy, "sensor", 500, 0);
+    int b = watchdog_policy_register(&policy, "usb", 250, 0);
+    CHECK(a == 0 && b == 1);
+
+    const sim_task_t tasks[] = {
+        { a, 400, 0 },
+        { b, 250, 0 }
+    };
+    CHECK(simulate(&policy, tasks, 2, 0, 60000, NULL, NULL) == 0);
+}
+
+static void test_stalled_task(void)
+{
+    watchdog_policy_t policy;
+    watchdog_policy_init(&policy);
+    int a = watchdog_policy_register(&policy, "sensor", 500, 0);
+    int b = watchdog_policy_register(&policy, "usb", 250, 0);
+    watchdog_policy_set_state(&policy, a, 7);
+
+    /* The sensor task stops checking in at 10s, while the other continues */
+    const sim_task_t tasks[] = {
+        { a, 100, 10000 },
+        { b, 50, 0 }
+    };
+    int overdue = -1;
+    uint32_t late = 0;
+    uint32_t reset_at = simulate(&policy, tasks, 2, 0, 60000, &overdue, &late);
+
+    /* Its last check-in was at 9.9s, so the deadline passes at 10.4s */
+    CHECK(overdue == a);
+    CHECK(reset_at > 10400);
+    CHECK(reset_at <= 10400 + SUPERVISOR_PERIOD);
+    CHECK(late == reset_at - 10400);
+    CHECK_STR(policy.clients[overdue].name, "sensor");
+    CHECK(policy.clients[overdue].state == 7);
+}
+
+static void test_deadline_boundary(void)
+{
+    watchdog_policy_t policy;
+    uint32_t late = 0;
+    watchdog_policy_init(&policy);
+    int a = watchdog_policy_register(&policy, "sensor", 500, 1000);
+
+    /* Reaching the deadline is allowed, only passing it is not */
+    CHECK(watchdog_policy_find_overdue(&policy, 1500, &late) < 0);
+    CHECK(watchdog_policy_find_overdue(&policy, 1501, &late) == a);
+    CHECK(late == 1);
+
+    /* Checking in starts a new deadline */
+    watchdog_policy_checkin(&policy, a, 1501);
+    CHECK(watchdog_policy_find_overdue(&policy, 2001, NULL) < 0);
+    CHECK(watchdog_policy_find_overdue(&policy, 2002, NULL) == a);
+}
+
+static void test_idle_task(void)
+{
+    watchdog_policy_t policy;
+    watchdog_policy_init(&policy);
+    int a = watchdog_policy_register(&policy, "keypad", 200, 0);
+
+    /* An idle task may wait for work indefinitely */
+    watchdog_policy_idle(&policy, a);
+    CHECK(watchdog_policy_find_overdue(&policy, 1000000, NULL) < 0);
+
+    /* Once it checks in again, it is supervised from that point */
+    watchdog_policy_checkin(&policy, a, 1000000);
+    CHECK(watchdog_policy_find_overdue(&policy, 1000200, NULL) < 0);
+    CHECK(watchdog_policy_find_overdue(&policy, 1000201, NULL) == a);
+}
+
+static void test_escalation_order(void)
+{
+    watchdog_policy_t policy;
+    uint32_t late = 0;
+    watchdog_policy_init(&policy);
+    int a = watchdog_policy_register(&policy, "a", 300, 0);
+    int b = watchdog_policy_register(&policy, "b", 100, 0);
+    int c = watchdog_policy_register(&policy, "c", 1000, 0);
+
+    /* With several tasks overdue, the one furthest past its deadline is reported */
+    CHECK(watchdog_policy_find_overdue(&policy, 250, &late) == b);
+    CHECK(late == 150);
+    CHECK(watchdog_policy_find_overdue(&policy, 500, &late) == b);
+    CHECK(late == 400);
+
+    watchdog_policy_checkin(&policy, b, 500);
+    CHECK(watchdog_policy_find_overdue(&policy, 550, &late) == a);
+    CHECK(late == 250);
+
+    watchdog_policy_idle(&policy, a);
+    watchdog_policy_idle(&policy, b);
+    CHECK(watchdog_policy_find_overdue(&policy, 550, NULL) < 0);
+    CHECK(watchdog_policy_find_overdue(&policy, 1001, &late) == c);
+    CHECK(late == 1);
+}
+
+static void test_tick_wraparound(void)
+{
+    watchdog_policy_t policy;
+    watchdog_policy_init(&policy);
+    int a = watchdog_policy_register(&policy, "sensor", 500, UINT32_MAX - 200);
+    int b = watchdog_policy_register(&policy, "usb", 500, UINT32_MAX - 200);
+
+    CHECK(watchdog_policy_find_overdue(&policy, 299, NULL) < 0);
+    CHECK(watchdog_policy_find_overdue(&policy, 300, NULL) == a);
+
+    /* A stall across the wraparound is caught the same way */
+    watchdog_policy_checkin(&policy, a, UINT32_MAX - 1000);
+    watchdog_policy_checkin(&policy, b, UINT32_MAX - 1000);
+    const sim_task_t tasks[] = {
+        { a, 100, 0 },
+        { b, 100, 1500 }
+    };
+    int overdue = -1;
+    uint32_t reset_at = simulate(&policy, tasks, 2, UINT32_MAX - 1000, 10000, &overdue, NULL);
+    CHECK(overdue == b);
+    CHECK(reset_at > 900 && reset_at <= 900 + SUPERVISOR_PERIOD);
+}
+
+static void test_registration(void)
+{
+    watchdog_policy_t policy;
+    watchdog_policy_init(&policy);
+
+    for (int i = 0; i < WATCHDOG_POLICY_MAX_CLIENTS; i++) {
+        CHECK(watchdog_policy_register(&policy, "task", 100, 0) == i);
+    }
+    CHECK(watchdog_policy_register(&policy, "extra", 100, 0) == -1);
+    CHECK(watchdog_policy_register(NULL, "extra", 100, 0) == -1);
+
+    /* Calls from tasks that are not supervised are ignored */
+    watchdog_policy_checkin(&policy, -1, 5000);
+    watchdog_policy_idle(&policy, -1);
+    watchdog_policy_set_state(&policy, -1, 1);
+    watchdog_policy_checkin(&policy, WATCHDOG_POLICY_MAX_CLIENTS, 5000);
+    for (int i = 0; i < WATCHDOG_POLICY_MAX_CLIENTS; i++) {
+        CHECK(policy.clients[i].checkin_ticks == 0);
+        CHECK(policy.clients[i].busy);
+        CHECK(policy.clients[i].state == 0);
+    }
+    CHECK(watchdog_policy_find_overdue(NULL, 0, NULL) == -1);
+}
+
+int main(void)
+{
+    RUN_TEST(test_healthy_tasks);
+    RUN_TEST(test_stalled_task);
+    RUN_TEST(test_deadline_boundary);
+    RUN_TEST(test_idle_task);
+    RUN_TEST(test_escalation_order);
+    RUN_TEST(test_tick_wraparound);
+    RUN_TEST(test_registration);
+    return TEST_RESULT();
+}
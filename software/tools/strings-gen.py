@@ -0,0 +1,738 @@
+#!/usr/bin/env python3
+#
+# Generates the localized string tables for the device display.
+#
+# Each language catalog is compiled into a compact table, with every
+# distinct string stored once in a single block of text and referenced
+# by an offset index. Strings that are the tail end of a longer string
+# share its storage, and joined strings such as menu lists are stored
+# pre-joined. Each language also gets a copy of its menu font that only
+# has the glyphs its strings need, along with printable ASCII for values
+# that are formatted at runtime.
+#
+# Every string is measured with the real font metrics against the layout
+# declared for it in the reference catalog, and the tables are only written
+# if every string of every language fits on the 128x64 display without
+# being clipped.
+#
+# The --preview option draws each string of a language as it will appear
+# on the display, so translations can be reviewed without a device.
+#
+import argparse
+import os
+import re
+import sys
+
+DISPLAY_WIDTH = 128
+DISPLAY_HEIGHT = 64
+
+# Layout constants from the u8g2 user interface functions and display.c
+LIST_BORDER = 1
+LIST_TITLE_GAP = 3
+BUTTON_BORDER = 1
+BUTTON_SPACING = 6
+BUTTON_TEXT_GAP = 3
+
+# Glyphs always included in a menu font, for text formatted at runtime
+ASCII_GLYPHS = range(0x20, 0x7F)
+
+SECTION_KINDS = ('item', 'title', 'text', 'button', 'setting', 'value')
+
+
+class CatalogError(Exception):
+    pass
+
+
+#
+# Catalog parsing
+#
+
+class Entry:
+    def __init__(self, string_id, kind, params, filename, line):
+        self.id = string_id
+        self.kind = kind
+        self.lines = int(params.get('lines', 1))
+        self.reserve = int(params.get('reserve', 0))
+        self.fixed = 'fixed' in params
+        self.text = None
+        self.join = None
+        self.values = None
+        self.location = '%s:%d' % (filename, line)
+
+
+class Catalog:
+    def __init__(self, filename):
+        self.filename = filename
+        self.directives = {}
+        self.entries = {}
+        self.order = []
+
+    @property
+    def code(self):
+        return self.directives.get('code', '')
+
+
+def unescape(text, location):
+    if len(text) >= 2 and text[0] == '"' and text[-1] == '"':
+        text = text[1:-1]
+    result = ''
+    i = 0
+    while i < len(text):
+        if text[i] == '\\':
+            if i + 1 >= len(text) or text[i + 1] not in 'n\\"':
+                raise CatalogError('%s: invalid escape sequence' % location)
+            result += '\n' if text[i + 1] == 'n' else text[i + 1]
+            i += 2
+        else:
+            result += text[i]
+            i += 1
+    return result
+
+
+def parse_catalog(filename):
+    catalog = Catalog(filename)
+    kind = None
+    params = {}
+
+    with open(filename, encoding='utf-8') as f:
+        for num, raw in enumerate(f, 1):
+            line = raw.strip()
+            location = '%s:%d' % (filename, num)
+            if not line or line.startswith('#'):
+                continue
+
+            if line.startswith('@'):
+                parts = line[1:].split(None, 1)
+                if len(parts) != 2:
+                    raise CatalogError('%s: directive without a value' % location)
+                catalog.directives[parts[0]] = parts[1].strip()
+                continue
+
+            m = re.match(r'^\[(\w+)((?:\s+[\w=]+)*)\]$', line)
+            if m:
+                kind = m.group(1)
+                if kind not in SECTION_KINDS:
+                    raise CatalogError('%s: unknown section "%s"' % (location, kind))
+                params = {}
+                for param in m.group(2).split():
+                    key, _, value = param.partition('=')
+                    params[key] = value
+                continue
+
+            m = re.match(r'^([A-Z][A-Z0-9_]*)\s*(?:\(([^)]*)\))?\s*=\s*(.*)$', line)
+            if not m:
+                raise CatalogError('%s: unable to parse line' % location)
+            if not kind:
+                raise CatalogError('%s: string outside of a section' % location)
+
+            string_id = m.group(1)
+            if string_id in catalog.entries:
+                raise CatalogError('%s: duplicate string %s' % (location, string_id))
+
+            entry = Entry(string_id, kind, params, filename, num)
+            text = m.group(3)
+            if text.startswith('{') and text.endswith('}'):
+                entry.join = [s.strip() for s in text[1:-1].split(',') if s.strip()]
+            else:
+                entry.text = unescape(text, location)
+
+            if m.group(2) is not None:
+                if kind != 'setting':
+                    raise CatalogError('%s: only settings can list their values' % location)
+                entry.values = re.findall(r'"[^"]*"|\S+', m.group(2))
+
+            catalog.entries[string_id] = entry
+            catalog.order.append(string_id)
+
+    if not catalog.code:
+        raise CatalogError('%s: missing @code directive' % filename)
+    if 'font' not in catalog.directives:
+        raise CatalogError('%s: missing @font directive' % filename)
+    return catalog
+
+
+#
+# u8g2 font handling
+#
+
+def load_font_data(fonts_file, name):
+    """Read the data of a font from the u8g2 font source file."""
+    with open(fonts_file, encoding='latin-1') as f:
+        source = f.read()
+
+    start = source.find('const uint8_t %s[' % name)
+    if start < 0:
+        raise CatalogError('Font %s not found in %s' % (name, fonts_file))
+    start = source.index('=', start) + 1
+    literals = re.compile(r'\s*"((?:[^"\\]|\\.)*)"').match
+
+    data = bytearray()
+    match = literals(source, start)
+    while match:
+        literal = match.group(1)
+        match = literals(source, match.end())
+        i = 0
+        while i < len(literal):
+            if literal[i] != '\\':
+                data.append(ord(literal[i]))
+                i += 1
+                continue
+            m = re.match(r'[0-7]{1,3}', literal[i + 1:])
+            if m:
+                data.append(int(m.group(0), 8))
+                i += 1 + len(m.group(0))
+            else:
+                data.append({'n': 10, 't': 9, 'r': 13, '\\': 92, '"': 34, '\'': 39, '?': 63}[literal[i + 1]])
+                i += 2
+    return bytes(data)
+
+
+class BitReader:
+    """Reads bit fields in the order used by the u8g2 glyph decoder."""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+        self.bit = 0
+
+    def unsigned(self, count):
+        value = self.data[self.pos] >> self.bit
+        end = self.bit + count
+        if end >= 8:
+            self.pos += 1
+            if self.pos < len(self.data):
+                value |= self.data[self.pos] << (8 - self.bit)
+            end -= 8
+        self.bit = end
+        return value & ((1 << count) - 1)
+
+    def signed(self, count):
+        return self.unsigned(count) - (1 << (count - 1))
+
+
+def to_signed(value):
+    return value - 256 if value > 127 else value
+
+
+class Glyph:
+    def __init__(self, font, encoding, record):
+        self.encoding = encoding
+        self.record = record
+        bits = BitReader(record[3 if encoding > 255 else 2:])
+        self.width = bits.unsigned(font.bits_per_char_width)
+        self.height = bits.unsigned(font.bits_per_char_height)
+        self.x = bits.signed(font.bits_per_char_x)
+        self.y = bits.signed(font.bits_per_char_y)
+        self.dx = bits.signed(font.bits_per_delta_x)
+        self.bits = bits
+
+    def bitmap(self, font):
+        """Decode the run length encoded glyph into rows of pixels."""
+        rows = [[0] * self.width for _ in range(self.height)]
+        if self.width == 0:
+            return rows
+        bits = BitReader(self.bits.data)
+        bits.pos = self.bits.pos
+        bits.bit = self.bits.bit
+        x = 0
+        y = 0
+
+        def run(length, color):
+            nonlocal x, y
+            while length > 0 and y < self.height:
+                count = min(length, self.width - x)
+                if color:
+                    for i in range(count):
+                        rows[y][x + i] = 1
+                length -= count
+                x += count
+                if x >= self.width:
+                    x = 0
+                    y += 1
+
+        while y < self.height:
+            zeros = bits.unsigned(font.bits_per_0)
+            ones = bits.unsigned(font.bits_per_1)
+            while True:
+                run(zeros, 0)
+                run(ones, 1)
+                if bits.unsigned(1) == 0:
+                    break
+        return rows
+
+
+class Font:
+    HEADER_SIZE = 23
+
+    def __init__(self, name, data):
+        self.name = name
+        self.header = bytearray(data[:Font.HEADER_SIZE])
+        self.bits_per_0 = data[2]
+        self.bits_per_1 = data[3]
+        self.bits_per_char_width = data[4]
+        self.bits_per_char_height = data[5]
+        self.bits_per_char_x = data[6]
+        self.bits_per_char_y = data[7]
+        self.bits_per_delta_x = data[8]
+        self.ascent = to_signed(data[13])
+        self.descent = to_signed(data[14])
+        self.glyphs = {}
+
+        # Glyphs up to 255 are a list of records, terminated by a zero length
+        pos = Font.HEADER_SIZE
+        while data[pos + 1] != 0:
+            self.glyphs[data[pos]] = Glyph(self, data[pos], data[pos:pos + data[pos + 1]])
+            pos += data[pos + 1]
+
+        # Larger glyphs follow a lookup table, and end with a zero encoding
+        table = Font.HEADER_SIZE + ((data[21] << 8) | data[22])
+        pos = table + ((data[table] << 8) | data[table + 1])
+        while pos + 1 < len(data):
+            encoding = (data[pos] << 8) | data[pos + 1]
+            if encoding == 0:
+                break
+            self.glyphs[encoding] = Glyph(self, encoding, data[pos:pos + data[pos + 2]])
+            pos += data[pos + 2]
+
+    @property
+    def line_height(self):
+        return self.ascent - self.descent
+
+    def text_width(self, text):
+        """Width of a line of text, calculated the same way as u8g2_GetUTF8Width()."""
+        width = 0
+        glyph = None
+        for ch in text:
+            glyph = self.glyphs[ord(ch)]
+            width += glyph.dx
+        if glyph and glyph.width != 0:
+            width += glyph.width + glyph.x - glyph.dx
+        return width
+
+    def subset(self, encodings):
+        """Build a font with only the given glyphs, in the u8g2 font format."""
+        small = sorted(e for e in encodings if e <= 255)
+        large = sorted(e for e in encodings if e > 255)
+
+        body = bytearray()
+        start_upper_a = None
+        start_lower_a = None
+        for encoding in small:
+            if start_upper_a is None and encoding >= ord('A'):
+                start_upper_a = len(body)
+            if start_lower_a is None and encoding >= ord('a'):
+                start_lower_a = len(body)
+            body += self.glyphs[encoding].record
+        if start_upper_a is None:
+            start_upper_a = len(body)
+        if start_lower_a is None:
+            start_lower_a = len(body)
+        body += b'\x00\x00'
+
+        # A single lookup table entry covers all of the larger glyphs
+        start_unicode = len(body)
+        body += b'\x00\x04\xff\xff'
+        for encoding in large:
+            body += self.glyphs[encoding].record
+        body += b'\x00\x00'
+
+        header = bytearray(self.header)
+        header[0] = len(encodings) & 0xFF
+        header[13] = self.ascent & 0xFF
+        header[14] = self.descent & 0xFF
+        header[17:19] = start_upper_a.to_bytes(2, 'big')
+        header[19:21] = start_lower_a.to_bytes(2, 'big')
+        header[21:23] = start_unicode.to_bytes(2, 'big')
+        return bytes(header + body)
+
+
+#
+# Language tables
+#
+
+class Language:
+    def __init__(self, catalog, font):
+        self.catalog = catalog
+        self.code = catalog.code
+        self.font = font
+        self.strings = {}
+        self.cell = font.glyphs[ord('0')].dx
+        self.columns = DISPLAY_WIDTH // self.cell
+
+    def columns_of(self, text):
+        """Width of text in character cells, using the same rule as ui_text_columns()."""
+        return sum(1 if ord(ch) <= 255 else 2 for ch in text)
+
+
+def build_languages(reference, catalogs, fonts_file):
+    font_cache = {}
+    languages = []
+    errors = []
+
+    language_ids = ['LANGUAGE_' + c.code for c in catalogs]
+    for catalog in catalogs:
+        name = catalog.directives['font']
+        if name not in font_cache:
+            font_cache[name] = load_font_data(fonts_file, name)
+        font = Font(name, font_cache[name])
+        if 'ascent' in catalog.directives:
+            font.ascent = int(catalog.directives['ascent'])
+        if 'descent' in catalog.directives:
+            font.descent = int(catalog.directives['descent'])
+        language = Language(catalog, font)
+
+        fallbacks = []
+        for string_id in reference.order:
+            entry = reference.entries[string_id]
+            if entry.join is not None:
+                continue
+            translated = catalog.entries.get(string_id)
+            if translated is not None and catalog is not reference:
+                if entry.fixed:
+                    errors.append('%s: %s is the same in every language' % (translated.location, string_id))
+                if translated.join is not None or translated.values is not None:
+                    errors.append('%s: joins and values are only given in the reference catalog' % translated.location)
+            if translated is None or translated.text is None or entry.fixed:
+                if not entry.fixed and catalog is not reference:
+                    fallbacks.append(string_id)
+                language.strings[string_id] = entry.text
+            else:
+                language.strings[string_id] = translated.text
+
+        for string_id in catalog.order:
+            if string_id not in reference.entries:
+                errors.append('%s: %s is not in the reference catalog' % (
+                    catalog.entries[string_id].location, string_id))
+
+        for string_id in reference.order:
+            entry = reference.entries[string_id]
+            if entry.join is not None:
+                missing = [s for s in entry.join if s not in language.strings]
+                if missing:
+                    errors.append('%s: %s joins unknown strings %s' % (entry.location, string_id, ', '.join(missing)))
+                    continue
+                language.strings[string_id] = '\n'.join(language.strings[s] for s in entry.join)
+
+        for other, string_id in zip(catalogs, language_ids):
+            language.strings[string_id] = other.code
+
+        if fallbacks:
+            print('%s: %d string(s) not translated: %s' % (catalog.filename, len(fallbacks), ', '.join(fallbacks)),
+                  file=sys.stderr)
+        languages.append(language)
+
+    return languages, language_ids, errors
+
+
+def check_language(language, reference, language_ids):
+    """Check that every string fits within its layout on the display."""
+    errors = []
+    font = language.font
+    code = language.code
+    line_height = font.line_height
+
+    def fail(string_id, message):
+        errors.append('%s: %s %s' % (code, string_id, message))
+
+    # Every glyph must be in the font, and must be one or two cells wide
+    for string_id, text in language.strings.items():
+        for ch in text:
+            if ch == '\n':
+                continue
+            glyph = font.glyphs.get(ord(ch))
+            if glyph is None:
+                fail(string_id, 'uses U+%04X which is not in %s' % (ord(ch), font.name))
+            elif glyph.dx != language.cell * language.columns_of(ch):
+                fail(string_id, 'uses U+%04X which does not fit the character cells of %s' % (ord(ch), font.name))
+            elif ord(ch) > 255 and (glyph.y + glyph.height > font.ascent or glyph.y < font.descent):
+                # Accents on capitals already reach into the line spacing
+                # of the Latin fonts, but larger glyphs have to fit the line
+                fail(string_id, 'uses U+%04X which is taller than the line height of %s' % (ord(ch), font.name))
+    if errors:
+        return errors
+
+    # A list needs room for its title and at least three items, and a
+    # message needs room for three lines of text above its buttons
+    list_rows = (DISPLAY_HEIGHT - LIST_TITLE_GAP) // (line_height + LIST_BORDER)
+    if list_rows < 4:
+        errors.append('%s: only %d rows of a list fit with %s' % (code, list_rows, font.name))
+    if 4 * line_height + BUTTON_TEXT_GAP > DISPLAY_HEIGHT:
+        errors.append('%s: a three line message does not fit with %s' % (code, font.name))
+
+    ids = reference.order + language_ids
+    for string_id in ids:
+        entry = reference.entries.get(string_id)
+        kind = entry.kind if entry else 'value'
+        text = language.strings[string_id]
+        lines = text.split('\n')
+        reserve = (entry.reserve if entry else 0) * language.cell
+
+        if kind == 'item':
+            for line in lines:
+                if font.text_width(line) + reserve > DISPLAY_WIDTH - 2 * LIST_BORDER:
+                    fail(string_id, 'line "%s" is too wide for a list' % line)
+            if entry.join is None and len(lines) > 1:
+                fail(string_id, 'must be a single line')
+
+        elif kind == 'title':
+            if len(lines) > 1:
+                fail(string_id, 'must be a single line')
+            elif font.text_width(text) + reserve > DISPLAY_WIDTH:
+                fail(string_id, 'is too wide for a title')
+
+        elif kind == 'text':
+            if len(lines) > entry.lines:
+                fail(string_id, 'has more than %d lines' % entry.lines)
+            for line in lines:
+                if font.text_width(line) + reserve > DISPLAY_WIDTH:
+                    fail(string_id, 'line "%s" is too wide' % line)
+
+        elif kind == 'button':
+            width = sum(font.text_width(line) + 2 * BUTTON_BORDER for line in lines)
+            width += (len(lines) - 1) * BUTTON_SPACING
+            if width > DISPLAY_WIDTH:
+                fail(string_id, 'buttons are too wide for the display')
+
+        elif kind == 'setting':
+            if len(lines) > 1:
+                fail(string_id, 'must be a single line')
+            for value in entry.values or []:
+                if value.startswith('"'):
+                    value_text = value[1:-1]
+                elif value in language.strings:
+                    value_text = language.strings[value]
+                else:
+                    fail(string_id, 'lists unknown value %s' % value)
+                    continue
+                # Setting lines are laid out as "label [value]" in character cells
+                cells = language.columns_of(text) + 1 + language.columns_of(value_text) + 2
+                if cells > language.columns:
+                    fail(string_id, 'does not fit beside value "%s"' % value_text)
+
+        elif kind == 'value':
+            if len(lines) > 1:
+                fail(string_id, 'must be a single line')
+
+    return errors
+
+
+#
+# Output
+#
+
+def pack_strings(language, ids):
+    """Pack strings into a single block, sharing the storage of common tails."""
+    encoded = {string_id: language.strings[string_id].encode('utf-8') for string_id in ids}
+    unique = sorted(set(encoded.values()), key=lambda s: (-len(s), s))
+
+    blob = bytearray()
+    placed = {}
+    for data in unique:
+        for other, offset in placed.items():
+            if other.endswith(data):
+                placed[data] = offset + len(other) - len(data)
+                break
+        else:
+            placed[data] = len(blob)
+            blob += data + b'\x00'
+
+    if len(blob) > 0xFFFF:
+        raise CatalogError('%s: string table is too large' % language.code)
+    return bytes(blob), [placed[encoded[string_id]] for string_id in ids]
+
+
+def c_string_lines(data, indent, width=76):
+    """Format bytes as C string literals, wrapped at the given width."""
+    lines = []
+    current = ''
+    for byte in data:
+        if 0x20 <= byte < 0x7F and chr(byte) not in '"\\?':
+            piece = chr(byte)
+        else:
+            piece = '\\%03o' % byte
+        if len(current) + len(piece) > width:
+            lines.append('%s"%s"' % (indent, current))
+            current = ''
+        current += piece
+    if current or not lines:
+        lines.append('%s"%s"' % (indent, current))
+    return lines
+
+
+def c_text_lines(blob, indent):
+    """Format a string block as C literals, with one string per line."""
+    lines = []
+    strings = blob.split(b'\x00')[:-1]
+    for i, data in enumerate(strings):
+        literal = ''
+        for byte in data:
+            if 0x20 <= byte < 0x7F and chr(byte) not in '"\\?':
+                literal += chr(byte)
+            elif byte == 0x0A:
+                literal += '\\n'
+            else:
+                literal += '\\%03o' % byte
+        if i < len(strings) - 1:
+            literal += '\\0'
+        lines.append('%s"%s"' % (indent, literal))
+    return lines
+
+
+def write_if_changed(filename, content):
+    try:
+        with open(filename, encoding='utf-8', newline='\n') as f:
+            if f.read() == content:
+                return
+    except OSError:
+        pass
+    with open(filename, 'w', encoding='utf-8', newline='\n') as f:
+        f.write(content)
+    print('Wrote %s' % filename, file=sys.stderr)
+
+
+def generate_header(ids, languages):
+    out = []
+    out.append('/*')
+    out.append(' * Localized string IDs, generated by tools/strings-gen.py')
+    out.append(' * from the catalogs in strings/. Do not edit.')
+    out.append(' */')
+    out.append('#ifndef UI_STRINGS_DATA_H')
+    out.append('#define UI_STRINGS_DATA_H')
+    out.append('')
+    out.append('typedef enum {')
+    for i, language in enumerate(languages):
+        out.append('    UI_LANGUAGE_%s%s,' % (language.code, ' = 0' if i == 0 else ''))
+    out.append('    UI_LANGUAGE_COUNT')
+    out.append('} ui_language_t;')
+    out.append('')
+    out.append('typedef enum {')
+    for i, string_id in enumerate(ids):
+        out.append('    STR_%s%s,' % (string_id, ' = 0' if i == 0 else ''))
+    out.append('    STR_COUNT')
+    out.append('} ui_string_t;')
+    out.append('')
+    out.append('#endif /* UI_STRINGS_DATA_H */')
+    return '\n'.join(out) + '\n'
+
+
+def generate_source(ids, languages):
+    out = []
+    out.append('/*')
+    out.append(' * Localized string tables, generated by tools/strings-gen.py')
+    out.append(' * from the catalogs in strings/. Do not edit.')
+    out.append(' */')
+    out.append('#include "ui_strings.h"')
+    out.append('')
+    out.append('#include "u8g2.h"')
+
+    font_names = {}
+    for language in languages:
+        name = language.code.lower()
+        blob, index = pack_strings(language, ids)
+
+        out.append('')
+        out.append('static const char ui_text_%s[%d] =' % (name, len(blob)))
+        out += c_text_lines(blob, '    ')
+        out[-1] += ';'
+        out.append('')
+        out.append('static const uint16_t ui_index_%s[STR_COUNT] = {' % name)
+        for i in range(0, len(index), 12):
+            out.append('    ' + ', '.join('%d' % v for v in index[i:i + 12]) + ',')
+        out[-1] = out[-1].rstrip(',')
+        out.append('};')
+
+        encodings = set(ASCII_GLYPHS)
+        for text in language.strings.values():
+            encodings.update(ord(ch) for ch in text if ch != '\n')
+        font_data = language.font.subset(encodings)
+        if font_data in font_names:
+            language.font_var = font_names[font_data]
+            continue
+        language.font_var = 'ui_font_%s' % name
+        font_names[font_data] = language.font_var
+
+        out.append('')
+        out.append('/* Glyphs of %s used by this language */' % language.font.name)
+        out.append('static const uint8_t %s[%d] U8G2_FONT_SECTION("%s") =' % (
+            language.font_var, len(font_data) + 1, language.font_var))
+        out += c_string_lines(font_data, '    ')
+        out[-1] += ';'
+
+    out.append('')
+    out.append('const ui_language_info_t ui_language_list[UI_LANGUAGE_COUNT] = {')
+    for language in languages:
+        name = language.code.lower()
+        out.append('    { ui_text_%s, ui_index_%s, %s, %d },' % (name, name, language.font_var, language.columns))
+    out[-1] = out[-1].rstrip(',')
+    out.append('};')
+    return '\n'.join(out) + '\n'
+
+
+def preview(language, ids):
+    """Print each string of a language as it would be drawn on the display."""
+    font = language.font
+    for string_id in ids:
+        print('%s:' % string_id)
+        for line in language.strings[string_id].split('\n'):
+            rows = [[' '] * DISPLAY_WIDTH for _ in range(font.ascent - font.descent)]
+            x = 0
+            for ch in line:
+                glyph = font.glyphs[ord(ch)]
+                bitmap = glyph.bitmap(font)
+                top = font.ascent - (glyph.y + glyph.height)
+                for gy, bits in enumerate(bitmap):
+                    for gx, bit in enumerate(bits):
+                        px = x + glyph.x + gx
+                        py = top + gy
+                        if bit and 0 <= py < len(rows) and px < DISPLAY_WIDTH:
+                            rows[py][px] = '#'
+                x += glyph.dx
+            clipped = '>' if font.text_width(line) > DISPLAY_WIDTH else '|'
+            for row in rows:
+                print('  |' + ''.join(row) + clipped)
+        print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate the localized display string tables')
+    parser.add_argument('--fonts', required=True, help='u8g2 font source file (u8g2_fonts.c)')
+    parser.add_argument('--output', help='directory to write ui_strings_data.c and ui_strings_data.h into')
+    parser.add_argument('--preview', metavar='CODE', help='draw the strings of a language instead of generating')
+    parser.add_argument('catalogs', nargs='+', help='language catalogs, starting with the reference catalog')
+    args = parser.parse_args()
+
+    try:
+        catalogs = [parse_catalog(filename) for filename in args.catalogs]
+        reference = catalogs[0]
+        codes = [c.code for c in catalogs]
+        if len(set(codes)) != len(codes):
+            raise CatalogError('Language codes must be unique')
+
+        languages, language_ids, errors = build_languages(reference, catalogs, args.fonts)
+        ids = [s for s in reference.order] + language_ids
+
+        if args.preview:
+            matches = [lang for lang in languages if lang.code == args.preview.upper()]
+            if not matches:
+                raise CatalogError('No catalog for language %s' % args.preview)
+            preview(matches[0], ids)
+            return 0
+
+        for language in languages:
+            errors += check_language(language, reference, language_ids)
+        if errors:
+            for error in errors:
+                print(error, file=sys.stderr)
+            return 1
+
+        if args.output:
+            write_if_changed(os.path.join(args.output, 'ui_strings_data.h'), generate_header(ids, languages))
+            write_if_changed(os.path.join(args.output, 'ui_strings_data.c'), generate_source(ids, languages))
+    except CatalogError as e:
+        print(e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())